@@ -2,15 +2,18 @@ import 'package:flutter/material.dart';
 import 'package:supabase_flutter/supabase_flutter.dart';
 import 'config.dart';
 import 'package:pharm_parrot_flutter/screens/main_screen.dart';
+import 'package:pharm_parrot_flutter/services/startup_timeline_service.dart';
 import 'package:pharm_parrot_flutter/theme/app_theme.dart';
 
 void main() async {
   WidgetsFlutterBinding.ensureInitialized();
+  StartupTimelineService.mark('dart_main');
   await Supabase.initialize(
     url: AppConfig.supabaseUrl,
     anonKey: AppConfig.supabaseAnonKey,
     realtimeClientOptions: const RealtimeClientOptions(),
   );
+  StartupTimelineService.mark('supabase_ready');
   runApp(const PharmParrotApp());
 }
 
@@ -0,0 +1,754 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io' show Platform;
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart' show kIsWeb, debugPrint;
+
+/// native/ffi/pharm_native_ffi.h 의 PharmGs1Record 와 동일한 레이아웃
+final class PharmGs1Record extends Struct {
+  @Int32()
+  external int status;
+
+  @Array(15)
+  external Array<Uint8> gtin;
+
+  @Array(7)
+  external Array<Uint8> expiry;
+
+  @Array(21)
+  external Array<Uint8> lot;
+
+  @Array(21)
+  external Array<Uint8> serial;
+}
+
+typedef _Gs1ParseNative = Int32 Function(
+    Pointer<Uint8> data, Int32 length, Pointer<PharmGs1Record> out);
+typedef _Gs1ParseDart = int Function(
+    Pointer<Uint8> data, int length, Pointer<PharmGs1Record> out);
+typedef _Gs1ParseBatchNative = Int32 Function(Pointer<Uint8> data,
+    Int32 length, Pointer<PharmGs1Record> out, Int32 capacity);
+typedef _Gs1ParseBatchDart = int Function(
+    Pointer<Uint8> data, int length, Pointer<PharmGs1Record> out, int capacity);
+
+/// native/ffi/pharm_native_ffi.h 의 PharmRecipeIndex (불투명 핸들)
+final class PharmRecipeIndex extends Opaque {}
+
+typedef _RecipeIndexCreateNative = Pointer<PharmRecipeIndex> Function();
+typedef _RecipeIndexDestroyNative = Void Function(Pointer<PharmRecipeIndex>);
+typedef _RecipeIndexBuildNative = Int32 Function(
+    Pointer<PharmRecipeIndex> index,
+    Pointer<Uint8> codes,
+    Int32 codesLength,
+    Pointer<Uint8> types,
+    Pointer<Uint8> complete,
+    Int32 count);
+typedef _RecipeIndexBuildDart = int Function(Pointer<PharmRecipeIndex> index,
+    Pointer<Uint8> codes, int codesLength, Pointer<Uint8> types,
+    Pointer<Uint8> complete, int count);
+typedef _RecipeIndexSetCompleteNative = Void Function(
+    Pointer<PharmRecipeIndex> index, Int32 row, Int32 complete);
+typedef _RecipeIndexSetCompleteDart = void Function(
+    Pointer<PharmRecipeIndex> index, int row, int complete);
+typedef _RecipeIndexLookupNative = Int32 Function(
+    Pointer<PharmRecipeIndex> index,
+    Pointer<Uint8> barcode,
+    Int32 length,
+    Pointer<Int32> rows,
+    Int32 capacity);
+typedef _RecipeIndexLookupDart = int Function(Pointer<PharmRecipeIndex> index,
+    Pointer<Uint8> barcode, int length, Pointer<Int32> rows, int capacity);
+
+/// native/ffi/pharm_native_ffi.h 의 PharmNameIndex (불투명 핸들)
+final class PharmNameIndex extends Opaque {}
+
+typedef _NameIndexBuildNative = Int32 Function(
+    Pointer<PharmNameIndex> index,
+    Pointer<Uint8> names,
+    Int32 namesLength,
+    Pointer<Uint8> numbers,
+    Int32 numbersLength,
+    Int32 count);
+typedef _NameIndexBuildDart = int Function(Pointer<PharmNameIndex> index,
+    Pointer<Uint8> names, int namesLength, Pointer<Uint8> numbers,
+    int numbersLength, int count);
+typedef _NameIndexSearchNative = Int32 Function(
+    Pointer<PharmNameIndex> index,
+    Pointer<Uint8> query,
+    Int32 length,
+    Pointer<Int32> ids,
+    Int32 capacity);
+typedef _NameIndexSearchDart = int Function(Pointer<PharmNameIndex> index,
+    Pointer<Uint8> query, int length, Pointer<Int32> ids, int capacity);
+
+/// native/ffi/pharm_native_ffi.h 의 PharmRecipeStore (불투명 핸들)
+final class PharmRecipeStore extends Opaque {}
+
+/// native/ffi/pharm_native_ffi.h 의 PharmRecipeTotals 와 동일한 레이아웃
+final class PharmRecipeTotals extends Struct {
+  @Double()
+  external double morning;
+  @Double()
+  external double afternoon;
+  @Double()
+  external double evening;
+  @Double()
+  external double night;
+}
+
+typedef _RecipeStoreResetNative = Int32 Function(
+    Pointer<PharmRecipeStore> store, Int32 rows);
+typedef _RecipeStoreResetDart = int Function(
+    Pointer<PharmRecipeStore> store, int rows);
+typedef _RecipeStoreColumnNative = Pointer<Void> Function(
+    Pointer<PharmRecipeStore> store, Int32 column);
+typedef _RecipeStoreColumnDart = Pointer<Void> Function(
+    Pointer<PharmRecipeStore> store, int column);
+typedef _RecipeStoreColumnForKeyNative = Int32 Function(
+    Pointer<Uint8> key, Int32 length, Pointer<Int32> rank);
+typedef _RecipeStoreColumnForKeyDart = int Function(
+    Pointer<Uint8> key, int length, Pointer<Int32> rank);
+typedef _RecipeStoreInternNative = Uint32 Function(
+    Pointer<PharmRecipeStore> store, Pointer<Uint8> value, Int32 length);
+typedef _RecipeStoreInternDart = int Function(
+    Pointer<PharmRecipeStore> store, Pointer<Uint8> value, int length);
+typedef _RecipeStoreStringNative = Pointer<Uint8> Function(
+    Pointer<PharmRecipeStore> store, Uint32 id, Pointer<Int32> length);
+typedef _RecipeStoreStringDart = Pointer<Uint8> Function(
+    Pointer<PharmRecipeStore> store, int id, Pointer<Int32> length);
+typedef _RecipeStoreTotalsNative = Void Function(
+    Pointer<PharmRecipeStore> store,
+    Int32 separation,
+    Pointer<PharmRecipeTotals> out);
+typedef _RecipeStoreTotalsDart = void Function(Pointer<PharmRecipeStore> store,
+    int separation, Pointer<PharmRecipeTotals> out);
+typedef _RecipeStoreSeparationsNative = Int32 Function(
+    Pointer<PharmRecipeStore> store, Pointer<Int32> out, Int32 capacity);
+typedef _RecipeStoreSeparationsDart = int Function(
+    Pointer<PharmRecipeStore> store, Pointer<Int32> out, int capacity);
+
+/// native/ffi/pharm_native_ffi.h 의 PharmRecordTable (불투명 핸들)
+final class PharmRecordTable extends Opaque {}
+
+typedef _RecordTableLoadJsonNative = Int32 Function(
+    Pointer<PharmRecordTable> table, Pointer<Uint8> json, Int32 length);
+typedef _RecordTableLoadJsonDart = int Function(
+    Pointer<PharmRecordTable> table, Pointer<Uint8> json, int length);
+typedef _RecordTableColumnNative = Pointer<Void> Function(
+    Pointer<PharmRecordTable> table, Int32 column);
+typedef _RecordTableColumnDart = Pointer<Void> Function(
+    Pointer<PharmRecordTable> table, int column);
+typedef _RecordTableStringNative = Pointer<Uint8> Function(
+    Pointer<PharmRecordTable> table, Uint32 id, Pointer<Int32> length);
+typedef _RecordTableStringDart = Pointer<Uint8> Function(
+    Pointer<PharmRecordTable> table, int id, Pointer<Int32> length);
+
+/// native/ffi/pharm_native_ffi.h 의 PharmUnitCache (불투명 핸들)
+final class PharmUnitCache extends Opaque {}
+
+/// native/ffi/pharm_native_ffi.h 의 PharmUnitCacheStats 와 동일한 레이아웃
+final class PharmUnitCacheStats extends Struct {
+  @Int64()
+  external int hits;
+  @Int64()
+  external int misses;
+  @Int64()
+  external int stale;
+  @Int64()
+  external int puts;
+  @Int64()
+  external int entries;
+  @Int64()
+  external int capacity;
+  @Int64()
+  external int generation;
+}
+
+typedef _UnitCacheOpenNative = Pointer<PharmUnitCache> Function(
+    Pointer<Utf8> path, Int32 capacity, Int64 ttlMs);
+typedef _UnitCacheOpenDart = Pointer<PharmUnitCache> Function(
+    Pointer<Utf8> path, int capacity, int ttlMs);
+typedef _UnitCacheLookupNative = Int32 Function(Pointer<PharmUnitCache> cache,
+    Pointer<Uint8> barcode, Int32 length, Int64 nowMs, Pointer<Double> unit);
+typedef _UnitCacheLookupDart = int Function(Pointer<PharmUnitCache> cache,
+    Pointer<Uint8> barcode, int length, int nowMs, Pointer<Double> unit);
+typedef _UnitCachePutNative = Int32 Function(Pointer<PharmUnitCache> cache,
+    Pointer<Uint8> barcode, Int32 length, Double unit, Int64 nowMs);
+typedef _UnitCachePutDart = int Function(Pointer<PharmUnitCache> cache,
+    Pointer<Uint8> barcode, int length, double unit, int nowMs);
+typedef _UnitCacheSetGenerationNative = Void Function(
+    Pointer<PharmUnitCache> cache, Int32 generation);
+typedef _UnitCacheSetGenerationDart = void Function(
+    Pointer<PharmUnitCache> cache, int generation);
+typedef _UnitCacheStatsNative = Void Function(
+    Pointer<PharmUnitCache> cache, Pointer<PharmUnitCacheStats> out);
+typedef _UnitCacheStatsDart = void Function(
+    Pointer<PharmUnitCache> cache, Pointer<PharmUnitCacheStats> out);
+
+/// native/ffi/pharm_native_ffi.h 의 PharmDaySnapshot (불투명 핸들)
+final class PharmDaySnapshot extends Opaque {}
+
+/// native/ffi/pharm_native_ffi.h 의 PharmDaySnapshotStats 와 동일한 레이아웃
+final class PharmDaySnapshotStats extends Struct {
+  @Int64()
+  external int hits;
+  @Int64()
+  external int misses;
+  @Int64()
+  external int puts;
+  @Int64()
+  external int changed;
+  @Int64()
+  external int compactions;
+  @Int64()
+  external int dropped;
+  @Int64()
+  external int entries;
+  @Int64()
+  external int liveBytes;
+  @Int64()
+  external int fileBytes;
+  @Int64()
+  external int generation;
+  @Int64()
+  external int syncedMs;
+}
+
+typedef _DaySnapshotOpenNative = Pointer<PharmDaySnapshot> Function(
+    Pointer<Utf8> path, Int32 day);
+typedef _DaySnapshotOpenDart = Pointer<PharmDaySnapshot> Function(
+    Pointer<Utf8> path, int day);
+typedef _DaySnapshotGetNative = Int64 Function(
+    Pointer<PharmDaySnapshot> snapshot,
+    Int32 kind,
+    Int64 key,
+    Pointer<Uint8> buffer,
+    Int64 capacity,
+    Pointer<Int64> fetchedMs);
+typedef _DaySnapshotGetDart = int Function(Pointer<PharmDaySnapshot> snapshot,
+    int kind, int key, Pointer<Uint8> buffer, int capacity,
+    Pointer<Int64> fetchedMs);
+typedef _DaySnapshotPutNative = Int32 Function(
+    Pointer<PharmDaySnapshot> snapshot,
+    Int32 kind,
+    Int64 key,
+    Pointer<Uint8> json,
+    Int64 length,
+    Int64 nowMs);
+typedef _DaySnapshotPutDart = int Function(Pointer<PharmDaySnapshot> snapshot,
+    int kind, int key, Pointer<Uint8> json, int length, int nowMs);
+typedef _DaySnapshotMarkDirtyNative = Void Function(
+    Pointer<PharmDaySnapshot> snapshot, Int64 tfn);
+typedef _DaySnapshotMarkDirtyDart = void Function(
+    Pointer<PharmDaySnapshot> snapshot, int tfn);
+typedef _DaySnapshotToFetchNative = Int32 Function(
+    Pointer<PharmDaySnapshot> snapshot, Pointer<Int64> out, Int32 capacity);
+typedef _DaySnapshotToFetchDart = int Function(
+    Pointer<PharmDaySnapshot> snapshot, Pointer<Int64> out, int capacity);
+typedef _DaySnapshotCommitNative = Int32 Function(
+    Pointer<PharmDaySnapshot> snapshot, Int64 nowMs);
+typedef _DaySnapshotCommitDart = int Function(
+    Pointer<PharmDaySnapshot> snapshot, int nowMs);
+typedef _DaySnapshotStatsNative = Void Function(
+    Pointer<PharmDaySnapshot> snapshot, Pointer<PharmDaySnapshotStats> out);
+typedef _DaySnapshotStatsDart = void Function(
+    Pointer<PharmDaySnapshot> snapshot, Pointer<PharmDaySnapshotStats> out);
+
+/// native/ffi/pharm_native_ffi.h 의 PharmCheckJournal (불투명 핸들)
+final class PharmCheckJournal extends Opaque {}
+
+/// native/ffi/pharm_native_ffi.h 의 PharmCheckEntry 와 동일한 레이아웃
+final class PharmCheckEntry extends Struct {
+  @Int64()
+  external int seq;
+  @Int64()
+  external int rxrecipeId;
+  @Int64()
+  external int createdMs;
+  @Int32()
+  external int delta;
+  @Array(256)
+  external Array<Uint8> packSerial;
+}
+
+/// native/ffi/pharm_native_ffi.h 의 PharmCheckJournalStats 와 동일한 레이아웃
+final class PharmCheckJournalStats extends Struct {
+  @Int64()
+  external int appended;
+  @Int64()
+  external int acked;
+  @Int64()
+  external int duplicates;
+  @Int64()
+  external int failures;
+  @Int64()
+  external int syncs;
+  @Int64()
+  external int replayed;
+  @Int64()
+  external int pending;
+  @Int64()
+  external int inFlight;
+  @Int64()
+  external int fileBytes;
+  @Int64()
+  external int backoffMs;
+  @Int64()
+  external int rejected;
+  @Int64()
+  external int unknown;
+  @Int64()
+  external int unsettled;
+}
+
+typedef _CheckJournalAppendNative = Int64 Function(
+    Pointer<PharmCheckJournal> journal,
+    Int64 rxrecipeId,
+    Int32 delta,
+    Pointer<Uint8> packSerial,
+    Int32 serialLength,
+    Int64 nowMs);
+typedef _CheckJournalAppendDart = int Function(
+    Pointer<PharmCheckJournal> journal,
+    int rxrecipeId,
+    int delta,
+    Pointer<Uint8> packSerial,
+    int serialLength,
+    int nowMs);
+typedef _CheckJournalTakeBatchNative = Int32 Function(
+    Pointer<PharmCheckJournal> journal,
+    Pointer<PharmCheckEntry> out,
+    Int32 capacity,
+    Int64 nowMs);
+typedef _CheckJournalTakeBatchDart = int Function(
+    Pointer<PharmCheckJournal> journal,
+    Pointer<PharmCheckEntry> out,
+    int capacity,
+    int nowMs);
+typedef _CheckJournalTakeUnsettledNative = Int32 Function(
+    Pointer<PharmCheckJournal> journal,
+    Pointer<PharmCheckEntry> out,
+    Int32 capacity);
+typedef _CheckJournalTakeUnsettledDart = int Function(
+    Pointer<PharmCheckJournal> journal,
+    Pointer<PharmCheckEntry> out,
+    int capacity);
+typedef _CheckJournalAckNative = Void Function(
+    Pointer<PharmCheckJournal> journal, Int64 seq, Int32 affected);
+typedef _CheckJournalAckDart = void Function(
+    Pointer<PharmCheckJournal> journal, int seq, int affected);
+typedef _CheckJournalTimedNative = Void Function(
+    Pointer<PharmCheckJournal> journal, Int64 seq, Int64 nowMs);
+typedef _CheckJournalTimedDart = void Function(
+    Pointer<PharmCheckJournal> journal, int seq, int nowMs);
+typedef _CheckJournalSyncIfDueNative = Void Function(
+    Pointer<PharmCheckJournal> journal, Int64 nowMs);
+typedef _CheckJournalSyncIfDueDart = void Function(
+    Pointer<PharmCheckJournal> journal, int nowMs);
+typedef _CheckJournalStatsNative = Void Function(
+    Pointer<PharmCheckJournal> journal, Pointer<PharmCheckJournalStats> out);
+typedef _CheckJournalStatsDart = void Function(
+    Pointer<PharmCheckJournal> journal, Pointer<PharmCheckJournalStats> out);
+
+/// native/ffi/pharm_native_ffi.h 의 PharmSerialFilter (불투명 핸들)
+final class PharmSerialFilter extends Opaque {}
+
+/// native/ffi/pharm_native_ffi.h 의 PharmSerialFilterStats 와 동일한 레이아웃
+final class PharmSerialFilterStats extends Struct {
+  @Int64()
+  external int lookups;
+  @Int64()
+  external int bloomNegatives;
+  @Int64()
+  external int pendingHits;
+  @Int64()
+  external int confirmedHits;
+  @Int64()
+  external int entries;
+  @Int64()
+  external int loaded;
+}
+
+typedef _SerialFilterOpenNative = Pointer<PharmSerialFilter> Function(
+    Pointer<Utf8> path, Int32 today);
+typedef _SerialFilterOpenDart = Pointer<PharmSerialFilter> Function(
+    Pointer<Utf8> path, int today);
+typedef _SerialFilterLookupNative = Int32 Function(
+    Pointer<PharmSerialFilter> filter,
+    Int32 day,
+    Int64 scope,
+    Pointer<Uint8> serial,
+    Int32 length);
+typedef _SerialFilterLookupDart = int Function(
+    Pointer<PharmSerialFilter> filter,
+    int day,
+    int scope,
+    Pointer<Uint8> serial,
+    int length);
+typedef _SerialFilterRecordNative = Void Function(
+    Pointer<PharmSerialFilter> filter,
+    Int32 day,
+    Int64 scope,
+    Pointer<Uint8> serial,
+    Int32 length,
+    Int32 state);
+typedef _SerialFilterRecordDart = void Function(
+    Pointer<PharmSerialFilter> filter,
+    int day,
+    int scope,
+    Pointer<Uint8> serial,
+    int length,
+    int state);
+typedef _SerialFilterStatsNative = Void Function(
+    Pointer<PharmSerialFilter> filter, Pointer<PharmSerialFilterStats> out);
+typedef _SerialFilterStatsDart = void Function(
+    Pointer<PharmSerialFilter> filter, Pointer<PharmSerialFilterStats> out);
+
+typedef _TraceRecordNative = Void Function(Pointer<Uint8> name, Int32 length,
+    Int64 scanId, Int64 beginNs, Int64 endNs);
+typedef _TraceRecordDart = void Function(
+    Pointer<Uint8> name, int length, int scanId, int beginNs, int endNs);
+typedef _TraceSetThreadNameNative = Void Function(
+    Pointer<Uint8> name, Int32 length);
+typedef _TraceSetThreadNameDart = void Function(
+    Pointer<Uint8> name, int length);
+typedef _TraceWriteNative = Int32 Function(
+    Pointer<Utf8> path, Pointer<Uint8> extraEvents, Int32 extraLength);
+typedef _TraceWriteDart = int Function(
+    Pointer<Utf8> path, Pointer<Uint8> extraEvents, int extraLength);
+
+/// native/ffi/pharm_native_ffi.h 의 PharmMetricCounter (불투명 핸들)
+final class PharmMetricCounter extends Opaque {}
+
+/// native/ffi/pharm_native_ffi.h 의 PharmMetricGauge (불투명 핸들)
+final class PharmMetricGauge extends Opaque {}
+
+/// native/ffi/pharm_native_ffi.h 의 PharmMetricHistogram (불투명 핸들)
+final class PharmMetricHistogram extends Opaque {}
+
+typedef _MetricsLookupNative<T extends NativeType> = Pointer<T> Function(
+    Pointer<Utf8> name,
+    Pointer<Utf8> labelKey,
+    Pointer<Utf8> labelValue,
+    Pointer<Utf8> help);
+typedef _MetricsLookupDart<T extends NativeType> = Pointer<T> Function(
+    Pointer<Utf8> name,
+    Pointer<Utf8> labelKey,
+    Pointer<Utf8> labelValue,
+    Pointer<Utf8> help);
+
+/// pharm_native_ffi 공유 라이브러리 바인딩
+///
+/// 라이브러리를 찾지 못하면 [instance] 는 null 이며, 호출 측은 Dart 구현으로
+/// 대체해야 한다.
+class PharmNativeBindings {
+  PharmNativeBindings._(DynamicLibrary lib)
+      : gs1Parse =
+            lib.lookupFunction<_Gs1ParseNative, _Gs1ParseDart>('pharm_gs1_parse'),
+        gs1ParseBatch = lib.lookupFunction<_Gs1ParseBatchNative,
+            _Gs1ParseBatchDart>('pharm_gs1_parse_batch'),
+        recipeIndexCreate = lib.lookupFunction<_RecipeIndexCreateNative,
+            Pointer<PharmRecipeIndex> Function()>('pharm_recipe_index_create'),
+        recipeIndexDestroy = lib.lookupFunction<_RecipeIndexDestroyNative,
+                void Function(Pointer<PharmRecipeIndex>)>(
+            'pharm_recipe_index_destroy'),
+        recipeIndexBuild =
+            lib.lookupFunction<_RecipeIndexBuildNative, _RecipeIndexBuildDart>(
+                'pharm_recipe_index_build'),
+        recipeIndexSetComplete = lib.lookupFunction<
+            _RecipeIndexSetCompleteNative,
+            _RecipeIndexSetCompleteDart>('pharm_recipe_index_set_complete'),
+        recipeIndexLookup = lib.lookupFunction<_RecipeIndexLookupNative,
+            _RecipeIndexLookupDart>('pharm_recipe_index_lookup'),
+        nameIndexCreate = lib.lookupFunction<
+            Pointer<PharmNameIndex> Function(),
+            Pointer<PharmNameIndex> Function()>('pharm_name_index_create'),
+        nameIndexDestroy = lib.lookupFunction<
+            Void Function(Pointer<PharmNameIndex>),
+            void Function(Pointer<PharmNameIndex>)>('pharm_name_index_destroy'),
+        nameIndexBuild =
+            lib.lookupFunction<_NameIndexBuildNative, _NameIndexBuildDart>(
+                'pharm_name_index_build'),
+        nameIndexSearch =
+            lib.lookupFunction<_NameIndexSearchNative, _NameIndexSearchDart>(
+                'pharm_name_index_search'),
+        recipeStoreCreate = lib.lookupFunction<
+            Pointer<PharmRecipeStore> Function(),
+            Pointer<PharmRecipeStore> Function()>('pharm_recipe_store_create'),
+        recipeStoreDestroy = lib.lookupFunction<
+            Void Function(Pointer<PharmRecipeStore>),
+            void Function(
+                Pointer<PharmRecipeStore>)>('pharm_recipe_store_destroy'),
+        recipeStoreReset =
+            lib.lookupFunction<_RecipeStoreResetNative, _RecipeStoreResetDart>(
+                'pharm_recipe_store_reset'),
+        recipeStoreColumn = lib.lookupFunction<_RecipeStoreColumnNative,
+            _RecipeStoreColumnDart>('pharm_recipe_store_column'),
+        recipeStoreColumnForKey = lib.lookupFunction<
+            _RecipeStoreColumnForKeyNative,
+            _RecipeStoreColumnForKeyDart>('pharm_recipe_store_column_for_key'),
+        recipeStoreIntern = lib.lookupFunction<_RecipeStoreInternNative,
+            _RecipeStoreInternDart>('pharm_recipe_store_intern'),
+        recipeStoreString = lib.lookupFunction<_RecipeStoreStringNative,
+            _RecipeStoreStringDart>('pharm_recipe_store_string'),
+        recipeStoreTotals = lib.lookupFunction<_RecipeStoreTotalsNative,
+            _RecipeStoreTotalsDart>('pharm_recipe_store_totals'),
+        recipeStoreSeparations = lib.lookupFunction<
+            _RecipeStoreSeparationsNative,
+            _RecipeStoreSeparationsDart>('pharm_recipe_store_separations'),
+        recordTableCreate = lib.lookupFunction<
+            Pointer<PharmRecordTable> Function(Int32),
+            Pointer<PharmRecordTable> Function(
+                int)>('pharm_record_table_create'),
+        recordTableDestroy = lib.lookupFunction<
+            Void Function(Pointer<PharmRecordTable>),
+            void Function(
+                Pointer<PharmRecordTable>)>('pharm_record_table_destroy'),
+        recordTableLoadJson = lib.lookupFunction<_RecordTableLoadJsonNative,
+            _RecordTableLoadJsonDart>('pharm_record_table_load_json'),
+        recordTableColumn = lib.lookupFunction<_RecordTableColumnNative,
+            _RecordTableColumnDart>('pharm_record_table_column'),
+        recordTableString = lib.lookupFunction<_RecordTableStringNative,
+            _RecordTableStringDart>('pharm_record_table_string'),
+        unitCacheOpen = lib.lookupFunction<_UnitCacheOpenNative,
+            _UnitCacheOpenDart>('pharm_unit_cache_open'),
+        unitCacheClose = lib.lookupFunction<
+            Void Function(Pointer<PharmUnitCache>),
+            void Function(Pointer<PharmUnitCache>)>('pharm_unit_cache_close'),
+        unitCacheLookup = lib.lookupFunction<_UnitCacheLookupNative,
+            _UnitCacheLookupDart>('pharm_unit_cache_lookup'),
+        unitCachePut =
+            lib.lookupFunction<_UnitCachePutNative, _UnitCachePutDart>(
+                'pharm_unit_cache_put'),
+        unitCacheSetGeneration = lib.lookupFunction<
+            _UnitCacheSetGenerationNative,
+            _UnitCacheSetGenerationDart>('pharm_unit_cache_set_generation'),
+        unitCacheStats =
+            lib.lookupFunction<_UnitCacheStatsNative, _UnitCacheStatsDart>(
+                'pharm_unit_cache_stats'),
+        daySnapshotOpen = lib.lookupFunction<_DaySnapshotOpenNative,
+            _DaySnapshotOpenDart>('pharm_day_snapshot_open'),
+        daySnapshotClose = lib.lookupFunction<
+            Void Function(Pointer<PharmDaySnapshot>),
+            void Function(
+                Pointer<PharmDaySnapshot>)>('pharm_day_snapshot_close'),
+        daySnapshotGet =
+            lib.lookupFunction<_DaySnapshotGetNative, _DaySnapshotGetDart>(
+                'pharm_day_snapshot_get'),
+        daySnapshotPut =
+            lib.lookupFunction<_DaySnapshotPutNative, _DaySnapshotPutDart>(
+                'pharm_day_snapshot_put'),
+        daySnapshotMarkDirty = lib.lookupFunction<_DaySnapshotMarkDirtyNative,
+            _DaySnapshotMarkDirtyDart>('pharm_day_snapshot_mark_dirty'),
+        daySnapshotRecipesToFetch = lib.lookupFunction<
+                _DaySnapshotToFetchNative, _DaySnapshotToFetchDart>(
+            'pharm_day_snapshot_recipes_to_fetch'),
+        daySnapshotCommit = lib.lookupFunction<_DaySnapshotCommitNative,
+            _DaySnapshotCommitDart>('pharm_day_snapshot_commit'),
+        daySnapshotStats = lib.lookupFunction<_DaySnapshotStatsNative,
+            _DaySnapshotStatsDart>('pharm_day_snapshot_stats'),
+        checkJournalOpen = lib.lookupFunction<
+            Pointer<PharmCheckJournal> Function(Pointer<Utf8>),
+            Pointer<PharmCheckJournal> Function(
+                Pointer<Utf8>)>('pharm_check_journal_open'),
+        checkJournalClose = lib.lookupFunction<
+            Void Function(Pointer<PharmCheckJournal>),
+            void Function(
+                Pointer<PharmCheckJournal>)>('pharm_check_journal_close'),
+        checkJournalAppend = lib.lookupFunction<_CheckJournalAppendNative,
+            _CheckJournalAppendDart>('pharm_check_journal_append'),
+        checkJournalTakeBatch = lib.lookupFunction<
+            _CheckJournalTakeBatchNative,
+            _CheckJournalTakeBatchDart>('pharm_check_journal_take_batch'),
+        checkJournalTakeUnsettled = lib.lookupFunction<
+                _CheckJournalTakeUnsettledNative,
+                _CheckJournalTakeUnsettledDart>(
+            'pharm_check_journal_take_unsettled'),
+        checkJournalAck =
+            lib.lookupFunction<_CheckJournalAckNative, _CheckJournalAckDart>(
+                'pharm_check_journal_ack'),
+        checkJournalFail = lib.lookupFunction<_CheckJournalTimedNative,
+            _CheckJournalTimedDart>('pharm_check_journal_fail'),
+        checkJournalSyncIfDue = lib.lookupFunction<
+            _CheckJournalSyncIfDueNative,
+            _CheckJournalSyncIfDueDart>('pharm_check_journal_sync_if_due'),
+        checkJournalStats = lib.lookupFunction<_CheckJournalStatsNative,
+            _CheckJournalStatsDart>('pharm_check_journal_stats'),
+        serialFilterOpen = lib.lookupFunction<_SerialFilterOpenNative,
+            _SerialFilterOpenDart>('pharm_serial_filter_open'),
+        serialFilterClose = lib.lookupFunction<
+            Void Function(Pointer<PharmSerialFilter>),
+            void Function(
+                Pointer<PharmSerialFilter>)>('pharm_serial_filter_close'),
+        serialFilterLookup = lib.lookupFunction<_SerialFilterLookupNative,
+            _SerialFilterLookupDart>('pharm_serial_filter_lookup'),
+        serialFilterRecord = lib.lookupFunction<_SerialFilterRecordNative,
+            _SerialFilterRecordDart>('pharm_serial_filter_record'),
+        serialFilterStats = lib.lookupFunction<_SerialFilterStatsNative,
+            _SerialFilterStatsDart>('pharm_serial_filter_stats'),
+        traceSetEnabled =
+            lib.lookupFunction<Void Function(Int32), void Function(int)>(
+                'pharm_trace_set_enabled'),
+        traceNowNs = lib.lookupFunction<Int64 Function(), int Function()>(
+            'pharm_trace_now_ns'),
+        traceNextScanId = lib.lookupFunction<Int64 Function(), int Function()>(
+            'pharm_trace_next_scan_id'),
+        traceRecord = lib.lookupFunction<_TraceRecordNative, _TraceRecordDart>(
+            'pharm_trace_record'),
+        traceSetThreadName = lib.lookupFunction<_TraceSetThreadNameNative,
+            _TraceSetThreadNameDart>('pharm_trace_set_thread_name'),
+        traceClear = lib.lookupFunction<Void Function(), void Function()>(
+            'pharm_trace_clear'),
+        traceWrite = lib.lookupFunction<_TraceWriteNative, _TraceWriteDart>(
+            'pharm_trace_write'),
+        metricsCounter = lib.lookupFunction<
+            _MetricsLookupNative<PharmMetricCounter>,
+            _MetricsLookupDart<PharmMetricCounter>>('pharm_metrics_counter'),
+        metricsCounterAdd = lib.lookupFunction<
+            Void Function(Pointer<PharmMetricCounter>, Int64),
+            void Function(Pointer<PharmMetricCounter>,
+                int)>('pharm_metrics_counter_add'),
+        metricsGauge = lib.lookupFunction<
+            _MetricsLookupNative<PharmMetricGauge>,
+            _MetricsLookupDart<PharmMetricGauge>>('pharm_metrics_gauge'),
+        metricsGaugeSet = lib.lookupFunction<
+            Void Function(Pointer<PharmMetricGauge>, Int64),
+            void Function(
+                Pointer<PharmMetricGauge>, int)>('pharm_metrics_gauge_set'),
+        metricsHistogram = lib.lookupFunction<
+                _MetricsLookupNative<PharmMetricHistogram>,
+                _MetricsLookupDart<PharmMetricHistogram>>(
+            'pharm_metrics_histogram'),
+        metricsHistogramRecord = lib.lookupFunction<
+            Void Function(Pointer<PharmMetricHistogram>, Int64),
+            void Function(Pointer<PharmMetricHistogram>,
+                int)>('pharm_metrics_histogram_record'),
+        metricsWrite = lib.lookupFunction<Int32 Function(Pointer<Utf8>),
+            int Function(Pointer<Utf8>)>('pharm_metrics_write'),
+        metricsStartWriter = lib.lookupFunction<
+            Void Function(Pointer<Utf8>, Int32),
+            void Function(Pointer<Utf8>, int)>('pharm_metrics_start_writer');
+
+  final int Function(Pointer<Uint8>, int, Pointer<PharmGs1Record>) gs1Parse;
+  final int Function(Pointer<Uint8>, int, Pointer<PharmGs1Record>, int)
+      gs1ParseBatch;
+
+  final Pointer<PharmRecipeIndex> Function() recipeIndexCreate;
+  final void Function(Pointer<PharmRecipeIndex>) recipeIndexDestroy;
+  final _RecipeIndexBuildDart recipeIndexBuild;
+  final _RecipeIndexSetCompleteDart recipeIndexSetComplete;
+  final _RecipeIndexLookupDart recipeIndexLookup;
+
+  final Pointer<PharmNameIndex> Function() nameIndexCreate;
+  final void Function(Pointer<PharmNameIndex>) nameIndexDestroy;
+  final _NameIndexBuildDart nameIndexBuild;
+  final _NameIndexSearchDart nameIndexSearch;
+
+  final Pointer<PharmRecipeStore> Function() recipeStoreCreate;
+  final void Function(Pointer<PharmRecipeStore>) recipeStoreDestroy;
+  final _RecipeStoreResetDart recipeStoreReset;
+  final _RecipeStoreColumnDart recipeStoreColumn;
+  final _RecipeStoreColumnForKeyDart recipeStoreColumnForKey;
+  final _RecipeStoreInternDart recipeStoreIntern;
+  final _RecipeStoreStringDart recipeStoreString;
+  final _RecipeStoreTotalsDart recipeStoreTotals;
+  final _RecipeStoreSeparationsDart recipeStoreSeparations;
+
+  final Pointer<PharmRecordTable> Function(int schema) recordTableCreate;
+  final void Function(Pointer<PharmRecordTable>) recordTableDestroy;
+  final _RecordTableLoadJsonDart recordTableLoadJson;
+  final _RecordTableColumnDart recordTableColumn;
+  final _RecordTableStringDart recordTableString;
+
+  final _UnitCacheOpenDart unitCacheOpen;
+  final void Function(Pointer<PharmUnitCache>) unitCacheClose;
+  final _UnitCacheLookupDart unitCacheLookup;
+  final _UnitCachePutDart unitCachePut;
+  final _UnitCacheSetGenerationDart unitCacheSetGeneration;
+  final _UnitCacheStatsDart unitCacheStats;
+
+  final _DaySnapshotOpenDart daySnapshotOpen;
+  final void Function(Pointer<PharmDaySnapshot>) daySnapshotClose;
+  final _DaySnapshotGetDart daySnapshotGet;
+  final _DaySnapshotPutDart daySnapshotPut;
+  final _DaySnapshotMarkDirtyDart daySnapshotMarkDirty;
+  final _DaySnapshotToFetchDart daySnapshotRecipesToFetch;
+  final _DaySnapshotCommitDart daySnapshotCommit;
+  final _DaySnapshotStatsDart daySnapshotStats;
+
+  final Pointer<PharmCheckJournal> Function(Pointer<Utf8>) checkJournalOpen;
+  final void Function(Pointer<PharmCheckJournal>) checkJournalClose;
+  final _CheckJournalAppendDart checkJournalAppend;
+  final _CheckJournalTakeBatchDart checkJournalTakeBatch;
+  final _CheckJournalTakeUnsettledDart checkJournalTakeUnsettled;
+  final _CheckJournalAckDart checkJournalAck;
+  final _CheckJournalTimedDart checkJournalFail;
+  final _CheckJournalSyncIfDueDart checkJournalSyncIfDue;
+  final _CheckJournalStatsDart checkJournalStats;
+
+  final _SerialFilterOpenDart serialFilterOpen;
+  final void Function(Pointer<PharmSerialFilter>) serialFilterClose;
+  final _SerialFilterLookupDart serialFilterLookup;
+  final _SerialFilterRecordDart serialFilterRecord;
+  final _SerialFilterStatsDart serialFilterStats;
+
+  final void Function(int) traceSetEnabled;
+  final int Function() traceNowNs;
+  final int Function() traceNextScanId;
+  final _TraceRecordDart traceRecord;
+  final _TraceSetThreadNameDart traceSetThreadName;
+  final void Function() traceClear;
+  final _TraceWriteDart traceWrite;
+
+  final _MetricsLookupDart<PharmMetricCounter> metricsCounter;
+  final void Function(Pointer<PharmMetricCounter>, int) metricsCounterAdd;
+  final _MetricsLookupDart<PharmMetricGauge> metricsGauge;
+  final void Function(Pointer<PharmMetricGauge>, int) metricsGaugeSet;
+  final _MetricsLookupDart<PharmMetricHistogram> metricsHistogram;
+  final void Function(Pointer<PharmMetricHistogram>, int)
+      metricsHistogramRecord;
+  final int Function(Pointer<Utf8>) metricsWrite;
+  final void Function(Pointer<Utf8>, int) metricsStartWriter;
+
+  static PharmNativeBindings? _instance;
+  static bool _loaded = false;
+
+  static PharmNativeBindings? get instance {
+    if (_loaded) return _instance;
+    _loaded = true;
+    if (kIsWeb) return null;
+    try {
+      final DynamicLibrary lib;
+      if (Platform.isWindows) {
+        lib = DynamicLibrary.open('pharm_native_ffi.dll');
+      } else if (Platform.isLinux) {
+        lib = DynamicLibrary.open('libpharm_native_ffi.so');
+      } else {
+        return null;
+      }
+      _instance = PharmNativeBindings._(lib);
+    } catch (e) {
+      debugPrint('[Native] pharm_native_ffi 로드 실패: $e');
+    }
+    return _instance;
+  }
+}
+
+/// NUL 로 끝나는 고정 길이 char 배열(UTF-8)을 문자열로 변환
+String readFixedString(Array<Uint8> chars, int capacity) {
+  final bytes = <int>[];
+  for (var i = 0; i < capacity; i++) {
+    final c = chars[i];
+    if (c == 0) break;
+    bytes.add(c);
+  }
+  return utf8.decode(bytes, allowMalformed: true);
+}
+
+/// 문자열을 네이티브 버퍼로 복사한다. 호출 측에서 [malloc.free] 해야 한다.
+Pointer<Uint8> toNativeBytes(List<int> bytes) {
+  final ptr = malloc<Uint8>(bytes.isEmpty ? 1 : bytes.length);
+  ptr.asTypedList(bytes.isEmpty ? 1 : bytes.length).setAll(0, bytes);
+  return ptr;
+}
@@ -23,6 +23,19 @@ import 'package:shared_preferences/shared_preferences.dart';
 import '../services/supabase_service.dart';
 import '../services/native_tts_service.dart';
 import '../services/com_port_service.dart';
+import '../services/gs1_barcode_service.dart';
+import '../services/metrics_service.dart';
+import '../services/name_index.dart';
+import '../services/check_journal.dart';
+import '../services/day_snapshot.dart';
+import '../services/recipe_index.dart';
+import '../services/recipe_store.dart';
+import '../services/serial_filter.dart';
+import '../services/serial_ports_service.dart';
+import '../services/keyboard_scanner_service.dart';
+import '../services/startup_timeline_service.dart';
+import '../services/trace_service.dart';
+import '../services/unit_cache.dart';
 import '../widgets/patient_drug_dialog.dart';
 
 num asNum(dynamic v, [num def = 0]) {
@@ -72,6 +85,15 @@ class _MainScreenState extends State<MainScreen> {
   final NativeTtsService _tts = NativeTtsService();
   final ScrollController _scrollController = ScrollController();
   late final ComPortService _comPortService;
+  // 설정의 'extraScannerPorts' (장치 경로 목록) 스캐너들, id 는 1부터
+  late final SerialPortsService _extraScanners;
+  List<String> _extraScannerPorts = const [];
+  // USB HID 스캐너: 설정의 'useKeyboardScanner' (기본 꺼짐, 켜면 창의 키
+  // 입력을 가로챈다), 'keyboardScannerMaxGapMs', 'keyboardScannerMinLength'
+  late final KeyboardScannerService _keyboardScanner;
+  bool _useKeyboardScanner = false;
+  int _keyboardScannerMaxGapMs = 30;
+  int _keyboardScannerMinLength = 8;
 
   static const double kTabletBreakpoint = 768.0;
   static const double kDesktopBreakpoint = 1024.0;
@@ -86,6 +108,36 @@ class _MainScreenState extends State<MainScreen> {
 
   List<dynamic> _rxHeads = [];
   List<dynamic> _rxRecipes = [];
+  // 바코드 → _rxRecipes 행 번호 (_rxRecipes 가 바뀔 때마다 rebuild)
+  final RecipeIndex _recipeIndex = RecipeIndex();
+  // _rxRecipes 의 수치 필드를 열 단위로 정규화한 사본 (합계/분리/체크 수량)
+  final RecipeStore _recipeStore = RecipeStore();
+  // 포장 바코드 → 포장 단위 (get_unit_from_pack_barcode 로컬 캐시)
+  late final UnitCacheService _unitCache;
+  // update_checked_amount_and_packserial 쓰기 지연 저널, seq → 화면에 반영한 값
+  late final CheckJournalService _checkJournal;
+  // scanId/queuedNs: 스캔 추적 (꺼져 있으면 0)
+  final Map<
+      int,
+      ({
+        int delta,
+        String drugName,
+        int day,
+        int scope,
+        String packSerial,
+        int scanId,
+        int queuedNs,
+      })> _pendingChecks = {};
+  // 처방(tfn)·날짜별로 이미 처리된 포장 일련번호
+  final SerialFilterService _serialFilter = SerialFilterService();
+  // 선택한 날짜의 rxhead/rxrecipe 로컬 스냅숏 (먼저 보여 주고 서버와 맞춘다)
+  late final DaySnapshotService _daySnapshot;
+  // _rxHeads 가 날짜 조회 결과인지 (이름 조회면 false)
+  bool _showingDay = false;
+  Timer? _daySyncTimer;
+  // 최근 [_nameIndexDays] 일 환자 이름/번호 입력 중 검색
+  final NameIndex _nameIndex = NameIndex();
+  static const int _nameIndexDays = 7;
   dynamic _selectedHead;
 
   String _resultText = '';
@@ -104,6 +156,12 @@ class _MainScreenState extends State<MainScreen> {
   void initState() {
     super.initState();
     _sb = SupabaseService(Supabase.instance.client);
+    _unitCache = UnitCacheService(_fetchPackUnit)..open();
+    _checkJournal = CheckJournalService(_sendCheck, onAck: _onCheckAcked)..open();
+    _serialFilter.open();
+    _daySnapshot = DaySnapshotService(
+        fetchHeads: _fetchHeadsByDate, fetchRecipes: _fetchRecipesByTfn);
+    _daySyncTimer = Timer.periodic(_daySyncInterval, (_) => _syncDay());
     
     unawaited(_initialize());
 
@@ -125,12 +183,25 @@ class _MainScreenState extends State<MainScreen> {
     _barcodeFocusNode.dispose();
     _scrollController.dispose();
     _comPortService.dispose();
+    _extraScanners.dispose(
+        [for (var i = 0; i < _extraScannerPorts.length; i++) i + 1]);
+    _keyboardScanner.dispose();
+    _recipeIndex.dispose();
+    _recipeStore.dispose();
+    _unitCache.dispose();
+    _checkJournal.dispose();
+    _serialFilter.dispose();
+    _daySyncTimer?.cancel();
+    _daySnapshot.dispose();
+    _nameIndex.dispose();
+    MetricsService.stop();
     super.dispose();
   }
 
-  Future<void> _speak(String text) async {
+  Future<void> _speak(String text,
+      {TtsPriority priority = TtsPriority.drug}) async {
     try {
-      await _tts.speak(text);
+      await _tts.speak(text, priority: priority);
     } catch (e) {
       debugPrint('[TTS Error] $e');
       debugPrint('[TTS] $text');
@@ -189,28 +260,145 @@ class _MainScreenState extends State<MainScreen> {
     );
   }
 
+  // _rxRecipes 가 바뀐 뒤 열 저장소와 바코드 인덱스를 다시 만든다.
+  void _reloadRecipes() {
+    _recipeStore.load(_rxRecipes);
+    _recipeIndex.rebuild(_rxRecipes, asNum);
+  }
+
+  static const Duration _daySyncInterval = Duration(minutes: 1);
+
+  Future<List<dynamic>> _fetchHeadsByDate(DateTime date) async {
+    final d = DateFormat('yyyy-MM-dd').format(date);
+    final resp = await _sb.rpc('select_rxhead_bydate', {'_selected_date': d});
+    return (resp as List?) ?? [];
+  }
+
+  Future<List<dynamic>> _fetchRecipesByTfn(num tfn) async {
+    final resp = await _sb
+        .rpc('select_rxrecipe_by_textfile_number', {'_textfile_number': tfn});
+    return (resp as List?) ?? [];
+  }
+
+  // 날짜를 고르면 스냅숏을 먼저 보여 주고, 서버 응답은 바뀐 부분만 반영한다.
   Future<void> _loadByDate(DateTime date) async {
+    final d = DateFormat('yyyy-MM-dd').format(date);
+    _daySnapshot.open(date);
+    final cached = _daySnapshot.heads();
+    if (cached != null) {
+      _showHeads(cached, d, fromSnapshot: true);
+    }
     try {
-      final d = DateFormat('yyyy-MM-dd').format(date);
-      final resp =
-          await _sb.rpc('select_rxhead_bydate', {'_selected_date': d});
-      final list = (resp as List?) ?? [];
-      setState(() {
-        _rxHeads = list;
-        _rxRecipes = [];
-      });
-
-      if (_rxHeads.isNotEmpty) {
-        onHeadSelected(_rxHeads.first);
-        _setResult('처방 ${_rxHeads.length}건 로드 완료 ($d).');
+      await _daySnapshot.sync(
+        onHeads: (heads) {
+          if (!mounted || _daySnapshot.day != _dayOf(_selectedDate)) return;
+          _indexNames();
+          if (cached == null) {
+            _showHeads(heads, d);
+          } else if (_showingDay) {
+            _replaceHeads(heads);
+          }
+        },
+        onRecipes: _onSnapshotRecipes,
+      );
+    } catch (e) {
+      if (cached == null) {
+        _setResult('RxHead 조회 실패: $e', error: true);
       } else {
-        _setResult('해당 날짜($d)의 처방이 없습니다.');
+        _setResult('서버 연결 실패, 저장된 처방을 표시합니다 ($d): $e', error: true);
       }
-    } catch (e) {
-      _setResult('RxHead 조회 실패: $e', error: true);
     }
   }
 
+  static DateTime _dayOf(DateTime t) => DateTime(t.year, t.month, t.day);
+
+  void _showHeads(List<dynamic> list, String d, {bool fromSnapshot = false}) {
+    _indexNames();
+    setState(() {
+      _rxHeads = list;
+      _rxRecipes = [];
+      _showingDay = true;
+    });
+    _reloadRecipes();
+
+    if (_rxHeads.isNotEmpty) {
+      onHeadSelected(_rxHeads.first);
+      _setResult(fromSnapshot
+          ? '처방 ${_rxHeads.length}건 (저장본, 서버 확인 중) ($d).'
+          : '처방 ${_rxHeads.length}건 로드 완료 ($d).');
+    } else {
+      _setResult('해당 날짜($d)의 처방이 없습니다.');
+    }
+  }
+
+  // 스냅숏을 보여 준 뒤 목록이 바뀌었을 때: 선택한 처방은 그대로 둔다.
+  void _replaceHeads(List<dynamic> heads) {
+    final selectedTfn =
+        _selectedHead == null ? null : asNum(_selectedHead['tfn']);
+    final selected = selectedTfn == null
+        ? null
+        : heads.firstWhere((r) => asNum(r['tfn']) == selectedTfn,
+            orElse: () => null);
+    setState(() {
+      _rxHeads = heads;
+      if (selected != null) _selectedHead = selected;
+    });
+    if (selected == null && heads.isNotEmpty) {
+      onHeadSelected(heads.first);
+    }
+  }
+
+  // 백그라운드로 받은 rxrecipe 가 스냅숏과 달랐을 때. 화면에 아직 서버가
+  // 확인하지 않은 체크가 있으면 덮어쓰지 않는다(다음 sync 가 다시 맞춘다).
+  void _onSnapshotRecipes(num tfn, List<dynamic> rows) {
+    if (!mounted || _selectedHead == null) return;
+    if (asNum(_selectedHead['tfn']) != tfn || _pendingChecks.isNotEmpty) {
+      return;
+    }
+    _showRecipes(rows);
+  }
+
+  void _indexNames() {
+    _nameIndex.rebuild(_daySnapshot.recentHeads(_nameIndexDays));
+  }
+
+  // 이름 입력란의 키 입력마다: 로컬 인덱스로 목록을 좁힌다(서버 호출 없음).
+  // 입력을 지우면 선택한 날짜의 목록으로 돌아간다.
+  void _onNameTyped(String value) {
+    _nameQuery = value;
+    if (value.trim().isEmpty) {
+      if (_showingDay) return;
+      setState(() {
+        _rxHeads = _daySnapshot.heads() ?? [];
+        _showingDay = true;
+      });
+      return;
+    }
+    final rows = _nameIndex.search(value);
+    setState(() {
+      _rxHeads = rows;
+      _showingDay = false;
+    });
+  }
+
+  // 오늘 날짜를 보고 있으면 주기적으로 서버와 맞춘다.
+  void _syncDay() {
+    if (!mounted || !_showingDay) return;
+    if (_dayOf(_selectedDate) != _dayOf(DateTime.now())) return;
+    unawaited(_daySnapshot
+        .sync(
+          onHeads: (heads) {
+            _indexNames();
+            if (mounted && _showingDay) _replaceHeads(heads);
+          },
+          onRecipes: _onSnapshotRecipes,
+        )
+        .catchError((Object e) {
+      debugPrint('[DaySnapshot] 주기 동기화 실패: $e');
+      return const DaySync(headsChanged: false, recipes: 0);
+    }));
+  }
+
   Future<void> _loadByName(String name) async {
     final q = name.trim();
     if (q.isEmpty) return;
@@ -221,7 +409,9 @@ class _MainScreenState extends State<MainScreen> {
       setState(() {
         _rxHeads = list;
         _rxRecipes = [];
+        _showingDay = false;
       });
+      _reloadRecipes();
       if (_rxHeads.isNotEmpty) {
         onHeadSelected(_rxHeads.first);
         _setResult('이름($q)으로 ${_rxHeads.length}건.');
@@ -233,21 +423,44 @@ class _MainScreenState extends State<MainScreen> {
     }
   }
 
+  // 스냅숏에 있으면 바로 보여 주고, 서버 응답이 다를 때만 다시 그린다.
   Future<void> _loadRecipesByTfn(num tfn) async {
+    final cached = _daySnapshot.recipes(tfn);
+    if (cached != null) {
+      _showRecipes(cached);
+    }
     try {
-      final resp = await _sb
-          .rpc('select_rxrecipe_by_textfile_number', {'_textfile_number': tfn});
-      final list = (resp as List?) ?? [];
-      setState(() {
-        _rxRecipes = list;
-      });
-      _refreshSeparationOptions();
-      _barcodeFocusNode.requestFocus();
+      final (rows, changed) = await _daySnapshot.refreshRecipes(tfn);
+      if (cached == null) {
+        if (!_isSelected(tfn)) return;
+        _showRecipes(rows);
+      } else if (changed) {
+        _onSnapshotRecipes(tfn, rows);
+      }
     } catch (e) {
-      _setResult('RxRecipe 조회 실패: $e', error: true);
+      if (cached == null) {
+        _setResult('RxRecipe 조회 실패: $e', error: true);
+      }
     }
   }
 
+  bool _isSelected(num tfn) =>
+      mounted && _selectedHead != null && asNum(_selectedHead['tfn']) == tfn;
+
+  void _showRecipes(List<dynamic> list) {
+    setState(() {
+      _rxRecipes = list;
+    });
+    _reloadRecipes();
+    _refreshSeparationOptions();
+    _barcodeFocusNode.requestFocus();
+    // 스캔될 약품 안내를 백그라운드에서 미리 합성해 둔다.
+    unawaited(_tts.warm([
+      for (final row in _rxRecipes)
+        if (row is Map<String, dynamic>) _drugAnnouncement(row),
+    ]));
+  }
+
   // 상태별 색상 - 디자인 모드에 따라 변경
   Color _statusColor(int checked, int total) {
     switch (_pageDesignMode) {
@@ -365,59 +578,71 @@ class _MainScreenState extends State<MainScreen> {
   }
 
 
-  Future<void> handleBarcode(String input) async {
+  // get_unit_from_pack_barcode 서버 조회 (UnitCacheService 미스/갱신 시)
+  Future<num?> _fetchPackUnit(String baseBarcode) async {
+    final unitResp = await _sb.rpc('get_unit_from_pack_barcode', {'_pack_barcode': baseBarcode});
+    final unitStr = unitResp?.toString().trim();
+    if (unitStr == null || unitStr.isEmpty) return null;
+    return num.tryParse(unitStr);
+  }
+
+  /// [scanId]: 스캐너에서 온 스캔의 추적 id. 0 이면(키보드 입력 등) 새로 받는다.
+  /// [receivedUs]: 스캔을 받은 시각 ([MetricsService.nowUs]). 0 이면 지금.
+  Future<void> handleBarcode(String input,
+      {int scanId = 0, int receivedUs = 0}) async {
+    final scan = scanId != 0 ? scanId : TraceService.newScan();
+    final received = receivedUs != 0 ? receivedUs : MetricsService.nowUs();
+    final begin = TraceService.now();
+    MetricsService.count('pharm_scans_total', help: 'Barcodes handled');
+    try {
+      await _handleBarcode(input, scan, received);
+    } finally {
+      TraceService.record('scan.handle', scan, begin);
+    }
+  }
+
+  // 화면 갱신을 요청한 뒤 그 프레임이 그려질 때까지 (ui.frame)
+  void _traceFrame(int scanId) {
+    if (!TraceService.enabled) return;
+    final begin = TraceService.now();
+    WidgetsBinding.instance.addPostFrameCallback(
+        (_) => TraceService.record('ui.frame', scanId, begin));
+  }
+
+  Future<void> _handleBarcode(String input, int scan, int receivedUs) async {
   // 0) 기본 가드
-  var inputBarcode = input.trim().replaceAll('(', '').replaceAll(')', '');
+  final inputBarcode = input.trim();
   if (inputBarcode.isEmpty) return;
   if (inputBarcode.length >= 4 && inputBarcode.toLowerCase().startsWith('http')) return;
-  if (inputBarcode.length < 13) return;
-
-  // 1) 바코드 정규화
-  final raw = inputBarcode;
-  String baseBarcode;
-  String packSerial = '';
-
-  // C#: if (raw.Length >= 16) { base = raw.Substring(3, 13); pack = raw.Substring(16); } else base = raw;
-  if (raw.length >= 16) {
-    // substring(start, endExclusive) 이므로 3..15(포함) → end=16
-    baseBarcode = raw.substring(3, 16);
-    packSerial = raw.substring(16);
-  } else {
-    baseBarcode = raw;
+  if (inputBarcode.replaceAll('(', '').replaceAll(')', '').length < 13) return;
+
+  // 1) 바코드 정규화: GS1 AI 파싱 (01) GTIN / 일련번호
+  //    (17) 유효기간, (10) 제조번호, GS 구분자가 있어도 위치가 어긋나지 않는다.
+  var t = TraceService.now();
+  final gs1 = Gs1BarcodeService.parse(inputBarcode);
+  TraceService.record('scan.parse', scan, t);
+  if (gs1.gtin.isEmpty) {
+    _setResult('바코드 형식 오류: $inputBarcode', error: true);
+    return;
   }
+  final String baseBarcode = gs1.baseBarcode;
+  // 예전과 같은 형식이라 업그레이드 전에 기록된 일련번호와도 중복 판별된다.
+  final String packSerial = gs1.packSerial;
 
-  // 2) 포장 단위(unit) 조회
-  num unitDecimal = 1;
-  try {
-    final unitResp = await _sb.rpc('get_unit_from_pack_barcode', {'_pack_barcode': baseBarcode});
-    final unitStr = unitResp?.toString().trim();
-    if (unitStr != null && unitStr.isNotEmpty) {
-      final parsed = num.tryParse(unitStr);
-      if (parsed != null) unitDecimal = parsed;
-    }
-  } catch (_) {
-    unitDecimal = 1;
-  }
+  // 2) 포장 단위(unit) 조회: 로컬 캐시 우선, 없으면 서버 (_fetchPackUnit)
+  final num unitDecimal = await TraceService.span(
+      'scan.unit', scan, () => _unitCache.unitFor(baseBarcode));
   final int delta = max(1, unitDecimal.round());
 
   // 3) RxRecipes에서 바코드 매칭
   // 요구사항 반영: type == 'E'는 12자리, 그 외(정제 T)는 11자리 비교
-  final candidates = _rxRecipes.where((r) {
-    final code = (r['pack_barcode'] ?? '').toString().trim();
-    final t = (r['type'] ?? r['T'] ?? r['typeCode'] ?? '').toString().trim().toUpperCase();
-    if (code.isEmpty) return false;
-
-    if (t == 'E') {
-      if (baseBarcode.length < 12 || code.length < 12) return false;
-      return code.substring(0, 12) == baseBarcode.substring(0, 12);
-    } else {
-      final key11 = baseBarcode.length >= 11 ? baseBarcode.substring(0, 11) : baseBarcode;
-      return code.length >= 11 && code.substring(0, 11) == key11;
-    }
-  }).toList();
+  // 미완료 항목이 먼저 오도록 정렬된 행 번호 (C#의 OrderBy(notComplete ? 0 : 1)와 동등)
+  t = TraceService.now();
+  final candidates = _recipeIndex.lookup(baseBarcode);
+  TraceService.record('scan.match', scan, t);
 
   if (candidates.isEmpty) {
-    await _tts.beep(1600, 1200);
+    await _tts.beep(1600, 1200, priority: TtsPriority.error);
     _setResult('바코드 매칭 실패: 일치하는 약품이 없습니다.', error: true);
 
     // 미스매치 후보 보여주기 (C#과 동일)
@@ -440,35 +665,85 @@ class _MainScreenState extends State<MainScreen> {
     return;
   }
 
-  // 4) 타겟 선택: "완료되지 않은 항목"이 우선 (C#의 OrderBy(notComplete ? 0 : 1)와 동등)
-  Map<String, dynamic> target = candidates.reduce((a, b) {
-    final aChecked = asNum(a['checked_amount'] ?? a['Checked']);
-    final aTotal   = asNum(a['total'] ?? a['Total']);
-    final bChecked = asNum(b['checked_amount'] ?? b['Checked']);
-    final bTotal   = asNum(b['total'] ?? b['Total']);
-
-    final aNotComplete = aChecked < aTotal;
-    final bNotComplete = bChecked < bTotal;
-
-    if (aNotComplete && !bNotComplete) return a;
-    if (!aNotComplete && bNotComplete) return b;
-    return a; // 동률이면 a 유지(첫 번째 것)
-  });
+  // 4) 타겟 선택: "완료되지 않은 항목"이 우선
+  final int targetRow = candidates.first;
+  final Map<String, dynamic> target = _rxRecipes[targetRow];
 
   // rxrecipe_id 보정(C#은 여러 키 시도)
-  num rxrecipeId = asNum(target['rxrecipe_id']);
-  if (rxrecipeId <= 0) rxrecipeId = asNum(target['rxRecipeID']);
-  if (rxrecipeId <= 0) rxrecipeId = asNum(target['RxRecipeId']);
+  final num rxrecipeId = _rxrecipeIdOf(target);
 
   if (rxrecipeId <= 0) {
-    await _tts.beep(1500, 1200);
+    await _tts.beep(1500, 1200, priority: TtsPriority.error);
     _setResult('바코드 처리 실패: 선택된 항목의 rxrecipe_id를 찾을 수 없습니다.', error: true);
     return;
   }
 
+  final rawDrugName = (target['product_name'] ??
+      target['약품명'] ??
+      target['name'] ??
+      '').toString();
+  final drugName = rawDrugName.split(RegExp(r'[_(]')).first;
+
+  // 4-1) 일련번호 중복: 서버가 이미 기록한 일련번호면 서버 호출 없이 바로 중복 처리.
+  //      응답 대기 중(pending)인 일련번호는 서버 판단(_onCheckAcked)에 맡긴다.
+  final int serialDay = SerialFilterService.today();
+  final int serialScope = asNum(_selectedHead?['tfn']).toInt();
+  if (_serialFilter.lookup(serialDay, serialScope, packSerial) ==
+      SerialState.confirmed) {
+    await _tts.beep(900, 300, priority: TtsPriority.error);
+    await _speak('중복된 바코드입니다', priority: TtsPriority.error);
+    _setResult('[중복] 이미 처리된 바코드입니다. ($drugName)', error: true);
+    return;
+  }
+
   // 5) 성공 beep + TTS
-  await _tts.beep(500, 500);
+  await TraceService.span('scan.beep', scan, () => _tts.beep(500, 500));
+  await TraceService.span(
+      'scan.speak', scan, () => _speak(_drugAnnouncement(target)));
+  MetricsService.observeSince('pharm_scan_to_voice_seconds', receivedUs,
+      help: 'Scan received to its announcement handed to speech');
+
+  // 6) DB: checked_amount 증가
+  //    저널에 기록하고 화면에는 바로 반영한다. 서버 전송과 중복(affected == 0)
+  //    보정은 _onCheckAcked 에서 한다.
+  // 현재 수치 읽기
+  final checkedNow = _recipeStore.checked[targetRow];
+  final totalVal   = _recipeStore.total[targetRow];
+  // 제한 판단은 증가 전 상태로 결정: 이미 완료 상태였다면 이후 스캔은 제한으로 표시
+  final bool wasCompleteBefore = packSerial.isEmpty && checkedNow >= totalVal;
+
+  t = TraceService.now();
+  final seq = _checkJournal.enqueue(rxrecipeId.toInt(), delta, packSerial);
+  TraceService.record('scan.journal', scan, t);
+  _pendingChecks[seq] = (
+    delta: delta,
+    drugName: drugName,
+    day: serialDay,
+    scope: serialScope,
+    packSerial: packSerial,
+    scanId: scan,
+    queuedNs: TraceService.now(),
+  );
+  _serialFilter.record(serialDay, serialScope, packSerial, SerialState.pending);
+
+  // [2] 낙관적 증가 처리 (UI 반영)
+  final int newChecked = _addChecked(targetRow, delta);
+  setState(() {});
+  _traceFrame(scan);
+
+  // [3] packSerial이 없는 경우: 증가 전 이미 전량 완료였다면 경고 메시지 표시 (UI는 이미 업데이트됨)
+  if (wasCompleteBefore) {
+    await _tts.beep(1000, 400, priority: TtsPriority.error);
+    _setResult('[제한] $drugName 이미 ${fmtNum(newChecked)}/${fmtNum(totalVal)}개 완료됨.', error: true);
+    return;
+  }
 
+  // [4] 정상 완료 메시지
+  _setResult('체크 완료: $drugName +$delta (현재 ${fmtNum(newChecked)}/${fmtNum(totalVal)})');
+}
+
+// 약품 안내 문장. 처방을 불러올 때 같은 문장으로 음성 캐시를 미리 채운다.
+String _drugAnnouncement(Map<String, dynamic> target) {
   final rawDrugName = (target['product_name'] ??
       target['약품명'] ??
       target['name'] ??
@@ -488,63 +763,129 @@ class _MainScreenState extends State<MainScreen> {
 
   if (drugType == 'E') {
     // C#은 "개!"로 읽음
-    await _speak('$drugName, $eachOneDecimal개!');
+    return '$drugName, $eachOneDecimal개!';
+  }
+  return '$drugName, ${fmtNum(dose)}정, ${fmtNum(times)}회, ${fmtNum(days)}일, 총 $eachOneDecimal개';
+}
+
+// _rxRecipes[row] 의 checked_amount 에 [change] 를 더하고 새 값을 반환한다.
+int _addChecked(int row, int change) {
+  final Map<String, dynamic> target = _rxRecipes[row];
+  final int newChecked = _recipeStore.addChecked(row, change);
+  // 맵을 그대로 읽는 곳(칩, 약품 다이얼로그)을 위해 맵에도 반영. 서로 다른 키 가능성 대응
+  if (target.containsKey('checked_amount')) {
+    target['checked_amount'] = newChecked;
   } else {
-    await _speak('$drugName, ${fmtNum(dose)}정, ${fmtNum(times)}회, ${fmtNum(days)}일, 총 $eachOneDecimal개');
+    target['Checked'] = newChecked;
   }
+  _recipeIndex.setComplete(row, _recipeStore.isComplete(row));
+  return newChecked;
+}
 
-  // 6) DB: checked_amount 증가
+num _rxrecipeIdOf(dynamic row) {
+  num id = asNum(row['rxrecipe_id']);
+  if (id <= 0) id = asNum(row['rxRecipeID']);
+  if (id <= 0) id = asNum(row['RxRecipeId']);
+  return id;
+}
+
+// PostgREST 가 DB 에 닿지 못했거나(PGRST000~003) 프록시가 넘기지 못한(503)
+// 오류: 실행되지 않았으므로 다시 보낸다.
+static const Set<String> _unreachedCodes = {
+  'PGRST000', 'PGRST001', 'PGRST002', 'PGRST003', '503',
+};
+
+// update_checked_amount_and_packserial 호출 (CheckJournalService 플러셔)
+Future<int> _sendCheck(int rxrecipeId, int delta, String packSerial) async {
+  final dynamic incResp;
   try {
-    final incResp = await _sb.rpc('update_checked_amount_and_packserial', {
+    incResp = await _sb.rpc('update_checked_amount_and_packserial', {
       '_rxrecipe_id': rxrecipeId,
       '_delta': delta,
       '_pack_serial': packSerial,
     });
-
-    int affected = 0;
-    if (incResp != null) {
-      affected = int.tryParse(incResp.toString().trim().replaceAll('"', '')) ?? 0;
+  } on PostgrestException catch (e) {
+    if (_unreachedCodes.contains(e.code)) rethrow;
+    // 프록시가 PostgREST 의 응답을 받지 못했다: 실행되었을 수 있다.
+    if (e.code == '502' || e.code == '504') {
+      throw CheckOutcomeUnknown(e.message);
     }
+    throw CheckRejected(e.message);
+  } on RpcOutcomeUnknown catch (e) {
+    throw CheckOutcomeUnknown(e.message);
+  }
+  if (incResp == null) return 0;
+  return int.tryParse(incResp.toString().trim().replaceAll('"', '')) ?? 0;
+}
 
-    // [1] 중복 처리 (affected == 0)
-    if (affected == 0) {
-      await _tts.beep(900, 300);
-      // 음성 피드백(선택)
-      await _speak('중복된 바코드입니다');
-      _setResult('[중복] 이미 처리된 바코드입니다. ($drugName)', error: true);
-      return;
+// 서버 응답으로 낙관적 반영값 보정
+void _onCheckAcked(CheckAck ack) {
+  // 이전 실행에서 재전송된 항목은 화면에 반영한 적이 없다.
+  final pending = _pendingChecks.remove(ack.seq);
+  if (pending == null) {
+    if (ack.outcome != CheckOutcome.applied && mounted) {
+      _reportUnsettledCheck(ack, '');
     }
-
-  // 현재 수치 읽기
-  final checkedNow = asNum(target['checked_amount'] ?? target['Checked']);
-  final totalVal   = asNum(target['total'] ?? target['Total']);
-  // 제한 판단은 증가 전 상태로 결정: 이미 완료 상태였다면 이후 스캔은 제한으로 표시
-  final bool wasCompleteBefore = packSerial.isEmpty && checkedNow >= totalVal;
-
-  // [2] 정상 증가 처리 (UI 반영) - DB가 업데이트되었으므로 UI도 반영
-  final int newChecked = max(0, min(32767, checkedNow.round() + affected));
-    // 서로 다른 키 가능성 대응
-    if (target.containsKey('checked_amount')) {
-      target['checked_amount'] = newChecked;
-    } else {
-      target['Checked'] = newChecked;
+    return;
+  }
+  // 저널 기록부터 update_checked_amount_and_packserial 응답까지
+  TraceService.record('check.ack', pending.scanId, pending.queuedNs);
+  // 스냅숏의 이 처방 행은 이제 서버보다 오래되었다. 응답 전에 다른 환자를
+  // 골랐을 수 있으므로 스캔 때의 처방(scope)을 쓴다.
+  _daySnapshot.markDirty(pending.scope);
+  // 중복이든 아니든 서버가 이 일련번호를 알게 되었으므로 이후 재스캔은 로컬에서 거른다.
+  // 거부되었거나 결과를 모르면 재스캔을 서버 판단에 맡긴다.
+  if (ack.outcome == CheckOutcome.applied) {
+    _serialFilter.record(
+        pending.day, pending.scope, pending.packSerial, SerialState.confirmed);
+  }
+  if (!mounted) return;
+
+  // 서버가 실제로 더한 값(affected)과 화면에 더한 값(delta)의 차이.
+  // 결과를 모르면 화면 값을 두고, 스냅숏 동기화가 서버 값으로 맞춘다.
+  final int applied = switch (ack.outcome) {
+    CheckOutcome.applied => ack.affected,
+    CheckOutcome.rejected => 0,
+    CheckOutcome.unknown => pending.delta,
+  };
+  final correction = applied - pending.delta;
+  if (correction != 0) {
+    final row = _rxRecipes.indexWhere((r) => _rxrecipeIdOf(r) == ack.rxrecipeId);
+    if (row >= 0) {
+      _addChecked(row, correction);
+      setState(() {});
     }
+  }
 
-    // UI 갱신
-    setState(() {});
+  if (ack.outcome != CheckOutcome.applied) {
+    _reportUnsettledCheck(ack, pending.drugName);
+    return;
+  }
 
-    // [3] packSerial이 없는 경우: 증가 전 이미 전량 완료였다면 경고 메시지 표시 (UI는 이미 업데이트됨)
-    if (wasCompleteBefore) {
-      await _tts.beep(1000, 400);
-      _setResult('[제한] $drugName 이미 ${fmtNum(newChecked)}/${fmtNum(totalVal)}개 완료됨.', error: true);
-      return;
-    }
+  // [1] 중복 처리 (affected == 0)
+  if (ack.affected == 0) {
+    unawaited(() async {
+      await _tts.beep(900, 300, priority: TtsPriority.error);
+      // 음성 피드백(선택)
+      await _speak('중복된 바코드입니다', priority: TtsPriority.error);
+    }());
+    _setResult('[중복] 이미 처리된 바코드입니다. (${pending.drugName})', error: true);
+  }
+}
 
-    // [4] 정상 완료 메시지
-    _setResult('체크 완료: $drugName +$delta (현재 ${fmtNum(newChecked)}/${fmtNum(totalVal)})');
-  } catch (e) {
-    await _tts.beep(1500, 900);
-    _setResult('체크 수량 증가 실패: $e', error: true);
+// 서버가 거부했거나 반영 여부를 모르는 체크를 알린다. 다시 보내지 않으므로
+// 약사가 수량을 확인해야 한다.
+void _reportUnsettledCheck(CheckAck ack, String drugName) {
+  final what = drugName.isNotEmpty ? drugName : 'rxrecipe ${ack.rxrecipeId}';
+  unawaited(_tts.beep(1500, 1200, priority: TtsPriority.error));
+  if (ack.outcome == CheckOutcome.rejected) {
+    _setResult('[저장 실패] $what +${ack.delta}: 서버가 거부했습니다. (${ack.error})',
+        error: true);
+  } else {
+    _setResult(
+        '[확인 필요] $what +${ack.delta}: 서버 반영 여부를 알 수 없습니다. '
+        '수량을 확인하세요.',
+        error: true);
   }
 }
 
@@ -557,7 +898,7 @@ void onHeadSelected(dynamic row) {
   final patientName = (row['patient_name'] ?? row['name'] ?? row['환자명'] ?? '').toString();
   if (patientName.isNotEmpty) {
     // 환자명 읽기
-    _speak(patientName);
+    _speak(patientName, priority: TtsPriority.patient);
   }
 
   final tfn = asNum(row['tfn']);
@@ -566,54 +907,19 @@ void onHeadSelected(dynamic row) {
 
 // --- C# RecalcDispenseTotals와 동등한 합계 계산 ------------------------------
 Map<String, String> calculateTotals(int selectedSeparation) {
-  num m = 0, a = 0, e = 0, n = 0;
-
-  for (final it in _rxRecipes) {
-    if (!asBool(it['use'], true)) continue;
-    final sep = asNum(it['separate'], -999).toInt();
-    if (selectedSeparation != 0 && sep != selectedSeparation) continue;
-
-    final typeCode = (it['type']?.toString() ?? it['T']?.toString() ?? '').trim().toUpperCase();
-    final isPill = typeCode == 'T';
-
-    num vm = asNum(it['morning']);
-    num va = asNum(it['afternoon']);
-    num ve = asNum(it['evening']);
-    num vn = asNum(it['night']);
-
-    if (isPill) {
-      vm = vm.ceil();
-      va = va.ceil();
-      ve = ve.ceil();
-      vn = vn.ceil();
-    }
-
-    m += vm;
-    a += va;
-    e += ve;
-    n += vn;
-  }
-
+  final t = _recipeStore.totals(selectedSeparation);
   return {
-    'm': fmtNum(m),
-    'a': fmtNum(a),
-    'e': fmtNum(e),
-    'n': fmtNum(n),
+    'm': fmtNum(t.morning),
+    'a': fmtNum(t.afternoon),
+    'e': fmtNum(t.evening),
+    'n': fmtNum(t.night),
   };
 }
 
   void _refreshSeparationOptions() {
     _separationOptions
       ..clear()
-      ..addAll(
-        _rxRecipes
-            .where((e) => asBool(e['use'], false))
-            .map((e) => asNum(e['separate'], -999).toInt())
-            .where((v) => v != -999)
-            .toSet()
-            .toList()
-          ..sort(),
-      );
+      ..addAll(_recipeStore.separations());
 
     if (_separationOptions.isEmpty) {
       _selectedSeparation = 0;
@@ -759,7 +1065,7 @@ Map<String, String> calculateTotals(int selectedSeparation) {
                   ),
                   const Divider(height: 32),
                   const Text(
-                    'COM Port 설정 (Windows)',
+                    'COM Port 설정 (Windows/Linux)',
                     style: TextStyle(fontSize: 16, fontWeight: FontWeight.bold),
                   ),
                   const SizedBox(height: 16),
@@ -802,6 +1108,29 @@ Map<String, String> calculateTotals(int selectedSeparation) {
                       ],
                     ),
                   ),
+                  const Divider(height: 32),
+                  const Text(
+                    '스캔 추적',
+                    style: TextStyle(fontSize: 16, fontWeight: FontWeight.bold),
+                  ),
+                  SwitchListTile(
+                    title: const Text('스캔 구간 기록'),
+                    subtitle: const Text('첫 시리얼 바이트부터 화면 반영까지'),
+                    value: TraceService.enabled,
+                    onChanged: (val) async {
+                      await TraceService.setEnabled(val);
+                      setDialogState(() {});
+                    },
+                  ),
+                  TextButton.icon(
+                    icon: const Icon(Icons.save_alt),
+                    label: const Text('추적 파일 저장 (Chrome/Perfetto)'),
+                    onPressed: () async {
+                      final path = await TraceService.dump();
+                      _setResult(path != null ? '추적 저장: $path' : '추적 저장 실패',
+                          error: path == null);
+                    },
+                  ),
                 ],
               ),
             ),
@@ -840,28 +1169,66 @@ Map<String, String> calculateTotals(int selectedSeparation) {
   }
 
   Future<void> _initialize() async {
+    await TraceService.init();
+    unawaited(MetricsService.start());
     await _loadSettings();
+    StartupTimelineService.mark('settings_loaded');
 
     // COM Port 서비스 초기화
     _comPortService = ComPortService(
       useComPort: _useComPort,
       comPortNumber: _selectedComPort,
       onBarcodeReceived: (barcode) {
+        final scan = _comPortService.lastScanId;
+        final received = TraceService.now();
+        final receivedUs = MetricsService.nowUs();
         // COM Port에서 수신된 원본 데이터 표시
         _setResult('COM Port: $barcode');
         // 잠시 후 바코드 처리 시작
         Future.delayed(const Duration(milliseconds: 500), () {
-          handleBarcode(barcode);
+          TraceService.record('comport.delay', scan, received);
+          handleBarcode(barcode, scanId: scan, receivedUs: receivedUs);
         });
       },
     );
     
-    // Windows 플랫폼이면 COM Port 자동 연결 시도
-    if (Platform.isWindows && _useComPort) {
+    // Windows/Linux 플랫폼이면 COM Port 자동 연결 시도
+    if ((Platform.isWindows || Platform.isLinux) && _useComPort) {
       _comPortService.connect();
     }
-    
+
+    // 추가 스캐너: 모든 포트를 네이티브 reactor 스레드 하나가 읽는다
+    _extraScanners = SerialPortsService(
+      onLine: (port, barcode, scanId) {
+        _setResult('Scanner $port: $barcode');
+        handleBarcode(barcode,
+            scanId: scanId, receivedUs: MetricsService.nowUs());
+      },
+    );
+    if (Platform.isLinux) {
+      for (var i = 0; i < _extraScannerPorts.length; i++) {
+        _extraScanners.openPort(i + 1, devicePath: _extraScannerPorts[i]);
+      }
+    }
+
+    // 키보드 웨지 스캐너: 포커스와 상관없이 스캔 한 번이 바코드 하나
+    _keyboardScanner = KeyboardScannerService(
+      onScan: (barcode, scanId) {
+        _setResult('Keyboard scanner: $barcode');
+        handleBarcode(barcode,
+            scanId: scanId, receivedUs: MetricsService.nowUs());
+      },
+    );
+    if (Platform.isLinux && _useKeyboardScanner) {
+      _keyboardScanner.configure(
+        maxGapMs: _keyboardScannerMaxGapMs,
+        minLength: _keyboardScannerMinLength,
+      );
+    }
+
     await _loadByDate(_selectedDate);
+    // 첫 화면에 오늘 처방이 보인 시점
+    StartupTimelineService.mark('first_data');
   }
 
   Future<void> _loadSettings() async {
@@ -869,6 +1236,11 @@ Map<String, String> calculateTotals(int selectedSeparation) {
     setState(() {
       _useComPort = prefs.getBool('useComPort') ?? true;
       _selectedComPort = prefs.getInt('selectedComPort') ?? 4;
+      _extraScannerPorts = prefs.getStringList('extraScannerPorts') ?? const [];
+      _useKeyboardScanner = prefs.getBool('useKeyboardScanner') ?? false;
+      _keyboardScannerMaxGapMs = prefs.getInt('keyboardScannerMaxGapMs') ?? 30;
+      _keyboardScannerMinLength =
+          prefs.getInt('keyboardScannerMinLength') ?? 8;
       final designModeName = prefs.getString('pageDesignMode');
       _pageDesignMode = PageDesignMode.values.firstWhere(
         (e) => e.name == designModeName,
@@ -957,7 +1329,7 @@ Map<String, String> calculateTotals(int selectedSeparation) {
                         labelText: '이름',
                         isDense: true,
                       ),
-                      onChanged: (v) => _nameQuery = v,
+                      onChanged: _onNameTyped,
                       onSubmitted: (v) => _loadByName(v),
                     ),
                   ),
@@ -1159,10 +1531,10 @@ Map<String, String> calculateTotals(int selectedSeparation) {
                     final name = (r['product_name'] ?? '').toString();
                     final code = (r['pack_barcode'] ?? '').toString();
                     final location = (r['location'] ?? '').toString();
-                    final checkedV = asNum(r['checked_amount']).toInt();
-                    final totalV = asNum(r['total']);
-                    final use = asBool(r['use'], true);
-                    final isAtc = asBool(r['is_atc']);
+                    final checkedV = _recipeStore.checked[i];
+                    final totalV = _recipeStore.total[i];
+                    final use = _recipeStore.use[i] != 0;
+                    final isAtc = _recipeStore.atc[i] == 1;
 
                     final bg = _statusColor(checkedV, totalV.ceil());
                     final on = _onColor(bg);
@@ -1179,6 +1551,7 @@ Map<String, String> calculateTotals(int selectedSeparation) {
                         );
                         if (updated is Map<String, dynamic>) {
                           setState(() => _rxRecipes[i] = updated);
+                          _reloadRecipes();
                           _refreshSeparationOptions();
                         }
                         // 다이얼로그 닫힌 후 바코드 입력창에 포커스 복원
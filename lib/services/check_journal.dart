@@ -0,0 +1,346 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:ffi';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart' show debugPrint;
+
+import '../native/pharm_native_bindings.dart';
+import 'local_store.dart';
+
+/// 체크 1건의 전송 결과
+enum CheckOutcome {
+  /// 서버가 처리했다 ([CheckAck.affected] 가 서버가 더한 값)
+  applied,
+
+  /// 서버가 오류로 거부했다. 다시 보내지 않는다.
+  rejected,
+
+  /// 보냈지만 응답을 받지 못해 반영 여부를 모른다. 두 번 더해질 수 있으므로
+  /// 다시 보내지 않는다.
+  unknown,
+}
+
+/// [CheckJournalService] 의 전송 함수가 던진다: 서버가 답한 오류라 다시
+/// 보내도 같다.
+class CheckRejected implements Exception {
+  const CheckRejected(this.message);
+  final String message;
+
+  @override
+  String toString() => 'CheckRejected: $message';
+}
+
+/// [CheckJournalService] 의 전송 함수가 던진다: 요청이 서버에 닿았을 수
+/// 있지만 응답이 없다 (시간 초과, 응답 전 연결 끊김).
+class CheckOutcomeUnknown implements Exception {
+  const CheckOutcomeUnknown(this.message);
+  final String message;
+
+  @override
+  String toString() => 'CheckOutcomeUnknown: $message';
+}
+
+/// 결과가 정해진 체크 1건
+class CheckAck {
+  const CheckAck({
+    required this.seq,
+    required this.rxrecipeId,
+    required this.delta,
+    required this.packSerial,
+    required this.affected,
+    this.outcome = CheckOutcome.applied,
+    this.error = '',
+  });
+
+  final int seq;
+  final int rxrecipeId;
+  final int delta;
+  final String packSerial;
+
+  /// update_checked_amount_and_packserial 결과. 0 이면 중복.
+  /// [outcome] 이 applied 가 아니면 0.
+  final int affected;
+
+  final CheckOutcome outcome;
+
+  /// rejected/unknown 의 사유
+  final String error;
+}
+
+/// update_checked_amount_and_packserial 쓰기 지연(write-behind) 저널
+///
+/// 스캔은 [enqueue] 로 저널에 기록된 즉시 반환되고, 백그라운드 플러셔가
+/// 순서대로 서버에 보낸다. 결과가 정해지면 [onAck] 가 호출되어 화면이
+/// 낙관적으로 반영한 값을 서버 결과(affected)에 맞춰 보정한다.
+///
+/// 서버에 닿지 못한 것이 확실한 실패만 다시 보낸다. 서버가 거부한 건
+/// (rejected) 과 보냈지만 응답이 없는 건 (unknown) 은 저널에서 빼고
+/// [onAck] 로 알린다. 거부된 한 건이 뒤의 체크를 모두 막거나, 이미 반영된
+/// 쓰기가 다시 더해지지 않게 하기 위함.
+///
+/// pharm_native_ffi 가 있으면 CRC 로 보호되는 check_journal.bin 에 기록해
+/// 앱이 죽거나 네트워크가 끊겨도 재시작/재연결 후 다시 보낸다. 앱이 죽을 때
+/// 보내던 중이던 건은 unknown 으로 알린다. 없으면 메모리 큐를 쓴다 (재시작
+/// 시 유실).
+class CheckJournalService {
+  CheckJournalService(this._send, {this.onAck});
+
+  /// 서버 호출. affected 를 반환한다. 서버가 거부하면 [CheckRejected],
+  /// 결과를 모르면 [CheckOutcomeUnknown], 보내지 못했으면 그 밖의 예외를
+  /// 던진다 (다시 보낸다).
+  final Future<int> Function(int rxrecipeId, int delta, String packSerial)
+      _send;
+
+  void Function(CheckAck ack)? onAck;
+
+  static const String _fileName = 'check_journal.bin';
+  static const int _batchSize = 8;
+  static const Duration _tick = Duration(milliseconds: 250);
+  static const Duration _minBackoff = Duration(milliseconds: 500);
+  static const Duration _maxBackoff = Duration(seconds: 30);
+  // native/check_journal.h 의 kCheckRejected, kCheckOutcomeUnknown
+  static const int _ackRejected = -1;
+  static const int _ackUnknown = -2;
+
+  PharmNativeBindings? _native;
+  Pointer<PharmCheckJournal> _handle = nullptr;
+  Pointer<PharmCheckEntry> _batch = nullptr;
+  Timer? _timer;
+  bool _flushing = false;
+
+  // Dart 대체 구현 (seq 는 음수로 매겨 네이티브 seq 와 겹치지 않게 한다)
+  final List<CheckAck> _memoryQueue = [];
+  int _memorySeq = 0;
+  DateTime _retryAt = DateTime.fromMillisecondsSinceEpoch(0);
+  Duration _backoff = Duration.zero;
+
+  /// 저널을 열어 지난 실행에서 못 보낸 항목을 다시 큐에 넣고 플러셔를 시작한다.
+  void open() {
+    final native = PharmNativeBindings.instance;
+    if (native != null && _native == null) {
+      final path = localStorePath(_fileName).toNativeUtf8();
+      try {
+        final handle = native.checkJournalOpen(path);
+        if (handle != nullptr) {
+          _native = native;
+          _handle = handle;
+          _batch = calloc<PharmCheckEntry>(_batchSize);
+        } else {
+          debugPrint('[CheckJournal] 저널 파일을 열 수 없음, 메모리 큐 사용');
+        }
+      } finally {
+        malloc.free(path);
+      }
+    }
+    _timer ??= Timer.periodic(_tick, (_) => unawaited(flush()));
+    unawaited(flush());
+  }
+
+  /// 체크 1건을 기록하고 seq 를 반환한다. 서버 전송은 백그라운드에서 한다.
+  int enqueue(int rxrecipeId, int delta, String packSerial) {
+    final native = _native;
+    if (native != null) {
+      final bytes = utf8.encode(packSerial);
+      final serial = toNativeBytes(bytes);
+      try {
+        final seq = native.checkJournalAppend(_handle, rxrecipeId, delta,
+            serial, bytes.length, DateTime.now().millisecondsSinceEpoch);
+        if (seq > 0) {
+          unawaited(flush());
+          return seq;
+        }
+        debugPrint('[CheckJournal] 저널 기록 실패, 메모리 큐 사용');
+      } finally {
+        malloc.free(serial);
+      }
+    }
+
+    final seq = --_memorySeq;
+    _memoryQueue.add(CheckAck(
+        seq: seq,
+        rxrecipeId: rxrecipeId,
+        delta: delta,
+        packSerial: packSerial,
+        affected: 0));
+    unawaited(flush());
+    return seq;
+  }
+
+  /// 대기 중인 항목을 순서대로 보낸다. 동시에 하나만 돈다.
+  Future<void> flush() async {
+    if (_flushing) return;
+    _flushing = true;
+    try {
+      while (await _flushBatch()) {}
+    } finally {
+      _flushing = false;
+    }
+  }
+
+  // 한 묶음을 보내고, 더 보낼 것이 있으면 true
+  Future<bool> _flushBatch() async {
+    final native = _native;
+    if (native != null) {
+      _settleUnsettled(native);
+      final now = DateTime.now().millisecondsSinceEpoch;
+      native.checkJournalSyncIfDue(_handle, now);
+      final count =
+          native.checkJournalTakeBatch(_handle, _batch, _batchSize, now);
+      final entries = _batchEntries(count);
+      final sent = await _sendInOrder(
+        entries,
+        ack: (e, affected) => native.checkJournalAck(_handle, e.seq, affected),
+        fail: (e) => native.checkJournalFail(
+            _handle, e.seq, DateTime.now().millisecondsSinceEpoch),
+      );
+      return count == _batchSize && sent == count;
+    }
+
+    if (_memoryQueue.isEmpty || DateTime.now().isBefore(_retryAt)) {
+      return false;
+    }
+    final entries = _memoryQueue.take(_batchSize).toList();
+    final sent = await _sendInOrder(
+      entries,
+      ack: (e, affected) {
+        _memoryQueue.remove(e);
+        _backoff = Duration.zero;
+      },
+      fail: (e) {},
+    );
+    if (sent < entries.length) {
+      final doubled = _backoff * 2;
+      _backoff = _backoff == Duration.zero
+          ? _minBackoff
+          : (doubled > _maxBackoff ? _maxBackoff : doubled);
+      _retryAt = DateTime.now().add(_backoff);
+    }
+    return sent == entries.length && _memoryQueue.isNotEmpty;
+  }
+
+  List<CheckAck> _batchEntries(int count) => [
+        for (var i = 0; i < count; i++)
+          CheckAck(
+            seq: _batch[i].seq,
+            rxrecipeId: _batch[i].rxrecipeId,
+            delta: _batch[i].delta,
+            packSerial: readFixedString(_batch[i].packSerial, 256),
+            affected: 0,
+          ),
+      ];
+
+  // 지난 실행이 보내던 중에 끝난 항목: 서버가 반영했을 수 있어 다시 보내지
+  // 않고 unknown 으로 알린다.
+  void _settleUnsettled(PharmNativeBindings native) {
+    while (true) {
+      final count =
+          native.checkJournalTakeUnsettled(_handle, _batch, _batchSize);
+      if (count == 0) return;
+      for (final e in _batchEntries(count)) {
+        native.checkJournalAck(_handle, e.seq, _ackUnknown);
+        onAck?.call(_settled(e, 0, CheckOutcome.unknown, '앱 종료 시 전송 중'));
+      }
+    }
+  }
+
+  static CheckAck _settled(
+          CheckAck e, int affected, CheckOutcome outcome, String error) =>
+      CheckAck(
+          seq: e.seq,
+          rxrecipeId: e.rxrecipeId,
+          delta: e.delta,
+          packSerial: e.packSerial,
+          affected: affected,
+          outcome: outcome,
+          error: error);
+
+  // 보내지 못한 항목이 생기면 나머지는 보내지 않고 되돌린다. 같은 일련번호의
+  // 재스캔이 원래 스캔을 앞지르지 않게 하기 위함. 결과가 정해진 건수를
+  // 반환한다.
+  Future<int> _sendInOrder(
+    List<CheckAck> entries, {
+    required void Function(CheckAck entry, int affected) ack,
+    required void Function(CheckAck entry) fail,
+  }) async {
+    var settled = 0;
+    var failed = false;
+    for (final e in entries) {
+      if (!failed) {
+        CheckAck? result;
+        var code = 0;
+        try {
+          final affected = await _send(e.rxrecipeId, e.delta, e.packSerial);
+          code = affected;
+          result = _settled(e, affected, CheckOutcome.applied, '');
+        } on CheckRejected catch (err) {
+          debugPrint('[CheckJournal] 서버 거부 (seq ${e.seq}): $err');
+          code = _ackRejected;
+          result = _settled(e, 0, CheckOutcome.rejected, err.message);
+        } on CheckOutcomeUnknown catch (err) {
+          debugPrint('[CheckJournal] 결과 모름 (seq ${e.seq}): $err');
+          code = _ackUnknown;
+          result = _settled(e, 0, CheckOutcome.unknown, err.message);
+        } catch (err) {
+          // 보내지 못한 실패만 여기 온다. 보냈을 수 있으면 _send 가
+          // CheckOutcomeUnknown 을 던진다. 다음 flush 때 다시 보낸다.
+          debugPrint('[CheckJournal] 전송 실패 (seq ${e.seq}): $err');
+          failed = true;
+        }
+        // 전송 중 dispose 되었으면 핸들이 닫혔으므로 기록하지 않는다.
+        if (_timer == null) return settled;
+        if (result != null) {
+          ack(e, code);
+          settled++;
+          onAck?.call(result);
+          continue;
+        }
+      }
+      if (_timer == null) return settled;
+      fail(e);
+    }
+    return settled;
+  }
+
+  /// 대기/재시도/중복 카운터
+  Map<String, int> stats() {
+    final native = _native;
+    if (native == null) {
+      return {'pending': _memoryQueue.length};
+    }
+    final out = calloc<PharmCheckJournalStats>();
+    try {
+      native.checkJournalStats(_handle, out);
+      final s = out.ref;
+      return {
+        'appended': s.appended,
+        'acked': s.acked,
+        'duplicates': s.duplicates,
+        'rejected': s.rejected,
+        'unknown': s.unknown,
+        'unsettled': s.unsettled,
+        'failures': s.failures,
+        'syncs': s.syncs,
+        'replayed': s.replayed,
+        'pending': s.pending,
+        'inFlight': s.inFlight,
+        'fileBytes': s.fileBytes,
+        'backoffMs': s.backoffMs,
+      };
+    } finally {
+      calloc.free(out);
+    }
+  }
+
+  void dispose() {
+    _timer?.cancel();
+    _timer = null;
+    final native = _native;
+    if (native == null) return;
+    // 보내는 중이던 항목은 ack 가 없으므로 다시 보내지 않는다. 다음 실행의
+    // _settleUnsettled 가 이들을 CheckOutcome.unknown 으로 알린다.
+    native.checkJournalClose(_handle);
+    calloc.free(_batch);
+    _native = null;
+  }
+}
@@ -5,16 +5,23 @@ import 'package:flutter/services.dart';
 class ComPortService extends ChangeNotifier {
   static const platform =
       MethodChannel('com.example.pharm_parrot_flutter/comport');
+  // 네이티브에서 완성된 라인을 즉시 전달하는 스트림
+  static const events =
+      EventChannel('com.example.pharm_parrot_flutter/comport/events');
 
+  StreamSubscription<dynamic>? _subscription;
   String _incomingData = '';
   bool _isConnected = false;
   int _comPortNumber = 4;
   bool _useComPort = false;
+  int _lastScanId = 0;
 
   bool get isConnected => _isConnected;
   String get incomingData => _incomingData;
   int get comPortNumber => _comPortNumber;
   bool get useComPort => _useComPort;
+  /// 마지막 라인의 스캔 추적 id (추적이 꺼져 있으면 0)
+  int get lastScanId => _lastScanId;
 
   // 바코드 수신 콜백
   Function(String)? _onBarcodeReceived;
@@ -81,47 +88,45 @@ class ComPortService extends ChangeNotifier {
   }
 
   /// COM Port에서 데이터 수신 시작
+  ///
+  /// 네이티브가 라인을 완성하는 즉시 (여러 줄이면 묶어서) 이벤트로 보내므로
+  /// 주기적으로 readComPort를 호출할 필요가 없습니다.
   void _startListening() {
-    // 100ms 주기로 포트에서 데이터 읽기
-    Timer.periodic(
-      const Duration(milliseconds: 100),
-      (timer) async {
-        if (!_isConnected) {
-          timer.cancel();
-          return;
-        }
-
-        try {
-          final String? data =
-              await platform.invokeMethod('readComPort') as String?;
-          if (data != null && data.isNotEmpty) {
-            _handleReceivedData(data);
+    _subscription?.cancel();
+    _subscription = events.receiveBroadcastStream().listen(
+      (event) {
+        if (event is List) {
+          for (final line in event) {
+            // 추적 중이면 {line, scanId}
+            if (line is Map) {
+              _handleReceivedLine(line['line'].toString(),
+                  scanId: line['scanId'] as int? ?? 0);
+            } else {
+              _handleReceivedLine(line.toString());
+            }
           }
-        } catch (e) {
-          debugPrint('포트 읽기 오류: $e');
+        } else if (event is String) {
+          _handleReceivedLine(event);
         }
       },
+      onError: (e) => debugPrint('포트 읽기 오류: $e'),
     );
   }
 
-  /// 수신된 데이터 처리
-  void _handleReceivedData(String data) {
-    try {
-      _incomingData += data;
-
-      // 엔터 또는 CR/LF로 완전한 바코드 판단
-      if (_incomingData.contains('\n') || _incomingData.contains('\r')) {
-        String barcode = _incomingData
-            .replaceAll('\r', '')
-            .replaceAll('\n', '')
-            .trim();
-
-        if (barcode.isNotEmpty) {
-          debugPrint('바코드 수신: $barcode');
-          _onBarcodeReceived?.call(barcode);
-        }
+  void _stopListening() {
+    _subscription?.cancel();
+    _subscription = null;
+  }
 
-        _incomingData = '';
+  /// 수신된 라인 처리 (CR/LF는 네이티브에서 이미 제거됨)
+  void _handleReceivedLine(String data, {int scanId = 0}) {
+    try {
+      _incomingData = data;
+      _lastScanId = scanId;
+      final barcode = data.trim();
+      if (barcode.isNotEmpty) {
+        debugPrint('바코드 수신: $barcode');
+        _onBarcodeReceived?.call(barcode);
       }
     } catch (e) {
       debugPrint('데이터 처리 오류: $e');
@@ -130,6 +135,7 @@ class ComPortService extends ChangeNotifier {
 
   /// COM Port 연결 해제
   Future<void> disconnect() async {
+    _stopListening();
     try {
       await platform.invokeMethod('closeComPort');
       _isConnected = false;
@@ -155,6 +161,19 @@ class ComPortService extends ChangeNotifier {
     }
   }
 
+  /// 라인 큐 통계 (드롭 수, 최고 적재량, 큐 대기 지연 등)
+  Future<Map<String, dynamic>> getQueueStats() async {
+    try {
+      final stats = await platform.invokeMethod('getComPortStats');
+      return Map<String, dynamic>.from(stats as Map);
+    } on PlatformException catch (e) {
+      debugPrint('COM Port 통계 조회 오류: ${e.message}');
+    } on MissingPluginException {
+      // 통계를 지원하지 않는 플랫폼
+    }
+    return {};
+  }
+
   @override
   void dispose() {
     disconnect();
@@ -0,0 +1,402 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart' show debugPrint;
+import 'package:intl/intl.dart';
+
+import '../native/pharm_native_bindings.dart';
+import 'local_store.dart';
+
+/// 하루치 처방(rxhead 목록 + 처방별 rxrecipe 행) 로컬 스냅숏
+///
+/// 날짜를 고르면 마지막으로 받아 둔 스냅숏을 즉시 보여 주고, [sync] 가
+/// 서버와 맞춘다. 서버에는 변경 피드가 없으므로 rxhead 행의 서명이 바뀐
+/// 처방(새 처방, is_complete 변경 등)과 로컬 체크로 [markDirty] 된 처방의
+/// rxrecipe 만 다시 받는다.
+///
+/// pharm_native_ffi 가 있으면 재시작 후에도 남는 메모리 매핑 파일
+/// (day_yyyyMMdd.snap)을, 없으면 프로세스 안의 Map 을 쓴다.
+class DaySnapshotService {
+  DaySnapshotService({required this.fetchHeads, required this.fetchRecipes});
+
+  /// select_rxhead_bydate
+  final Future<List<dynamic>> Function(DateTime day) fetchHeads;
+
+  /// select_rxrecipe_by_textfile_number
+  final Future<List<dynamic>> Function(num tfn) fetchRecipes;
+
+  static const int _kindHeads = 1;
+  static const int _kindRecipes = 2;
+  static const int _putChanged = 2;
+
+  /// 이 기간보다 오래된 스냅숏 파일은 open 때 지운다.
+  static const Duration keep = Duration(days: 7);
+
+  /// 동시에 보내는 rxrecipe 요청 수
+  static const int _concurrency = 4;
+
+  static final DateFormat _fileDate = DateFormat('yyyyMMdd');
+
+  PharmNativeBindings? _native;
+  Pointer<PharmDaySnapshot> _handle = nullptr;
+  Pointer<Uint8> _scratch = nullptr;
+  int _scratchSize = 0;
+
+  DateTime? _day;
+  // 저장된 rxhead 목록의 tfn. 다른 날짜의 처방은 스냅숏에 넣지 않는다.
+  final Set<num> _tfns = {};
+
+  // Dart 대체 구현
+  List<dynamic>? _memoryHeads;
+  final Map<num, List<dynamic>> _memoryRecipes = {};
+  final Set<num> _memoryDirty = {};
+  // tfn → 저장된 rxhead 목록에서 그 행의 서명 (jsonEncode)
+  final Map<num, String> _memorySignatures = {};
+  // tfn → rxrecipe 를 받을 때의 rxhead 행 서명
+  final Map<num, String?> _memoryFetchedWith = {};
+
+  Future<DaySync>? _syncing;
+
+  // 다른 날짜 스냅숏의 rxhead 목록 (open 때 비운다)
+  final Map<DateTime, List<dynamic>> _otherDays = {};
+
+  /// 스냅숏이 가리키는 날짜
+  DateTime? get day => _day;
+
+  /// [day] 의 스냅숏을 연다. 같은 날짜면 아무 일도 하지 않는다.
+  void open(DateTime day) {
+    final date = DateTime(day.year, day.month, day.day);
+    if (_day == date) return;
+    _close();
+    _day = date;
+    _syncing = null;
+    _otherDays.clear();
+
+    final native = PharmNativeBindings.instance;
+    if (native == null) return;
+    _removeOldFiles(date);
+    final path = localStorePath(_fileName(date)).toNativeUtf8();
+    try {
+      final handle =
+          native.daySnapshotOpen(path, int.parse(_fileDate.format(date)));
+      if (handle == nullptr) {
+        debugPrint('[DaySnapshot] 스냅숏 파일을 열 수 없음, 메모리 사용');
+        return;
+      }
+      _native = native;
+      _handle = handle;
+    } finally {
+      malloc.free(path);
+    }
+    final heads = this.heads();
+    if (heads != null) _rememberTfns(heads);
+  }
+
+  /// 저장된 rxhead 목록. 없으면 null.
+  List<dynamic>? heads() {
+    final native = _native;
+    if (native == null) return _memoryHeads;
+    return _get(native, _handle, _kindHeads, 0);
+  }
+
+  /// 열린 날짜와 그 전 [days]-1 일의 저장된 rxhead 목록(최근 날짜부터).
+  /// 다른 날짜는 파일이 있을 때만 잠깐 열어 읽는다.
+  List<dynamic> recentHeads(int days) {
+    final day = _day;
+    if (day == null) return const [];
+    final rows = [...?heads()];
+    final native = _native;
+    if (native == null) return rows;
+    for (var i = 1; i < days; i++) {
+      final other = DateTime(day.year, day.month, day.day - i);
+      rows.addAll(_otherDays[other] ??= _readHeads(native, other));
+    }
+    return rows;
+  }
+
+  List<dynamic> _readHeads(PharmNativeBindings native, DateTime day) {
+    final file = localStorePath(_fileName(day));
+    if (!File(file).existsSync()) return const [];
+    final path = file.toNativeUtf8();
+    final handle =
+        native.daySnapshotOpen(path, int.parse(_fileDate.format(day)));
+    malloc.free(path);
+    if (handle == nullptr) return const [];
+    try {
+      return _get(native, handle, _kindHeads, 0) ?? const [];
+    } finally {
+      native.daySnapshotClose(handle);
+    }
+  }
+
+  /// 저장된 [tfn] 의 rxrecipe 행. 없거나 이 날짜의 처방이 아니면 null.
+  List<dynamic>? recipes(num tfn) {
+    if (!_tfns.contains(tfn)) return null;
+    final native = _native;
+    if (native == null) return _memoryRecipes[tfn];
+    return _get(native, _handle, _kindRecipes, tfn.toInt());
+  }
+
+  /// 서버에서 [tfn] 의 rxrecipe 를 다시 받아 저장한다.
+  /// 받은 행과 저장된 행이 달랐는지 함께 돌려준다.
+  Future<(List<dynamic>, bool)> refreshRecipes(num tfn) async {
+    final day = _day;
+    final rows = await fetchRecipes(tfn);
+    if (day != _day || !_tfns.contains(tfn)) return (rows, true);
+    return (rows, _put(_kindRecipes, tfn, rows));
+  }
+
+  /// 로컬 체크 후: 다음 [sync] 때 [tfn] 을 다시 받는다.
+  void markDirty(num tfn) {
+    if (!_tfns.contains(tfn)) return;
+    final native = _native;
+    if (native == null) {
+      _memoryDirty.add(tfn);
+      return;
+    }
+    native.daySnapshotMarkDirty(_handle, tfn.toInt());
+  }
+
+  /// rxhead 목록을 받아 저장하고, 바뀐 처방의 rxrecipe 만 다시 받는다.
+  ///
+  /// [onHeads] 는 목록이 바뀌었을 때, [onRecipes] 는 처방의 행이 바뀌었을
+  /// 때 불린다. 진행 중인 sync 가 있으면 그 결과를 기다린다.
+  Future<DaySync> sync({
+    void Function(List<dynamic> heads)? onHeads,
+    void Function(num tfn, List<dynamic> rows)? onRecipes,
+  }) {
+    final running = _syncing;
+    if (running != null) return running;
+    late final Future<DaySync> future;
+    future = () async {
+      try {
+        return await _sync(onHeads, onRecipes);
+      } finally {
+        // 그 사이 open 이 새 날짜의 sync 를 시작했으면 그것은 남겨 둔다.
+        if (identical(_syncing, future)) _syncing = null;
+      }
+    }();
+    return _syncing = future;
+  }
+
+  Future<DaySync> _sync(
+    void Function(List<dynamic> heads)? onHeads,
+    void Function(num tfn, List<dynamic> rows)? onRecipes,
+  ) async {
+    final day = _day;
+    if (day == null) return const DaySync(headsChanged: false, recipes: 0);
+    final heads = await fetchHeads(day);
+    if (day != _day) return const DaySync(headsChanged: false, recipes: 0);
+    final headsChanged = _put(_kindHeads, 0, heads);
+    _rememberTfns(heads);
+    if (headsChanged) onHeads?.call(heads);
+
+    final queue = _recipesToFetch();
+    var fetched = 0;
+    Future<void> worker() async {
+      while (queue.isNotEmpty) {
+        final tfn = queue.removeAt(0);
+        try {
+          final (rows, changed) = await refreshRecipes(tfn);
+          if (day != _day) return;
+          fetched++;
+          if (changed) onRecipes?.call(tfn, rows);
+        } catch (e) {
+          // 다음 sync 때 다시 목록에 오른다.
+          debugPrint('[DaySnapshot] rxrecipe 조회 실패 ($tfn): $e');
+        }
+      }
+    }
+
+    await Future.wait([
+      for (var i = 0; i < _concurrency && i < queue.length; i++) worker(),
+    ]);
+    if (day == _day) _commit();
+    return DaySync(headsChanged: headsChanged, recipes: fetched);
+  }
+
+  List<num> _recipesToFetch() {
+    final native = _native;
+    if (native == null) {
+      return [
+        for (final tfn in _tfns)
+          if (!_memoryRecipes.containsKey(tfn) ||
+              _memoryDirty.contains(tfn) ||
+              _memoryFetchedWith[tfn] != _memorySignatures[tfn])
+            tfn,
+      ];
+    }
+    var capacity = _tfns.length + 1;
+    while (true) {
+      final out = malloc<Int64>(capacity);
+      try {
+        final total = native.daySnapshotRecipesToFetch(_handle, out, capacity);
+        if (total <= capacity) {
+          return [for (var i = 0; i < total; i++) out[i]];
+        }
+        capacity = total;
+      } finally {
+        malloc.free(out);
+      }
+    }
+  }
+
+  void _commit() {
+    final native = _native;
+    if (native == null) return;
+    native.daySnapshotCommit(_handle, DateTime.now().millisecondsSinceEpoch);
+  }
+
+  List<dynamic>? _get(PharmNativeBindings native,
+      Pointer<PharmDaySnapshot> handle, int kind, int key) {
+    var length = native.daySnapshotGet(
+        handle, kind, key, _scratch, _scratchSize, nullptr);
+    if (length < 0) return null;
+    if (length > _scratchSize) {
+      _growScratch(length);
+      length = native.daySnapshotGet(
+          handle, kind, key, _scratch, _scratchSize, nullptr);
+      if (length < 0 || length > _scratchSize) return null;
+    }
+    try {
+      final decoded = jsonDecode(utf8.decode(_scratch.asTypedList(length)));
+      return decoded is List ? decoded : null;
+    } on FormatException {
+      return null;
+    }
+  }
+
+  // 저장된 내용과 달랐으면 true
+  bool _put(int kind, num key, List<dynamic> rows) {
+    final native = _native;
+    if (native == null) {
+      if (kind == _kindHeads) {
+        final changed = jsonEncode(_memoryHeads) != jsonEncode(rows);
+        _memoryHeads = rows;
+        return changed;
+      }
+      final changed = jsonEncode(_memoryRecipes[key]) != jsonEncode(rows);
+      _memoryRecipes[key] = rows;
+      _memoryFetchedWith[key] = _memorySignatures[key];
+      _memoryDirty.remove(key);
+      return changed;
+    }
+    final bytes = utf8.encode(jsonEncode(rows));
+    if (bytes.length > _scratchSize) _growScratch(bytes.length);
+    _scratch.asTypedList(bytes.length).setAll(0, bytes);
+    final result = native.daySnapshotPut(_handle, kind, key.toInt(), _scratch,
+        bytes.length, DateTime.now().millisecondsSinceEpoch);
+    return result == _putChanged;
+  }
+
+  void _rememberTfns(List<dynamic> heads) {
+    final memory = _native == null;
+    _tfns.clear();
+    if (memory) _memorySignatures.clear();
+    for (final row in heads) {
+      final tfn = row is Map ? _asNum(row['tfn']) : null;
+      if (tfn == null) continue;
+      _tfns.add(tfn);
+      // 네이티브처럼 같은 tfn 이 여러 행이면 첫 행의 서명을 쓴다.
+      if (memory) _memorySignatures.putIfAbsent(tfn, () => jsonEncode(row));
+    }
+    if (memory) {
+      _memoryRecipes.removeWhere((tfn, _) => !_tfns.contains(tfn));
+      _memoryFetchedWith.removeWhere((tfn, _) => !_tfns.contains(tfn));
+    }
+  }
+
+  void _growScratch(int length) {
+    if (_scratch != nullptr) malloc.free(_scratch);
+    _scratchSize = length < 64 * 1024 ? 64 * 1024 : length * 2;
+    _scratch = malloc<Uint8>(_scratchSize);
+  }
+
+  /// 적중/미스/저장 카운터와 파일 크기
+  Map<String, int> stats() {
+    final native = _native;
+    if (native == null) {
+      return {
+        'entries': (_memoryHeads == null ? 0 : 1) + _memoryRecipes.length,
+        'dirty': _memoryDirty.length,
+      };
+    }
+    final out = calloc<PharmDaySnapshotStats>();
+    try {
+      native.daySnapshotStats(_handle, out);
+      final s = out.ref;
+      return {
+        'hits': s.hits,
+        'misses': s.misses,
+        'puts': s.puts,
+        'changed': s.changed,
+        'compactions': s.compactions,
+        'dropped': s.dropped,
+        'entries': s.entries,
+        'liveBytes': s.liveBytes,
+        'fileBytes': s.fileBytes,
+        'generation': s.generation,
+        'syncedMs': s.syncedMs,
+      };
+    } finally {
+      calloc.free(out);
+    }
+  }
+
+  void _close() {
+    final native = _native;
+    if (native != null) native.daySnapshotClose(_handle);
+    _native = null;
+    _handle = nullptr;
+    _tfns.clear();
+    _memoryHeads = null;
+    _memoryRecipes.clear();
+    _memoryDirty.clear();
+    _memorySignatures.clear();
+    _memoryFetchedWith.clear();
+  }
+
+  void dispose() {
+    _close();
+    _day = null;
+    if (_scratch != nullptr) malloc.free(_scratch);
+    _scratch = nullptr;
+    _scratchSize = 0;
+  }
+
+  static String _fileName(DateTime day) => 'day_${_fileDate.format(day)}.snap';
+
+  // [keep] 보다 오래된 날짜의 스냅숏. 열려 있는 날짜 파일은 남긴다.
+  static void _removeOldFiles(DateTime open) {
+    final cutoff = DateTime.now().subtract(keep);
+    try {
+      for (final entry in localStoreDir().listSync()) {
+        if (entry is! File) continue;
+        final name = entry.uri.pathSegments.last;
+        final match = RegExp(r'^day_(\d{8})\.snap$').firstMatch(name);
+        if (match == null || name == _fileName(open)) continue;
+        final date = DateTime.tryParse(match.group(1)!);
+        if (date != null && date.isBefore(cutoff)) entry.deleteSync();
+      }
+    } on FileSystemException catch (e) {
+      debugPrint('[DaySnapshot] 오래된 스냅숏 정리 실패: $e');
+    }
+  }
+
+  static num? _asNum(dynamic v) =>
+      v == null ? null : (v is num ? v : num.tryParse(v.toString()));
+}
+
+/// [DaySnapshotService.sync] 결과
+class DaySync {
+  const DaySync({required this.headsChanged, required this.recipes});
+
+  /// rxhead 목록이 스냅숏과 달랐는지
+  final bool headsChanged;
+
+  /// 다시 받은 처방 수
+  final int recipes;
+}
@@ -0,0 +1,127 @@
+import 'dart:convert';
+import 'dart:ffi';
+
+import 'package:ffi/ffi.dart';
+
+import '../native/pharm_native_bindings.dart';
+
+/// GS1 바코드 파싱 결과
+class Gs1Barcode {
+  const Gs1Barcode({
+    required this.status,
+    required this.gtin,
+    this.expiry = '',
+    this.lot = '',
+    this.serial = '',
+    this.packSerial = '',
+  });
+
+  /// native Gs1Status (0 = 정상)
+  final int status;
+
+  /// GTIN-14 (EAN-13 등은 0 으로 왼쪽 채움)
+  final String gtin;
+
+  /// AI(17) YYMMDD
+  final String expiry;
+
+  /// AI(10)
+  final String lot;
+
+  /// AI(21)
+  final String serial;
+
+  /// 중복 스캔 판별과 서버 기록용 일련번호. 기존 방식 그대로 (01) GTIN 뒤의
+  /// 나머지 전체 ("21..." + (17), (10) 등)라 이미 저장된 값과 비교된다.
+  final String packSerial;
+
+  bool get isValid => status == 0 && gtin.isNotEmpty;
+
+  /// 약품 조회용 13자리 바코드 (GTIN-14 에서 포장 지시자 제거)
+  String get baseBarcode => gtin.length == 14 ? gtin.substring(1) : gtin;
+}
+
+/// GS1 AI 파서 (pharm_native_ffi). 라이브러리가 없으면 기존 고정 위치
+/// substring 방식으로 대체한다.
+class Gs1BarcodeService {
+  /// 바코드 한 개 파싱
+  static Gs1Barcode parse(String raw) {
+    final native = PharmNativeBindings.instance;
+    if (native == null) return _legacyParse(raw);
+
+    // 한글 등이 섞여도 예외 없이 파싱 실패(status != 0)로 끝난다.
+    final bytes = utf8.encode(raw);
+    final data = toNativeBytes(bytes);
+    final out = calloc<PharmGs1Record>();
+    try {
+      native.gs1Parse(data, bytes.length, out);
+      return _fromRecord(out.ref, raw);
+    } finally {
+      malloc.free(data);
+      calloc.free(out);
+    }
+  }
+
+  /// CR/LF 로 구분된 스캔 로그 일괄 파싱 (감사용 재생)
+  static List<Gs1Barcode> parseBatch(String log) {
+    final native = PharmNativeBindings.instance;
+    if (native == null) {
+      return const LineSplitter()
+          .convert(log)
+          .where((l) => l.isNotEmpty)
+          .map(_legacyParse)
+          .toList();
+    }
+
+    final bytes = utf8.encode(log);
+    // 한 줄은 최소 2바이트(문자 + 개행)이므로 이 용량이면 충분하다.
+    final capacity = bytes.length ~/ 2 + 1;
+    final data = toNativeBytes(bytes);
+    final out = calloc<PharmGs1Record>(capacity);
+    try {
+      final count = native.gs1ParseBatch(data, bytes.length, out, capacity);
+      final lines =
+          const LineSplitter().convert(log).where((l) => l.isNotEmpty).toList();
+      return [
+        for (var i = 0; i < count; i++)
+          _fromRecord(out[i], i < lines.length ? lines[i] : ''),
+      ];
+    } finally {
+      malloc.free(data);
+      calloc.free(out);
+    }
+  }
+
+  static Gs1Barcode _fromRecord(PharmGs1Record r, String raw) => Gs1Barcode(
+        status: r.status,
+        gtin: readFixedString(r.gtin, 15),
+        expiry: readFixedString(r.expiry, 7),
+        lot: readFixedString(r.lot, 21),
+        serial: readFixedString(r.serial, 21),
+        packSerial: _legacyPackSerial(raw),
+      );
+
+  // 예전 handleBarcode 의 raw.substring(16). 심볼 식별자("]d2")와 앞의 FNC1 은
+  // 예전에도 붙어 오지 않던 것이라 떼고 센다.
+  static String _legacyPackSerial(String raw) {
+    var code = raw.replaceAll('(', '').replaceAll(')', '');
+    if (code.length >= 3 && code.startsWith(']')) code = code.substring(3);
+    while (code.startsWith('\x1d')) {
+      code = code.substring(1);
+    }
+    return code.length >= 16 ? code.substring(16) : '';
+  }
+
+  // C#: if (raw.Length >= 16) { base = raw.Substring(3, 13); pack = raw.Substring(16); } else base = raw;
+  static Gs1Barcode _legacyParse(String raw) {
+    final code = raw.replaceAll('(', '').replaceAll(')', '');
+    if (code.length >= 16) {
+      return Gs1Barcode(
+          status: 0,
+          gtin: code.substring(2, 16),
+          serial: code.substring(16),
+          packSerial: code.substring(16));
+    }
+    return Gs1Barcode(status: 0, gtin: code);
+  }
+}
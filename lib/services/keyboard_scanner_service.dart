@@ -0,0 +1,79 @@
+import 'dart:async';
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+/// USB HID(키보드 웨지) 스캐너의 입력을 한 번의 스캔으로 받는다
+///
+/// 네이티브 러너가 창에 들어오는 키를 뷰보다 먼저 보고, 사람이 칠 수 없는
+/// 간격(기본 30ms 이하)으로 이어진 키 묶음을 바코드 하나로 보낸다. 어느
+/// 위젯에 포커스가 있든 스캔이 TextField 에 흩어지지 않는다. 평소 타이핑은
+/// 최대 [maxGapMs] 늦게 그대로 전달된다. 지원하지 않는 플랫폼에서는
+/// 아무것도 하지 않는다.
+class KeyboardScannerService {
+  static const platform = MethodChannel('pharm_parrot/keyboard_scanner');
+  static const events = EventChannel('pharm_parrot/keyboard_scanner/events');
+
+  KeyboardScannerService({this.onScan});
+
+  /// 스캔된 코드 (앞뒤 공백 제거된 내용, 스캔 추적 id 또는 0)
+  final void Function(String line, int scanId)? onScan;
+
+  StreamSubscription<dynamic>? _subscription;
+
+  /// 감지를 켜고 설정을 바꾼다. 빠진 값은 그대로 둔다.
+  /// [maxGapMs] 키 사이 최대 간격, [minLength] 스캔으로 볼 최소 글자 수,
+  /// [endOnTab] 이면 Tab 도 Enter 처럼 스캔을 끝낸다.
+  Future<bool> configure({
+    bool enabled = true,
+    int? maxGapMs,
+    int? minLength,
+    bool? endOnTab,
+  }) async {
+    if (enabled) _startListening();
+    try {
+      final result = await platform.invokeMethod('configure', {
+        'enabled': enabled,
+        if (maxGapMs != null) 'maxGapMs': maxGapMs,
+        if (minLength != null) 'minLength': minLength,
+        if (endOnTab != null) 'endOnTab': endOnTab,
+      });
+      return result == true;
+    } on PlatformException catch (e) {
+      debugPrint('키보드 스캐너 설정 오류: ${e.message}');
+    } on MissingPluginException {
+      // 키보드 스캐너 감지를 지원하지 않는 플랫폼
+    }
+    return false;
+  }
+
+  /// 설정과 통계 (enabled, maxGapMs, minLength, scans, typedBursts 등)
+  Future<Map<String, dynamic>> getStats() async {
+    try {
+      final stats = await platform.invokeMethod('getStats');
+      return Map<String, dynamic>.from(stats as Map);
+    } on PlatformException catch (e) {
+      debugPrint('키보드 스캐너 통계 조회 오류: ${e.message}');
+    } on MissingPluginException {
+      // 키보드 스캐너 감지를 지원하지 않는 플랫폼
+    }
+    return {};
+  }
+
+  void _startListening() {
+    _subscription ??= events.receiveBroadcastStream().listen(
+      (event) {
+        if (event is! Map) return;
+        final line = event['line']?.toString().trim() ?? '';
+        if (line.isEmpty) return;
+        onScan?.call(line, event['scanId'] as int? ?? 0);
+      },
+      onError: (e) => debugPrint('키보드 스캐너 읽기 오류: $e'),
+    );
+  }
+
+  /// 구독을 끝낸다. 네이티브는 붙잡고 있던 키를 그대로 돌려보낸다.
+  Future<void> dispose() async {
+    await _subscription?.cancel();
+    _subscription = null;
+  }
+}
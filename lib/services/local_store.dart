@@ -0,0 +1,28 @@
+import 'dart:io';
+
+/// 로컬 캐시/저널 파일을 두는 앱 전용 디렉터리
+///
+/// Windows: %LOCALAPPDATA%\pharm_parrot, Linux: $XDG_DATA_HOME/pharm_parrot
+/// (없으면 ~/.local/share/pharm_parrot). 둘 다 없으면 시스템 임시 폴더를 쓴다.
+Directory localStoreDir() {
+  final env = Platform.environment;
+  String base;
+  if (Platform.isWindows) {
+    base = env['LOCALAPPDATA'] ?? env['APPDATA'] ?? Directory.systemTemp.path;
+  } else {
+    final xdg = env['XDG_DATA_HOME'];
+    final home = env['HOME'];
+    base = (xdg != null && xdg.isNotEmpty)
+        ? xdg
+        : (home != null ? '$home/.local/share' : Directory.systemTemp.path);
+  }
+  final dir = Directory('$base${Platform.pathSeparator}pharm_parrot');
+  if (!dir.existsSync()) {
+    dir.createSync(recursive: true);
+  }
+  return dir;
+}
+
+/// [localStoreDir] 안의 파일 경로
+String localStorePath(String fileName) =>
+    '${localStoreDir().path}${Platform.pathSeparator}$fileName';
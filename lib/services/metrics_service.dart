@@ -0,0 +1,147 @@
+import 'dart:ffi';
+import 'dart:io';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart' show kIsWeb, debugPrint;
+import 'package:flutter/services.dart';
+
+import '../native/pharm_native_bindings.dart';
+import 'local_store.dart';
+
+/// 약국마다의 지연/처리량 지표 (Prometheus text 파일)
+///
+/// 스캔 한 건을 들여다보는 [TraceService] 와 달리, 여기서는 모든 스캔을
+/// 모아 p50/p99/p999 로 본다. Dart 는 스캔→음성 요청, 함수별 RPC 지연 같은
+/// 앱 쪽 숫자를 네이티브 레지스트리(스레드별 샤드, 잠금 없음)에 기록하고,
+/// 러너는 채널 호출 지연, TTS 대기, 시리얼 라인/드롭을 따로 기록한다.
+///
+/// [start] 이후 둘은 같은 디렉터리의 `pharm_parrot_app.prom`,
+/// `pharm_parrot_runner.prom` 에 주기적으로 쓰인다. 디렉터리를 node_exporter
+/// (Windows 는 windows_exporter) textfile collector 에 물려 두면 앱 안에
+/// 네트워크 서비스 없이 수집된다. 기본 위치는 로컬 저장소의 metrics,
+/// PHARM_METRICS_DIR 로 바꿀 수 있다.
+///
+/// 네이티브 라이브러리가 없으면 기록은 아무것도 하지 않는다.
+class MetricsService {
+  static const MethodChannel _channel = MethodChannel('pharm_parrot/metrics');
+  static const Duration defaultInterval = Duration(seconds: 15);
+
+  static final Stopwatch _clock = Stopwatch()..start();
+  static final Map<String, Pointer<PharmMetricCounter>> _counters = {};
+  static final Map<String, Pointer<PharmMetricGauge>> _gauges = {};
+  static final Map<String, Pointer<PharmMetricHistogram>> _histograms = {};
+  static String? _directory;
+
+  /// 지표가 쓰이는 디렉터리 ([start] 전에는 null)
+  static String? get directory => _directory;
+
+  /// 단조 시계(µs, 0 이 아님). 구간 시작에 찍어 두고 [observeSince] 에 넘긴다.
+  static int nowUs() => _clock.elapsedMicroseconds + 1;
+
+  /// [name] 지연 분포에 [us] 를 더한다. 이름은 `_seconds` 로 끝낸다.
+  static void observe(String name, int us,
+      {String? label, String? value, String? help}) {
+    final native = PharmNativeBindings.instance;
+    if (native == null) return;
+    final histogram = _lookup(_histograms, native.metricsHistogram, name,
+        label, value, help);
+    native.metricsHistogramRecord(histogram, us);
+  }
+
+  /// [beginUs] ([nowUs]) 부터 지금까지. [beginUs] 가 0 이면 기록하지 않는다.
+  static void observeSince(String name, int beginUs,
+      {String? label, String? value, String? help}) {
+    if (beginUs == 0) return;
+    observe(name, nowUs() - beginUs, label: label, value: value, help: help);
+  }
+
+  /// [name] 카운터에 [by] 를 더한다. 이름은 `_total` 로 끝낸다.
+  static void count(String name,
+      {int by = 1, String? label, String? value, String? help}) {
+    final native = PharmNativeBindings.instance;
+    if (native == null) return;
+    native.metricsCounterAdd(
+        _lookup(_counters, native.metricsCounter, name, label, value, help),
+        by);
+  }
+
+  static void setGauge(String name, int level,
+      {String? label, String? value, String? help}) {
+    final native = PharmNativeBindings.instance;
+    if (native == null) return;
+    native.metricsGaugeSet(
+        _lookup(_gauges, native.metricsGauge, name, label, value, help),
+        level);
+  }
+
+  /// 핸들은 이름과 레이블마다 한 번만 찾고 계속 쓴다 (네이티브에서 해제되지 않음).
+  static Pointer<T> _lookup<T extends NativeType>(
+      Map<String, Pointer<T>> cache,
+      Pointer<T> Function(
+              Pointer<Utf8>, Pointer<Utf8>, Pointer<Utf8>, Pointer<Utf8>)
+          find,
+      String name,
+      String? label,
+      String? value,
+      String? help) {
+    final key = label == null ? name : '$name\n$label\n$value';
+    final cached = cache[key];
+    if (cached != null) return cached;
+    final namePtr = name.toNativeUtf8();
+    final labelPtr = label?.toNativeUtf8() ?? nullptr;
+    final valuePtr = (value ?? '').toNativeUtf8();
+    final helpPtr = help?.toNativeUtf8() ?? nullptr;
+    try {
+      return cache[key] = find(namePtr, labelPtr, valuePtr, helpPtr);
+    } finally {
+      malloc.free(namePtr);
+      if (labelPtr != nullptr) malloc.free(labelPtr);
+      malloc.free(valuePtr);
+      if (helpPtr != nullptr) malloc.free(helpPtr);
+    }
+  }
+
+  /// 앱과 러너의 지표를 [interval] 마다 파일로 쓰기 시작한다.
+  static Future<void> start({Duration interval = defaultInterval}) async {
+    final native = PharmNativeBindings.instance;
+    if (kIsWeb || native == null) return;
+    final env = Platform.environment['PHARM_METRICS_DIR'];
+    final dir = Directory(
+        env != null && env.isNotEmpty ? env : localStorePath('metrics'));
+    try {
+      dir.createSync(recursive: true);
+    } on FileSystemException catch (e) {
+      debugPrint('[Metrics] 디렉터리 생성 오류: ${e.message}');
+      return;
+    }
+    _directory = dir.path;
+    final sep = Platform.pathSeparator;
+    final appPath = '${dir.path}${sep}pharm_parrot_app.prom'.toNativeUtf8();
+    try {
+      native.metricsStartWriter(appPath, interval.inMilliseconds);
+    } finally {
+      malloc.free(appPath);
+    }
+    try {
+      await _channel.invokeMethod('start', {
+        'path': '${dir.path}${sep}pharm_parrot_runner.prom',
+        'intervalMs': interval.inMilliseconds,
+      });
+    } on PlatformException catch (e) {
+      debugPrint('[Metrics] 러너 지표 시작 오류: ${e.message}');
+    } on MissingPluginException {
+      // 러너 쪽 지표가 없는 플랫폼: 앱 지표만 쓴다.
+    }
+  }
+
+  static Future<void> stop() async {
+    PharmNativeBindings.instance?.metricsStartWriter(nullptr, 0);
+    try {
+      await _channel.invokeMethod('stop');
+    } on PlatformException catch (e) {
+      debugPrint('[Metrics] 러너 지표 중지 오류: ${e.message}');
+    } on MissingPluginException {
+      // 러너 쪽 지표가 없는 플랫폼
+    }
+  }
+}
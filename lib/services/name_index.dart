@@ -0,0 +1,156 @@
+import 'dart:convert';
+import 'dart:ffi';
+
+import 'package:ffi/ffi.dart';
+
+import '../native/pharm_native_bindings.dart';
+
+/// 환자 이름/번호 입력 중 검색 (서버 호출 없음)
+///
+/// 최근 며칠의 rxhead 행을 [rebuild] 해 두면, 이름 입력란의 매 키 입력마다
+/// [search] 로 목록을 좁힌다.
+/// - 완성된 음절은 그대로, 초성(ㄱ..ㅎ)은 그 초성으로 시작하는 음절과 맞는다
+///   ("ㄱㅁㅅ" → 김민수).
+/// - 마지막 글자는 조합 중일 수 있다("김미" → 김민수, "김" → 기미영).
+/// - 접수번호, 생년월일, tfn 도 부분 일치로 찾는다.
+/// 결과는 전체 일치 > 앞부분 일치 > 중간 일치, 이어서 정확히 맞은 음절 수 순.
+///
+/// pharm_native_ffi 가 있으면 네이티브 n-gram 인덱스를, 없으면 Dart 선형
+/// 탐색(조합 중 글자 규칙 제외)을 쓴다.
+class NameIndex {
+  NameIndex() {
+    final native = PharmNativeBindings.instance;
+    if (native != null) {
+      _native = native;
+      _handle = native.nameIndexCreate();
+      _ids = malloc<Int32>(maxResults);
+      _query = malloc<Uint8>(_maxQueryBytes);
+    }
+  }
+
+  static const int maxResults = 50;
+  static const int _maxQueryBytes = 256;
+
+  PharmNativeBindings? _native;
+  Pointer<PharmNameIndex> _handle = nullptr;
+  Pointer<Int32> _ids = nullptr;
+  Pointer<Uint8> _query = nullptr;
+
+  List<dynamic> _rows = const [];
+  // Dart 대체 구현: 행별 (이름, 번호들)
+  final List<(String, List<String>)> _fields = [];
+
+  static String nameOf(dynamic row) =>
+      (row['patient_name'] ?? row['name'] ?? row['환자명'] ?? '').toString();
+
+  static List<String> numbersOf(dynamic row) => [
+        for (final v in [
+          row['no'],
+          row['patient_birth'] ?? row['birth_date'] ?? row['생년월일'],
+          row['tfn'],
+        ])
+          if (v != null && v.toString().trim().isNotEmpty)
+            v.toString().replaceAll(RegExp(r'\s'), ''),
+      ];
+
+  /// rxhead 행 전체로 인덱스를 다시 만든다. 같은 tfn 은 처음 것만 남긴다.
+  void rebuild(List<dynamic> rows) {
+    final seen = <String>{};
+    _rows = [
+      for (final row in rows)
+        if (row is Map && seen.add('${row['tfn']}')) row,
+    ];
+
+    final native = _native;
+    if (native != null) {
+      final names = utf8.encode(
+          _rows.map((r) => '${nameOf(r).replaceAll('\n', ' ')}\n').join());
+      final numbers =
+          utf8.encode(_rows.map((r) => '${numbersOf(r).join(' ')}\n').join());
+      final namePtr = toNativeBytes(names);
+      final numberPtr = toNativeBytes(numbers);
+      try {
+        native.nameIndexBuild(_handle, namePtr, names.length, numberPtr,
+            numbers.length, _rows.length);
+      } finally {
+        malloc.free(namePtr);
+        malloc.free(numberPtr);
+      }
+      return;
+    }
+
+    _fields
+      ..clear()
+      ..addAll([
+        for (final r in _rows)
+          (_normalize(nameOf(r)), numbersOf(r).map(_normalize).toList()),
+      ]);
+  }
+
+  /// [query] 와 맞는 행, 좋은 것부터 최대 [maxResults] 개
+  List<dynamic> search(String query) {
+    final native = _native;
+    final bytes = utf8.encode(query);
+    if (native != null && bytes.length <= _maxQueryBytes) {
+      _query.asTypedList(bytes.length).setAll(0, bytes);
+      final count = native.nameIndexSearch(
+          _handle, _query, bytes.length, _ids, maxResults);
+      final n = count < maxResults ? count : maxResults;
+      return [for (var i = 0; i < n; i++) _rows[_ids[i]]];
+    }
+
+    final q = _normalize(query);
+    if (q.isEmpty) return const [];
+    final ranked = <(int, int)>[];
+    for (var i = 0; i < _fields.length && i < _rows.length; i++) {
+      final (name, numbers) = _fields[i];
+      var best = 0;
+      for (final field in [name, ...numbers]) {
+        final at = _indexOf(field, q);
+        if (at < 0) continue;
+        final rank = at > 0 ? 1 : (field.length == q.length ? 3 : 2);
+        if (rank > best) best = rank;
+      }
+      if (best > 0) ranked.add((best, i));
+    }
+    ranked.sort((a, b) => a.$1 != b.$1 ? b.$1 - a.$1 : a.$2 - b.$2);
+    return [for (final (_, i) in ranked.take(maxResults)) _rows[i]];
+  }
+
+  static String _normalize(String s) =>
+      s.replaceAll(RegExp(r'\s'), '').toLowerCase();
+
+  static const List<int> _initials = [
+    0x3131, 0x3132, 0x3134, 0x3137, 0x3138, 0x3139, 0x3141, 0x3142, 0x3143, //
+    0x3145, 0x3146, 0x3147, 0x3148, 0x3149, 0x314A, 0x314B, 0x314C, 0x314D,
+    0x314E,
+  ];
+
+  static bool _charMatches(int q, int c) {
+    if (q == c) return true;
+    if (!_initials.contains(q) || c < 0xAC00 || c > 0xD7A3) return false;
+    return _initials[(c - 0xAC00) ~/ 588] == q;
+  }
+
+  static int _indexOf(String field, String q) {
+    final f = field.runes.toList();
+    final p = q.runes.toList();
+    for (var at = 0; at + p.length <= f.length; at++) {
+      var i = 0;
+      while (i < p.length && _charMatches(p[i], f[at + i])) {
+        i++;
+      }
+      if (i == p.length) return at;
+    }
+    return -1;
+  }
+
+  void dispose() {
+    final native = _native;
+    if (native == null) return;
+    native.nameIndexDestroy(_handle);
+    malloc.free(_ids);
+    malloc.free(_query);
+    _native = null;
+  }
+}
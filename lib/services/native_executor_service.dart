@@ -0,0 +1,30 @@
+import 'package:flutter/foundation.dart' show kIsWeb, debugPrint;
+import 'package:flutter/services.dart';
+
+/// 네이티브 작업 실행기(executor) 지표
+///
+/// 막힐 수 있는 채널 작업(시리얼 쓰기/열기/닫기, SAPI 음성)은 플랫폼 스레드가
+/// 아닌 작업 스레드에서 서비스별 순서(strand)대로 실행된다. 여기서 돌려주는
+/// 값으로 채널 호출이 화면 갱신을 막지 않는지 확인한다.
+///
+/// - `strands`: 서비스별 `{posted, executed, cancelled, pending, avgQueueUs,
+///   maxQueueUs, avgRunUs, maxRunUs}`
+/// - `maxPlatformBusyUs`: 채널 핸들러/응답 처리가 플랫폼 스레드를 잡고 있던
+///   가장 긴 시간. 16667us(한 프레임)를 넘은 횟수는 `platformBusyOverFrame`.
+/// - `avgCompletionUs`, `maxCompletionUs`: 작업 완료부터 응답 전달까지 지연
+class NativeExecutorService {
+  static const MethodChannel _channel = MethodChannel('pharm_parrot/executor');
+
+  static Future<Map<String, dynamic>> stats() async {
+    if (kIsWeb) return {};
+    try {
+      final result = await _channel.invokeMethod('getStats');
+      return Map<String, dynamic>.from(result as Map);
+    } on PlatformException catch (e) {
+      debugPrint('[Executor] 통계 조회 오류: ${e.message}');
+    } on MissingPluginException {
+      // 실행기가 없는 플랫폼
+    }
+    return {};
+  }
+}
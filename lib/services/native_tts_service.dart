@@ -1,10 +1,24 @@
 import 'package:flutter/foundation.dart' show kIsWeb, debugPrint;
 import 'package:flutter/services.dart';
 
+/// 음성 안내 분류. 높은 분류가 낮은 분류의 안내를 끊고 먼저 나온다.
+/// (Linux 러너만 반영, Windows 는 무시)
+enum TtsPriority {
+  /// 환자명: 새 환자명이 이전 환자명을 대체한다
+  patient,
+
+  /// 약품 안내
+  drug,
+
+  /// 오류/중복 경고
+  error,
+}
+
 class NativeTtsService {
   static const MethodChannel _channel = MethodChannel('pharm_parrot/tts');
   
-  Future<void> speak(String text) async {
+  Future<void> speak(String text,
+      {TtsPriority priority = TtsPriority.drug}) async {
     if (kIsWeb) {
       // Web implementation using browser's speech synthesis
       // Could be implemented later if needed
@@ -13,7 +27,8 @@ class NativeTtsService {
     }
     
     try {
-      await _channel.invokeMethod('speak', {'text': text});
+      await _channel.invokeMethod(
+          'speak', {'text': text, 'priority': priority.name});
       debugPrint('[TTS Native] Speaking: $text');
     } on PlatformException catch (e) {
       debugPrint('[TTS Error] ${e.message}');
@@ -22,13 +37,16 @@ class NativeTtsService {
     }
   }
   
-  Future<void> beep(int frequency, int duration) async {
+  /// 비동기로 재생한다. 재생이 끝나기 전에 반환된다.
+  Future<void> beep(int frequency, int duration,
+      {TtsPriority priority = TtsPriority.drug}) async {
     if (kIsWeb) return;
     
     try {
       await _channel.invokeMethod('beep', {
         'frequency': frequency,
         'duration': duration,
+        'priority': priority.name,
       });
     } on PlatformException catch (e) {
       debugPrint('[Beep Error] ${e.message}');
@@ -44,4 +62,31 @@ class NativeTtsService {
       debugPrint('[TTS Error] ${e.message}');
     }
   }
+
+  /// [texts] 의 안내 문장 조각(약품명, 숫자, 단위)을 백그라운드에서 미리
+  /// 합성해 캐시에 넣는다. Linux 러너만 지원.
+  Future<void> warm(List<String> texts) async {
+    if (kIsWeb || texts.isEmpty) return;
+    try {
+      await _channel.invokeMethod('warm', {'texts': texts});
+    } on PlatformException catch (e) {
+      debugPrint('[TTS Error] ${e.message}');
+    } on MissingPluginException {
+      // Windows 러너에는 없음
+    }
+  }
+
+  /// 대기열 길이, 첫 음성까지 걸린 시간(us), 음성 캐시 적중 등. Linux 러너만 지원.
+  Future<Map<String, int>> stats() async {
+    if (kIsWeb) return {};
+    try {
+      final result = await _channel.invokeMapMethod<String, int>('getStats');
+      return result ?? {};
+    } on PlatformException catch (e) {
+      debugPrint('[TTS Error] ${e.message}');
+    } on MissingPluginException {
+      // Windows 러너에는 없음
+    }
+    return {};
+  }
 }
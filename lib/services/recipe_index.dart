@@ -0,0 +1,127 @@
+import 'dart:convert';
+import 'dart:ffi';
+
+import 'package:ffi/ffi.dart';
+
+import '../native/pharm_native_bindings.dart';
+
+/// 스캔한 바코드 → 처방(RxRecipe) 행 인덱스
+///
+/// type == 'E' 는 앞 12자리, 그 외는 앞 11자리로 매칭한다. 결과는 미완료 행이
+/// 먼저, 같은 상태끼리는 행 순서대로 정렬된다. select_rxrecipe_by_textfile_number
+/// 결과가 도착할 때 [rebuild] 하고, checked_amount 가 바뀌면 [setComplete] 한다.
+///
+/// pharm_native_ffi 가 있으면 네이티브 해시 인덱스를, 없으면 Dart Map 을 쓴다.
+class RecipeIndex {
+  RecipeIndex() {
+    final native = PharmNativeBindings.instance;
+    if (native != null) {
+      _native = native;
+      _handle = native.recipeIndexCreate();
+      _barcode = malloc<Uint8>(_maxBarcodeLength);
+      _rows = malloc<Int32>(_maxCandidates);
+    }
+  }
+
+  static const int _maxBarcodeLength = 64;
+  static const int _maxCandidates = 64;
+
+  PharmNativeBindings? _native;
+  Pointer<PharmRecipeIndex> _handle = nullptr;
+  Pointer<Uint8> _barcode = nullptr;
+  Pointer<Int32> _rows = nullptr;
+
+  // Dart 대체 구현: 'E'+12자리 / 'T'+11자리 키 → 행 번호
+  final Map<String, List<int>> _byKey = {};
+  final List<bool> _complete = [];
+
+  static String typeOf(dynamic row) =>
+      (row['type'] ?? row['T'] ?? row['typeCode'] ?? '').toString().trim().toUpperCase();
+
+  static bool isComplete(dynamic row, num Function(dynamic) asNum) =>
+      asNum(row['checked_amount'] ?? row['Checked']) >= asNum(row['total'] ?? row['Total']);
+
+  /// 처방 목록 전체로 인덱스를 다시 만든다.
+  void rebuild(List<dynamic> rows, num Function(dynamic) asNum) {
+    final codes = <String>[];
+    final types = <int>[];
+    final complete = <int>[];
+    for (final r in rows) {
+      // 바코드에 개행이 섞이면 행 경계가 어긋나므로 제거
+      codes.add((r['pack_barcode'] ?? '').toString().trim().replaceAll('\n', ''));
+      types.add(typeOf(r) == 'E' ? 0x45 : 0x54);
+      complete.add(isComplete(r, asNum) ? 1 : 0);
+    }
+
+    final native = _native;
+    if (native != null) {
+      final codeBytes = utf8.encode(codes.join('\n'));
+      final codePtr = toNativeBytes(codeBytes);
+      final typePtr = toNativeBytes(types);
+      final completePtr = toNativeBytes(complete);
+      try {
+        native.recipeIndexBuild(_handle, codePtr, codeBytes.length, typePtr,
+            completePtr, rows.length);
+      } finally {
+        malloc.free(codePtr);
+        malloc.free(typePtr);
+        malloc.free(completePtr);
+      }
+      return;
+    }
+
+    _byKey.clear();
+    _complete
+      ..clear()
+      ..addAll(complete.map((c) => c != 0));
+    for (var i = 0; i < codes.length; i++) {
+      final digits = types[i] == 0x45 ? 12 : 11;
+      if (codes[i].length < digits) continue;
+      final key = String.fromCharCode(types[i]) + codes[i].substring(0, digits);
+      (_byKey[key] ??= []).add(i);
+    }
+  }
+
+  /// checked_amount 변경 후 완료 여부 갱신
+  void setComplete(int row, bool complete) {
+    final native = _native;
+    if (native != null) {
+      native.recipeIndexSetComplete(_handle, row, complete ? 1 : 0);
+    } else if (row >= 0 && row < _complete.length) {
+      _complete[row] = complete;
+    }
+  }
+
+  /// [barcode] 와 매칭되는 행 번호 (미완료 우선)
+  List<int> lookup(String barcode) {
+    final native = _native;
+    if (native != null && barcode.length <= _maxBarcodeLength) {
+      final units = barcode.codeUnits;
+      for (var i = 0; i < units.length; i++) {
+        _barcode[i] = units[i] & 0xFF;
+      }
+      final count = native.recipeIndexLookup(
+          _handle, _barcode, units.length, _rows, _maxCandidates);
+      final n = count < _maxCandidates ? count : _maxCandidates;
+      return [for (var i = 0; i < n; i++) _rows[i]];
+    }
+
+    final matches = <int>[
+      if (barcode.length >= 12) ...?_byKey['E${barcode.substring(0, 12)}'],
+      if (barcode.length >= 11) ...?_byKey['T${barcode.substring(0, 11)}'],
+    ]..sort();
+    return [
+      ...matches.where((i) => !_complete[i]),
+      ...matches.where((i) => _complete[i]),
+    ];
+  }
+
+  void dispose() {
+    final native = _native;
+    if (native == null) return;
+    native.recipeIndexDestroy(_handle);
+    malloc.free(_barcode);
+    malloc.free(_rows);
+    _native = null;
+  }
+}
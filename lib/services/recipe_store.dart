@@ -0,0 +1,414 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+
+import '../native/pharm_native_bindings.dart';
+
+/// 처방(RxRecipe) 행을 열(column) 단위로 담는 저장소
+///
+/// 필드마다 행 번호로 접근하는 연속 배열 하나씩을 둔다. 같은 필드의 여러 키
+/// ('checked_amount'/'Checked', 'type'/'T'/'typeCode' 등)는 [load] 할 때 한
+/// 열로 합쳐지고, 문자열(약품명, 포장 바코드, 위치)은 중복 없이 한 번만 저장된다.
+/// 합계([totals])와 분리 목록([separations])은 맵을 다시 해석하지 않고 배열을
+/// 훑는다.
+///
+/// pharm_native_ffi 가 있으면 열은 네이티브 메모리이고 아래 typed list 들은
+/// 복사 없이 그 메모리를 직접 가리킨다. 없으면 같은 모양의 Dart typed list 를
+/// 쓴다. 열은 다음 [load] 전까지만 유효하다.
+class RecipeStore {
+  RecipeStore() {
+    final native = PharmNativeBindings.instance;
+    if (native != null) {
+      _native = native;
+      _handle = native.recipeStoreCreate();
+      _length = malloc<Int32>();
+      _totals = malloc<PharmRecipeTotals>();
+      _scratch = malloc<Uint8>(_scratchSize);
+    }
+  }
+
+  /// 'separate' 가 없는 행의 분리 값
+  static const int noSeparation = -999;
+
+  /// 'use' 가 없는 행의 [use] 값. 합계에는 포함, 분리 목록에는 제외된다.
+  static const int unset = 2;
+  static const int maxChecked = 32767;
+
+  // native/recipe_store.h 의 RecipeColumn 과 같은 번호
+  static const int _rxrecipeId = 0;
+  static const int _checked = 1;
+  static const int _separation = 2;
+  static const int _recipeOrder = 3;
+  static const int _total = 4;
+  static const int _dose = 5;
+  static const int _times = 6;
+  static const int _days = 7;
+  static const int _morning = 8;
+  static const int _afternoon = 9;
+  static const int _evening = 10;
+  static const int _night = 11;
+  static const int _type = 12;
+  static const int _use = 13;
+  static const int _atc = 14;
+  static const int _productName = 15;
+  static const int _packBarcode = 16;
+  static const int _location = 17;
+  static const int _columnCount = 18;
+
+  // Dart 대체 구현용 키 → (열, 순위). 순위가 낮은 키의 값이 우선한다.
+  static const Map<String, (int, int)> _fallbackFields = {
+    'rxrecipe_id': (_rxrecipeId, 0),
+    'rxRecipeID': (_rxrecipeId, 1),
+    'RxRecipeId': (_rxrecipeId, 2),
+    'checked_amount': (_checked, 0),
+    'Checked': (_checked, 1),
+    'separate': (_separation, 0),
+    'seperate': (_separation, 1),
+    'recipe_order': (_recipeOrder, 0),
+    'total': (_total, 0),
+    'Total': (_total, 1),
+    'dose': (_dose, 0),
+    '용량': (_dose, 1),
+    'times': (_times, 0),
+    '횟수': (_times, 1),
+    'days': (_days, 0),
+    '일수': (_days, 1),
+    'morning': (_morning, 0),
+    'afternoon': (_afternoon, 0),
+    'evening': (_evening, 0),
+    'night': (_night, 0),
+    'type': (_type, 0),
+    'T': (_type, 1),
+    'typeCode': (_type, 2),
+    'use': (_use, 0),
+    'is_atc': (_atc, 0),
+    'product_name': (_productName, 0),
+    '약품명': (_productName, 1),
+    'name': (_productName, 2),
+    'pack_barcode': (_packBarcode, 0),
+    'location': (_location, 0),
+  };
+
+  PharmNativeBindings? _native;
+  Pointer<PharmRecipeStore> _handle = nullptr;
+  Pointer<Int32> _length = nullptr;
+  Pointer<PharmRecipeTotals> _totals = nullptr;
+  Pointer<Uint8> _scratch = nullptr;
+  int _scratchSize = 256;
+
+  // 네이티브 키 해석 결과 (null: 보관하지 않는 필드)
+  static final Map<String, (int, int)?> _nativeFields = {};
+
+  // Dart 대체 구현의 문자열 풀 (id 0 은 빈 문자열)
+  final List<String> _strings = [''];
+  // 한 번의 load 동안 문자열 → id
+  final Map<String, int> _ids = {};
+
+  int _rows = 0;
+  Int64List rxrecipeId = Int64List(0);
+  Int32List checked = Int32List(0);
+  Int32List separation = Int32List(0);
+  Int32List recipeOrder = Int32List(0);
+  Float64List total = Float64List(0);
+  Float64List dose = Float64List(0);
+  Float64List times = Float64List(0);
+  Float64List days = Float64List(0);
+  Float64List morning = Float64List(0);
+  Float64List afternoon = Float64List(0);
+  Float64List evening = Float64List(0);
+  Float64List night = Float64List(0);
+
+  /// 한 글자 type 의 대문자 코드 ('T' = 정제, 'E' 등). 없거나 두 글자
+  /// 이상이면 0 (전체를 'T' 와 비교하므로 'TAB' 는 정제가 아니다).
+  Uint8List type = Uint8List(0);
+
+  /// 0, 1 또는 [unset]
+  Uint8List use = Uint8List(0);
+  Uint8List atc = Uint8List(0);
+
+  /// 문자열 id ([productNameOf], [packBarcodeOf] 로 읽는다)
+  Uint32List productName = Uint32List(0);
+  Uint32List packBarcode = Uint32List(0);
+  Uint32List location = Uint32List(0);
+
+  int get length => _rows;
+
+  /// RPC 결과 행 목록으로 저장소를 다시 채운다.
+  void load(List<dynamic> rows) {
+    _allocate(rows.length);
+    _ids.clear();
+    final ranks = List<int>.filled(_columnCount, 0);
+    for (var r = 0; r < rows.length; r++) {
+      final row = rows[r];
+      if (row is! Map) continue;
+      ranks.fillRange(0, _columnCount, 1 << 30);
+      row.forEach((key, value) {
+        if (value == null) return;
+        final field = _fieldFor(key.toString());
+        if (field == null) return;
+        final (column, rank) = field;
+        if (rank >= ranks[column]) return;
+        if (_set(r, column, value)) ranks[column] = rank;
+      });
+    }
+  }
+
+  String productNameOf(int row) => _string(productName[row]);
+  String packBarcodeOf(int row) => _string(packBarcode[row]);
+  String locationOf(int row) => _string(location[row]);
+
+  bool isComplete(int row) => checked[row] >= total[row];
+
+  /// checked_amount 에 [delta] 를 더한다 (0..[maxChecked]). 새 값을 반환한다.
+  int addChecked(int row, int delta) {
+    final value = (checked[row] + delta).clamp(0, maxChecked);
+    checked[row] = value;
+    return value;
+  }
+
+  /// 사용 중인 행의 아침/점심/저녁/취침 합계. [separation] 이 0 이면 전체,
+  /// 정제('T')는 1정 단위로 올림한다.
+  ({double morning, double afternoon, double evening, double night}) totals(
+      int separation) {
+    final native = _native;
+    if (native != null) {
+      native.recipeStoreTotals(_handle, separation, _totals);
+      final t = _totals.ref;
+      return (
+        morning: t.morning,
+        afternoon: t.afternoon,
+        evening: t.evening,
+        night: t.night,
+      );
+    }
+    var m = 0.0, a = 0.0, e = 0.0, n = 0.0;
+    const pill = 0x54; // 'T'
+    for (var i = 0; i < _rows; i++) {
+      if (use[i] == 0) continue;
+      if (separation != 0 && this.separation[i] != separation) continue;
+      final isPill = type[i] == pill;
+      m += isPill ? morning[i].ceilToDouble() : morning[i];
+      a += isPill ? afternoon[i].ceilToDouble() : afternoon[i];
+      e += isPill ? evening[i].ceilToDouble() : evening[i];
+      n += isPill ? night[i].ceilToDouble() : night[i];
+    }
+    return (morning: m, afternoon: a, evening: e, night: n);
+  }
+
+  /// 'use' 가 명시적으로 켜진 행들의 분리 값 (중복 없이 오름차순)
+  List<int> separations() {
+    final native = _native;
+    if (native != null) {
+      final count = native.recipeStoreSeparations(_handle, nullptr, 0);
+      if (count == 0) return [];
+      final out = malloc<Int32>(count);
+      try {
+        native.recipeStoreSeparations(_handle, out, count);
+        return out.asTypedList(count).toList();
+      } finally {
+        malloc.free(out);
+      }
+    }
+    final values = <int>{
+      for (var i = 0; i < _rows; i++)
+        if (use[i] == 1 && separation[i] != noSeparation) separation[i],
+    };
+    return values.toList()..sort();
+  }
+
+  void dispose() {
+    final native = _native;
+    if (native == null) return;
+    native.recipeStoreDestroy(_handle);
+    malloc.free(_length);
+    malloc.free(_totals);
+    malloc.free(_scratch);
+    _native = null;
+    _allocateDart(0);
+  }
+
+  void _allocate(int rows) {
+    final native = _native;
+    if (native == null) {
+      _allocateDart(rows);
+      return;
+    }
+    _attach(native.recipeStoreReset(_handle, rows));
+  }
+
+  // 네이티브 열 [rows] 개를 typed list 뷰로 연결한다.
+  void _attach(int rows) {
+    final native = _native!;
+    _rows = rows;
+    _ids.clear();
+    if (_rows == 0) {
+      _allocateDart(0);
+      return;
+    }
+    Pointer<Void> column(int c) => native.recipeStoreColumn(_handle, c);
+    rxrecipeId = column(_rxrecipeId).cast<Int64>().asTypedList(_rows);
+    checked = column(_checked).cast<Int32>().asTypedList(_rows);
+    separation = column(_separation).cast<Int32>().asTypedList(_rows);
+    recipeOrder = column(_recipeOrder).cast<Int32>().asTypedList(_rows);
+    total = column(_total).cast<Double>().asTypedList(_rows);
+    dose = column(_dose).cast<Double>().asTypedList(_rows);
+    times = column(_times).cast<Double>().asTypedList(_rows);
+    days = column(_days).cast<Double>().asTypedList(_rows);
+    morning = column(_morning).cast<Double>().asTypedList(_rows);
+    afternoon = column(_afternoon).cast<Double>().asTypedList(_rows);
+    evening = column(_evening).cast<Double>().asTypedList(_rows);
+    night = column(_night).cast<Double>().asTypedList(_rows);
+    type = column(_type).cast<Uint8>().asTypedList(_rows);
+    use = column(_use).cast<Uint8>().asTypedList(_rows);
+    atc = column(_atc).cast<Uint8>().asTypedList(_rows);
+    productName = column(_productName).cast<Uint32>().asTypedList(_rows);
+    packBarcode = column(_packBarcode).cast<Uint32>().asTypedList(_rows);
+    location = column(_location).cast<Uint32>().asTypedList(_rows);
+  }
+
+  void _allocateDart(int rows) {
+    _rows = rows;
+    _strings
+      ..clear()
+      ..add('');
+    rxrecipeId = Int64List(rows);
+    checked = Int32List(rows);
+    separation = Int32List(rows)..fillRange(0, rows, noSeparation);
+    recipeOrder = Int32List(rows);
+    total = Float64List(rows);
+    dose = Float64List(rows);
+    times = Float64List(rows);
+    days = Float64List(rows);
+    morning = Float64List(rows);
+    afternoon = Float64List(rows);
+    evening = Float64List(rows);
+    night = Float64List(rows);
+    type = Uint8List(rows);
+    use = Uint8List(rows)..fillRange(0, rows, unset);
+    atc = Uint8List(rows);
+    productName = Uint32List(rows);
+    packBarcode = Uint32List(rows);
+    location = Uint32List(rows);
+  }
+
+  (int, int)? _fieldFor(String key) {
+    final native = _native;
+    if (native == null) return _fallbackFields[key];
+    return _nativeFields.putIfAbsent(key, () {
+      final bytes = _toScratch(key);
+      final column =
+          native.recipeStoreColumnForKey(_scratch, bytes, _length);
+      return column < 0 ? null : (column, _length.value);
+    });
+  }
+
+  // 값을 열에 쓴다. 해석할 수 없는 값이면 false (다음 순위 키를 쓴다).
+  bool _set(int row, int column, dynamic value) {
+    switch (column) {
+      case _type:
+        final s = value.toString().trim().toUpperCase();
+        final c = s.length == 1 ? s.codeUnitAt(0) : 0;
+        type[row] = c < 0x80 ? c : 0;
+        return true;
+      case _use:
+      case _atc:
+        final b = _parseBool(value);
+        if (b == null) return false;
+        (column == _use ? use : atc)[row] = b ? 1 : 0;
+        return true;
+      case _productName:
+      case _packBarcode:
+      case _location:
+        final id = _intern(value.toString());
+        switch (column) {
+          case _productName:
+            productName[row] = id;
+          case _packBarcode:
+            packBarcode[row] = id;
+          default:
+            location[row] = id;
+        }
+        return true;
+    }
+    final n = _parseNum(value);
+    if (n == null || !n.isFinite) return false;
+    switch (column) {
+      case _rxrecipeId:
+        rxrecipeId[row] = n.toInt();
+      case _checked:
+        checked[row] = n.round();
+      case _separation:
+        separation[row] = n.toInt();
+      case _recipeOrder:
+        recipeOrder[row] = n.toInt();
+      case _total:
+        total[row] = n.toDouble();
+      case _dose:
+        dose[row] = n.toDouble();
+      case _times:
+        times[row] = n.toDouble();
+      case _days:
+        days[row] = n.toDouble();
+      case _morning:
+        morning[row] = n.toDouble();
+      case _afternoon:
+        afternoon[row] = n.toDouble();
+      case _evening:
+        evening[row] = n.toDouble();
+      case _night:
+        night[row] = n.toDouble();
+    }
+    return true;
+  }
+
+  int _intern(String value) {
+    if (value.isEmpty) return 0;
+    return _ids.putIfAbsent(value, () {
+      final native = _native;
+      if (native == null) {
+        _strings.add(value);
+        return _strings.length - 1;
+      }
+      final length = _toScratch(value);
+      return native.recipeStoreIntern(_handle, _scratch, length);
+    });
+  }
+
+  String _string(int id) {
+    final native = _native;
+    if (native == null) return id < _strings.length ? _strings[id] : '';
+    final bytes = native.recipeStoreString(_handle, id, _length);
+    return utf8.decode(bytes.asTypedList(_length.value), allowMalformed: true);
+  }
+
+  // UTF-8 로 _scratch 에 복사하고 바이트 수를 반환한다.
+  int _toScratch(String value) {
+    final bytes = utf8.encode(value);
+    if (bytes.length > _scratchSize) {
+      malloc.free(_scratch);
+      _scratchSize = bytes.length;
+      _scratch = malloc<Uint8>(_scratchSize);
+    }
+    _scratch.asTypedList(bytes.length).setAll(0, bytes);
+    return bytes.length;
+  }
+
+  static num? _parseNum(dynamic v) {
+    if (v is num) return v;
+    if (v is String) return num.tryParse(v.trim());
+    return null;
+  }
+
+  static bool? _parseBool(dynamic v) {
+    if (v is bool) return v;
+    if (v is num) return v != 0;
+    if (v is String) {
+      final s = v.trim().toLowerCase();
+      if (s == 'true' || s == '1') return true;
+      if (s == 'false' || s == '0') return false;
+    }
+    return null;
+  }
+}
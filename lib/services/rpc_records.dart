@@ -0,0 +1,94 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+
+import '../native/pharm_native_bindings.dart';
+
+enum _Kind { int64, boolean, string }
+
+/// 정해진 열만 쓰는 RPC 응답을 네이티브 RecordTable 로 푼다
+///
+/// rxhead 목록과 get_miss_mached_drug 는 화면이 읽는 필드가 몇 개뿐이다.
+/// 응답 본문(UTF-8 JSON)을 jsonDecode 로 통째로 풀지 않고 그 필드만 열로
+/// 읽어 맵을 만든다. 별칭 키('name', '환자명' 등)는 네이티브에서 대표 키 하나로
+/// 합쳐진다. 처방(rxrecipe) 행은 화면이 맵의 나머지 필드도 쓰므로 대상이
+/// 아니다.
+class RpcRecords {
+  RpcRecords._();
+
+  // 함수 이름 → pharm_record_table_create 의 schema 번호
+  static const Map<String, int> _schemaOf = {
+    'select_rxhead_bydate': 0,
+    'select_rxhead_by_name': 0,
+    'get_miss_mached_drug': 1,
+  };
+
+  // schema 별 열 (RxHeadColumn / MissMatchedDrugColumn 순서)
+  static const List<List<(String, _Kind)>> _columns = [
+    [
+      ('tfn', _Kind.int64),
+      ('no', _Kind.string),
+      ('pid', _Kind.string),
+      ('patient_name', _Kind.string),
+      ('patient_birth', _Kind.string),
+      ('is_complete', _Kind.boolean),
+    ],
+    [
+      ('product_name', _Kind.string),
+      ('location', _Kind.string),
+    ],
+  ];
+
+  /// [fn] 의 응답 [body] 를 행 목록으로 푼다. 대상 함수가 아니거나,
+  /// pharm_native_ffi 가 없거나, JSON 이 올바르지 않으면 null 이다.
+  static List<Map<String, dynamic>>? decode(String fn, Uint8List body) {
+    final schema = _schemaOf[fn];
+    final native = PharmNativeBindings.instance;
+    if (schema == null || native == null) return null;
+
+    final table = native.recordTableCreate(schema);
+    final json = toNativeBytes(body);
+    final length = malloc<Int32>();
+    try {
+      final rows = native.recordTableLoadJson(table, json, body.length);
+      if (rows < 0) return null;
+      if (rows == 0) return [];
+      final columns = _columns[schema];
+      final rowList = [for (var r = 0; r < rows; r++) <String, dynamic>{}];
+      for (var c = 0; c < columns.length; c++) {
+        final (key, kind) = columns[c];
+        final data = native.recordTableColumn(table, c);
+        switch (kind) {
+          case _Kind.int64:
+            final values = data.cast<Int64>().asTypedList(rows);
+            for (var r = 0; r < rows; r++) {
+              rowList[r][key] = values[r];
+            }
+          case _Kind.boolean:
+            final values = data.cast<Uint8>().asTypedList(rows);
+            for (var r = 0; r < rows; r++) {
+              rowList[r][key] = values[r] != 0;
+            }
+          case _Kind.string:
+            final ids = data.cast<Uint32>().asTypedList(rows);
+            // 같은 문자열은 id 가 같으므로 한 번만 디코딩한다.
+            final strings = <int, String>{};
+            for (var r = 0; r < rows; r++) {
+              rowList[r][key] = strings.putIfAbsent(ids[r], () {
+                final bytes = native.recordTableString(table, ids[r], length);
+                return utf8.decode(bytes.asTypedList(length.value),
+                    allowMalformed: true);
+              });
+            }
+        }
+      }
+      return rowList;
+    } finally {
+      malloc.free(length);
+      malloc.free(json);
+      native.recordTableDestroy(table);
+    }
+  }
+}
@@ -0,0 +1,121 @@
+import 'dart:convert';
+import 'dart:ffi';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart' show debugPrint;
+
+import '../native/pharm_native_bindings.dart';
+import 'local_store.dart';
+
+/// native/serial_filter.h 의 SerialState
+enum SerialState { unknown, pending, confirmed }
+
+/// 이미 처리된 포장 일련번호(pack serial) 로컬 필터
+///
+/// 처방(tfn)별·날짜별로 스캔된 일련번호를 기억해, 서버가 이미 기록한
+/// 일련번호를 다시 스캔하면 서버 왕복 없이 바로 중복으로 처리한다.
+/// 서버 응답 전(pending)인 일련번호는 서버 판단에 맡긴다.
+///
+/// pharm_native_ffi 가 있으면 serial_filter.bin 에 기록되어 재시작 후에도
+/// 당일 항목이 유지된다. 없으면 프로세스 안의 Map 을 쓴다.
+class SerialFilterService {
+  static const String _fileName = 'serial_filter.bin';
+
+  PharmNativeBindings? _native;
+  Pointer<PharmSerialFilter> _handle = nullptr;
+
+  // Dart 대체 구현: "day/scope/serial" → 상태
+  final Map<String, SerialState> _memory = {};
+
+  /// 오늘 날짜 번호 (로컬 자정 기준, epoch 이후 일수)
+  static int today() {
+    final now = DateTime.now();
+    return DateTime.utc(now.year, now.month, now.day)
+            .millisecondsSinceEpoch ~/
+        Duration.millisecondsPerDay;
+  }
+
+  /// 필터 파일을 열어 오늘 항목을 불러온다. 앱 시작 시 한 번 호출.
+  void open() {
+    final native = PharmNativeBindings.instance;
+    if (native == null || _native != null) return;
+    final path = localStorePath(_fileName).toNativeUtf8();
+    try {
+      final handle = native.serialFilterOpen(path, today());
+      if (handle == nullptr) {
+        debugPrint('[SerialFilter] 필터 파일을 열 수 없음, 메모리 필터 사용');
+        return;
+      }
+      _native = native;
+      _handle = handle;
+    } finally {
+      malloc.free(path);
+    }
+  }
+
+  SerialState lookup(int day, int scope, String serial) {
+    if (serial.isEmpty) return SerialState.unknown;
+    final native = _native;
+    if (native == null) {
+      return _memory['$day/$scope/$serial'] ?? SerialState.unknown;
+    }
+    final bytes = utf8.encode(serial);
+    final ptr = toNativeBytes(bytes);
+    try {
+      return SerialState.values[
+          native.serialFilterLookup(_handle, day, scope, ptr, bytes.length)];
+    } finally {
+      malloc.free(ptr);
+    }
+  }
+
+  /// 상태를 올린다 (pending → confirmed). 내려가지는 않는다.
+  void record(int day, int scope, String serial, SerialState state) {
+    if (serial.isEmpty || state == SerialState.unknown) return;
+    final native = _native;
+    if (native == null) {
+      final key = '$day/$scope/$serial';
+      final current = _memory[key] ?? SerialState.unknown;
+      if (state.index > current.index) _memory[key] = state;
+      return;
+    }
+    final bytes = utf8.encode(serial);
+    final ptr = toNativeBytes(bytes);
+    try {
+      native.serialFilterRecord(
+          _handle, day, scope, ptr, bytes.length, state.index);
+    } finally {
+      malloc.free(ptr);
+    }
+  }
+
+  /// 조회/적중 카운터
+  Map<String, int> stats() {
+    final native = _native;
+    if (native == null) {
+      return {'entries': _memory.length};
+    }
+    final out = calloc<PharmSerialFilterStats>();
+    try {
+      native.serialFilterStats(_handle, out);
+      final s = out.ref;
+      return {
+        'lookups': s.lookups,
+        'bloomNegatives': s.bloomNegatives,
+        'pendingHits': s.pendingHits,
+        'confirmedHits': s.confirmedHits,
+        'entries': s.entries,
+        'loaded': s.loaded,
+      };
+    } finally {
+      calloc.free(out);
+    }
+  }
+
+  void dispose() {
+    final native = _native;
+    if (native == null) return;
+    native.serialFilterClose(_handle);
+    _native = null;
+  }
+}
@@ -0,0 +1,128 @@
+import 'dart:async';
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+/// 여러 스캐너(핸드 스캐너, 고정형 스캐너, ATC 라인 등)를 한 번에 연결
+///
+/// 네이티브의 단일 reactor 스레드가 모든 포트를 읽고, 완성된 라인을
+/// 포트 id 와 함께 이벤트로 보낸다. 기존 [ComPortService] 의 단일 포트는
+/// 그대로 두고, 추가 스캐너만 여기서 연다. 지원하지 않는 플랫폼에서는
+/// 아무것도 하지 않는다.
+class SerialPortsService {
+  static const platform = MethodChannel('pharm_parrot/serial');
+  static const events = EventChannel('pharm_parrot/serial/events');
+
+  SerialPortsService({this.onLine});
+
+  /// 수신된 라인 (포트 id, 앞뒤 공백 제거된 내용, 스캔 추적 id 또는 0)
+  final void Function(int port, String line, int scanId)? onLine;
+
+  StreamSubscription<dynamic>? _subscription;
+
+  /// 포트 [id] 를 연다. 같은 id 의 포트는 교체된다.
+  /// [reopen] 이면 장치가 빠졌다 다시 꽂혀도 1초마다 다시 연다.
+  Future<bool> openPort(
+    int id, {
+    String? devicePath,
+    int? portNumber,
+    int baudRate = 9600,
+    String? terminator,
+    String? prefix,
+    bool reopen = true,
+  }) async {
+    _startListening();
+    try {
+      final result = await platform.invokeMethod('openPort', {
+        'id': id,
+        if (devicePath != null) 'devicePath': devicePath,
+        if (portNumber != null) 'portNumber': portNumber,
+        'baudRate': baudRate,
+        if (terminator != null) 'terminator': terminator,
+        if (prefix != null) 'prefix': prefix,
+        'reopen': reopen,
+      });
+      return result == true;
+    } on PlatformException catch (e) {
+      debugPrint('스캐너 포트 $id 연결 오류: ${e.message}');
+    } on MissingPluginException {
+      // 다중 포트를 지원하지 않는 플랫폼
+    }
+    return false;
+  }
+
+  Future<void> closePort(int id) async {
+    try {
+      await platform.invokeMethod('closePort', {'id': id});
+    } on PlatformException catch (e) {
+      debugPrint('스캐너 포트 $id 해제 오류: ${e.message}');
+    } on MissingPluginException {
+      // 다중 포트를 지원하지 않는 플랫폼
+    }
+  }
+
+  Future<bool> write(int id, String data) async {
+    try {
+      return await platform.invokeMethod('writePort', {
+            'id': id,
+            'data': data,
+          }) ==
+          true;
+    } on PlatformException catch (e) {
+      debugPrint('스캐너 포트 $id 전송 오류: ${e.message}');
+    } on MissingPluginException {
+      // 다중 포트를 지원하지 않는 플랫폼
+    }
+    return false;
+  }
+
+  /// 포트별 설정과 통계 (open, lines, dropped, hangups, reopens 등)
+  Future<List<Map<String, dynamic>>> listPorts() async {
+    try {
+      final ports = await platform.invokeMethod('listPorts') as List;
+      return [for (final p in ports) Map<String, dynamic>.from(p as Map)];
+    } on PlatformException catch (e) {
+      debugPrint('스캐너 포트 목록 조회 오류: ${e.message}');
+    } on MissingPluginException {
+      // 다중 포트를 지원하지 않는 플랫폼
+    }
+    return const [];
+  }
+
+  /// 모든 포트가 함께 쓰는 라인 큐의 통계
+  Future<Map<String, dynamic>> getQueueStats() async {
+    try {
+      final stats = await platform.invokeMethod('getStats');
+      return Map<String, dynamic>.from(stats as Map);
+    } on PlatformException catch (e) {
+      debugPrint('스캐너 큐 통계 조회 오류: ${e.message}');
+    } on MissingPluginException {
+      // 다중 포트를 지원하지 않는 플랫폼
+    }
+    return {};
+  }
+
+  void _startListening() {
+    _subscription ??= events.receiveBroadcastStream().listen(
+      (event) {
+        if (event is! List) return;
+        for (final entry in event) {
+          if (entry is! Map) continue;
+          final line = entry['line']?.toString().trim() ?? '';
+          if (line.isEmpty) continue;
+          onLine?.call(
+              entry['port'] as int, line, entry['scanId'] as int? ?? 0);
+        }
+      },
+      onError: (e) => debugPrint('스캐너 포트 읽기 오류: $e'),
+    );
+  }
+
+  /// 여러 포트를 닫고 구독을 끝낸다.
+  Future<void> dispose(Iterable<int> ids) async {
+    await _subscription?.cancel();
+    _subscription = null;
+    for (final id in ids) {
+      await closePort(id);
+    }
+  }
+}
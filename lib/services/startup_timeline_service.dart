@@ -0,0 +1,40 @@
+import 'package:flutter/foundation.dart' show kIsWeb, debugPrint;
+import 'package:flutter/services.dart';
+
+/// 앱 시작 단계 기록
+///
+/// 네이티브 러너가 프로세스 시작부터 `main`, `activate`, `view_created`,
+/// `first_frame` 등을 기록하고, Dart 쪽 단계(`dart_main`, `supabase_ready`,
+/// `first_data` 등)는 [mark]로 같은 타임라인에 더한다. 시간은 프로세스
+/// 시작부터의 마이크로초이며, 같은 이름은 처음 기록만 남는다.
+class StartupTimelineService {
+  static const MethodChannel _channel = MethodChannel('pharm_parrot/startup');
+
+  /// 응답을 기다리지 않는다. 기록이 시작을 늦추면 안 되기 때문.
+  static void mark(String name) {
+    if (kIsWeb) return;
+    _channel.invokeMethod('mark', {'name': name}).catchError((Object e) {
+      if (e is PlatformException) {
+        debugPrint('[Startup] 단계 기록 오류: ${e.message}');
+      }
+      // MissingPluginException: 타임라인이 없는 플랫폼
+      return null;
+    });
+  }
+
+  /// 지금까지의 단계. `{processStart, marks: [{name, us}]}`
+  ///
+  /// `processStart`가 false면 프로세스 시작 시각을 몰라 러너 시작부터 잰 값이다.
+  static Future<Map<String, dynamic>> timeline() async {
+    if (kIsWeb) return {};
+    try {
+      final result = await _channel.invokeMethod('getTimeline');
+      return Map<String, dynamic>.from(result as Map);
+    } on PlatformException catch (e) {
+      debugPrint('[Startup] 타임라인 조회 오류: ${e.message}');
+    } on MissingPluginException {
+      // 타임라인이 없는 플랫폼
+    }
+    return {};
+  }
+}
@@ -1,11 +1,290 @@
-﻿import 'package:supabase_flutter/supabase_flutter.dart';
+﻿import 'dart:async';
+import 'dart:convert';
+import 'dart:io' show SocketException;
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart'
+    show kIsWeb, debugPrint, visibleForTesting;
+import 'package:flutter/services.dart';
+import 'package:http/http.dart' show ClientException;
+import 'package:supabase_flutter/supabase_flutter.dart';
+
+import '../config.dart';
+import 'metrics_service.dart';
+import 'rpc_records.dart';
+
+/// RPC 함수별 전송 정책
+///
+/// 읽기는 같은 인자로 동시에 들어온 호출을 한 번의 요청으로 묶고(coalesce)
+/// 일시적인 실패에 다시 시도한다. 쓰기는 두 번 실행되면 안 되므로 묶지도
+/// 다시 보내지도, 다른 요청과 한 연결에 겹쳐 보내지도(pipelining) 않는다.
+/// 보낸 쓰기가 응답 없이 끝나면 [RpcOutcomeUnknown] 을 던진다.
+class RpcPolicy {
+  final Duration timeout;
+  final int retries;
+  final bool coalesce;
+
+  /// 두 번 실행되어도 결과가 같다 (읽기)
+  final bool idempotent;
+
+  const RpcPolicy({
+    required this.timeout,
+    this.retries = 0,
+    this.coalesce = false,
+    this.idempotent = false,
+  });
+
+  static const read = RpcPolicy(
+    timeout: Duration(seconds: 8),
+    retries: 2,
+    coalesce: true,
+    idempotent: true,
+  );
+  static const write = RpcPolicy(timeout: Duration(seconds: 10));
+
+  Map<String, dynamic> toMap() => {
+        'timeoutMs': timeout.inMilliseconds,
+        'retries': retries,
+        'coalesce': coalesce,
+        'idempotent': idempotent,
+      };
+}
+
+/// 쓰기 요청을 보냈지만 결과를 알 수 없다 (시간 초과, 응답 전 연결 끊김,
+/// 읽을 수 없는 응답). 서버에서 실행되었을 수도 있으므로 그대로 다시 보내면
+/// 안 된다.
+class RpcOutcomeUnknown implements Exception {
+  const RpcOutcomeUnknown(this.function, this.message);
+  final String function;
+  final String message;
+
+  @override
+  String toString() => 'RpcOutcomeUnknown: $function: $message';
+}
 
 class SupabaseService {
   final SupabaseClient client;
   SupabaseService(this.client);
 
-  Future<dynamic> rpc(String fn, Map<String, dynamic> params) async {
-    final res = await client.rpc(fn, params: params);
-    return res; // can be List or Map or primitive depending on function
+  static const MethodChannel _channel = MethodChannel('pharm_parrot/rpc');
+
+  /// 앱이 부르는 RPC 함수와 정책. 목록에 없는 함수는 쓰기로 취급한다.
+  static const Map<String, RpcPolicy> policies = {
+    'select_rxhead_bydate': RpcPolicy.read,
+    'select_rxhead_by_name': RpcPolicy.read,
+    'select_rxhead_by_patient_number': RpcPolicy.read,
+    'select_rxrecipe_by_textfile_number': RpcPolicy.read,
+    'get_unit_from_pack_barcode': RpcPolicy.read,
+    'get_product_id_by_pack_barcode': RpcPolicy.read,
+    'get_miss_mached_drug': RpcPolicy.read,
+    'update_checked_amount_and_packserial': RpcPolicy.write,
+    'update_rxhead_complete': RpcPolicy.write,
+    'update_patientdrug_by_id': RpcPolicy.write,
+    'insert_patientdrug': RpcPolicy.write,
+    'update_product_is_atc': RpcPolicy.write,
+    'update_product_location_by_pack_barcode': RpcPolicy.write,
+  };
+
+  static const _retryBackoff = Duration(milliseconds: 200);
+
+  // 연결 거부의 errno (Linux, macOS, Windows)
+  static const Set<int> _connectRefused = {111, 61, 10061, 1225};
+
+  // 게이트웨이가 요청을 보내기 전에 끝낸 호출의 오류 코드
+  static const Set<String> _notSentCodes = {
+    'RPC_FAILED', 'NOT_CONFIGURED', 'INVALID_ARGUMENT',
+  };
+
+  // 이보다 큰 응답 본문은 백그라운드 isolate 에서 JSON 을 푼다.
+  static const int _inlineDecodeBytes = 16 * 1024;
+
+  // 응답을 기다리는 읽기 호출 (함수 이름 + 인자 JSON 기준)
+  static final Map<String, Future<dynamic>> _inFlight = {};
+
+  // 네이티브 게이트웨이 설정 결과. null이면 아직 시도하지 않았다.
+  static Future<bool>? _gateway;
+
+  Future<dynamic> rpc(String fn, Map<String, dynamic> params) {
+    final policy = policies[fn] ?? RpcPolicy.write;
+    if (!policy.coalesce) return _timedSend(fn, params, policy);
+    final key = '$fn\n${jsonEncode(params)}';
+    final pending = _inFlight[key];
+    if (pending != null) return pending;
+    final future = _timedSend(fn, params, policy)
+        .whenComplete(() => _inFlight.remove(key));
+    _inFlight[key] = future;
+    return future;
+  }
+
+  /// 함수별 지연(pharm_rpc_seconds)과 오류 수. 묶인 호출은 한 번만 센다.
+  Future<dynamic> _timedSend(
+      String fn, Map<String, dynamic> params, RpcPolicy policy) async {
+    final begin = MetricsService.nowUs();
+    try {
+      return await _send(fn, params, policy);
+    } catch (_) {
+      MetricsService.count('pharm_rpc_errors_total',
+          label: 'function',
+          value: fn,
+          help: 'RPC calls that ended in an error');
+      rethrow;
+    } finally {
+      MetricsService.observeSince('pharm_rpc_seconds', begin,
+          label: 'function',
+          value: fn,
+          help: 'RPC call to its result, retries included');
+    }
+  }
+
+  Future<dynamic> _send(
+      String fn, Map<String, dynamic> params, RpcPolicy policy) async {
+    if (await _gatewayReady()) {
+      try {
+        return await _viaGateway(fn, params, policy);
+      } on MissingPluginException {
+        _gateway = Future.value(false);
+      }
+    }
+    for (var attempt = 0;; attempt++) {
+      try {
+        // can be List or Map or primitive depending on function
+        return await client.rpc(fn, params: params).timeout(policy.timeout);
+      } on PostgrestException {
+        rethrow; // 서버가 답한 오류는 다시 보내도 같다
+      } catch (e) {
+        // 시간 초과나 연결 끊김이면 요청은 이미 서버에 닿았을 수 있다.
+        if (!policy.idempotent && !failedBeforeSending(e)) {
+          throw RpcOutcomeUnknown(fn, _describe(e));
+        }
+        if (attempt >= policy.retries) rethrow;
+        debugPrint('[RPC] $fn 재시도 ${attempt + 1}: $e');
+        await Future.delayed(_retryBackoff * (attempt + 1));
+      }
+    }
   }
+
+  /// [error] 가 요청을 보내기 전에 난 실패인지: 연결 거부, 이름 풀이 실패,
+  /// 게이트웨이의 RPC_FAILED 등. 그 밖의 실패 뒤에는 쓰기가 서버에서 실행되었을
+  /// 수 있어 [RpcOutcomeUnknown] 으로 알린다.
+  @visibleForTesting
+  static bool failedBeforeSending(Object error) {
+    if (error is PlatformException) return _notSentCodes.contains(error.code);
+    if (error is SocketException) {
+      final code = error.osError?.errorCode;
+      if (code != null && _connectRefused.contains(code)) return true;
+    }
+    // ClientException 은 원인(SocketException)을 메시지로만 전한다.
+    if (error is SocketException || error is ClientException) {
+      final text = error.toString();
+      return text.contains('Connection refused') ||
+          text.contains('Failed host lookup');
+    }
+    return false;
+  }
+
+  static String _describe(Object error) => switch (error) {
+        TimeoutException(:final message) => message ?? 'timeout',
+        PlatformException(:final code, :final message) => message ?? code,
+        _ => '$error',
+      };
+
+  /// RPC_GATEWAY_URL이 평문 http일 때만 네이티브 게이트웨이를 쓴다.
+  /// 게이트웨이에는 TLS가 없으므로 https 주소는 Supabase 클라이언트로 간다.
+  static Future<bool> _gatewayReady() {
+    return _gateway ??= () async {
+      if (kIsWeb || AppConfig.rpcGatewayUrl.isEmpty) return false;
+      final uri = Uri.tryParse(AppConfig.rpcGatewayUrl);
+      if (uri == null || uri.scheme != 'http') return false;
+      final base = uri.path.endsWith('/')
+          ? uri.path.substring(0, uri.path.length - 1)
+          : uri.path;
+      try {
+        await _channel.invokeMethod('configure', {
+          'host': uri.host,
+          'port': uri.hasPort ? uri.port : 80,
+          'pathPrefix': '$base/rest/v1/rpc/',
+          'headers': {
+            'apikey': AppConfig.supabaseAnonKey,
+            'Authorization': 'Bearer ${AppConfig.supabaseAnonKey}',
+          },
+          'policies': {
+            for (final e in policies.entries) e.key: e.value.toMap(),
+          },
+        });
+        return true;
+      } on PlatformException catch (e) {
+        debugPrint('[RPC] 게이트웨이 설정 오류: ${e.message}');
+      } on MissingPluginException {
+        // 게이트웨이가 없는 플랫폼
+      }
+      return false;
+    }();
+  }
+
+  Future<dynamic> _viaGateway(
+      String fn, Map<String, dynamic> params, RpcPolicy policy) async {
+    final Map result;
+    try {
+      result = await _channel.invokeMethod('call', {
+        'function': fn,
+        'body': jsonEncode(params),
+      }) as Map;
+    } on PlatformException catch (e) {
+      // 응답을 받지 못했다. RPC_FAILED 등이 아니면 요청은 나갔을 수 있다.
+      if (!policy.idempotent && !failedBeforeSending(e)) {
+        throw RpcOutcomeUnknown(fn, _describe(e));
+      }
+      throw TimeoutException('RPC $fn: ${e.message}');
+    }
+    return decodeReply(
+        fn, policy, result['status'] as int, result['body'] as Uint8List);
+  }
+
+  /// 게이트웨이가 받은 HTTP 응답을 결과로 바꾼다.
+  ///
+  /// 4xx/5xx 는 [PostgrestException] 이다. 쓰기의 1xx/3xx 응답과 2xx 인데
+  /// 읽을 수 없는 본문은 서버에서 실행되었는지 알 수 없으므로
+  /// [RpcOutcomeUnknown] 이다. 다시 보내도 되는 실패로 끝나지 않는다.
+  @visibleForTesting
+  static Future<dynamic> decodeReply(
+      String fn, RpcPolicy policy, int status, Uint8List body) async {
+    final success = status >= 200 && status < 300;
+    if (!success && (status >= 400 || policy.idempotent)) {
+      final text = utf8.decode(body, allowMalformed: true);
+      Object? decoded;
+      try {
+        decoded = text.isEmpty ? null : jsonDecode(text);
+      } on FormatException {
+        decoded = null; // 프록시의 HTML 오류 페이지 등
+      }
+      final error = decoded is Map ? decoded : const {};
+      throw PostgrestException(
+        message: (error['message'] ?? text).toString(),
+        code: (error['code'] ?? '$status').toString(),
+        details: error['details'],
+        hint: error['hint']?.toString(),
+      );
+    }
+    if (!success) throw RpcOutcomeUnknown(fn, 'HTTP $status');
+    try {
+      return await _decodeBody(fn, body);
+    } catch (e) {
+      // 2xx 이므로 쓰기는 실행되었을 것이지만 결과를 읽지 못했다.
+      if (policy.idempotent) rethrow;
+      throw RpcOutcomeUnknown(fn, 'unreadable reply: $e');
+    }
+  }
+
+  // 큰 응답(처방 목록 등)은 UI isolate 를 멈추지 않게 따로 푼다.
+  static Future<dynamic> _decodeBody(String fn, Uint8List body) async {
+    if (body.isEmpty) return null;
+    if (body.length < _inlineDecodeBytes) return _decode(fn, body);
+    return Isolate.run(() => _decode(fn, body));
+  }
+
+  // rxhead 등 열이 정해진 응답은 네이티브 디코더로, 나머지는 jsonDecode 로.
+  static dynamic _decode(String fn, Uint8List body) =>
+      RpcRecords.decode(fn, body) ??
+      jsonDecode(utf8.decode(body, allowMalformed: true));
 }
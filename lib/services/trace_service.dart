@@ -0,0 +1,129 @@
+import 'dart:convert';
+import 'dart:ffi';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart' show kIsWeb, debugPrint;
+import 'package:flutter/services.dart';
+
+import '../native/pharm_native_bindings.dart';
+import 'local_store.dart';
+
+/// 스캔 한 건의 구간별 시간 기록 (Chrome/Perfetto trace JSON)
+///
+/// "스캐너가 느리다"를 구간으로 나눠 본다. 러너가 첫 시리얼 바이트부터
+/// 라인 완성(`serial.frame`)과 채널 전달 대기(`comport.queue`)를 기록하고,
+/// Dart 는 같은 scan id 로 단위 조회, 매칭, beep/TTS, 저널 기록, 화면 반영을
+/// [record]/[span] 으로 더한다. [dump] 는 둘을 합쳐 chrome://tracing 이나
+/// ui.perfetto.dev 에서 여는 파일로 쓴다.
+///
+/// 기록은 스레드별 네이티브 링에 쌓이고(잠금 없음), 꺼져 있으면 [now] 와
+/// [record] 는 즉시 돌아온다. 러너는 PHARM_TRACE=1 이면 켜진 채로 시작한다.
+class TraceService {
+  static const MethodChannel _channel = MethodChannel('pharm_parrot/trace');
+
+  static bool _enabled = false;
+  static Pointer<Uint8> _name = nullptr;
+  static const int _maxNameBytes = 39;
+
+  static bool get enabled => _enabled;
+
+  /// 러너의 현재 상태를 따른다. 앱 시작 시 한 번 부른다.
+  static Future<void> init() async {
+    if (kIsWeb) return;
+    try {
+      final on = await _channel.invokeMethod('isEnabled');
+      if (on == true) _enable(true);
+    } on PlatformException catch (e) {
+      debugPrint('[Trace] 상태 조회 오류: ${e.message}');
+    } on MissingPluginException {
+      // 러너 쪽 기록이 없는 플랫폼: Dart 구간만 기록한다.
+    }
+  }
+
+  static Future<void> setEnabled(bool on) async {
+    _enable(on);
+    if (kIsWeb) return;
+    try {
+      await _channel.invokeMethod('setEnabled', {'enabled': on});
+    } on PlatformException catch (e) {
+      debugPrint('[Trace] 설정 오류: ${e.message}');
+    } on MissingPluginException {
+      // 러너 쪽 기록이 없는 플랫폼
+    }
+  }
+
+  static void _enable(bool on) {
+    final native = PharmNativeBindings.instance;
+    if (native == null) return;
+    if (_name == nullptr) {
+      _name = malloc<Uint8>(_maxNameBytes);
+      final thread = utf8.encode('dart:ui');
+      _name.asTypedList(thread.length).setAll(0, thread);
+      native.traceSetThreadName(_name, thread.length);
+    }
+    native.traceSetEnabled(on ? 1 : 0);
+    _enabled = on;
+  }
+
+  /// 러너와 같은 단조 시계(ns). 꺼져 있으면 0.
+  static int now() =>
+      _enabled ? PharmNativeBindings.instance!.traceNowNs() : 0;
+
+  /// 새 스캔 id. 꺼져 있으면 0.
+  static int newScan() =>
+      _enabled ? PharmNativeBindings.instance!.traceNextScanId() : 0;
+
+  /// [beginNs] 부터 지금(또는 [endNs])까지의 구간을 기록한다.
+  static void record(String name, int scanId, int beginNs, [int? endNs]) {
+    if (!_enabled || beginNs == 0) return;
+    final native = PharmNativeBindings.instance!;
+    final end = endNs ?? native.traceNowNs();
+    final bytes = name.codeUnits;
+    final n = bytes.length < _maxNameBytes ? bytes.length : _maxNameBytes;
+    _name.asTypedList(n).setAll(0, bytes.take(n));
+    native.traceRecord(_name, n, scanId, beginNs, end);
+  }
+
+  /// [body] 가 끝날 때까지를 [name] 구간으로 기록한다.
+  static Future<T> span<T>(
+      String name, int scanId, Future<T> Function() body) async {
+    final begin = now();
+    try {
+      return await body();
+    } finally {
+      record(name, scanId, begin);
+    }
+  }
+
+  static void clear() {
+    PharmNativeBindings.instance?.traceClear();
+    _channel.invokeMethod('clear').catchError((Object e) => null);
+  }
+
+  /// 러너와 Dart 의 구간을 합쳐 [path] (기본: 로컬 저장소의
+  /// scan_trace.json) 에 쓰고, 쓴 경로를 돌려준다. 실패하면 null.
+  static Future<String?> dump([String? path]) async {
+    final native = PharmNativeBindings.instance;
+    if (native == null) return null;
+    String runnerEvents = '';
+    try {
+      runnerEvents = (await _channel.invokeMethod('events')) as String? ?? '';
+    } on PlatformException catch (e) {
+      debugPrint('[Trace] 러너 구간 조회 오류: ${e.message}');
+    } on MissingPluginException {
+      // 러너 쪽 기록이 없는 플랫폼
+    }
+    final target = path ?? localStorePath('scan_trace.json');
+    final extra = utf8.encode(runnerEvents);
+    final pathPtr = target.toNativeUtf8();
+    final extraPtr = toNativeBytes(extra);
+    try {
+      return native.traceWrite(pathPtr, extraPtr, extra.length) == 1
+          ? target
+          : null;
+    } finally {
+      malloc.free(pathPtr);
+      malloc.free(extraPtr);
+    }
+  }
+}
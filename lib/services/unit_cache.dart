@@ -0,0 +1,178 @@
+import 'dart:async';
+import 'dart:ffi';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter/foundation.dart' show debugPrint;
+
+import '../native/pharm_native_bindings.dart';
+import 'local_store.dart';
+
+/// get_unit_from_pack_barcode 결과(포장 단위) 로컬 캐시
+///
+/// 포장 단위는 거의 바뀌지 않으므로 스캔마다 서버를 기다리지 않는다.
+/// - 적중: 캐시 값을 즉시 반환
+/// - 만료(TTL 경과 또는 세대 변경): 캐시 값을 즉시 반환하고 백그라운드로 갱신
+/// - 미스: 서버 조회 후 저장
+///
+/// pharm_native_ffi 가 있으면 재시작 후에도 남는 메모리 매핑 파일
+/// (unit_cache.bin)을, 없으면 프로세스 안의 Map 을 쓴다.
+class UnitCacheService {
+  UnitCacheService(this._fetch);
+
+  /// 서버 조회. 단위를 알 수 없으면 null.
+  final Future<num?> Function(String barcode) _fetch;
+
+  static const String _fileName = 'unit_cache.bin';
+  static const int _initialCapacity = 4096;
+  static const Duration ttl = Duration(days: 7);
+
+  /// 단위 의미가 바뀌면 올린다. 이전 세대 항목은 모두 만료로 취급된다.
+  static const int generation = 1;
+
+  static const int _maxBarcodeLength = 32;
+
+  PharmNativeBindings? _native;
+  Pointer<PharmUnitCache> _handle = nullptr;
+  Pointer<Uint8> _barcode = nullptr;
+  Pointer<Double> _unit = nullptr;
+
+  // Dart 대체 구현: 바코드 → (단위, 조회 시각)
+  final Map<String, (num, DateTime)> _memory = {};
+  int _hits = 0, _misses = 0, _stale = 0;
+
+  // 같은 바코드의 서버 조회는 한 번만
+  final Map<String, Future<num?>> _inFlight = {};
+
+  /// 캐시 파일을 매핑하고 미리 읽어 둔다. 앱 시작 시 한 번 호출.
+  void open() {
+    final native = PharmNativeBindings.instance;
+    if (native == null || _native != null) return;
+    final path = localStorePath(_fileName).toNativeUtf8();
+    try {
+      final handle =
+          native.unitCacheOpen(path, _initialCapacity, ttl.inMilliseconds);
+      if (handle == nullptr) {
+        debugPrint('[UnitCache] 캐시 파일을 열 수 없음, 메모리 캐시 사용');
+        return;
+      }
+      native.unitCacheSetGeneration(handle, generation);
+      _native = native;
+      _handle = handle;
+      _barcode = malloc<Uint8>(_maxBarcodeLength);
+      _unit = malloc<Double>();
+    } finally {
+      malloc.free(path);
+    }
+  }
+
+  /// [barcode] 의 포장 단위. 캐시에 없고 서버도 실패하면 1.
+  Future<num> unitFor(String barcode) async {
+    final (status, cached) = _lookup(barcode);
+    if (cached == null) {
+      return await _refresh(barcode) ?? 1;
+    }
+    if (status == _Status.stale) {
+      unawaited(_refresh(barcode));
+    }
+    return cached;
+  }
+
+  Future<num?> _refresh(String barcode) {
+    return _inFlight[barcode] ??= () async {
+      try {
+        final unit = await _fetch(barcode);
+        if (unit != null) _put(barcode, unit);
+        return unit;
+      } catch (e) {
+        debugPrint('[UnitCache] 단위 조회 실패 ($barcode): $e');
+        return null;
+      } finally {
+        _inFlight.remove(barcode);
+      }
+    }();
+  }
+
+  (_Status, num?) _lookup(String barcode) {
+    final now = DateTime.now();
+    final native = _native;
+    if (native != null && barcode.length <= _maxBarcodeLength) {
+      final length = _copyBarcode(barcode);
+      final status = native.unitCacheLookup(
+          _handle, _barcode, length, now.millisecondsSinceEpoch, _unit);
+      if (status == 0) return (_Status.miss, null);
+      return (status == 1 ? _Status.hit : _Status.stale, _unit.value);
+    }
+
+    final entry = _memory[barcode];
+    if (entry == null) {
+      _misses++;
+      return (_Status.miss, null);
+    }
+    if (now.difference(entry.$2) > ttl) {
+      _stale++;
+      return (_Status.stale, entry.$1);
+    }
+    _hits++;
+    return (_Status.hit, entry.$1);
+  }
+
+  void _put(String barcode, num unit) {
+    final now = DateTime.now();
+    final native = _native;
+    if (native != null && barcode.length <= _maxBarcodeLength) {
+      final length = _copyBarcode(barcode);
+      native.unitCachePut(_handle, _barcode, length, unit.toDouble(),
+          now.millisecondsSinceEpoch);
+      return;
+    }
+    _memory[barcode] = (unit, now);
+  }
+
+  int _copyBarcode(String barcode) {
+    final units = barcode.codeUnits;
+    for (var i = 0; i < units.length; i++) {
+      _barcode[i] = units[i] & 0xFF;
+    }
+    return units.length;
+  }
+
+  /// 적중/미스/만료 카운터
+  Map<String, int> stats() {
+    final native = _native;
+    if (native == null) {
+      return {
+        'hits': _hits,
+        'misses': _misses,
+        'stale': _stale,
+        'entries': _memory.length,
+      };
+    }
+    final out = calloc<PharmUnitCacheStats>();
+    try {
+      native.unitCacheStats(_handle, out);
+      final s = out.ref;
+      return {
+        'hits': s.hits,
+        'misses': s.misses,
+        'stale': s.stale,
+        'puts': s.puts,
+        'entries': s.entries,
+        'capacity': s.capacity,
+        'generation': s.generation,
+      };
+    } finally {
+      calloc.free(out);
+    }
+  }
+
+  void dispose() {
+    final native = _native;
+    if (native == null) return;
+    native.unitCacheClose(_handle);
+    malloc.free(_barcode);
+    malloc.free(_unit);
+    _native = null;
+  }
+}
+
+enum _Status { miss, hit, stale }
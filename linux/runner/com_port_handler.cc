@@ -0,0 +1,127 @@
+#include "com_port_handler.h"
+
+#include <glib-unix.h>
+
+#include <string_view>
+
+#include "native/trace_recorder.h"
+
+namespace {
+
+// Default line queue size: far more than a burst of tray scans.
+constexpr size_t kDefaultQueueCapacity = 256;
+
+}  // namespace
+
+ComPortHandler::ComPortHandler()
+    : watch_id_(0),
+      queue_capacity_(kDefaultQueueCapacity),
+      overflow_policy_(OverflowPolicy::kDropOldest),
+      frame_begin_ns_(0) {
+  ResetQueue();
+}
+
+ComPortHandler::~ComPortHandler() { CloseComPort(); }
+
+bool ComPortHandler::OpenComPort(int port_number, int baud_rate) {
+  return OpenDevice(SerialDevicePathForPort(port_number), baud_rate);
+}
+
+bool ComPortHandler::OpenDevice(const std::string& device_path,
+                                int baud_rate) {
+  if (IsOpen()) {
+    CloseComPort();
+  }
+
+  if (!port_.Open(device_path, baud_rate)) {
+    g_warning("Failed to open serial port %s", device_path.c_str());
+    return false;
+  }
+  ResetQueue();
+
+  // Start watching the port on the main loop
+  watch_id_ = g_unix_fd_add(port_.fd(),
+                            static_cast<GIOCondition>(G_IO_IN | G_IO_HUP |
+                                                      G_IO_ERR),
+                            &ComPortHandler::OnPortReadable, this);
+  return true;
+}
+
+void ComPortHandler::CloseComPort() {
+  if (watch_id_ != 0) {
+    g_source_remove(watch_id_);
+    watch_id_ = 0;
+  }
+  port_.Close();
+}
+
+bool ComPortHandler::WriteData(const std::string& data) {
+  return port_.WriteData(data);
+}
+
+std::string ComPortHandler::GetLineData() {
+  ComPortLine line;
+  if (!PopLine(&line)) {
+    return "";
+  }
+  return std::move(line.text);
+}
+
+bool ComPortHandler::PopLine(ComPortLine* line) {
+  return line_ring_->Pop(line);
+}
+
+void ComPortHandler::SetQueueOptions(size_t capacity, OverflowPolicy policy) {
+  queue_capacity_ = capacity > 0 ? capacity : kDefaultQueueCapacity;
+  overflow_policy_ = policy;
+}
+
+void ComPortHandler::ResetQueue() {
+  line_ring_ = std::make_unique<SpscRing<ComPortLine>>(
+      queue_capacity_, overflow_policy_, std::chrono::milliseconds(0));
+}
+
+gboolean ComPortHandler::OnPortReadable(gint fd, GIOCondition condition,
+                                        gpointer user_data) {
+  ComPortHandler* self = static_cast<ComPortHandler*>(user_data);
+
+  // A line's bytes may span several wake-ups; its first one starts the
+  // scan. Lines completed by the same read start with that read.
+  TraceRecorder& trace = ProcessTraceRecorder();
+  const int64_t woke_ns = trace.enabled() ? TraceRecorder::NowNs() : 0;
+  if (self->frame_begin_ns_ == 0) {
+    self->frame_begin_ns_ = woke_ns;
+  }
+
+  bool queued = false;
+  bool alive = self->port_.ReadFrames(
+      [self, &trace, &queued, woke_ns](std::string_view text) {
+        ComPortLine line;
+        line.text.assign(text.data(), text.size());
+        if (self->frame_begin_ns_ != 0) {
+          line.scan_id = TraceRecorder::NextScanId();
+          line.framed_ns = TraceRecorder::NowNs();
+          trace.Record("serial.frame", line.scan_id, self->frame_begin_ns_,
+                       line.framed_ns);
+          self->frame_begin_ns_ = woke_ns;
+        }
+        self->line_ring_->Push(std::move(line));
+        queued = true;
+      });
+  if (queued) {
+    // A partial line left over is timed from the next read, slightly short
+    self->frame_begin_ns_ = 0;
+  }
+  if (queued && self->data_available_callback_) {
+    self->data_available_callback_();
+  }
+
+  if (!alive) {
+    // Scanner unplugged; returning FALSE removes this watch.
+    g_warning("Serial port closed by device");
+    self->watch_id_ = 0;
+    self->port_.Close();
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
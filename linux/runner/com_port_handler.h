@@ -0,0 +1,95 @@
+#ifndef RUNNER_COM_PORT_HANDLER_H_
+#define RUNNER_COM_PORT_HANDLER_H_
+
+#include <glib.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "native/serial_port.h"
+#include "native/spsc_ring.h"
+
+// A framed line. While tracing is on it starts a scan: |scan_id| names its
+// spans and |framed_ns| is when it was queued (TraceRecorder::NowNs()).
+struct ComPortLine {
+  std::string text;
+  uint64_t scan_id = 0;
+  int64_t framed_ns = 0;
+};
+
+// Linux counterpart of the Windows runner's ComPortHandler.
+//
+// Instead of a polling read thread, the port's file descriptor is watched on
+// the GLib main loop and complete lines are queued as soon as they arrive.
+class ComPortHandler {
+ public:
+  ComPortHandler();
+  ~ComPortHandler();
+
+  // Open COM port (COMn maps to /dev/ttyS(n-1))
+  bool OpenComPort(int port_number, int baud_rate = 9600);
+
+  // Open a serial device by path, e.g. /dev/ttyUSB0 or /dev/ttyACM0
+  bool OpenDevice(const std::string& device_path, int baud_rate = 9600);
+
+  // Close COM port
+  void CloseComPort();
+
+  // Write data. Called on the executor's "comport" strand; every other
+  // method runs on the main loop. A write waiting for the device never
+  // blocks those; a close (including after an unplug) cancels it.
+  bool WriteData(const std::string& data);
+
+  // Check if port is open
+  bool IsOpen() const { return port_.IsOpen(); }
+
+  // Get line data from queue
+  std::string GetLineData();
+  bool PopLine(ComPortLine* line);
+
+  // Size and overflow policy of the line queue; applied on the next open.
+  // Producer and consumer share the main loop here, so kBlock cannot wait
+  // and behaves like kDropNewest.
+  void SetQueueOptions(size_t capacity, OverflowPolicy policy);
+
+  // How incoming bytes are cut into lines
+  void SetFramerOptions(LineFramerOptions options) {
+    port_.SetFramerOptions(std::move(options));
+  }
+
+  // Records the raw reads of the port, as port 0, to |capture| (null
+  // stops)
+  void SetCapture(SerialCaptureWriter* capture) {
+    port_.SetCapture(capture, 0);
+  }
+
+  // Line queue counters (drops, high-water mark, latency)
+  SpscRingStats GetQueueStats() const { return line_ring_->GetStats(); }
+  OverflowPolicy queue_policy() const { return line_ring_->policy(); }
+
+  // Called on the main loop whenever new lines were queued
+  void SetDataAvailableCallback(std::function<void()> callback) {
+    data_available_callback_ = std::move(callback);
+  }
+
+ private:
+  SerialPort port_;
+  guint watch_id_;
+
+  // Recreate the line queue with the current options
+  void ResetQueue();
+  std::unique_ptr<SpscRing<ComPortLine>> line_ring_;
+  size_t queue_capacity_;
+  OverflowPolicy overflow_policy_;
+  std::function<void()> data_available_callback_;
+  // When the bytes of the line being framed started arriving; 0 if none
+  // are pending or tracing is off
+  int64_t frame_begin_ns_;
+
+  // GLib fd watch callback, runs on the main loop
+  static gboolean OnPortReadable(gint fd, GIOCondition condition,
+                                 gpointer user_data);
+};
+
+#endif  // RUNNER_COM_PORT_HANDLER_H_
@@ -0,0 +1,62 @@
+#include "espeak_engine.h"
+
+#include <espeak-ng/speak_lib.h>
+
+namespace {
+
+// Called by espeak_Synth() on the synthesizing thread. |wav| is null once
+// the utterance is complete; every event carries espeak_Synth()'s user data.
+// Returning 1 aborts synthesis.
+int OnSynth(short* wav, int count, espeak_EVENT* events) {
+  if (wav == nullptr || count <= 0 || events == nullptr) {
+    return 0;
+  }
+  auto* on_audio =
+      static_cast<const SpeechEngine::AudioCallback*>(events->user_data);
+  if (on_audio == nullptr) {
+    return 0;
+  }
+  return (*on_audio)(reinterpret_cast<const int16_t*>(wav),
+                     static_cast<size_t>(count))
+             ? 0
+             : 1;
+}
+
+}  // namespace
+
+EspeakEngine::EspeakEngine() = default;
+
+EspeakEngine::~EspeakEngine() {
+  if (sample_rate_ > 0) {
+    espeak_Terminate();
+  }
+}
+
+bool EspeakEngine::Initialize(const std::string& voice,
+                              int words_per_minute) {
+  // 100 ms buffers: the callback, and so the cancel check, runs at least
+  // that often.
+  const int rate = espeak_Initialize(AUDIO_OUTPUT_SYNCHRONOUS, 100, nullptr, 0);
+  if (rate <= 0) {
+    return false;
+  }
+  sample_rate_ = rate;
+  espeak_SetSynthCallback(OnSynth);
+  if (espeak_SetVoiceByName(voice.c_str()) != EE_OK) {
+    // Without Korean voice data, still say something.
+    espeak_SetVoiceByName("en");
+  }
+  espeak_SetParameter(espeakRATE, words_per_minute, 0);
+  return true;
+}
+
+bool EspeakEngine::Synthesize(const std::string& text,
+                              const AudioCallback& on_audio) {
+  if (sample_rate_ <= 0) {
+    return false;
+  }
+  const AudioCallback* user_data = &on_audio;
+  return espeak_Synth(text.c_str(), text.size() + 1, 0, POS_CHARACTER, 0,
+                      espeakCHARS_UTF8, nullptr,
+                      const_cast<AudioCallback*>(user_data)) == EE_OK;
+}
@@ -0,0 +1,31 @@
+#ifndef RUNNER_ESPEAK_ENGINE_H_
+#define RUNNER_ESPEAK_ENGINE_H_
+
+#include <string>
+
+#include "native/speech_scheduler.h"
+
+// espeak-ng in synchronous mode: Synthesize() returns PCM through the
+// callback instead of playing it, so the scheduler owns playback.
+//
+// espeak-ng keeps global state; create at most one engine per process.
+class EspeakEngine : public SpeechEngine {
+ public:
+  EspeakEngine();
+  ~EspeakEngine() override;
+
+  EspeakEngine(const EspeakEngine&) = delete;
+  EspeakEngine& operator=(const EspeakEngine&) = delete;
+
+  // Loads the voice data. |voice| is an espeak-ng voice name such as "ko".
+  bool Initialize(const std::string& voice, int words_per_minute);
+
+  int sample_rate() const override { return sample_rate_; }
+  bool Synthesize(const std::string& text,
+                  const AudioCallback& on_audio) override;
+
+ private:
+  int sample_rate_ = 0;
+};
+
+#endif  // RUNNER_ESPEAK_ENGINE_H_
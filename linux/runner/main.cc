@@ -1,6 +1,9 @@
 #include "my_application.h"
+#include "native/startup_timeline.h"
 
 int main(int argc, char** argv) {
+  // Everything before this is exec, the dynamic loader and static init.
+  ProcessStartupTimeline().Mark("main");
   g_autoptr(MyApplication) app = my_application_new();
   return g_application_run(G_APPLICATION(app), argc, argv);
 }
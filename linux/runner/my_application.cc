@@ -1,28 +1,1684 @@
 #include "my_application.h"
 
 #include <flutter_linux/flutter_linux.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #ifdef GDK_WINDOWING_X11
 #include <gdk/gdkx.h>
 #endif
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "flutter/generated_plugin_registrant.h"
+#include "com_port_handler.h"
+#include "native/key_burst_detector.h"
+#include "native/metrics_registry.h"
+#include "native/rpc_gateway.h"
+#include "native/serial_capture.h"
+#include "native/serial_reactor.h"
+#include "native/startup_timeline.h"
+#include "native/task_executor.h"
+#include "native/trace_recorder.h"
+#include "tts_handler.h"
+
+struct KeyWedge;
 
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
+
+  // COM Port handler instance
+  ComPortHandler* com_port_handler;
+  FlMethodChannel* comport_channel;
+  FlEventChannel* comport_event_channel;
+  gboolean comport_listening;
+
+  // Speech for the "pharm_parrot/tts" channel
+  TtsHandler* tts_handler;
+  FlMethodChannel* tts_channel;
+
+  // Channel work that can block runs on executor strands; its responses
+  // come back to the main loop through main_queue.
+  MainThreadQueue* main_queue;
+  TaskExecutor* executor;
+  FlMethodChannel* executor_channel;
+
+  // Startup phases, marked here and by Dart over "pharm_parrot/startup".
+  // The timeline is reported once |startup_report_phase| is marked.
+  FlMethodChannel* startup_channel;
+  gchar* startup_report_phase;
+  gboolean startup_benchmark;
+
+  // PostgREST calls over "pharm_parrot/rpc"; null until Dart configures it.
+  // Its callbacks come back to the main loop through main_queue.
+  RpcGateway* rpc_gateway;
+  FlMethodChannel* rpc_channel;
+
+  // Extra scanners over "pharm_parrot/serial", all read by one reactor
+  // thread; null until the first port is opened. Its lines come back to the
+  // main loop through main_queue.
+  SerialReactor* serial_reactor;
+  FlMethodChannel* serial_channel;
+  FlEventChannel* serial_event_channel;
+  gboolean serial_listening;
+
+  // PHARM_SERIAL_CAPTURE=<path> records the raw reads of the COM port (as
+  // port 0) and of the reactor's ports for bench/serial_replay; null
+  // otherwise. Outlives both and the executor. serial_capture_timer has
+  // it flushed on the "capture" strand while the ports are quiet.
+  SerialCaptureWriter* serial_capture;
+  guint serial_capture_timer;
+
+  // Scan spans over "pharm_parrot/trace"; PHARM_TRACE=1 starts recording.
+  FlMethodChannel* trace_channel;
+
+  // Prometheus text file of ProcessMetrics(), started by Dart over
+  // "pharm_parrot/metrics": stats are copied in on the main loop every
+  // metrics_timer tick and the file is written on the "metrics" strand.
+  FlMethodChannel* metrics_channel;
+  gchar* metrics_path;
+  guint metrics_timer;
+
+  // Keyboard-wedge scanners: key bursts caught on the window before the
+  // view sees them go to Dart as scans on "pharm_parrot/keyboard_scanner".
+  KeyWedge* key_wedge;
+  FlMethodChannel* keyboard_scanner_channel;
+  FlEventChannel* keyboard_scanner_event_channel;
+  gboolean keyboard_scanner_listening;
+  gboolean keyboard_scanner_enabled;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 
+static gboolean quit_cb(gpointer user_data) {
+  g_application_quit(G_APPLICATION(user_data));
+  return G_SOURCE_REMOVE;
+}
+
+// Writes the timeline where PHARM_STARTUP_TIMELINE says: "stdout" prints a
+// table, anything else is a file that gets one JSON line per start, so
+// starts on different days can be compared.
+static void write_startup_report(const StartupTimeline& timeline) {
+  const char* target = getenv("PHARM_STARTUP_TIMELINE");
+  if (target == nullptr || *target == '\0') {
+    return;
+  }
+  if (strcmp(target, "stdout") == 0) {
+    fputs(timeline.ToText().c_str(), stdout);
+    fflush(stdout);
+    return;
+  }
+  FILE* file = fopen(target, "a");
+  if (file == nullptr) {
+    g_warning("Cannot append the startup timeline to %s", target);
+    return;
+  }
+  fprintf(file, "%s\n", timeline.ToJson().c_str());
+  fclose(file);
+}
+
+// Marks a startup phase; reports the timeline when it is the one waited
+// for and, in benchmark mode, quits.
+static void mark_startup_phase(MyApplication* self, const char* name) {
+  StartupTimeline& timeline = ProcessStartupTimeline();
+  const bool first_time = timeline.Get(name) < 0;
+  timeline.Mark(name);
+  if (!first_time || g_strcmp0(name, self->startup_report_phase) != 0) {
+    return;
+  }
+  write_startup_report(timeline);
+  if (self->startup_benchmark) {
+    // startup_bench reads this line
+    printf("PHARM_STARTUP %s\n", timeline.ToJson().c_str());
+    fflush(stdout);
+    g_idle_add(quit_cb, self);
+  }
+}
+
 // Called when first Flutter frame received.
 static void first_frame_cb(MyApplication* self, FlView *view)
 {
   gtk_widget_show(gtk_widget_get_toplevel(GTK_WIDGET(view)));
+  mark_startup_phase(self, "first_frame");
+}
+
+static gboolean main_queue_drain_cb(gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  self->main_queue->Drain();
+  return G_SOURCE_REMOVE;
+}
+
+static void respond(FlMethodCall* method_call, FlMethodResponse* response,
+                    const char* channel_name) {
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send %s response: %s", channel_name, error->message);
+  }
+}
+
+// Labels of a channel call's latency: the channel (or strand) and method
+static std::string channel_call_labels(const char* channel,
+                                       FlMethodCall* method_call) {
+  return MetricLabel("channel", channel) + "," +
+         MetricLabel("method", fl_method_call_get_name(method_call));
+}
+
+// Records how long a channel handler holds the platform thread.
+class ChannelCallTimer {
+ public:
+  ChannelCallTimer(const char* channel, FlMethodCall* method_call)
+      : histogram_(ProcessMetrics().GetHistogram(
+            "pharm_channel_call_seconds",
+            channel_call_labels(channel, method_call),
+            "Platform thread time of a channel call")),
+        begin_ns_(TraceRecorder::NowNs()) {}
+  ~ChannelCallTimer() {
+    histogram_.Record((TraceRecorder::NowNs() - begin_ns_) / 1000);
+  }
+
+  ChannelCallTimer(const ChannelCallTimer&) = delete;
+  ChannelCallTimer& operator=(const ChannelCallTimer&) = delete;
+
+ private:
+  LatencyHistogram& histogram_;
+  const int64_t begin_ns_;
+};
+
+// Runs |work| on |strand| of the executor, then |finish| on the main loop to
+// build the response to |method_call|. Main-loop state (fd watches, the
+// line queue) is only touched in |finish|; the strand keeps the blocking
+// parts in order. Cancelled calls are answered with "CANCELLED".
+static void respond_on_strand(MyApplication* self, const char* strand,
+                              FlMethodCall* method_call,
+                              std::function<void()> work,
+                              std::function<FlMethodResponse*()> finish) {
+  // GObject references are not copyable captures; share one.
+  std::shared_ptr<FlMethodCall> call(
+      FL_METHOD_CALL(g_object_ref(method_call)), g_object_unref);
+  MainThreadQueue* main_queue = self->main_queue;
+  LatencyHistogram* latency = &ProcessMetrics().GetHistogram(
+      "pharm_channel_async_seconds", channel_call_labels(strand, method_call),
+      "Channel call to its answer, for calls answered from a strand");
+  const int64_t begin_ns = TraceRecorder::NowNs();
+  self->executor->Post(
+      strand,
+      [call, main_queue, work, finish, latency, begin_ns]() {
+        if (work) {
+          work();
+        }
+        main_queue->Post([call, finish, latency, begin_ns]() {
+          g_autoptr(FlMethodResponse) response = finish();
+          latency->Record((TraceRecorder::NowNs() - begin_ns) / 1000);
+          respond(call.get(), response, "executor");
+        });
+      },
+      // Cancelled from the main loop, so answer directly
+      [call]() {
+        g_autoptr(FlMethodResponse) response =
+            FL_METHOD_RESPONSE(fl_method_error_response_new(
+                "CANCELLED", "Cancelled before it started", nullptr));
+        respond(call.get(), response, "executor");
+      });
+}
+
+static FlMethodResponse* success_response(FlValue* result) {
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Handles calls on the COM Port platform channel. Method names and
+// arguments match the Windows runner.
+static void comport_method_call_cb(FlMethodChannel* channel,
+                                   FlMethodCall* method_call,
+                                   gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  MainThreadQueue::BusyScope busy(self->main_queue);
+  ChannelCallTimer timer("comport", method_call);
+  ComPortHandler* handler = self->com_port_handler;
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "openComPort") == 0) {
+    FlValue* port = nullptr;
+    FlValue* baud = nullptr;
+    FlValue* path = nullptr;
+    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      port = fl_value_lookup_string(args, "portNumber");
+      baud = fl_value_lookup_string(args, "baudRate");
+      path = fl_value_lookup_string(args, "devicePath");
+    }
+    if (port != nullptr && baud != nullptr &&
+        fl_value_get_type(port) == FL_VALUE_TYPE_INT &&
+        fl_value_get_type(baud) == FL_VALUE_TYPE_INT) {
+      int baud_rate = static_cast<int>(fl_value_get_int(baud));
+
+      // Optional line queue options
+      size_t capacity = 0;
+      OverflowPolicy policy = handler->queue_policy();
+      FlValue* capacity_value = fl_value_lookup_string(args, "queueCapacity");
+      if (capacity_value != nullptr &&
+          fl_value_get_type(capacity_value) == FL_VALUE_TYPE_INT &&
+          fl_value_get_int(capacity_value) > 0) {
+        capacity = static_cast<size_t>(fl_value_get_int(capacity_value));
+      }
+      FlValue* policy_value = fl_value_lookup_string(args, "overflowPolicy");
+      if (policy_value != nullptr &&
+          fl_value_get_type(policy_value) == FL_VALUE_TYPE_STRING) {
+        ParseOverflowPolicy(fl_value_get_string(policy_value), &policy);
+      }
+      handler->SetQueueOptions(capacity, policy);
+
+      // Optional framing: a terminator such as "\r\n" or "\x03", and a
+      // prefix such as "\x02". Default: any CR or LF.
+      LineFramerOptions framing;
+      FlValue* terminator = fl_value_lookup_string(args, "terminator");
+      if (terminator != nullptr &&
+          fl_value_get_type(terminator) == FL_VALUE_TYPE_STRING) {
+        framing.terminator = fl_value_get_string(terminator);
+      }
+      FlValue* prefix = fl_value_lookup_string(args, "prefix");
+      if (prefix != nullptr &&
+          fl_value_get_type(prefix) == FL_VALUE_TYPE_STRING) {
+        framing.prefix = fl_value_get_string(prefix);
+      }
+      handler->SetFramerOptions(std::move(framing));
+
+      std::string device_path =
+          path != nullptr && fl_value_get_type(path) == FL_VALUE_TYPE_STRING
+              ? fl_value_get_string(path)
+              : SerialDevicePathForPort(
+                    static_cast<int>(fl_value_get_int(port)));
+      // Reopening closes the port, so wait for writes still in flight.
+      respond_on_strand(self, "comport", method_call, nullptr,
+                        [handler, device_path, baud_rate]() {
+                          g_autoptr(FlValue) result = fl_value_new_bool(
+                              handler->OpenDevice(device_path, baud_rate));
+                          return success_response(result);
+                        });
+      return;
+    } else {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Port number and baud rate required", nullptr));
+    }
+  } else if (strcmp(method, "closeComPort") == 0) {
+    // Writes still waiting are answered as cancelled; the one in flight is
+    // allowed to finish before the port is closed.
+    self->executor->CancelStrand("comport");
+    respond_on_strand(self, "comport", method_call, nullptr, [handler]() {
+      handler->CloseComPort();
+      return success_response(nullptr);
+    });
+    return;
+  } else if (strcmp(method, "readComPort") == 0) {
+    std::string data = handler->GetLineData();
+    g_autoptr(FlValue) result = fl_value_new_string(data.c_str());
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "getComPortStats") == 0) {
+    SpscRingStats stats = handler->GetQueueStats();
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "pushed", fl_value_new_int(stats.pushed));
+    fl_value_set_string_take(result, "popped", fl_value_new_int(stats.popped));
+    fl_value_set_string_take(result, "dropped",
+                             fl_value_new_int(stats.dropped));
+    fl_value_set_string_take(result, "size", fl_value_new_int(stats.size));
+    fl_value_set_string_take(result, "capacity",
+                             fl_value_new_int(stats.capacity));
+    fl_value_set_string_take(result, "highWaterMark",
+                             fl_value_new_int(stats.high_water_mark));
+    fl_value_set_string_take(
+        result, "avgLatencyUs",
+        fl_value_new_int(stats.popped > 0
+                             ? stats.total_latency_ns / stats.popped / 1000
+                             : 0));
+    fl_value_set_string_take(result, "maxLatencyUs",
+                             fl_value_new_int(stats.max_latency_ns / 1000));
+    fl_value_set_string_take(
+        result, "overflowPolicy",
+        fl_value_new_string(OverflowPolicyName(handler->queue_policy())));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "writeComPort") == 0) {
+    FlValue* data = nullptr;
+    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      data = fl_value_lookup_string(args, "data");
+    }
+    if (data != nullptr && fl_value_get_type(data) == FL_VALUE_TYPE_STRING) {
+      // A full output buffer makes the write wait up to 50 ms.
+      std::string text = fl_value_get_string(data);
+      auto success = std::make_shared<bool>(false);
+      respond_on_strand(
+          self, "comport", method_call,
+          [handler, text, success]() { *success = handler->WriteData(text); },
+          [success]() {
+            g_autoptr(FlValue) result = fl_value_new_bool(*success);
+            return success_response(result);
+          });
+      return;
+    } else {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Data required", nullptr));
+    }
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send comport response: %s", error->message);
+  }
+}
+
+// Sends every queued line to Dart as one batch on the event channel.
+static void deliver_comport_lines(MyApplication* self) {
+  if (!self->comport_listening || self->comport_event_channel == nullptr) {
+    return;
+  }
+
+  static MetricCounter& line_count = ProcessMetrics().GetCounter(
+      "pharm_serial_lines_total", MetricLabel("port", "comport"),
+      "Lines framed from a scanner port");
+  static MetricCounter& byte_count = ProcessMetrics().GetCounter(
+      "pharm_serial_line_bytes_total", MetricLabel("port", "comport"),
+      "Bytes of the lines framed from a scanner port");
+
+  // A traced line goes as {line, scanId} so Dart can continue the scan.
+  g_autoptr(FlValue) lines = fl_value_new_list();
+  ComPortLine line;
+  while (self->com_port_handler->PopLine(&line)) {
+    if (line.text.empty()) {
+      continue;
+    }
+    line_count.Add();
+    byte_count.Add(line.text.size());
+    if (line.scan_id == 0) {
+      fl_value_append_take(lines, fl_value_new_string(line.text.c_str()));
+      continue;
+    }
+    ProcessTraceRecorder().Record("comport.queue", line.scan_id,
+                                  line.framed_ns, TraceRecorder::NowNs());
+    FlValue* entry = fl_value_new_map();
+    fl_value_set_string_take(entry, "line",
+                             fl_value_new_string(line.text.c_str()));
+    fl_value_set_string_take(
+        entry, "scanId", fl_value_new_int(static_cast<int64_t>(line.scan_id)));
+    fl_value_append_take(lines, entry);
+  }
+  if (fl_value_get_length(lines) == 0) {
+    return;
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(self->comport_event_channel, lines, nullptr,
+                             &error)) {
+    g_warning("Failed to send comport event: %s", error->message);
+  }
+}
+
+static FlMethodErrorResponse* comport_listen_cb(FlEventChannel* channel,
+                                                FlValue* args,
+                                                gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  self->comport_listening = TRUE;
+  // Flush anything scanned before Dart started listening
+  deliver_comport_lines(self);
+  return nullptr;
+}
+
+static FlMethodErrorResponse* comport_cancel_cb(FlEventChannel* channel,
+                                                FlValue* args,
+                                                gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  self->comport_listening = FALSE;
+  return nullptr;
+}
+
+// Setup COM Port platform channel
+static void setup_comport_channel(MyApplication* self, FlView* view) {
+  FlEngine* engine = fl_view_get_engine(view);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_clear_object(&self->comport_channel);
+  self->comport_channel = fl_method_channel_new(
+      messenger, "com.example.pharm_parrot_flutter/comport",
+      FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(
+      self->comport_channel, comport_method_call_cb, self, nullptr);
+
+  // Lines are pushed as soon as the fd watch has framed them
+  g_clear_object(&self->comport_event_channel);
+  self->comport_event_channel = fl_event_channel_new(
+      messenger, "com.example.pharm_parrot_flutter/comport/events",
+      FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->comport_event_channel,
+                                       comport_listen_cb, comport_cancel_cb,
+                                       self, nullptr);
+  self->com_port_handler->SetDataAvailableCallback(
+      [self]() { deliver_comport_lines(self); });
+}
+
+// Handles calls on the TTS channel. "speak" takes an optional "priority"
+// ("patient", "drug" or "error"; default "drug") that the Windows runner
+// ignores.
+static void tts_method_call_cb(FlMethodChannel* channel,
+                               FlMethodCall* method_call,
+                               gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  // Every method only queues work for the speech thread.
+  MainThreadQueue::BusyScope busy(self->main_queue);
+  ChannelCallTimer timer("tts", method_call);
+  TtsHandler* handler = self->tts_handler;
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "speak") == 0) {
+    FlValue* text = nullptr;
+    FlValue* priority_value = nullptr;
+    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      text = fl_value_lookup_string(args, "text");
+      priority_value = fl_value_lookup_string(args, "priority");
+    }
+    SpeechPriority priority = SpeechPriority::kDrugLine;
+    if (priority_value != nullptr &&
+        fl_value_get_type(priority_value) == FL_VALUE_TYPE_STRING) {
+      ParseSpeechPriority(fl_value_get_string(priority_value), &priority);
+    }
+    if (text == nullptr || fl_value_get_type(text) != FL_VALUE_TYPE_STRING) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Text argument is required", nullptr));
+    } else if (!handler->IsAvailable()) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "TTS_ERROR", "No speech engine available", nullptr));
+    } else {
+      // Queued; returns before any audio is produced.
+      handler->Speak(fl_value_get_string(text), priority);
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  } else if (strcmp(method, "warm") == 0) {
+    FlValue* texts = nullptr;
+    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      texts = fl_value_lookup_string(args, "texts");
+    }
+    std::vector<std::string> list;
+    if (texts != nullptr && fl_value_get_type(texts) == FL_VALUE_TYPE_LIST) {
+      for (size_t i = 0; i < fl_value_get_length(texts); ++i) {
+        FlValue* text = fl_value_get_list_value(texts, i);
+        if (fl_value_get_type(text) == FL_VALUE_TYPE_STRING) {
+          list.push_back(fl_value_get_string(text));
+        }
+      }
+    }
+    handler->Warm(list);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  } else if (strcmp(method, "stop") == 0) {
+    handler->Stop();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  } else if (strcmp(method, "beep") == 0) {
+    FlValue* frequency = nullptr;
+    FlValue* duration = nullptr;
+    FlValue* priority_value = nullptr;
+    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      frequency = fl_value_lookup_string(args, "frequency");
+      duration = fl_value_lookup_string(args, "duration");
+      priority_value = fl_value_lookup_string(args, "priority");
+    }
+    SpeechPriority priority = SpeechPriority::kDrugLine;
+    if (priority_value != nullptr &&
+        fl_value_get_type(priority_value) == FL_VALUE_TYPE_STRING) {
+      ParseSpeechPriority(fl_value_get_string(priority_value), &priority);
+    }
+    if (frequency != nullptr && duration != nullptr &&
+        fl_value_get_type(frequency) == FL_VALUE_TYPE_INT &&
+        fl_value_get_type(duration) == FL_VALUE_TYPE_INT) {
+      // Queued with the speech around it; returns before the tone plays.
+      handler->Beep(static_cast<int>(fl_value_get_int(frequency)),
+                    static_cast<int>(fl_value_get_int(duration)), priority);
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    } else {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Frequency and duration required", nullptr));
+    }
+  } else if (strcmp(method, "getStats") == 0) {
+    SpeechSchedulerStats stats = handler->GetStats();
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "requested",
+                             fl_value_new_int(stats.requested));
+    fl_value_set_string_take(result, "sounds", fl_value_new_int(stats.sounds));
+    fl_value_set_string_take(result, "spoken", fl_value_new_int(stats.spoken));
+    fl_value_set_string_take(result, "coalesced",
+                             fl_value_new_int(stats.coalesced));
+    fl_value_set_string_take(result, "preempted",
+                             fl_value_new_int(stats.preempted));
+    fl_value_set_string_take(result, "dropped",
+                             fl_value_new_int(stats.dropped));
+    fl_value_set_string_take(result, "stopped",
+                             fl_value_new_int(stats.stopped));
+    fl_value_set_string_take(result, "engineErrors",
+                             fl_value_new_int(stats.engine_errors));
+    fl_value_set_string_take(result, "queueDepth",
+                             fl_value_new_int(stats.queue_depth));
+    fl_value_set_string_take(result, "maxQueueDepth",
+                             fl_value_new_int(stats.max_queue_depth));
+    fl_value_set_string_take(result, "lastFirstAudioUs",
+                             fl_value_new_int(stats.last_first_audio_us));
+    fl_value_set_string_take(result, "maxFirstAudioUs",
+                             fl_value_new_int(stats.max_first_audio_us));
+    fl_value_set_string_take(
+        result, "avgFirstAudioUs",
+        fl_value_new_int(stats.first_audio_count > 0
+                             ? stats.total_first_audio_us /
+                                   stats.first_audio_count
+                             : 0));
+    CachingSpeechEngineStats cache = handler->GetCacheStats();
+    fl_value_set_string_take(result, "cacheHits",
+                             fl_value_new_int(cache.cache.hits));
+    fl_value_set_string_take(result, "cacheMisses",
+                             fl_value_new_int(cache.cache.misses));
+    fl_value_set_string_take(result, "cacheEvictions",
+                             fl_value_new_int(cache.cache.evictions));
+    fl_value_set_string_take(result, "cacheEntries",
+                             fl_value_new_int(cache.cache.entries));
+    fl_value_set_string_take(result, "cacheBytes",
+                             fl_value_new_int(cache.cache.bytes));
+    fl_value_set_string_take(result, "cacheBudgetBytes",
+                             fl_value_new_int(cache.cache.budget_bytes));
+    fl_value_set_string_take(result, "warmed", fl_value_new_int(cache.warmed));
+    fl_value_set_string_take(result, "warmPending",
+                             fl_value_new_int(cache.warm_pending));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send tts response: %s", error->message);
+  }
+}
+
+// Setup TTS platform channel
+static void setup_tts_channel(MyApplication* self, FlView* view) {
+  FlEngine* engine = fl_view_get_engine(view);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_clear_object(&self->tts_channel);
+  self->tts_channel = fl_method_channel_new(messenger, "pharm_parrot/tts",
+                                            FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->tts_channel,
+                                            tts_method_call_cb, self, nullptr);
+}
+
+static FlValue* task_queue_stats_value(const TaskQueueStats& stats) {
+  FlValue* value = fl_value_new_map();
+  fl_value_set_string_take(value, "posted", fl_value_new_int(stats.posted));
+  fl_value_set_string_take(value, "executed",
+                           fl_value_new_int(stats.executed));
+  fl_value_set_string_take(value, "cancelled",
+                           fl_value_new_int(stats.cancelled));
+  fl_value_set_string_take(value, "pending", fl_value_new_int(stats.pending));
+  fl_value_set_string_take(
+      value, "avgQueueUs",
+      fl_value_new_int(stats.executed > 0
+                           ? stats.total_queue_us / stats.executed
+                           : 0));
+  fl_value_set_string_take(value, "maxQueueUs",
+                           fl_value_new_int(stats.max_queue_us));
+  fl_value_set_string_take(
+      value, "avgRunUs",
+      fl_value_new_int(stats.executed > 0 ? stats.total_run_us / stats.executed
+                                          : 0));
+  fl_value_set_string_take(value, "maxRunUs",
+                           fl_value_new_int(stats.max_run_us));
+  return value;
+}
+
+// Reports per-strand queue latency and how long the main loop was held by
+// channel handlers and completions.
+static void executor_method_call_cb(FlMethodChannel* channel,
+                                    FlMethodCall* method_call,
+                                    gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  const gchar* method = fl_method_call_get_name(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "getStats") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_map();
+    FlValue* strands = fl_value_new_map();
+    for (const auto& entry : self->executor->GetStrandStats()) {
+      fl_value_set_string_take(strands, entry.first.c_str(),
+                               task_queue_stats_value(entry.second));
+    }
+    fl_value_set_string_take(result, "strands", strands);
+    MainThreadQueueStats stats = self->main_queue->GetStats();
+    fl_value_set_string_take(result, "completions",
+                             fl_value_new_int(stats.completed));
+    fl_value_set_string_take(
+        result, "avgCompletionUs",
+        fl_value_new_int(stats.completed > 0
+                             ? stats.total_latency_us / stats.completed
+                             : 0));
+    fl_value_set_string_take(result, "maxCompletionUs",
+                             fl_value_new_int(stats.max_latency_us));
+    fl_value_set_string_take(result, "maxPlatformBusyUs",
+                             fl_value_new_int(stats.max_busy_us));
+    fl_value_set_string_take(result, "platformBusyOverFrame",
+                             fl_value_new_int(stats.busy_over_frame));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+  respond(method_call, response, "executor");
+}
+
+// Setup executor stats channel
+static void setup_executor_channel(MyApplication* self, FlView* view) {
+  FlEngine* engine = fl_view_get_engine(view);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_clear_object(&self->executor_channel);
+  self->executor_channel = fl_method_channel_new(
+      messenger, "pharm_parrot/executor", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(
+      self->executor_channel, executor_method_call_cb, self, nullptr);
+}
+
+// "mark" records a phase reached in Dart (e.g. "dart_main", "first_data");
+// "getTimeline" returns every phase so far in microseconds since process
+// start.
+static void startup_method_call_cb(FlMethodChannel* channel,
+                                   FlMethodCall* method_call,
+                                   gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "mark") == 0) {
+    FlValue* name = nullptr;
+    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      name = fl_value_lookup_string(args, "name");
+    }
+    if (name != nullptr && fl_value_get_type(name) == FL_VALUE_TYPE_STRING) {
+      mark_startup_phase(self, fl_value_get_string(name));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    } else {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Name required", nullptr));
+    }
+  } else if (strcmp(method, "getTimeline") == 0) {
+    const StartupTimeline& timeline = ProcessStartupTimeline();
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "processStart",
+                             fl_value_new_bool(timeline.has_process_start()));
+    FlValue* marks = fl_value_new_list();
+    for (const StartupMark& mark : timeline.Marks()) {
+      FlValue* entry = fl_value_new_map();
+      fl_value_set_string_take(entry, "name",
+                               fl_value_new_string(mark.name.c_str()));
+      fl_value_set_string_take(entry, "us", fl_value_new_int(mark.us));
+      fl_value_append_take(marks, entry);
+    }
+    fl_value_set_string_take(result, "marks", marks);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  respond(method_call, response, "startup");
+}
+
+// Setup startup timeline channel
+static void setup_startup_channel(MyApplication* self, FlView* view) {
+  FlEngine* engine = fl_view_get_engine(view);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_clear_object(&self->startup_channel);
+  self->startup_channel = fl_method_channel_new(
+      messenger, "pharm_parrot/startup", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(
+      self->startup_channel, startup_method_call_cb, self, nullptr);
+}
+
+// Integer in |map| under |key|, or |fallback|.
+static int64_t lookup_int(FlValue* map, const char* key, int64_t fallback) {
+  FlValue* value = fl_value_lookup_string(map, key);
+  return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT
+             ? fl_value_get_int(value)
+             : fallback;
+}
+
+static const gchar* lookup_string(FlValue* map, const char* key) {
+  FlValue* value = fl_value_lookup_string(map, key);
+  return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_STRING
+             ? fl_value_get_string(value)
+             : nullptr;
+}
+
+// {fn: {timeoutMs, retries, coalesce, idempotent}} from Dart's endpoint
+// table.
+static void set_rpc_policies(RpcGateway* gateway, FlValue* policies) {
+  if (policies == nullptr ||
+      fl_value_get_type(policies) != FL_VALUE_TYPE_MAP) {
+    return;
+  }
+  for (size_t i = 0; i < fl_value_get_length(policies); ++i) {
+    FlValue* name = fl_value_get_map_key(policies, i);
+    FlValue* entry = fl_value_get_map_value(policies, i);
+    if (fl_value_get_type(name) != FL_VALUE_TYPE_STRING ||
+        fl_value_get_type(entry) != FL_VALUE_TYPE_MAP) {
+      continue;
+    }
+    RpcPolicy policy;
+    policy.timeout_ms =
+        static_cast<int>(lookup_int(entry, "timeoutMs", policy.timeout_ms));
+    policy.retries =
+        static_cast<int>(lookup_int(entry, "retries", policy.retries));
+    FlValue* coalesce = fl_value_lookup_string(entry, "coalesce");
+    policy.coalesce = coalesce != nullptr &&
+                      fl_value_get_type(coalesce) == FL_VALUE_TYPE_BOOL &&
+                      fl_value_get_bool(coalesce);
+    FlValue* idempotent = fl_value_lookup_string(entry, "idempotent");
+    policy.idempotent = idempotent != nullptr &&
+                        fl_value_get_type(idempotent) == FL_VALUE_TYPE_BOOL &&
+                        fl_value_get_bool(idempotent);
+    gateway->SetPolicy(fl_value_get_string(name), policy);
+  }
+}
+
+// "configure" points the gateway at a plain-HTTP PostgREST (or proxy) and
+// sets the per-function policies; "call" sends {function, body} and answers
+// with {status, body (bytes), attempts, shared} once the response is in,
+// without holding the main loop; "getStats" reports pooling and coalescing.
+// A call without a response fails with RPC_FAILED if its request never went
+// out, and with RPC_OUTCOME_UNKNOWN if the server may have run it.
+static void rpc_method_call_cb(FlMethodChannel* channel,
+                               FlMethodCall* method_call, gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  MainThreadQueue::BusyScope busy(self->main_queue);
+  ChannelCallTimer timer("rpc", method_call);
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+  const bool has_map = fl_value_get_type(args) == FL_VALUE_TYPE_MAP;
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "configure") == 0) {
+    const gchar* host = has_map ? lookup_string(args, "host") : nullptr;
+    const int64_t port = has_map ? lookup_int(args, "port", 0) : 0;
+    if (host == nullptr || port <= 0 || port > 65535) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Host and port required", nullptr));
+    } else {
+      RpcGatewayOptions options;
+      options.host = host;
+      options.port = static_cast<uint16_t>(port);
+      if (const gchar* prefix = lookup_string(args, "pathPrefix")) {
+        options.path_prefix = prefix;
+      }
+      FlValue* headers = fl_value_lookup_string(args, "headers");
+      if (headers != nullptr &&
+          fl_value_get_type(headers) == FL_VALUE_TYPE_MAP) {
+        for (size_t i = 0; i < fl_value_get_length(headers); ++i) {
+          FlValue* key = fl_value_get_map_key(headers, i);
+          FlValue* value = fl_value_get_map_value(headers, i);
+          if (fl_value_get_type(key) == FL_VALUE_TYPE_STRING &&
+              fl_value_get_type(value) == FL_VALUE_TYPE_STRING) {
+            options.headers.push_back(std::string(fl_value_get_string(key)) +
+                                      ": " + fl_value_get_string(value));
+          }
+        }
+      }
+      options.max_connections = static_cast<size_t>(
+          lookup_int(args, "connections", options.max_connections));
+      options.pipeline_depth = static_cast<size_t>(
+          lookup_int(args, "pipelineDepth", options.pipeline_depth));
+      // The old gateway answers its pending calls with "shutdown"
+      delete self->rpc_gateway;
+      self->rpc_gateway = new RpcGateway(options);
+      set_rpc_policies(self->rpc_gateway,
+                       fl_value_lookup_string(args, "policies"));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  } else if (strcmp(method, "call") == 0) {
+    const gchar* function = has_map ? lookup_string(args, "function") : nullptr;
+    const gchar* body = has_map ? lookup_string(args, "body") : nullptr;
+    if (self->rpc_gateway == nullptr) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "NOT_CONFIGURED", "Call configure first", nullptr));
+    } else if (function == nullptr) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Function required", nullptr));
+    } else {
+      std::shared_ptr<FlMethodCall> call(
+          FL_METHOD_CALL(g_object_ref(method_call)), g_object_unref);
+      MainThreadQueue* main_queue = self->main_queue;
+      LatencyHistogram* latency = &ProcessMetrics().GetHistogram(
+          "pharm_rpc_gateway_seconds", MetricLabel("function", function),
+          "RPC call through the native gateway, retries included");
+      const int64_t begin_ns = TraceRecorder::NowNs();
+      self->rpc_gateway->Call(
+          function, body != nullptr ? body : "",
+          [call, main_queue, latency, begin_ns](const RpcResult& result) {
+            latency->Record((TraceRecorder::NowNs() - begin_ns) / 1000);
+            main_queue->Post([call, result]() {
+              g_autoptr(FlMethodResponse) response = nullptr;
+              if (result.status == 0) {
+                response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+                    result.sent ? "RPC_OUTCOME_UNKNOWN" : "RPC_FAILED",
+                    result.error.c_str(), nullptr));
+              } else {
+                g_autoptr(FlValue) value = fl_value_new_map();
+                fl_value_set_string_take(value, "status",
+                                         fl_value_new_int(result.status));
+                // Raw bytes: Dart decodes them off the UI isolate
+                fl_value_set_string_take(
+                    value, "body",
+                    fl_value_new_uint8_list(
+                        reinterpret_cast<const uint8_t*>(result.body.data()),
+                        result.body.size()));
+                fl_value_set_string_take(value, "attempts",
+                                         fl_value_new_int(result.attempts));
+                fl_value_set_string_take(value, "shared",
+                                         fl_value_new_bool(result.shared));
+                response = success_response(value);
+              }
+              respond(call.get(), response, "rpc");
+            });
+          });
+      return;
+    }
+  } else if (strcmp(method, "getStats") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_map();
+    if (self->rpc_gateway != nullptr) {
+      const RpcGatewayStats stats = self->rpc_gateway->GetStats();
+      fl_value_set_string_take(result, "calls", fl_value_new_int(stats.calls));
+      fl_value_set_string_take(result, "coalesced",
+                               fl_value_new_int(stats.coalesced));
+      fl_value_set_string_take(result, "requests",
+                               fl_value_new_int(stats.requests));
+      fl_value_set_string_take(result, "retries",
+                               fl_value_new_int(stats.retries));
+      fl_value_set_string_take(result, "timeouts",
+                               fl_value_new_int(stats.timeouts));
+      fl_value_set_string_take(result, "failures",
+                               fl_value_new_int(stats.failures));
+      fl_value_set_string_take(result, "connectionsOpened",
+                               fl_value_new_int(stats.connections_opened));
+      fl_value_set_string_take(result, "reused",
+                               fl_value_new_int(stats.reused));
+      fl_value_set_string_take(result, "pipelined",
+                               fl_value_new_int(stats.pipelined));
+      fl_value_set_string_take(result, "maxInFlight",
+                               fl_value_new_int(stats.max_in_flight));
+    }
+    response = success_response(result);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+  respond(method_call, response, "rpc");
+}
+
+// Setup RPC gateway channel
+static void setup_rpc_channel(MyApplication* self, FlView* view) {
+  FlEngine* engine = fl_view_get_engine(view);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_clear_object(&self->rpc_channel);
+  self->rpc_channel = fl_method_channel_new(messenger, "pharm_parrot/rpc",
+                                            FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->rpc_channel,
+                                            rpc_method_call_cb, self, nullptr);
+}
+
+static FlValue* serial_port_value(int32_t id, const SerialPortConfig& config,
+                                  const SerialPortStats& stats) {
+  FlValue* value = fl_value_new_map();
+  fl_value_set_string_take(value, "id", fl_value_new_int(id));
+  fl_value_set_string_take(value, "devicePath",
+                           fl_value_new_string(config.device_path.c_str()));
+  fl_value_set_string_take(value, "baudRate",
+                           fl_value_new_int(config.baud_rate));
+  fl_value_set_string_take(
+      value, "terminator",
+      fl_value_new_string_sized(config.framing.terminator.data(),
+                                config.framing.terminator.size()));
+  fl_value_set_string_take(
+      value, "prefix",
+      fl_value_new_string_sized(config.framing.prefix.data(),
+                                config.framing.prefix.size()));
+  fl_value_set_string_take(value, "reopen", fl_value_new_bool(config.reopen));
+  fl_value_set_string_take(value, "open", fl_value_new_bool(stats.open));
+  fl_value_set_string_take(value, "lines", fl_value_new_int(stats.lines));
+  fl_value_set_string_take(value, "lineBytes",
+                           fl_value_new_int(stats.line_bytes));
+  fl_value_set_string_take(value, "reads", fl_value_new_int(stats.reads));
+  fl_value_set_string_take(value, "dropped", fl_value_new_int(stats.dropped));
+  fl_value_set_string_take(value, "hangups", fl_value_new_int(stats.hangups));
+  fl_value_set_string_take(value, "reopens", fl_value_new_int(stats.reopens));
+  fl_value_set_string_take(value, "lastLineMs",
+                           fl_value_new_int(stats.last_line_ms));
+  return value;
+}
+
+// Sends every queued line to Dart as one batch of {port, line} maps.
+static void deliver_serial_lines(MyApplication* self) {
+  if (!self->serial_listening || self->serial_event_channel == nullptr ||
+      self->serial_reactor == nullptr) {
+    return;
+  }
+
+  g_autoptr(FlValue) lines = fl_value_new_list();
+  SerialLine line;
+  while (self->serial_reactor->PopLine(&line)) {
+    FlValue* entry = fl_value_new_map();
+    fl_value_set_string_take(entry, "port", fl_value_new_int(line.port));
+    fl_value_set_string_take(
+        entry, "line",
+        fl_value_new_string_sized(line.text.data(), line.text.size()));
+    if (line.scan_id != 0) {
+      ProcessTraceRecorder().Record("serial.queue", line.scan_id,
+                                    line.framed_ns, TraceRecorder::NowNs());
+      fl_value_set_string_take(
+          entry, "scanId",
+          fl_value_new_int(static_cast<int64_t>(line.scan_id)));
+    }
+    fl_value_append_take(lines, entry);
+  }
+  if (fl_value_get_length(lines) == 0) {
+    return;
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(self->serial_event_channel, lines, nullptr,
+                             &error)) {
+    g_warning("Failed to send serial event: %s", error->message);
+  }
+}
+
+// "openPort" takes {id, devicePath or portNumber, baudRate, terminator,
+// prefix, reopen} and replaces any port with that id; "closePort" {id};
+// "writePort" {id, data}; "listPorts" answers with each port's config and
+// counters; "getStats" with the shared line queue's.
+static void serial_method_call_cb(FlMethodChannel* channel,
+                                  FlMethodCall* method_call,
+                                  gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  MainThreadQueue::BusyScope busy(self->main_queue);
+  ChannelCallTimer timer("serial", method_call);
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+  const bool has_map = fl_value_get_type(args) == FL_VALUE_TYPE_MAP;
+  const int64_t id = has_map ? lookup_int(args, "id", -1) : -1;
+
+  if (self->serial_reactor == nullptr) {
+    MainThreadQueue* main_queue = self->main_queue;
+    self->serial_reactor = new SerialReactor(1024, [self, main_queue]() {
+      main_queue->Post([self]() { deliver_serial_lines(self); });
+    });
+    self->serial_reactor->SetCapture(self->serial_capture);
+  }
+  SerialReactor* reactor = self->serial_reactor;
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "openPort") == 0) {
+    const gchar* path = has_map ? lookup_string(args, "devicePath") : nullptr;
+    const int64_t port = has_map ? lookup_int(args, "portNumber", -1) : -1;
+    if (id < 0 || (path == nullptr && port < 0)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Id and device path or port number required",
+          nullptr));
+    } else {
+      SerialPortConfig config;
+      config.device_path =
+          path != nullptr ? std::string(path)
+                          : SerialDevicePathForPort(static_cast<int>(port));
+      config.baud_rate =
+          static_cast<int>(lookup_int(args, "baudRate", config.baud_rate));
+      if (const gchar* terminator = lookup_string(args, "terminator")) {
+        config.framing.terminator = terminator;
+      }
+      if (const gchar* prefix = lookup_string(args, "prefix")) {
+        config.framing.prefix = prefix;
+      }
+      FlValue* reopen = fl_value_lookup_string(args, "reopen");
+      if (reopen != nullptr &&
+          fl_value_get_type(reopen) == FL_VALUE_TYPE_BOOL) {
+        config.reopen = fl_value_get_bool(reopen);
+      }
+      // Waits for a write to the port being replaced
+      respond_on_strand(self, "serial", method_call, nullptr,
+                        [reactor, id, config]() {
+                          g_autoptr(FlValue) result = fl_value_new_bool(
+                              reactor->OpenPort(static_cast<int32_t>(id),
+                                                config));
+                          return success_response(result);
+                        });
+      return;
+    }
+  } else if (strcmp(method, "closePort") == 0) {
+    respond_on_strand(self, "serial", method_call, nullptr, [reactor, id]() {
+      g_autoptr(FlValue) result =
+          fl_value_new_bool(reactor->ClosePort(static_cast<int32_t>(id)));
+      return success_response(result);
+    });
+    return;
+  } else if (strcmp(method, "writePort") == 0) {
+    const gchar* data = has_map ? lookup_string(args, "data") : nullptr;
+    if (data == nullptr) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Data required", nullptr));
+    } else {
+      // A full output buffer makes the write wait up to 50 ms.
+      std::string text = data;
+      auto success = std::make_shared<bool>(false);
+      respond_on_strand(
+          self, "serial", method_call,
+          [reactor, id, text, success]() {
+            *success = reactor->Write(static_cast<int32_t>(id), text);
+          },
+          [success]() {
+            g_autoptr(FlValue) result = fl_value_new_bool(*success);
+            return success_response(result);
+          });
+      return;
+    }
+  } else if (strcmp(method, "listPorts") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_list();
+    for (int32_t port : reactor->PortIds()) {
+      SerialPortConfig config;
+      SerialPortStats stats;
+      if (reactor->GetPortConfig(port, &config) &&
+          reactor->GetPortStats(port, &stats)) {
+        fl_value_append_take(result, serial_port_value(port, config, stats));
+      }
+    }
+    response = success_response(result);
+  } else if (strcmp(method, "getStats") == 0) {
+    const SpscRingStats stats = reactor->GetQueueStats();
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "pushed", fl_value_new_int(stats.pushed));
+    fl_value_set_string_take(result, "popped", fl_value_new_int(stats.popped));
+    fl_value_set_string_take(result, "dropped",
+                             fl_value_new_int(stats.dropped));
+    fl_value_set_string_take(result, "size", fl_value_new_int(stats.size));
+    fl_value_set_string_take(result, "capacity",
+                             fl_value_new_int(stats.capacity));
+    fl_value_set_string_take(result, "highWaterMark",
+                             fl_value_new_int(stats.high_water_mark));
+    fl_value_set_string_take(result, "maxLatencyUs",
+                             fl_value_new_int(stats.max_latency_ns / 1000));
+    response = success_response(result);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+  respond(method_call, response, "serial");
+}
+
+static FlMethodErrorResponse* serial_listen_cb(FlEventChannel* channel,
+                                               FlValue* args,
+                                               gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  self->serial_listening = TRUE;
+  deliver_serial_lines(self);
+  return nullptr;
+}
+
+static FlMethodErrorResponse* serial_cancel_cb(FlEventChannel* channel,
+                                               FlValue* args,
+                                               gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  self->serial_listening = FALSE;
+  return nullptr;
+}
+
+// Setup multi-port serial channel
+static void setup_serial_channel(MyApplication* self, FlView* view) {
+  FlEngine* engine = fl_view_get_engine(view);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_clear_object(&self->serial_channel);
+  self->serial_channel = fl_method_channel_new(
+      messenger, "pharm_parrot/serial", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(
+      self->serial_channel, serial_method_call_cb, self, nullptr);
+
+  g_clear_object(&self->serial_event_channel);
+  self->serial_event_channel = fl_event_channel_new(
+      messenger, "pharm_parrot/serial/events", FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->serial_event_channel,
+                                       serial_listen_cb, serial_cancel_cb,
+                                       self, nullptr);
+}
+
+// Writes out the serial capture's buffered reads, so the end of a burst
+// is on disk even if no read follows it. The write can block on a slow
+// disk, so it runs on the "capture" strand.
+static gboolean serial_capture_timer_cb(gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  SerialCaptureWriter* capture = self->serial_capture;
+  self->executor->Post("capture", [capture]() { capture->Flush(); });
+  return G_SOURCE_CONTINUE;
+}
+
+// "setEnabled" {enabled} starts or stops recording; "isEnabled"; "events"
+// answers with the runner's spans as comma-separated Chrome trace events,
+// which Dart merges with its own when it writes the file; "clear".
+static void trace_method_call_cb(FlMethodChannel* channel,
+                                 FlMethodCall* method_call,
+                                 gpointer user_data) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+  TraceRecorder& trace = ProcessTraceRecorder();
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "setEnabled") == 0) {
+    FlValue* enabled = fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                           ? fl_value_lookup_string(args, "enabled")
+                           : nullptr;
+    if (enabled == nullptr ||
+        fl_value_get_type(enabled) != FL_VALUE_TYPE_BOOL) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Enabled required", nullptr));
+    } else {
+      trace.SetEnabled(fl_value_get_bool(enabled));
+      response = success_response(nullptr);
+    }
+  } else if (strcmp(method, "isEnabled") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_bool(trace.enabled());
+    response = success_response(result);
+  } else if (strcmp(method, "events") == 0) {
+    const std::string events = trace.ChromeEvents();
+    g_autoptr(FlValue) result =
+        fl_value_new_string_sized(events.data(), events.size());
+    response = success_response(result);
+  } else if (strcmp(method, "clear") == 0) {
+    trace.Clear();
+    response = success_response(nullptr);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+  respond(method_call, response, "trace");
+}
+
+// Setup scan trace channel
+static void setup_trace_channel(MyApplication* self, FlView* view) {
+  FlEngine* engine = fl_view_get_engine(view);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_clear_object(&self->trace_channel);
+  self->trace_channel = fl_method_channel_new(
+      messenger, "pharm_parrot/trace", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(
+      self->trace_channel, trace_method_call_cb, self, nullptr);
+}
+
+// Copies stats the handlers keep into ProcessMetrics(). Main loop only:
+// the serial reactor and the gateway are created and replaced here.
+static void collect_metrics(MyApplication* self) {
+  MetricsRegistry& metrics = ProcessMetrics();
+  const SpscRingStats comport = self->com_port_handler->GetQueueStats();
+  metrics
+      .GetCounter("pharm_serial_dropped_total",
+                  MetricLabel("port", "comport"),
+                  "Lines dropped from a full line queue")
+      .Mirror(comport.dropped);
+  metrics
+      .GetGauge("pharm_serial_queue_depth", MetricLabel("queue", "comport"),
+                "Lines waiting for the platform thread")
+      .Set(static_cast<int64_t>(comport.size));
+
+  if (self->serial_reactor != nullptr) {
+    for (int32_t id : self->serial_reactor->PortIds()) {
+      SerialPortStats stats;
+      if (!self->serial_reactor->GetPortStats(id, &stats)) {
+        continue;
+      }
+      const std::string port = MetricLabel("port", std::to_string(id));
+      metrics.GetCounter("pharm_serial_lines_total", port).Mirror(stats.lines);
+      metrics.GetCounter("pharm_serial_line_bytes_total", port)
+          .Mirror(stats.line_bytes);
+      metrics.GetCounter("pharm_serial_dropped_total", port)
+          .Mirror(stats.dropped);
+      metrics
+          .GetCounter("pharm_serial_hangups_total", port,
+                      "Scanner ports that went away")
+          .Mirror(stats.hangups);
+      metrics
+          .GetCounter("pharm_serial_reopens_total", port,
+                      "Scanner ports opened again after a hangup")
+          .Mirror(stats.reopens);
+    }
+    metrics
+        .GetGauge("pharm_serial_queue_depth", MetricLabel("queue", "reactor"))
+        .Set(static_cast<int64_t>(
+            self->serial_reactor->GetQueueStats().size));
+  }
+
+  const SpeechSchedulerStats tts = self->tts_handler->GetStats();
+  metrics.GetCounter("pharm_tts_spoken_total", {}, "Utterances played")
+      .Mirror(tts.spoken);
+  metrics
+      .GetCounter("pharm_tts_dropped_total", {},
+                  "Utterances dropped from a full queue or replaced")
+      .Mirror(tts.dropped);
+  metrics
+      .GetCounter("pharm_tts_preempted_total", {},
+                  "Utterances cut off by a more urgent one")
+      .Mirror(tts.preempted);
+  metrics.GetGauge("pharm_tts_queue_depth", {}, "Utterances waiting")
+      .Set(static_cast<int64_t>(tts.queue_depth));
+
+  if (self->rpc_gateway != nullptr) {
+    const RpcGatewayStats rpc = self->rpc_gateway->GetStats();
+    metrics.GetCounter("pharm_rpc_gateway_requests_total", {},
+                       "HTTP requests sent by the native gateway")
+        .Mirror(rpc.requests);
+    metrics.GetCounter("pharm_rpc_gateway_retries_total").Mirror(rpc.retries);
+    metrics.GetCounter("pharm_rpc_gateway_timeouts_total")
+        .Mirror(rpc.timeouts);
+    metrics.GetCounter("pharm_rpc_gateway_failures_total")
+        .Mirror(rpc.failures);
+  }
+}
+
+// Collects on the main loop, writes on the "metrics" strand.
+static void write_metrics(MyApplication* self) {
+  collect_metrics(self);
+  const std::string path = self->metrics_path;
+  self->executor->Post("metrics", [path]() {
+    if (!ProcessMetrics().WriteFile(path)) {
+      g_warning("Failed to write metrics to %s", path.c_str());
+    }
+  });
+}
+
+static gboolean metrics_timer_cb(gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  if (self->metrics_path != nullptr) {
+    write_metrics(self);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static void stop_metrics_timer(MyApplication* self) {
+  if (self->metrics_timer != 0) {
+    g_source_remove(self->metrics_timer);
+    self->metrics_timer = 0;
+  }
+}
+
+// "start" {path, intervalMs} writes the runner's metrics to |path| now and
+// then every interval; "stop" ends that; "write" writes once more and
+// answers whether it worked.
+static void metrics_method_call_cb(FlMethodChannel* channel,
+                                   FlMethodCall* method_call,
+                                   gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+  const bool has_map = fl_value_get_type(args) == FL_VALUE_TYPE_MAP;
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "start") == 0) {
+    const gchar* path = has_map ? lookup_string(args, "path") : nullptr;
+    const int64_t interval_ms =
+        has_map ? lookup_int(args, "intervalMs", 15000) : 15000;
+    if (path == nullptr || *path == '\0' || interval_ms < 100) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Path and an interval of 100 ms or more",
+          nullptr));
+    } else {
+      g_free(self->metrics_path);
+      self->metrics_path = g_strdup(path);
+      stop_metrics_timer(self);
+      self->metrics_timer = g_timeout_add(static_cast<guint>(interval_ms),
+                                          metrics_timer_cb, self);
+      write_metrics(self);
+      response = success_response(nullptr);
+    }
+  } else if (strcmp(method, "stop") == 0) {
+    stop_metrics_timer(self);
+    response = success_response(nullptr);
+  } else if (strcmp(method, "write") == 0) {
+    if (self->metrics_path == nullptr) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "NOT_STARTED", "Call start first", nullptr));
+    } else {
+      collect_metrics(self);
+      const std::string path = self->metrics_path;
+      auto written = std::make_shared<bool>(false);
+      respond_on_strand(
+          self, "metrics", method_call,
+          [path, written]() { *written = ProcessMetrics().WriteFile(path); },
+          [written]() {
+            g_autoptr(FlValue) result = fl_value_new_bool(*written);
+            return success_response(result);
+          });
+      return;
+    }
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+  respond(method_call, response, "metrics");
+}
+
+// Setup metrics channel
+static void setup_metrics_channel(MyApplication* self, FlView* view) {
+  FlEngine* engine = fl_view_get_engine(view);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_clear_object(&self->metrics_channel);
+  self->metrics_channel = fl_method_channel_new(
+      messenger, "pharm_parrot/metrics", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(
+      self->metrics_channel, metrics_method_call_cb, self, nullptr);
+}
+
+// Keys held back by the keyboard-wedge detector, on the main loop only.
+struct KeyWedge {
+  KeyBurstDetector detector;
+  // Weak: cleared if the window goes first
+  GtkWidget* window = nullptr;
+  // Copies of the held presses and releases, in arrival order
+  std::vector<GdkEvent*> held;
+  // Keys whose press is held and still down, and keys whose press was
+  // dropped with a scan: their releases follow the press
+  std::set<guint16> held_down;
+  std::set<guint16> dropped_down;
+  guint timer = 0;
+  // Set while held keys are re-sent, so the handler lets them through
+  bool replaying = false;
+  // GdkEventKey::time (ms, 32 bits) unwrapped
+  int64_t clock_ms = 0;
+  guint32 last_time = 0;
+  int64_t burst_begin_ns = 0;
+  uint64_t scans = 0;
+  uint64_t typed_bursts = 0;
+};
+
+static void drop_held_keys(KeyWedge* wedge) {
+  for (GdkEvent* event : wedge->held) {
+    gdk_event_free(event);
+  }
+  wedge->held.clear();
+  wedge->dropped_down.insert(wedge->held_down.begin(), wedge->held_down.end());
+  wedge->held_down.clear();
+}
+
+// Sends the held keys on to the view as if they had just arrived.
+static void release_held_keys(KeyWedge* wedge) {
+  std::vector<GdkEvent*> held;
+  held.swap(wedge->held);
+  wedge->held_down.clear();
+  wedge->replaying = true;
+  for (GdkEvent* event : held) {
+    gtk_widget_event(wedge->window, event);
+    gdk_event_free(event);
+  }
+  wedge->replaying = false;
+  ++wedge->typed_bursts;
+}
+
+// A scan typed by a keyboard-wedge scanner, sent as {line, scanId}.
+static void deliver_keyboard_scan(MyApplication* self,
+                                  const std::string& code) {
+  static MetricCounter& scans = ProcessMetrics().GetCounter(
+      "pharm_keyboard_scans_total", {}, "Scans typed by keyboard scanners");
+  scans.Add();
+  ++self->key_wedge->scans;
+  g_autoptr(FlValue) event = fl_value_new_map();
+  fl_value_set_string_take(event, "line",
+                           fl_value_new_string_sized(code.data(), code.size()));
+  TraceRecorder& trace = ProcessTraceRecorder();
+  if (trace.enabled() && self->key_wedge->burst_begin_ns != 0) {
+    const uint64_t scan_id = TraceRecorder::NextScanId();
+    trace.Record("keyboard.burst", scan_id, self->key_wedge->burst_begin_ns,
+                 TraceRecorder::NowNs());
+    fl_value_set_string_take(event, "scanId",
+                             fl_value_new_int(static_cast<int64_t>(scan_id)));
+  }
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(self->keyboard_scanner_event_channel, event,
+                             nullptr, &error)) {
+    g_warning("Failed to send keyboard scan: %s", error->message);
+  }
+}
+
+static void apply_key_burst(MyApplication* self,
+                            const KeyBurstResult& result) {
+  if (result.release_held) {
+    release_held_keys(self->key_wedge);
+  } else if (!result.barcode.empty()) {
+    drop_held_keys(self->key_wedge);
+    deliver_keyboard_scan(self, result.barcode);
+  }
+}
+
+static gboolean key_burst_timeout_cb(gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  self->key_wedge->timer = 0;
+  apply_key_burst(self, self->key_wedge->detector.OnTimeout());
+  return G_SOURCE_REMOVE;
+}
+
+static KeyKind classify_key(const GdkEventKey* event,
+                            const KeyBurstOptions& options,
+                            uint32_t* code_point) {
+  *code_point = 0;
+  if (event->is_modifier) {
+    return KeyKind::kModifier;
+  }
+  const guint state = event->state & gtk_accelerator_get_default_mod_mask();
+  switch (event->keyval) {
+    case GDK_KEY_Return:
+    case GDK_KEY_KP_Enter:
+    case GDK_KEY_ISO_Enter:
+      return state == 0 ? KeyKind::kTerminator : KeyKind::kOther;
+    case GDK_KEY_Tab:
+      return state == 0 && options.end_on_tab ? KeyKind::kTerminator
+                                              : KeyKind::kOther;
+    case GDK_KEY_bracketright:
+      // Ctrl+] is how HID scanners type the GS1 group separator
+      if (state == GDK_CONTROL_MASK) {
+        *code_point = 0x1d;
+        return KeyKind::kCharacter;
+      }
+      break;
+    default:
+      break;
+  }
+  if ((state & ~GDK_SHIFT_MASK) != 0) {
+    return KeyKind::kOther;
+  }
+  *code_point = gdk_keyval_to_unicode(event->keyval);
+  return *code_point >= 0x20 && *code_point != 0x7f ? KeyKind::kCharacter
+                                                     : KeyKind::kOther;
+}
+
+// Runs on the window before the view sees the key.
+static gboolean window_key_event_cb(GtkWidget* widget, GdkEventKey* event,
+                                    gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  KeyWedge* wedge = self->key_wedge;
+  if (wedge->replaying) {
+    return FALSE;
+  }
+  const guint16 key = event->hardware_keycode;
+  if (event->type == GDK_KEY_RELEASE) {
+    if (wedge->dropped_down.erase(key) > 0) {
+      return TRUE;
+    }
+    if (wedge->held_down.erase(key) > 0) {
+      wedge->held.push_back(gdk_event_copy(reinterpret_cast<GdkEvent*>(event)));
+      return TRUE;
+    }
+    return FALSE;
+  }
+  if (!self->keyboard_scanner_enabled || !self->keyboard_scanner_listening) {
+    return FALSE;
+  }
+
+  wedge->clock_ms += static_cast<guint32>(event->time - wedge->last_time);
+  wedge->last_time = event->time;
+  uint32_t code_point = 0;
+  const KeyKind kind =
+      classify_key(event, wedge->detector.options(), &code_point);
+  const KeyBurstResult result =
+      wedge->detector.OnPress(kind, code_point, wedge->clock_ms);
+  apply_key_burst(self, result);
+
+  gboolean handled = FALSE;
+  if (result.key == KeyBurstResult::Key::kHold) {
+    if (wedge->held.empty()) {
+      wedge->burst_begin_ns = TraceRecorder::NowNs();
+    }
+    wedge->held.push_back(gdk_event_copy(reinterpret_cast<GdkEvent*>(event)));
+    wedge->held_down.insert(key);
+    handled = TRUE;
+  } else if (result.key == KeyBurstResult::Key::kDrop) {
+    wedge->dropped_down.insert(key);
+    handled = TRUE;
+  }
+
+  if (wedge->timer != 0) {
+    g_source_remove(wedge->timer);
+    wedge->timer = 0;
+  }
+  if (wedge->detector.holding()) {
+    wedge->timer =
+        g_timeout_add(static_cast<guint>(wedge->detector.options().max_gap_ms),
+                      key_burst_timeout_cb, self);
+  }
+  return handled;
+}
+
+// Held keys go on to the view when the window loses focus.
+static gboolean window_focus_out_cb(GtkWidget* widget, GdkEvent* event,
+                                    gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  if (self->key_wedge->timer != 0) {
+    g_source_remove(self->key_wedge->timer);
+    self->key_wedge->timer = 0;
+  }
+  apply_key_burst(self, self->key_wedge->detector.Release());
+  return FALSE;
+}
+
+static FlMethodErrorResponse* keyboard_scanner_listen_cb(
+    FlEventChannel* channel, FlValue* args, gpointer user_data) {
+  MY_APPLICATION(user_data)->keyboard_scanner_listening = TRUE;
+  return nullptr;
+}
+
+static FlMethodErrorResponse* keyboard_scanner_cancel_cb(
+    FlEventChannel* channel, FlValue* args, gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  self->keyboard_scanner_listening = FALSE;
+  apply_key_burst(self, self->key_wedge->detector.Release());
+  return nullptr;
+}
+
+// "configure" {enabled, maxGapMs, minLength, endOnTab}, missing fields
+// unchanged; "getStats" answers with the settings and counters.
+static void keyboard_scanner_method_call_cb(FlMethodChannel* channel,
+                                            FlMethodCall* method_call,
+                                            gpointer user_data) {
+  MyApplication* self = MY_APPLICATION(user_data);
+  ChannelCallTimer timer("keyboard_scanner", method_call);
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+  KeyWedge* wedge = self->key_wedge;
+  KeyBurstOptions options = wedge->detector.options();
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "configure") == 0) {
+    if (fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      FlValue* enabled = fl_value_lookup_string(args, "enabled");
+      if (enabled != nullptr &&
+          fl_value_get_type(enabled) == FL_VALUE_TYPE_BOOL) {
+        self->keyboard_scanner_enabled = fl_value_get_bool(enabled);
+      }
+      FlValue* end_on_tab = fl_value_lookup_string(args, "endOnTab");
+      if (end_on_tab != nullptr &&
+          fl_value_get_type(end_on_tab) == FL_VALUE_TYPE_BOOL) {
+        options.end_on_tab = fl_value_get_bool(end_on_tab);
+      }
+      options.max_gap_ms = std::max<int64_t>(
+          1, lookup_int(args, "maxGapMs", options.max_gap_ms));
+      options.min_length = static_cast<size_t>(std::max<int64_t>(
+          1, lookup_int(args, "minLength",
+                        static_cast<int64_t>(options.min_length))));
+    }
+    wedge->detector.SetOptions(options);
+    if (!self->keyboard_scanner_enabled) {
+      apply_key_burst(self, wedge->detector.Release());
+    }
+    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+    response = success_response(result);
+  } else if (strcmp(method, "getStats") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "enabled",
+                             fl_value_new_bool(self->keyboard_scanner_enabled));
+    fl_value_set_string_take(result, "maxGapMs",
+                             fl_value_new_int(options.max_gap_ms));
+    fl_value_set_string_take(
+        result, "minLength",
+        fl_value_new_int(static_cast<int64_t>(options.min_length)));
+    fl_value_set_string_take(result, "endOnTab",
+                             fl_value_new_bool(options.end_on_tab));
+    fl_value_set_string_take(
+        result, "scans", fl_value_new_int(static_cast<int64_t>(wedge->scans)));
+    fl_value_set_string_take(
+        result, "typedBursts",
+        fl_value_new_int(static_cast<int64_t>(wedge->typed_bursts)));
+    response = success_response(result);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+  respond(method_call, response, "keyboard_scanner");
+}
+
+// Setup keyboard-wedge scanner channel and key interception
+static void setup_keyboard_scanner_channel(MyApplication* self, FlView* view,
+                                           GtkWindow* window) {
+  FlEngine* engine = fl_view_get_engine(view);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_clear_object(&self->keyboard_scanner_channel);
+  self->keyboard_scanner_channel = fl_method_channel_new(
+      messenger, "pharm_parrot/keyboard_scanner", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->keyboard_scanner_channel,
+                                            keyboard_scanner_method_call_cb,
+                                            self, nullptr);
+
+  g_clear_object(&self->keyboard_scanner_event_channel);
+  self->keyboard_scanner_event_channel =
+      fl_event_channel_new(messenger, "pharm_parrot/keyboard_scanner/events",
+                           FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(
+      self->keyboard_scanner_event_channel, keyboard_scanner_listen_cb,
+      keyboard_scanner_cancel_cb, self, nullptr);
+
+  // Before the window's own handler, which passes keys to the focused view
+  self->key_wedge->window = GTK_WIDGET(window);
+  g_object_add_weak_pointer(
+      G_OBJECT(window), reinterpret_cast<gpointer*>(&self->key_wedge->window));
+  g_signal_connect(window, "key-press-event",
+                   G_CALLBACK(window_key_event_cb), self);
+  g_signal_connect(window, "key-release-event",
+                   G_CALLBACK(window_key_event_cb), self);
+  g_signal_connect(window, "focus-out-event",
+                   G_CALLBACK(window_focus_out_cb), self);
 }
 
 // Implements GApplication::activate.
 static void my_application_activate(GApplication* application) {
   MyApplication* self = MY_APPLICATION(application);
+  mark_startup_phase(self, "activate");
   GtkWindow* window =
       GTK_WINDOW(gtk_application_window_new(GTK_APPLICATION(application)));
 
@@ -57,8 +1713,11 @@ static void my_application_activate(GApplication* application) {
 
   g_autoptr(FlDartProject) project = fl_dart_project_new();
   fl_dart_project_set_dart_entrypoint_arguments(project, self->dart_entrypoint_arguments);
+  mark_startup_phase(self, "dart_project");
 
+  // Starts the engine, which loads the AOT snapshot
   FlView* view = fl_view_new(project);
+  mark_startup_phase(self, "view_created");
   GdkRGBA background_color;
   // Background defaults to black, override it here if necessary, e.g. #00000000 for transparent.
   gdk_rgba_parse(&background_color, "#000000");
@@ -70,8 +1729,38 @@ static void my_application_activate(GApplication* application) {
   // Requires the view to be realized so we can start rendering.
   g_signal_connect_swapped(view, "first-frame", G_CALLBACK(first_frame_cb), self);
   gtk_widget_realize(GTK_WIDGET(view));
+  mark_startup_phase(self, "view_realized");
 
   fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+  mark_startup_phase(self, "plugins_registered");
+
+  // Before the other channels so that Dart can mark phases from main()
+  setup_startup_channel(self, view);
+
+  // Setup COM Port platform channel
+  setup_comport_channel(self, view);
+
+  // Setup TTS platform channel
+  setup_tts_channel(self, view);
+
+  // Setup executor stats channel
+  setup_executor_channel(self, view);
+
+  // Setup RPC gateway channel
+  setup_rpc_channel(self, view);
+
+  // Setup multi-port serial channel
+  setup_serial_channel(self, view);
+
+  // Setup scan trace channel
+  setup_trace_channel(self, view);
+
+  // Setup metrics channel
+  setup_metrics_channel(self, view);
+
+  // Setup keyboard-wedge scanner channel
+  setup_keyboard_scanner_channel(self, view, window);
+  mark_startup_phase(self, "channels_ready");
 
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
@@ -117,6 +1806,81 @@ static void my_application_shutdown(GApplication* application) {
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+  g_clear_object(&self->comport_channel);
+  g_clear_object(&self->comport_event_channel);
+  g_clear_object(&self->tts_channel);
+  g_clear_object(&self->executor_channel);
+  g_clear_object(&self->startup_channel);
+  g_clear_object(&self->rpc_channel);
+  g_clear_object(&self->serial_channel);
+  g_clear_object(&self->serial_event_channel);
+  g_clear_object(&self->trace_channel);
+  g_clear_object(&self->metrics_channel);
+  g_clear_object(&self->keyboard_scanner_channel);
+  g_clear_object(&self->keyboard_scanner_event_channel);
+  g_clear_pointer(&self->startup_report_phase, g_free);
+  stop_metrics_timer(self);
+  g_clear_pointer(&self->metrics_path, g_free);
+  // Answer every outstanding call before the handlers go away. The gateway
+  // posts its "shutdown" answers to main_queue, drained below.
+  if (self->rpc_gateway != nullptr) {
+    delete self->rpc_gateway;
+    self->rpc_gateway = nullptr;
+  }
+  if (self->executor != nullptr) {
+    self->executor->CancelStrand("comport");
+    self->executor->CancelStrand("serial");
+    // A metrics write still waiting is dropped; the last file stays.
+    self->executor->CancelStrand("metrics");
+    // Closing the capture below writes what a dropped flush would have.
+    self->executor->CancelStrand("capture");
+    delete self->executor;
+    self->executor = nullptr;
+    // No strand uses the reactor now; its last lines are posted before
+    // the drain and delivered to nobody.
+    delete self->serial_reactor;
+    self->serial_reactor = nullptr;
+    self->main_queue->Drain();
+    g_idle_remove_by_data(self);
+  }
+  if (self->main_queue != nullptr) {
+    delete self->main_queue;
+    self->main_queue = nullptr;
+  }
+  if (self->com_port_handler != nullptr) {
+    delete self->com_port_handler;
+    self->com_port_handler = nullptr;
+  }
+  if (self->serial_capture_timer != 0) {
+    g_source_remove(self->serial_capture_timer);
+    self->serial_capture_timer = 0;
+  }
+  if (self->serial_capture != nullptr) {
+    delete self->serial_capture;
+    self->serial_capture = nullptr;
+  }
+  if (self->tts_handler != nullptr) {
+    delete self->tts_handler;
+    self->tts_handler = nullptr;
+  }
+  if (self->key_wedge != nullptr) {
+    // The window's key handlers use key_wedge
+    GtkWidget* window = self->key_wedge->window;
+    if (window != nullptr) {
+      g_signal_handlers_disconnect_by_data(window, self);
+      g_object_remove_weak_pointer(
+          G_OBJECT(window),
+          reinterpret_cast<gpointer*>(&self->key_wedge->window));
+    }
+    if (self->key_wedge->timer != 0) {
+      g_source_remove(self->key_wedge->timer);
+    }
+    for (GdkEvent* event : self->key_wedge->held) {
+      gdk_event_free(event);
+    }
+    delete self->key_wedge;
+    self->key_wedge = nullptr;
+  }
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
@@ -128,7 +1892,46 @@ static void my_application_class_init(MyApplicationClass* klass) {
   G_OBJECT_CLASS(klass)->dispose = my_application_dispose;
 }
 
-static void my_application_init(MyApplication* self) {}
+static void my_application_init(MyApplication* self) {
+  self->com_port_handler = new ComPortHandler();
+  self->tts_handler = new TtsHandler();
+  // Woken from worker threads; drains on the main loop.
+  self->main_queue = new MainThreadQueue([self]() {
+    g_idle_add_full(G_PRIORITY_DEFAULT, main_queue_drain_cb, self, nullptr);
+  });
+  self->executor = new TaskExecutor();
+  // Keys pass straight through until "configure" turns detection on
+  self->key_wedge = new KeyWedge();
+
+  ProcessTraceRecorder().SetThreadName("platform");
+  const char* trace = getenv("PHARM_TRACE");
+  if (trace != nullptr && strcmp(trace, "1") == 0) {
+    ProcessTraceRecorder().SetEnabled(true);
+  }
+
+  const char* capture = getenv("PHARM_SERIAL_CAPTURE");
+  if (capture != nullptr && *capture != '\0') {
+    self->serial_capture = new SerialCaptureWriter();
+    if (self->serial_capture->Open(capture)) {
+      self->com_port_handler->SetCapture(self->serial_capture);
+      self->serial_capture_timer =
+          g_timeout_add(SerialCaptureWriter::kFlushIntervalMs,
+                        serial_capture_timer_cb, self);
+    } else {
+      g_warning("Cannot write serial capture %s", capture);
+      delete self->serial_capture;
+      self->serial_capture = nullptr;
+    }
+  }
+
+  // PHARM_STARTUP_BENCHMARK=<phase> (or 1 for first_frame) prints the
+  // timeline for startup_bench once <phase> is reached and quits.
+  const char* benchmark = getenv("PHARM_STARTUP_BENCHMARK");
+  self->startup_benchmark = benchmark != nullptr && *benchmark != '\0';
+  self->startup_report_phase = g_strdup(
+      self->startup_benchmark && strcmp(benchmark, "1") != 0 ? benchmark
+                                                             : "first_frame");
+}
 
 MyApplication* my_application_new() {
   // Set the program name to the application ID, which helps various systems
@@ -0,0 +1,75 @@
+#include "pulse_audio_sink.h"
+
+#include <glib.h>
+#include <pulse/error.h>
+
+namespace {
+
+// Target buffer length. Short, so an interrupted utterance stops promptly
+// and Write() paces synthesis closely to playback.
+constexpr pa_usec_t kTargetLatencyUs = 80 * 1000;
+
+}  // namespace
+
+PulseAudioSink::~PulseAudioSink() { CloseStream(); }
+
+bool PulseAudioSink::Begin(int sample_rate) {
+  if (stream_ != nullptr && sample_rate == sample_rate_) {
+    return true;
+  }
+  CloseStream();
+
+  pa_sample_spec spec;
+  spec.format = PA_SAMPLE_S16LE;
+  spec.rate = static_cast<uint32_t>(sample_rate);
+  spec.channels = 1;
+  pa_buffer_attr attr;
+  attr.maxlength = static_cast<uint32_t>(-1);
+  attr.tlength = static_cast<uint32_t>(pa_usec_to_bytes(kTargetLatencyUs, &spec));
+  attr.prebuf = static_cast<uint32_t>(-1);
+  attr.minreq = static_cast<uint32_t>(-1);
+  attr.fragsize = static_cast<uint32_t>(-1);
+
+  int error = 0;
+  stream_ = pa_simple_new(nullptr, "pharm_parrot", PA_STREAM_PLAYBACK, nullptr,
+                          "tts", &spec, nullptr, &attr, &error);
+  if (stream_ == nullptr) {
+    g_warning("PulseAudio stream failed: %s", pa_strerror(error));
+    return false;
+  }
+  sample_rate_ = sample_rate;
+  return true;
+}
+
+bool PulseAudioSink::Write(const int16_t* samples, size_t count) {
+  if (stream_ == nullptr) {
+    return false;
+  }
+  int error = 0;
+  if (pa_simple_write(stream_, samples, count * sizeof(int16_t), &error) < 0) {
+    g_warning("PulseAudio write failed: %s", pa_strerror(error));
+    // Reconnect on the next utterance, e.g. after the server restarted.
+    CloseStream();
+    return false;
+  }
+  return true;
+}
+
+void PulseAudioSink::End(bool drain) {
+  if (stream_ == nullptr) {
+    return;
+  }
+  int error = 0;
+  if (drain) {
+    pa_simple_drain(stream_, &error);
+  } else {
+    pa_simple_flush(stream_, &error);
+  }
+}
+
+void PulseAudioSink::CloseStream() {
+  if (stream_ != nullptr) {
+    pa_simple_free(stream_);
+    stream_ = nullptr;
+  }
+}
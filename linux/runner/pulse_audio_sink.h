@@ -0,0 +1,30 @@
+#ifndef RUNNER_PULSE_AUDIO_SINK_H_
+#define RUNNER_PULSE_AUDIO_SINK_H_
+
+#include <pulse/simple.h>
+
+#include "native/audio_sink.h"
+
+// Plays utterances through the PulseAudio simple API (also served by
+// PipeWire). The stream is opened on first use and kept, so only the first
+// utterance pays for connecting to the server.
+class PulseAudioSink : public AudioSink {
+ public:
+  PulseAudioSink() = default;
+  ~PulseAudioSink() override;
+
+  PulseAudioSink(const PulseAudioSink&) = delete;
+  PulseAudioSink& operator=(const PulseAudioSink&) = delete;
+
+  bool Begin(int sample_rate) override;
+  bool Write(const int16_t* samples, size_t count) override;
+  void End(bool drain) override;
+
+ private:
+  void CloseStream();
+
+  pa_simple* stream_ = nullptr;
+  int sample_rate_ = 0;
+};
+
+#endif  // RUNNER_PULSE_AUDIO_SINK_H_
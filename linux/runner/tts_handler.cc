@@ -0,0 +1,127 @@
+#include "tts_handler.h"
+
+#include <glib.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "native/metrics_registry.h"
+
+#ifdef HAVE_ESPEAK_NG
+#include "espeak_engine.h"
+#endif
+#ifdef HAVE_PULSE_SIMPLE
+#include "pulse_audio_sink.h"
+#endif
+
+namespace {
+
+// About 4 minutes of 22 kHz speech
+constexpr size_t kCacheBudgetBytes = 12 * 1024 * 1024;
+
+#ifdef HAVE_ESPEAK_NG
+constexpr char kVoice[] = "ko";
+constexpr int kWordsPerMinute = 190;
+#endif
+
+// Stands in when there is no speech engine, so that beeps still play.
+class NoSpeechEngine : public SpeechEngine {
+ public:
+  int sample_rate() const override { return 22050; }
+  bool Synthesize(const std::string& text,
+                  const AudioCallback& on_audio) override {
+    return false;
+  }
+};
+
+// Beep tones used by the app, rendered when the channel is created.
+constexpr int kCommonBeeps[][2] = {
+    {500, 500}, {900, 300}, {1000, 400}, {1500, 1200}, {1600, 1200}};
+
+std::unique_ptr<AudioSink> CreateSink() {
+  const char* choice = getenv("PHARM_TTS_SINK");
+  if (choice != nullptr && strcmp(choice, "null") == 0) {
+    return std::make_unique<NullAudioSink>(/*paced=*/true);
+  }
+  if (choice != nullptr && strncmp(choice, "file:", 5) == 0) {
+    return std::make_unique<WavFileSink>(choice + 5);
+  }
+#ifdef HAVE_PULSE_SIMPLE
+  return std::make_unique<PulseAudioSink>();
+#else
+  g_warning("Built without PulseAudio; speech is discarded");
+  return std::make_unique<NullAudioSink>();
+#endif
+}
+
+}  // namespace
+
+TtsHandler::TtsHandler() {
+#ifdef HAVE_ESPEAK_NG
+  auto engine = std::make_unique<EspeakEngine>();
+  if (engine->Initialize(kVoice, kWordsPerMinute)) {
+    engine_ = std::move(engine);
+    speech_available_ = true;
+  } else {
+    g_warning("espeak-ng failed to initialize; TTS disabled");
+  }
+#else
+  g_warning("Built without espeak-ng; TTS disabled");
+#endif
+  if (engine_ == nullptr) {
+    engine_ = std::make_unique<NoSpeechEngine>();
+  }
+  cache_ =
+      std::make_unique<CachingSpeechEngine>(engine_.get(), kCacheBudgetBytes);
+  sink_ = CreateSink();
+  SpeechSchedulerOptions options;
+  options.queue_delay = &ProcessMetrics().GetHistogram(
+      "pharm_tts_queue_delay_seconds", {},
+      "Speak() to the start of playback, including the wait behind other "
+      "utterances");
+  options.first_audio = &ProcessMetrics().GetHistogram(
+      "pharm_tts_first_audio_seconds", {}, "Speak() to the first samples");
+  scheduler_ = std::make_unique<SpeechScheduler>(cache_.get(), sink_.get(),
+                                                 options);
+  tones_ = std::make_unique<ToneGenerator>(scheduler_->sample_rate());
+  for (const auto& beep : kCommonBeeps) {
+    tones_->Get(beep[0], beep[1]);
+  }
+}
+
+TtsHandler::~TtsHandler() {
+  // Threads go first: the scheduler uses the cache and the sink, and the
+  // cache's warmer uses the engine.
+  scheduler_.reset();
+  cache_.reset();
+}
+
+void TtsHandler::Speak(const std::string& text, SpeechPriority priority) {
+  if (speech_available_) {
+    scheduler_->Speak(text, priority);
+  }
+}
+
+void TtsHandler::Beep(int frequency, int duration_ms,
+                      SpeechPriority priority) {
+  scheduler_->Play(tones_->Get(frequency, duration_ms),
+                   "beep:" + std::to_string(frequency) + ":" +
+                       std::to_string(duration_ms),
+                   priority);
+}
+
+void TtsHandler::Stop() { scheduler_->Stop(); }
+
+void TtsHandler::Warm(const std::vector<std::string>& texts) {
+  if (speech_available_) {
+    cache_->Warm(texts);
+  }
+}
+
+SpeechSchedulerStats TtsHandler::GetStats() const {
+  return scheduler_->GetStats();
+}
+
+CachingSpeechEngineStats TtsHandler::GetCacheStats() const {
+  return cache_->GetStats();
+}
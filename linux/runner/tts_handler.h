@@ -0,0 +1,52 @@
+#ifndef RUNNER_TTS_HANDLER_H_
+#define RUNNER_TTS_HANDLER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "native/audio_sink.h"
+#include "native/speech_cache.h"
+#include "native/speech_scheduler.h"
+#include "native/tone_generator.h"
+
+// Linux side of the "pharm_parrot/tts" channel.
+//
+// Speech goes through a SpeechScheduler so that rapid scans queue, coalesce
+// and preempt by class instead of cutting each other off. Announcements are
+// assembled from cached per-segment audio (drug names, numbers, units), so
+// a repeated phrase starts playing without synthesis. Beeps are rendered
+// once and queued on the same scheduler, so no call waits for playback.
+//
+// The engine is espeak-ng and the sink PulseAudio when the runner was built
+// with them. PHARM_TTS_SINK overrides the sink: "null" discards audio at
+// playback speed and "file:<path>" writes a WAV file.
+class TtsHandler {
+ public:
+  TtsHandler();
+  ~TtsHandler();
+
+  // False when no speech engine is available; Speak() then does nothing,
+  // but beeps still play.
+  bool IsAvailable() const { return speech_available_; }
+
+  void Speak(const std::string& text, SpeechPriority priority);
+  void Beep(int frequency, int duration_ms, SpeechPriority priority);
+  void Stop();
+  // Renders the segments of |texts| in the background, e.g. every drug line
+  // of a prescription when it is loaded.
+  void Warm(const std::vector<std::string>& texts);
+
+  SpeechSchedulerStats GetStats() const;
+  CachingSpeechEngineStats GetCacheStats() const;
+
+ private:
+  bool speech_available_ = false;
+  std::unique_ptr<SpeechEngine> engine_;
+  std::unique_ptr<CachingSpeechEngine> cache_;
+  std::unique_ptr<AudioSink> sink_;
+  std::unique_ptr<SpeechScheduler> scheduler_;
+  std::unique_ptr<ToneGenerator> tones_;
+};
+
+#endif  // RUNNER_TTS_HANDLER_H_
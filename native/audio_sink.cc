@@ -0,0 +1,98 @@
+#include "native/audio_sink.h"
+
+#include <chrono>
+#include <thread>
+#include <utility>
+
+std::string MakeWavHeader(int sample_rate, uint64_t samples) {
+  const uint32_t data_bytes = static_cast<uint32_t>(samples * 2);
+  const uint32_t rate = static_cast<uint32_t>(sample_rate);
+  struct {
+    char riff[4];
+    uint32_t riff_size;
+    char wave[4];
+    char fmt[4];
+    uint32_t fmt_size;
+    uint16_t format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits;
+    char data[4];
+    uint32_t data_size;
+  } header = {{'R', 'I', 'F', 'F'}, 36 + data_bytes, {'W', 'A', 'V', 'E'},
+              {'f', 'm', 't', ' '}, 16, 1, 1, rate, rate * 2, 2, 16,
+              {'d', 'a', 't', 'a'}, data_bytes};
+  static_assert(sizeof(header) == 44, "WAV header must not be padded");
+  return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+bool NullAudioSink::Begin(int sample_rate) {
+  ++utterances_;
+  sample_rate_ = sample_rate;
+  return sample_rate > 0;
+}
+
+bool NullAudioSink::Write(const int16_t* samples, size_t count) {
+  samples_ += count;
+  if (paced_) {
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(count * 1000000 / sample_rate_));
+  }
+  return true;
+}
+
+void NullAudioSink::End(bool drain) {
+  if (!drain) {
+    ++interrupted_;
+  }
+}
+
+WavFileSink::WavFileSink(std::string path) : path_(std::move(path)) {}
+
+WavFileSink::~WavFileSink() {
+  if (file_ != nullptr) {
+    fclose(file_);
+  }
+}
+
+bool WavFileSink::Begin(int sample_rate) {
+  if (sample_rate <= 0) {
+    return false;
+  }
+  if (file_ == nullptr) {
+    file_ = fopen(path_.c_str(), "wb");
+    if (file_ == nullptr) {
+      return false;
+    }
+    sample_rate_ = sample_rate;
+    WriteHeader();
+  }
+  // One file has one rate; the engine does not change it between calls.
+  return sample_rate == sample_rate_;
+}
+
+bool WavFileSink::Write(const int16_t* samples, size_t count) {
+  if (file_ == nullptr || fwrite(samples, sizeof(int16_t), count, file_) !=
+                              count) {
+    return false;
+  }
+  samples_ += count;
+  return true;
+}
+
+void WavFileSink::End(bool drain) {
+  if (file_ == nullptr) {
+    return;
+  }
+  WriteHeader();
+  fseek(file_, 0, SEEK_END);
+  fflush(file_);
+}
+
+void WavFileSink::WriteHeader() {
+  const std::string header = MakeWavHeader(sample_rate_, samples_);
+  fseek(file_, 0, SEEK_SET);
+  fwrite(header.data(), header.size(), 1, file_);
+}
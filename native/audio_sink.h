@@ -0,0 +1,80 @@
+#ifndef NATIVE_AUDIO_SINK_H_
+#define NATIVE_AUDIO_SINK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Mono 16-bit PCM at the engine's sample rate.
+using PcmBuffer = std::vector<int16_t>;
+
+// 44-byte RIFF/WAVE header for |samples| mono 16-bit samples.
+std::string MakeWavHeader(int sample_rate, uint64_t samples);
+
+// Destination of synthesized mono 16-bit PCM. One utterance is one
+// Begin() ... Write()* ... End() sequence; calls come from a single thread.
+class AudioSink {
+ public:
+  virtual ~AudioSink() = default;
+
+  virtual bool Begin(int sample_rate) = 0;
+  // Blocks while the device buffer is full, which paces synthesis to
+  // playback. Returns false if the samples could not be played.
+  virtual bool Write(const int16_t* samples, size_t count) = 0;
+  // |drain| waits for queued audio to finish playing; otherwise queued
+  // audio is discarded (the utterance was interrupted).
+  virtual void End(bool drain) = 0;
+};
+
+// Discards audio, counting what it was given. For tests and headless runs.
+// With |paced|, Write() takes as long as playing the samples would, like a
+// device whose buffer is full.
+class NullAudioSink : public AudioSink {
+ public:
+  explicit NullAudioSink(bool paced = false) : paced_(paced) {}
+
+  bool Begin(int sample_rate) override;
+  bool Write(const int16_t* samples, size_t count) override;
+  void End(bool drain) override;
+
+  uint64_t utterances() const { return utterances_; }
+  uint64_t samples() const { return samples_; }
+  uint64_t interrupted() const { return interrupted_; }
+
+ private:
+  const bool paced_;
+  int sample_rate_ = 0;
+  uint64_t utterances_ = 0;
+  uint64_t samples_ = 0;
+  uint64_t interrupted_ = 0;
+};
+
+// Appends every utterance to one WAV file, for listening to what the
+// scheduler produced without an audio device. The header is rewritten after
+// each utterance, so the file is playable at any point.
+class WavFileSink : public AudioSink {
+ public:
+  explicit WavFileSink(std::string path);
+  ~WavFileSink() override;
+
+  WavFileSink(const WavFileSink&) = delete;
+  WavFileSink& operator=(const WavFileSink&) = delete;
+
+  bool Begin(int sample_rate) override;
+  bool Write(const int16_t* samples, size_t count) override;
+  void End(bool drain) override;
+
+  uint64_t samples() const { return samples_; }
+
+ private:
+  void WriteHeader();
+
+  std::string path_;
+  FILE* file_ = nullptr;
+  int sample_rate_ = 0;
+  uint64_t samples_ = 0;
+};
+
+#endif  // NATIVE_AUDIO_SINK_H_
@@ -0,0 +1,85 @@
+// Throughput of ParseGs1 and of the FFI batch entry point on a synthetic
+// scan log, i.e. the audit replay workload.
+//
+// Usage: gs1_parser_bench [codes]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/gs1_parser.h"
+
+namespace {
+
+// Mix of bracketed, FNC1/GS DataMatrix and plain EAN-13 codes.
+std::vector<std::string> MakeCodes(size_t count) {
+  std::vector<std::string> codes;
+  codes.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::string serial = std::to_string(100000000 + i * 7919);
+    switch (i % 4) {
+      case 0:
+        codes.push_back("]d2010880646900731217261231" "10LOT" +
+                        std::to_string(i % 997) + "\x1d" "21" + serial);
+        break;
+      case 1:
+        codes.push_back("(01)08806469007312(21)" + serial);
+        break;
+      case 2:
+        codes.push_back("0108806469007312" "21" + serial + "\x1d" "17270630");
+        break;
+      default:
+        codes.push_back("8806469007312");
+        break;
+    }
+  }
+  return codes;
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  const std::vector<std::string> codes = MakeCodes(count);
+  const int iterations = 5;
+
+  size_t ok = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    for (const std::string& code : codes) {
+      Gs1Parse parse;
+      ok += ParseGs1(code, &parse) == Gs1Status::kOk;
+    }
+  }
+  double seconds = Seconds(start);
+  std::printf("%-12s %12.0f codes/s (%zu ok)\n", "parse",
+              count * iterations / seconds, ok);
+
+  std::string log;
+  for (const std::string& code : codes) {
+    log += code;
+    log += "\r\n";
+  }
+  std::vector<PharmGs1Record> records(count);
+  size_t written = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    written += pharm_gs1_parse_batch(log.data(),
+                                     static_cast<int32_t>(log.size()),
+                                     records.data(),
+                                     static_cast<int32_t>(records.size()));
+  }
+  seconds = Seconds(start);
+  std::printf("%-12s %12.0f codes/s %10.1f MB/s\n", "ffi batch",
+              written / seconds, log.size() * iterations / seconds / 1e6);
+  return 0;
+}
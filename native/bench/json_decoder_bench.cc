@@ -0,0 +1,190 @@
+// Compares decoding rxhead and get_miss_mached_drug RPC responses into typed
+// columns (RecordTable) with materializing them as a list of generic maps,
+// which is what jsonDecode hands the Dart side. The responses are synthetic,
+// sized like a busy day's worth of prescriptions.
+//
+// Usage: json_decoder_bench [rows]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "native/json_reader.h"
+#include "native/rpc_records.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocated_bytes{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+const char* const kDrugs[] = {
+    "\xed\x83\x80\xec\x9d\xb4\xeb\xa0\x88\xeb\x86\x80\xec\xa0\x95" "500mg",
+    "\xec\x95\x84\xec\x8a\xa4\xed\x94\xbc\xeb\xa6\xb0\xec\xa0\x95" "100mg",
+    "Amoxicillin Cap. 500mg",
+    "\xeb\xac\xb4\xec\xa2\x80\xec\x97\xb0\xea\xb3\xa0",
+};
+
+std::string MakeMissMatchedDrugs(size_t rows) {
+  std::string json = "[";
+  for (size_t i = 0; i < rows; ++i) {
+    if (i > 0) {
+      json += ',';
+    }
+    json += std::string("{\"product_name\":\"") + kDrugs[i % 4] + "\"";
+    json += ",\"location\":\"A-" + std::to_string(i % 40) + "\"}";
+  }
+  json += "]";
+  return json;
+}
+
+std::string MakeHeads(size_t rows) {
+  std::string json = "[";
+  for (size_t i = 0; i < rows; ++i) {
+    if (i > 0) {
+      json += ',';
+    }
+    json += "{\"tfn\":" + std::to_string(20240101000 + i);
+    json += ",\"no\":\"" + std::to_string(i % 300) + "\"";
+    json += ",\"pid\":\"P" + std::to_string(100000 + i) + "\"";
+    json += ",\"patient_name\":\"\xed\x99\x8d\xea\xb8\xb8\xeb\x8f\x99" +
+            std::to_string(i % 97) + "\"";
+    json += ",\"patient_birth\":\"1980-01-" + std::to_string(i % 28 + 10) +
+            "\"";
+    json += ",\"is_complete\":" + std::string(i % 3 ? "false" : "true") + "}";
+  }
+  json += "]";
+  return json;
+}
+
+// List<Map<String, dynamic>> in C++ terms.
+using Value = std::variant<std::nullptr_t, bool, double, std::string>;
+using Row = std::map<std::string, Value>;
+
+class DomHandler : public JsonHandler {
+ public:
+  explicit DomHandler(std::vector<Row>* rows) : rows_(rows) {}
+
+  bool StartObject() override {
+    if (++depth_ == 2) {
+      rows_->emplace_back();
+    }
+    return true;
+  }
+  bool EndObject() override {
+    --depth_;
+    return true;
+  }
+  bool StartArray() override {
+    ++depth_;
+    return true;
+  }
+  bool EndArray() override {
+    --depth_;
+    return true;
+  }
+  bool Key(std::string_view key) override {
+    key_.assign(key);
+    return true;
+  }
+  bool String(std::string_view value) override {
+    return Set(std::string(value));
+  }
+  bool Number(double value) override { return Set(value); }
+  bool Bool(bool value) override { return Set(value); }
+  bool Null() override { return Set(nullptr); }
+
+ private:
+  bool Set(Value value) {
+    if (depth_ == 2) {
+      rows_->back()[key_] = std::move(value);
+    }
+    return true;
+  }
+
+  std::vector<Row>* rows_;
+  size_t depth_ = 0;
+  std::string key_;
+};
+
+size_t DecodeDom(const std::string& json) {
+  std::vector<Row> rows;
+  DomHandler handler(&rows);
+  JsonReader reader(&handler);
+  reader.Feed(json);
+  reader.Finish();
+  return rows.size();
+}
+
+size_t DecodeTable(const std::string& json, RecordTable* table) {
+  table->Clear();
+  DecodeJsonRows(json, table);
+  return table->size();
+}
+
+template <typename Fn>
+void Run(const char* name, const std::string& json, int iterations, Fn fn) {
+  fn();  // warm-up: lets reused columns reach their final capacity
+  size_t rows = 0;
+  const uint64_t allocations_before = g_allocations.load();
+  const uint64_t bytes_before = g_allocated_bytes.load();
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    rows += fn();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  const double allocations =
+      static_cast<double>(g_allocations.load() - allocations_before);
+  const double bytes =
+      static_cast<double>(g_allocated_bytes.load() - bytes_before);
+  std::printf("%-18s %8.1f MB/s %9.1f ns/row %9.2f allocs/row %9.1f B/row\n",
+              name, json.size() * iterations / seconds / 1e6,
+              rows ? seconds * 1e9 / rows : 0.0, rows ? allocations / rows : 0,
+              rows ? bytes / rows : 0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+  const std::string heads = MakeHeads(rows);
+  const std::string drugs = MakeMissMatchedDrugs(rows);
+  const int iterations = 10;
+
+  std::printf("rxhead: %zu rows, %.1f MB\n", rows, heads.size() / 1e6);
+  RecordTable table(RxHeadSchema());
+  Run("maps", heads, iterations, [&]() { return DecodeDom(heads); });
+  Run("columns", heads, iterations,
+      [&]() { return DecodeTable(heads, &table); });
+
+  std::printf("get_miss_mached_drug: %zu rows, %.1f MB\n", rows,
+              drugs.size() / 1e6);
+  RecordTable drug_table(MissMatchedDrugSchema());
+  Run("maps", drugs, iterations, [&]() { return DecodeDom(drugs); });
+  Run("columns", drugs, iterations,
+      [&]() { return DecodeTable(drugs, &drug_table); });
+  return 0;
+}
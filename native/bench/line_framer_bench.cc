@@ -0,0 +1,152 @@
+// Compares LineFramer with the byte-at-a-time loop that
+// ComPortHandler::ReadThreadProc used before it, on a synthetic multiplexed
+// scanner feed delivered in 1 KB reads.
+//
+// Usage: line_framer_bench [lines]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <queue>
+#include <string>
+
+#include "native/line_framer.h"
+#include "native/spsc_ring.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+constexpr size_t kReadSize = 1024;
+
+// GS1 DataMatrix-like payloads with mixed CRLF / LF / CR terminators.
+std::string MakeFeed(size_t lines) {
+  static const char* kTerminators[] = {"\r\n", "\n", "\r"};
+  std::string feed;
+  for (size_t i = 0; i < lines; ++i) {
+    feed += "0108806469007312";
+    feed += "21";
+    feed += std::to_string(100000000 + i * 7919);
+    if (i % 3 == 0) {
+      feed += "17261231";
+      feed += "10LOT";
+      feed += std::to_string(i % 997);
+    }
+    feed += kTerminators[i % 3];
+  }
+  return feed;
+}
+
+// The pre-LineFramer ReadThreadProc loop, queue included.
+size_t LegacyFrame(const std::string& feed) {
+  std::string partial_line;
+  std::queue<std::string> data_queue;
+  size_t lines = 0;
+  for (size_t offset = 0; offset < feed.size(); offset += kReadSize) {
+    size_t bytes_read = std::min(kReadSize, feed.size() - offset);
+    std::string data(feed.data() + offset, bytes_read);
+    for (char c : data) {
+      partial_line += c;
+      if (c == '\n' || c == '\r') {
+        if (!partial_line.empty()) {
+          std::string line = partial_line;
+          line.erase(std::remove_if(line.begin(), line.end(),
+                                    [](char ch) {
+                                      return ch == '\r' || ch == '\n';
+                                    }),
+                     line.end());
+          if (!line.empty()) {
+            data_queue.push(line);
+          }
+        }
+        partial_line.clear();
+      }
+    }
+    while (!data_queue.empty()) {
+      data_queue.pop();
+      ++lines;
+    }
+  }
+  return lines;
+}
+
+// LineFramer alone, consuming frames in place.
+size_t FramerOnly(const std::string& feed, LineFramer* framer) {
+  size_t lines = 0;
+  for (size_t offset = 0; offset < feed.size(); offset += kReadSize) {
+    size_t bytes_read = std::min(kReadSize, feed.size() - offset);
+    framer->Feed(feed.data() + offset, bytes_read,
+                 [&lines](std::string_view) { ++lines; });
+  }
+  return lines;
+}
+
+// LineFramer feeding the SPSC ring, drained after every read.
+size_t FramerFrame(const std::string& feed, LineFramer* framer,
+                   SpscRing<std::string>* ring) {
+  size_t lines = 0;
+  std::string line;
+  for (size_t offset = 0; offset < feed.size(); offset += kReadSize) {
+    size_t bytes_read = std::min(kReadSize, feed.size() - offset);
+    framer->Feed(feed.data() + offset, bytes_read,
+                 [ring](std::string_view frame) { ring->Push(frame); });
+    while (ring->Pop(&line)) {
+      ++lines;
+    }
+  }
+  return lines;
+}
+
+template <typename Fn>
+void Run(const char* name, const std::string& feed, int iterations, Fn fn) {
+  fn();  // warm-up: lets recycled buffers reach steady state
+  size_t lines = 0;
+  const uint64_t allocations_before = g_allocations.load();
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    lines += fn();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  const uint64_t allocations = g_allocations.load() - allocations_before;
+  std::printf("%-12s %10.1f MB/s %12.0f lines/s %8.3f allocs/line\n", name,
+              feed.size() * iterations / seconds / 1e6, lines / seconds,
+              lines ? static_cast<double>(allocations) / lines : 0.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  const std::string feed = MakeFeed(lines);
+  const int iterations = 10;
+
+  LineFramer framer;
+  SpscRing<std::string> ring(256);
+
+  Run("legacy", feed, iterations, [&feed]() { return LegacyFrame(feed); });
+  Run("framer", feed, iterations,
+      [&]() { return FramerOnly(feed, &framer); });
+  Run("framer+ring", feed, iterations,
+      [&]() { return FramerFrame(feed, &framer, &ring); });
+  return 0;
+}
@@ -0,0 +1,74 @@
+// Per-keystroke latency of NameIndex::Search on a synthetic week of
+// patients, replaying the partial strings an IME produces while a name is
+// typed (ㄱ, 기, 김, 김ㅁ, 김미, 김민, ...) as well as 초성-only and number
+// queries.
+//
+// Usage: name_index_bench [entries]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "native/name_index.h"
+
+namespace {
+
+const char* const kSurnames[] = {"김", "이", "박", "최", "정", "강",
+                                 "조", "윤", "장", "임", "한", "오"};
+const char* const kGiven[] = {"민", "서", "지", "수", "현", "영", "준",
+                              "우", "은", "하", "도", "윤", "진", "경",
+                              "숙", "철", "희", "호", "연", "성"};
+
+std::string Name(size_t i) {
+  return std::string(kSurnames[i % 12]) + kGiven[(i / 12) % 20] +
+         kGiven[(i / 240 + i) % 20];
+}
+
+double Micros(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+  NameIndex index;
+  index.Reserve(count);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    index.Add(Name(i), std::to_string(i % 300) + " " +
+                           std::to_string(19400101 + i * 37 % 700000) + " " +
+                           std::to_string(500000 + i));
+  }
+  std::printf("%-10s %10.0f us for %zu entries\n", "build", Micros(start),
+              count);
+
+  const std::vector<std::string> keystrokes = {
+      "ㄱ", "기", "김", "김ㅁ", "김미", "김민", "김민ㅅ", "김민서",
+      "ㅂ", "바", "박", "박ㅈ", "박지", "박진", "박진ㅎ", "박진호",
+      "ㅇㅅ", "ㅈㅎㅇ", "ㅎ", "1", "19", "1985", "5004", "50042"};
+  uint32_t ids[50];
+  std::vector<double> samples;
+  size_t matched = 0;
+  const int rounds = 200;
+  for (int r = 0; r < rounds; ++r) {
+    for (const std::string& query : keystrokes) {
+      start = std::chrono::steady_clock::now();
+      matched += index.Search(query, ids, 50);
+      samples.push_back(Micros(start));
+    }
+  }
+  std::sort(samples.begin(), samples.end());
+  double total = 0;
+  for (double s : samples) total += s;
+  std::printf("%-10s %10.1f us mean, %.1f p50, %.1f p99, %.1f max (%zu)\n",
+              "keystroke", total / samples.size(),
+              samples[samples.size() / 2], samples[samples.size() * 99 / 100],
+              samples.back(), matched / rounds);
+  return 0;
+}
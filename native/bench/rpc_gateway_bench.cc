@@ -0,0 +1,161 @@
+// Replays a scanning session's RPC traffic against the stand-in server with
+// WAN-like latency (jitter and a slow tail) and compares ways of sending it:
+//
+//   one-shot    a connection per call, like a client without a pool
+//   keep-alive  pooled connections, one request at a time on each
+//   pipelined   pooled connections, several requests in flight on each
+//   coalesced   pipelined, and identical reads in flight share a request
+//
+// The workload comes in bursts: a barcode scan fires a unit lookup and a
+// product lookup for the same pack (scanned again a moment later as often
+// as not), and every few scans a check write and a prescription reload.
+//
+// Usage: rpc_gateway_bench [bursts] [latency_ms]
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "native/rpc_gateway.h"
+#include "native/rpc_standin_server.h"
+
+namespace {
+
+struct Call {
+  const char* function;
+  std::string body;
+};
+
+std::vector<std::vector<Call>> MakeBursts(int bursts) {
+  std::vector<std::vector<Call>> out;
+  for (int b = 0; b < bursts; ++b) {
+    std::vector<Call> burst;
+    // Packs repeat: the same box is scanned twice, or its twin is
+    const std::string barcode =
+        "{\"_pack_barcode\":\"880646900" + std::to_string(7000 + b / 2 % 40) +
+        "\"}";
+    for (int scan = 0; scan < 2; ++scan) {
+      burst.push_back({"get_unit_from_pack_barcode", barcode});
+      burst.push_back({"get_product_id_by_pack_barcode", barcode});
+    }
+    if (b % 3 == 0) {
+      burst.push_back({"update_checked_amount_and_packserial",
+                       "{\"_rxrecipe_id\":" + std::to_string(1000 + b) +
+                           ",\"_delta\":1}"});
+    }
+    if (b % 5 == 0) {
+      burst.push_back({"select_rxrecipe_by_textfile_number",
+                       "{\"_tfn\":" + std::to_string(20240101000 + b / 5) +
+                           "}"});
+      burst.push_back({"get_miss_mached_drug", "{}"});
+    }
+    out.push_back(std::move(burst));
+  }
+  return out;
+}
+
+struct Mode {
+  const char* name;
+  bool keep_alive;
+  size_t pipeline_depth;
+  bool coalesce;
+};
+
+void Run(const Mode& mode, const std::vector<std::vector<Call>>& bursts,
+         RpcStandInServer* server) {
+  RpcGatewayOptions options;
+  options.port = server->port();
+  options.keep_alive = mode.keep_alive;
+  options.pipeline_depth = mode.pipeline_depth;
+  options.max_connections = 4;
+  RpcGateway gateway(options);
+  RpcPolicy read;
+  read.coalesce = mode.coalesce;
+  read.retries = 2;
+  read.idempotent = true;
+  for (const char* function :
+       {"get_unit_from_pack_barcode", "get_product_id_by_pack_barcode",
+        "select_rxrecipe_by_textfile_number", "get_miss_mached_drug"}) {
+    gateway.SetPolicy(function, read);
+  }
+
+  const uint64_t requests_before = server->requests();
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<int64_t> latencies;
+  size_t total = 0;
+  int failures = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (const std::vector<Call>& burst : bursts) {
+    // A burst is issued at once; the next scan waits for its answers, as
+    // the screen does before it can show the next row
+    size_t pending = burst.size();
+    for (const Call& call : burst) {
+      gateway.Call(call.function, call.body, [&](const RpcResult& result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        latencies.push_back(result.latency_us);
+        failures += result.ok() ? 0 : 1;
+        if (--pending == 0) {
+          cv.notify_one();
+        }
+      });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return pending == 0; });
+    total += burst.size();
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) {
+    return latencies[std::min(latencies.size() - 1,
+                              static_cast<size_t>(p * latencies.size()))] /
+           1000.0;
+  };
+  const RpcGatewayStats stats = gateway.GetStats();
+  std::printf(
+      "%-11s %7.1f calls/s %6llu requests %4llu conns  p50 %6.1f  p90 %6.1f  "
+      "p99 %6.1f  max %6.1f ms  %d failed\n",
+      mode.name, total / seconds,
+      static_cast<unsigned long long>(server->requests() - requests_before),
+      static_cast<unsigned long long>(stats.connections_opened),
+      percentile(0.5), percentile(0.9), percentile(0.99),
+      latencies.back() / 1000.0, failures);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int bursts = argc > 1 ? std::atoi(argv[1]) : 200;
+  RpcStandInOptions server_options;
+  server_options.latency_ms = argc > 2 ? std::atoi(argv[2]) : 15;
+  server_options.jitter_ms = server_options.latency_ms / 2;
+  server_options.tail_ratio = 0.02;
+  server_options.tail_ms = server_options.latency_ms * 8;
+  RpcStandInServer server(server_options,
+                          [](const std::string&, const std::string& body) {
+                            return RpcStandInReply{200, "[" + body + "]"};
+                          });
+  if (!server.ok()) {
+    std::fprintf(stderr, "cannot start the stand-in server\n");
+    return 1;
+  }
+  const std::vector<std::vector<Call>> workload = MakeBursts(bursts);
+  std::printf("%d bursts, %d ms (+%d jitter, %d%% +%d ms)\n", bursts,
+              server_options.latency_ms, server_options.jitter_ms,
+              static_cast<int>(server_options.tail_ratio * 100),
+              server_options.tail_ms);
+  for (const Mode& mode : {Mode{"one-shot", false, 1, false},
+                           Mode{"keep-alive", true, 1, false},
+                           Mode{"pipelined", true, 4, false},
+                           Mode{"coalesced", true, 4, true}}) {
+    Run(mode, workload, &server);
+  }
+  return 0;
+}
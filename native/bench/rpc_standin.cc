@@ -0,0 +1,89 @@
+// Stand-in for the PostgREST RPC endpoint, so the app can run and be
+// profiled without the pharmacy database. Each call to <function> is
+// answered with <fixtures>/<function>.json, or "[]" if there is none, after
+// the configured latency. Runs until interrupted.
+//
+// Point the app at it with
+//   --dart-define=RPC_GATEWAY_URL=http://127.0.0.1:<port>
+//
+// Usage: rpc_standin [--port P] [--latency-ms L] [--jitter-ms J]
+//                    [--fixtures DIR]
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "native/rpc_standin_server.h"
+
+namespace {
+
+volatile sig_atomic_t g_stop = 0;
+
+void OnSignal(int) { g_stop = 1; }
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: rpc_standin [--port P] [--latency-ms L] "
+               "[--jitter-ms J] [--fixtures DIR]\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  RpcStandInOptions options;
+  options.port = 54321;
+  std::string fixtures;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      options.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--latency-ms") == 0 && i + 1 < argc) {
+      options.latency_ms = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--jitter-ms") == 0 && i + 1 < argc) {
+      options.jitter_ms = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--fixtures") == 0 && i + 1 < argc) {
+      fixtures = argv[++i];
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  RpcStandInServer server(options, [&](const std::string& function,
+                                       const std::string& body) {
+    std::printf("%s %s\n", function.c_str(), body.c_str());
+    std::fflush(stdout);
+    RpcStandInReply reply;
+    reply.body = "[]";
+    if (!fixtures.empty()) {
+      // The gateway only sends [A-Za-z0-9_] names
+      std::ifstream file(fixtures + "/" + function + ".json");
+      if (file) {
+        std::ostringstream text;
+        text << file.rdbuf();
+        reply.body = text.str();
+      }
+    }
+    return reply;
+  });
+  if (!server.ok()) {
+    std::fprintf(stderr, "cannot listen on port %u\n", options.port);
+    return 1;
+  }
+  signal(SIGINT, OnSignal);
+  signal(SIGTERM, OnSignal);
+  std::printf("listening on http://127.0.0.1:%u\n", server.port());
+  std::fflush(stdout);
+  while (!g_stop) {
+    pause();
+  }
+  std::printf("%llu requests on %llu connections\n",
+              static_cast<unsigned long long>(server.requests()),
+              static_cast<unsigned long long>(server.connections()));
+  return 0;
+}
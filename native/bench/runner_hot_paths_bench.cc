@@ -0,0 +1,483 @@
+// The per-scan work of the desktop runner and of handleBarcode, measured on
+// synthetic data with one JSON object per line, so the output of two
+// releases can be kept and compared (diff, or jq on "name" and "size"):
+//
+//   serial/*  bytes read from a scanner port framed into lines and queued,
+//             as ComPortHandler::OnPortReadable does, per read size
+//   codec/*   the comport event and TTS channel payloads through the
+//             engine's FlStandardMessageCodec (Linux runner build only)
+//   scan/*    handleBarcode's candidate matching (GS1 parse and RecipeIndex,
+//             and the linear scan it replaced), per prescription size
+//   totals/*  calculateTotals over the same prescriptions
+//
+// codec/* needs flutter_linux, so only the target in linux/runner builds
+// it (cmake --build <linux build dir> --target runner_hot_paths_bench); the
+// native-only build leaves it out. FlValue allocates with g_malloc, which
+// allocs_per_op does not count.
+//
+// Usage: runner_hot_paths_bench [--filter=<name prefix>] [--min-ms=<ms>]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef PHARM_BENCH_FLUTTER_CODEC
+#include <flutter_linux/flutter_linux.h>
+#endif
+
+#include "native/gs1_parser.h"
+#include "native/line_framer.h"
+#include "native/recipe_index.h"
+#include "native/recipe_store.h"
+#include "native/spsc_ring.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+// Results are folded in here so the measured work is not optimized away.
+uint64_t g_sink = 0;
+
+struct Options {
+  std::string filter;
+  double min_ms = 200;
+};
+
+// Calls |fn| until |min_ms| have passed and prints one line. |fn| does one
+// unit of work or more and returns how many.
+template <typename Fn>
+void Run(const Options& options, const char* name, size_t size,
+         const char* unit, Fn fn) {
+  if (std::string_view(name).substr(0, options.filter.size()) !=
+      options.filter) {
+    return;
+  }
+  fn();  // warm-up: lets recycled buffers reach steady state
+  uint64_t ops = 0;
+  uint64_t calls = 1;
+  double elapsed_ns = 0;
+  const uint64_t allocations_before = g_allocations.load();
+  while (elapsed_ns < options.min_ms * 1e6) {
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < calls; ++i) {
+      ops += fn();
+    }
+    elapsed_ns += std::chrono::duration<double, std::nano>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    calls = std::min<uint64_t>(calls * 2, 1 << 16);
+  }
+  const uint64_t allocations = g_allocations.load() - allocations_before;
+  std::printf(
+      "{\"name\":\"%s\",\"size\":%zu,\"unit\":\"%s\",\"ns_per_op\":%.1f,"
+      "\"ops_per_s\":%.0f,\"allocs_per_op\":%.3f}\n",
+      name, size, unit, ops ? elapsed_ns / ops : 0.0,
+      elapsed_ns > 0 ? ops * 1e9 / elapsed_ns : 0.0,
+      ops ? static_cast<double>(allocations) / ops : 0.0);
+  std::fflush(stdout);
+}
+
+// --- Serial framing ---
+
+// What ComPortHandler queues per line (ComPortLine)
+struct FramedLine {
+  std::string text;
+  uint64_t scan_id = 0;
+  int64_t framed_ns = 0;
+};
+
+// GS1 DataMatrix-like payloads with mixed CRLF / LF / CR terminators.
+std::string MakeFeed(size_t lines) {
+  static const char* kTerminators[] = {"\r\n", "\n", "\r"};
+  std::string feed;
+  for (size_t i = 0; i < lines; ++i) {
+    feed += "0108806469007312";
+    feed += "21";
+    feed += std::to_string(100000000 + i * 7919);
+    if (i % 3 == 0) {
+      feed += "17261231";
+      feed += "10LOT";
+      feed += std::to_string(i % 997);
+    }
+    feed += kTerminators[i % 3];
+  }
+  return feed;
+}
+
+// One wake-up of the port watch per |read_size| bytes, the queue drained
+// after each as deliver_comport_lines does.
+size_t FrameFeed(const std::string& feed, size_t read_size, LineFramer* framer,
+                 SpscRing<FramedLine>* ring) {
+  size_t lines = 0;
+  FramedLine line;
+  for (size_t offset = 0; offset < feed.size(); offset += read_size) {
+    const size_t bytes_read = std::min(read_size, feed.size() - offset);
+    framer->Feed(feed.data() + offset, bytes_read, [ring](std::string_view t) {
+      FramedLine framed;
+      framed.text.assign(t.data(), t.size());
+      ring->Push(std::move(framed));
+    });
+    while (ring->Pop(&line)) {
+      g_sink += line.text.size();
+      ++lines;
+    }
+  }
+  return lines;
+}
+
+#ifdef PHARM_BENCH_FLUTTER_CODEC
+
+// --- StandardMessageCodec ---
+
+// The wire format is the engine's: FlStandardMethodCodec frames its calls
+// and envelopes with these FlStandardMessageCodec calls.
+
+// deliver_comport_lines: a list of {line, scanId} maps (traced lines), as
+// MyApplication builds it
+FlValue* ComportEvent(const std::vector<FramedLine>& lines) {
+  FlValue* event = fl_value_new_list();
+  for (const FramedLine& line : lines) {
+    FlValue* entry = fl_value_new_map();
+    fl_value_set_string_take(entry, "line",
+                             fl_value_new_string(line.text.c_str()));
+    fl_value_set_string_take(
+        entry, "scanId", fl_value_new_int(static_cast<int64_t>(line.scan_id)));
+    fl_value_append_take(event, entry);
+  }
+  return event;
+}
+
+// A success envelope, as the event channel sends
+void EncodeEnvelope(FlStandardMessageCodec* codec, FlValue* value,
+                    GByteArray* out) {
+  const guint8 success = 0;
+  g_byte_array_set_size(out, 0);
+  g_byte_array_append(out, &success, 1);
+  fl_standard_message_codec_write_value(codec, out, value, nullptr);
+}
+
+void EncodeMethodCall(FlStandardMessageCodec* codec, const char* method,
+                      FlValue* args, GByteArray* out) {
+  g_autoptr(FlValue) name = fl_value_new_string(method);
+  g_byte_array_set_size(out, 0);
+  fl_standard_message_codec_write_value(codec, out, name, nullptr);
+  fl_standard_message_codec_write_value(codec, out, args, nullptr);
+}
+
+GBytes* CopyBytes(const GByteArray* buffer) {
+  return g_bytes_new(buffer->data, buffer->len);
+}
+
+// NativeTtsService.speak
+FlValue* SpeakArgs() {
+  FlValue* args = fl_value_new_map();
+  fl_value_set_string_take(
+      args, "text",
+      fl_value_new_string("타이레놀정500밀리그람, 1정, 3회, 3일, 총 9.0개"));
+  fl_value_set_string_take(args, "priority", fl_value_new_string("normal"));
+  return args;
+}
+
+// getComPortStats
+FlValue* ComportStats() {
+  static const char* kKeys[] = {"pushed",        "popped",
+                                "dropped",       "size",
+                                "capacity",      "highWaterMark",
+                                "avgLatencyUs",  "maxLatencyUs"};
+  FlValue* stats = fl_value_new_map();
+  int64_t n = 1;
+  for (const char* key : kKeys) {
+    fl_value_set_string_take(stats, key, fl_value_new_int(n *= 7));
+  }
+  fl_value_set_string_take(stats, "overflowPolicy",
+                           fl_value_new_string("dropOldest"));
+  return stats;
+}
+
+size_t StringLength(FlValue* map, const char* key) {
+  FlValue* value = fl_value_lookup_string(map, key);
+  return value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_STRING
+             ? std::strlen(fl_value_get_string(value))
+             : 0;
+}
+
+#endif  // PHARM_BENCH_FLUTTER_CODEC
+
+// --- Prescriptions ---
+
+// Appends the GS1 mod-10 check digit to |digits|.
+std::string WithCheckDigit(std::string digits) {
+  int sum = 0;
+  for (size_t i = 0; i < digits.size(); ++i) {
+    const int weight = (digits.size() - i) % 2 == 1 ? 3 : 1;
+    sum += (digits[i] - '0') * weight;
+  }
+  digits += static_cast<char>('0' + (10 - sum % 10) % 10);
+  return digits;
+}
+
+std::string Digits(uint64_t value, size_t width) {
+  std::string digits = std::to_string(value);
+  return std::string(width - std::min(width, digits.size()), '0') + digits;
+}
+
+// A patient's day: 13-digit pack barcodes, one row in five a second
+// separation of the drug before it, one in seven type 'E'.
+struct Prescription {
+  std::vector<std::string> barcodes;
+  std::vector<char> types;
+  RecipeStore store;
+  RecipeIndex index;
+  // GS1 element strings as scanned, a few of drugs not prescribed
+  std::vector<std::string> scans;
+};
+
+void MakePrescription(size_t rows, Prescription* rx) {
+  rx->store.Reset(rows);
+  rx->index.Reserve(rows);
+  for (size_t i = 0; i < rows; ++i) {
+    const std::string barcode =
+        i % 5 == 4 ? rx->barcodes.back()
+                   : WithCheckDigit("880" + Digits(i * 7919 % 99999999, 8) +
+                                    "0");
+    const char type = i % 7 == 6 ? 'E' : 'T';
+    rx->barcodes.push_back(barcode);
+    rx->types.push_back(type);
+
+    const uint32_t row = static_cast<uint32_t>(i);
+    RecipeStore& store = rx->store;
+    store.SetNumber(row, RecipeColumn::kRxrecipeId, 1000000.0 + i);
+    store.SetNumber(row, RecipeColumn::kSeparation, 1 + i % 3);
+    store.SetNumber(row, RecipeColumn::kUse, 1);
+    store.SetString(row, RecipeColumn::kType, std::string(1, type));
+    store.SetString(row, RecipeColumn::kPackBarcode, barcode);
+    store.SetNumber(row, RecipeColumn::kDose, i % 4 == 0 ? 0.5 : 1);
+    store.SetNumber(row, RecipeColumn::kTimes, 3);
+    store.SetNumber(row, RecipeColumn::kDays, 3 + i % 5);
+    store.SetNumber(row, RecipeColumn::kTotal, 9.0 * (1 + i % 3));
+    store.SetNumber(row, RecipeColumn::kMorning, i % 4 == 0 ? 0.5 : 1);
+    store.SetNumber(row, RecipeColumn::kAfternoon, 1);
+    store.SetNumber(row, RecipeColumn::kEvening, i % 2);
+    store.SetNumber(row, RecipeColumn::kNight, i % 6 == 0 ? 0.25 : 0);
+    rx->index.AddRow(barcode, type, store.IsComplete(row));
+  }
+
+  for (size_t i = 0; i < 256; ++i) {
+    const std::string gtin =
+        i % 16 == 15 ? WithCheckDigit("880999999999")
+                     : rx->barcodes[i * 2654435761u % rows];
+    rx->scans.push_back("010" + gtin + "21" + Digits(4000000000 + i, 10));
+  }
+}
+
+// The 13-digit base barcode of a scan (Gs1Barcode.baseBarcode), or empty
+std::string_view BaseBarcode(std::string_view scan) {
+  Gs1Parse parse;
+  ParseGs1(scan, &parse);
+  const Gs1Element* gtin = parse.Find(kGs1AiGtin);
+  if (gtin == nullptr) {
+    return {};
+  }
+  const std::string_view value = Gs1Value(scan, *gtin);
+  return value.size() == 14 ? value.substr(1) : value;
+}
+
+// handleBarcode's matching before RecipeIndex: every row compared on 12
+// (type 'E') or 11 characters, incomplete rows first.
+uint32_t LinearBest(const Prescription& rx, std::string_view barcode,
+                    std::vector<uint32_t>* candidates) {
+  candidates->clear();
+  for (size_t i = 0; i < rx.barcodes.size(); ++i) {
+    const size_t digits = rx.types[i] == 'E' ? 12 : 11;
+    const std::string& pack = rx.barcodes[i];
+    if (pack.size() >= digits && barcode.size() >= digits &&
+        pack.compare(0, digits, barcode.data(), digits) == 0) {
+      candidates->push_back(static_cast<uint32_t>(i));
+    }
+  }
+  std::stable_sort(candidates->begin(), candidates->end(),
+                   [&rx](uint32_t a, uint32_t b) {
+                     return !rx.store.IsComplete(a) && rx.store.IsComplete(b);
+                   });
+  return candidates->empty() ? RecipeIndex::kNoRow : candidates->front();
+}
+
+// fmtNum: at most two decimals, none for whole numbers
+std::string FormatNumber(double value) {
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.2f", value);
+  char* end = text + std::strlen(text);
+  while (end[-1] == '0') {
+    --end;
+  }
+  if (end[-1] == '.') {
+    --end;
+  }
+  return std::string(text, end);
+}
+
+// calculateTotals: the four sums, formatted
+size_t CalculateTotals(const RecipeStore& store, int32_t separation) {
+  const RecipeTotals totals = store.Totals(separation);
+  const std::string m = FormatNumber(totals.morning);
+  const std::string a = FormatNumber(totals.afternoon);
+  const std::string e = FormatNumber(totals.evening);
+  const std::string n = FormatNumber(totals.night);
+  return m.size() + a.size() + e.size() + n.size();
+}
+
+// The native part of one handleBarcode call: parse, match, check off one
+// unit and recompute the totals for the rebuilt screen.
+size_t HandleScan(Prescription* rx, std::string_view scan) {
+  const std::string_view barcode = BaseBarcode(scan);
+  const uint32_t row = rx->index.Best(barcode);
+  if (row != RecipeIndex::kNoRow) {
+    rx->store.AddChecked(row, 1);
+    rx->index.SetComplete(row, rx->store.IsComplete(row));
+  }
+  return CalculateTotals(rx->store, 1);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg.substr(0, 9) == "--filter=") {
+      options.filter = std::string(arg.substr(9));
+    } else if (arg.substr(0, 9) == "--min-ms=") {
+      options.min_ms = std::atof(argv[i] + 9);
+    } else {
+      std::fprintf(stderr,
+                   "Usage: %s [--filter=<name prefix>] [--min-ms=<ms>]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  // Serial: a 9600 baud scanner wakes the watch every few bytes, a USB
+  // CDC one with the whole code.
+  const std::string feed = MakeFeed(4096);
+  for (size_t read_size : {8, 64, 1024}) {
+    LineFramer framer;
+    SpscRing<FramedLine> ring(256);
+    Run(options, "serial/frame_queue", read_size, "line",
+        [&]() { return FrameFeed(feed, read_size, &framer, &ring); });
+  }
+
+#ifdef PHARM_BENCH_FLUTTER_CODEC
+  // Codec: one scan, and a burst the main loop picked up at once
+  g_autoptr(FlStandardMessageCodec) codec = fl_standard_message_codec_new();
+  g_autoptr(GByteArray) buffer = g_byte_array_new();
+  for (size_t count : {1, 16}) {
+    std::vector<FramedLine> lines(count);
+    for (size_t i = 0; i < count; ++i) {
+      lines[i].text = "0108806469007312211" + std::to_string(i + 10000000);
+      lines[i].scan_id = 1000 + i;
+    }
+    Run(options, "codec/comport_event_encode", count, "event", [&]() {
+      g_autoptr(FlValue) event = ComportEvent(lines);
+      EncodeEnvelope(codec, event, buffer);
+      g_sink += buffer->len;
+      return size_t{1};
+    });
+    g_autoptr(FlValue) event_value = ComportEvent(lines);
+    EncodeEnvelope(codec, event_value, buffer);
+    g_autoptr(GBytes) event = CopyBytes(buffer);
+    Run(options, "codec/comport_event_decode", count, "event", [&]() {
+      size_t offset = 1;
+      g_autoptr(FlValue) value =
+          fl_standard_message_codec_read_value(codec, event, &offset, nullptr);
+      const size_t entries = value != nullptr ? fl_value_get_length(value) : 0;
+      for (size_t i = 0; i < entries; ++i) {
+        g_sink += StringLength(fl_value_get_list_value(value, i), "line");
+      }
+      return size_t{1};
+    });
+  }
+  Run(options, "codec/comport_stats_encode", 1, "call", [&]() {
+    g_autoptr(FlValue) stats = ComportStats();
+    EncodeEnvelope(codec, stats, buffer);
+    g_sink += buffer->len;
+    return size_t{1};
+  });
+  Run(options, "codec/tts_speak_encode", 1, "call", [&]() {
+    g_autoptr(FlValue) args = SpeakArgs();
+    EncodeMethodCall(codec, "speak", args, buffer);
+    g_sink += buffer->len;
+    return size_t{1};
+  });
+  g_autoptr(FlValue) speak_args = SpeakArgs();
+  EncodeMethodCall(codec, "speak", speak_args, buffer);
+  g_autoptr(GBytes) speak = CopyBytes(buffer);
+  Run(options, "codec/tts_speak_decode", 1, "call", [&]() {
+    size_t offset = 0;
+    g_autoptr(FlValue) method =
+        fl_standard_message_codec_read_value(codec, speak, &offset, nullptr);
+    g_autoptr(FlValue) args =
+        method != nullptr ? fl_standard_message_codec_read_value(
+                                codec, speak, &offset, nullptr)
+                          : nullptr;
+    if (args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      g_sink += StringLength(args, "text") + StringLength(args, "priority");
+    }
+    return size_t{1};
+  });
+#endif  // PHARM_BENCH_FLUTTER_CODEC
+
+  // Scans and totals, per prescription size
+  for (size_t rows : {10, 100, 1000, 10000}) {
+    Prescription rx;
+    MakePrescription(rows, &rx);
+    std::vector<uint32_t> candidates;
+    size_t next = 0;
+    Run(options, "scan/match_linear", rows, "scan", [&]() {
+      const std::string& scan = rx.scans[next++ % rx.scans.size()];
+      g_sink += LinearBest(rx, BaseBarcode(scan), &candidates);
+      return size_t{1};
+    });
+    Run(options, "scan/match_index", rows, "scan", [&]() {
+      const std::string& scan = rx.scans[next++ % rx.scans.size()];
+      g_sink += rx.index.Best(BaseBarcode(scan));
+      return size_t{1};
+    });
+    Run(options, "scan/handle", rows, "scan", [&]() {
+      g_sink += HandleScan(&rx, rx.scans[next++ % rx.scans.size()]);
+      return size_t{1};
+    });
+    Run(options, "totals/all", rows, "call", [&]() {
+      g_sink += CalculateTotals(rx.store, 0);
+      return size_t{1};
+    });
+    Run(options, "totals/separation", rows, "call", [&]() {
+      g_sink += CalculateTotals(rx.store, 2);
+      return size_t{1};
+    });
+  }
+  return g_sink == 42 ? 1 : 0;
+}
@@ -0,0 +1,398 @@
+// Replays a scanner capture (native/serial_capture.h) into a pseudo-terminal
+// with the original timing, scaled, or as fast as the pty takes it, so the
+// burst patterns of a station can be load-tested deterministically.
+//
+// By default the pty is read by a SerialReactor in this process, the
+// headless pipeline of the runner, and each line's latency from the write
+// of its last byte to its framing is reported. With --app the slave side is
+// left for the app instead: the tool prints its path (and links it at
+// --link), waits for Enter or --delay-ms, replays and reports the pacing.
+// Point the app's scanner port at that path.
+//
+// Captures come from the runner (PHARM_SERIAL_CAPTURE=<file>) or from
+// --record, which reads a device directly until interrupted. A runner
+// capture can hold several ports; one pty stands for one port, so only
+// --port ID is replayed, by default the port of the first read.
+//
+// Usage: serial_replay <capture> [--speed 1|2|10|max] [--port ID]
+//                      [--repeat N] [--app] [--link PATH] [--delay-ms MS]
+//        serial_replay --record DEVICE [--baud B] <capture>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "native/line_framer.h"
+#include "native/metrics_registry.h"
+#include "native/serial_capture.h"
+#include "native/serial_port.h"
+#include "native/serial_reactor.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+volatile sig_atomic_t g_stop = 0;
+
+void OnSignal(int) { g_stop = 1; }
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: serial_replay <capture> [--speed 1|2|10|max] "
+               "[--port ID] [--repeat N]\n"
+               "                     [--app] [--link PATH] [--delay-ms MS]\n"
+               "       serial_replay --record DEVICE [--baud B] <capture>\n");
+}
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+// Sleeps most of the way and spins the rest, so bursts keep their
+// sub-millisecond gaps.
+void WaitUntil(int64_t at_ns) {
+  const int64_t kSpinNs = 300000;
+  int64_t now = NowNs();
+  if (at_ns - now > kSpinNs) {
+    std::this_thread::sleep_for(
+        std::chrono::nanoseconds(at_ns - now - kSpinNs));
+  }
+  while (NowNs() < at_ns) {
+  }
+}
+
+// Raw mode, as SerialPort::Open sets it; until the reader opens the slave,
+// the default line discipline would echo and translate CR.
+bool MakeRaw(int fd) {
+  struct termios tio = {};
+  if (tcgetattr(fd, &tio) != 0) {
+    return false;
+  }
+  cfmakeraw(&tio);
+  return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+bool WriteChunk(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t n = write(fd, data.data() + written, data.size() - written);
+    if (n > 0) {
+      written += static_cast<size_t>(n);
+    } else if (n < 0 && errno != EINTR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PrintLatencies(const char* name, const LatencyHistogram& histogram) {
+  const HistogramSnapshot snapshot = histogram.Snapshot();
+  std::printf("%-10s p50 %llu us, p90 %llu, p99 %llu, p999 %llu, max %llu\n",
+              name,
+              static_cast<unsigned long long>(snapshot.ValueAtQuantile(0.5)),
+              static_cast<unsigned long long>(snapshot.ValueAtQuantile(0.9)),
+              static_cast<unsigned long long>(snapshot.ValueAtQuantile(0.99)),
+              static_cast<unsigned long long>(snapshot.ValueAtQuantile(0.999)),
+              static_cast<unsigned long long>(snapshot.max_us));
+}
+
+int Record(const std::string& device, int baud, const std::string& path) {
+  SerialCaptureWriter capture;
+  if (!capture.Open(path)) {
+    std::fprintf(stderr, "cannot write %s\n", path.c_str());
+    return 1;
+  }
+  SerialPort port;
+  if (!port.Open(device, baud)) {
+    std::fprintf(stderr, "cannot open %s at %d baud\n", device.c_str(), baud);
+    return 1;
+  }
+  port.SetCapture(&capture, 0);
+  signal(SIGINT, OnSignal);
+  signal(SIGTERM, OnSignal);
+  std::printf("recording %s to %s; interrupt to stop\n", device.c_str(),
+              path.c_str());
+  std::fflush(stdout);
+  uint64_t lines = 0;
+  while (!g_stop) {
+    struct pollfd pfd = {port.fd(), POLLIN, 0};
+    if (poll(&pfd, 1, 200) <= 0) {
+      continue;
+    }
+    if (!port.ReadFrames([&lines](std::string_view) { ++lines; })) {
+      std::fprintf(stderr, "%s hung up\n", device.c_str());
+      break;
+    }
+  }
+  port.Close();
+  capture.Close();
+  std::printf("%llu chunks, %llu bytes, %llu lines\n",
+              static_cast<unsigned long long>(capture.chunks()),
+              static_cast<unsigned long long>(capture.bytes()),
+              static_cast<unsigned long long>(lines));
+  return 0;
+}
+
+struct ScheduledWrite {
+  // From the start of the replay, already scaled
+  int64_t at_ns;
+  const std::string* data;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string path;
+  std::string record_device;
+  std::string link;
+  int baud = 9600;
+  double speed = 1;
+  int64_t only_port = -1;
+  int repeat = 1;
+  bool app = false;
+  int delay_ms = -1;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      ++i;
+      speed = std::strcmp(argv[i], "max") == 0 ? 0 : std::atof(argv[i]);
+      if (speed < 0) {
+        PrintUsage();
+        return 2;
+      }
+    } else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      only_port = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeat = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--app") == 0) {
+      app = true;
+    } else if (std::strcmp(argv[i], "--link") == 0 && i + 1 < argc) {
+      link = argv[++i];
+    } else if (std::strcmp(argv[i], "--delay-ms") == 0 && i + 1 < argc) {
+      delay_ms = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_device = argv[++i];
+    } else if (std::strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+      baud = std::atoi(argv[++i]);
+    } else if (argv[i][0] != '-' && path.empty()) {
+      path = argv[i];
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+  if (path.empty()) {
+    PrintUsage();
+    return 2;
+  }
+  if (!record_device.empty()) {
+    return Record(record_device, baud, path);
+  }
+
+  SerialCapture capture;
+  if (!ReadSerialCapture(path, &capture)) {
+    std::fprintf(stderr, "%s is not a serial capture\n", path.c_str());
+    return 1;
+  }
+  if (only_port < 0 && !capture.chunks.empty()) {
+    only_port = capture.chunks.front().port;
+  }
+  std::vector<const SerialCaptureChunk*> chunks;
+  std::set<int32_t> ports;
+  uint64_t capture_bytes = 0;
+  for (const SerialCaptureChunk& chunk : capture.chunks) {
+    ports.insert(chunk.port);
+    if (chunk.port == only_port) {
+      chunks.push_back(&chunk);
+      capture_bytes += chunk.data.size();
+    }
+  }
+  if (chunks.empty()) {
+    std::fprintf(stderr, "no chunks to replay\n");
+    return 1;
+  }
+  const int64_t first_ns = chunks.front()->time_ns;
+  const int64_t span_ns = chunks.back()->time_ns - first_ns;
+  std::printf("capture    %zu chunks, %llu bytes, %.3f s, ports", chunks.size(),
+              static_cast<unsigned long long>(capture_bytes), span_ns / 1e9);
+  for (int32_t port : ports) {
+    std::printf(" %d", port);
+  }
+  std::printf("%s\n", capture.truncated ? " (truncated)" : "");
+  if (ports.size() > 1) {
+    std::printf("replaying  port %lld (--port picks another)\n",
+                static_cast<long long>(only_port));
+  }
+
+  // Repetitions follow each other with the capture's mean gap between them
+  const int64_t gap_ns =
+      chunks.size() > 1 ? span_ns / static_cast<int64_t>(chunks.size() - 1)
+                        : 0;
+  std::vector<ScheduledWrite> schedule;
+  for (int r = 0; r < repeat; ++r) {
+    const int64_t offset_ns = r * (span_ns + gap_ns);
+    for (const SerialCaptureChunk* chunk : chunks) {
+      const int64_t at = offset_ns + chunk->time_ns - first_ns;
+      schedule.push_back({speed > 0 ? static_cast<int64_t>(at / speed) : 0,
+                          &chunk->data});
+    }
+  }
+
+  // The write that completes each line, framed the way the reactor frames
+  std::vector<size_t> line_write;
+  {
+    LineFramer framer;
+    for (size_t i = 0; i < schedule.size(); ++i) {
+      framer.Feed(schedule[i].data->data(), schedule[i].data->size(),
+                  [&line_write, i](std::string_view) {
+                    line_write.push_back(i);
+                  });
+    }
+  }
+
+  const int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    std::fprintf(stderr, "cannot create a pty\n");
+    return 1;
+  }
+  const std::string slave_path = ptsname(master);
+  // Held open so the pty stays up while the reader reopens it
+  const int slave = open(slave_path.c_str(), O_RDWR | O_NOCTTY);
+  if (slave < 0 || !MakeRaw(slave)) {
+    std::fprintf(stderr, "cannot set up %s\n", slave_path.c_str());
+    return 1;
+  }
+
+  // Headless: the reactor pops each line as soon as it is framed
+  std::vector<int64_t> received_ns(line_write.size(), 0);
+  std::atomic<size_t> received{0};
+  SerialReactor* reactor_ptr = nullptr;
+  std::unique_ptr<SerialReactor> reactor;
+  if (!app) {
+    reactor = std::make_unique<SerialReactor>(
+        4096, [&received_ns, &received, &reactor_ptr]() {
+          SerialLine line;
+          while (reactor_ptr->PopLine(&line)) {
+            const size_t n = received.load(std::memory_order_relaxed);
+            if (n < received_ns.size()) {
+              received_ns[n] = NowNs();
+            }
+            received.store(n + 1, std::memory_order_release);
+          }
+        });
+    reactor_ptr = reactor.get();
+    SerialPortConfig config;
+    config.device_path = slave_path;
+    config.baud_rate = 115200;
+    config.reopen = false;
+    if (!reactor->ok() || !reactor->OpenPort(1, config)) {
+      std::fprintf(stderr, "cannot read %s\n", slave_path.c_str());
+      return 1;
+    }
+  } else {
+    if (!link.empty()) {
+      unlink(link.c_str());
+      if (symlink(slave_path.c_str(), link.c_str()) != 0) {
+        std::fprintf(stderr, "cannot link %s\n", link.c_str());
+        return 1;
+      }
+    }
+    std::printf("scanner    %s%s%s\n", slave_path.c_str(),
+                link.empty() ? "" : " <- ", link.c_str());
+    if (delay_ms >= 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    } else {
+      std::printf("open it in the app, then press Enter\n");
+      std::fflush(stdout);
+      std::getchar();
+    }
+  }
+
+  signal(SIGINT, OnSignal);
+  signal(SIGTERM, OnSignal);
+  LatencyHistogram pacing;
+  std::vector<int64_t> written_ns(schedule.size(), 0);
+  size_t writes = 0;
+  uint64_t bytes = 0;
+  const int64_t start_ns = NowNs();
+  for (; writes < schedule.size() && !g_stop; ++writes) {
+    const ScheduledWrite& write = schedule[writes];
+    if (speed > 0) {
+      WaitUntil(start_ns + write.at_ns);
+    }
+    const int64_t now = NowNs();
+    written_ns[writes] = now;
+    if (speed > 0) {
+      pacing.Record((now - start_ns - write.at_ns) / 1000);
+    }
+    if (!WriteChunk(master, *write.data)) {
+      std::fprintf(stderr, "write failed\n");
+      break;
+    }
+    bytes += write.data->size();
+  }
+  const double seconds = (NowNs() - start_ns) / 1e9;
+
+  // Lines still in flight get a second to arrive
+  size_t lines = line_write.size();
+  if (!app) {
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(1);
+    while (received.load(std::memory_order_acquire) < line_write.size() &&
+           Clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    reactor.reset();
+    lines = std::min(received.load(std::memory_order_acquire),
+                     line_write.size());
+  }
+
+  std::printf("replay     %zu writes in %.3f s at ", writes, seconds);
+  if (speed > 0) {
+    std::printf("%gx (%.2fx achieved)\n", speed,
+                seconds > 0 ? span_ns * repeat / 1e9 / seconds : 0.0);
+  } else {
+    std::printf("max speed\n");
+  }
+  std::printf("throughput %.1f KB/s, %.0f lines/s\n", bytes / seconds / 1e3,
+              lines / seconds);
+  if (speed > 0) {
+    PrintLatencies("pacing", pacing);
+  }
+  if (!app) {
+    LatencyHistogram latency;
+    for (size_t i = 0; i < lines; ++i) {
+      latency.Record((received_ns[i] - written_ns[line_write[i]]) / 1000);
+    }
+    PrintLatencies("latency", latency);
+    std::printf("lines      %zu of %zu framed\n", lines, line_write.size());
+  } else {
+    const size_t sent = std::lower_bound(line_write.begin(), line_write.end(),
+                                         writes) -
+                        line_write.begin();
+    std::printf("lines      %zu sent\n", sent);
+  }
+
+  close(slave);
+  close(master);
+  if (app && !link.empty()) {
+    unlink(link.c_str());
+  }
+  return 0;
+}
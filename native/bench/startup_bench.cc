@@ -0,0 +1,179 @@
+// Launches the Linux runner repeatedly with PHARM_STARTUP_BENCHMARK set to
+// the phase to wait for (first_frame unless --wait says otherwise). The
+// runner prints its startup timeline when it gets there and quits; this
+// summarizes the phases over all runs.
+//
+// With --cold the page cache is dropped before every run (needs root), so
+// the engine, the AOT snapshot and the fonts come from disk; otherwise the
+// first run is cold-ish and the rest are warm.
+//
+// Usage: startup_bench [--runs N] [--cold] [--timeout-ms T] [--wait MARK]
+//                      -- <runner binary> [args...]
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "native/startup_timeline.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr char kLinePrefix[] = "PHARM_STARTUP ";
+constexpr int kExitGraceMs = 5000;
+
+bool DropPageCache() {
+  sync();
+  int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+  if (fd < 0) {
+    return false;
+  }
+  const bool ok = write(fd, "3\n", 2) == 2;
+  close(fd);
+  return ok;
+}
+
+// Runs |argv| once and returns the timeline it printed, or an empty vector
+// if it did not print one within |timeout_ms|.
+std::vector<StartupMark> RunOnce(const std::vector<char*>& argv,
+                                 const std::string& wait_mark,
+                                 int timeout_ms) {
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) {
+    return {};
+  }
+  const pid_t child = fork();
+  if (child == 0) {
+    dup2(pipe_fds[1], STDOUT_FILENO);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    setenv("PHARM_STARTUP_BENCHMARK", wait_mark.c_str(), 1);
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+  close(pipe_fds[1]);
+
+  std::vector<StartupMark> marks;
+  std::string buffer;
+  const Clock::time_point deadline =
+      Clock::now() + std::chrono::milliseconds(timeout_ms);
+  bool done = false;
+  while (!done) {
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - Clock::now());
+    struct pollfd pfd = {pipe_fds[0], POLLIN, 0};
+    if (left.count() <= 0 ||
+        poll(&pfd, 1, static_cast<int>(left.count())) <= 0) {
+      break;
+    }
+    char chunk[4096];
+    const ssize_t n = read(pipe_fds[0], chunk, sizeof(chunk));
+    if (n <= 0) {
+      break;
+    }
+    buffer.append(chunk, static_cast<size_t>(n));
+    size_t newline;
+    while ((newline = buffer.find('\n')) != std::string::npos) {
+      const std::string line = buffer.substr(0, newline);
+      buffer.erase(0, newline + 1);
+      if (line.compare(0, sizeof(kLinePrefix) - 1, kLinePrefix) == 0 &&
+          ParseStartupTimeline(line.substr(sizeof(kLinePrefix) - 1),
+                               &marks)) {
+        done = true;
+      }
+    }
+  }
+  close(pipe_fds[0]);
+  // The runner quits by itself after printing; give it a moment to exit so
+  // runs do not overlap.
+  const Clock::time_point exit_deadline =
+      Clock::now() + std::chrono::milliseconds(done ? kExitGraceMs : 0);
+  int status = 0;
+  while (waitpid(child, &status, WNOHANG) == 0) {
+    if (Clock::now() >= exit_deadline) {
+      kill(child, SIGKILL);
+      waitpid(child, &status, 0);
+      break;
+    }
+    usleep(10000);
+  }
+  return done ? marks : std::vector<StartupMark>();
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: startup_bench [--runs N] [--cold] [--timeout-ms T] "
+               "[--wait MARK] -- <runner> [args...]\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int runs = 10;
+  bool cold = false;
+  int timeout_ms = 30000;
+  std::string wait_mark = "first_frame";
+  int i = 1;
+  for (; i < argc && std::strcmp(argv[i], "--") != 0; ++i) {
+    if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      runs = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--cold") == 0) {
+      cold = true;
+    } else if (std::strcmp(argv[i], "--timeout-ms") == 0 && i + 1 < argc) {
+      timeout_ms = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--wait") == 0 && i + 1 < argc) {
+      wait_mark = argv[++i];
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+  if (i + 1 >= argc || runs <= 0) {
+    PrintUsage();
+    return 2;
+  }
+  std::vector<char*> child_argv(argv + i + 1, argv + argc);
+  child_argv.push_back(nullptr);
+
+  std::vector<std::vector<StartupMark>> timelines;
+  for (int run = 0; run < runs; ++run) {
+    if (cold && !DropPageCache()) {
+      std::fprintf(stderr, "cannot drop the page cache (not root?)\n");
+      return 1;
+    }
+    std::vector<StartupMark> marks =
+        RunOnce(child_argv, wait_mark, timeout_ms);
+    if (marks.empty()) {
+      std::fprintf(stderr, "run %d: no timeline within %d ms\n", run + 1,
+                   timeout_ms);
+      continue;
+    }
+    std::printf("run %2d: %s %.1f ms\n", run + 1, marks.back().name.c_str(),
+                marks.back().us / 1000.0);
+    timelines.push_back(std::move(marks));
+  }
+  if (timelines.empty()) {
+    return 1;
+  }
+
+  std::printf("\n%s start, %zu of %d runs (ms since process start)\n",
+              cold ? "cold" : "warm", timelines.size(), runs);
+  std::printf("%-24s %8s %8s %8s %8s\n", "phase", "min", "median", "p90",
+              "max");
+  for (const StartupPhaseSummary& phase : SummarizeStartups(timelines)) {
+    std::printf("%-24s %8.1f %8.1f %8.1f %8.1f\n", phase.name.c_str(),
+                phase.min_us / 1000.0, phase.median_us / 1000.0,
+                phase.p90_us / 1000.0, phase.max_us / 1000.0);
+  }
+  return timelines.size() == static_cast<size_t>(runs) ? 0 : 1;
+}
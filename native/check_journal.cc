@@ -0,0 +1,389 @@
+#include "native/check_journal.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "native/crc32.h"
+#include "native/file_io.h"
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4A435050;  // "PPCJ"
+// Version 1 files have no sending/requeued marks and are read as is.
+constexpr uint32_t kFormatVersion = 2;
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kFrameSize = 8;
+// Larger frames can only come from corruption.
+constexpr uint32_t kMaxPayload = 4096;
+constexpr size_t kMaxSerialLength = 255;
+
+enum RecordType : uint8_t {
+  kIncrement = 1,
+  kAck = 2,
+  // Taken by the flusher: may reach the server from here on
+  kSending = 3,
+  // Failed without reaching the server: queued again
+  kRequeued = 4,
+};
+
+}  // namespace
+
+CheckJournal::CheckJournal(CheckJournalOptions options)
+    : options_(options),
+      fd_(-1),
+      file_bytes_(0),
+      next_seq_(1),
+      unsynced_(0),
+      first_unsynced_ms_(0),
+      backoff_ms_(0),
+      retry_at_ms_(0) {}
+
+CheckJournal::~CheckJournal() { Close(); }
+
+bool CheckJournal::Open(const std::string& path) {
+  Close();
+  std::lock_guard<std::mutex> lock(mutex_);
+  fd_ = OpenDataFile(path);
+  if (fd_ < 0) {
+    return false;
+  }
+  path_ = path;
+  stats_ = CheckJournalStats();
+  Replay();
+  return true;
+}
+
+void CheckJournal::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ < 0) {
+    return;
+  }
+  if (unsynced_ > 0) {
+    SyncLocked();
+  }
+  CloseDataFile(fd_);
+  fd_ = -1;
+  queue_.clear();
+  in_flight_.clear();
+  unsettled_.clear();
+  file_bytes_ = 0;
+  next_seq_ = 1;
+  backoff_ms_ = 0;
+  retry_at_ms_ = 0;
+}
+
+bool CheckJournal::IsOpen() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return fd_ >= 0;
+}
+
+bool CheckJournal::WriteHeader() {
+  std::string header;
+  AppendPod(&header, kMagic);
+  AppendPod(&header, kFormatVersion);
+  AppendPod(&header, next_seq_);
+  if (!SeekDataFile(fd_, 0) || !WriteAll(fd_, header.data(), header.size())) {
+    return false;
+  }
+  file_bytes_ = kHeaderSize;
+  return true;
+}
+
+void CheckJournal::Replay() {
+  std::string data;
+  SeekDataFile(fd_, 0);
+  ReadToEnd(fd_, &data);
+
+  const char* cursor = data.data();
+  const char* end = cursor + data.size();
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t base_seq = 0;
+  if (!ReadPod(&cursor, end, &magic) || !ReadPod(&cursor, end, &version) ||
+      !ReadPod(&cursor, end, &base_seq) || magic != kMagic || version < 1 ||
+      version > kFormatVersion) {
+    // New or unreadable journal: start a fresh one.
+    TruncateDataFile(fd_, 0);
+    next_seq_ = 1;
+    WriteHeader();
+    SyncDataFile(fd_);
+    return;
+  }
+  next_seq_ = std::max<uint64_t>(base_seq, 1);
+
+  std::vector<CheckEntry> increments;
+  std::unordered_map<uint64_t, bool> acked;
+  // Last sending (true) or requeued (false) mark of each entry
+  std::unordered_map<uint64_t, bool> sending;
+  const char* valid_end = cursor;
+  while (true) {
+    uint32_t length = 0;
+    uint32_t crc = 0;
+    if (!ReadPod(&cursor, end, &length) || !ReadPod(&cursor, end, &crc) ||
+        length == 0 || length > kMaxPayload ||
+        static_cast<size_t>(end - cursor) < length ||
+        Crc32(cursor, length) != crc) {
+      break;
+    }
+    const char* payload = cursor;
+    const char* payload_end = cursor + length;
+    cursor = payload_end;
+
+    uint8_t type = 0;
+    uint64_t seq = 0;
+    if (!ReadPod(&payload, payload_end, &type) ||
+        !ReadPod(&payload, payload_end, &seq)) {
+      break;
+    }
+    if (type == kIncrement) {
+      CheckEntry entry;
+      entry.seq = seq;
+      uint16_t serial_length = 0;
+      if (!ReadPod(&payload, payload_end, &entry.rxrecipe_id) ||
+          !ReadPod(&payload, payload_end, &entry.delta) ||
+          !ReadPod(&payload, payload_end, &entry.created_ms) ||
+          !ReadPod(&payload, payload_end, &serial_length) ||
+          static_cast<size_t>(payload_end - payload) < serial_length) {
+        break;
+      }
+      entry.pack_serial.assign(payload, serial_length);
+      increments.push_back(std::move(entry));
+    } else if (type == kAck) {
+      acked[seq] = true;
+    } else if (type == kSending || type == kRequeued) {
+      sending[seq] = type == kSending;
+    } else {
+      break;
+    }
+    next_seq_ = std::max(next_seq_, seq + 1);
+    valid_end = cursor;
+  }
+
+  // Drop a torn tail so new records follow the last good one.
+  file_bytes_ = static_cast<uint64_t>(valid_end - data.data());
+  if (file_bytes_ < data.size()) {
+    TruncateDataFile(fd_, file_bytes_);
+    SyncDataFile(fd_);
+  }
+  if (version < kFormatVersion) {
+    // Marks follow; a version 1 reader would take them for a torn tail.
+    const uint64_t records_end = file_bytes_;
+    if (WriteHeader()) {
+      SyncDataFile(fd_);
+    }
+    file_bytes_ = records_end;
+  }
+  SeekDataFile(fd_, file_bytes_);
+
+  for (CheckEntry& entry : increments) {
+    if (acked.count(entry.seq) != 0) {
+      continue;
+    }
+    ++stats_.replayed;
+    auto mark = sending.find(entry.seq);
+    if (mark != sending.end() && mark->second) {
+      unsettled_.push_back(std::move(entry));
+      ++stats_.unsettled;
+    } else {
+      queue_.push_back(std::move(entry));
+    }
+  }
+}
+
+bool CheckJournal::WriteRecord(const std::string& payload) {
+  std::string frame;
+  frame.reserve(kFrameSize + payload.size());
+  AppendPod(&frame, static_cast<uint32_t>(payload.size()));
+  AppendPod(&frame, Crc32(payload.data(), payload.size()));
+  frame += payload;
+  if (!WriteAll(fd_, frame.data(), frame.size())) {
+    // Cut off whatever part of the frame made it to the file.
+    TruncateDataFile(fd_, file_bytes_);
+    SeekDataFile(fd_, file_bytes_);
+    return false;
+  }
+  file_bytes_ += frame.size();
+  ++unsynced_;
+  return true;
+}
+
+bool CheckJournal::WriteMark(uint8_t type, uint64_t seq) {
+  std::string payload;
+  AppendPod(&payload, type);
+  AppendPod(&payload, seq);
+  return WriteRecord(payload);
+}
+
+uint64_t CheckJournal::Append(int64_t rxrecipe_id, int32_t delta,
+                              std::string_view pack_serial, int64_t now_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ < 0 || pack_serial.size() > kMaxSerialLength) {
+    return 0;
+  }
+
+  CheckEntry entry;
+  entry.seq = next_seq_;
+  entry.rxrecipe_id = rxrecipe_id;
+  entry.delta = delta;
+  entry.pack_serial.assign(pack_serial.data(), pack_serial.size());
+  entry.created_ms = now_ms;
+
+  std::string payload;
+  AppendPod(&payload, static_cast<uint8_t>(kIncrement));
+  AppendPod(&payload, entry.seq);
+  AppendPod(&payload, entry.rxrecipe_id);
+  AppendPod(&payload, entry.delta);
+  AppendPod(&payload, entry.created_ms);
+  AppendPod(&payload, static_cast<uint16_t>(pack_serial.size()));
+  payload.append(pack_serial.data(), pack_serial.size());
+  if (!WriteRecord(payload)) {
+    return 0;
+  }
+  ++next_seq_;
+  ++stats_.appended;
+  if (unsynced_ == 1) {
+    first_unsynced_ms_ = now_ms;
+  }
+  if (unsynced_ >= options_.sync_batch) {
+    SyncLocked();
+  }
+
+  queue_.push_back(std::move(entry));
+  return next_seq_ - 1;
+}
+
+size_t CheckJournal::TakeBatch(size_t max, int64_t now_ms,
+                               std::vector<CheckEntry>* out) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (now_ms < retry_at_ms_) {
+    return 0;
+  }
+  size_t taken = 0;
+  while (taken < max && !queue_.empty()) {
+    CheckEntry& entry = queue_.front();
+    // Without the mark a crash mid-send would resend it after a restart.
+    // Not fsynced: a power loss can still lose it.
+    if (fd_ < 0 || !WriteMark(kSending, entry.seq)) {
+      break;
+    }
+    out->push_back(entry);
+    in_flight_.emplace(entry.seq, std::move(entry));
+    queue_.pop_front();
+    ++taken;
+  }
+  return taken;
+}
+
+size_t CheckJournal::TakeUnsettled(size_t max, std::vector<CheckEntry>* out) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t taken = 0;
+  while (taken < max && !unsettled_.empty()) {
+    CheckEntry& entry = unsettled_.front();
+    out->push_back(entry);
+    in_flight_.emplace(entry.seq, std::move(entry));
+    unsettled_.pop_front();
+    ++taken;
+  }
+  return taken;
+}
+
+void CheckJournal::Ack(uint64_t seq, int32_t affected) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ < 0 || in_flight_.erase(seq) == 0) {
+    return;
+  }
+  std::string payload;
+  AppendPod(&payload, static_cast<uint8_t>(kAck));
+  AppendPod(&payload, seq);
+  AppendPod(&payload, affected);
+  // If the ack cannot be written the entry comes back from TakeUnsettled
+  // after a restart.
+  WriteRecord(payload);
+  ++stats_.acked;
+  if (affected == 0) {
+    ++stats_.duplicates;
+  } else if (affected == kCheckRejected) {
+    ++stats_.rejected;
+  } else if (affected == kCheckOutcomeUnknown) {
+    ++stats_.unknown;
+  }
+  // A reply means the server is reachable again.
+  if (affected != kCheckOutcomeUnknown) {
+    backoff_ms_ = 0;
+    retry_at_ms_ = 0;
+  }
+  MaybeCompact();
+}
+
+void CheckJournal::Fail(uint64_t seq, int64_t now_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = in_flight_.find(seq);
+  if (it == in_flight_.end()) {
+    return;
+  }
+  // Keep the queue in sequence order so increments reach the server in the
+  // order they were scanned.
+  auto position = std::lower_bound(
+      queue_.begin(), queue_.end(), seq,
+      [](const CheckEntry& entry, uint64_t value) { return entry.seq < value; });
+  queue_.insert(position, std::move(it->second));
+  in_flight_.erase(it);
+  WriteMark(kRequeued, seq);
+
+  ++stats_.failures;
+  // Failures of one batch extend the backoff once, not once per entry.
+  if (now_ms >= retry_at_ms_) {
+    backoff_ms_ = backoff_ms_ == 0
+                      ? options_.min_backoff_ms
+                      : std::min(backoff_ms_ * 2, options_.max_backoff_ms);
+    retry_at_ms_ = now_ms + backoff_ms_;
+  }
+}
+
+void CheckJournal::SyncIfDue(int64_t now_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (unsynced_ > 0 &&
+      (unsynced_ >= options_.sync_batch ||
+       now_ms - first_unsynced_ms_ >= options_.sync_interval_ms)) {
+    SyncLocked();
+  }
+}
+
+bool CheckJournal::Sync() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return SyncLocked();
+}
+
+bool CheckJournal::SyncLocked() {
+  if (fd_ < 0) {
+    return false;
+  }
+  if (!SyncDataFile(fd_)) {
+    return false;
+  }
+  unsynced_ = 0;
+  ++stats_.syncs;
+  return true;
+}
+
+void CheckJournal::MaybeCompact() {
+  if (!queue_.empty() || !in_flight_.empty() || !unsettled_.empty() ||
+      file_bytes_ < options_.compact_bytes) {
+    return;
+  }
+  // Everything is acknowledged: keep only the sequence counter.
+  if (TruncateDataFile(fd_, 0) && WriteHeader()) {
+    SyncLocked();
+  }
+  SeekDataFile(fd_, file_bytes_);
+}
+
+CheckJournalStats CheckJournal::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CheckJournalStats stats = stats_;
+  stats.pending = queue_.size();
+  stats.in_flight = in_flight_.size();
+  stats.file_bytes = file_bytes_;
+  stats.backoff_ms = backoff_ms_;
+  return stats;
+}
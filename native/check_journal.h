@@ -0,0 +1,149 @@
+#ifndef NATIVE_CHECK_JOURNAL_H_
+#define NATIVE_CHECK_JOURNAL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// One update_checked_amount_and_packserial call waiting for the server.
+struct CheckEntry {
+  uint64_t seq = 0;
+  int64_t rxrecipe_id = 0;
+  int32_t delta = 0;
+  std::string pack_serial;
+  int64_t created_ms = 0;
+};
+
+// Ack() values for entries that were settled without a server count.
+// The server refused the call for good (a PostgREST error); it is not resent
+constexpr int32_t kCheckRejected = -1;
+// The call may or may not have been applied (no response after it was
+// sent); it is not resent, since resending could apply it twice
+constexpr int32_t kCheckOutcomeUnknown = -2;
+
+// When the journal fsyncs and how the flusher backs off.
+struct CheckJournalOptions {
+  // fsync once this many records are unsynced...
+  size_t sync_batch = 16;
+  // ...or the oldest unsynced record is this old (checked by SyncIfDue)
+  int64_t sync_interval_ms = 200;
+  // Retry delay after a failed send; doubles up to the maximum
+  int64_t min_backoff_ms = 500;
+  int64_t max_backoff_ms = 30000;
+  // Rewrite the file once it is this large and nothing is outstanding
+  size_t compact_bytes = 256 * 1024;
+};
+
+// Counters since Open().
+struct CheckJournalStats {
+  uint64_t appended = 0;
+  uint64_t acked = 0;
+  uint64_t duplicates = 0;
+  uint64_t rejected = 0;
+  uint64_t unknown = 0;
+  uint64_t failures = 0;
+  uint64_t syncs = 0;
+  uint64_t replayed = 0;
+  // Replayed entries that were being sent when the app stopped
+  uint64_t unsettled = 0;
+  uint64_t pending = 0;
+  uint64_t in_flight = 0;
+  uint64_t file_bytes = 0;
+  int64_t backoff_ms = 0;
+};
+
+// Write-behind journal for checked-amount increments.
+//
+// A scan is appended (and is durable against an app crash as soon as
+// Append returns; against power loss after the next fsync) and the UI moves
+// on. A flusher takes batches of unacknowledged entries, sends them, and
+// reports each outcome with Ack: the server's affected count, or
+// kCheckRejected / kCheckOutcomeUnknown. Only an entry that certainly did
+// not reach the server is reported with Fail and retried after a backoff.
+//
+// The file is a header followed by CRC-framed records:
+//   [u32 payload length][u32 CRC-32 of payload][payload]
+// Payloads are increments, acks, and sending/requeued marks written as
+// entries are taken and failed. Open replays the file, stops at the first
+// torn or corrupt frame (the tail of a crashed write) and truncates it, and
+// re-queues every increment without an ack that was not being sent. Those
+// that were are held for TakeUnsettled: the server may have applied them.
+// All methods are thread-safe.
+class CheckJournal {
+ public:
+  explicit CheckJournal(CheckJournalOptions options = CheckJournalOptions());
+  ~CheckJournal();
+
+  CheckJournal(const CheckJournal&) = delete;
+  CheckJournal& operator=(const CheckJournal&) = delete;
+
+  // Opens or creates the journal at |path| and replays it.
+  bool Open(const std::string& path);
+  void Close();
+  bool IsOpen() const;
+
+  // Appends an increment and returns its sequence number, or 0 on failure.
+  uint64_t Append(int64_t rxrecipe_id, int32_t delta,
+                  std::string_view pack_serial, int64_t now_ms);
+
+  // Moves up to |max| queued entries, oldest first, to in-flight and
+  // appends them to |out|. Returns nothing while a backoff is running.
+  size_t TakeBatch(size_t max, int64_t now_ms, std::vector<CheckEntry>* out);
+
+  // Moves up to |max| entries that were being sent when the app stopped to
+  // in-flight and appends them to |out|. Settle each with Ack, usually
+  // kCheckOutcomeUnknown after the user has been told.
+  size_t TakeUnsettled(size_t max, std::vector<CheckEntry>* out);
+
+  // |seq| is settled. |affected| == 0 means the server saw a duplicate;
+  // kCheckRejected and kCheckOutcomeUnknown are settled without a count.
+  void Ack(uint64_t seq, int32_t affected);
+
+  // |seq| did not reach the server (e.g. the connection could not be
+  // opened); it is queued again (ahead of newer entries) and the next
+  // TakeBatch waits for the backoff.
+  void Fail(uint64_t seq, int64_t now_ms);
+
+  // fsyncs if the batch size or interval in the options has been reached.
+  void SyncIfDue(int64_t now_ms);
+
+  // fsyncs now.
+  bool Sync();
+
+  CheckJournalStats GetStats() const;
+
+ private:
+  bool WriteRecord(const std::string& payload);
+  // A record of |type| carrying only |seq|
+  bool WriteMark(uint8_t type, uint64_t seq);
+  bool SyncLocked();
+  void Replay();
+  void MaybeCompact();
+  bool WriteHeader();
+
+  mutable std::mutex mutex_;
+  CheckJournalOptions options_;
+  std::string path_;
+  int fd_;
+  uint64_t file_bytes_;
+  uint64_t next_seq_;
+
+  // Queued entries in send order, and entries handed to the flusher
+  std::deque<CheckEntry> queue_;
+  std::unordered_map<uint64_t, CheckEntry> in_flight_;
+  // Replayed entries whose sending was not settled
+  std::deque<CheckEntry> unsettled_;
+
+  size_t unsynced_;
+  int64_t first_unsynced_ms_;
+  int64_t backoff_ms_;
+  int64_t retry_at_ms_;
+  CheckJournalStats stats_;
+};
+
+#endif  // NATIVE_CHECK_JOURNAL_H_
@@ -0,0 +1,11 @@
+#ifndef NATIVE_CRC32_H_
+#define NATIVE_CRC32_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE 802.3, the zlib polynomial) of |length| bytes at |data|.
+// Pass a previous result as |crc| to continue over several buffers.
+uint32_t Crc32(const void* data, size_t length, uint32_t crc = 0);
+
+#endif  // NATIVE_CRC32_H_
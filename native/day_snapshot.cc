@@ -0,0 +1,489 @@
+#include "native/day_snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+#include "native/crc32.h"
+#include "native/field_text.h"
+#include "native/rpc_records.h"
+
+namespace {
+
+constexpr uint32_t kMagic = 0x53445050;  // "PPDS"
+constexpr uint32_t kFormatVersion = 1;
+constexpr size_t kInitialEntries = 256;
+constexpr size_t kInitialData = 256 * 1024;
+constexpr uint32_t kDirty = 1;
+constexpr uint32_t kNoSlot = UINT32_MAX;
+
+size_t Align8(size_t value) { return (value + 7) & ~static_cast<size_t>(7); }
+
+// Feeds each rxhead row's members into a CRC and notes its tfn.
+class HeadSignatureSink : public JsonRowSink {
+ public:
+  explicit HeadSignatureSink(std::vector<std::pair<int64_t, uint32_t>>* out)
+      : out_(out) {}
+
+  ~HeadSignatureSink() override { EndRow(); }
+
+  void BeginRow() override {
+    EndRow();
+    in_row_ = true;
+    crc_ = 0;
+    tfn_ = 0;
+  }
+
+  int32_t Field(std::string_view key) override {
+    crc_ = Crc32(key.data(), key.size(), crc_);
+    crc_ = Crc32("=", 1, crc_);
+    return key == "tfn" ? 1 : 0;
+  }
+
+  void String(int32_t column, std::string_view value) override {
+    Value(value);
+    double number;
+    if (column == 1 && ParseFieldNumber(value, &number)) {
+      tfn_ = static_cast<int64_t>(number);
+    }
+  }
+
+  void Number(int32_t column, double value) override {
+    const std::string text = FormatFieldNumber(value);
+    Value(text);
+    if (column == 1 && std::isfinite(value)) {
+      tfn_ = static_cast<int64_t>(value);
+    }
+  }
+
+  void Bool(int32_t, bool value) override {
+    Value(value ? "true" : "false");
+  }
+
+ private:
+  void Value(std::string_view text) {
+    crc_ = Crc32(text.data(), text.size(), crc_);
+    crc_ = Crc32(";", 1, crc_);
+  }
+
+  void EndRow() {
+    if (in_row_ && tfn_ != 0) {
+      out_->emplace_back(tfn_, crc_);
+    }
+    in_row_ = false;
+  }
+
+  std::vector<std::pair<int64_t, uint32_t>>* out_;
+  bool in_row_ = false;
+  uint32_t crc_ = 0;
+  int64_t tfn_ = 0;
+};
+
+}  // namespace
+
+// On-disk layout, fixed-width plain data like UnitCache's. Offsets in
+// entries are relative to the data area, which follows the entry table.
+struct DaySnapshot::Header {
+  uint32_t magic;
+  uint32_t format_version;
+  int32_t day;
+  uint32_t generation;
+  uint32_t capacity;   // entry slots
+  uint32_t used;       // slots ever used; free ones have kind 0
+  uint64_t data_used;  // bytes appended to the data area
+  uint64_t live_bytes;
+  int64_t synced_ms;
+  uint32_t reserved[4];
+};
+
+struct DaySnapshot::Entry {
+  int64_t key;
+  uint64_t offset;
+  uint32_t length;
+  uint32_t crc;
+  int64_t fetched_ms;
+  // SnapshotKind; 0 marks a free slot
+  uint32_t kind;
+  uint32_t flags;
+  // Signature of the head row when a kRecipes entry was fetched
+  uint32_t head_signature;
+  uint32_t reserved;
+};
+
+DaySnapshot::DaySnapshot() {
+  static_assert(sizeof(Header) == 64, "header layout");
+  static_assert(sizeof(Entry) == 48, "entry layout");
+}
+
+DaySnapshot::~DaySnapshot() { Close(); }
+
+DaySnapshot::Header* DaySnapshot::header() {
+  return reinterpret_cast<Header*>(file_.data());
+}
+
+const DaySnapshot::Header* DaySnapshot::header() const {
+  return reinterpret_cast<const Header*>(file_.data());
+}
+
+DaySnapshot::Entry* DaySnapshot::entries() {
+  return reinterpret_cast<Entry*>(file_.data() + sizeof(Header));
+}
+
+const DaySnapshot::Entry* DaySnapshot::entries() const {
+  return reinterpret_cast<const Entry*>(file_.data() + sizeof(Header));
+}
+
+uint8_t* DaySnapshot::data_area() {
+  return file_.data() + sizeof(Header) + header()->capacity * sizeof(Entry);
+}
+
+const uint8_t* DaySnapshot::data_area() const {
+  return file_.data() + sizeof(Header) + header()->capacity * sizeof(Entry);
+}
+
+size_t DaySnapshot::DataCapacity() const {
+  return file_.size() - sizeof(Header) - header()->capacity * sizeof(Entry);
+}
+
+bool DaySnapshot::Initialize(size_t capacity, size_t data) {
+  if (!file_.Resize(sizeof(Header) + capacity * sizeof(Entry) + data)) {
+    return false;
+  }
+  std::memset(file_.data(), 0, sizeof(Header) + capacity * sizeof(Entry));
+  Header* h = header();
+  h->magic = kMagic;
+  h->format_version = kFormatVersion;
+  h->day = day_;
+  h->capacity = static_cast<uint32_t>(capacity);
+  return true;
+}
+
+bool DaySnapshot::Open(const std::string& path, int32_t day) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  file_.Close();
+  index_.clear();
+  signatures_.clear();
+  head_order_.clear();
+  stats_ = DaySnapshotStats();
+  day_ = day;
+  if (!file_.Open(path, sizeof(Header))) {
+    return false;
+  }
+  const Header* h = header();
+  const bool valid =
+      h->magic == kMagic && h->format_version == kFormatVersion &&
+      h->day == day && h->capacity > 0 && h->used <= h->capacity &&
+      file_.size() >= sizeof(Header) + h->capacity * sizeof(Entry) &&
+      h->data_used <= DataCapacity();
+  if (!valid && !Initialize(kInitialEntries, kInitialData)) {
+    file_.Close();
+    return false;
+  }
+  file_.Prefetch();
+  Load();
+  return true;
+}
+
+void DaySnapshot::Load() {
+  Header* h = header();
+  Entry* table = entries();
+  uint64_t live = 0;
+  for (uint32_t slot = 0; slot < h->used; ++slot) {
+    Entry& entry = table[slot];
+    if (entry.kind == 0) {
+      continue;
+    }
+    const bool in_range = entry.offset <= h->data_used &&
+                          entry.length <= h->data_used - entry.offset;
+    const bool known =
+        entry.kind == static_cast<uint32_t>(SnapshotKind::kHeads) ||
+        entry.kind == static_cast<uint32_t>(SnapshotKind::kRecipes);
+    if (!known || !in_range ||
+        Crc32(data_area() + entry.offset, entry.length) != entry.crc ||
+        !index_.emplace(EntryKey(entry.kind, entry.key), slot).second) {
+      std::memset(&entry, 0, sizeof(entry));
+      ++stats_.dropped;
+      continue;
+    }
+    live += entry.length;
+  }
+  h->live_bytes = live;
+  IndexHeads();
+}
+
+void DaySnapshot::IndexHeads() {
+  signatures_.clear();
+  head_order_.clear();
+  auto it = index_.find(
+      EntryKey(static_cast<uint32_t>(SnapshotKind::kHeads), 0));
+  if (it == index_.end()) {
+    return;
+  }
+  const Entry& entry = entries()[it->second];
+  const std::string_view json(
+      reinterpret_cast<const char*>(data_area() + entry.offset), entry.length);
+  for (const auto& row : HeadSignatures(json)) {
+    if (signatures_.emplace(row.first, row.second).second) {
+      head_order_.push_back(row.first);
+    }
+  }
+}
+
+void DaySnapshot::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_.IsOpen()) {
+    file_.Sync(false);
+  }
+  file_.Close();
+  index_.clear();
+  signatures_.clear();
+  head_order_.clear();
+}
+
+bool DaySnapshot::IsOpen() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_.IsOpen();
+}
+
+bool DaySnapshot::Get(SnapshotKind kind, int64_t key, std::string* out,
+                      int64_t* fetched_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(EntryKey(static_cast<uint32_t>(kind), key));
+  if (!file_.IsOpen() || it == index_.end()) {
+    ++stats_.misses;
+    return false;
+  }
+  const Entry& entry = entries()[it->second];
+  out->assign(reinterpret_cast<const char*>(data_area() + entry.offset),
+              entry.length);
+  if (fetched_ms != nullptr) {
+    *fetched_ms = entry.fetched_ms;
+  }
+  ++stats_.hits;
+  return true;
+}
+
+uint32_t DaySnapshot::FreeSlot() {
+  Header* h = header();
+  for (uint32_t slot = 0; slot < h->used; ++slot) {
+    if (entries()[slot].kind == 0) {
+      return slot;
+    }
+  }
+  return h->used < h->capacity ? h->used : kNoSlot;
+}
+
+void DaySnapshot::Remove(uint32_t slot) {
+  Entry& entry = entries()[slot];
+  index_.erase(EntryKey(entry.kind, entry.key));
+  header()->live_bytes -= entry.length;
+  std::memset(&entry, 0, sizeof(entry));
+}
+
+SnapshotPut DaySnapshot::Put(SnapshotKind kind, int64_t key,
+                             std::string_view json, int64_t now_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!file_.IsOpen() || json.size() > UINT32_MAX) {
+    return SnapshotPut::kFailed;
+  }
+  ++stats_.puts;
+  const EntryKey entry_key(static_cast<uint32_t>(kind), key);
+  uint32_t signature = 0;
+  if (kind == SnapshotKind::kRecipes) {
+    auto sig = signatures_.find(key);
+    signature = sig != signatures_.end() ? sig->second : 0;
+  }
+
+  auto it = index_.find(entry_key);
+  if (it != index_.end()) {
+    Entry& entry = entries()[it->second];
+    if (entry.length == json.size() &&
+        std::memcmp(data_area() + entry.offset, json.data(), json.size()) ==
+            0) {
+      entry.fetched_ms = now_ms;
+      entry.flags &= ~kDirty;
+      entry.head_signature = signature;
+      return SnapshotPut::kUnchanged;
+    }
+  }
+
+  // Room for the bytes and, for a new entry, a slot
+  Header* h = header();
+  uint32_t slot = it != index_.end() ? it->second : FreeSlot();
+  const size_t need = Align8(json.size());
+  if (slot == kNoSlot || h->data_used + need > DataCapacity()) {
+    const size_t live = h->live_bytes + need;
+    const size_t capacity =
+        slot == kNoSlot ? h->capacity * 2 : static_cast<size_t>(h->capacity);
+    const size_t garbage = h->data_used - h->live_bytes;
+    if (slot == kNoSlot || garbage > h->live_bytes) {
+      if (!Compact(capacity, std::max(kInitialData, live * 2))) {
+        return SnapshotPut::kFailed;
+      }
+      ++stats_.compactions;
+    } else {
+      const size_t grown = std::max(DataCapacity() * 2, h->data_used + need);
+      if (!file_.Resize(sizeof(Header) + h->capacity * sizeof(Entry) +
+                        grown)) {
+        return SnapshotPut::kFailed;
+      }
+    }
+    h = header();
+    it = index_.find(entry_key);
+    slot = it != index_.end() ? it->second : FreeSlot();
+  }
+
+  // Bytes first, then the entry that points at them; a crash in between
+  // leaves an entry whose CRC fails and is dropped at the next Open.
+  const uint64_t offset = h->data_used;
+  std::memcpy(data_area() + offset, json.data(), json.size());
+  h->data_used = offset + need;
+  Entry& entry = entries()[slot];
+  if (entry.kind != 0) {
+    h->live_bytes -= entry.length;
+  }
+  entry.key = key;
+  entry.offset = offset;
+  entry.length = static_cast<uint32_t>(json.size());
+  entry.crc = Crc32(json.data(), json.size());
+  entry.fetched_ms = now_ms;
+  entry.flags = 0;
+  entry.head_signature = signature;
+  entry.kind = static_cast<uint32_t>(kind);
+  h->live_bytes += json.size();
+  if (slot >= h->used) {
+    h->used = slot + 1;
+  }
+  index_[entry_key] = slot;
+  ++stats_.changed;
+
+  if (kind == SnapshotKind::kHeads) {
+    IndexHeads();
+    // Prescriptions that left the day (cancelled, moved)
+    std::vector<uint32_t> gone;
+    for (const auto& item : index_) {
+      if (item.first.first == static_cast<uint32_t>(SnapshotKind::kRecipes) &&
+          signatures_.count(item.first.second) == 0) {
+        gone.push_back(item.second);
+      }
+    }
+    for (uint32_t slot_gone : gone) {
+      Remove(slot_gone);
+    }
+  }
+  return SnapshotPut::kChanged;
+}
+
+bool DaySnapshot::Compact(size_t capacity, size_t data) {
+  // Into a temporary file first, so a crash leaves the old snapshot whole
+  const std::string path = file_.path();
+  const std::string temp = path + ".tmp";
+  MappedFile fresh;
+  const size_t table = sizeof(Header) + capacity * sizeof(Entry);
+  if (!fresh.Open(temp, table + data) || !fresh.Resize(table + data)) {
+    return false;
+  }
+  std::memset(fresh.data(), 0, table);
+  Header* h = reinterpret_cast<Header*>(fresh.data());
+  *h = *header();
+  h->capacity = static_cast<uint32_t>(capacity);
+  h->used = 0;
+  h->data_used = 0;
+  h->live_bytes = 0;
+  Entry* table_out = reinterpret_cast<Entry*>(fresh.data() + sizeof(Header));
+  uint8_t* data_out = fresh.data() + table;
+  for (const auto& item : index_) {
+    const Entry& entry = entries()[item.second];
+    Entry& copy = table_out[h->used++];
+    copy = entry;
+    copy.offset = h->data_used;
+    std::memcpy(data_out + h->data_used, data_area() + entry.offset,
+                entry.length);
+    h->data_used += Align8(entry.length);
+    h->live_bytes += entry.length;
+  }
+  fresh.Sync(true);
+  fresh.Close();
+  file_.Close();
+  std::error_code error;
+  std::filesystem::rename(std::filesystem::u8path(temp),
+                          std::filesystem::u8path(path), error);
+  if (!file_.Open(path, sizeof(Header))) {
+    index_.clear();
+    return false;
+  }
+  index_.clear();
+  for (uint32_t slot = 0; slot < header()->used; ++slot) {
+    const Entry& entry = entries()[slot];
+    index_.emplace(EntryKey(entry.kind, entry.key), slot);
+  }
+  return !error;
+}
+
+void DaySnapshot::MarkDirty(int64_t tfn) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it =
+      index_.find(EntryKey(static_cast<uint32_t>(SnapshotKind::kRecipes), tfn));
+  if (it != index_.end()) {
+    entries()[it->second].flags |= kDirty;
+  }
+}
+
+std::vector<int64_t> DaySnapshot::RecipesToFetch() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<int64_t> out;
+  if (!file_.IsOpen()) {
+    return out;
+  }
+  for (int64_t tfn : head_order_) {
+    auto it = index_.find(
+        EntryKey(static_cast<uint32_t>(SnapshotKind::kRecipes), tfn));
+    if (it == index_.end()) {
+      out.push_back(tfn);
+      continue;
+    }
+    const Entry& entry = entries()[it->second];
+    if ((entry.flags & kDirty) != 0 ||
+        entry.head_signature != signatures_.at(tfn)) {
+      out.push_back(tfn);
+    }
+  }
+  return out;
+}
+
+uint32_t DaySnapshot::Commit(int64_t now_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!file_.IsOpen()) {
+    return 0;
+  }
+  Header* h = header();
+  ++h->generation;
+  h->synced_ms = now_ms;
+  file_.Sync(false);
+  return h->generation;
+}
+
+DaySnapshotStats DaySnapshot::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  DaySnapshotStats stats = stats_;
+  if (file_.IsOpen()) {
+    const Header* h = header();
+    stats.entries = index_.size();
+    stats.live_bytes = h->live_bytes;
+    stats.file_bytes = file_.size();
+    stats.generation = h->generation;
+    stats.synced_ms = h->synced_ms;
+  }
+  return stats;
+}
+
+std::vector<std::pair<int64_t, uint32_t>> DaySnapshot::HeadSignatures(
+    std::string_view json) {
+  std::vector<std::pair<int64_t, uint32_t>> out;
+  {
+    HeadSignatureSink sink(&out);
+    DecodeJsonRows(json, &sink);
+  }
+  return out;
+}
@@ -0,0 +1,141 @@
+#ifndef NATIVE_DAY_SNAPSHOT_H_
+#define NATIVE_DAY_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "native/mapped_file.h"
+
+// What a DaySnapshot entry holds.
+enum class SnapshotKind : uint32_t {
+  // select_rxhead_bydate response of the day; key 0
+  kHeads = 1,
+  // select_rxrecipe_by_textfile_number response; key is the tfn
+  kRecipes = 2,
+};
+
+enum class SnapshotPut : int32_t {
+  kFailed = 0,
+  // Same bytes as before; only the fetch time moved
+  kUnchanged = 1,
+  kChanged = 2,
+};
+
+// Counters since Open(), plus the file's shape.
+struct DaySnapshotStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t puts = 0;
+  uint64_t changed = 0;
+  uint64_t compactions = 0;
+  // Entries dropped at Open because their bytes failed the CRC
+  uint64_t dropped = 0;
+  uint64_t entries = 0;
+  uint64_t live_bytes = 0;
+  uint64_t file_bytes = 0;
+  uint32_t generation = 0;
+  int64_t synced_ms = 0;
+};
+
+// One day's prescriptions as last fetched: the rxhead list and the rxrecipe
+// rows of each of its prescriptions, kept as the JSON the server sent in a
+// memory-mapped file, so a restart or a flaky network still has the day on
+// screen at once.
+//
+// The file is a header, a table of entries and an append-only data area.
+// Replacing an entry appends its new bytes; once more than half the data
+// area is garbage the file is rewritten into a temporary file that then
+// replaces it. Every entry carries a CRC of its bytes; Open drops entries
+// that fail it (a write torn by a crash), so they are fetched again.
+//
+// Incremental sync: the server has no change feed, so the heads list is the
+// delta signal. Each rxhead row gets a signature (CRC of its fields), and a
+// prescription's rows are stored with the signature its head had then.
+// RecipesToFetch lists the prescriptions that are new, whose head row
+// changed (e.g. is_complete), or that were marked dirty by a local write;
+// only those need a request. All methods are thread-safe.
+class DaySnapshot {
+ public:
+  DaySnapshot();
+  ~DaySnapshot();
+
+  DaySnapshot(const DaySnapshot&) = delete;
+  DaySnapshot& operator=(const DaySnapshot&) = delete;
+
+  // Maps |path| for |day| (yyyymmdd). A missing, foreign, damaged or other
+  // day's file starts empty.
+  bool Open(const std::string& path, int32_t day);
+  void Close();
+  bool IsOpen() const;
+
+  // Copies the bytes of an entry to |out|. Returns false if there is none.
+  bool Get(SnapshotKind kind, int64_t key, std::string* out,
+           int64_t* fetched_ms = nullptr);
+
+  // Stores a response fetched at |now_ms|. Storing the heads list also
+  // drops the rows of prescriptions no longer in it.
+  SnapshotPut Put(SnapshotKind kind, int64_t key, std::string_view json,
+                  int64_t now_ms);
+
+  // The next RecipesToFetch lists |tfn| again, e.g. after a local check.
+  void MarkDirty(int64_t tfn);
+
+  // Prescriptions of the stored heads list, in its order, whose rows are
+  // missing, dirty or older than their head row.
+  std::vector<int64_t> RecipesToFetch() const;
+
+  // Ends a sync: bumps the generation, records |now_ms| and starts writing
+  // the pages back. Returns the new generation.
+  uint32_t Commit(int64_t now_ms);
+
+  DaySnapshotStats GetStats() const;
+
+  // Signature per tfn of each row of an rxhead list, in order. Rows
+  // without a tfn are left out. Exposed for tests.
+  static std::vector<std::pair<int64_t, uint32_t>> HeadSignatures(
+      std::string_view json);
+
+ private:
+  struct Header;
+  struct Entry;
+
+  using EntryKey = std::pair<uint32_t, int64_t>;
+
+  Header* header();
+  const Header* header() const;
+  Entry* entries();
+  const Entry* entries() const;
+  uint8_t* data_area();
+  const uint8_t* data_area() const;
+  size_t DataCapacity() const;
+
+  // Starts an empty file with room for |capacity| entries and |data| bytes.
+  bool Initialize(size_t capacity, size_t data);
+  // Rebuilds index_ and signatures_ from the mapped file; drops bad entries.
+  void Load();
+  void IndexHeads();
+  // Rewrites the live entries into a fresh file with room for |capacity|
+  // entries and |data| bytes.
+  bool Compact(size_t capacity, size_t data);
+  void Remove(uint32_t slot);
+  // Free slot for a new entry, or UINT32_MAX
+  uint32_t FreeSlot();
+
+  mutable std::mutex mutex_;
+  MappedFile file_;
+  int32_t day_ = 0;
+  std::map<EntryKey, uint32_t> index_;
+  // tfn -> signature of its row in the stored heads list
+  std::unordered_map<int64_t, uint32_t> signatures_;
+  std::vector<int64_t> head_order_;
+  mutable DaySnapshotStats stats_;
+};
+
+#endif  // NATIVE_DAY_SNAPSHOT_H_
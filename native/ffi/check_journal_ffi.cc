@@ -0,0 +1,128 @@
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "native/check_journal.h"
+#include "native/ffi/pharm_native_ffi.h"
+
+struct PharmCheckJournal {
+  CheckJournal journal;
+};
+
+namespace {
+
+int32_t CopyEntries(const std::vector<CheckEntry>& batch,
+                    PharmCheckEntry* out) {
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const CheckEntry& entry = batch[i];
+    PharmCheckEntry& record = out[i];
+    record.seq = static_cast<int64_t>(entry.seq);
+    record.rxrecipe_id = entry.rxrecipe_id;
+    record.created_ms = entry.created_ms;
+    record.delta = entry.delta;
+    // Append caps serials at 255 bytes, so this always fits.
+    const size_t length = entry.pack_serial.size() < sizeof(record.pack_serial)
+                              ? entry.pack_serial.size()
+                              : sizeof(record.pack_serial) - 1;
+    memcpy(record.pack_serial, entry.pack_serial.data(), length);
+    record.pack_serial[length] = '\0';
+  }
+  return static_cast<int32_t>(batch.size());
+}
+
+}  // namespace
+
+PharmCheckJournal* pharm_check_journal_open(const char* path) {
+  if (path == nullptr) {
+    return nullptr;
+  }
+  PharmCheckJournal* journal = new PharmCheckJournal();
+  if (!journal->journal.Open(path)) {
+    delete journal;
+    return nullptr;
+  }
+  return journal;
+}
+
+void pharm_check_journal_close(PharmCheckJournal* journal) { delete journal; }
+
+int64_t pharm_check_journal_append(PharmCheckJournal* journal,
+                                   int64_t rxrecipe_id, int32_t delta,
+                                   const char* pack_serial,
+                                   int32_t serial_length, int64_t now_ms) {
+  if (journal == nullptr || serial_length < 0 ||
+      (pack_serial == nullptr && serial_length > 0)) {
+    return 0;
+  }
+  return static_cast<int64_t>(journal->journal.Append(
+      rxrecipe_id, delta,
+      std::string_view(pack_serial, static_cast<size_t>(serial_length)),
+      now_ms));
+}
+
+int32_t pharm_check_journal_take_batch(PharmCheckJournal* journal,
+                                       PharmCheckEntry* out, int32_t capacity,
+                                       int64_t now_ms) {
+  if (journal == nullptr || out == nullptr || capacity <= 0) {
+    return 0;
+  }
+  std::vector<CheckEntry> batch;
+  journal->journal.TakeBatch(static_cast<size_t>(capacity), now_ms, &batch);
+  return CopyEntries(batch, out);
+}
+
+int32_t pharm_check_journal_take_unsettled(PharmCheckJournal* journal,
+                                           PharmCheckEntry* out,
+                                           int32_t capacity) {
+  if (journal == nullptr || out == nullptr || capacity <= 0) {
+    return 0;
+  }
+  std::vector<CheckEntry> batch;
+  journal->journal.TakeUnsettled(static_cast<size_t>(capacity), &batch);
+  return CopyEntries(batch, out);
+}
+
+void pharm_check_journal_ack(PharmCheckJournal* journal, int64_t seq,
+                             int32_t affected) {
+  if (journal != nullptr) {
+    journal->journal.Ack(static_cast<uint64_t>(seq), affected);
+  }
+}
+
+void pharm_check_journal_fail(PharmCheckJournal* journal, int64_t seq,
+                              int64_t now_ms) {
+  if (journal != nullptr) {
+    journal->journal.Fail(static_cast<uint64_t>(seq), now_ms);
+  }
+}
+
+void pharm_check_journal_sync_if_due(PharmCheckJournal* journal,
+                                     int64_t now_ms) {
+  if (journal != nullptr) {
+    journal->journal.SyncIfDue(now_ms);
+  }
+}
+
+void pharm_check_journal_stats(const PharmCheckJournal* journal,
+                               PharmCheckJournalStats* out) {
+  if (out == nullptr) {
+    return;
+  }
+  CheckJournalStats stats;
+  if (journal != nullptr) {
+    stats = journal->journal.GetStats();
+  }
+  out->appended = static_cast<int64_t>(stats.appended);
+  out->acked = static_cast<int64_t>(stats.acked);
+  out->duplicates = static_cast<int64_t>(stats.duplicates);
+  out->failures = static_cast<int64_t>(stats.failures);
+  out->syncs = static_cast<int64_t>(stats.syncs);
+  out->replayed = static_cast<int64_t>(stats.replayed);
+  out->pending = static_cast<int64_t>(stats.pending);
+  out->in_flight = static_cast<int64_t>(stats.in_flight);
+  out->file_bytes = static_cast<int64_t>(stats.file_bytes);
+  out->backoff_ms = stats.backoff_ms;
+  out->rejected = static_cast<int64_t>(stats.rejected);
+  out->unknown = static_cast<int64_t>(stats.unknown);
+  out->unsettled = static_cast<int64_t>(stats.unsettled);
+}
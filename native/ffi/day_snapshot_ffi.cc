@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "native/day_snapshot.h"
+#include "native/ffi/pharm_native_ffi.h"
+
+struct PharmDaySnapshot {
+  DaySnapshot snapshot;
+  // Holds the last entry read, so a call with a larger buffer after a
+  // too-small one reads nothing twice
+  std::string scratch;
+  int32_t scratch_kind = 0;
+  int64_t scratch_key = 0;
+  int64_t scratch_fetched_ms = 0;
+  bool scratch_valid = false;
+};
+
+namespace {
+
+bool ValidKind(int32_t kind) {
+  return kind == static_cast<int32_t>(SnapshotKind::kHeads) ||
+         kind == static_cast<int32_t>(SnapshotKind::kRecipes);
+}
+
+}  // namespace
+
+PharmDaySnapshot* pharm_day_snapshot_open(const char* path, int32_t day) {
+  if (path == nullptr) {
+    return nullptr;
+  }
+  PharmDaySnapshot* snapshot = new PharmDaySnapshot();
+  if (!snapshot->snapshot.Open(path, day)) {
+    delete snapshot;
+    return nullptr;
+  }
+  return snapshot;
+}
+
+void pharm_day_snapshot_close(PharmDaySnapshot* snapshot) { delete snapshot; }
+
+int64_t pharm_day_snapshot_get(PharmDaySnapshot* snapshot, int32_t kind,
+                               int64_t key, uint8_t* buffer, int64_t capacity,
+                               int64_t* fetched_ms) {
+  if (snapshot == nullptr || !ValidKind(kind)) {
+    return -1;
+  }
+  const bool cached = snapshot->scratch_valid &&
+                      snapshot->scratch_kind == kind &&
+                      snapshot->scratch_key == key;
+  if (!cached) {
+    snapshot->scratch_valid = snapshot->snapshot.Get(
+        static_cast<SnapshotKind>(kind), key, &snapshot->scratch,
+        &snapshot->scratch_fetched_ms);
+    snapshot->scratch_kind = kind;
+    snapshot->scratch_key = key;
+    if (!snapshot->scratch_valid) {
+      return -1;
+    }
+  }
+  const int64_t length = static_cast<int64_t>(snapshot->scratch.size());
+  if (buffer != nullptr && length <= capacity) {
+    std::memcpy(buffer, snapshot->scratch.data(), snapshot->scratch.size());
+    if (fetched_ms != nullptr) {
+      *fetched_ms = snapshot->scratch_fetched_ms;
+    }
+    // Copied out; the next read goes to the file again
+    snapshot->scratch_valid = false;
+  }
+  return length;
+}
+
+int32_t pharm_day_snapshot_put(PharmDaySnapshot* snapshot, int32_t kind,
+                               int64_t key, const uint8_t* json,
+                               int64_t length, int64_t now_ms) {
+  if (snapshot == nullptr || !ValidKind(kind) || length < 0 ||
+      (json == nullptr && length > 0)) {
+    return static_cast<int32_t>(SnapshotPut::kFailed);
+  }
+  snapshot->scratch_valid = false;
+  return static_cast<int32_t>(snapshot->snapshot.Put(
+      static_cast<SnapshotKind>(kind), key,
+      std::string_view(reinterpret_cast<const char*>(json),
+                       static_cast<size_t>(length)),
+      now_ms));
+}
+
+void pharm_day_snapshot_mark_dirty(PharmDaySnapshot* snapshot, int64_t tfn) {
+  if (snapshot != nullptr) {
+    snapshot->snapshot.MarkDirty(tfn);
+  }
+}
+
+int32_t pharm_day_snapshot_recipes_to_fetch(PharmDaySnapshot* snapshot,
+                                            int64_t* out, int32_t capacity) {
+  if (snapshot == nullptr) {
+    return 0;
+  }
+  const std::vector<int64_t> tfns = snapshot->snapshot.RecipesToFetch();
+  if (out != nullptr && capacity > 0) {
+    std::copy_n(tfns.begin(),
+                std::min(tfns.size(), static_cast<size_t>(capacity)), out);
+  }
+  return static_cast<int32_t>(tfns.size());
+}
+
+int32_t pharm_day_snapshot_commit(PharmDaySnapshot* snapshot, int64_t now_ms) {
+  if (snapshot == nullptr) {
+    return 0;
+  }
+  return static_cast<int32_t>(snapshot->snapshot.Commit(now_ms));
+}
+
+void pharm_day_snapshot_stats(const PharmDaySnapshot* snapshot,
+                              PharmDaySnapshotStats* out) {
+  if (out == nullptr) {
+    return;
+  }
+  DaySnapshotStats stats;
+  if (snapshot != nullptr) {
+    stats = snapshot->snapshot.GetStats();
+  }
+  out->hits = static_cast<int64_t>(stats.hits);
+  out->misses = static_cast<int64_t>(stats.misses);
+  out->puts = static_cast<int64_t>(stats.puts);
+  out->changed = static_cast<int64_t>(stats.changed);
+  out->compactions = static_cast<int64_t>(stats.compactions);
+  out->dropped = static_cast<int64_t>(stats.dropped);
+  out->entries = static_cast<int64_t>(stats.entries);
+  out->live_bytes = static_cast<int64_t>(stats.live_bytes);
+  out->file_bytes = static_cast<int64_t>(stats.file_bytes);
+  out->generation = static_cast<int64_t>(stats.generation);
+  out->synced_ms = stats.synced_ms;
+}
@@ -0,0 +1,72 @@
+#include <cstring>
+#include <string_view>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/gs1_parser.h"
+#include "native/line_framer.h"
+
+namespace {
+
+template <size_t N>
+void CopyField(std::string_view input, const Gs1Parse& parse, uint16_t ai,
+               char (&out)[N]) {
+  const Gs1Element* element = parse.Find(ai);
+  size_t length = 0;
+  if (element != nullptr) {
+    std::string_view value = Gs1Value(input, *element);
+    length = value.size() < N - 1 ? value.size() : N - 1;
+    memcpy(out, value.data(), length);
+  }
+  out[length] = '\0';
+}
+
+int32_t FillRecord(std::string_view input, PharmGs1Record* out) {
+  Gs1Parse parse;
+  ParseGs1(input, &parse);
+  out->status = static_cast<int32_t>(parse.status);
+
+  // Plain EAN/UPC codes are widened to GTIN-14.
+  const Gs1Element* gtin = parse.Find(kGs1AiGtin);
+  size_t length = 0;
+  if (gtin != nullptr && gtin->length <= 14) {
+    const size_t pad = 14 - gtin->length;
+    memset(out->gtin, '0', pad);
+    memcpy(out->gtin + pad, input.data() + gtin->offset, gtin->length);
+    length = 14;
+  }
+  out->gtin[length] = '\0';
+
+  CopyField(input, parse, kGs1AiExpiry, out->expiry);
+  CopyField(input, parse, kGs1AiLot, out->lot);
+  CopyField(input, parse, kGs1AiSerial, out->serial);
+  return out->status;
+}
+
+}  // namespace
+
+int32_t pharm_gs1_parse(const char* data, int32_t length,
+                        PharmGs1Record* out) {
+  if (data == nullptr || length < 0 || out == nullptr) {
+    return static_cast<int32_t>(Gs1Status::kEmpty);
+  }
+  return FillRecord(std::string_view(data, static_cast<size_t>(length)), out);
+}
+
+int32_t pharm_gs1_parse_batch(const char* data, int32_t length,
+                              PharmGs1Record* out, int32_t capacity) {
+  if (data == nullptr || length <= 0 || out == nullptr || capacity <= 0) {
+    return 0;
+  }
+  int32_t count = 0;
+  LineFramer framer;
+  auto on_code = [&count, out, capacity](std::string_view code) {
+    if (count < capacity) {
+      FillRecord(code, &out[count++]);
+    }
+  };
+  framer.Feed(data, static_cast<size_t>(length), on_code);
+  // The last code does not need a trailing newline.
+  static const char kNewline = '\n';
+  framer.Feed(&kNewline, 1, on_code);
+  return count;
+}
@@ -0,0 +1,91 @@
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/metrics_registry.h"
+
+namespace {
+
+std::string_view View(const char* text) {
+  return text != nullptr ? std::string_view(text) : std::string_view();
+}
+
+std::string Labels(const char* key, const char* value) {
+  return key != nullptr && *key != '\0' ? MetricLabel(key, View(value))
+                                        : std::string();
+}
+
+std::mutex writer_mutex;
+// Not destroyed at unload: joining a thread there deadlocks on Windows
+MetricsFileWriter* writer = nullptr;
+
+}  // namespace
+
+PharmMetricCounter* pharm_metrics_counter(const char* name,
+                                          const char* label_key,
+                                          const char* label_value,
+                                          const char* help) {
+  if (name == nullptr || *name == '\0') {
+    return nullptr;
+  }
+  return reinterpret_cast<PharmMetricCounter*>(&ProcessMetrics().GetCounter(
+      name, Labels(label_key, label_value), View(help)));
+}
+
+void pharm_metrics_counter_add(PharmMetricCounter* counter, int64_t n) {
+  if (counter != nullptr && n > 0) {
+    reinterpret_cast<MetricCounter*>(counter)->Add(static_cast<uint64_t>(n));
+  }
+}
+
+PharmMetricGauge* pharm_metrics_gauge(const char* name, const char* label_key,
+                                      const char* label_value,
+                                      const char* help) {
+  if (name == nullptr || *name == '\0') {
+    return nullptr;
+  }
+  return reinterpret_cast<PharmMetricGauge*>(&ProcessMetrics().GetGauge(
+      name, Labels(label_key, label_value), View(help)));
+}
+
+void pharm_metrics_gauge_set(PharmMetricGauge* gauge, int64_t value) {
+  if (gauge != nullptr) {
+    reinterpret_cast<MetricGauge*>(gauge)->Set(value);
+  }
+}
+
+PharmMetricHistogram* pharm_metrics_histogram(const char* name,
+                                              const char* label_key,
+                                              const char* label_value,
+                                              const char* help) {
+  if (name == nullptr || *name == '\0') {
+    return nullptr;
+  }
+  return reinterpret_cast<PharmMetricHistogram*>(
+      &ProcessMetrics().GetHistogram(name, Labels(label_key, label_value),
+                                     View(help)));
+}
+
+void pharm_metrics_histogram_record(PharmMetricHistogram* histogram,
+                                    int64_t value_us) {
+  if (histogram != nullptr) {
+    reinterpret_cast<LatencyHistogram*>(histogram)->Record(value_us);
+  }
+}
+
+int32_t pharm_metrics_write(const char* path) {
+  if (path == nullptr || *path == '\0') {
+    return 0;
+  }
+  return ProcessMetrics().WriteFile(path) ? 1 : 0;
+}
+
+void pharm_metrics_start_writer(const char* path, int32_t interval_ms) {
+  std::lock_guard<std::mutex> lock(writer_mutex);
+  delete writer;
+  writer = nullptr;
+  if (path != nullptr && *path != '\0') {
+    writer = new MetricsFileWriter(&ProcessMetrics(), path, interval_ms);
+  }
+}
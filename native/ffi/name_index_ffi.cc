@@ -0,0 +1,64 @@
+#include <cstring>
+#include <string_view>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/name_index.h"
+
+struct PharmNameIndex {
+  NameIndex index;
+};
+
+namespace {
+
+// Next '\n'-terminated line of [*cursor, end), advancing |*cursor|.
+std::string_view NextLine(const char** cursor, const char* end) {
+  const char* start = *cursor;
+  const char* newline = static_cast<const char*>(
+      memchr(start, '\n', static_cast<size_t>(end - start)));
+  const char* line_end = newline != nullptr ? newline : end;
+  *cursor = newline != nullptr ? newline + 1 : end;
+  return std::string_view(start, static_cast<size_t>(line_end - start));
+}
+
+}  // namespace
+
+PharmNameIndex* pharm_name_index_create(void) { return new PharmNameIndex(); }
+
+void pharm_name_index_destroy(PharmNameIndex* index) { delete index; }
+
+int32_t pharm_name_index_build(PharmNameIndex* index, const char* names,
+                               int32_t names_length, const char* numbers,
+                               int32_t numbers_length, int32_t count) {
+  if (index == nullptr) {
+    return 0;
+  }
+  index->index.Clear();
+  if (names == nullptr || names_length < 0 || numbers == nullptr ||
+      numbers_length < 0 || count <= 0) {
+    return 0;
+  }
+  index->index.Reserve(static_cast<size_t>(count));
+
+  const char* name_cursor = names;
+  const char* names_end = names + names_length;
+  const char* number_cursor = numbers;
+  const char* numbers_end = numbers + numbers_length;
+  for (int32_t i = 0; i < count; ++i) {
+    const std::string_view name = NextLine(&name_cursor, names_end);
+    index->index.Add(name, NextLine(&number_cursor, numbers_end));
+  }
+  return count;
+}
+
+int32_t pharm_name_index_search(const PharmNameIndex* index,
+                                const char* query, int32_t length,
+                                int32_t* ids, int32_t capacity) {
+  if (index == nullptr || query == nullptr || length <= 0) {
+    return 0;
+  }
+  static_assert(sizeof(int32_t) == sizeof(uint32_t), "ids are 32-bit");
+  return static_cast<int32_t>(index->index.Search(
+      std::string_view(query, static_cast<size_t>(length)),
+      reinterpret_cast<uint32_t*>(ids),
+      ids != nullptr && capacity > 0 ? static_cast<size_t>(capacity) : 0));
+}
@@ -0,0 +1,450 @@
+#ifndef NATIVE_FFI_PHARM_NATIVE_FFI_H_
+#define NATIVE_FFI_PHARM_NATIVE_FFI_H_
+
+// C entry points of libpharm_native_ffi, loaded from Dart with dart:ffi.
+// Keep the structs in sync with lib/native/pharm_native_bindings.dart.
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define PHARM_FFI_EXPORT __declspec(dllexport)
+#else
+#define PHARM_FFI_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --- GS1 barcodes -----------------------------------------------------------
+
+// Fields of one parsed pack barcode. Strings are NUL-terminated and empty
+// when the code does not carry the AI.
+typedef struct {
+  // Gs1Status; 0 means the whole code parsed cleanly
+  int32_t status;
+  // GTIN-14, left-padded with zeros for EAN-8/UPC-A/EAN-13 input
+  char gtin[15];
+  // AI (17), YYMMDD
+  char expiry[7];
+  // AI (10)
+  char lot[21];
+  // AI (21)
+  char serial[21];
+} PharmGs1Record;
+
+// Parses one barcode of |length| bytes. Returns the status.
+PHARM_FFI_EXPORT int32_t pharm_gs1_parse(const char* data, int32_t length,
+                                         PharmGs1Record* out);
+
+// Parses CR/LF separated barcodes, writing at most |capacity| records.
+// Returns the number of records written.
+PHARM_FFI_EXPORT int32_t pharm_gs1_parse_batch(const char* data,
+                                               int32_t length,
+                                               PharmGs1Record* out,
+                                               int32_t capacity);
+
+// --- Prescription row index -------------------------------------------------
+
+// Opaque handle to a RecipeIndex (native/recipe_index.h).
+typedef struct PharmRecipeIndex PharmRecipeIndex;
+
+PHARM_FFI_EXPORT PharmRecipeIndex* pharm_recipe_index_create(void);
+PHARM_FFI_EXPORT void pharm_recipe_index_destroy(PharmRecipeIndex* index);
+
+// Replaces the rows of |index| with |count| rows. |codes| holds their
+// pack_barcode values separated by '\n' (an empty line for a row without
+// one), |types| one type character per row and |complete| one 0/1 flag per
+// row. Returns the number of rows indexed.
+PHARM_FFI_EXPORT int32_t pharm_recipe_index_build(PharmRecipeIndex* index,
+                                                  const char* codes,
+                                                  int32_t codes_length,
+                                                  const char* types,
+                                                  const uint8_t* complete,
+                                                  int32_t count);
+
+// Updates the complete flag of one row after its checked_amount changed.
+PHARM_FFI_EXPORT void pharm_recipe_index_set_complete(PharmRecipeIndex* index,
+                                                      int32_t row,
+                                                      int32_t complete);
+
+// Writes the rows matching |barcode|, incomplete first, to |rows| (at most
+// |capacity|). Returns the number of matching rows.
+PHARM_FFI_EXPORT int32_t pharm_recipe_index_lookup(
+    const PharmRecipeIndex* index, const char* barcode, int32_t length,
+    int32_t* rows, int32_t capacity);
+
+// --- Patient name search ----------------------------------------------------
+
+// Opaque handle to a NameIndex (native/name_index.h).
+typedef struct PharmNameIndex PharmNameIndex;
+
+PHARM_FFI_EXPORT PharmNameIndex* pharm_name_index_create(void);
+PHARM_FFI_EXPORT void pharm_name_index_destroy(PharmNameIndex* index);
+
+// Replaces the entries of |index| with |count| entries. |names| and
+// |numbers| are UTF-8 with one '\n'-terminated line per entry; a numbers
+// line holds space-separated fields. Returns the number of entries indexed.
+PHARM_FFI_EXPORT int32_t pharm_name_index_build(PharmNameIndex* index,
+                                                const char* names,
+                                                int32_t names_length,
+                                                const char* numbers,
+                                                int32_t numbers_length,
+                                                int32_t count);
+
+// Writes the ids of the best matches of the UTF-8 |query| to |ids| (at most
+// |capacity|), best first. Returns the number of matching entries.
+PHARM_FFI_EXPORT int32_t pharm_name_index_search(const PharmNameIndex* index,
+                                                 const char* query,
+                                                 int32_t length, int32_t* ids,
+                                                 int32_t capacity);
+
+// --- Columnar prescription rows ---------------------------------------------
+
+// Opaque handle to a RecipeStore (native/recipe_store.h).
+typedef struct PharmRecipeStore PharmRecipeStore;
+
+// Dose sums of calculateTotals.
+typedef struct {
+  double morning;
+  double afternoon;
+  double evening;
+  double night;
+} PharmRecipeTotals;
+
+PHARM_FFI_EXPORT PharmRecipeStore* pharm_recipe_store_create(void);
+PHARM_FFI_EXPORT void pharm_recipe_store_destroy(PharmRecipeStore* store);
+
+// Drops all rows and strings and makes |rows| default rows. Column pointers
+// from before are invalid afterwards. Returns the row count.
+PHARM_FFI_EXPORT int32_t pharm_recipe_store_reset(PharmRecipeStore* store,
+                                                  int32_t rows);
+
+// First element of column |column| (a RecipeColumn), valid until the next
+// reset. Dart reads and writes the rows through it in place. Null for an
+// unknown column or an empty store.
+PHARM_FFI_EXPORT void* pharm_recipe_store_column(PharmRecipeStore* store,
+                                                 int32_t column);
+
+// RecipeColumn that RPC field |key| (UTF-8) belongs to, or -1 if it is not
+// kept. |rank| receives its rank among the keys of that column.
+PHARM_FFI_EXPORT int32_t pharm_recipe_store_column_for_key(const char* key,
+                                                           int32_t length,
+                                                           int32_t* rank);
+
+// Interns |length| bytes and returns the string id for a string column.
+PHARM_FFI_EXPORT uint32_t pharm_recipe_store_intern(PharmRecipeStore* store,
+                                                    const char* value,
+                                                    int32_t length);
+
+// Bytes of string |id|, NUL-terminated and valid until the next intern or
+// reset. |length| receives their count.
+PHARM_FFI_EXPORT const char* pharm_recipe_store_string(
+    const PharmRecipeStore* store, uint32_t id, int32_t* length);
+
+PHARM_FFI_EXPORT void pharm_recipe_store_totals(const PharmRecipeStore* store,
+                                                int32_t separation,
+                                                PharmRecipeTotals* out);
+
+// Writes the distinct separations in use, ascending, to |out| (at most
+// |capacity|). Returns how many there are.
+PHARM_FFI_EXPORT int32_t pharm_recipe_store_separations(
+    const PharmRecipeStore* store, int32_t* out, int32_t capacity);
+
+// --- RPC rows ---------------------------------------------------------------
+
+// Opaque handle to a RecordTable (native/rpc_records.h).
+typedef struct PharmRecordTable PharmRecordTable;
+
+// Table for the rows of one RPC: 0 = select_rxhead_bydate and
+// select_rxhead_by_name (RxHeadColumn), 1 = get_miss_mached_drug
+// (MissMatchedDrugColumn). Null for an unknown schema.
+PHARM_FFI_EXPORT PharmRecordTable* pharm_record_table_create(int32_t schema);
+PHARM_FFI_EXPORT void pharm_record_table_destroy(PharmRecordTable* table);
+
+// Replaces the rows with those of a response body (UTF-8 JSON). Returns the
+// row count, or -1 and an empty table if it is not valid JSON.
+PHARM_FFI_EXPORT int32_t pharm_record_table_load_json(PharmRecordTable* table,
+                                                      const char* json,
+                                                      int32_t length);
+
+// First element of |column|, valid until the next load: int64_t, double,
+// uint8_t 0/1 or a uint32_t string id by the column's type. Null for an
+// unknown column or an empty table.
+PHARM_FFI_EXPORT void* pharm_record_table_column(PharmRecordTable* table,
+                                                 int32_t column);
+
+// Bytes of string |id|, valid until the next load. |length| receives their
+// count.
+PHARM_FFI_EXPORT const char* pharm_record_table_string(
+    const PharmRecordTable* table, uint32_t id, int32_t* length);
+
+// --- Pack unit cache --------------------------------------------------------
+
+// Opaque handle to a UnitCache (native/unit_cache.h).
+typedef struct PharmUnitCache PharmUnitCache;
+
+// Counters of a unit cache; see UnitCacheStats.
+typedef struct {
+  int64_t hits;
+  int64_t misses;
+  int64_t stale;
+  int64_t puts;
+  int64_t entries;
+  int64_t capacity;
+  int64_t generation;
+} PharmUnitCacheStats;
+
+// Maps the cache file at |path| (UTF-8), creating it if needed. Returns null
+// if the file cannot be opened.
+PHARM_FFI_EXPORT PharmUnitCache* pharm_unit_cache_open(const char* path,
+                                                       int32_t capacity,
+                                                       int64_t ttl_ms);
+PHARM_FFI_EXPORT void pharm_unit_cache_close(PharmUnitCache* cache);
+
+// Looks up |barcode|. Returns a UnitCacheResult (0 miss, 1 hit, 2 stale);
+// on hit and stale |*unit| receives the cached value.
+PHARM_FFI_EXPORT int32_t pharm_unit_cache_lookup(PharmUnitCache* cache,
+                                                 const char* barcode,
+                                                 int32_t length,
+                                                 int64_t now_ms,
+                                                 double* unit);
+
+// Stores a unit fetched at |now_ms|. Returns 1 if it was cached.
+PHARM_FFI_EXPORT int32_t pharm_unit_cache_put(PharmUnitCache* cache,
+                                              const char* barcode,
+                                              int32_t length, double unit,
+                                              int64_t now_ms);
+
+// Sets the generation; records from other generations turn stale.
+PHARM_FFI_EXPORT void pharm_unit_cache_set_generation(PharmUnitCache* cache,
+                                                      int32_t generation);
+
+PHARM_FFI_EXPORT void pharm_unit_cache_stats(const PharmUnitCache* cache,
+                                             PharmUnitCacheStats* out);
+
+// --- Day snapshot -----------------------------------------------------------
+
+// Opaque handle to a DaySnapshot (native/day_snapshot.h).
+typedef struct PharmDaySnapshot PharmDaySnapshot;
+
+// Counters of a day snapshot; see DaySnapshotStats.
+typedef struct {
+  int64_t hits;
+  int64_t misses;
+  int64_t puts;
+  int64_t changed;
+  int64_t compactions;
+  int64_t dropped;
+  int64_t entries;
+  int64_t live_bytes;
+  int64_t file_bytes;
+  int64_t generation;
+  int64_t synced_ms;
+} PharmDaySnapshotStats;
+
+// Maps the snapshot of |day| (yyyymmdd) at |path| (UTF-8), creating it if
+// needed. Returns null if the file cannot be opened.
+PHARM_FFI_EXPORT PharmDaySnapshot* pharm_day_snapshot_open(const char* path,
+                                                           int32_t day);
+PHARM_FFI_EXPORT void pharm_day_snapshot_close(PharmDaySnapshot* snapshot);
+
+// Copies the JSON stored under |kind| (SnapshotKind: 1 heads, 2 recipes)
+// and |key| into |buffer| if it fits in |capacity| bytes. Returns its
+// length, or -1 if there is none; call again with a larger buffer when the
+// length exceeds |capacity|.
+PHARM_FFI_EXPORT int64_t pharm_day_snapshot_get(PharmDaySnapshot* snapshot,
+                                                int32_t kind, int64_t key,
+                                                uint8_t* buffer,
+                                                int64_t capacity,
+                                                int64_t* fetched_ms);
+
+// Stores |length| bytes of JSON. Returns a SnapshotPut (0 failed,
+// 1 unchanged, 2 changed).
+PHARM_FFI_EXPORT int32_t pharm_day_snapshot_put(PharmDaySnapshot* snapshot,
+                                                int32_t kind, int64_t key,
+                                                const uint8_t* json,
+                                                int64_t length,
+                                                int64_t now_ms);
+
+PHARM_FFI_EXPORT void pharm_day_snapshot_mark_dirty(PharmDaySnapshot* snapshot,
+                                                    int64_t tfn);
+
+// Writes up to |capacity| tfns whose rows need fetching to |out|. Returns
+// how many there are in all.
+PHARM_FFI_EXPORT int32_t pharm_day_snapshot_recipes_to_fetch(
+    PharmDaySnapshot* snapshot, int64_t* out, int32_t capacity);
+
+// Ends a sync; returns the new generation.
+PHARM_FFI_EXPORT int32_t pharm_day_snapshot_commit(PharmDaySnapshot* snapshot,
+                                                   int64_t now_ms);
+
+PHARM_FFI_EXPORT void pharm_day_snapshot_stats(
+    const PharmDaySnapshot* snapshot, PharmDaySnapshotStats* out);
+
+// --- Checked-amount journal -------------------------------------------------
+
+// Opaque handle to a CheckJournal (native/check_journal.h).
+typedef struct PharmCheckJournal PharmCheckJournal;
+
+// One journaled update_checked_amount_and_packserial call.
+typedef struct {
+  int64_t seq;
+  int64_t rxrecipe_id;
+  int64_t created_ms;
+  int32_t delta;
+  // NUL-terminated
+  char pack_serial[256];
+} PharmCheckEntry;
+
+// Counters of a journal; see CheckJournalStats.
+typedef struct {
+  int64_t appended;
+  int64_t acked;
+  int64_t duplicates;
+  int64_t failures;
+  int64_t syncs;
+  int64_t replayed;
+  int64_t pending;
+  int64_t in_flight;
+  int64_t file_bytes;
+  int64_t backoff_ms;
+  int64_t rejected;
+  int64_t unknown;
+  int64_t unsettled;
+} PharmCheckJournalStats;
+
+// Opens the journal at |path| (UTF-8) and replays unacknowledged entries.
+// Returns null if the file cannot be opened.
+PHARM_FFI_EXPORT PharmCheckJournal* pharm_check_journal_open(const char* path);
+PHARM_FFI_EXPORT void pharm_check_journal_close(PharmCheckJournal* journal);
+
+// Appends an increment. Returns its sequence number, or 0 on failure.
+PHARM_FFI_EXPORT int64_t pharm_check_journal_append(
+    PharmCheckJournal* journal, int64_t rxrecipe_id, int32_t delta,
+    const char* pack_serial, int32_t serial_length, int64_t now_ms);
+
+// Moves up to |capacity| queued entries to in-flight and writes them to
+// |out|. Returns the number written (0 while backing off).
+PHARM_FFI_EXPORT int32_t pharm_check_journal_take_batch(
+    PharmCheckJournal* journal, PharmCheckEntry* out, int32_t capacity,
+    int64_t now_ms);
+
+// Entries that were being sent when the app last stopped; the server may
+// have applied them. Moved to in-flight like take_batch.
+PHARM_FFI_EXPORT int32_t pharm_check_journal_take_unsettled(
+    PharmCheckJournal* journal, PharmCheckEntry* out, int32_t capacity);
+
+// |affected| is the server's count, or -1 (rejected for good) or -2
+// (outcome unknown); see kCheckRejected in native/check_journal.h.
+PHARM_FFI_EXPORT void pharm_check_journal_ack(PharmCheckJournal* journal,
+                                              int64_t seq, int32_t affected);
+// The entry did not reach the server and is retried after a backoff.
+PHARM_FFI_EXPORT void pharm_check_journal_fail(PharmCheckJournal* journal,
+                                               int64_t seq, int64_t now_ms);
+PHARM_FFI_EXPORT void pharm_check_journal_sync_if_due(
+    PharmCheckJournal* journal, int64_t now_ms);
+PHARM_FFI_EXPORT void pharm_check_journal_stats(
+    const PharmCheckJournal* journal, PharmCheckJournalStats* out);
+
+// --- Pack-serial duplicate filter -------------------------------------------
+
+// Opaque handle to a SerialFilter (native/serial_filter.h).
+typedef struct PharmSerialFilter PharmSerialFilter;
+
+// Counters of a serial filter; see SerialFilterStats.
+typedef struct {
+  int64_t lookups;
+  int64_t bloom_negatives;
+  int64_t pending_hits;
+  int64_t confirmed_hits;
+  int64_t entries;
+  int64_t loaded;
+} PharmSerialFilterStats;
+
+// Opens the filter log at |path| (UTF-8; null or empty for memory only) and
+// loads the serials of today's retention window. Returns null if the file
+// cannot be opened.
+PHARM_FFI_EXPORT PharmSerialFilter* pharm_serial_filter_open(const char* path,
+                                                             int32_t today);
+PHARM_FFI_EXPORT void pharm_serial_filter_close(PharmSerialFilter* filter);
+
+// Returns a SerialState (0 unknown, 1 pending, 2 confirmed).
+PHARM_FFI_EXPORT int32_t pharm_serial_filter_lookup(PharmSerialFilter* filter,
+                                                    int32_t day, int64_t scope,
+                                                    const char* serial,
+                                                    int32_t length);
+PHARM_FFI_EXPORT void pharm_serial_filter_record(PharmSerialFilter* filter,
+                                                 int32_t day, int64_t scope,
+                                                 const char* serial,
+                                                 int32_t length,
+                                                 int32_t state);
+PHARM_FFI_EXPORT void pharm_serial_filter_stats(
+    const PharmSerialFilter* filter, PharmSerialFilterStats* out);
+
+// --- Scan tracing -----------------------------------------------------------
+
+// The process TraceRecorder of this library (native/trace_recorder.h).
+// Times are steady-clock nanoseconds, shared with the runner's recorder.
+PHARM_FFI_EXPORT void pharm_trace_set_enabled(int32_t enabled);
+PHARM_FFI_EXPORT int32_t pharm_trace_enabled(void);
+PHARM_FFI_EXPORT int64_t pharm_trace_now_ns(void);
+PHARM_FFI_EXPORT int64_t pharm_trace_next_scan_id(void);
+
+// Records a span of the calling thread; a no-op while disabled. |name| is
+// |length| bytes of UTF-8, truncated to 39.
+PHARM_FFI_EXPORT void pharm_trace_record(const char* name, int32_t length,
+                                         int64_t scan_id, int64_t begin_ns,
+                                         int64_t end_ns);
+PHARM_FFI_EXPORT void pharm_trace_set_thread_name(const char* name,
+                                                  int32_t length);
+PHARM_FFI_EXPORT void pharm_trace_clear(void);
+
+// Writes the Chrome trace JSON to |path| (UTF-8), merging in
+// |extra_events|: comma-separated trace event objects from another
+// recorder, such as the runner's. Returns 1 on success, 0 otherwise.
+PHARM_FFI_EXPORT int32_t pharm_trace_write(const char* path,
+                                           const char* extra_events,
+                                           int32_t extra_length);
+
+// --- Metrics ----------------------------------------------------------------
+
+// The process MetricsRegistry of this library (native/metrics_registry.h).
+// Strings are NUL-terminated UTF-8. |label_key| and |label_value| may be
+// null for a metric without labels; |help| may be null. The handles live
+// as long as the library; look them up once and keep them.
+typedef struct PharmMetricCounter PharmMetricCounter;
+typedef struct PharmMetricGauge PharmMetricGauge;
+typedef struct PharmMetricHistogram PharmMetricHistogram;
+
+PHARM_FFI_EXPORT PharmMetricCounter* pharm_metrics_counter(
+    const char* name, const char* label_key, const char* label_value,
+    const char* help);
+PHARM_FFI_EXPORT void pharm_metrics_counter_add(PharmMetricCounter* counter,
+                                                int64_t n);
+PHARM_FFI_EXPORT PharmMetricGauge* pharm_metrics_gauge(
+    const char* name, const char* label_key, const char* label_value,
+    const char* help);
+PHARM_FFI_EXPORT void pharm_metrics_gauge_set(PharmMetricGauge* gauge,
+                                              int64_t value);
+// Latencies in microseconds, exported as a summary in seconds
+PHARM_FFI_EXPORT PharmMetricHistogram* pharm_metrics_histogram(
+    const char* name, const char* label_key, const char* label_value,
+    const char* help);
+PHARM_FFI_EXPORT void pharm_metrics_histogram_record(
+    PharmMetricHistogram* histogram, int64_t value_us);
+
+// Writes the Prometheus text to |path| now. Returns 1 on success, 0
+// otherwise.
+PHARM_FFI_EXPORT int32_t pharm_metrics_write(const char* path);
+
+// Writes the Prometheus text to |path| every |interval_ms| on a background
+// thread, replacing an earlier writer. A null or empty |path| stops it.
+PHARM_FFI_EXPORT void pharm_metrics_start_writer(const char* path,
+                                                 int32_t interval_ms);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // NATIVE_FFI_PHARM_NATIVE_FFI_H_
@@ -0,0 +1,62 @@
+#include <cstring>
+#include <string_view>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/recipe_index.h"
+
+struct PharmRecipeIndex {
+  RecipeIndex index;
+};
+
+PharmRecipeIndex* pharm_recipe_index_create(void) {
+  return new PharmRecipeIndex();
+}
+
+void pharm_recipe_index_destroy(PharmRecipeIndex* index) { delete index; }
+
+int32_t pharm_recipe_index_build(PharmRecipeIndex* index, const char* codes,
+                                 int32_t codes_length, const char* types,
+                                 const uint8_t* complete, int32_t count) {
+  if (index == nullptr) {
+    return 0;
+  }
+  index->index.Clear();
+  if (codes == nullptr || codes_length < 0 || types == nullptr ||
+      complete == nullptr || count <= 0) {
+    return 0;
+  }
+  index->index.Reserve(static_cast<size_t>(count));
+
+  const char* cursor = codes;
+  const char* end = codes + codes_length;
+  for (int32_t row = 0; row < count; ++row) {
+    const char* newline = static_cast<const char*>(
+        memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+    const char* code_end = newline != nullptr ? newline : end;
+    index->index.AddRow(
+        std::string_view(cursor, static_cast<size_t>(code_end - cursor)),
+        types[row], complete[row] != 0);
+    cursor = newline != nullptr ? newline + 1 : end;
+  }
+  return count;
+}
+
+void pharm_recipe_index_set_complete(PharmRecipeIndex* index, int32_t row,
+                                     int32_t complete) {
+  if (index != nullptr && row >= 0) {
+    index->index.SetComplete(static_cast<uint32_t>(row), complete != 0);
+  }
+}
+
+int32_t pharm_recipe_index_lookup(const PharmRecipeIndex* index,
+                                  const char* barcode, int32_t length,
+                                  int32_t* rows, int32_t capacity) {
+  if (index == nullptr || barcode == nullptr || length <= 0) {
+    return 0;
+  }
+  static_assert(sizeof(int32_t) == sizeof(uint32_t), "row ids are 32-bit");
+  return static_cast<int32_t>(index->index.Lookup(
+      std::string_view(barcode, static_cast<size_t>(length)),
+      reinterpret_cast<uint32_t*>(rows),
+      rows != nullptr && capacity > 0 ? static_cast<size_t>(capacity) : 0));
+}
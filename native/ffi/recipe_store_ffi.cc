@@ -0,0 +1,105 @@
+#include <string_view>
+#include <vector>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/recipe_store.h"
+
+struct PharmRecipeStore {
+  RecipeStore store;
+};
+
+namespace {
+
+bool ValidColumn(int32_t column) {
+  return column >= 0 && column < static_cast<int32_t>(RecipeColumn::kCount);
+}
+
+}  // namespace
+
+PharmRecipeStore* pharm_recipe_store_create(void) {
+  return new PharmRecipeStore();
+}
+
+void pharm_recipe_store_destroy(PharmRecipeStore* store) { delete store; }
+
+int32_t pharm_recipe_store_reset(PharmRecipeStore* store, int32_t rows) {
+  if (store == nullptr) {
+    return 0;
+  }
+  store->store.Reset(rows > 0 ? static_cast<size_t>(rows) : 0);
+  return static_cast<int32_t>(store->store.size());
+}
+
+void* pharm_recipe_store_column(PharmRecipeStore* store, int32_t column) {
+  if (store == nullptr || !ValidColumn(column)) {
+    return nullptr;
+  }
+  return store->store.ColumnData(static_cast<RecipeColumn>(column));
+}
+
+int32_t pharm_recipe_store_column_for_key(const char* key, int32_t length,
+                                          int32_t* rank) {
+  if (key == nullptr || length <= 0) {
+    return -1;
+  }
+  const RecipeField field = RecipeStore::FieldForKey(
+      std::string_view(key, static_cast<size_t>(length)));
+  if (field.column == RecipeColumn::kCount) {
+    return -1;
+  }
+  if (rank != nullptr) {
+    *rank = field.rank;
+  }
+  return static_cast<int32_t>(field.column);
+}
+
+uint32_t pharm_recipe_store_intern(PharmRecipeStore* store, const char* value,
+                                   int32_t length) {
+  if (store == nullptr || value == nullptr || length <= 0) {
+    return StringPool::kEmpty;
+  }
+  return store->store.strings().Intern(
+      std::string_view(value, static_cast<size_t>(length)));
+}
+
+const char* pharm_recipe_store_string(const PharmRecipeStore* store,
+                                      uint32_t id, int32_t* length) {
+  std::string_view value;
+  if (store != nullptr) {
+    value = store->store.strings().Get(id);
+  }
+  if (length != nullptr) {
+    *length = static_cast<int32_t>(value.size());
+  }
+  return value.empty() ? "" : value.data();
+}
+
+void pharm_recipe_store_totals(const PharmRecipeStore* store,
+                               int32_t separation, PharmRecipeTotals* out) {
+  if (out == nullptr) {
+    return;
+  }
+  RecipeTotals totals;
+  if (store != nullptr) {
+    totals = store->store.Totals(separation);
+  }
+  out->morning = totals.morning;
+  out->afternoon = totals.afternoon;
+  out->evening = totals.evening;
+  out->night = totals.night;
+}
+
+int32_t pharm_recipe_store_separations(const PharmRecipeStore* store,
+                                       int32_t* out, int32_t capacity) {
+  if (store == nullptr) {
+    return 0;
+  }
+  const std::vector<int32_t> separations = store->store.Separations();
+  for (size_t i = 0;
+       out != nullptr && i < separations.size() &&
+       i < static_cast<size_t>(capacity > 0 ? capacity : 0);
+       ++i) {
+    out[i] = separations[i];
+  }
+  return static_cast<int32_t>(separations.size());
+}
@@ -0,0 +1,56 @@
+#include <string_view>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/rpc_records.h"
+
+struct PharmRecordTable {
+  explicit PharmRecordTable(const RecordSchema& schema) : table(schema) {}
+
+  RecordTable table;
+};
+
+PharmRecordTable* pharm_record_table_create(int32_t schema) {
+  switch (schema) {
+    case 0:
+      return new PharmRecordTable(RxHeadSchema());
+    case 1:
+      return new PharmRecordTable(MissMatchedDrugSchema());
+    default:
+      return nullptr;
+  }
+}
+
+void pharm_record_table_destroy(PharmRecordTable* table) { delete table; }
+
+int32_t pharm_record_table_load_json(PharmRecordTable* table, const char* json,
+                                     int32_t length) {
+  if (table == nullptr || json == nullptr || length < 0) {
+    return -1;
+  }
+  table->table.Clear();
+  if (!DecodeJsonRows(std::string_view(json, static_cast<size_t>(length)),
+                      &table->table)) {
+    table->table.Clear();
+    return -1;
+  }
+  return static_cast<int32_t>(table->table.size());
+}
+
+void* pharm_record_table_column(PharmRecordTable* table, int32_t column) {
+  if (table == nullptr || column < 0) {
+    return nullptr;
+  }
+  return table->table.ColumnData(static_cast<size_t>(column));
+}
+
+const char* pharm_record_table_string(const PharmRecordTable* table,
+                                      uint32_t id, int32_t* length) {
+  std::string_view value;
+  if (table != nullptr) {
+    value = table->table.strings().Get(id);
+  }
+  if (length != nullptr) {
+    *length = static_cast<int32_t>(value.size());
+  }
+  return value.empty() ? "" : value.data();
+}
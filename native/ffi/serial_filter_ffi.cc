@@ -0,0 +1,60 @@
+#include <string_view>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/serial_filter.h"
+
+struct PharmSerialFilter {
+  SerialFilter filter;
+};
+
+PharmSerialFilter* pharm_serial_filter_open(const char* path,
+                                            int32_t today) {
+  PharmSerialFilter* filter = new PharmSerialFilter();
+  if (!filter->filter.Load(path != nullptr ? path : "", today)) {
+    delete filter;
+    return nullptr;
+  }
+  return filter;
+}
+
+void pharm_serial_filter_close(PharmSerialFilter* filter) { delete filter; }
+
+int32_t pharm_serial_filter_lookup(PharmSerialFilter* filter, int32_t day,
+                                   int64_t scope, const char* serial,
+                                   int32_t length) {
+  if (filter == nullptr || serial == nullptr || length <= 0) {
+    return static_cast<int32_t>(SerialState::kUnknown);
+  }
+  return static_cast<int32_t>(filter->filter.Lookup(
+      day, scope, std::string_view(serial, static_cast<size_t>(length))));
+}
+
+void pharm_serial_filter_record(PharmSerialFilter* filter, int32_t day,
+                                int64_t scope, const char* serial,
+                                int32_t length, int32_t state) {
+  if (filter == nullptr || serial == nullptr || length <= 0 ||
+      state < static_cast<int32_t>(SerialState::kPending) ||
+      state > static_cast<int32_t>(SerialState::kConfirmed)) {
+    return;
+  }
+  filter->filter.Record(day, scope,
+                        std::string_view(serial, static_cast<size_t>(length)),
+                        static_cast<SerialState>(state));
+}
+
+void pharm_serial_filter_stats(const PharmSerialFilter* filter,
+                               PharmSerialFilterStats* out) {
+  if (out == nullptr) {
+    return;
+  }
+  SerialFilterStats stats;
+  if (filter != nullptr) {
+    stats = filter->filter.GetStats();
+  }
+  out->lookups = static_cast<int64_t>(stats.lookups);
+  out->bloom_negatives = static_cast<int64_t>(stats.bloom_negatives);
+  out->pending_hits = static_cast<int64_t>(stats.pending_hits);
+  out->confirmed_hits = static_cast<int64_t>(stats.confirmed_hits);
+  out->entries = static_cast<int64_t>(stats.entries);
+  out->loaded = static_cast<int64_t>(stats.loaded);
+}
@@ -0,0 +1,59 @@
+#include <string>
+#include <string_view>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/file_io.h"
+#include "native/trace_recorder.h"
+
+void pharm_trace_set_enabled(int32_t enabled) {
+  ProcessTraceRecorder().SetEnabled(enabled != 0);
+}
+
+int32_t pharm_trace_enabled(void) {
+  return ProcessTraceRecorder().enabled() ? 1 : 0;
+}
+
+int64_t pharm_trace_now_ns(void) { return TraceRecorder::NowNs(); }
+
+int64_t pharm_trace_next_scan_id(void) {
+  return static_cast<int64_t>(TraceRecorder::NextScanId());
+}
+
+void pharm_trace_record(const char* name, int32_t length, int64_t scan_id,
+                        int64_t begin_ns, int64_t end_ns) {
+  if (name == nullptr || length < 0) {
+    return;
+  }
+  ProcessTraceRecorder().Record(
+      std::string_view(name, static_cast<size_t>(length)),
+      static_cast<uint64_t>(scan_id), begin_ns, end_ns);
+}
+
+void pharm_trace_set_thread_name(const char* name, int32_t length) {
+  if (name == nullptr || length < 0) {
+    return;
+  }
+  ProcessTraceRecorder().SetThreadName(
+      std::string_view(name, static_cast<size_t>(length)));
+}
+
+void pharm_trace_clear(void) { ProcessTraceRecorder().Clear(); }
+
+int32_t pharm_trace_write(const char* path, const char* extra_events,
+                          int32_t extra_length) {
+  if (path == nullptr || *path == '\0') {
+    return 0;
+  }
+  const std::string json = ProcessTraceRecorder().ToChromeJson(
+      extra_events != nullptr && extra_length > 0
+          ? std::string_view(extra_events, static_cast<size_t>(extra_length))
+          : std::string_view());
+  const int fd = OpenDataFile(path);
+  if (fd < 0) {
+    return 0;
+  }
+  const bool ok = TruncateDataFile(fd, 0) &&
+                  WriteAll(fd, json.data(), json.size());
+  CloseDataFile(fd);
+  return ok ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+#include <string>
+#include <string_view>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "native/unit_cache.h"
+
+struct PharmUnitCache {
+  UnitCache cache;
+};
+
+PharmUnitCache* pharm_unit_cache_open(const char* path, int32_t capacity,
+                                      int64_t ttl_ms) {
+  if (path == nullptr) {
+    return nullptr;
+  }
+  PharmUnitCache* cache = new PharmUnitCache();
+  if (!cache->cache.Open(path,
+                         capacity > 0 ? static_cast<size_t>(capacity) : 0,
+                         ttl_ms)) {
+    delete cache;
+    return nullptr;
+  }
+  return cache;
+}
+
+void pharm_unit_cache_close(PharmUnitCache* cache) { delete cache; }
+
+int32_t pharm_unit_cache_lookup(PharmUnitCache* cache, const char* barcode,
+                                int32_t length, int64_t now_ms,
+                                double* unit) {
+  if (cache == nullptr || barcode == nullptr || length <= 0 ||
+      unit == nullptr) {
+    return static_cast<int32_t>(UnitCacheResult::kMiss);
+  }
+  return static_cast<int32_t>(cache->cache.Lookup(
+      std::string_view(barcode, static_cast<size_t>(length)), now_ms, unit));
+}
+
+int32_t pharm_unit_cache_put(PharmUnitCache* cache, const char* barcode,
+                             int32_t length, double unit, int64_t now_ms) {
+  if (cache == nullptr || barcode == nullptr || length <= 0) {
+    return 0;
+  }
+  return cache->cache.Put(
+             std::string_view(barcode, static_cast<size_t>(length)), unit,
+             now_ms)
+             ? 1
+             : 0;
+}
+
+void pharm_unit_cache_set_generation(PharmUnitCache* cache,
+                                     int32_t generation) {
+  if (cache != nullptr) {
+    cache->cache.SetGeneration(static_cast<uint32_t>(generation));
+  }
+}
+
+void pharm_unit_cache_stats(const PharmUnitCache* cache,
+                            PharmUnitCacheStats* out) {
+  if (out == nullptr) {
+    return;
+  }
+  UnitCacheStats stats;
+  if (cache != nullptr) {
+    stats = cache->cache.GetStats();
+  }
+  out->hits = static_cast<int64_t>(stats.hits);
+  out->misses = static_cast<int64_t>(stats.misses);
+  out->stale = static_cast<int64_t>(stats.stale);
+  out->puts = static_cast<int64_t>(stats.puts);
+  out->entries = static_cast<int64_t>(stats.entries);
+  out->capacity = static_cast<int64_t>(stats.capacity);
+  out->generation = static_cast<int64_t>(stats.generation);
+}
@@ -0,0 +1,72 @@
+#include "native/field_text.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include "native/json_reader.h"
+
+std::string_view TrimField(std::string_view value) {
+  const size_t start = value.find_first_not_of(" \t\r\n");
+  if (start == std::string_view::npos) {
+    return std::string_view();
+  }
+  const size_t end = value.find_last_not_of(" \t\r\n");
+  return value.substr(start, end - start + 1);
+}
+
+bool ParseFieldNumber(std::string_view text, double* value) {
+  text = TrimField(text);
+  // Dart also takes a leading '+' and a bare fraction (".5", "5.")
+  if (!text.empty() && text[0] == '+') {
+    text.remove_prefix(1);
+  }
+  std::string normalized;
+  const bool bare_dot =
+      !text.empty() &&
+      (text[0] == '.' || text.back() == '.' ||
+       (text[0] == '-' && text.size() > 1 && text[1] == '.'));
+  if (bare_dot) {
+    normalized.assign(text);
+    if (normalized.back() == '.') {
+      normalized.push_back('0');
+    }
+    const size_t dot = normalized.find('.');
+    if (dot == 0 || normalized[dot - 1] == '-') {
+      normalized.insert(dot, 1, '0');
+    }
+    text = normalized;
+  }
+  return ParseJsonNumber(text, value) && std::isfinite(*value);
+}
+
+bool ParseFieldBool(std::string_view text, bool* value) {
+  text = TrimField(text);
+  if (text == "1" || text == "0") {
+    *value = text == "1";
+    return true;
+  }
+  if (text.size() != 4 && text.size() != 5) {
+    return false;
+  }
+  char lower[5];
+  for (size_t i = 0; i < text.size(); ++i) {
+    const char c = text[i];
+    lower[i] = static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+  }
+  const std::string_view word(lower, text.size());
+  if (word == "true" || word == "false") {
+    *value = word == "true";
+    return true;
+  }
+  return false;
+}
+
+std::string FormatFieldNumber(double value) {
+  char text[32];
+  if (std::trunc(value) == value && std::fabs(value) < 1e15) {
+    std::snprintf(text, sizeof(text), "%lld", static_cast<long long>(value));
+  } else {
+    std::snprintf(text, sizeof(text), "%.17g", value);
+  }
+  return text;
+}
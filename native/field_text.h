@@ -0,0 +1,25 @@
+#ifndef NATIVE_FIELD_TEXT_H_
+#define NATIVE_FIELD_TEXT_H_
+
+#include <string>
+#include <string_view>
+
+// Conversions of RPC field values that arrive in the "wrong" JSON type,
+// following the Dart helpers (asNum, asBool, toString) the app applied to
+// the decoded maps.
+
+// |value| without leading and trailing whitespace
+std::string_view TrimField(std::string_view value);
+
+// num.tryParse of the trimmed text. Returns false if it does not parse.
+bool ParseFieldNumber(std::string_view text, double* value);
+
+// asBool of a string: true/1 and false/0, case-insensitively. Returns false
+// for anything else.
+bool ParseFieldBool(std::string_view text, bool* value);
+
+// toString of a JSON number: integers without a fraction, so a barcode sent
+// as a number reads as its digits.
+std::string FormatFieldNumber(double value);
+
+#endif  // NATIVE_FIELD_TEXT_H_
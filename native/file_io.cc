@@ -0,0 +1,107 @@
+#include "native/file_io.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+int OpenDataFile(const std::string& path) {
+  int fd = -1;
+  _sopen_s(&fd, path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY | _O_NOINHERIT,
+           _SH_DENYWR, _S_IREAD | _S_IWRITE);
+  return fd;
+}
+
+void CloseDataFile(int fd) { _close(fd); }
+
+bool SyncDataFile(int fd) { return _commit(fd) == 0; }
+
+bool TruncateDataFile(int fd, uint64_t size) {
+  return _chsize_s(fd, static_cast<__int64>(size)) == 0;
+}
+
+bool SeekDataFile(int fd, uint64_t offset) {
+  return _lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) >= 0;
+}
+
+bool ReplaceDataFile(const std::string& from, const std::string& to) {
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+namespace {
+long long ReadSome(int fd, void* data, size_t length) {
+  return _read(fd, data, static_cast<unsigned int>(length));
+}
+long long WriteSome(int fd, const void* data, size_t length) {
+  return _write(fd, data, static_cast<unsigned int>(length));
+}
+}  // namespace
+
+#else  // POSIX
+
+int OpenDataFile(const std::string& path) {
+  return open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+}
+
+void CloseDataFile(int fd) { close(fd); }
+
+bool SyncDataFile(int fd) { return fdatasync(fd) == 0; }
+
+bool TruncateDataFile(int fd, uint64_t size) {
+  return ftruncate(fd, static_cast<off_t>(size)) == 0;
+}
+
+bool SeekDataFile(int fd, uint64_t offset) {
+  return lseek(fd, static_cast<off_t>(offset), SEEK_SET) >= 0;
+}
+
+bool ReplaceDataFile(const std::string& from, const std::string& to) {
+  return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+namespace {
+long long ReadSome(int fd, void* data, size_t length) {
+  return read(fd, data, length);
+}
+long long WriteSome(int fd, const void* data, size_t length) {
+  return write(fd, data, length);
+}
+}  // namespace
+
+#endif
+
+bool ReadToEnd(int fd, std::string* out) {
+  char buffer[16384];
+  while (true) {
+    const long long n = ReadSome(fd, buffer, sizeof(buffer));
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      return true;
+    }
+    out->append(buffer, static_cast<size_t>(n));
+  }
+}
+
+bool WriteAll(int fd, const void* data, size_t length) {
+  const char* bytes = static_cast<const char*>(data);
+  while (length > 0) {
+    const long long written = WriteSome(fd, bytes, length);
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    length -= static_cast<size_t>(written);
+  }
+  return true;
+}
@@ -0,0 +1,50 @@
+#ifndef NATIVE_FILE_IO_H_
+#define NATIVE_FILE_IO_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Thin portable wrappers over POSIX/CRT file descriptors for the on-disk
+// logs. All return false (or -1) on failure and never throw.
+
+// Opens |path| read/write, creating it if needed. Returns -1 on failure.
+int OpenDataFile(const std::string& path);
+void CloseDataFile(int fd);
+
+// Flushes written data to the device (fdatasync / _commit).
+bool SyncDataFile(int fd);
+bool TruncateDataFile(int fd, uint64_t size);
+bool SeekDataFile(int fd, uint64_t offset);
+
+// Moves |from| over |to|, replacing it in one step, so readers see either
+// the old file or the new one.
+bool ReplaceDataFile(const std::string& from, const std::string& to);
+
+// Reads from the current position to the end of the file into |out|.
+bool ReadToEnd(int fd, std::string* out);
+
+// Writes all |length| bytes at the current position.
+bool WriteAll(int fd, const void* data, size_t length);
+
+// Appends the bytes of a trivially copyable |value| to |out| (host order;
+// the files never leave the machine that wrote them).
+template <typename T>
+void AppendPod(std::string* out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Reads a value written by AppendPod from |*cursor| and advances it. Returns
+// false if fewer than sizeof(T) bytes are left before |end|.
+template <typename T>
+bool ReadPod(const char** cursor, const char* end, T* value) {
+  if (static_cast<size_t>(end - *cursor) < sizeof(T)) {
+    return false;
+  }
+  std::memcpy(value, *cursor, sizeof(T));
+  *cursor += sizeof(T);
+  return true;
+}
+
+#endif  // NATIVE_FILE_IO_H_
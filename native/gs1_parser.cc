@@ -0,0 +1,359 @@
+#include "native/gs1_parser.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+constexpr char kGroupSeparator = '\x1d';
+
+// One row of the AI table: AIs |first|..|last| (same digit count) carry
+// |min_length|..|max_length| characters of data.
+struct AiSpec {
+  uint16_t first;
+  uint16_t last;
+  uint8_t ai_length;
+  uint8_t min_length;
+  uint8_t max_length;
+  bool numeric;
+  bool check_digit;
+};
+
+// Subset of the GS1 General Specifications AI table relevant to
+// pharmaceutical packs and logistics labels, sorted by AI prefix.
+constexpr AiSpec kAiTable[] = {
+    {0, 0, 2, 18, 18, true, true},       // SSCC
+    {1, 1, 2, 14, 14, true, true},       // GTIN
+    {2, 2, 2, 14, 14, true, true},       // CONTENT
+    {10, 10, 2, 1, 20, false, false},    // BATCH/LOT
+    {11, 13, 2, 6, 6, true, false},      // PROD/DUE/PACK DATE
+    {15, 17, 2, 6, 6, true, false},      // BEST BEFORE/SELL BY/USE BY
+    {20, 20, 2, 2, 2, true, false},      // VARIANT
+    {21, 21, 2, 1, 20, false, false},    // SERIAL
+    {22, 22, 2, 1, 20, false, false},    // CPV
+    {235, 235, 3, 1, 28, false, false},  // TPX
+    {240, 241, 3, 1, 30, false, false},  // ADDITIONAL ID / CUST. PART NO.
+    {242, 242, 3, 1, 6, true, false},    // MTO VARIANT
+    {243, 243, 3, 1, 20, false, false},  // PCN
+    {250, 251, 3, 1, 30, false, false},  // SECONDARY SERIAL / REF. TO SOURCE
+    {253, 253, 3, 13, 30, false, false}, // GDTI
+    {254, 254, 3, 1, 20, false, false},  // GLN EXTENSION
+    {255, 255, 3, 13, 25, true, false},  // GCN
+    {30, 30, 2, 1, 8, true, false},      // VAR. COUNT
+    // Trade and logistic measures with a decimal indicator
+    {3100, 3199, 4, 6, 6, true, false},
+    {3200, 3299, 4, 6, 6, true, false},
+    {3300, 3399, 4, 6, 6, true, false},
+    {3400, 3499, 4, 6, 6, true, false},
+    {3500, 3599, 4, 6, 6, true, false},
+    {3600, 3699, 4, 6, 6, true, false},
+    {37, 37, 2, 1, 8, true, false},      // COUNT
+    {3900, 3909, 4, 1, 15, true, false}, // AMOUNT
+    {3910, 3919, 4, 4, 18, true, false}, // AMOUNT + currency
+    {3920, 3929, 4, 1, 15, true, false}, // PRICE
+    {3930, 3939, 4, 4, 18, true, false}, // PRICE + currency
+    {400, 400, 3, 1, 30, false, false},  // ORDER NUMBER
+    {401, 401, 3, 1, 30, false, false},  // GINC
+    {402, 402, 3, 17, 17, true, true},   // GSIN
+    {403, 403, 3, 1, 30, false, false},  // ROUTE
+    {410, 417, 3, 13, 13, true, true},   // GLNs
+    {420, 420, 3, 1, 20, false, false},  // SHIP TO POST
+    {421, 421, 3, 4, 12, false, false},  // SHIP TO POST + ISO
+    {422, 422, 3, 3, 3, true, false},    // ORIGIN
+    {423, 423, 3, 4, 15, true, false},   // COUNTRY - INITIAL PROCESS
+    {424, 424, 3, 3, 3, true, false},    // COUNTRY - PROCESS
+    {425, 425, 3, 4, 15, true, false},   // COUNTRY - DISASSEMBLY
+    {426, 426, 3, 3, 3, true, false},    // COUNTRY - FULL PROCESS
+    {7001, 7001, 4, 13, 13, true, false},  // NSN
+    {7002, 7002, 4, 1, 30, false, false},  // MEAT CUT
+    {7003, 7003, 4, 10, 10, true, false},  // EXPIRY TIME
+    {7004, 7004, 4, 1, 4, true, false},    // ACTIVE POTENCY
+    {7005, 7005, 4, 1, 12, false, false},  // CATCH AREA
+    {7006, 7006, 4, 6, 6, true, false},    // FIRST FREEZE DATE
+    {7007, 7007, 4, 6, 12, true, false},   // HARVEST DATE
+    {7008, 7008, 4, 1, 3, false, false},   // AQUATIC SPECIES
+    {7009, 7009, 4, 1, 10, false, false},  // FISHING GEAR TYPE
+    {7010, 7010, 4, 1, 2, false, false},   // PROD METHOD
+    {710, 716, 3, 1, 20, false, false},    // NHRN (national reimbursement)
+    {8001, 8001, 4, 14, 14, true, false},  // DIMENSIONS
+    {8002, 8002, 4, 1, 20, false, false},  // CMT NO.
+    {8003, 8003, 4, 14, 30, false, false}, // GRAI
+    {8004, 8004, 4, 1, 30, false, false},  // GIAI
+    {8005, 8005, 4, 6, 6, true, false},    // PRICE PER UNIT
+    {8006, 8006, 4, 18, 18, true, false},  // ITIP
+    {8007, 8007, 4, 1, 34, false, false},  // IBAN
+    {8008, 8008, 4, 8, 12, true, false},   // PROD TIME
+    {8010, 8010, 4, 1, 30, false, false},  // CPID
+    {8011, 8011, 4, 1, 12, true, false},   // CPID SERIAL
+    {8012, 8012, 4, 1, 20, false, false},  // VERSION
+    {8013, 8013, 4, 1, 25, false, false},  // GMN
+    {8017, 8018, 4, 18, 18, true, true},   // GSRN
+    {8019, 8019, 4, 1, 10, true, false},   // SRIN
+    {8020, 8020, 4, 1, 25, false, false},  // REF NO.
+    {90, 90, 2, 1, 30, false, false},      // INTERNAL
+    {91, 99, 2, 1, 90, false, false},      // INTERNAL
+};
+
+constexpr size_t kAiTableSize = sizeof(kAiTable) / sizeof(kAiTable[0]);
+
+constexpr uint16_t PrefixOf(uint16_t ai, uint8_t ai_length) {
+  for (int i = ai_length; i > 2; --i) {
+    ai /= 10;
+  }
+  return ai;
+}
+
+// For every two-digit AI prefix, the [begin, end) range of table rows that
+// start with it. Built at compile time from kAiTable.
+struct PrefixIndex {
+  std::array<uint8_t, 100> begin{};
+  std::array<uint8_t, 100> end{};
+};
+
+constexpr PrefixIndex BuildPrefixIndex() {
+  PrefixIndex index;
+  for (size_t i = 0; i < kAiTableSize; ++i) {
+    const AiSpec& spec = kAiTable[i];
+    for (uint16_t prefix = PrefixOf(spec.first, spec.ai_length);
+         prefix <= PrefixOf(spec.last, spec.ai_length); ++prefix) {
+      if (index.begin[prefix] == index.end[prefix]) {
+        index.begin[prefix] = static_cast<uint8_t>(i);
+      }
+      index.end[prefix] = static_cast<uint8_t>(i + 1);
+    }
+  }
+  return index;
+}
+
+constexpr PrefixIndex kPrefixIndex = BuildPrefixIndex();
+
+// Rows sharing a prefix must be contiguous for the index to work.
+constexpr bool PrefixesContiguous() {
+  for (size_t p = 0; p < 100; ++p) {
+    for (size_t i = kPrefixIndex.begin[p]; i < kPrefixIndex.end[p]; ++i) {
+      const AiSpec& spec = kAiTable[i];
+      if (p < PrefixOf(spec.first, spec.ai_length) ||
+          p > PrefixOf(spec.last, spec.ai_length)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+static_assert(PrefixesContiguous(), "kAiTable must be grouped by AI prefix");
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Looks up the AI at the start of |input|.
+const AiSpec* MatchAi(std::string_view input, uint16_t* ai) {
+  if (input.size() < 2 || !IsDigit(input[0]) || !IsDigit(input[1])) {
+    return nullptr;
+  }
+  const int prefix = (input[0] - '0') * 10 + (input[1] - '0');
+  for (size_t i = kPrefixIndex.begin[prefix]; i < kPrefixIndex.end[prefix];
+       ++i) {
+    const AiSpec& spec = kAiTable[i];
+    if (input.size() < spec.ai_length) {
+      continue;
+    }
+    uint16_t value = 0;
+    bool digits = true;
+    for (size_t d = 0; d < spec.ai_length; ++d) {
+      digits = digits && IsDigit(input[d]);
+      value = static_cast<uint16_t>(value * 10 + (input[d] - '0'));
+    }
+    if (digits && value >= spec.first && value <= spec.last) {
+      *ai = value;
+      return &spec;
+    }
+  }
+  return nullptr;
+}
+
+bool AllDigits(std::string_view value) {
+  for (char c : value) {
+    if (!IsDigit(c)) return false;
+  }
+  return true;
+}
+
+// Validates |value| against |spec| and appends it to |out|.
+Gs1Status AddElement(const AiSpec& spec, uint16_t ai, size_t offset,
+                     std::string_view value, Gs1Parse* out) {
+  if (out->count == kGs1MaxElements) {
+    return Gs1Status::kTooManyElements;
+  }
+  if (value.size() < spec.min_length || value.size() > spec.max_length) {
+    return Gs1Status::kBadLength;
+  }
+  if (spec.numeric && !AllDigits(value)) {
+    return Gs1Status::kNotNumeric;
+  }
+  if (spec.check_digit && !Gs1CheckDigitValid(value)) {
+    return Gs1Status::kBadCheckDigit;
+  }
+  out->elements[out->count++] = {ai, static_cast<uint16_t>(offset),
+                                 static_cast<uint16_t>(value.size())};
+  return Gs1Status::kOk;
+}
+
+// "(01)08806469007312(21)ABC" as printed under the symbol.
+Gs1Status ParseBracketed(std::string_view input, size_t base, Gs1Parse* out) {
+  size_t pos = 0;
+  while (pos < input.size()) {
+    if (input[pos] != '(') {
+      return Gs1Status::kUnknownAi;
+    }
+    const size_t close = input.find(')', pos + 1);
+    if (close == std::string_view::npos) {
+      return Gs1Status::kUnknownAi;
+    }
+    uint16_t ai = 0;
+    std::string_view ai_text = input.substr(pos + 1, close - pos - 1);
+    const AiSpec* spec = MatchAi(ai_text, &ai);
+    if (spec == nullptr || ai_text.size() != spec->ai_length) {
+      return Gs1Status::kUnknownAi;
+    }
+    size_t next = input.find('(', close + 1);
+    if (next == std::string_view::npos) next = input.size();
+    Gs1Status status = AddElement(*spec, ai, base + close + 1,
+                                  input.substr(close + 1, next - close - 1),
+                                  out);
+    if (status != Gs1Status::kOk) {
+      return status;
+    }
+    pos = next;
+  }
+  return Gs1Status::kOk;
+}
+
+Gs1Status ParseElementString(std::string_view input, size_t base,
+                             Gs1Parse* out);
+
+// Where a variable-length field starting at |start| ends when its GS was
+// lost (keyboard wedges drop it) and it ran past |spec|'s maximum: the last
+// position that starts a fixed-length AI from which the rest parses, or
+// |end| if there is none.
+size_t SplitRunOnField(std::string_view input, const AiSpec& spec,
+                       size_t start, size_t end) {
+  const size_t first = start + spec.min_length;
+  for (size_t split = std::min(end, start + spec.max_length); split >= first;
+       --split) {
+    uint16_t ai = 0;
+    const AiSpec* next = MatchAi(input.substr(split), &ai);
+    if (next == nullptr || next->min_length != next->max_length) {
+      continue;
+    }
+    Gs1Parse rest;
+    if (ParseElementString(input.substr(split), 0, &rest) == Gs1Status::kOk) {
+      return split;
+    }
+  }
+  return end;
+}
+
+// Concatenated element string with GS after variable-length fields.
+Gs1Status ParseElementString(std::string_view input, size_t base,
+                             Gs1Parse* out) {
+  size_t pos = 0;
+  while (pos < input.size()) {
+    if (input[pos] == kGroupSeparator) {
+      ++pos;
+      continue;
+    }
+    uint16_t ai = 0;
+    const AiSpec* spec = MatchAi(input.substr(pos), &ai);
+    if (spec == nullptr) {
+      return Gs1Status::kUnknownAi;
+    }
+    const size_t start = pos + spec->ai_length;
+    size_t end;
+    if (spec->min_length == spec->max_length) {
+      end = start + spec->max_length;
+      if (end > input.size()) {
+        return Gs1Status::kBadLength;
+      }
+    } else {
+      end = input.find(kGroupSeparator, start);
+      if (end == std::string_view::npos) end = input.size();
+      if (end - start > spec->max_length) {
+        end = SplitRunOnField(input, *spec, start, end);
+      }
+    }
+    Gs1Status status = AddElement(*spec, ai, base + start,
+                                  input.substr(start, end - start), out);
+    if (status != Gs1Status::kOk) {
+      return status;
+    }
+    pos = end;
+  }
+  return Gs1Status::kOk;
+}
+
+}  // namespace
+
+const Gs1Element* Gs1Parse::Find(uint16_t ai) const {
+  for (uint8_t i = 0; i < count; ++i) {
+    if (elements[i].ai == ai) {
+      return &elements[i];
+    }
+  }
+  return nullptr;
+}
+
+bool Gs1CheckDigitValid(std::string_view digits) {
+  if (digits.size() < 2) {
+    return false;
+  }
+  // Weights alternate 3, 1, 3, ... from the digit left of the check digit.
+  int sum = 0;
+  int weight = 3;
+  for (size_t i = digits.size() - 1; i-- > 0;) {
+    if (!IsDigit(digits[i])) return false;
+    sum += (digits[i] - '0') * weight;
+    weight = 4 - weight;
+  }
+  const char check = digits.back();
+  return IsDigit(check) && (10 - sum % 10) % 10 == check - '0';
+}
+
+Gs1Status ParseGs1(std::string_view input, Gs1Parse* out) {
+  out->count = 0;
+  out->plain = false;
+
+  // Trailing CR/LF/space from keyboard wedges
+  while (!input.empty() &&
+         (input.back() == '\r' || input.back() == '\n' || input.back() == ' ')) {
+    input.remove_suffix(1);
+  }
+
+  size_t base = 0;
+  // Symbology identifier, e.g. "]d2" (DataMatrix) or "]C1" (GS1-128)
+  if (input.size() >= 3 && input[0] == ']') {
+    base += 3;
+  }
+  // Leading FNC1
+  while (base < input.size() && input[base] == kGroupSeparator) {
+    ++base;
+  }
+  std::string_view body = input.substr(base);
+  if (body.empty()) {
+    return out->status = Gs1Status::kEmpty;
+  }
+
+  // Bare EAN-8 / UPC-A / EAN-13 / GTIN-14
+  const size_t n = body.size();
+  if ((n == 8 || n == 12 || n == 13 || n == 14) && AllDigits(body) &&
+      Gs1CheckDigitValid(body)) {
+    out->plain = true;
+    out->elements[0] = {kGs1AiGtin, static_cast<uint16_t>(base),
+                        static_cast<uint16_t>(n)};
+    out->count = 1;
+    return out->status = Gs1Status::kOk;
+  }
+
+  if (body[0] == '(') {
+    return out->status = ParseBracketed(body, base, out);
+  }
+  return out->status = ParseElementString(body, base, out);
+}
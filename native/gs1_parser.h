@@ -0,0 +1,70 @@
+#ifndef NATIVE_GS1_PARSER_H_
+#define NATIVE_GS1_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// GS1 Application Identifier parsing for pack barcodes (GS1 DataMatrix /
+// GS1-128 element strings).
+//
+// Accepts raw scanner output with or without a symbology identifier
+// ("]d2", "]C1", ...), a leading FNC1, GS (0x1D) separators after
+// variable-length fields, the human-readable "(01)...(21)..." form, and
+// plain EAN-8/UPC-A/EAN-13/GTIN-14 codes. Parsing never allocates: results
+// are offsets into the caller's input.
+
+enum class Gs1Status : int32_t {
+  kOk = 0,
+  kEmpty = 1,
+  // An AI that is not in the table
+  kUnknownAi = 2,
+  // A field shorter or longer than its AI allows
+  kBadLength = 3,
+  // Letters in a numeric-only field
+  kNotNumeric = 4,
+  // GTIN/SSCC/GLN whose mod-10 check digit does not match
+  kBadCheckDigit = 5,
+  kTooManyElements = 6,
+};
+
+// Application Identifiers used by the app.
+constexpr uint16_t kGs1AiGtin = 1;
+constexpr uint16_t kGs1AiLot = 10;
+constexpr uint16_t kGs1AiExpiry = 17;
+constexpr uint16_t kGs1AiSerial = 21;
+
+constexpr size_t kGs1MaxElements = 16;
+
+struct Gs1Element {
+  uint16_t ai;
+  uint16_t offset;
+  uint16_t length;
+};
+
+struct Gs1Parse {
+  Gs1Status status = Gs1Status::kEmpty;
+  // True for a bare EAN/UPC/GTIN; it is reported as AI 01.
+  bool plain = false;
+  uint8_t count = 0;
+  Gs1Element elements[kGs1MaxElements];
+
+  // First element with |ai|, or nullptr
+  const Gs1Element* Find(uint16_t ai) const;
+};
+
+// Parses |input| into |out|. Elements parsed before an error are kept, so
+// callers can still use e.g. the GTIN of a code with a malformed serial.
+Gs1Status ParseGs1(std::string_view input, Gs1Parse* out);
+
+// Value of |element| within the |input| it was parsed from.
+inline std::string_view Gs1Value(std::string_view input,
+                                 const Gs1Element& element) {
+  return input.substr(element.offset, element.length);
+}
+
+// True if the last digit of |digits| is the GS1 mod-10 check digit of the
+// others.
+bool Gs1CheckDigitValid(std::string_view digits);
+
+#endif  // NATIVE_GS1_PARSER_H_
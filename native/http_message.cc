@@ -0,0 +1,332 @@
+#include "native/http_message.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+char Lower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (Lower(a[i]) != Lower(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string_view Trim(std::string_view text) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+// Whether the comma-separated |list| holds |token|, as in "Connection:
+// keep-alive, Upgrade".
+bool HasToken(std::string_view list, std::string_view token) {
+  while (!list.empty()) {
+    const size_t comma = list.find(',');
+    if (EqualsIgnoreCase(Trim(list.substr(0, comma)), token)) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    list.remove_prefix(comma + 1);
+  }
+  return false;
+}
+
+// Strict decimal; no sign, no overflow
+bool ParseSize(std::string_view text, size_t* value) {
+  if (text.empty() || text.size() > 15) {
+    return false;
+  }
+  size_t n = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    n = n * 10 + static_cast<size_t>(c - '0');
+  }
+  *value = n;
+  return true;
+}
+
+bool ParseHexSize(std::string_view text, size_t* value) {
+  // Chunk extensions (";name=value") are ignored
+  text = Trim(text.substr(0, text.find(';')));
+  if (text.empty() || text.size() > 12) {
+    return false;
+  }
+  size_t n = 0;
+  for (char c : text) {
+    int digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (Lower(c) >= 'a' && Lower(c) <= 'f') {
+      digit = Lower(c) - 'a' + 10;
+    } else {
+      return false;
+    }
+    n = n * 16 + static_cast<size_t>(digit);
+  }
+  *value = n;
+  return true;
+}
+
+}  // namespace
+
+HttpParser::HttpParser(Kind kind) : kind_(kind) {}
+
+void HttpParser::Reset() {
+  state_ = State::kHead;
+  head_request_ = false;
+  started_ = false;
+  head_.clear();
+  line_.clear();
+  method_.clear();
+  target_.clear();
+  status_ = 0;
+  headers_.clear();
+  body_.clear();
+  remaining_ = 0;
+  keep_alive_ = true;
+  error_.clear();
+}
+
+HttpParser::Result HttpParser::Fail(const char* message) {
+  state_ = State::kError;
+  error_ = message;
+  keep_alive_ = false;
+  return Result::kError;
+}
+
+std::string_view HttpParser::Header(std::string_view name) const {
+  for (const auto& header : headers_) {
+    if (EqualsIgnoreCase(header.first, name)) {
+      return header.second;
+    }
+  }
+  return std::string_view();
+}
+
+bool HttpParser::TakeLine(const char* data, size_t size, size_t* offset) {
+  const char* start = data + *offset;
+  const char* newline =
+      static_cast<const char*>(memchr(start, '\n', size - *offset));
+  if (newline == nullptr) {
+    line_.append(start, size - *offset);
+    *offset = size;
+    return false;
+  }
+  line_.append(start, static_cast<size_t>(newline - start));
+  *offset += static_cast<size_t>(newline - start) + 1;
+  if (!line_.empty() && line_.back() == '\r') {
+    line_.pop_back();
+  }
+  return true;
+}
+
+bool HttpParser::ParseHead() {
+  std::string_view head(head_);
+  head.remove_suffix(4);  // the blank line
+  const size_t first_end = head.find("\r\n");
+  const std::string_view first = head.substr(0, first_end);
+  std::string_view version;
+  if (kind_ == Kind::kRequest) {
+    const size_t a = first.find(' ');
+    const size_t b = a == std::string_view::npos ? a : first.find(' ', a + 1);
+    if (b == std::string_view::npos || a == 0 || b == a + 1) {
+      error_ = "bad request line";
+      return false;
+    }
+    method_.assign(first.substr(0, a));
+    target_.assign(first.substr(a + 1, b - a - 1));
+    version = first.substr(b + 1);
+  } else {
+    const size_t a = first.find(' ');
+    version = first.substr(0, a);
+    size_t status = 0;
+    if (a == std::string_view::npos ||
+        !ParseSize(first.substr(a + 1, 3), &status) || status < 100 ||
+        status > 999 ||
+        (first.size() > a + 4 && first[a + 4] != ' ')) {
+      error_ = "bad status line";
+      return false;
+    }
+    status_ = static_cast<int>(status);
+  }
+  if (version == "HTTP/1.1") {
+    keep_alive_ = true;
+  } else if (version == "HTTP/1.0") {
+    keep_alive_ = false;
+  } else {
+    error_ = "unsupported HTTP version";
+    return false;
+  }
+
+  std::string_view rest = first_end == std::string_view::npos
+                              ? std::string_view()
+                              : head.substr(first_end + 2);
+  while (!rest.empty()) {
+    const size_t end = rest.find("\r\n");
+    const std::string_view line = rest.substr(0, end);
+    rest = end == std::string_view::npos ? std::string_view()
+                                         : rest.substr(end + 2);
+    const size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0 || line[0] == ' ' ||
+        line[0] == '\t') {
+      error_ = "bad header line";
+      return false;
+    }
+    headers_.emplace_back(std::string(line.substr(0, colon)),
+                          std::string(Trim(line.substr(colon + 1))));
+  }
+
+  const std::string_view connection = Header("Connection");
+  if (HasToken(connection, "close")) {
+    keep_alive_ = false;
+  } else if (HasToken(connection, "keep-alive")) {
+    keep_alive_ = true;
+  }
+
+  if (kind_ == Kind::kResponse &&
+      (head_request_ || status_ < 200 || status_ == 204 || status_ == 304)) {
+    state_ = State::kDone;
+    return true;
+  }
+  if (HasToken(Header("Transfer-Encoding"), "chunked")) {
+    state_ = State::kChunkSize;
+    return true;
+  }
+  const std::string_view length = Header("Content-Length");
+  if (!length.empty()) {
+    if (!ParseSize(length, &remaining_)) {
+      error_ = "bad Content-Length";
+      return false;
+    }
+    state_ = remaining_ == 0 ? State::kDone : State::kBody;
+    return true;
+  }
+  if (kind_ == Kind::kRequest) {
+    state_ = State::kDone;
+  } else {
+    state_ = State::kUntilEof;
+    keep_alive_ = false;
+  }
+  return true;
+}
+
+HttpParser::Result HttpParser::Feed(const char* data, size_t size,
+                                    size_t* used) {
+  size_t offset = 0;
+  if (size > 0 && state_ != State::kDone && state_ != State::kError) {
+    started_ = true;
+  }
+  while (true) {
+    if (state_ == State::kDone) {
+      *used = offset;
+      return Result::kDone;
+    }
+    if (state_ == State::kError) {
+      *used = offset;
+      return Result::kError;
+    }
+    if (offset == size) {
+      *used = offset;
+      return Result::kNeedMore;
+    }
+    switch (state_) {
+      case State::kHead: {
+        const size_t before = head_.size();
+        const size_t scan_from = before >= 3 ? before - 3 : 0;
+        head_.append(data + offset, size - offset);
+        const size_t end = head_.find("\r\n\r\n", scan_from);
+        if (end == std::string::npos) {
+          if (head_.size() > kMaxHeadSize) {
+            *used = size;
+            return Fail("head too large");
+          }
+          offset = size;
+          break;
+        }
+        const size_t head_size = end + 4;
+        offset += head_size - before;
+        head_.resize(head_size);
+        if (!ParseHead()) {
+          // ParseHead said why in error_
+          *used = offset;
+          state_ = State::kError;
+          keep_alive_ = false;
+          return Result::kError;
+        }
+        break;
+      }
+      case State::kBody:
+      case State::kChunkData: {
+        const size_t n = std::min(remaining_, size - offset);
+        body_.append(data + offset, n);
+        offset += n;
+        remaining_ -= n;
+        if (remaining_ == 0) {
+          state_ = state_ == State::kBody ? State::kDone : State::kChunkEnd;
+        }
+        break;
+      }
+      case State::kUntilEof:
+        body_.append(data + offset, size - offset);
+        offset = size;
+        break;
+      case State::kChunkSize:
+      case State::kChunkEnd:
+      case State::kTrailer: {
+        if (!TakeLine(data, size, &offset)) {
+          if (line_.size() > kMaxHeadSize) {
+            *used = offset;
+            return Fail("chunk line too long");
+          }
+          break;
+        }
+        std::string line;
+        line.swap(line_);
+        if (state_ == State::kChunkEnd) {
+          if (!line.empty()) {
+            *used = offset;
+            return Fail("bad chunk end");
+          }
+          state_ = State::kChunkSize;
+        } else if (state_ == State::kTrailer) {
+          if (line.empty()) {
+            state_ = State::kDone;
+          }
+        } else if (!ParseHexSize(line, &remaining_)) {
+          *used = offset;
+          return Fail("bad chunk size");
+        } else {
+          state_ = remaining_ == 0 ? State::kTrailer : State::kChunkData;
+        }
+        break;
+      }
+      case State::kDone:
+      case State::kError:
+        break;
+    }
+  }
+}
+
+bool HttpParser::FinishAtEof() {
+  if (state_ != State::kUntilEof) {
+    return false;
+  }
+  state_ = State::kDone;
+  return true;
+}
@@ -0,0 +1,90 @@
+#ifndef NATIVE_HTTP_MESSAGE_H_
+#define NATIVE_HTTP_MESSAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Incremental parser of one HTTP/1.1 request or response at a time, as read
+// off a socket. Bodies may be sized by Content-Length, chunked, or (for a
+// response) run to the end of the connection. Bytes after the message,
+// e.g. the next pipelined one, are left for the next message.
+class HttpParser {
+ public:
+  enum class Kind : uint8_t { kRequest, kResponse };
+  enum class Result : uint8_t { kNeedMore, kDone, kError };
+
+  // Larger heads are rejected rather than buffered.
+  static constexpr size_t kMaxHeadSize = 64 * 1024;
+
+  explicit HttpParser(Kind kind);
+
+  // Parses from |data|. |*used| receives how many bytes were consumed; on
+  // kDone the rest of |data| belongs to the next message.
+  Result Feed(const char* data, size_t size, size_t* used);
+
+  // The connection ended. Returns true if that completes a response whose
+  // body runs to the end of the connection.
+  bool FinishAtEof();
+
+  // Readies the parser for the next message on the same connection.
+  void Reset();
+
+  // The response to a HEAD request has no body whatever its headers say.
+  void set_head_request(bool head) { head_request_ = head; }
+
+  // Request line
+  const std::string& method() const { return method_; }
+  const std::string& target() const { return target_; }
+  // Status line; 0 for a request
+  int status() const { return status_; }
+
+  // Value of the first header named |name| (any case), or empty
+  std::string_view Header(std::string_view name) const;
+  const std::string& body() const { return body_; }
+  std::string TakeBody() { return std::move(body_); }
+
+  // Whether the connection may carry another message after this one
+  bool keep_alive() const { return keep_alive_; }
+  // Whether any byte of the current message has been seen
+  bool started() const { return started_; }
+  const std::string& error() const { return error_; }
+
+ private:
+  enum class State : uint8_t {
+    kHead,
+    kBody,         // Content-Length bytes
+    kUntilEof,     // response body to the end of the connection
+    kChunkSize,    // hex size line
+    kChunkData,
+    kChunkEnd,     // CRLF after the data
+    kTrailer,      // header lines after the last chunk
+    kDone,
+    kError,
+  };
+
+  Result Fail(const char* message);
+  bool ParseHead();
+  // Consumes one CRLF-terminated line into |line_|; false if incomplete
+  bool TakeLine(const char* data, size_t size, size_t* offset);
+
+  const Kind kind_;
+  State state_ = State::kHead;
+  bool head_request_ = false;
+  bool started_ = false;
+  std::string head_;
+  std::string line_;
+  std::string method_;
+  std::string target_;
+  int status_ = 0;
+  std::vector<std::pair<std::string, std::string>> headers_;
+  std::string body_;
+  size_t remaining_ = 0;
+  bool keep_alive_ = true;
+  std::string error_;
+};
+
+#endif  // NATIVE_HTTP_MESSAGE_H_
@@ -0,0 +1,518 @@
+#include "native/json_reader.h"
+
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+constexpr double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                             1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                             1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+constexpr uint64_t kMaxExactMantissa = uint64_t{1} << 53;
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool IsNumberChar(char c) {
+  return IsDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' ||
+         c == 'E';
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+}  // namespace
+
+bool ParseJsonNumber(std::string_view text, double* value) {
+  const size_t n = text.size();
+  size_t i = 0;
+  const bool negative = i < n && text[i] == '-';
+  if (negative) {
+    ++i;
+  }
+  if (i >= n) {
+    return false;
+  }
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  if (text[i] == '0') {
+    ++i;
+  } else if (IsDigit(text[i])) {
+    for (; i < n && IsDigit(text[i]); ++i) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(text[i] - '0');
+        if (mantissa != 0) {
+          ++digits;
+        }
+      } else {
+        // Digits past 19 only scale the value
+        ++exponent;
+        ++digits;
+      }
+    }
+  } else {
+    return false;
+  }
+  if (i < n && text[i] == '.') {
+    ++i;
+    if (i >= n || !IsDigit(text[i])) {
+      return false;
+    }
+    for (; i < n && IsDigit(text[i]); ++i) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(text[i] - '0');
+        --exponent;
+        if (mantissa != 0) {
+          ++digits;
+        }
+      } else {
+        ++digits;
+      }
+    }
+  }
+  if (i < n && (text[i] == 'e' || text[i] == 'E')) {
+    ++i;
+    bool exponent_negative = false;
+    if (i < n && (text[i] == '+' || text[i] == '-')) {
+      exponent_negative = text[i] == '-';
+      ++i;
+    }
+    if (i >= n || !IsDigit(text[i])) {
+      return false;
+    }
+    int explicit_exponent = 0;
+    for (; i < n && IsDigit(text[i]); ++i) {
+      if (explicit_exponent < 100000) {
+        explicit_exponent = explicit_exponent * 10 + (text[i] - '0');
+      }
+    }
+    exponent += exponent_negative ? -explicit_exponent : explicit_exponent;
+  }
+  if (i != n) {
+    return false;
+  }
+
+  // Both the mantissa and 10^|exponent| are exact doubles, so one
+  // multiplication or division rounds correctly.
+  if (digits <= 19 && mantissa <= kMaxExactMantissa && exponent >= -22 &&
+      exponent <= 22) {
+    double result = static_cast<double>(mantissa);
+    result = exponent < 0 ? result / kPow10[-exponent]
+                          : result * kPow10[exponent];
+    *value = negative ? -result : result;
+    return true;
+  }
+  // Long or extreme numbers: JSON's grammar is a subset of strtod's, and
+  // none of its characters depend on the locale but the '.'.
+  std::string copy(text);
+  const char* dot = std::strchr(copy.c_str(), '.');
+  const char* decimal_point = std::localeconv()->decimal_point;
+  if (dot != nullptr && decimal_point != nullptr && decimal_point[0] != '.' &&
+      decimal_point[0] != '\0') {
+    copy[static_cast<size_t>(dot - copy.c_str())] = decimal_point[0];
+  }
+  *value = std::strtod(copy.c_str(), nullptr);
+  return true;
+}
+
+JsonReader::JsonReader(JsonHandler* handler, size_t max_depth)
+    : handler_(handler), max_depth_(max_depth) {}
+
+void JsonReader::Reset() {
+  state_ = State::kValue;
+  lexeme_ = Lexeme::kNone;
+  stack_.clear();
+  token_.clear();
+  escape_ = 0;
+  unicode_ = 0;
+  high_surrogate_ = 0;
+  literal_ = nullptr;
+  literal_matched_ = 0;
+  offset_ = 0;
+  failed_ = false;
+  error_.clear();
+}
+
+bool JsonReader::Fail(const char* message) {
+  if (!failed_) {
+    failed_ = true;
+    error_ = std::string(message) + " at byte " + std::to_string(offset_);
+  }
+  return false;
+}
+
+bool JsonReader::Feed(const char* data, size_t size) {
+  if (failed_) {
+    return false;
+  }
+  const char* p = data;
+  const char* const end = data + size;
+  while (p < end) {
+    bool ok = true;
+    switch (lexeme_) {
+      case Lexeme::kString:
+        ok = ContinueString(&p, end);
+        break;
+      case Lexeme::kNumber:
+        ok = ContinueNumber(&p, end);
+        break;
+      case Lexeme::kLiteral:
+        ok = ContinueLiteral(&p, end);
+        break;
+      case Lexeme::kNone:
+        ++offset_;
+        ok = Step(*p++);
+        break;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool JsonReader::Step(char c) {
+  if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+    return true;
+  }
+  switch (state_) {
+    case State::kValue:
+      return BeginValue(c);
+    case State::kArrayFirst:
+      return c == ']' ? CloseContainer(c) : BeginValue(c);
+    case State::kObjectFirst:
+      if (c == '}') {
+        return CloseContainer(c);
+      }
+      [[fallthrough]];
+    case State::kKey:
+      if (c != '"') {
+        return Fail("expected a key");
+      }
+      lexeme_ = Lexeme::kString;
+      string_is_key_ = true;
+      return true;
+    case State::kColon:
+      if (c != ':') {
+        return Fail("expected ':'");
+      }
+      state_ = State::kValue;
+      return true;
+    case State::kCommaOrEnd:
+      if (c == ',') {
+        state_ = stack_.back() == '{' ? State::kKey : State::kValue;
+        return true;
+      }
+      if (c == '}' || c == ']') {
+        return CloseContainer(c);
+      }
+      return Fail("expected ',' or a closing bracket");
+    case State::kDone:
+      break;
+  }
+  return Fail("trailing characters");
+}
+
+bool JsonReader::BeginValue(char c) {
+  switch (c) {
+    case '{':
+    case '[':
+      if (stack_.size() >= max_depth_) {
+        return Fail("nested too deeply");
+      }
+      stack_.push_back(c);
+      state_ = c == '{' ? State::kObjectFirst : State::kArrayFirst;
+      if (!(c == '{' ? handler_->StartObject() : handler_->StartArray())) {
+        return Fail("stopped by the handler");
+      }
+      return true;
+    case '"':
+      lexeme_ = Lexeme::kString;
+      string_is_key_ = false;
+      return true;
+    case 't':
+      literal_ = "true";
+      break;
+    case 'f':
+      literal_ = "false";
+      break;
+    case 'n':
+      literal_ = "null";
+      break;
+    default:
+      if (c == '-' || IsDigit(c)) {
+        lexeme_ = Lexeme::kNumber;
+        token_.assign(1, c);
+        return true;
+      }
+      return Fail("expected a value");
+  }
+  lexeme_ = Lexeme::kLiteral;
+  literal_matched_ = 1;
+  return true;
+}
+
+bool JsonReader::AfterValue() {
+  state_ = stack_.empty() ? State::kDone : State::kCommaOrEnd;
+  return true;
+}
+
+bool JsonReader::CloseContainer(char c) {
+  const char open = c == '}' ? '{' : '[';
+  if (stack_.empty() || stack_.back() != open) {
+    return Fail("mismatched closing bracket");
+  }
+  stack_.pop_back();
+  if (!(c == '}' ? handler_->EndObject() : handler_->EndArray())) {
+    return Fail("stopped by the handler");
+  }
+  return AfterValue();
+}
+
+bool JsonReader::EmitString(std::string_view value) {
+  lexeme_ = Lexeme::kNone;
+  if (string_is_key_) {
+    if (!handler_->Key(value)) {
+      return Fail("stopped by the handler");
+    }
+    state_ = State::kColon;
+    return true;
+  }
+  if (!handler_->String(value)) {
+    return Fail("stopped by the handler");
+  }
+  return AfterValue();
+}
+
+void JsonReader::AppendCodePoint(uint32_t code_point) {
+  if (code_point < 0x80) {
+    token_.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    token_.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    token_.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    token_.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    token_.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    token_.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    token_.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    token_.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    token_.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    token_.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+bool JsonReader::ContinueString(const char** p, const char* end) {
+  const char* cursor = *p;
+  // Fast path: the whole string is in this chunk and has no escapes.
+  if (token_.empty() && escape_ == 0 && high_surrogate_ == 0) {
+    const char* scan = cursor;
+    while (scan < end && *scan != '"' && *scan != '\\' &&
+           static_cast<unsigned char>(*scan) >= 0x20) {
+      ++scan;
+    }
+    if (scan < end && *scan == '"') {
+      offset_ += static_cast<size_t>(scan + 1 - cursor);
+      *p = scan + 1;
+      return EmitString(
+          std::string_view(cursor, static_cast<size_t>(scan - cursor)));
+    }
+  }
+
+  while (cursor < end) {
+    const char c = *cursor;
+    if (escape_ == 0) {
+      if (c == '"') {
+        ++cursor;
+        ++offset_;
+        *p = cursor;
+        if (high_surrogate_ != 0) {
+          AppendCodePoint(0xFFFD);
+          high_surrogate_ = 0;
+        }
+        const std::string value = std::move(token_);
+        token_.clear();
+        return EmitString(value);
+      }
+      if (c == '\\') {
+        escape_ = 1;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        *p = cursor;
+        return Fail("control character in string");
+      } else {
+        if (high_surrogate_ != 0) {
+          AppendCodePoint(0xFFFD);
+          high_surrogate_ = 0;
+        }
+        // Copy the run of plain bytes at once
+        const char* run = cursor;
+        while (run < end && *run != '"' && *run != '\\' &&
+               static_cast<unsigned char>(*run) >= 0x20) {
+          ++run;
+        }
+        token_.append(cursor, static_cast<size_t>(run - cursor));
+        offset_ += static_cast<size_t>(run - cursor);
+        cursor = run;
+        continue;
+      }
+    } else if (escape_ == 1) {
+      char decoded = 0;
+      switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+          decoded = c;
+          break;
+        case 'b':
+          decoded = '\b';
+          break;
+        case 'f':
+          decoded = '\f';
+          break;
+        case 'n':
+          decoded = '\n';
+          break;
+        case 'r':
+          decoded = '\r';
+          break;
+        case 't':
+          decoded = '\t';
+          break;
+        case 'u':
+          escape_ = 2;
+          unicode_ = 0;
+          break;
+        default:
+          *p = cursor;
+          return Fail("bad escape");
+      }
+      if (escape_ == 1) {
+        if (high_surrogate_ != 0) {
+          AppendCodePoint(0xFFFD);
+          high_surrogate_ = 0;
+        }
+        token_.push_back(decoded);
+        escape_ = 0;
+      }
+    } else {
+      const int digit = HexValue(c);
+      if (digit < 0) {
+        *p = cursor;
+        return Fail("bad \\u escape");
+      }
+      unicode_ = (unicode_ << 4) | static_cast<uint32_t>(digit);
+      if (++escape_ == 6) {
+        escape_ = 0;
+        if (unicode_ >= 0xD800 && unicode_ <= 0xDBFF) {
+          if (high_surrogate_ != 0) {
+            AppendCodePoint(0xFFFD);
+          }
+          high_surrogate_ = unicode_;
+        } else if (unicode_ >= 0xDC00 && unicode_ <= 0xDFFF) {
+          if (high_surrogate_ != 0) {
+            AppendCodePoint(0x10000 + ((high_surrogate_ - 0xD800) << 10) +
+                            (unicode_ - 0xDC00));
+            high_surrogate_ = 0;
+          } else {
+            // Lone low surrogate
+            AppendCodePoint(0xFFFD);
+          }
+        } else {
+          if (high_surrogate_ != 0) {
+            AppendCodePoint(0xFFFD);
+            high_surrogate_ = 0;
+          }
+          AppendCodePoint(unicode_);
+        }
+      }
+    }
+    ++cursor;
+    ++offset_;
+  }
+  *p = cursor;
+  return true;
+}
+
+bool JsonReader::ContinueNumber(const char** p, const char* end) {
+  const char* cursor = *p;
+  while (cursor < end && IsNumberChar(*cursor)) {
+    ++cursor;
+  }
+  token_.append(*p, static_cast<size_t>(cursor - *p));
+  offset_ += static_cast<size_t>(cursor - *p);
+  *p = cursor;
+  if (cursor == end) {
+    // May continue in the next chunk
+    return true;
+  }
+  return FinishNumber();
+}
+
+bool JsonReader::FinishNumber() {
+  lexeme_ = Lexeme::kNone;
+  double value;
+  if (!ParseJsonNumber(token_, &value)) {
+    return Fail("bad number");
+  }
+  token_.clear();
+  if (!handler_->Number(value)) {
+    return Fail("stopped by the handler");
+  }
+  return AfterValue();
+}
+
+bool JsonReader::ContinueLiteral(const char** p, const char* end) {
+  const size_t length = std::strlen(literal_);
+  const char* cursor = *p;
+  while (cursor < end && literal_matched_ < length) {
+    if (*cursor != literal_[literal_matched_]) {
+      *p = cursor;
+      return Fail("bad literal");
+    }
+    ++cursor;
+    ++offset_;
+    ++literal_matched_;
+  }
+  *p = cursor;
+  if (literal_matched_ < length) {
+    return true;
+  }
+  lexeme_ = Lexeme::kNone;
+  bool ok;
+  if (literal_[0] == 'n') {
+    ok = handler_->Null();
+  } else {
+    ok = handler_->Bool(literal_[0] == 't');
+  }
+  if (!ok) {
+    return Fail("stopped by the handler");
+  }
+  return AfterValue();
+}
+
+bool JsonReader::Finish() {
+  if (failed_) {
+    return false;
+  }
+  if (lexeme_ == Lexeme::kNumber && !FinishNumber()) {
+    return false;
+  }
+  if (lexeme_ != Lexeme::kNone) {
+    return Fail("unexpected end in a token");
+  }
+  if (state_ != State::kDone) {
+    return Fail("unexpected end");
+  }
+  return true;
+}
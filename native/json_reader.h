@@ -0,0 +1,108 @@
+#ifndef NATIVE_JSON_READER_H_
+#define NATIVE_JSON_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Receives the events of a JsonReader. Each returns false to stop parsing.
+class JsonHandler {
+ public:
+  virtual ~JsonHandler() = default;
+
+  virtual bool StartObject() = 0;
+  virtual bool EndObject() = 0;
+  virtual bool StartArray() = 0;
+  virtual bool EndArray() = 0;
+  // Views are only valid during the call.
+  virtual bool Key(std::string_view key) = 0;
+  virtual bool String(std::string_view value) = 0;
+  virtual bool Number(double value) = 0;
+  virtual bool Bool(bool value) = 0;
+  virtual bool Null() = 0;
+};
+
+// Streaming (SAX) JSON parser.
+//
+// Input can arrive in chunks of any size, e.g. as an HTTP body is read; a
+// token split across chunks is carried over in a small buffer. Strings
+// without escapes that lie within one chunk reach the handler as views of
+// the input, so decoding a response does not allocate per value. Numbers
+// are parsed without the C locale's help: the common short ones exactly
+// with integer arithmetic, the rest by strtod.
+class JsonReader {
+ public:
+  explicit JsonReader(JsonHandler* handler, size_t max_depth = 64);
+
+  // Parses |size| more bytes. Returns false once the input is malformed or
+  // the handler stopped; later calls then do nothing.
+  bool Feed(const char* data, size_t size);
+  bool Feed(std::string_view data) { return Feed(data.data(), data.size()); }
+
+  // Ends the input. Returns true if it held exactly one complete value.
+  bool Finish();
+
+  // Starts over with the same handler.
+  void Reset();
+
+  // Why parsing failed, empty while it has not
+  const std::string& error() const { return error_; }
+  // Bytes consumed so far
+  size_t offset() const { return offset_; }
+
+ private:
+  enum class State : uint8_t {
+    kValue,        // a value: the top level, after ':' or an array ','
+    kArrayFirst,   // after '[': a value or ']'
+    kObjectFirst,  // after '{': a key or '}'
+    kKey,          // after an object ',': a key
+    kColon,
+    kCommaOrEnd,
+    kDone,
+  };
+  enum class Lexeme : uint8_t { kNone, kString, kNumber, kLiteral };
+
+  bool Fail(const char* message);
+  // Handles one byte outside any string, number or literal
+  bool Step(char c);
+  bool BeginValue(char c);
+  bool AfterValue();
+  bool CloseContainer(char c);
+  // Continue the lexeme in progress from |*p|; advance |*p| past what they
+  // consumed.
+  bool ContinueString(const char** p, const char* end);
+  bool ContinueNumber(const char** p, const char* end);
+  bool ContinueLiteral(const char** p, const char* end);
+  bool FinishNumber();
+  bool EmitString(std::string_view value);
+  void AppendCodePoint(uint32_t code_point);
+
+  JsonHandler* handler_;
+  size_t max_depth_;
+  State state_ = State::kValue;
+  Lexeme lexeme_ = Lexeme::kNone;
+  // '{' or '[' per open container
+  std::vector<char> stack_;
+  // Bytes of a string or number cut by a chunk boundary
+  std::string token_;
+  bool string_is_key_ = false;
+  // 0 outside an escape, 1 after '\', 2-5 reading the \u hex digits
+  int escape_ = 0;
+  uint32_t unicode_ = 0;
+  // High surrogate waiting for its low half
+  uint32_t high_surrogate_ = 0;
+  // The literal being matched and how much of it has been seen
+  const char* literal_ = nullptr;
+  size_t literal_matched_ = 0;
+  size_t offset_ = 0;
+  bool failed_ = false;
+  std::string error_;
+};
+
+// Parses a complete JSON number (RFC 8259 grammar). Returns false if |text|
+// is not one.
+bool ParseJsonNumber(std::string_view text, double* value);
+
+#endif  // NATIVE_JSON_READER_H_
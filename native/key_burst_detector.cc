@@ -0,0 +1,98 @@
+#include "native/key_burst_detector.h"
+
+namespace {
+
+void AppendUtf8(uint32_t code_point, std::string* out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else {
+    out->push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  }
+}
+
+}  // namespace
+
+KeyBurstDetector::KeyBurstDetector(KeyBurstOptions options)
+    : options_(options) {}
+
+KeyBurstResult KeyBurstDetector::OnPress(KeyKind kind, uint32_t code_point,
+                                         int64_t time_ms) {
+  KeyBurstResult result;
+  // A pause since the last key ended the burst even if the timer is late
+  if (holding_ && time_ms - last_ms_ > options_.max_gap_ms) {
+    result = Resolve();
+  }
+
+  switch (kind) {
+    case KeyKind::kCharacter:
+      holding_ = true;
+      AppendUtf8(code_point, &text_);
+      ++characters_;
+      last_ms_ = time_ms;
+      result.key = KeyBurstResult::Key::kHold;
+      break;
+    case KeyKind::kModifier:
+      if (holding_) {
+        last_ms_ = time_ms;
+        result.key = KeyBurstResult::Key::kHold;
+      }
+      break;
+    case KeyKind::kTerminator:
+      if (holding_) {
+        const bool scan = characters_ >= options_.min_length;
+        const KeyBurstResult ended = Resolve();
+        result.release_held = ended.release_held;
+        result.barcode = ended.barcode;
+        if (scan) {
+          result.key = KeyBurstResult::Key::kDrop;
+        }
+      }
+      break;
+    case KeyKind::kOther:
+      if (holding_) {
+        const KeyBurstResult ended = Resolve();
+        result.release_held = ended.release_held;
+        result.barcode = ended.barcode;
+      }
+      break;
+  }
+  return result;
+}
+
+KeyBurstResult KeyBurstDetector::OnTimeout() {
+  return holding_ ? Resolve() : KeyBurstResult();
+}
+
+KeyBurstResult KeyBurstDetector::Release() {
+  KeyBurstResult result;
+  result.release_held = holding_;
+  Clear();
+  return result;
+}
+
+KeyBurstResult KeyBurstDetector::Resolve() {
+  KeyBurstResult result;
+  if (characters_ >= options_.min_length) {
+    result.barcode = std::move(text_);
+  } else {
+    result.release_held = true;
+  }
+  Clear();
+  return result;
+}
+
+void KeyBurstDetector::Clear() {
+  holding_ = false;
+  text_.clear();
+  characters_ = 0;
+}
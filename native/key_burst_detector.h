@@ -0,0 +1,93 @@
+#ifndef NATIVE_KEY_BURST_DETECTOR_H_
+#define NATIVE_KEY_BURST_DETECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Timing that tells a keyboard-wedge (USB HID) scanner from a person.
+struct KeyBurstOptions {
+  // Longest gap between two keys of one scan. Scanners type a key every
+  // 1-15 ms; people, and key auto-repeat, rarely go under 40 ms.
+  int64_t max_gap_ms = 30;
+  // Fewest characters in a scan; a shorter burst is typing
+  size_t min_length = 8;
+  // Tab ends a scan like Enter (scanners set up with a Tab suffix)
+  bool end_on_tab = true;
+};
+
+// How the caller classifies a key press.
+enum class KeyKind {
+  // Types |code_point|
+  kCharacter,
+  // Enter, or Tab when it ends scans
+  kTerminator,
+  // Shift and the like; a scanner presses Shift for capitals
+  kModifier,
+  // Arrows, function keys, Ctrl/Alt combinations, ...
+  kOther,
+};
+
+// What to do with the held keys and the key just pressed.
+struct KeyBurstResult {
+  enum class Key {
+    // Deliver it after any released keys
+    kDeliver,
+    // Keep it back with the held keys; a later call decides
+    kHold,
+    // It ended the scan in |barcode|; drop it
+    kDrop,
+  };
+
+  // Deliver the held keys in order: they were typed by a person
+  bool release_held = false;
+  // Non-empty: the held keys typed this code (UTF-8) and are dropped
+  std::string barcode;
+  Key key = Key::kDeliver;
+};
+
+// Detects scans among the key presses of a keyboard-wedge scanner, so the
+// runner can hand a whole code to Dart as one event whatever widget has
+// focus, instead of a TextField receiving it a character at a time.
+//
+// Character keys are held back while they come faster than max_gap_ms.
+// The burst is a scan if it reaches min_length characters and ends with a
+// terminator or a pause; anything else is released to the UI as typed,
+// late by at most max_gap_ms. Releases of held keys belong with their
+// presses and are the caller's to hold.
+class KeyBurstDetector {
+ public:
+  explicit KeyBurstDetector(KeyBurstOptions options = KeyBurstOptions());
+
+  const KeyBurstOptions& options() const { return options_; }
+  // Takes effect with the next burst
+  void SetOptions(const KeyBurstOptions& options) { options_ = options; }
+
+  // A key press at |time_ms| (any monotonic millisecond clock).
+  KeyBurstResult OnPress(KeyKind kind, uint32_t code_point, int64_t time_ms);
+
+  // No key came by deadline_ms(): ends the burst.
+  KeyBurstResult OnTimeout();
+
+  // Ends the burst as typing, e.g. when the window loses focus.
+  KeyBurstResult Release();
+
+  bool holding() const { return holding_; }
+  // When OnTimeout() is due, or -1 while nothing is held
+  int64_t deadline_ms() const {
+    return holding_ ? last_ms_ + options_.max_gap_ms : -1;
+  }
+
+ private:
+  // Ends the burst: a scan if long enough, else typing
+  KeyBurstResult Resolve();
+  void Clear();
+
+  KeyBurstOptions options_;
+  bool holding_ = false;
+  std::string text_;
+  size_t characters_ = 0;
+  int64_t last_ms_ = 0;
+};
+
+#endif  // NATIVE_KEY_BURST_DETECTOR_H_
@@ -0,0 +1,128 @@
+#include "native/line_framer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#define LINE_FRAMER_HAVE_SSE2 1
+#endif
+
+namespace {
+
+#if defined(LINE_FRAMER_HAVE_SSE2)
+inline int LowestSetBit(unsigned int mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+}  // namespace
+
+size_t FindNewline(const char* data, size_t size) {
+  size_t i = 0;
+#if defined(LINE_FRAMER_HAVE_SSE2)
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  for (; i + 16 <= size; i += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, lf))));
+    if (mask != 0) {
+      return i + LowestSetBit(mask);
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    if (data[i] == '\r' || data[i] == '\n') {
+      return i;
+    }
+  }
+  return size;
+}
+
+LineFramer::LineFramer(LineFramerOptions options)
+    : options_(std::move(options)) {
+  arena_.reserve(256);
+}
+
+void LineFramer::Reset() {
+  arena_.clear();
+  oversize_ = false;
+  stats_ = LineFramerStats();
+}
+
+size_t LineFramer::FindEnd(const char* data, size_t size,
+                           size_t* delimiter_length) const {
+  const std::string& terminator = options_.terminator;
+  if (terminator.empty()) {
+    *delimiter_length = 1;
+    return FindNewline(data, size);
+  }
+
+  *delimiter_length = terminator.size();
+  const char first = terminator[0];
+  const char* cursor = data;
+  const char* end = data + size;
+  while (cursor < end) {
+    const void* hit = memchr(cursor, first, end - cursor);
+    if (hit == nullptr) {
+      break;
+    }
+    const char* candidate = static_cast<const char*>(hit);
+    if (static_cast<size_t>(end - candidate) < terminator.size()) {
+      // Possible terminator cut off by the end of the read; the straddle
+      // check in Feed() picks it up next time.
+      break;
+    }
+    if (memcmp(candidate, terminator.data(), terminator.size()) == 0) {
+      return candidate - data;
+    }
+    cursor = candidate + 1;
+  }
+  return size;
+}
+
+bool LineFramer::Accept(std::string_view* frame) {
+  if (!options_.prefix.empty()) {
+    const size_t start = frame->find(options_.prefix);
+    if (start == std::string_view::npos) {
+      ++stats_.dropped_no_prefix;
+      return false;
+    }
+    frame->remove_prefix(start + options_.prefix.size());
+  }
+  if (frame->size() > options_.max_frame_length) {
+    ++stats_.dropped_oversize;
+    return false;
+  }
+  if (frame->empty() && options_.skip_empty) {
+    return false;
+  }
+  ++stats_.frames;
+  return true;
+}
+
+void LineFramer::AppendPartial(const char* data, size_t size) {
+  if (oversize_) {
+    return;
+  }
+  if (arena_.size() + size > options_.max_frame_length) {
+    // Noise without delimiters: stop buffering until the next frame end.
+    ++stats_.dropped_oversize;
+    arena_.clear();
+    oversize_ = true;
+    return;
+  }
+  arena_.append(data, size);
+}
@@ -0,0 +1,144 @@
+#ifndef NATIVE_LINE_FRAMER_H_
+#define NATIVE_LINE_FRAMER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// How a byte stream is cut into frames.
+struct LineFramerOptions {
+  // Empty: any CR or LF ends a frame (CRLF, LF-only and CR-only all work).
+  // Otherwise the exact byte sequence that ends a frame, e.g. "\r\n" for
+  // strict CRLF, "\n" for LF-only (a lone CR stays in the frame) or "\x03"
+  // for an ETX suffix.
+  std::string terminator;
+
+  // Optional frame prefix such as STX. Bytes before it are noise and are
+  // discarded; frames without it are dropped.
+  std::string prefix;
+
+  // Frames longer than this are dropped instead of growing the arena
+  size_t max_frame_length = 4096;
+
+  // Skip frames with no content (e.g. the gap in "\r\n" for kAnyNewline)
+  bool skip_empty = true;
+};
+
+// Counters since construction or the last Reset().
+struct LineFramerStats {
+  uint64_t bytes = 0;
+  uint64_t frames = 0;
+  uint64_t dropped_oversize = 0;
+  uint64_t dropped_no_prefix = 0;
+};
+
+// Splits raw serial reads into frames without per-byte work.
+//
+// Delimiters are found with SSE2 (or memchr) over the caller's buffer, and
+// frames that lie entirely inside it are handed out as views into that
+// buffer. Only a frame that straddles two reads is assembled in an internal
+// arena, which keeps its capacity between frames, so steady-state framing
+// does not allocate.
+class LineFramer {
+ public:
+  explicit LineFramer(LineFramerOptions options = LineFramerOptions());
+
+  // Feed one read's worth of bytes. |on_frame| is called with a
+  // std::string_view per complete frame, delimiters excluded; the view is
+  // only valid during the call.
+  template <typename Callback>
+  void Feed(const char* data, size_t size, Callback&& on_frame);
+
+  // Forget any partial frame
+  void Reset();
+
+  // Bytes of the current partial frame
+  size_t pending() const { return arena_.size(); }
+
+  const LineFramerStats& stats() const { return stats_; }
+  const LineFramerOptions& options() const { return options_; }
+
+ private:
+  // Finds the next frame end in [data, data + size). Returns its offset or
+  // |size| if there is none; |*delimiter_length| receives its length.
+  size_t FindEnd(const char* data, size_t size, size_t* delimiter_length) const;
+
+  // Applies prefix/empty/oversize rules; returns false if the frame is
+  // dropped, otherwise narrows |*frame| to the payload.
+  bool Accept(std::string_view* frame);
+
+  // Appends to the arena, dropping the frame once it grows too long
+  void AppendPartial(const char* data, size_t size);
+
+  LineFramerOptions options_;
+  LineFramerStats stats_;
+  std::string arena_;
+  bool oversize_ = false;
+};
+
+// Offset of the first CR or LF in [data, data + size), or |size|.
+size_t FindNewline(const char* data, size_t size);
+
+template <typename Callback>
+void LineFramer::Feed(const char* data, size_t size, Callback&& on_frame) {
+  stats_.bytes += size;
+  size_t delimiter_length = 0;
+
+  // Finish a frame carried over from earlier reads.
+  if (!arena_.empty() || oversize_) {
+    const size_t terminator_length = options_.terminator.size();
+    if (terminator_length > 1 && !arena_.empty()) {
+      // The terminator itself may straddle the two reads.
+      const size_t tail = std::min(terminator_length - 1, arena_.size());
+      std::string boundary = arena_.substr(arena_.size() - tail);
+      boundary.append(data, std::min(terminator_length - 1, size));
+      const size_t hit = boundary.find(options_.terminator);
+      if (hit != std::string::npos && hit < tail) {
+        arena_.resize(arena_.size() - tail + hit);
+        const size_t consumed = terminator_length - (tail - hit);
+        std::string_view frame(arena_);
+        if (!oversize_ && Accept(&frame)) {
+          on_frame(frame);
+        }
+        arena_.clear();
+        oversize_ = false;
+        data += consumed;
+        size -= consumed;
+      }
+    }
+    if (!arena_.empty() || oversize_) {
+      const size_t end = FindEnd(data, size, &delimiter_length);
+      AppendPartial(data, end);
+      if (end == size) {
+        return;
+      }
+      std::string_view frame(arena_);
+      if (!oversize_ && Accept(&frame)) {
+        on_frame(frame);
+      }
+      arena_.clear();
+      oversize_ = false;
+      data += end + delimiter_length;
+      size -= end + delimiter_length;
+    }
+  }
+
+  // Frames wholly inside this buffer are passed through without copying.
+  while (size > 0) {
+    const size_t end = FindEnd(data, size, &delimiter_length);
+    if (end == size) {
+      AppendPartial(data, size);
+      return;
+    }
+    std::string_view frame(data, end);
+    if (Accept(&frame)) {
+      on_frame(frame);
+    }
+    data += end + delimiter_length;
+    size -= end + delimiter_length;
+  }
+}
+
+#endif  // NATIVE_LINE_FRAMER_H_
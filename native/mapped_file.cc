@@ -0,0 +1,216 @@
+#include "native/mapped_file.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile()
+    : data_(nullptr), size_(0), file_(INVALID_HANDLE_VALUE), mapping_(nullptr) {}
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::Open(const std::string& path, size_t min_size) {
+  Close();
+  int wide_length =
+      MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+  std::wstring wide_path(static_cast<size_t>(wide_length), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide_path[0],
+                      wide_length);
+  HANDLE file = CreateFileW(wide_path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  file_ = file;
+  path_ = path;
+
+  LARGE_INTEGER current;
+  if (!GetFileSizeEx(file, &current)) {
+    Close();
+    return false;
+  }
+  size_t size = static_cast<size_t>(current.QuadPart);
+  if (size < min_size) {
+    size = min_size;
+  }
+  if (!Map(size)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool MappedFile::Map(size_t size) {
+  if (size == 0) {
+    return false;
+  }
+  // CreateFileMapping extends the file to the requested size with zeros.
+  const uint64_t size64 = size;
+  HANDLE mapping = CreateFileMappingW(
+      file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32),
+      static_cast<DWORD>(size64 & 0xffffffffu), nullptr);
+  if (mapping == nullptr) {
+    return false;
+  }
+  void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+  if (view == nullptr) {
+    CloseHandle(mapping);
+    return false;
+  }
+  mapping_ = mapping;
+  data_ = static_cast<uint8_t*>(view);
+  size_ = size;
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+    data_ = nullptr;
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+  size_ = 0;
+}
+
+void MappedFile::Close() {
+  Unmap();
+  if (file_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+  }
+  path_.clear();
+}
+
+bool MappedFile::Resize(size_t size) {
+  if (file_ == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  Unmap();
+  LARGE_INTEGER position;
+  position.QuadPart = static_cast<LONGLONG>(size);
+  if (!SetFilePointerEx(file_, position, nullptr, FILE_BEGIN) ||
+      !SetEndOfFile(file_)) {
+    return false;
+  }
+  return Map(size);
+}
+
+void MappedFile::Prefetch() {
+  // Touch one byte per page; there is no portable madvise equivalent.
+  volatile uint8_t sink = 0;
+  for (size_t offset = 0; offset < size_; offset += 4096) {
+    sink = sink + data_[offset];
+  }
+}
+
+bool MappedFile::Sync(bool wait) {
+  if (data_ == nullptr) {
+    return false;
+  }
+  if (!FlushViewOfFile(data_, size_)) {
+    return false;
+  }
+  return !wait || FlushFileBuffers(file_) != 0;
+}
+
+#else  // POSIX
+
+MappedFile::MappedFile() : data_(nullptr), size_(0), fd_(-1) {}
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::Open(const std::string& path, size_t min_size) {
+  Close();
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    return false;
+  }
+  path_ = path;
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    Close();
+    return false;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  if (size < min_size) {
+    if (ftruncate(fd_, static_cast<off_t>(min_size)) != 0) {
+      Close();
+      return false;
+    }
+    size = min_size;
+  }
+  if (!Map(size)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool MappedFile::Map(size_t size) {
+  if (size == 0) {
+    return false;
+  }
+  void* addr =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  data_ = static_cast<uint8_t*>(addr);
+  size_ = size;
+  return true;
+}
+
+void MappedFile::Unmap() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+  }
+  size_ = 0;
+}
+
+void MappedFile::Close() {
+  Unmap();
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  path_.clear();
+}
+
+bool MappedFile::Resize(size_t size) {
+  if (fd_ < 0) {
+    return false;
+  }
+  Unmap();
+  if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+    return false;
+  }
+  return Map(size);
+}
+
+void MappedFile::Prefetch() {
+  if (data_ != nullptr) {
+    madvise(data_, size_, MADV_WILLNEED);
+  }
+}
+
+bool MappedFile::Sync(bool wait) {
+  if (data_ == nullptr) {
+    return false;
+  }
+  return msync(data_, size_, wait ? MS_SYNC : MS_ASYNC) == 0;
+}
+
+#endif
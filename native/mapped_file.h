@@ -0,0 +1,58 @@
+#ifndef NATIVE_MAPPED_FILE_H_
+#define NATIVE_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A file mapped read/write into memory, shared with the page cache so that
+// writes persist without explicit I/O. Used by the on-disk caches; callers
+// lay out their own header and records inside data().
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Opens (creating if needed) |path| and maps it. A file shorter than
+  // |min_size| is extended with zeros first.
+  bool Open(const std::string& path, size_t min_size);
+
+  // Unmaps and closes the file.
+  void Close();
+
+  bool IsOpen() const { return data_ != nullptr; }
+
+  // Grows or shrinks the file to |size| bytes and remaps it. Pointers into
+  // the old mapping are invalid afterwards.
+  bool Resize(size_t size);
+
+  // Asks the kernel to read the whole mapping ahead (startup preload).
+  void Prefetch();
+
+  // Flushes dirty pages to disk. |wait| blocks until they are written.
+  bool Sync(bool wait);
+
+  uint8_t* data() { return data_; }
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string& path() const { return path_; }
+
+ private:
+  bool Map(size_t size);
+  void Unmap();
+
+  std::string path_;
+  uint8_t* data_;
+  size_t size_;
+#if defined(_WIN32)
+  void* file_;
+  void* mapping_;
+#else
+  int fd_;
+#endif
+};
+
+#endif  // NATIVE_MAPPED_FILE_H_
@@ -0,0 +1,375 @@
+#include "native/metrics_registry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+#include "native/file_io.h"
+
+namespace {
+
+// Threads take shard slots in turn on their first update
+std::atomic<uint32_t> next_thread_slot{0};
+thread_local uint32_t thread_slot = next_thread_slot.fetch_add(1);
+
+// Exact values below kSubBuckets; above, kSubBuckets / 2 buckets for each
+// power of two
+constexpr uint64_t kSubBuckets = 128;
+constexpr uint64_t kHalfSubBuckets = kSubBuckets / 2;
+
+int HighestBit(uint64_t value) {
+  int bit = 0;
+  for (int step = 32; step > 0; step /= 2) {
+    if (value >> step) {
+      value >>= step;
+      bit += step;
+    }
+  }
+  return bit;
+}
+
+void AppendEscapedLabelValue(std::string* out, std::string_view value) {
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (c == '\n') {
+      out->append("\\n");
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+void AppendHelpText(std::string* out, std::string_view help) {
+  for (char c : help) {
+    if (c == '\\') {
+      out->append("\\\\");
+    } else if (c == '\n') {
+      out->append("\\n");
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+// name{labels,extra} with the braces left out when both are empty
+void AppendSeries(std::string* out, std::string_view name,
+                  std::string_view labels, std::string_view extra = {}) {
+  out->append(name.data(), name.size());
+  if (labels.empty() && extra.empty()) {
+    return;
+  }
+  out->push_back('{');
+  out->append(labels.data(), labels.size());
+  if (!labels.empty() && !extra.empty()) {
+    out->push_back(',');
+  }
+  out->append(extra.data(), extra.size());
+  out->push_back('}');
+}
+
+void AppendSeconds(std::string* out, uint64_t us) {
+  char number[32];
+  std::snprintf(number, sizeof(number), " %.6f\n", us / 1e6);
+  out->append(number);
+}
+
+// Finds or adds the metric for |labels| in one of a family's maps
+template <typename Metric, typename Map>
+Metric& MetricOf(Map* metrics, std::string_view labels) {
+  auto found = metrics->find(labels);
+  if (found == metrics->end()) {
+    found = metrics->emplace(std::string(labels), std::make_unique<Metric>())
+                .first;
+  }
+  return *found->second;
+}
+
+}  // namespace
+
+void MetricCounter::Add(uint64_t n) {
+  shards_[thread_slot % kMetricShards].value.fetch_add(
+      n, std::memory_order_relaxed);
+}
+
+void MetricCounter::Mirror(uint64_t total) {
+  shards_[0].value.store(total, std::memory_order_relaxed);
+  for (size_t i = 1; i < kMetricShards; ++i) {
+    shards_[i].value.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t MetricCounter::Value() const {
+  uint64_t total = 0;
+  for (const Shard& shard : shards_) {
+    total += shard.value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+uint64_t HistogramSnapshot::ValueAtQuantile(double quantile) const {
+  uint64_t total = 0;
+  for (uint64_t n : buckets) {
+    total += n;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const double clamped = std::min(std::max(quantile, 0.0), 1.0);
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(clamped * total)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return std::min(LatencyHistogram::BucketUpperBound(i), max_us);
+    }
+  }
+  return max_us;
+}
+
+struct alignas(64) LatencyHistogram::Shard {
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> sum_us{0};
+  std::atomic<uint64_t> min_us{std::numeric_limits<uint64_t>::max()};
+  std::atomic<uint64_t> max_us{0};
+  std::atomic<uint64_t> buckets[kBucketCount] = {};
+};
+
+LatencyHistogram::LatencyHistogram() : shards_(new Shard[kShards]) {}
+
+LatencyHistogram::~LatencyHistogram() = default;
+
+size_t LatencyHistogram::BucketOf(uint64_t value_us) {
+  if (value_us < kSubBuckets) {
+    return static_cast<size_t>(value_us);
+  }
+  // value >> shift falls in [kHalfSubBuckets, kSubBuckets)
+  const int shift = HighestBit(value_us) - 6;
+  const size_t bucket =
+      static_cast<size_t>(kSubBuckets + (shift - 1) * kHalfSubBuckets +
+                          ((value_us >> shift) - kHalfSubBuckets));
+  return std::min(bucket, kBucketCount - 1);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  const uint64_t offset = bucket - kSubBuckets;
+  const int shift = static_cast<int>(offset / kHalfSubBuckets) + 1;
+  const uint64_t sub = offset % kHalfSubBuckets + kHalfSubBuckets;
+  return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(int64_t value_us) {
+  const uint64_t value = value_us > 0 ? static_cast<uint64_t>(value_us) : 0;
+  Shard& shard = shards_[thread_slot % kShards];
+  shard.buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+  shard.sum_us.fetch_add(value, std::memory_order_relaxed);
+  uint64_t low = shard.min_us.load(std::memory_order_relaxed);
+  while (value < low && !shard.min_us.compare_exchange_weak(
+                            low, value, std::memory_order_relaxed)) {
+  }
+  uint64_t high = shard.max_us.load(std::memory_order_relaxed);
+  while (value > high && !shard.max_us.compare_exchange_weak(
+                             high, value, std::memory_order_relaxed)) {
+  }
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const {
+  HistogramSnapshot snapshot;
+  snapshot.buckets.assign(kBucketCount, 0);
+  uint64_t low = std::numeric_limits<uint64_t>::max();
+  for (size_t s = 0; s < kShards; ++s) {
+    const Shard& shard = shards_[s];
+    snapshot.count += shard.count.load(std::memory_order_relaxed);
+    snapshot.sum_us += shard.sum_us.load(std::memory_order_relaxed);
+    low = std::min(low, shard.min_us.load(std::memory_order_relaxed));
+    snapshot.max_us =
+        std::max(snapshot.max_us, shard.max_us.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      snapshot.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+    }
+  }
+  snapshot.min_us = snapshot.count > 0 ? low : 0;
+  return snapshot;
+}
+
+struct MetricsRegistry::Family {
+  Kind kind;
+  std::string help;
+  // By label set; only the map of |kind| is used
+  std::map<std::string, std::unique_ptr<MetricCounter>, std::less<>> counters;
+  std::map<std::string, std::unique_ptr<MetricGauge>, std::less<>> gauges;
+  std::map<std::string, std::unique_ptr<LatencyHistogram>, std::less<>>
+      histograms;
+};
+
+MetricsRegistry::MetricsRegistry() = default;
+
+MetricsRegistry::~MetricsRegistry() = default;
+
+MetricsRegistry::Family* MetricsRegistry::FamilyOf(std::string_view name,
+                                                   Kind kind,
+                                                   std::string_view help) {
+  auto found = families_.find(name);
+  if (found == families_.end()) {
+    auto family = std::make_unique<Family>();
+    family->kind = kind;
+    family->help.assign(help.data(), help.size());
+    found = families_.emplace(std::string(name), std::move(family)).first;
+  } else if (found->second->help.empty()) {
+    found->second->help.assign(help.data(), help.size());
+  }
+  if (found->second->kind != kind) {
+    mismatched_.push_back(std::make_unique<Family>());
+    mismatched_.back()->kind = kind;
+    return mismatched_.back().get();
+  }
+  return found->second.get();
+}
+
+MetricCounter& MetricsRegistry::GetCounter(std::string_view name,
+                                           std::string_view labels,
+                                           std::string_view help) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return MetricOf<MetricCounter>(
+      &FamilyOf(name, Kind::kCounter, help)->counters, labels);
+}
+
+MetricGauge& MetricsRegistry::GetGauge(std::string_view name,
+                                       std::string_view labels,
+                                       std::string_view help) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return MetricOf<MetricGauge>(&FamilyOf(name, Kind::kGauge, help)->gauges,
+                               labels);
+}
+
+LatencyHistogram& MetricsRegistry::GetHistogram(std::string_view name,
+                                                std::string_view labels,
+                                                std::string_view help) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return MetricOf<LatencyHistogram>(
+      &FamilyOf(name, Kind::kHistogram, help)->histograms, labels);
+}
+
+std::string MetricsRegistry::ToPrometheusText() {
+  static const char* const kKindNames[] = {"counter", "gauge", "summary"};
+  static const struct {
+    double quantile;
+    const char* label;
+  } kQuantiles[] = {{0.5, "quantile=\"0.5\""},
+                    {0.9, "quantile=\"0.9\""},
+                    {0.99, "quantile=\"0.99\""},
+                    {0.999, "quantile=\"0.999\""}};
+
+  std::string out;
+  char number[32];
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : families_) {
+    const std::string& name = entry.first;
+    const Family& family = *entry.second;
+    if (!family.help.empty()) {
+      out.append("# HELP ").append(name).push_back(' ');
+      AppendHelpText(&out, family.help);
+      out.push_back('\n');
+    }
+    out.append("# TYPE ").append(name).push_back(' ');
+    out.append(kKindNames[static_cast<int>(family.kind)]).push_back('\n');
+    for (const auto& counter : family.counters) {
+      AppendSeries(&out, name, counter.first);
+      std::snprintf(number, sizeof(number), " %" PRIu64 "\n",
+                    counter.second->Value());
+      out.append(number);
+    }
+    for (const auto& gauge : family.gauges) {
+      AppendSeries(&out, name, gauge.first);
+      std::snprintf(number, sizeof(number), " %" PRId64 "\n",
+                    gauge.second->Value());
+      out.append(number);
+    }
+    for (const auto& histogram : family.histograms) {
+      const HistogramSnapshot snapshot = histogram.second->Snapshot();
+      for (const auto& quantile : kQuantiles) {
+        AppendSeries(&out, name, histogram.first, quantile.label);
+        AppendSeconds(&out, snapshot.ValueAtQuantile(quantile.quantile));
+      }
+      AppendSeries(&out, name + "_sum", histogram.first);
+      AppendSeconds(&out, snapshot.sum_us);
+      AppendSeries(&out, name + "_count", histogram.first);
+      std::snprintf(number, sizeof(number), " %" PRIu64 "\n", snapshot.count);
+      out.append(number);
+    }
+  }
+  return out;
+}
+
+bool MetricsRegistry::WriteFile(const std::string& path) {
+  const std::string text = ToPrometheusText();
+  // The textfile collectors only read *.prom, so the partial file is not
+  // picked up.
+  const std::string temporary = path + ".tmp";
+  const int fd = OpenDataFile(temporary);
+  if (fd < 0) {
+    return false;
+  }
+  const bool ok =
+      TruncateDataFile(fd, 0) && WriteAll(fd, text.data(), text.size());
+  CloseDataFile(fd);
+  return ok && ReplaceDataFile(temporary, path);
+}
+
+std::string MetricLabel(std::string_view key, std::string_view value) {
+  std::string label(key.data(), key.size());
+  label.append("=\"");
+  AppendEscapedLabelValue(&label, value);
+  label.push_back('"');
+  return label;
+}
+
+MetricsRegistry& ProcessMetrics() {
+  static MetricsRegistry* registry = new MetricsRegistry();
+  return *registry;
+}
+
+MetricsFileWriter::MetricsFileWriter(MetricsRegistry* registry,
+                                     std::string path, int interval_ms)
+    : registry_(registry),
+      path_(std::move(path)),
+      interval_ms_(std::max(interval_ms, 100)),
+      thread_([this] { Run(); }) {}
+
+MetricsFileWriter::~MetricsFileWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+  WriteOnce();
+}
+
+void MetricsFileWriter::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    lock.unlock();
+    WriteOnce();
+    lock.lock();
+    wake_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                   [this] { return stop_; });
+  }
+}
+
+void MetricsFileWriter::WriteOnce() {
+  if (registry_->WriteFile(path_)) {
+    writes_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    failures_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
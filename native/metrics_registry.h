@@ -0,0 +1,189 @@
+#ifndef NATIVE_METRICS_REGISTRY_H_
+#define NATIVE_METRICS_REGISTRY_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Updates of one metric are spread over this many cache lines, picked by
+// thread, so the serial, speech, gateway and UI threads do not contend.
+constexpr size_t kMetricShards = 8;
+
+// Monotonic count of events or bytes.
+class MetricCounter {
+ public:
+  void Add(uint64_t n = 1);
+  // Makes the count |total|, for a counter that mirrors a running total
+  // kept elsewhere (a stats struct). A lower total, after that source was
+  // reset, reads as a counter reset to Prometheus. Not mixed with Add().
+  void Mirror(uint64_t total);
+  uint64_t Value() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value{0};
+  };
+  Shard shards_[kMetricShards];
+};
+
+// A level that goes up and down: queue depth, open ports, cache bytes.
+class MetricGauge {
+ public:
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t delta) {
+    value_.fetch_add(delta, std::memory_order_relaxed);
+  }
+  int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+// Microsecond values of a LatencyHistogram, merged over its shards.
+struct HistogramSnapshot {
+  uint64_t count = 0;
+  uint64_t sum_us = 0;
+  uint64_t min_us = 0;
+  uint64_t max_us = 0;
+  // Per bucket of LatencyHistogram
+  std::vector<uint64_t> buckets;
+
+  // The value below which |quantile| (0..1) of the recorded values fall,
+  // within the bucket resolution and never above max_us.
+  uint64_t ValueAtQuantile(double quantile) const;
+};
+
+// Latencies in microseconds, in log-linear buckets the way HdrHistogram
+// lays them out: exact below 128 us, then 64 buckets per power of two, so
+// every bucket is within 1.6% of its values up to ~19 hours (larger values
+// land in the last bucket). Record() is a few relaxed atomic adds on the
+// calling thread's shard: no lock and no allocation.
+class LatencyHistogram {
+ public:
+  static constexpr size_t kBucketCount = 1984;
+
+  LatencyHistogram();
+  ~LatencyHistogram();
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  // Negative values are recorded as 0.
+  void Record(int64_t value_us);
+
+  HistogramSnapshot Snapshot() const;
+
+  static size_t BucketOf(uint64_t value_us);
+  // The largest value that falls into |bucket|
+  static uint64_t BucketUpperBound(size_t bucket);
+
+ private:
+  static constexpr size_t kShards = 4;
+  struct Shard;
+
+  std::unique_ptr<Shard[]> shards_;
+};
+
+// Counters, gauges and latency histograms by name and labels, exported in
+// the Prometheus text format for node_exporter's textfile collector (or
+// windows_exporter's), so the numbers of every pharmacy can be scraped
+// without a network service in the app.
+//
+// The Get* lookups take a lock; the returned references stay valid for the
+// registry's lifetime, so hot paths look a metric up once and keep it.
+//
+//   static MetricCounter& lines = ProcessMetrics().GetCounter(
+//       "pharm_serial_lines_total", MetricLabel("port", "comport"),
+//       "Lines framed by the serial readers");
+//   lines.Add();
+class MetricsRegistry {
+ public:
+  MetricsRegistry();
+  ~MetricsRegistry();
+
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  // |labels| is empty or in exposition form, such as
+  // MetricLabel("function", "get_rx"). |help| is kept from the first
+  // lookup of |name|. A name belongs to one kind of metric; looking it up
+  // as another kind returns a metric that is not exported.
+  MetricCounter& GetCounter(std::string_view name, std::string_view labels = {},
+                            std::string_view help = {});
+  MetricGauge& GetGauge(std::string_view name, std::string_view labels = {},
+                        std::string_view help = {});
+  // Exported as a summary in seconds: the 0.5, 0.9, 0.99 and 0.999
+  // quantiles since start, _sum and _count.
+  LatencyHistogram& GetHistogram(std::string_view name,
+                                 std::string_view labels = {},
+                                 std::string_view help = {});
+
+  // The exposition text, families sorted by name
+  std::string ToPrometheusText();
+
+  // Writes ToPrometheusText() to |path| through a temporary file, so a
+  // scrape never reads half a file. Returns false on failure.
+  bool WriteFile(const std::string& path);
+
+ private:
+  enum class Kind { kCounter, kGauge, kHistogram };
+  struct Family;
+
+  Family* FamilyOf(std::string_view name, Kind kind, std::string_view help);
+
+  std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<Family>, std::less<>> families_;
+  // Metrics looked up under a name of another kind
+  std::vector<std::unique_ptr<Family>> mismatched_;
+};
+
+// key="value", with the value escaped for the exposition format. Joined
+// with commas for several labels.
+std::string MetricLabel(std::string_view key, std::string_view value);
+
+// The registry of this process (of this copy of the library)
+MetricsRegistry& ProcessMetrics();
+
+// Writes a registry to a file every |interval_ms| on its own thread, and
+// once more when destroyed.
+class MetricsFileWriter {
+ public:
+  MetricsFileWriter(MetricsRegistry* registry, std::string path,
+                    int interval_ms);
+  ~MetricsFileWriter();
+
+  MetricsFileWriter(const MetricsFileWriter&) = delete;
+  MetricsFileWriter& operator=(const MetricsFileWriter&) = delete;
+
+  const std::string& path() const { return path_; }
+  uint64_t writes() const { return writes_.load(std::memory_order_relaxed); }
+  uint64_t failures() const {
+    return failures_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void Run();
+  void WriteOnce();
+
+  MetricsRegistry* const registry_;
+  const std::string path_;
+  const int interval_ms_;
+  std::atomic<uint64_t> writes_{0};
+  std::atomic<uint64_t> failures_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+#endif  // NATIVE_METRICS_REGISTRY_H_
@@ -0,0 +1,313 @@
+#include "native/name_index.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t kSyllableFirst = 0xAC00;
+constexpr uint32_t kSyllableLast = 0xD7A3;
+// Syllables per initial+medial pair
+constexpr uint32_t kFinals = 28;
+constexpr uint32_t kReplacement = 0xFFFD;
+
+// Compatibility jamo of the 19 initials, in syllable order
+constexpr uint32_t kInitialJamo[19] = {
+    0x3131, 0x3132, 0x3134, 0x3137, 0x3138, 0x3139, 0x3141,
+    0x3142, 0x3143, 0x3145, 0x3146, 0x3147, 0x3148, 0x3149,
+    0x314A, 0x314B, 0x314C, 0x314D, 0x314E,
+};
+
+// What an IME does with a final when the next vowel arrives: |stay| is the
+// final left on the syllable, |moves| the initial (as compatibility jamo)
+// that starts the next one.
+struct FinalSplit {
+  uint8_t stay;
+  uint32_t moves;
+};
+constexpr FinalSplit kFinalSplit[kFinals] = {
+    {0, 0},        // none
+    {0, 0x3131},   // ㄱ
+    {0, 0x3132},   // ㄲ
+    {1, 0x3145},   // ㄳ
+    {0, 0x3134},   // ㄴ
+    {4, 0x3148},   // ㄵ
+    {4, 0x314E},   // ㄶ
+    {0, 0x3137},   // ㄷ
+    {0, 0x3139},   // ㄹ
+    {8, 0x3131},   // ㄺ
+    {8, 0x3141},   // ㄻ
+    {8, 0x3142},   // ㄼ
+    {8, 0x3145},   // ㄽ
+    {8, 0x314C},   // ㄾ
+    {8, 0x314D},   // ㄿ
+    {8, 0x314E},   // ㅀ
+    {0, 0x3141},   // ㅁ
+    {0, 0x3142},   // ㅂ
+    {17, 0x3145},  // ㅄ
+    {0, 0x3145},   // ㅅ
+    {0, 0x3146},   // ㅆ
+    {0, 0x3147},   // ㅇ
+    {0, 0x3148},   // ㅈ
+    {0, 0x314A},   // ㅊ
+    {0, 0x314B},   // ㅋ
+    {0, 0x314C},   // ㅌ
+    {0, 0x314D},   // ㅍ
+    {0, 0x314E},   // ㅎ
+};
+
+bool IsSyllable(uint32_t c) {
+  return c >= kSyllableFirst && c <= kSyllableLast;
+}
+
+bool IsInitialJamo(uint32_t c) {
+  return std::find(std::begin(kInitialJamo), std::end(kInitialJamo), c) !=
+         std::end(kInitialJamo);
+}
+
+// A syllable's initial as compatibility jamo; anything else is itself.
+uint32_t InitialOf(uint32_t c) {
+  if (!IsSyllable(c)) {
+    return c;
+  }
+  return kInitialJamo[(c - kSyllableFirst) / (21 * kFinals)];
+}
+
+bool IsSpace(uint32_t c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == 0x3000;
+}
+
+// Code points of |text| without whitespace or control characters, ASCII
+// lowercased. Malformed UTF-8 reads as U+FFFD.
+std::vector<uint32_t> Normalize(std::string_view text) {
+  std::vector<uint32_t> out;
+  out.reserve(text.size());
+  size_t i = 0;
+  while (i < text.size()) {
+    const uint8_t lead = static_cast<uint8_t>(text[i]);
+    uint32_t c = lead;
+    size_t extra = 0;
+    if (lead >= 0xF0 && lead < 0xF8) {
+      c = lead & 0x07;
+      extra = 3;
+    } else if (lead >= 0xE0) {
+      c = lead & 0x0F;
+      extra = 2;
+    } else if (lead >= 0xC0) {
+      c = lead & 0x1F;
+      extra = 1;
+    } else if (lead >= 0x80) {
+      c = kReplacement;
+    }
+    ++i;
+    for (size_t k = 0; k < extra; ++k, ++i) {
+      if (i >= text.size() || (static_cast<uint8_t>(text[i]) & 0xC0) != 0x80) {
+        c = kReplacement;
+        break;
+      }
+      c = (c << 6) | (static_cast<uint8_t>(text[i]) & 0x3F);
+    }
+    if (c < 0x20 || IsSpace(c)) {
+      continue;
+    }
+    if (c >= 'A' && c <= 'Z') {
+      c += 'a' - 'A';
+    }
+    out.push_back(c);
+  }
+  return out;
+}
+
+// Whether field character |c|, followed by |next| (0 at the end), satisfies
+// query character |q|, given that their initials are equal. |last| is true
+// for the query's final character, which may be half typed. Sets |*exact|
+// when |c| is |q| itself.
+bool CharMatches(uint32_t q, uint32_t c, uint32_t next, bool last,
+                 bool* exact) {
+  *exact = q == c;
+  if (*exact || IsInitialJamo(q)) {
+    return true;
+  }
+  if (!last || !IsSyllable(q) || !IsSyllable(c)) {
+    return false;
+  }
+  const uint32_t qs = q - kSyllableFirst;
+  const uint32_t cs = c - kSyllableFirst;
+  if (qs / kFinals != cs / kFinals) {
+    return false;
+  }
+  const uint32_t q_final = qs % kFinals;
+  const uint32_t c_final = cs % kFinals;
+  // 미 -> 민, 달 -> 닭
+  if (q_final == 0 || kFinalSplit[c_final].stay == q_final) {
+    return true;
+  }
+  // 김 -> 기|미, 닭 -> 달|기
+  return c_final == kFinalSplit[q_final].stay &&
+         InitialOf(next) == kFinalSplit[q_final].moves;
+}
+
+uint64_t Gram(uint32_t a, uint32_t b) {
+  return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+// How good a match is; larger compares better in every member but length
+// and id.
+struct Match {
+  // 3 whole field, 2 prefix, 1 infix
+  uint8_t kind;
+  uint8_t is_name;
+  uint16_t exact;
+  uint32_t length;
+  uint32_t id;
+};
+
+bool Better(const Match& a, const Match& b) {
+  if (a.kind != b.kind) return a.kind > b.kind;
+  if (a.exact != b.exact) return a.exact > b.exact;
+  if (a.is_name != b.is_name) return a.is_name > b.is_name;
+  if (a.length != b.length) return a.length < b.length;
+  return a.id < b.id;
+}
+
+}  // namespace
+
+NameIndex::NameIndex() = default;
+
+void NameIndex::Clear() {
+  chars_.clear();
+  initials_.clear();
+  fields_.clear();
+  entries_.clear();
+  postings_.clear();
+}
+
+void NameIndex::Reserve(size_t entries) {
+  entries_.reserve(entries);
+  fields_.reserve(entries * 4);
+  chars_.reserve(entries * 24);
+  initials_.reserve(entries * 24);
+}
+
+uint32_t NameIndex::Add(std::string_view name, std::string_view numbers) {
+  const uint32_t id = static_cast<uint32_t>(entries_.size());
+  entries_.push_back(Entry{static_cast<uint32_t>(fields_.size()), 0});
+  AddField(id, Normalize(name), true);
+  size_t start = 0;
+  while (start < numbers.size()) {
+    size_t end = numbers.find(' ', start);
+    if (end == std::string_view::npos) {
+      end = numbers.size();
+    }
+    AddField(id, Normalize(numbers.substr(start, end - start)), false);
+    start = end + 1;
+  }
+  return id;
+}
+
+void NameIndex::AddField(uint32_t id, const std::vector<uint32_t>& chars,
+                         bool is_name) {
+  if (chars.empty()) {
+    return;
+  }
+  const uint32_t begin = static_cast<uint32_t>(chars_.size());
+  for (size_t i = 0; i < chars.size(); ++i) {
+    chars_.push_back(chars[i]);
+    initials_.push_back(InitialOf(chars[i]));
+    Post(Gram(initials_.back(), 0), id);
+    if (i > 0) {
+      Post(Gram(initials_[begin + i - 1], initials_.back()), id);
+    }
+  }
+  fields_.push_back(
+      Field{begin, static_cast<uint32_t>(chars.size()), is_name});
+  ++entries_[id].field_count;
+}
+
+void NameIndex::Post(uint64_t gram, uint32_t id) {
+  std::vector<uint32_t>& ids = postings_[gram];
+  if (ids.empty() || ids.back() != id) {
+    ids.push_back(id);
+  }
+}
+
+size_t NameIndex::Search(std::string_view query, uint32_t* ids,
+                         size_t capacity) const {
+  const std::vector<uint32_t> q = Normalize(query);
+  if (q.empty()) {
+    return 0;
+  }
+  std::vector<uint32_t> q_initials(q.size());
+  std::transform(q.begin(), q.end(), q_initials.begin(), InitialOf);
+
+  // Shortest postings list among the query's grams
+  const std::vector<uint32_t>* candidates = nullptr;
+  const size_t grams = q.size() == 1 ? 1 : q.size() - 1;
+  for (size_t i = 0; i < grams; ++i) {
+    const uint64_t gram = q.size() == 1
+                              ? Gram(q_initials[0], 0)
+                              : Gram(q_initials[i], q_initials[i + 1]);
+    auto it = postings_.find(gram);
+    if (it == postings_.end()) {
+      return 0;
+    }
+    if (candidates == nullptr || it->second.size() < candidates->size()) {
+      candidates = &it->second;
+    }
+  }
+
+  std::vector<Match> matches;
+  matches.reserve(candidates->size());
+  for (uint32_t id : *candidates) {
+    const Entry& entry = entries_[id];
+    bool found = false;
+    Match best{};
+    for (uint32_t f = 0; f < entry.field_count; ++f) {
+      const Field& field = fields_[entry.first_field + f];
+      if (field.length < q.size()) {
+        continue;
+      }
+      const uint32_t* chars = chars_.data() + field.begin;
+      const uint32_t* initials = initials_.data() + field.begin;
+      for (size_t p = 0; p + q.size() <= field.length; ++p) {
+        // Equal initials are necessary and cheap to compare
+        if (!std::equal(q_initials.begin(), q_initials.end(), initials + p)) {
+          continue;
+        }
+        uint16_t exact = 0;
+        bool ok = true;
+        for (size_t i = 0; i < q.size() && ok; ++i) {
+          const size_t at = p + i;
+          const uint32_t next = at + 1 < field.length ? chars[at + 1] : 0;
+          bool same = false;
+          ok = CharMatches(q[i], chars[at], next, i + 1 == q.size(), &same);
+          exact += same;
+        }
+        if (!ok) {
+          continue;
+        }
+        const uint8_t kind =
+            p > 0 ? 1 : (q.size() == field.length ? 3 : 2);
+        const Match match{kind, field.is_name, exact, field.length, id};
+        if (!found || Better(match, best)) {
+          best = match;
+          found = true;
+        }
+        // Later positions of this field are infixes that can at best tie
+        if (p == 0 || exact == q.size()) {
+          break;
+        }
+      }
+    }
+    if (found) {
+      matches.push_back(best);
+    }
+  }
+
+  const size_t n = std::min(capacity, matches.size());
+  std::partial_sort(matches.begin(), matches.begin() + n, matches.end(),
+                    Better);
+  for (size_t i = 0; i < n; ++i) {
+    ids[i] = matches[i].id;
+  }
+  return matches.size();
+}
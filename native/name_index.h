@@ -0,0 +1,70 @@
+#ifndef NATIVE_NAME_INDEX_H_
+#define NATIVE_NAME_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Type-ahead search over the patients of the loaded days, so the name field
+// narrows the list on every keystroke without asking the server.
+//
+// Each entry is a patient name plus a few numbers (receipt no., birth date,
+// tfn), all UTF-8. A query matches a substring of the name or of one number:
+//   - a Hangul syllable matches itself;
+//   - a compatibility consonant (ㄱ..ㅎ) matches any syllable that starts
+//     with it, so "ㄱㅁㅅ" finds 김민수;
+//   - the last syllable may be half typed, as an IME shows it: "김미" finds
+//     김민수, and "김" finds 기미 (its final is the next initial);
+//   - anything else matches itself, ASCII case-insensitively.
+// Whitespace in names and queries is ignored.
+//
+// Candidates come from postings of the query's initial bigrams (a
+// syllable counts as its initial), taking the shortest list; each candidate
+// is then checked against the rules above. Results rank whole matches over
+// prefixes over infixes, then by how many syllables matched exactly, names
+// over numbers, shorter fields, and insertion order.
+class NameIndex {
+ public:
+  NameIndex();
+
+  void Clear();
+  void Reserve(size_t entries);
+
+  // Appends an entry and returns its id, the number of entries before it.
+  // |numbers| holds space-separated fields.
+  uint32_t Add(std::string_view name, std::string_view numbers);
+
+  // Writes the best |capacity| matches of |query| to |ids|, best first.
+  // Returns the number of matching entries, which may exceed |capacity|.
+  size_t Search(std::string_view query, uint32_t* ids,
+                size_t capacity) const;
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Field {
+    uint32_t begin;
+    uint32_t length;
+    bool is_name;
+  };
+  struct Entry {
+    uint32_t first_field;
+    uint32_t field_count;
+  };
+
+  void AddField(uint32_t id, const std::vector<uint32_t>& chars,
+                bool is_name);
+  void Post(uint64_t gram, uint32_t id);
+
+  // Code points of all fields, back to back, and the initial of each
+  std::vector<uint32_t> chars_;
+  std::vector<uint32_t> initials_;
+  std::vector<Field> fields_;
+  std::vector<Entry> entries_;
+  // Unigram and bigram of initials -> ids in ascending order
+  std::unordered_map<uint64_t, std::vector<uint32_t>> postings_;
+};
+
+#endif  // NATIVE_NAME_INDEX_H_
@@ -0,0 +1,176 @@
+#include "native/recipe_index.h"
+
+namespace {
+
+constexpr size_t kTypeEDigits = 12;
+constexpr size_t kOtherDigits = 11;
+constexpr size_t kInitialSlots = 64;
+
+size_t HashKey(uint64_t key) {
+  // splitmix64 finalizer; the keys themselves are sequential-ish GTINs.
+  key ^= key >> 30;
+  key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 27;
+  key *= 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+  return static_cast<size_t>(key);
+}
+
+}  // namespace
+
+RecipeIndex::RecipeIndex() : slots_(kInitialSlots, Slot{0, kNoRow, kNoRow}) {}
+
+void RecipeIndex::Clear() {
+  slots_.assign(kInitialSlots, Slot{0, kNoRow, kNoRow});
+  used_slots_ = 0;
+  next_.clear();
+  complete_.clear();
+}
+
+void RecipeIndex::Reserve(size_t rows) {
+  next_.reserve(rows);
+  complete_.reserve(rows);
+  while (slots_.size() < rows * 2) {
+    Grow();
+  }
+}
+
+uint64_t RecipeIndex::MakeKey(std::string_view code, size_t digits,
+                              bool type_e) {
+  if (code.size() < digits) {
+    return 0;
+  }
+  uint64_t value = 0;
+  for (size_t i = 0; i < digits; ++i) {
+    const unsigned digit = static_cast<unsigned char>(code[i]) - '0';
+    if (digit > 9) {
+      return 0;
+    }
+    value = value * 10 + digit;
+  }
+  // Both prefix kinds share the table; the low bit keeps them apart and the
+  // +1 keeps every valid key non-zero.
+  return ((value << 1) | (type_e ? 1 : 0)) + 1;
+}
+
+const RecipeIndex::Slot* RecipeIndex::Find(uint64_t key) const {
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = HashKey(key) & mask;; i = (i + 1) & mask) {
+    const Slot& slot = slots_[i];
+    if (slot.key == key) {
+      return &slot;
+    }
+    if (slot.key == 0) {
+      return nullptr;
+    }
+  }
+}
+
+RecipeIndex::Slot* RecipeIndex::FindOrInsert(uint64_t key) {
+  if ((used_slots_ + 1) * 2 > slots_.size()) {
+    Grow();
+  }
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = HashKey(key) & mask;; i = (i + 1) & mask) {
+    Slot& slot = slots_[i];
+    if (slot.key == key) {
+      return &slot;
+    }
+    if (slot.key == 0) {
+      slot.key = key;
+      ++used_slots_;
+      return &slot;
+    }
+  }
+}
+
+void RecipeIndex::Grow() {
+  std::vector<Slot> old(slots_.size() * 2, Slot{0, kNoRow, kNoRow});
+  old.swap(slots_);
+  const size_t mask = slots_.size() - 1;
+  for (const Slot& slot : old) {
+    if (slot.key == 0) {
+      continue;
+    }
+    size_t i = HashKey(slot.key) & mask;
+    while (slots_[i].key != 0) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = slot;
+  }
+}
+
+uint32_t RecipeIndex::AddRow(std::string_view pack_barcode, char type,
+                             bool complete) {
+  const uint32_t row = static_cast<uint32_t>(next_.size());
+  next_.push_back(kNoRow);
+  complete_.push_back(complete ? 1 : 0);
+
+  const bool type_e = type == 'E' || type == 'e';
+  const uint64_t key =
+      MakeKey(pack_barcode, type_e ? kTypeEDigits : kOtherDigits, type_e);
+  if (key != 0) {
+    Slot* slot = FindOrInsert(key);
+    if (slot->head == kNoRow) {
+      slot->head = row;
+    } else {
+      next_[slot->tail] = row;
+    }
+    slot->tail = row;
+  }
+  return row;
+}
+
+void RecipeIndex::SetComplete(uint32_t row, bool complete) {
+  if (row < complete_.size()) {
+    complete_[row] = complete ? 1 : 0;
+  }
+}
+
+template <typename Fn>
+void RecipeIndex::ForEachCandidate(std::string_view barcode, Fn fn) const {
+  const Slot* e_slot = Find(MakeKey(barcode, kTypeEDigits, true));
+  const Slot* other_slot = Find(MakeKey(barcode, kOtherDigits, false));
+  uint32_t e_row = e_slot != nullptr ? e_slot->head : kNoRow;
+  uint32_t other_row = other_slot != nullptr ? other_slot->head : kNoRow;
+  // kNoRow is the largest uint32_t, so an exhausted chain sorts last.
+  while (e_row != kNoRow || other_row != kNoRow) {
+    if (e_row < other_row) {
+      fn(e_row);
+      e_row = next_[e_row];
+    } else {
+      fn(other_row);
+      other_row = next_[other_row];
+    }
+  }
+}
+
+size_t RecipeIndex::Lookup(std::string_view barcode, uint32_t* rows,
+                           size_t capacity) const {
+  size_t count = 0;
+  for (int pass_complete = 0; pass_complete < 2; ++pass_complete) {
+    ForEachCandidate(barcode, [&](uint32_t row) {
+      if (complete_[row] == pass_complete) {
+        if (count < capacity) {
+          rows[count] = row;
+        }
+        ++count;
+      }
+    });
+  }
+  return count;
+}
+
+uint32_t RecipeIndex::Best(std::string_view barcode) const {
+  uint32_t first = kNoRow;
+  uint32_t first_incomplete = kNoRow;
+  ForEachCandidate(barcode, [&](uint32_t row) {
+    if (first == kNoRow) {
+      first = row;
+    }
+    if (first_incomplete == kNoRow && complete_[row] == 0) {
+      first_incomplete = row;
+    }
+  });
+  return first_incomplete != kNoRow ? first_incomplete : first;
+}
@@ -0,0 +1,76 @@
+#ifndef NATIVE_RECIPE_INDEX_H_
+#define NATIVE_RECIPE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Maps a scanned pack barcode to the prescription rows it can check off.
+//
+// The match rule is the one handleBarcode applied with a linear scan: rows of
+// type 'E' match on the first 12 digits of their pack_barcode, all other rows
+// on the first 11. Each (type, prefix) key is one slot of an open-addressing
+// table whose rows are chained in row order, so a lookup is two probes plus a
+// walk of the (short) candidate chains, and never allocates.
+//
+// Pack barcodes are numeric GTINs; a row whose prefix contains anything but
+// digits is kept (its row id stays valid) but never matches.
+class RecipeIndex {
+ public:
+  static constexpr uint32_t kNoRow = UINT32_MAX;
+
+  RecipeIndex();
+
+  // Drops all rows.
+  void Clear();
+
+  // Reserves room for |rows| rows.
+  void Reserve(size_t rows);
+
+  // Appends a row and returns its id, which is the number of rows added
+  // before it.
+  uint32_t AddRow(std::string_view pack_barcode, char type, bool complete);
+
+  // Marks |row| complete (checked_amount >= total) or not.
+  void SetComplete(uint32_t row, bool complete);
+
+  // Writes the rows matching |barcode| to |rows|, incomplete rows first and
+  // otherwise in row order, up to |capacity| of them. Returns the number of
+  // matching rows, which may exceed |capacity|.
+  size_t Lookup(std::string_view barcode, uint32_t* rows,
+                size_t capacity) const;
+
+  // First row Lookup() would return, or kNoRow.
+  uint32_t Best(std::string_view barcode) const;
+
+  size_t size() const { return next_.size(); }
+
+ private:
+  struct Slot {
+    // 0 marks an empty slot
+    uint64_t key;
+    uint32_t head;
+    uint32_t tail;
+  };
+
+  // Table key of the first |digits| characters of |code|, or 0 if they are
+  // not all digits.
+  static uint64_t MakeKey(std::string_view code, size_t digits, bool type_e);
+
+  const Slot* Find(uint64_t key) const;
+  Slot* FindOrInsert(uint64_t key);
+  void Grow();
+
+  // Calls |fn| for the rows of both candidate chains in row order.
+  template <typename Fn>
+  void ForEachCandidate(std::string_view barcode, Fn fn) const;
+
+  std::vector<Slot> slots_;
+  size_t used_slots_ = 0;
+  // Per row: next row with the same key, or kNoRow
+  std::vector<uint32_t> next_;
+  std::vector<uint8_t> complete_;
+};
+
+#endif  // NATIVE_RECIPE_INDEX_H_
@@ -0,0 +1,323 @@
+#include "native/recipe_store.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "native/field_text.h"
+
+namespace {
+
+struct FieldAlias {
+  std::string_view key;
+  RecipeColumn column;
+  int32_t rank;
+};
+
+// The keys main_screen looked up with '??' chains, in the same order. The
+// Korean ones (용량, 횟수, 일수, 약품명) are spelled as UTF-8 escapes so the
+// source compiles the same without /utf-8.
+constexpr FieldAlias kFieldAliases[] = {
+    {"rxrecipe_id", RecipeColumn::kRxrecipeId, 0},
+    {"rxRecipeID", RecipeColumn::kRxrecipeId, 1},
+    {"RxRecipeId", RecipeColumn::kRxrecipeId, 2},
+    {"checked_amount", RecipeColumn::kChecked, 0},
+    {"Checked", RecipeColumn::kChecked, 1},
+    {"separate", RecipeColumn::kSeparation, 0},
+    {"seperate", RecipeColumn::kSeparation, 1},
+    {"recipe_order", RecipeColumn::kRecipeOrder, 0},
+    {"total", RecipeColumn::kTotal, 0},
+    {"Total", RecipeColumn::kTotal, 1},
+    {"dose", RecipeColumn::kDose, 0},
+    {"\xec\x9a\xa9\xeb\x9f\x89", RecipeColumn::kDose, 1},
+    {"times", RecipeColumn::kTimes, 0},
+    {"\xed\x9a\x9f\xec\x88\x98", RecipeColumn::kTimes, 1},
+    {"days", RecipeColumn::kDays, 0},
+    {"\xec\x9d\xbc\xec\x88\x98", RecipeColumn::kDays, 1},
+    {"morning", RecipeColumn::kMorning, 0},
+    {"afternoon", RecipeColumn::kAfternoon, 0},
+    {"evening", RecipeColumn::kEvening, 0},
+    {"night", RecipeColumn::kNight, 0},
+    {"type", RecipeColumn::kType, 0},
+    {"T", RecipeColumn::kType, 1},
+    {"typeCode", RecipeColumn::kType, 2},
+    {"use", RecipeColumn::kUse, 0},
+    {"is_atc", RecipeColumn::kAtc, 0},
+    {"product_name", RecipeColumn::kProductName, 0},
+    {"\xec\x95\xbd\xed\x92\x88\xeb\xaa\x85", RecipeColumn::kProductName, 1},
+    {"name", RecipeColumn::kProductName, 2},
+    {"pack_barcode", RecipeColumn::kPackBarcode, 0},
+    {"location", RecipeColumn::kLocation, 0},
+};
+
+// |value|, already whole, saturated to T
+template <typename T>
+T Saturate(double value) {
+  if (!std::isfinite(value)) {
+    return 0;
+  }
+  // max() may round up to a double one past it
+  if (value >= static_cast<double>(std::numeric_limits<T>::max())) {
+    return std::numeric_limits<T>::max();
+  }
+  if (value <= static_cast<double>(std::numeric_limits<T>::min())) {
+    return std::numeric_limits<T>::min();
+  }
+  return static_cast<T>(value);
+}
+
+// Dart's toInt()
+template <typename T>
+T Truncate(double value) {
+  return Saturate<T>(std::trunc(value));
+}
+
+// Dart's round(): halves away from zero
+template <typename T>
+T Round(double value) {
+  return Saturate<T>(std::round(value));
+}
+
+double Dose(double value, bool pill) { return pill ? std::ceil(value) : value; }
+
+}  // namespace
+
+RecipeStore::RecipeStore() = default;
+
+void RecipeStore::Reset(size_t rows) {
+  rxrecipe_id_.assign(rows, 0);
+  checked_.assign(rows, 0);
+  separation_.assign(rows, kNoSeparation);
+  recipe_order_.assign(rows, 0);
+  for (std::vector<double>* column :
+       {&total_, &dose_, &times_, &days_, &morning_, &afternoon_, &evening_,
+        &night_}) {
+    column->assign(rows, 0);
+  }
+  type_.assign(rows, 0);
+  use_.assign(rows, kUnset);
+  atc_.assign(rows, 0);
+  product_name_.assign(rows, StringPool::kEmpty);
+  pack_barcode_.assign(rows, StringPool::kEmpty);
+  location_.assign(rows, StringPool::kEmpty);
+  strings_.Clear();
+}
+
+uint32_t RecipeStore::AddRow() {
+  const uint32_t row = static_cast<uint32_t>(size());
+  rxrecipe_id_.push_back(0);
+  checked_.push_back(0);
+  separation_.push_back(kNoSeparation);
+  recipe_order_.push_back(0);
+  for (std::vector<double>* column :
+       {&total_, &dose_, &times_, &days_, &morning_, &afternoon_, &evening_,
+        &night_}) {
+    column->push_back(0);
+  }
+  type_.push_back(0);
+  use_.push_back(kUnset);
+  atc_.push_back(0);
+  product_name_.push_back(StringPool::kEmpty);
+  pack_barcode_.push_back(StringPool::kEmpty);
+  location_.push_back(StringPool::kEmpty);
+  return row;
+}
+
+RecipeField RecipeStore::FieldForKey(std::string_view key) {
+  for (const FieldAlias& alias : kFieldAliases) {
+    if (alias.key == key) {
+      return RecipeField{alias.column, alias.rank};
+    }
+  }
+  return RecipeField{};
+}
+
+void* RecipeStore::ColumnData(RecipeColumn column) {
+  if (size() == 0) {
+    return nullptr;
+  }
+  switch (column) {
+    case RecipeColumn::kRxrecipeId:
+      return rxrecipe_id_.data();
+    case RecipeColumn::kChecked:
+      return checked_.data();
+    case RecipeColumn::kSeparation:
+      return separation_.data();
+    case RecipeColumn::kRecipeOrder:
+      return recipe_order_.data();
+    case RecipeColumn::kTotal:
+      return total_.data();
+    case RecipeColumn::kDose:
+      return dose_.data();
+    case RecipeColumn::kTimes:
+      return times_.data();
+    case RecipeColumn::kDays:
+      return days_.data();
+    case RecipeColumn::kMorning:
+      return morning_.data();
+    case RecipeColumn::kAfternoon:
+      return afternoon_.data();
+    case RecipeColumn::kEvening:
+      return evening_.data();
+    case RecipeColumn::kNight:
+      return night_.data();
+    case RecipeColumn::kType:
+      return type_.data();
+    case RecipeColumn::kUse:
+      return use_.data();
+    case RecipeColumn::kAtc:
+      return atc_.data();
+    case RecipeColumn::kProductName:
+      return product_name_.data();
+    case RecipeColumn::kPackBarcode:
+      return pack_barcode_.data();
+    case RecipeColumn::kLocation:
+      return location_.data();
+    case RecipeColumn::kCount:
+      break;
+  }
+  return nullptr;
+}
+
+size_t RecipeStore::ColumnWidth(RecipeColumn column) {
+  switch (column) {
+    case RecipeColumn::kRxrecipeId:
+      return sizeof(int64_t);
+    case RecipeColumn::kChecked:
+    case RecipeColumn::kSeparation:
+    case RecipeColumn::kRecipeOrder:
+      return sizeof(int32_t);
+    case RecipeColumn::kTotal:
+    case RecipeColumn::kDose:
+    case RecipeColumn::kTimes:
+    case RecipeColumn::kDays:
+    case RecipeColumn::kMorning:
+    case RecipeColumn::kAfternoon:
+    case RecipeColumn::kEvening:
+    case RecipeColumn::kNight:
+      return sizeof(double);
+    case RecipeColumn::kType:
+    case RecipeColumn::kUse:
+    case RecipeColumn::kAtc:
+      return sizeof(uint8_t);
+    case RecipeColumn::kProductName:
+    case RecipeColumn::kPackBarcode:
+    case RecipeColumn::kLocation:
+      return sizeof(uint32_t);
+    case RecipeColumn::kCount:
+      break;
+  }
+  return 0;
+}
+
+bool RecipeStore::SetNumber(uint32_t row, RecipeColumn column, double value) {
+  if (row >= size()) {
+    return false;
+  }
+  switch (column) {
+    case RecipeColumn::kRxrecipeId:
+      rxrecipe_id_[row] = Truncate<int64_t>(value);
+      return true;
+    case RecipeColumn::kChecked:
+      // main_screen took checked_amount with round()
+      checked_[row] = Round<int32_t>(value);
+      return true;
+    case RecipeColumn::kSeparation:
+    case RecipeColumn::kRecipeOrder:
+      static_cast<int32_t*>(ColumnData(column))[row] =
+          Truncate<int32_t>(value);
+      return true;
+    case RecipeColumn::kUse:
+    case RecipeColumn::kAtc:
+      static_cast<uint8_t*>(ColumnData(column))[row] = value != 0 ? 1 : 0;
+      return true;
+    case RecipeColumn::kProductName:
+    case RecipeColumn::kPackBarcode:
+    case RecipeColumn::kLocation:
+      // A barcode sent as a JSON number
+      static_cast<uint32_t*>(ColumnData(column))[row] =
+          strings_.Intern(FormatFieldNumber(value));
+      return true;
+    case RecipeColumn::kType:
+    case RecipeColumn::kCount:
+      return false;
+    default:
+      static_cast<double*>(ColumnData(column))[row] = value;
+      return true;
+  }
+}
+
+bool RecipeStore::SetString(uint32_t row, RecipeColumn column,
+                            std::string_view value) {
+  if (row >= size()) {
+    return false;
+  }
+  switch (column) {
+    case RecipeColumn::kProductName:
+    case RecipeColumn::kPackBarcode:
+    case RecipeColumn::kLocation:
+      static_cast<uint32_t*>(ColumnData(column))[row] =
+          strings_.Intern(value);
+      return true;
+    case RecipeColumn::kType: {
+      // The whole code is compared ("TAB" is not 'T'), so only one-letter
+      // codes are kept.
+      const std::string_view type = TrimField(value);
+      const uint8_t c = type.size() == 1 ? type[0] : 0;
+      type_[row] = c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c < 0x80 ? c : 0;
+      return true;
+    }
+    case RecipeColumn::kUse:
+    case RecipeColumn::kAtc: {
+      bool flag;
+      return ParseFieldBool(value, &flag) && SetNumber(row, column, flag);
+    }
+    case RecipeColumn::kCount:
+      return false;
+    default: {
+      double number;
+      return ParseFieldNumber(value, &number) &&
+             SetNumber(row, column, number);
+    }
+  }
+}
+
+int32_t RecipeStore::AddChecked(uint32_t row, int32_t delta) {
+  if (row >= size()) {
+    return 0;
+  }
+  const int64_t value = static_cast<int64_t>(checked_[row]) + delta;
+  checked_[row] = static_cast<int32_t>(
+      std::clamp<int64_t>(value, 0, static_cast<int64_t>(kMaxChecked)));
+  return checked_[row];
+}
+
+RecipeTotals RecipeStore::Totals(int32_t separation) const {
+  RecipeTotals totals;
+  const size_t rows = size();
+  for (size_t i = 0; i < rows; ++i) {
+    if (use_[i] == 0 || (separation != 0 && separation_[i] != separation)) {
+      continue;
+    }
+    const bool pill = type_[i] == 'T';
+    totals.morning += Dose(morning_[i], pill);
+    totals.afternoon += Dose(afternoon_[i], pill);
+    totals.evening += Dose(evening_[i], pill);
+    totals.night += Dose(night_[i], pill);
+  }
+  return totals;
+}
+
+std::vector<int32_t> RecipeStore::Separations() const {
+  std::vector<int32_t> separations;
+  const size_t rows = size();
+  for (size_t i = 0; i < rows; ++i) {
+    if (use_[i] == 1 && separation_[i] != kNoSeparation) {
+      separations.push_back(separation_[i]);
+    }
+  }
+  std::sort(separations.begin(), separations.end());
+  separations.erase(std::unique(separations.begin(), separations.end()),
+                    separations.end());
+  return separations;
+}
@@ -0,0 +1,134 @@
+#ifndef NATIVE_RECIPE_STORE_H_
+#define NATIVE_RECIPE_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "native/string_pool.h"
+
+// Columns of a RecipeStore. The element type of each is fixed and listed
+// here; Dart maps them with the same numbers.
+enum class RecipeColumn : int32_t {
+  kRxrecipeId = 0,    // int64_t
+  kChecked = 1,       // int32_t, checked_amount
+  kSeparation = 2,    // int32_t, separate; kNoSeparation when missing
+  kRecipeOrder = 3,   // int32_t
+  kTotal = 4,         // double
+  kDose = 5,          // double
+  kTimes = 6,         // double
+  kDays = 7,          // double
+  kMorning = 8,       // double
+  kAfternoon = 9,     // double
+  kEvening = 10,      // double
+  kNight = 11,        // double
+  kType = 12,         // uint8_t, upper-case one-character ASCII type or 0
+  kUse = 13,          // uint8_t, 0, 1 or kUnset
+  kAtc = 14,          // uint8_t, 0 or 1
+  kProductName = 15,  // uint32_t, StringPool id
+  kPackBarcode = 16,  // uint32_t, StringPool id
+  kLocation = 17,     // uint32_t, StringPool id
+  kCount = 18,
+};
+
+// Where a row field of the RPC results goes. |rank| orders the alternative
+// keys of one column: a value under a lower rank wins ('checked_amount'
+// over 'Checked').
+struct RecipeField {
+  RecipeColumn column = RecipeColumn::kCount;
+  int32_t rank = 0;
+};
+
+// Sums of the morning/afternoon/evening/night doses, as calculateTotals
+// computes them.
+struct RecipeTotals {
+  double morning = 0;
+  double afternoon = 0;
+  double evening = 0;
+  double night = 0;
+};
+
+// Prescription rows of one patient, stored column by column.
+//
+// Each field is one contiguous array indexed by row, with the alternative
+// keys the RPCs use ('type', 'T', 'typeCode', ...) folded into one column
+// and strings interned, so a row costs under 100 bytes and totals and
+// filters are loops over a few arrays. Column pointers stay valid until
+// the row count changes.
+class RecipeStore {
+ public:
+  static constexpr int32_t kNoSeparation = -999;
+  static constexpr uint8_t kUnset = 2;
+  static constexpr int32_t kMaxChecked = 32767;
+
+  RecipeStore();
+
+  // Drops all rows and strings and makes |rows| rows with every field at
+  // its default (zero, kNoSeparation, use kUnset).
+  void Reset(size_t rows);
+
+  // Appends a row with default fields and returns its index.
+  uint32_t AddRow();
+
+  size_t size() const { return rxrecipe_id_.size(); }
+
+  // Column for an RPC field name, or kCount for a field that is not kept.
+  static RecipeField FieldForKey(std::string_view key);
+
+  // First element of |column|, or null for kCount or an empty store.
+  void* ColumnData(RecipeColumn column);
+  // Size of one element of |column|, 0 for kCount
+  static size_t ColumnWidth(RecipeColumn column);
+
+  // Sets a field from a JSON number or bool. kChecked rounds like Dart's
+  // round(); the other integer columns truncate like toInt(). Returns false
+  // if the column takes no numbers (kType).
+  bool SetNumber(uint32_t row, RecipeColumn column, double value);
+  // Sets a field from a JSON string: interned for string columns, the
+  // upper-cased code for a one-character kType (0 for longer ones), and
+  // parsed for the others. Returns false, leaving
+  // the field alone, when it does not parse.
+  bool SetString(uint32_t row, RecipeColumn column, std::string_view value);
+
+  StringPool& strings() { return strings_; }
+  const StringPool& strings() const { return strings_; }
+
+  int32_t checked(uint32_t row) const { return checked_[row]; }
+  double total(uint32_t row) const { return total_[row]; }
+  bool IsComplete(uint32_t row) const { return checked_[row] >= total_[row]; }
+
+  // Adds |delta| to checked_amount, clamped to [0, kMaxChecked]. Returns the
+  // new value.
+  int32_t AddChecked(uint32_t row, int32_t delta);
+
+  // Totals of the rows in use and of |separation| (0 for all); type 'T'
+  // doses are rounded up to whole tablets.
+  RecipeTotals Totals(int32_t separation) const;
+
+  // Distinct separations of the rows explicitly in use, ascending.
+  std::vector<int32_t> Separations() const;
+
+ private:
+  std::vector<int64_t> rxrecipe_id_;
+  std::vector<int32_t> checked_;
+  std::vector<int32_t> separation_;
+  std::vector<int32_t> recipe_order_;
+  std::vector<double> total_;
+  std::vector<double> dose_;
+  std::vector<double> times_;
+  std::vector<double> days_;
+  std::vector<double> morning_;
+  std::vector<double> afternoon_;
+  std::vector<double> evening_;
+  std::vector<double> night_;
+  std::vector<uint8_t> type_;
+  std::vector<uint8_t> use_;
+  std::vector<uint8_t> atc_;
+  std::vector<uint32_t> product_name_;
+  std::vector<uint32_t> pack_barcode_;
+  std::vector<uint32_t> location_;
+  StringPool strings_;
+};
+
+#endif  // NATIVE_RECIPE_STORE_H_
@@ -0,0 +1,759 @@
+#include "native/rpc_gateway.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <utility>
+
+struct RpcGateway::Pending {
+  std::string function;
+  // Coalescing key; empty when the call is not shared
+  std::string key;
+  // The whole HTTP request
+  std::string request;
+  RpcPolicy policy;
+  std::vector<Callback> waiters;
+  Clock::time_point start;
+  // Of the current attempt
+  Clock::time_point deadline;
+  // Retries wait for their backoff
+  Clock::time_point not_before;
+  int attempts = 0;
+  // Attempts written to a connection, less those the server never read
+  // or that never got connected
+  int writes = 0;
+  bool timed_out = false;
+};
+
+struct RpcGateway::Connection {
+  Connection() : parser(HttpParser::Kind::kResponse) {}
+
+  int fd = -1;
+  bool connected = false;
+  Clock::time_point connect_deadline;
+  Clock::time_point idle_since;
+  std::string out;
+  size_t out_offset = 0;
+  // Written or being written, in order; responses come back in this order
+  std::deque<std::shared_ptr<Pending>> waiting;
+  HttpParser parser;
+  uint64_t sent = 0;
+  // Takes no more requests
+  bool draining = false;
+};
+
+namespace {
+
+bool ValidFunctionName(const std::string& name) {
+  if (name.empty()) {
+    return false;
+  }
+  for (char c : name) {
+    const bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    (c >= '0' && c <= '9') || c == '_';
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SetNonBlocking(int fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+int64_t Microseconds(std::chrono::steady_clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+}  // namespace
+
+RpcGateway::RpcGateway(RpcGatewayOptions options)
+    : options_(std::move(options)) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return;
+  }
+  SetNonBlocking(fds[0]);
+  SetNonBlocking(fds[1]);
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  wake_read_ = fds[0];
+  wake_write_ = fds[1];
+  thread_ = std::thread([this] { Loop(); });
+}
+
+RpcGateway::~RpcGateway() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  if (thread_.joinable()) {
+    Wake();
+    thread_.join();
+  }
+  if (wake_read_ >= 0) {
+    close(wake_read_);
+    close(wake_write_);
+  }
+}
+
+void RpcGateway::SetPolicy(const std::string& function,
+                           const RpcPolicy& policy) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  policies_[function] = policy;
+}
+
+void RpcGateway::Call(const std::string& function, std::string body,
+                      Callback done) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.calls;
+    if (!stopping_ && ok()) {
+      submissions_.push_back(
+          Submission{function, std::move(body), std::move(done), Clock::now()});
+      if (submissions_.size() == 1) {
+        // Earlier submissions already woke the loop
+        Wake();
+      }
+      return;
+    }
+    ++stats_.failures;
+  }
+  RpcResult result;
+  result.error = "shutdown";
+  done(result);
+}
+
+RpcResult RpcGateway::CallSync(const std::string& function, std::string body) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool finished = false;
+  RpcResult result;
+  Call(function, std::move(body), [&](const RpcResult& r) {
+    std::lock_guard<std::mutex> lock(mutex);
+    result = r;
+    finished = true;
+    cv.notify_one();
+  });
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [&] { return finished; });
+  return result;
+}
+
+RpcGatewayStats RpcGateway::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void RpcGateway::Wake() {
+  const char byte = 1;
+  // A full pipe already means a wake-up is pending
+  ssize_t ignored = write(wake_write_, &byte, 1);
+  (void)ignored;
+}
+
+void RpcGateway::Loop() {
+  std::vector<Submission> submissions;
+  std::vector<pollfd> fds;
+  std::vector<Connection*> polled;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_) {
+        break;
+      }
+      submissions.swap(submissions_);
+    }
+    Clock::time_point now = Clock::now();
+    for (Submission& submission : submissions) {
+      Accept(&submission, now);
+    }
+    submissions.clear();
+
+    ExpireDeadlines(now);
+    Dispatch(now);
+    for (auto& connection : connections_) {
+      if (connection->fd >= 0 && connection->connected &&
+          !Flush(connection.get())) {
+        CloseConnection(connection.get(), "connection reset", now);
+      }
+    }
+    connections_.erase(
+        std::remove_if(connections_.begin(), connections_.end(),
+                       [](const std::unique_ptr<Connection>& connection) {
+                         return connection->fd < 0;
+                       }),
+        connections_.end());
+
+    fds.clear();
+    polled.clear();
+    fds.push_back(pollfd{wake_read_, POLLIN, 0});
+    for (auto& connection : connections_) {
+      short events = POLLIN;
+      if (!connection->connected ||
+          connection->out_offset < connection->out.size()) {
+        events |= POLLOUT;
+      }
+      fds.push_back(pollfd{connection->fd, events, 0});
+      polled.push_back(connection.get());
+    }
+    const int ready = poll(fds.data(), fds.size(), PollTimeoutMs(now));
+    if (ready <= 0) {
+      continue;
+    }
+    if (fds[0].revents != 0) {
+      char drain[64];
+      while (read(wake_read_, drain, sizeof(drain)) > 0) {
+      }
+    }
+    now = Clock::now();
+    for (size_t i = 0; i < polled.size(); ++i) {
+      Connection* connection = polled[i];
+      const short revents = fds[i + 1].revents;
+      if (revents == 0 || connection->fd < 0) {
+        continue;
+      }
+      if (!connection->connected) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(connection->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0 || (revents & (POLLERR | POLLHUP)) != 0) {
+          CloseConnection(connection, "connect failed", now);
+          continue;
+        }
+        connection->connected = true;
+        connection->idle_since = now;
+      }
+      if ((revents & POLLOUT) != 0 && !Flush(connection)) {
+        CloseConnection(connection, "connection reset", now);
+        continue;
+      }
+      if ((revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+        Receive(connection, now);
+      }
+    }
+  }
+  FailEverything("shutdown");
+}
+
+void RpcGateway::Accept(Submission* submission, Clock::time_point now) {
+  RpcPolicy policy = options_.default_policy;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = policies_.find(submission->function);
+    if (it != policies_.end()) {
+      policy = it->second;
+    }
+  }
+  if (!ValidFunctionName(submission->function)) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++stats_.failures;
+    }
+    RpcResult result;
+    result.error = "bad function name";
+    submission->done(result);
+    return;
+  }
+
+  std::string key;
+  if (policy.coalesce) {
+    key = submission->function + '\n' + submission->body;
+    auto it = coalescing_.find(key);
+    if (it != coalescing_.end()) {
+      it->second->waiters.push_back(std::move(submission->done));
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++stats_.coalesced;
+      return;
+    }
+  }
+
+  auto call = std::make_shared<Pending>();
+  call->function = submission->function;
+  call->policy = policy;
+  call->start = submission->submitted;
+  call->deadline = now + std::chrono::milliseconds(policy.timeout_ms);
+  call->not_before = now;
+  call->waiters.push_back(std::move(submission->done));
+
+  const std::string& body =
+      submission->body.empty() ? std::string("{}") : submission->body;
+  std::string& request = call->request;
+  request.reserve(256 + body.size());
+  request += "POST ";
+  request += options_.path_prefix;
+  request += submission->function;
+  request += " HTTP/1.1\r\nHost: ";
+  request += options_.host;
+  request += ':';
+  request += std::to_string(options_.port);
+  request +=
+      "\r\nContent-Type: application/json\r\nAccept: application/json\r\n"
+      "Content-Length: ";
+  request += std::to_string(body.size());
+  request += "\r\n";
+  if (!options_.keep_alive) {
+    request += "Connection: close\r\n";
+  }
+  for (const std::string& header : options_.headers) {
+    request += header;
+    request += "\r\n";
+  }
+  request += "\r\n";
+  request += body;
+
+  if (!key.empty()) {
+    call->key = key;
+    coalescing_.emplace(std::move(key), call);
+  }
+  queue_.push_back(std::move(call));
+}
+
+RpcGateway::Connection* RpcGateway::IdleConnection() {
+  for (auto& connection : connections_) {
+    if (connection->fd >= 0 && connection->connected &&
+        !connection->draining && connection->waiting.empty()) {
+      return connection.get();
+    }
+  }
+  return nullptr;
+}
+
+RpcGateway::Connection* RpcGateway::LeastLoadedConnection(
+    const Pending& call) {
+  const size_t depth = std::max<size_t>(1, options_.pipeline_depth);
+  if (!call.policy.idempotent) {
+    return nullptr;
+  }
+  Connection* best = nullptr;
+  for (auto& connection : connections_) {
+    if (connection->fd < 0 || connection->draining ||
+        connection->waiting.size() >= depth) {
+      continue;
+    }
+    const bool behind_write = std::any_of(
+        connection->waiting.begin(), connection->waiting.end(),
+        [](const std::shared_ptr<Pending>& waiting) {
+          return !waiting->policy.idempotent;
+        });
+    if (behind_write) {
+      continue;
+    }
+    if (best == nullptr || connection->waiting.size() < best->waiting.size()) {
+      best = connection.get();
+    }
+  }
+  return best;
+}
+
+size_t RpcGateway::LiveConnections() const {
+  size_t live = 0;
+  for (const auto& connection : connections_) {
+    if (connection->fd >= 0) {
+      ++live;
+    }
+  }
+  return live;
+}
+
+void RpcGateway::Dispatch(Clock::time_point now) {
+  std::vector<std::shared_ptr<Pending>> unsent;
+  for (auto it = queue_.begin(); it != queue_.end();) {
+    if ((*it)->not_before > now) {
+      ++it;
+      continue;
+    }
+    // A free warm connection first, then a new one, then pipelining
+    Connection* connection = IdleConnection();
+    if (connection == nullptr &&
+        LiveConnections() < std::max<size_t>(1, options_.max_connections)) {
+      connection = OpenConnection(now);
+      if (connection == nullptr) {
+        unsent.push_back(std::move(*it));
+        it = queue_.erase(it);
+        continue;
+      }
+    }
+    if (connection == nullptr) {
+      connection = LeastLoadedConnection(**it);
+    }
+    if (connection == nullptr) {
+      // A write waiting for a free connection does not hold up the reads
+      // behind it
+      ++it;
+      continue;
+    }
+    Send(connection, std::move(*it));
+    it = queue_.erase(it);
+  }
+  for (auto& call : unsent) {
+    ++call->attempts;
+    Retry(std::move(call), "connect failed", now);
+  }
+}
+
+RpcGateway::Connection* RpcGateway::OpenConnection(Clock::time_point now) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.connections_opened;
+  }
+  if (address_.empty()) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* info = nullptr;
+    const std::string port = std::to_string(options_.port);
+    if (getaddrinfo(options_.host.c_str(), port.c_str(), &hints, &info) != 0 ||
+        info == nullptr) {
+      return nullptr;
+    }
+    const auto* bytes = reinterpret_cast<const uint8_t*>(info->ai_addr);
+    address_.assign(bytes, bytes + info->ai_addrlen);
+    freeaddrinfo(info);
+  }
+  const auto* address = reinterpret_cast<const sockaddr*>(address_.data());
+  const int fd = socket(address->sa_family, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  int one = 1;
+  // Requests are small and latency-bound
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (!SetNonBlocking(fd) ||
+      (connect(fd, address, static_cast<socklen_t>(address_.size())) != 0 &&
+       errno != EINPROGRESS)) {
+    close(fd);
+    return nullptr;
+  }
+  auto connection = std::make_unique<Connection>();
+  connection->fd = fd;
+  connection->connect_deadline =
+      now + std::chrono::milliseconds(options_.connect_timeout_ms);
+  connection->idle_since = now;
+  connections_.push_back(std::move(connection));
+  return connections_.back().get();
+}
+
+void RpcGateway::Send(Connection* connection, std::shared_ptr<Pending> call) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.requests;
+    if (connection->sent > 0) {
+      ++stats_.reused;
+    }
+    if (!connection->waiting.empty()) {
+      ++stats_.pipelined;
+    }
+    ++in_flight_;
+    stats_.max_in_flight = std::max(stats_.max_in_flight, in_flight_);
+  }
+  ++call->attempts;
+  ++call->writes;
+  ++connection->sent;
+  if (connection->out_offset == connection->out.size()) {
+    connection->out.clear();
+    connection->out_offset = 0;
+  }
+  connection->out += call->request;
+  connection->waiting.push_back(std::move(call));
+  if (!options_.keep_alive) {
+    connection->draining = true;
+  }
+}
+
+bool RpcGateway::Flush(Connection* connection) {
+  while (connection->out_offset < connection->out.size()) {
+    const ssize_t n =
+        send(connection->fd, connection->out.data() + connection->out_offset,
+             connection->out.size() - connection->out_offset, MSG_NOSIGNAL);
+    if (n > 0) {
+      connection->out_offset += static_cast<size_t>(n);
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return true;
+    } else {
+      return false;
+    }
+  }
+  connection->out.clear();
+  connection->out_offset = 0;
+  return true;
+}
+
+void RpcGateway::Receive(Connection* connection, Clock::time_point now) {
+  char buffer[16384];
+  while (connection->fd >= 0) {
+    const ssize_t n = recv(connection->fd, buffer, sizeof(buffer), 0);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        CloseConnection(connection, "connection reset", now);
+      }
+      return;
+    }
+    if (n == 0) {
+      if (!connection->waiting.empty() && connection->parser.FinishAtEof()) {
+        Answer(connection, now);
+      }
+      if (connection->fd >= 0) {
+        CloseConnection(connection, "connection closed", now);
+      }
+      return;
+    }
+    size_t offset = 0;
+    while (offset < static_cast<size_t>(n) && connection->fd >= 0) {
+      if (connection->waiting.empty()) {
+        CloseConnection(connection, "unexpected response", now);
+        return;
+      }
+      size_t used = 0;
+      const HttpParser::Result result = connection->parser.Feed(
+          buffer + offset, static_cast<size_t>(n) - offset, &used);
+      offset += used;
+      if (result == HttpParser::Result::kNeedMore) {
+        break;
+      }
+      if (result == HttpParser::Result::kError) {
+        CloseConnection(connection,
+                        "bad response: " + connection->parser.error(), now);
+        return;
+      }
+      Answer(connection, now);
+    }
+    if (static_cast<size_t>(n) < sizeof(buffer)) {
+      return;
+    }
+  }
+}
+
+void RpcGateway::Answer(Connection* connection, Clock::time_point now) {
+  std::shared_ptr<Pending> call = std::move(connection->waiting.front());
+  connection->waiting.pop_front();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --in_flight_;
+  }
+  HttpParser& parser = connection->parser;
+  RpcResult result;
+  result.status = parser.status();
+  result.body = parser.TakeBody();
+  const bool keep_alive = parser.keep_alive();
+  parser.Reset();
+  connection->idle_since = now;
+
+  const bool unavailable = result.status == 502 || result.status == 503 ||
+                           result.status == 504;
+  if (unavailable && call->attempts <= call->policy.retries) {
+    Retry(std::move(call), "", now);
+  } else {
+    Complete(call, std::move(result), now);
+  }
+  if (!keep_alive || (connection->draining && connection->waiting.empty())) {
+    // The server reads nothing after a "Connection: close" response
+    CloseConnection(connection, "connection closed", now, /*resend=*/true);
+  }
+}
+
+void RpcGateway::CloseConnection(Connection* connection,
+                                 const std::string& error,
+                                 Clock::time_point now, bool resend) {
+  if (connection->fd < 0) {
+    return;
+  }
+  close(connection->fd);
+  connection->fd = -1;
+  std::deque<std::shared_ptr<Pending>> waiting;
+  waiting.swap(connection->waiting);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_ -= waiting.size();
+  }
+  if (resend) {
+    // Back to the front, in their original order, without using up an
+    // attempt
+    for (auto it = waiting.rbegin(); it != waiting.rend(); ++it) {
+      --(*it)->attempts;
+      --(*it)->writes;
+      (*it)->not_before = now;
+      queue_.push_front(std::move(*it));
+    }
+    return;
+  }
+  for (auto& call : waiting) {
+    if (!connection->connected) {
+      // Queued on a connection that never came up
+      --call->writes;
+    }
+    const std::string reason = call->timed_out ? "timeout" : error;
+    Retry(std::move(call), reason, now);
+  }
+}
+
+void RpcGateway::Retry(std::shared_ptr<Pending> call, const std::string& error,
+                       Clock::time_point now) {
+  if (call->attempts <= call->policy.retries) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++stats_.retries;
+    }
+    call->timed_out = false;
+    call->not_before =
+        now + std::chrono::milliseconds(options_.retry_backoff_ms *
+                                        call->attempts);
+    call->deadline =
+        call->not_before + std::chrono::milliseconds(call->policy.timeout_ms);
+    queue_.push_back(std::move(call));
+    return;
+  }
+  RpcResult result;
+  result.error = error.empty() ? "unavailable" : error;
+  Complete(call, std::move(result), now);
+}
+
+void RpcGateway::Complete(const std::shared_ptr<Pending>& call,
+                          RpcResult result, Clock::time_point now) {
+  if (!call->key.empty()) {
+    auto it = coalescing_.find(call->key);
+    if (it != coalescing_.end() && it->second == call) {
+      coalescing_.erase(it);
+    }
+  }
+  result.attempts = call->attempts;
+  result.sent = result.status != 0 || call->writes > 0;
+  result.latency_us = Microseconds(now - call->start);
+  if (result.status == 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.failures += call->waiters.size();
+  }
+  std::vector<Callback> waiters;
+  waiters.swap(call->waiters);
+  for (size_t i = 0; i < waiters.size(); ++i) {
+    result.shared = i > 0;
+    waiters[i](result);
+  }
+}
+
+void RpcGateway::ExpireDeadlines(Clock::time_point now) {
+  std::vector<std::shared_ptr<Pending>> expired;
+  for (auto it = queue_.begin(); it != queue_.end();) {
+    if ((*it)->deadline <= now) {
+      expired.push_back(std::move(*it));
+      it = queue_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  uint64_t timeouts = expired.size();
+  for (auto& connection : connections_) {
+    if (connection->fd < 0) {
+      continue;
+    }
+    if (!connection->connected && connection->connect_deadline <= now) {
+      CloseConnection(connection.get(), "connect timeout", now);
+      continue;
+    }
+    bool late = false;
+    for (auto& call : connection->waiting) {
+      if (call->deadline <= now) {
+        call->timed_out = true;
+        ++timeouts;
+        late = true;
+      }
+    }
+    if (late) {
+      // Responses come in order, so the connection is stuck behind the
+      // late one; the others go elsewhere.
+      CloseConnection(connection.get(), "connection closed", now);
+    } else if (connection->waiting.empty() && connection->connected &&
+               now - connection->idle_since >=
+                   std::chrono::milliseconds(options_.idle_timeout_ms)) {
+      CloseConnection(connection.get(), "idle", now);
+    }
+  }
+  if (timeouts > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.timeouts += timeouts;
+  }
+  for (auto& call : expired) {
+    RpcResult result;
+    result.error = "timeout";
+    Complete(call, std::move(result), now);
+  }
+}
+
+int RpcGateway::PollTimeoutMs(Clock::time_point now) const {
+  const auto idle_timeout = std::chrono::milliseconds(options_.idle_timeout_ms);
+  Clock::time_point next = now + std::chrono::seconds(1);
+  for (const auto& call : queue_) {
+    next = std::min(next, call->not_before > now ? call->not_before
+                                                 : call->deadline);
+  }
+  for (const auto& connection : connections_) {
+    if (!connection->connected) {
+      next = std::min(next, connection->connect_deadline);
+    }
+    for (const auto& call : connection->waiting) {
+      next = std::min(next, call->deadline);
+    }
+    if (connection->waiting.empty()) {
+      next = std::min(next, connection->idle_since + idle_timeout);
+    }
+  }
+  if (next <= now) {
+    return 0;
+  }
+  // Round up so the deadline has passed when poll returns
+  return static_cast<int>((Microseconds(next - now) + 999) / 1000);
+}
+
+void RpcGateway::FailEverything(const std::string& error) {
+  std::vector<std::shared_ptr<Pending>> calls(queue_.begin(), queue_.end());
+  queue_.clear();
+  for (auto& connection : connections_) {
+    if (connection->fd >= 0) {
+      close(connection->fd);
+      connection->fd = -1;
+    }
+    for (auto& call : connection->waiting) {
+      calls.push_back(std::move(call));
+    }
+    connection->waiting.clear();
+  }
+  connections_.clear();
+  std::vector<Submission> submissions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    submissions.swap(submissions_);
+    in_flight_ = 0;
+  }
+  const Clock::time_point now = Clock::now();
+  for (auto& call : calls) {
+    RpcResult result;
+    result.error = error;
+    Complete(call, std::move(result), now);
+  }
+  for (Submission& submission : submissions) {
+    RpcResult result;
+    result.error = error;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++stats_.failures;
+    }
+    submission.done(result);
+  }
+}
@@ -0,0 +1,191 @@
+#ifndef NATIVE_RPC_GATEWAY_H_
+#define NATIVE_RPC_GATEWAY_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "native/http_message.h"
+
+// How calls to one RPC function are sent.
+struct RpcPolicy {
+  // Per attempt, from when it is queued until its response is complete
+  int timeout_ms = 10000;
+  // Further attempts after a transport failure, a timeout or a 502/503/504.
+  // Leave at 0 for functions that must not run twice.
+  int retries = 0;
+  // Identical calls (same function and body) made while one is in flight
+  // share its response instead of sending their own. Only for reads.
+  bool coalesce = false;
+  // Running it twice is harmless. Only such calls are pipelined: a write
+  // waits for a connection with nothing in flight and nothing is written
+  // behind it, so a late or dropped response to another request cannot cut
+  // it off after the server has read it.
+  bool idempotent = false;
+};
+
+struct RpcGatewayOptions {
+  std::string host = "127.0.0.1";
+  uint16_t port = 0;
+  // PostgREST's RPC route; the function name is appended
+  std::string path_prefix = "/rest/v1/rpc/";
+  // Extra request header lines without CRLF, e.g. "apikey: <key>"
+  std::vector<std::string> headers;
+  size_t max_connections = 4;
+  // Requests written on one connection ahead of their responses. 1 turns
+  // pipelining off; calls that are not idempotent always use 1.
+  size_t pipeline_depth = 4;
+  // false sends "Connection: close" and uses every connection once, like a
+  // client without a connection pool
+  bool keep_alive = true;
+  int connect_timeout_ms = 3000;
+  // Idle connections are closed after this long
+  int idle_timeout_ms = 30000;
+  // Delay before retry n is n times this
+  int retry_backoff_ms = 100;
+  RpcPolicy default_policy;
+};
+
+struct RpcResult {
+  // HTTP status, or 0 if no response arrived (see |error|)
+  int status = 0;
+  std::string body;
+  // Why no response arrived: "timeout", "connect failed", ...
+  std::string error;
+  // The request was written to a connection, so without a response the
+  // server may still have run it. Always true when |status| is set.
+  bool sent = false;
+  int attempts = 0;
+  // Answered by a request another caller made
+  bool shared = false;
+  int64_t latency_us = 0;
+
+  bool ok() const { return status >= 200 && status < 300; }
+};
+
+struct RpcGatewayStats {
+  uint64_t calls = 0;
+  // Calls that shared another call's request
+  uint64_t coalesced = 0;
+  // Requests written, retries included
+  uint64_t requests = 0;
+  uint64_t retries = 0;
+  uint64_t timeouts = 0;
+  // Calls that ended without a response
+  uint64_t failures = 0;
+  uint64_t connections_opened = 0;
+  // Requests sent on a connection that had already carried one
+  uint64_t reused = 0;
+  // Requests written while the connection still owed a response
+  uint64_t pipelined = 0;
+  uint64_t max_in_flight = 0;
+};
+
+// HTTP/1.1 client for PostgREST RPC calls (POST <prefix><function>).
+//
+// One I/O thread owns a small pool of keep-alive connections and writes
+// calls to them as they come, several per connection when the pool is
+// busy; PostgREST answers pipelined requests in order. Identical reads in
+// flight at the same time share one request. Each function can have its
+// own timeout and retry budget.
+//
+// Plain TCP only: point it at a PostgREST on the LAN, a TLS-terminating
+// proxy, or the stand-in server.
+class RpcGateway {
+ public:
+  // Runs on the I/O thread and must not block.
+  using Callback = std::function<void(const RpcResult&)>;
+
+  explicit RpcGateway(RpcGatewayOptions options);
+  // Fails the calls still pending with "shutdown" and closes everything.
+  ~RpcGateway();
+
+  RpcGateway(const RpcGateway&) = delete;
+  RpcGateway& operator=(const RpcGateway&) = delete;
+
+  // False if the I/O thread could not be set up
+  bool ok() const { return wake_write_ >= 0; }
+
+  void SetPolicy(const std::string& function, const RpcPolicy& policy);
+
+  // Sends |body| (JSON) to |function| and calls |done| exactly once.
+  void Call(const std::string& function, std::string body, Callback done);
+
+  // Blocks until the call completes. Not from a Callback.
+  RpcResult CallSync(const std::string& function, std::string body);
+
+  RpcGatewayStats GetStats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Pending;
+  struct Connection;
+
+  struct Submission {
+    std::string function;
+    std::string body;
+    Callback done;
+    Clock::time_point submitted;
+  };
+
+  void Loop();
+  void Accept(Submission* submission, Clock::time_point now);
+  void Dispatch(Clock::time_point now);
+  // A connection for the next request, or null if all are busy
+  Connection* IdleConnection();
+  // A connection |call| can be pipelined on, or null
+  Connection* LeastLoadedConnection(const Pending& call);
+  size_t LiveConnections() const;
+  // Starts connecting; null if that failed at once
+  Connection* OpenConnection(Clock::time_point now);
+  void Send(Connection* connection, std::shared_ptr<Pending> call);
+  bool Flush(Connection* connection);
+  void Receive(Connection* connection, Clock::time_point now);
+  void Answer(Connection* connection, Clock::time_point now);
+  // Drops |connection|. Its unanswered calls are retried or failed with
+  // |error|, or with |resend| queued again as if never sent (the server
+  // closed the connection before reading them).
+  void CloseConnection(Connection* connection, const std::string& error,
+                       Clock::time_point now, bool resend = false);
+  void Retry(std::shared_ptr<Pending> call, const std::string& error,
+             Clock::time_point now);
+  void Complete(const std::shared_ptr<Pending>& call, RpcResult result,
+                Clock::time_point now);
+  void ExpireDeadlines(Clock::time_point now);
+  int PollTimeoutMs(Clock::time_point now) const;
+  void FailEverything(const std::string& error);
+  void Wake();
+
+  const RpcGatewayOptions options_;
+
+  // Shared with the callers
+  mutable std::mutex mutex_;
+  std::vector<Submission> submissions_;
+  std::map<std::string, RpcPolicy> policies_;
+  RpcGatewayStats stats_;
+  bool stopping_ = false;
+
+  // I/O thread only
+  std::deque<std::shared_ptr<Pending>> queue_;
+  std::unordered_map<std::string, std::shared_ptr<Pending>> coalescing_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+  uint64_t in_flight_ = 0;
+  // sockaddr of the server, resolved on the first connect
+  std::vector<uint8_t> address_;
+
+  int wake_read_ = -1;
+  int wake_write_ = -1;
+  std::thread thread_;
+};
+
+#endif  // NATIVE_RPC_GATEWAY_H_
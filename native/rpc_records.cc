@@ -0,0 +1,313 @@
+#include "native/rpc_records.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+#include "native/field_text.h"
+
+namespace {
+
+constexpr int32_t kNoRank = std::numeric_limits<int32_t>::max();
+
+// The '??' chains main_screen reads rxhead rows with. 환자명 and 생년월일
+// are spelled as UTF-8 escapes.
+constexpr RecordColumnSpec kRxHeadColumns[] = {
+    {RecordType::kInt64, {"tfn", nullptr, nullptr}},
+    {RecordType::kString, {"no", nullptr, nullptr}},
+    {RecordType::kString, {"pid", nullptr, nullptr}},
+    {RecordType::kString,
+     {"patient_name", "name", "\xed\x99\x98\xec\x9e\x90\xeb\xaa\x85"}},
+    {RecordType::kString,
+     {"patient_birth", "birth_date",
+      "\xec\x83\x9d\xeb\x85\x84\xec\x9b\x94\xec\x9d\xbc"}},
+    {RecordType::kBool, {"is_complete", nullptr, nullptr}},
+};
+static_assert(std::size(kRxHeadColumns) ==
+              static_cast<size_t>(RxHeadColumn::kCount));
+
+constexpr RecordColumnSpec kMissMatchedDrugColumns[] = {
+    {RecordType::kString, {"product_name", nullptr, nullptr}},
+    {RecordType::kString, {"location", nullptr, nullptr}},
+};
+static_assert(std::size(kMissMatchedDrugColumns) ==
+              static_cast<size_t>(MissMatchedDrugColumn::kCount));
+
+int64_t ToInt64(double value) {
+  if (!std::isfinite(value)) {
+    return 0;
+  }
+  if (value >= static_cast<double>(std::numeric_limits<int64_t>::max())) {
+    return std::numeric_limits<int64_t>::max();
+  }
+  if (value <= static_cast<double>(std::numeric_limits<int64_t>::min())) {
+    return std::numeric_limits<int64_t>::min();
+  }
+  return static_cast<int64_t>(std::trunc(value));
+}
+
+}  // namespace
+
+// JsonRowsDecoder
+
+JsonRowsDecoder::JsonRowsDecoder(JsonRowSink* sink)
+    : sink_(sink), reader_(this) {}
+
+bool JsonRowsDecoder::StartObject() {
+  if (depth_ == 0) {
+    row_depth_ = 1;
+  }
+  if (depth_ == row_depth_) {
+    // An object as the value of a field is skipped
+    column_ = -1;
+  }
+  ++depth_;
+  if (depth_ == row_depth_) {
+    sink_->BeginRow();
+    ++rows_;
+    column_ = -1;
+  }
+  return true;
+}
+
+bool JsonRowsDecoder::EndObject() {
+  --depth_;
+  return true;
+}
+
+bool JsonRowsDecoder::StartArray() {
+  if (depth_ == 0) {
+    row_depth_ = 2;
+  }
+  if (depth_ == row_depth_) {
+    column_ = -1;
+  }
+  ++depth_;
+  return true;
+}
+
+bool JsonRowsDecoder::EndArray() {
+  --depth_;
+  return true;
+}
+
+bool JsonRowsDecoder::Key(std::string_view key) {
+  if (depth_ == row_depth_) {
+    column_ = sink_->Field(key);
+  }
+  return true;
+}
+
+bool JsonRowsDecoder::String(std::string_view value) {
+  if (AtField()) {
+    sink_->String(column_, value);
+    column_ = -1;
+  }
+  return true;
+}
+
+bool JsonRowsDecoder::Number(double value) {
+  if (AtField()) {
+    sink_->Number(column_, value);
+    column_ = -1;
+  }
+  return true;
+}
+
+bool JsonRowsDecoder::Bool(bool value) {
+  if (AtField()) {
+    sink_->Bool(column_, value);
+    column_ = -1;
+  }
+  return true;
+}
+
+bool JsonRowsDecoder::Null() {
+  if (depth_ == row_depth_) {
+    column_ = -1;
+  }
+  return true;
+}
+
+bool DecodeJsonRows(std::string_view json, JsonRowSink* sink,
+                    std::string* error) {
+  JsonRowsDecoder decoder(sink);
+  const bool ok = decoder.Feed(json) && decoder.Finish();
+  if (!ok && error != nullptr) {
+    *error = decoder.error();
+  }
+  return ok;
+}
+
+// RecordTable
+
+const RecordSchema& RxHeadSchema() {
+  static const RecordSchema schema{kRxHeadColumns, std::size(kRxHeadColumns)};
+  return schema;
+}
+
+const RecordSchema& MissMatchedDrugSchema() {
+  static const RecordSchema schema{kMissMatchedDrugColumns,
+                                   std::size(kMissMatchedDrugColumns)};
+  return schema;
+}
+
+RecordTable::RecordTable(const RecordSchema& schema)
+    : schema_(schema), columns_(schema.count), ranks_(schema.count, kNoRank) {
+  for (size_t i = 0; i < schema.count; ++i) {
+    columns_[i].type = schema.columns[i].type;
+  }
+}
+
+void RecordTable::Clear() {
+  for (Column& column : columns_) {
+    column.ints.clear();
+    column.doubles.clear();
+    column.bools.clear();
+    column.strings.clear();
+  }
+  rows_ = 0;
+  strings_.Clear();
+}
+
+void* RecordTable::ColumnData(size_t column) {
+  if (column >= columns_.size() || rows_ == 0) {
+    return nullptr;
+  }
+  Column& c = columns_[column];
+  switch (c.type) {
+    case RecordType::kInt64:
+      return c.ints.data();
+    case RecordType::kDouble:
+      return c.doubles.data();
+    case RecordType::kBool:
+      return c.bools.data();
+    case RecordType::kString:
+      return c.strings.data();
+  }
+  return nullptr;
+}
+
+int64_t RecordTable::Int64At(size_t row, size_t column) const {
+  return columns_[column].ints[row];
+}
+
+double RecordTable::DoubleAt(size_t row, size_t column) const {
+  return columns_[column].doubles[row];
+}
+
+bool RecordTable::BoolAt(size_t row, size_t column) const {
+  return columns_[column].bools[row] != 0;
+}
+
+std::string_view RecordTable::StringAt(size_t row,
+                                       size_t column) const {
+  return strings_.Get(columns_[column].strings[row]);
+}
+
+void RecordTable::BeginRow() {
+  for (Column& column : columns_) {
+    switch (column.type) {
+      case RecordType::kInt64:
+        column.ints.push_back(0);
+        break;
+      case RecordType::kDouble:
+        column.doubles.push_back(0);
+        break;
+      case RecordType::kBool:
+        column.bools.push_back(0);
+        break;
+      case RecordType::kString:
+        column.strings.push_back(StringPool::kEmpty);
+        break;
+    }
+  }
+  ++rows_;
+  std::fill(ranks_.begin(), ranks_.end(), kNoRank);
+}
+
+int32_t RecordTable::Field(std::string_view key) {
+  for (size_t i = 0; i < schema_.count; ++i) {
+    const char* const* keys = schema_.columns[i].keys;
+    for (int32_t rank = 0; rank < 3 && keys[rank] != nullptr; ++rank) {
+      if (key == keys[rank]) {
+        if (ranks_[i] <= rank) {
+          return -1;
+        }
+        rank_ = rank;
+        return static_cast<int32_t>(i);
+      }
+    }
+  }
+  return -1;
+}
+
+void RecordTable::String(int32_t column, std::string_view value) {
+  Column& c = columns_[column];
+  const size_t row = rows_ - 1;
+  switch (c.type) {
+    case RecordType::kString:
+      c.strings[row] = strings_.Intern(value);
+      Took(column, true);
+      return;
+    case RecordType::kBool: {
+      bool flag;
+      if (ParseFieldBool(value, &flag)) {
+        c.bools[row] = flag ? 1 : 0;
+        Took(column, true);
+      }
+      return;
+    }
+    case RecordType::kInt64:
+    case RecordType::kDouble: {
+      double number;
+      if (ParseFieldNumber(value, &number)) {
+        Number(column, number);
+      }
+      return;
+    }
+  }
+}
+
+void RecordTable::Number(int32_t column, double value) {
+  Column& c = columns_[column];
+  const size_t row = rows_ - 1;
+  switch (c.type) {
+    case RecordType::kInt64:
+      c.ints[row] = ToInt64(value);
+      break;
+    case RecordType::kDouble:
+      c.doubles[row] = value;
+      break;
+    case RecordType::kBool:
+      c.bools[row] = value != 0 ? 1 : 0;
+      break;
+    case RecordType::kString:
+      c.strings[row] = strings_.Intern(FormatFieldNumber(value));
+      break;
+  }
+  Took(column, true);
+}
+
+void RecordTable::Bool(int32_t column, bool value) {
+  Column& c = columns_[column];
+  const size_t row = rows_ - 1;
+  switch (c.type) {
+    case RecordType::kBool:
+      c.bools[row] = value ? 1 : 0;
+      break;
+    case RecordType::kString:
+      c.strings[row] = strings_.Intern(value ? "true" : "false");
+      break;
+    default:
+      return;
+  }
+  Took(column, true);
+}
+
+void RecordTable::Took(int32_t column, bool taken) {
+  if (taken) {
+    ranks_[column] = rank_;
+  }
+}
@@ -0,0 +1,154 @@
+#ifndef NATIVE_RPC_RECORDS_H_
+#define NATIVE_RPC_RECORDS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "native/json_reader.h"
+#include "native/string_pool.h"
+
+// Receives the rows of an RPC response: the objects of a top-level array,
+// or a top-level object as the only row. Only scalar members reach the
+// sink; nested values are skipped and nulls dropped.
+class JsonRowSink {
+ public:
+  virtual ~JsonRowSink() = default;
+
+  virtual void BeginRow() = 0;
+  // Column for member |key| of the current row, or -1 to skip it. The
+  // value follows in one of the calls below.
+  virtual int32_t Field(std::string_view key) = 0;
+  virtual void String(int32_t column, std::string_view value) = 0;
+  virtual void Number(int32_t column, double value) = 0;
+  virtual void Bool(int32_t column, bool value) = 0;
+};
+
+// Decodes an RPC response into a JsonRowSink as its bytes arrive.
+class JsonRowsDecoder : private JsonHandler {
+ public:
+  explicit JsonRowsDecoder(JsonRowSink* sink);
+
+  bool Feed(const char* data, size_t size) { return reader_.Feed(data, size); }
+  bool Feed(std::string_view data) { return reader_.Feed(data); }
+  // Returns true if the whole response was valid JSON.
+  bool Finish() { return reader_.Finish(); }
+
+  size_t rows() const { return rows_; }
+  const std::string& error() const { return reader_.error(); }
+
+ private:
+  bool StartObject() override;
+  bool EndObject() override;
+  bool StartArray() override;
+  bool EndArray() override;
+  bool Key(std::string_view key) override;
+  bool String(std::string_view value) override;
+  bool Number(double value) override;
+  bool Bool(bool value) override;
+  bool Null() override;
+
+  // Whether a scalar at the current depth is a field of a row
+  bool AtField() const { return depth_ == row_depth_ && column_ >= 0; }
+
+  JsonRowSink* sink_;
+  JsonReader reader_;
+  size_t depth_ = 0;
+  // Depth of the row objects: 1 for a single object, 2 inside an array
+  size_t row_depth_ = 0;
+  int32_t column_ = -1;
+  size_t rows_ = 0;
+};
+
+// Decodes a complete response. Returns false, with the reason in |error|,
+// if it is not valid JSON.
+bool DecodeJsonRows(std::string_view json, JsonRowSink* sink,
+                    std::string* error = nullptr);
+
+enum class RecordType : uint8_t {
+  kInt64,   // int64_t
+  kDouble,  // double
+  kBool,    // uint8_t 0/1
+  kString,  // uint32_t StringPool id
+};
+
+struct RecordColumnSpec {
+  RecordType type;
+  // Keys of the column in order of preference; unused ones are null
+  const char* keys[3];
+};
+
+struct RecordSchema {
+  const RecordColumnSpec* columns;
+  size_t count;
+};
+
+// select_rxhead_bydate and select_rxhead_by_name rows
+enum class RxHeadColumn : int32_t {
+  kTfn = 0,           // int64
+  kNo = 1,            // string
+  kPid = 2,           // string
+  kPatientName = 3,   // string
+  kPatientBirth = 4,  // string
+  kIsComplete = 5,    // bool
+  kCount = 6,
+};
+const RecordSchema& RxHeadSchema();
+
+// get_miss_mached_drug rows
+enum class MissMatchedDrugColumn : int32_t {
+  kProductName = 0,  // string
+  kLocation = 1,     // string
+  kCount = 2,
+};
+const RecordSchema& MissMatchedDrugSchema();
+
+// Rows of a fixed schema stored column by column, with strings interned.
+class RecordTable : public JsonRowSink {
+ public:
+  explicit RecordTable(const RecordSchema& schema);
+
+  void Clear();
+  size_t size() const { return rows_; }
+  size_t columns() const { return columns_.size(); }
+  RecordType type(size_t column) const { return columns_[column].type; }
+
+  // First element of |column|, or null when empty or out of range
+  void* ColumnData(size_t column);
+
+  int64_t Int64At(size_t row, size_t column) const;
+  double DoubleAt(size_t row, size_t column) const;
+  bool BoolAt(size_t row, size_t column) const;
+  std::string_view StringAt(size_t row, size_t column) const;
+
+  const StringPool& strings() const { return strings_; }
+
+  // JsonRowSink
+  void BeginRow() override;
+  int32_t Field(std::string_view key) override;
+  void String(int32_t column, std::string_view value) override;
+  void Number(int32_t column, double value) override;
+  void Bool(int32_t column, bool value) override;
+
+ private:
+  struct Column {
+    RecordType type;
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+    std::vector<uint8_t> bools;
+    std::vector<uint32_t> strings;
+  };
+
+  void Took(int32_t column, bool taken);
+
+  const RecordSchema& schema_;
+  std::vector<Column> columns_;
+  size_t rows_ = 0;
+  int32_t rank_ = 0;
+  std::vector<int32_t> ranks_;
+  StringPool strings_;
+};
+
+#endif  // NATIVE_RPC_RECORDS_H_
@@ -0,0 +1,321 @@
+#include "native/rpc_standin_server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "native/http_message.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+bool SetNonBlocking(int fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+const char* Reason(int status) {
+  switch (status) {
+    case 200:
+      return "OK";
+    case 204:
+      return "No Content";
+    case 400:
+      return "Bad Request";
+    case 404:
+      return "Not Found";
+    case 405:
+      return "Method Not Allowed";
+    case 500:
+      return "Internal Server Error";
+    case 503:
+      return "Service Unavailable";
+    default:
+      return "Status";
+  }
+}
+
+}  // namespace
+
+struct RpcStandInServer::Client {
+  struct Reply {
+    Clock::time_point ready_at;
+    std::string bytes;
+    bool close = false;
+    bool drop = false;
+  };
+
+  Client() : parser(HttpParser::Kind::kRequest) {}
+
+  int fd = -1;
+  HttpParser parser;
+  // In request order; each is written once it is ready and all before it
+  // are written
+  std::deque<Reply> replies;
+  std::string out;
+  size_t out_offset = 0;
+  int served = 0;
+  // No more requests are read
+  bool closing = false;
+};
+
+RpcStandInServer::RpcStandInServer(RpcStandInOptions options, Handler handler)
+    : options_(std::move(options)),
+      handler_(std::move(handler)),
+      latency_ms_(options_.latency_ms) {
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  int fds[2];
+  if (listen_fd_ < 0 || pipe(fds) != 0) {
+    return;
+  }
+  wake_read_ = fds[0];
+  wake_write_ = fds[1];
+  SetNonBlocking(wake_read_);
+  int one = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(options_.port);
+  socklen_t length = sizeof(addr);
+  if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) !=
+          0 ||
+      listen(listen_fd_, 64) != 0 || !SetNonBlocking(listen_fd_) ||
+      getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &length) !=
+          0) {
+    return;
+  }
+  port_ = ntohs(addr.sin_port);
+  thread_ = std::thread([this] { Serve(); });
+}
+
+RpcStandInServer::~RpcStandInServer() {
+  stop_ = true;
+  if (thread_.joinable()) {
+    const char byte = 1;
+    ssize_t ignored = write(wake_write_, &byte, 1);
+    (void)ignored;
+    thread_.join();
+  }
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+  }
+  if (wake_read_ >= 0) {
+    close(wake_read_);
+    close(wake_write_);
+  }
+}
+
+void RpcStandInServer::Serve() {
+  std::mt19937 random(options_.seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<std::unique_ptr<Client>> clients;
+  std::vector<pollfd> fds;
+  uint64_t sequence = 0;
+
+  // Parses what |client| has sent and queues the replies.
+  auto handle = [&](Client* client, const char* data, size_t size) {
+    size_t offset = 0;
+    while (offset < size && !client->closing) {
+      size_t used = 0;
+      const HttpParser::Result result =
+          client->parser.Feed(data + offset, size - offset, &used);
+      offset += used;
+      if (result == HttpParser::Result::kNeedMore) {
+        return;
+      }
+      Client::Reply reply;
+      int latency = latency_ms_;
+      if (options_.jitter_ms > 0) {
+        latency += static_cast<int>(unit(random) * options_.jitter_ms);
+      }
+      if (options_.tail_ratio > 0 && unit(random) < options_.tail_ratio) {
+        latency += options_.tail_ms;
+      }
+      reply.ready_at = Clock::now() + std::chrono::milliseconds(latency);
+
+      RpcStandInReply answer;
+      if (result == HttpParser::Result::kError) {
+        answer.status = 400;
+        answer.body = "{\"message\":\"" + client->parser.error() + "\"}";
+        reply.close = true;
+      } else {
+        ++requests_;
+        ++client->served;
+        const std::string& target = client->parser.target();
+        const std::string& prefix = options_.path_prefix;
+        if (options_.drop_every > 0 &&
+            ++sequence % static_cast<uint64_t>(options_.drop_every) == 0) {
+          reply.drop = true;
+        } else if (client->parser.method() != "POST") {
+          answer.status = 405;
+          answer.body = "{\"message\":\"method not allowed\"}";
+        } else if (target.compare(0, prefix.size(), prefix) != 0 ||
+                   target.size() == prefix.size()) {
+          answer.status = 404;
+          answer.body = "{\"message\":\"no such function\"}";
+        } else {
+          answer = handler_(target.substr(prefix.size()),
+                            client->parser.body());
+        }
+        reply.close = !client->parser.keep_alive() ||
+                      (options_.max_requests_per_connection > 0 &&
+                       client->served >= options_.max_requests_per_connection);
+      }
+      if (!reply.drop) {
+        reply.bytes = "HTTP/1.1 " + std::to_string(answer.status) + " " +
+                      Reason(answer.status) +
+                      "\r\nContent-Type: application/json\r\n"
+                      "Content-Length: " +
+                      std::to_string(answer.body.size()) + "\r\n";
+        if (reply.close) {
+          reply.bytes += "Connection: close\r\n";
+        }
+        reply.bytes += "\r\n";
+        reply.bytes += answer.body;
+      }
+      client->closing = reply.close || reply.drop;
+      client->replies.push_back(std::move(reply));
+      client->parser.Reset();
+    }
+  };
+
+  // Writes the replies that are due; false once the connection is done.
+  auto flush = [&](Client* client, Clock::time_point now) {
+    while (true) {
+      if (client->out_offset == client->out.size()) {
+        client->out.clear();
+        client->out_offset = 0;
+        if (client->replies.empty() ||
+            client->replies.front().ready_at > now) {
+          return true;
+        }
+        Client::Reply& reply = client->replies.front();
+        if (reply.drop || reply.bytes.empty()) {
+          return false;
+        }
+        client->out.swap(reply.bytes);
+        const bool close_after = reply.close;
+        client->replies.pop_front();
+        if (close_after) {
+          // Nothing is answered after this one
+          client->replies.clear();
+          client->closing = true;
+        }
+      }
+      const ssize_t n =
+          send(client->fd, client->out.data() + client->out_offset,
+               client->out.size() - client->out_offset, MSG_NOSIGNAL);
+      if (n > 0) {
+        client->out_offset += static_cast<size_t>(n);
+        if (client->out_offset == client->out.size() && client->closing &&
+            client->replies.empty()) {
+          return false;
+        }
+      } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return true;
+      } else if (n < 0 && errno == EINTR) {
+        continue;
+      } else {
+        return false;
+      }
+    }
+  };
+
+  while (!stop_) {
+    Clock::time_point now = Clock::now();
+    for (auto& client : clients) {
+      if (!flush(client.get(), now)) {
+        close(client->fd);
+        client->fd = -1;
+      }
+    }
+    clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                 [](const std::unique_ptr<Client>& client) {
+                                   return client->fd < 0;
+                                 }),
+                  clients.end());
+
+    int timeout_ms = 100;
+    fds.clear();
+    fds.push_back(pollfd{wake_read_, POLLIN, 0});
+    fds.push_back(pollfd{listen_fd_, POLLIN, 0});
+    for (auto& client : clients) {
+      short events = client->closing ? 0 : POLLIN;
+      if (client->out_offset < client->out.size()) {
+        events |= POLLOUT;
+      } else if (!client->replies.empty()) {
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+            client->replies.front().ready_at - now);
+        timeout_ms = std::max(
+            0, std::min(timeout_ms, static_cast<int>(wait.count()) + 1));
+      }
+      fds.push_back(pollfd{client->fd, events, 0});
+    }
+    if (poll(fds.data(), fds.size(), timeout_ms) <= 0) {
+      continue;
+    }
+    if (fds[0].revents != 0) {
+      char drain[16];
+      while (read(wake_read_, drain, sizeof(drain)) > 0) {
+      }
+    }
+    char buffer[16384];
+    const size_t polled = clients.size();
+    for (size_t i = 0; i < polled; ++i) {
+      Client* client = clients[i].get();
+      const short revents = fds[i + 2].revents;
+      if ((revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+        continue;
+      }
+      const ssize_t n = recv(client->fd, buffer, sizeof(buffer), 0);
+      if (n > 0) {
+        handle(client, buffer, static_cast<size_t>(n));
+      } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+        close(client->fd);
+        client->fd = -1;
+      }
+    }
+    if (fds[1].revents != 0) {
+      while (true) {
+        const int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+          break;
+        }
+        SetNonBlocking(fd);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        auto client = std::make_unique<Client>();
+        client->fd = fd;
+        clients.push_back(std::move(client));
+        ++connections_;
+        uint64_t open = 0;
+        for (const auto& c : clients) {
+          open += c->fd >= 0 ? 1 : 0;
+        }
+        if (open > max_concurrent_) {
+          max_concurrent_ = open;
+        }
+      }
+    }
+  }
+  for (auto& client : clients) {
+    if (client->fd >= 0) {
+      close(client->fd);
+    }
+  }
+}
@@ -0,0 +1,77 @@
+#ifndef NATIVE_RPC_STANDIN_SERVER_H_
+#define NATIVE_RPC_STANDIN_SERVER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+struct RpcStandInOptions {
+  // 0 picks a free port; see port()
+  uint16_t port = 0;
+  std::string path_prefix = "/rest/v1/rpc/";
+  // Added to every response, plus up to |jitter_ms| more
+  int latency_ms = 0;
+  int jitter_ms = 0;
+  // This fraction of responses takes |tail_ms| more, like a busy database
+  double tail_ratio = 0.0;
+  int tail_ms = 0;
+  // Every n-th request has its connection dropped unanswered; 0 never
+  int drop_every = 0;
+  // Answers with "Connection: close" after this many requests; 0 no limit
+  int max_requests_per_connection = 0;
+  uint32_t seed = 1;
+};
+
+struct RpcStandInReply {
+  int status = 200;
+  std::string body;
+};
+
+// Loopback HTTP/1.1 server that answers PostgREST-style RPC calls
+// (POST <prefix><function>) from a handler, with injected latency. It keeps
+// connections alive and answers pipelined requests in order, their delays
+// overlapping as they would on a real server. Used by the gateway tests and
+// benchmark, and standalone (bench/rpc_standin) to run the app off-line.
+class RpcStandInServer {
+ public:
+  using Handler = std::function<RpcStandInReply(const std::string& function,
+                                                const std::string& body)>;
+
+  RpcStandInServer(RpcStandInOptions options, Handler handler);
+  ~RpcStandInServer();
+
+  RpcStandInServer(const RpcStandInServer&) = delete;
+  RpcStandInServer& operator=(const RpcStandInServer&) = delete;
+
+  bool ok() const { return port_ != 0; }
+  uint16_t port() const { return port_; }
+
+  void set_latency_ms(int ms) { latency_ms_ = ms; }
+
+  uint64_t requests() const { return requests_; }
+  uint64_t connections() const { return connections_; }
+  // Most connections open at once
+  uint64_t max_concurrent() const { return max_concurrent_; }
+
+ private:
+  struct Client;
+
+  void Serve();
+
+  const RpcStandInOptions options_;
+  const Handler handler_;
+  int listen_fd_ = -1;
+  int wake_read_ = -1;
+  int wake_write_ = -1;
+  uint16_t port_ = 0;
+  std::atomic<bool> stop_{false};
+  std::atomic<int> latency_ms_;
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<uint64_t> connections_{0};
+  std::atomic<uint64_t> max_concurrent_{0};
+  std::thread thread_;
+};
+
+#endif  // NATIVE_RPC_STANDIN_SERVER_H_
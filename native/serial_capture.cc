@@ -0,0 +1,170 @@
+#include "native/serial_capture.h"
+
+#include <cstring>
+
+#include "native/file_io.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'H', 'S', 'C', 'A', 'P', '1', '\n'};
+constexpr size_t kFlushBytes = 16 * 1024;
+constexpr auto kFlushInterval =
+    std::chrono::milliseconds(SerialCaptureWriter::kFlushIntervalMs);
+
+void AppendVarint(std::string* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(const char** cursor, const char* end, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *cursor < end; shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(*(*cursor)++);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+SerialCaptureWriter::SerialCaptureWriter() = default;
+
+SerialCaptureWriter::~SerialCaptureWriter() { Close(); }
+
+bool SerialCaptureWriter::Open(const std::string& path) {
+  Close();
+  std::lock_guard<std::mutex> lock(mutex_);
+  fd_ = OpenDataFile(path);
+  if (fd_ < 0) {
+    return false;
+  }
+  if (!TruncateDataFile(fd_, 0)) {
+    CloseDataFile(fd_);
+    fd_ = -1;
+    return false;
+  }
+  start_ = Clock::now();
+  last_flush_ = start_;
+  last_ns_ = 0;
+  chunks_ = 0;
+  bytes_ = 0;
+  failed_ = false;
+  buffer_.assign(kMagic, sizeof(kMagic));
+  AppendPod<int64_t>(&buffer_,
+                     std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count());
+  FlushLocked();
+  return !failed_;
+}
+
+void SerialCaptureWriter::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ < 0) {
+    return;
+  }
+  FlushLocked();
+  CloseDataFile(fd_);
+  fd_ = -1;
+}
+
+bool SerialCaptureWriter::IsOpen() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return fd_ >= 0;
+}
+
+void SerialCaptureWriter::Record(int32_t port, const char* data,
+                                 size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ < 0 || failed_ || size == 0) {
+    return;
+  }
+  // Stamped under the lock, so records are in time order across threads
+  const Clock::time_point now = Clock::now();
+  const int64_t now_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_)
+          .count();
+  AppendVarint(&buffer_, static_cast<uint64_t>(now_ns - last_ns_));
+  AppendVarint(&buffer_, static_cast<uint32_t>(port));
+  AppendVarint(&buffer_, size);
+  buffer_.append(data, size);
+  last_ns_ = now_ns;
+  ++chunks_;
+  bytes_ += size;
+  if (buffer_.size() >= kFlushBytes || now - last_flush_ >= kFlushInterval) {
+    FlushLocked();
+  }
+}
+
+void SerialCaptureWriter::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ >= 0) {
+    FlushLocked();
+  }
+}
+
+uint64_t SerialCaptureWriter::chunks() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return chunks_;
+}
+
+uint64_t SerialCaptureWriter::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+void SerialCaptureWriter::FlushLocked() {
+  last_flush_ = Clock::now();
+  if (buffer_.empty() || failed_) {
+    return;
+  }
+  failed_ = !WriteAll(fd_, buffer_.data(), buffer_.size());
+  buffer_.clear();
+}
+
+bool ReadSerialCapture(const std::string& path, SerialCapture* capture) {
+  *capture = SerialCapture();
+  const int fd = OpenDataFile(path);
+  if (fd < 0) {
+    return false;
+  }
+  std::string contents;
+  const bool read = ReadToEnd(fd, &contents);
+  CloseDataFile(fd);
+  if (!read || contents.size() < sizeof(kMagic) ||
+      std::memcmp(contents.data(), kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+
+  const char* cursor = contents.data() + sizeof(kMagic);
+  const char* const end = contents.data() + contents.size();
+  if (!ReadPod(&cursor, end, &capture->start_unix_us)) {
+    return false;
+  }
+  int64_t time_ns = 0;
+  while (cursor < end) {
+    uint64_t delta_ns = 0;
+    uint64_t port = 0;
+    uint64_t size = 0;
+    if (!ReadVarint(&cursor, end, &delta_ns) ||
+        !ReadVarint(&cursor, end, &port) || !ReadVarint(&cursor, end, &size) ||
+        static_cast<uint64_t>(end - cursor) < size) {
+      capture->truncated = true;
+      break;
+    }
+    time_ns += static_cast<int64_t>(delta_ns);
+    SerialCaptureChunk chunk;
+    chunk.time_ns = time_ns;
+    chunk.port = static_cast<int32_t>(static_cast<uint32_t>(port));
+    chunk.data.assign(cursor, size);
+    cursor += size;
+    capture->chunks.push_back(std::move(chunk));
+  }
+  return true;
+}
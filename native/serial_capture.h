@@ -0,0 +1,91 @@
+#ifndef NATIVE_SERIAL_CAPTURE_H_
+#define NATIVE_SERIAL_CAPTURE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One read of a serial port as it came off the device, terminators and
+// partial frames included.
+struct SerialCaptureChunk {
+  // Nanoseconds since the capture was opened
+  int64_t time_ns = 0;
+  int32_t port = 0;
+  std::string data;
+};
+
+struct SerialCapture {
+  // Wall clock when the capture was opened, us since the epoch
+  int64_t start_unix_us = 0;
+  std::vector<SerialCaptureChunk> chunks;
+  // The last record was cut short (the writer died mid-record); the chunks
+  // before it are intact
+  bool truncated = false;
+};
+
+// Records the raw reads of serial ports to a compact binary file, so the
+// burst patterns of a station (tray scanning, double reads, mixed CR/LF)
+// can be replayed later (bench/serial_replay).
+//
+// The file is a 16-byte header (magic "PHSCAP1\n", then the start wall
+// clock in us) followed by one record per read: the nanoseconds since the
+// previous record, the port id and the byte count as LEB128 varints, then
+// the bytes. A scanner code costs 4-6 bytes on top of its own.
+//
+// Record() may be called from any thread (the main loop and the serial
+// reactor share one writer); records are appended in time order. Writes
+// are buffered; they reach the file once 16 KB are pending, on a Record()
+// kFlushIntervalMs after the last flush, on Flush() and on Close().
+class SerialCaptureWriter {
+ public:
+  // Owners call Flush() this often, so the last reads before the station
+  // goes quiet reach the file without waiting for the next one.
+  static constexpr int kFlushIntervalMs = 256;
+
+  SerialCaptureWriter();
+  ~SerialCaptureWriter();
+
+  SerialCaptureWriter(const SerialCaptureWriter&) = delete;
+  SerialCaptureWriter& operator=(const SerialCaptureWriter&) = delete;
+
+  // Starts a new capture at |path|, replacing any file there.
+  bool Open(const std::string& path);
+  // Writes what is buffered and closes the file.
+  void Close();
+  bool IsOpen() const;
+
+  // Appends one read of |port|, stamped now. Does nothing while closed.
+  void Record(int32_t port, const char* data, size_t size);
+
+  // Writes what is buffered.
+  void Flush();
+
+  uint64_t chunks() const;
+  uint64_t bytes() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Holds mutex_.
+  void FlushLocked();
+
+  mutable std::mutex mutex_;
+  int fd_ = -1;
+  std::string buffer_;
+  Clock::time_point start_;
+  Clock::time_point last_flush_;
+  int64_t last_ns_ = 0;
+  uint64_t chunks_ = 0;
+  uint64_t bytes_ = 0;
+  // A write failed (disk full); recording stops
+  bool failed_ = false;
+};
+
+// Reads a capture written by SerialCaptureWriter. Returns false if |path|
+// cannot be read or is not a capture.
+bool ReadSerialCapture(const std::string& path, SerialCapture* capture);
+
+#endif  // NATIVE_SERIAL_CAPTURE_H_
@@ -0,0 +1,307 @@
+#include "native/serial_filter.h"
+
+#include <algorithm>
+
+#include "native/crc32.h"
+#include "native/file_io.h"
+
+namespace {
+
+constexpr uint32_t kMagic = 0x46535050;  // "PPSF"
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint32_t kNoEntry = UINT32_MAX;
+constexpr size_t kMaxSerialLength = 255;
+constexpr uint32_t kMaxPayload = 512;
+constexpr int kBloomHashes = 4;
+
+size_t RoundUpPowerOfTwo(size_t value, size_t minimum) {
+  size_t result = minimum;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+uint64_t Mix(uint64_t key) {
+  // splitmix64 finalizer, as in RecipeIndex.
+  key ^= key >> 30;
+  key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 27;
+  key *= 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+  return key;
+}
+
+}  // namespace
+
+SerialFilter::SerialFilter(SerialFilterOptions options)
+    : options_(options), fd_(-1) {
+  // ~10 bits per expected serial keeps the false positive rate near 1%.
+  bloom_.assign(RoundUpPowerOfTwo(options_.expected_serials * 10, 4096) / 64,
+                0);
+  table_.assign(RoundUpPowerOfTwo(options_.expected_serials * 2, 64), kNoEntry);
+}
+
+SerialFilter::~SerialFilter() { Close(); }
+
+uint64_t SerialFilter::Hash(int32_t day, int64_t scope,
+                            std::string_view serial) {
+  // FNV-1a over the serial, then mixed with the scope and day.
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : serial) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  hash = Mix(hash ^ static_cast<uint64_t>(scope));
+  return Mix(hash ^ static_cast<uint32_t>(day));
+}
+
+void SerialFilter::BloomAdd(uint64_t hash) {
+  const uint64_t bits = bloom_.size() * 64;
+  const uint64_t step = (hash >> 32) | 1;
+  for (int i = 0; i < kBloomHashes; ++i) {
+    const uint64_t bit = (hash + i * step) & (bits - 1);
+    bloom_[bit >> 6] |= 1ULL << (bit & 63);
+  }
+}
+
+bool SerialFilter::BloomMayContain(uint64_t hash) const {
+  const uint64_t bits = bloom_.size() * 64;
+  const uint64_t step = (hash >> 32) | 1;
+  for (int i = 0; i < kBloomHashes; ++i) {
+    const uint64_t bit = (hash + i * step) & (bits - 1);
+    if ((bloom_[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t SerialFilter::Find(uint64_t hash, int32_t day, int64_t scope,
+                            std::string_view serial) const {
+  const size_t mask = table_.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const uint32_t id = table_[i];
+    if (id == kNoEntry) {
+      return kNoEntry;
+    }
+    const Entry& entry = entries_[id];
+    if (entry.hash == hash && entry.day == day && entry.scope == scope &&
+        std::string_view(arena_.data() + entry.offset, entry.length) ==
+            serial) {
+      return id;
+    }
+  }
+}
+
+void SerialFilter::Insert(uint64_t hash, int32_t day, int64_t scope,
+                          std::string_view serial, SerialState state) {
+  if ((entries_.size() + 1) * 2 > table_.size()) {
+    GrowTable();
+  }
+  const uint32_t id = static_cast<uint32_t>(entries_.size());
+  entries_.push_back(Entry{hash, scope, static_cast<uint32_t>(arena_.size()),
+                           day, static_cast<uint16_t>(serial.size()), state});
+  arena_.append(serial.data(), serial.size());
+
+  const size_t mask = table_.size() - 1;
+  size_t i = hash & mask;
+  while (table_[i] != kNoEntry) {
+    i = (i + 1) & mask;
+  }
+  table_[i] = id;
+  BloomAdd(hash);
+}
+
+void SerialFilter::GrowTable() {
+  table_.assign(table_.size() * 2, kNoEntry);
+  const size_t mask = table_.size() - 1;
+  for (uint32_t id = 0; id < entries_.size(); ++id) {
+    size_t i = entries_[id].hash & mask;
+    while (table_[i] != kNoEntry) {
+      i = (i + 1) & mask;
+    }
+    table_[i] = id;
+  }
+  // Past the expected size the Bloom filter saturates; resize it as well.
+  if (entries_.size() * 10 > bloom_.size() * 64) {
+    bloom_.assign(bloom_.size() * 2, 0);
+    for (const Entry& entry : entries_) {
+      BloomAdd(entry.hash);
+    }
+  }
+}
+
+bool SerialFilter::Load(const std::string& path, int32_t today) {
+  Close();
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  arena_.clear();
+  std::fill(table_.begin(), table_.end(), kNoEntry);
+  std::fill(bloom_.begin(), bloom_.end(), 0);
+  stats_ = SerialFilterStats();
+  if (path.empty()) {
+    return true;
+  }
+  fd_ = OpenDataFile(path);
+  if (fd_ < 0) {
+    return false;
+  }
+  path_ = path;
+
+  std::string data;
+  SeekDataFile(fd_, 0);
+  ReadToEnd(fd_, &data);
+  const char* cursor = data.data();
+  const char* end = cursor + data.size();
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  bool dropped = false;
+  if (ReadPod(&cursor, end, &magic) && ReadPod(&cursor, end, &version) &&
+      magic == kMagic && version == kFormatVersion) {
+    const int32_t oldest = today - options_.retention_days + 1;
+    while (true) {
+      uint32_t length = 0;
+      uint32_t crc = 0;
+      if (!ReadPod(&cursor, end, &length) || !ReadPod(&cursor, end, &crc) ||
+          length > kMaxPayload || static_cast<size_t>(end - cursor) < length ||
+          Crc32(cursor, length) != crc) {
+        // Torn tail of a crashed write, or garbage: keep what came before.
+        dropped = cursor != end;
+        break;
+      }
+      const char* payload = cursor;
+      const char* payload_end = cursor + length;
+      cursor = payload_end;
+
+      int32_t day = 0;
+      int64_t scope = 0;
+      uint8_t state = 0;
+      uint16_t serial_length = 0;
+      if (!ReadPod(&payload, payload_end, &day) ||
+          !ReadPod(&payload, payload_end, &scope) ||
+          !ReadPod(&payload, payload_end, &state) ||
+          !ReadPod(&payload, payload_end, &serial_length) ||
+          static_cast<size_t>(payload_end - payload) != serial_length) {
+        dropped = true;
+        break;
+      }
+      if (day < oldest || day > today) {
+        dropped = true;
+        continue;
+      }
+      const std::string_view serial(payload, serial_length);
+      const uint64_t hash = Hash(day, scope, serial);
+      const uint32_t id = Find(hash, day, scope, serial);
+      if (id == kNoEntry) {
+        Insert(hash, day, scope, serial, static_cast<SerialState>(state));
+        ++stats_.loaded;
+      } else if (state > static_cast<uint8_t>(entries_[id].state)) {
+        entries_[id].state = static_cast<SerialState>(state);
+      }
+    }
+  } else {
+    dropped = true;
+  }
+
+  // Rewrite the log when it held expired days or damage, so it only ever
+  // holds the retention window.
+  if (dropped || data.empty()) {
+    return Rewrite();
+  }
+  return SeekDataFile(fd_, data.size());
+}
+
+bool SerialFilter::Rewrite() {
+  std::string data;
+  AppendPod(&data, kMagic);
+  AppendPod(&data, kFormatVersion);
+  if (!TruncateDataFile(fd_, 0) || !SeekDataFile(fd_, 0) ||
+      !WriteAll(fd_, data.data(), data.size())) {
+    return false;
+  }
+  for (const Entry& entry : entries_) {
+    Append(entry.day, entry.scope,
+           std::string_view(arena_.data() + entry.offset, entry.length),
+           entry.state);
+  }
+  return SyncDataFile(fd_);
+}
+
+void SerialFilter::Append(int32_t day, int64_t scope,
+                          std::string_view serial, SerialState state) {
+  if (fd_ < 0) {
+    return;
+  }
+  std::string payload;
+  AppendPod(&payload, day);
+  AppendPod(&payload, scope);
+  AppendPod(&payload, static_cast<uint8_t>(state));
+  AppendPod(&payload, static_cast<uint16_t>(serial.size()));
+  payload.append(serial.data(), serial.size());
+
+  std::string frame;
+  AppendPod(&frame, static_cast<uint32_t>(payload.size()));
+  AppendPod(&frame, Crc32(payload.data(), payload.size()));
+  frame += payload;
+  // Not fsynced: losing the last entries only means the server gets asked.
+  WriteAll(fd_, frame.data(), frame.size());
+}
+
+void SerialFilter::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ >= 0) {
+    SyncDataFile(fd_);
+    CloseDataFile(fd_);
+    fd_ = -1;
+  }
+  path_.clear();
+}
+
+SerialState SerialFilter::Lookup(int32_t day, int64_t scope,
+                                 std::string_view serial) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.lookups;
+  const uint64_t hash = Hash(day, scope, serial);
+  if (!BloomMayContain(hash)) {
+    ++stats_.bloom_negatives;
+    return SerialState::kUnknown;
+  }
+  const uint32_t id = Find(hash, day, scope, serial);
+  if (id == kNoEntry) {
+    return SerialState::kUnknown;
+  }
+  const SerialState state = entries_[id].state;
+  if (state == SerialState::kConfirmed) {
+    ++stats_.confirmed_hits;
+  } else if (state == SerialState::kPending) {
+    ++stats_.pending_hits;
+  }
+  return state;
+}
+
+void SerialFilter::Record(int32_t day, int64_t scope, std::string_view serial,
+                          SerialState state) {
+  if (serial.empty() || serial.size() > kMaxSerialLength ||
+      state == SerialState::kUnknown) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t hash = Hash(day, scope, serial);
+  const uint32_t id = Find(hash, day, scope, serial);
+  if (id == kNoEntry) {
+    Insert(hash, day, scope, serial, state);
+  } else if (state > entries_[id].state) {
+    entries_[id].state = state;
+  } else {
+    return;
+  }
+  Append(day, scope, serial, state);
+}
+
+SerialFilterStats SerialFilter::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SerialFilterStats stats = stats_;
+  stats.entries = entries_.size();
+  return stats;
+}
@@ -0,0 +1,103 @@
+#ifndef NATIVE_SERIAL_FILTER_H_
+#define NATIVE_SERIAL_FILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What the filter knows about a (day, prescription, pack serial) triple.
+enum class SerialState : uint8_t {
+  // Never scanned: the server decides
+  kUnknown = 0,
+  // Scanned, server answer outstanding: still the server's call
+  kPending = 1,
+  // The server has recorded this serial: a re-scan is a duplicate
+  kConfirmed = 2,
+};
+
+struct SerialFilterOptions {
+  // Days (today included) whose serials are loaded from the file
+  int retention_days = 1;
+  // Sizing hint for the Bloom filter and the table
+  size_t expected_serials = 4096;
+};
+
+struct SerialFilterStats {
+  uint64_t lookups = 0;
+  // Lookups answered by the Bloom filter alone
+  uint64_t bloom_negatives = 0;
+  uint64_t pending_hits = 0;
+  uint64_t confirmed_hits = 0;
+  uint64_t entries = 0;
+  uint64_t loaded = 0;
+};
+
+// Pack serials already seen, scoped per prescription and per day, so that a
+// re-scanned serialized pack is rejected without a server round-trip.
+//
+// Membership is exact: a Bloom filter in front answers most first-time scans
+// without touching the table, and the table compares full serials. Each
+// change is appended to a CRC-framed log that Load() replays, dropping days
+// outside the retention window. All methods are thread-safe.
+class SerialFilter {
+ public:
+  explicit SerialFilter(SerialFilterOptions options = SerialFilterOptions());
+  ~SerialFilter();
+
+  SerialFilter(const SerialFilter&) = delete;
+  SerialFilter& operator=(const SerialFilter&) = delete;
+
+  // Opens the log at |path| and replays the entries of the retained days up
+  // to |today| (a day number, e.g. local days since the epoch). With an
+  // empty path the filter lives in memory only.
+  bool Load(const std::string& path, int32_t today);
+  void Close();
+
+  SerialState Lookup(int32_t day, int64_t scope, std::string_view serial);
+
+  // Raises the state of a serial (kPending -> kConfirmed; never lowers it)
+  // and persists the change.
+  void Record(int32_t day, int64_t scope, std::string_view serial,
+              SerialState state);
+
+  SerialFilterStats GetStats() const;
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    int64_t scope;
+    uint32_t offset;
+    int32_t day;
+    uint16_t length;
+    SerialState state;
+  };
+
+  static uint64_t Hash(int32_t day, int64_t scope, std::string_view serial);
+  void BloomAdd(uint64_t hash);
+  bool BloomMayContain(uint64_t hash) const;
+  // Index into entries_, or UINT32_MAX
+  uint32_t Find(uint64_t hash, int32_t day, int64_t scope,
+                std::string_view serial) const;
+  void Insert(uint64_t hash, int32_t day, int64_t scope,
+              std::string_view serial, SerialState state);
+  void GrowTable();
+  void Append(int32_t day, int64_t scope, std::string_view serial,
+              SerialState state);
+  bool Rewrite();
+
+  mutable std::mutex mutex_;
+  SerialFilterOptions options_;
+  std::string path_;
+  int fd_;
+
+  std::vector<uint64_t> bloom_;
+  std::vector<uint32_t> table_;
+  std::vector<Entry> entries_;
+  std::string arena_;
+  SerialFilterStats stats_;
+};
+
+#endif  // NATIVE_SERIAL_FILTER_H_
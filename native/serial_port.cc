@@ -0,0 +1,235 @@
+#include "native/serial_port.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "native/serial_capture.h"
+
+namespace {
+
+// Write timeout, matching WriteTotalTimeoutConstant on Windows: the whole
+// write, not each wait for room.
+constexpr int kWriteTimeoutMs = 50;
+
+void DrainPipe(int fd) {
+  char drain[64];
+  while (read(fd, drain, sizeof(drain)) > 0) {
+  }
+}
+
+bool BaudToSpeed(int baud_rate, speed_t* speed) {
+  switch (baud_rate) {
+    case 1200: *speed = B1200; return true;
+    case 2400: *speed = B2400; return true;
+    case 4800: *speed = B4800; return true;
+    case 9600: *speed = B9600; return true;
+    case 19200: *speed = B19200; return true;
+    case 38400: *speed = B38400; return true;
+    case 57600: *speed = B57600; return true;
+    case 115200: *speed = B115200; return true;
+    case 230400: *speed = B230400; return true;
+    default: return false;
+  }
+}
+
+}  // namespace
+
+SerialPort::SerialPort() : fd_(-1) {
+  int fds[2];
+  if (pipe(fds) == 0) {
+    for (int fd : fds) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    cancel_read_ = fds[0];
+    cancel_write_ = fds[1];
+  }
+}
+
+SerialPort::~SerialPort() {
+  Close();
+  // No write can be running: the owner is destroying the port
+  if (cancel_read_ >= 0) {
+    close(cancel_read_);
+    close(cancel_write_);
+  }
+}
+
+bool SerialPort::Open(const std::string& device_path, int baud_rate) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseLocked();
+
+  speed_t speed;
+  if (!BaudToSpeed(baud_rate, &speed)) {
+    return false;
+  }
+
+  fd_ = open(device_path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd_ < 0) {
+    return false;
+  }
+
+  struct termios tio = {};
+  if (tcgetattr(fd_, &tio) != 0) {
+    CloseLocked();
+    return false;
+  }
+
+  // Raw mode: no echo, no line discipline, no CR/LF translation
+  cfmakeraw(&tio);
+  tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS);
+  tio.c_cflag |= CS8 | CLOCAL | CREAD;  // 8N1, ignore modem control lines
+  tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+
+  if (tcsetattr(fd_, TCSANOW, &tio) != 0) {
+    CloseLocked();
+    return false;
+  }
+
+  // Clear existing buffers
+  tcflush(fd_, TCIOFLUSH);
+  framer_.Reset();
+  return true;
+}
+
+void SerialPort::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseLocked();
+}
+
+void SerialPort::CloseLocked() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+    generation_.fetch_add(1);
+    if (cancel_write_ >= 0) {
+      // A full pipe already means a cancel is pending
+      const char byte = 1;
+      ssize_t ignored = write(cancel_write_, &byte, 1);
+      (void)ignored;
+    }
+  }
+  framer_.Reset();
+}
+
+void SerialPort::SetFramerOptions(LineFramerOptions options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  framer_ = LineFramer(std::move(options));
+}
+
+bool SerialPort::ReadLines(std::vector<std::string>* lines) {
+  return ReadFrames(
+      [lines](std::string_view frame) { lines->emplace_back(frame); });
+}
+
+bool SerialPort::ReadFrames(
+    const std::function<void(std::string_view)>& on_frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ < 0) {
+    return false;
+  }
+
+  char buffer[4096];
+  while (true) {
+    ssize_t bytes_read = read(fd_, buffer, sizeof(buffer));
+    if (bytes_read > 0) {
+      if (capture_ != nullptr) {
+        capture_->Record(capture_port_, buffer,
+                         static_cast<size_t>(bytes_read));
+      }
+      framer_.Feed(buffer, static_cast<size_t>(bytes_read), on_frame);
+      continue;
+    }
+    if (bytes_read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes_read == 0) {
+      // With VMIN = VTIME = 0 an empty read means either "nothing buffered"
+      // or a hang-up; only poll() can tell them apart.
+      struct pollfd pfd = {fd_, POLLIN, 0};
+      return poll(&pfd, 1, 0) >= 0 && !(pfd.revents & (POLLHUP | POLLERR));
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return true;
+    }
+    // EIO or similar once the device has gone away
+    return false;
+  }
+}
+
+bool SerialPort::WriteData(const std::string& data) {
+  std::lock_guard<std::mutex> write_lock(write_mutex_);
+  if (cancel_read_ >= 0) {
+    // Cancels of earlier closes; this write checks the port itself
+    DrainPipe(cancel_read_);
+  }
+  int fd;
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ < 0) {
+      return false;
+    }
+    // The duplicate stays valid whatever Close() does meanwhile
+    fd = fcntl(fd_, F_DUPFD_CLOEXEC, 0);
+    generation = generation_.load();
+  }
+  if (fd < 0) {
+    return false;
+  }
+  const bool written = WriteTo(fd, data, generation);
+  close(fd);
+  return written;
+}
+
+bool SerialPort::WriteTo(int fd, const std::string& data,
+                         uint64_t generation) {
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(kWriteTimeoutMs);
+  size_t written = 0;
+  while (written < data.size()) {
+    if (generation_.load() != generation) {
+      return false;
+    }
+    ssize_t n = write(fd, data.data() + written, data.size() - written);
+    if (n > 0) {
+      written += static_cast<size_t>(n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (left.count() <= 0) {
+        return false;
+      }
+      struct pollfd fds[2] = {{fd, POLLOUT, 0}, {cancel_read_, POLLIN, 0}};
+      if (poll(fds, cancel_read_ >= 0 ? 2 : 1,
+               static_cast<int>(left.count())) <= 0) {
+        return false;
+      }
+      if (fds[1].revents != 0 && generation_.load() == generation) {
+        // From a close before this write took its descriptor
+        DrainPipe(cancel_read_);
+      }
+      continue;
+    }
+    return false;
+  }
+  return true;
+}
+
+std::string SerialDevicePathForPort(int port_number) {
+  return "/dev/ttyS" + std::to_string(port_number > 0 ? port_number - 1 : 0);
+}
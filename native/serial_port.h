@@ -0,0 +1,104 @@
+#ifndef NATIVE_SERIAL_PORT_H_
+#define NATIVE_SERIAL_PORT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "native/line_framer.h"
+
+class SerialCaptureWriter;
+
+// POSIX serial port configured through termios.
+//
+// The port is opened non-blocking so the owner can watch fd() on its own
+// event loop and call ReadLines() whenever the descriptor becomes readable.
+//
+// Every method may be called from any thread: writes usually run on a
+// worker while reads, and the close after a hang-up, run on the event loop.
+// A write works on its own duplicate of the descriptor and does not hold
+// the lock reads and closes take, so a stalled device never blocks the
+// event loop. Closing the port cancels a write in progress.
+class SerialPort {
+ public:
+  SerialPort();
+  ~SerialPort();
+
+  SerialPort(const SerialPort&) = delete;
+  SerialPort& operator=(const SerialPort&) = delete;
+
+  // Open |device_path| in raw 8N1 mode at |baud_rate|
+  bool Open(const std::string& device_path, int baud_rate = 9600);
+
+  // Close the port
+  void Close();
+
+  // Check if port is open
+  bool IsOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fd_ >= 0;
+  }
+
+  // File descriptor to watch for readability, or -1 when closed
+  int fd() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fd_;
+  }
+
+  // How incoming bytes are cut into frames; resets any partial frame
+  void SetFramerOptions(LineFramerOptions options);
+
+  // Read everything currently available and call |on_frame| for each
+  // complete frame (a view valid only during the call). Returns false once
+  // the device has hung up or failed; the port should be closed then.
+  // |on_frame| runs with the port locked and must not call back into it.
+  bool ReadFrames(const std::function<void(std::string_view)>& on_frame);
+
+  // Records every read to |capture| as port |port_id| before it is framed;
+  // null stops. The writer must outlive the port or be unset first.
+  void SetCapture(SerialCaptureWriter* capture, int32_t port_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capture_ = capture;
+    capture_port_ = port_id;
+  }
+
+  // ReadFrames() collecting copies of the frames into |lines|
+  bool ReadLines(std::vector<std::string>* lines);
+
+  // Writes |data|, giving up after 50 ms in all if the device does not
+  // take it. Returns false then, or if the port is closed meanwhile.
+  // Concurrent writes go out one after the other.
+  bool WriteData(const std::string& data);
+
+ private:
+  void CloseLocked();
+  // Writes to |fd| until done, the deadline, or a close after |generation|
+  bool WriteTo(int fd, const std::string& data, uint64_t generation);
+
+  // Serialises writers; never taken together with mutex_ held
+  std::mutex write_mutex_;
+  // Bumped by every close; a write that sees it change stops
+  std::atomic<uint64_t> generation_{0};
+  // Self-pipe that wakes a write waiting for room when the port closes
+  int cancel_read_ = -1;
+  int cancel_write_ = -1;
+
+  // Guards everything below
+  mutable std::mutex mutex_;
+  int fd_;
+
+  // Carries partial frames between reads
+  LineFramer framer_;
+
+  SerialCaptureWriter* capture_ = nullptr;
+  int32_t capture_port_ = 0;
+};
+
+// Device path used for a Windows-style COM port number (COM1 -> /dev/ttyS0).
+std::string SerialDevicePathForPort(int port_number);
+
+#endif  // NATIVE_SERIAL_PORT_H_
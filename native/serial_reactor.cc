@@ -0,0 +1,370 @@
+#include "native/serial_reactor.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include <algorithm>
+#include <string_view>
+
+#include "native/trace_recorder.h"
+
+namespace {
+
+// Reopen attempts of a port whose device went away
+constexpr std::chrono::seconds kReopenInterval(1);
+
+// Poll-set token of the wake pipe; ports count up from 1
+constexpr uint64_t kWakeToken = 0;
+
+bool SetNonBlocking(int fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+// The descriptors the reactor waits on, each named by a token. Add and
+// Remove may be called while another thread is in Wait.
+class SerialReactor::Poller {
+ public:
+#ifdef __linux__
+  Poller() : epoll_(epoll_create1(EPOLL_CLOEXEC)) {}
+  ~Poller() {
+    if (epoll_ >= 0) {
+      close(epoll_);
+    }
+  }
+
+  bool ok() const { return epoll_ >= 0; }
+
+  bool Add(int fd, uint64_t token) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = token;
+    return epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) == 0;
+  }
+
+  void Remove(int fd) { epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr); }
+
+  // Tokens of the ready descriptors, waiting at most |timeout_ms| (-1:
+  // until one is ready)
+  void Wait(int timeout_ms, std::vector<uint64_t>* tokens) {
+    struct epoll_event events[32];
+    tokens->clear();
+    const int n = epoll_wait(epoll_, events, 32, timeout_ms);
+    for (int i = 0; i < n; ++i) {
+      tokens->push_back(events[i].data.u64);
+    }
+  }
+
+ private:
+  int epoll_;
+#else
+  bool ok() const { return true; }
+
+  bool Add(int fd, uint64_t token) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fds_[fd] = token;
+    return true;
+  }
+
+  void Remove(int fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fds_.erase(fd);
+  }
+
+  // The set is copied per call; the reactor wakes itself after changes.
+  void Wait(int timeout_ms, std::vector<uint64_t>* tokens) {
+    std::vector<pollfd> fds;
+    std::vector<uint64_t> names;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const auto& entry : fds_) {
+        fds.push_back(pollfd{entry.first, POLLIN, 0});
+        names.push_back(entry.second);
+      }
+    }
+    tokens->clear();
+    if (poll(fds.data(), fds.size(), timeout_ms) <= 0) {
+      return;
+    }
+    for (size_t i = 0; i < fds.size(); ++i) {
+      if (fds[i].revents != 0) {
+        tokens->push_back(names[i]);
+      }
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<int, uint64_t> fds_;
+#endif
+};
+
+SerialReactor::SerialReactor(size_t queue_capacity, LinesCallback on_lines)
+    : lines_(queue_capacity, OverflowPolicy::kDropOldest,
+             std::chrono::milliseconds(0)),
+      on_lines_(std::move(on_lines)),
+      poller_(new Poller()) {
+  int fds[2];
+  if (!poller_->ok() || pipe(fds) != 0) {
+    return;
+  }
+  SetNonBlocking(fds[0]);
+  SetNonBlocking(fds[1]);
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  if (!poller_->Add(fds[0], kWakeToken)) {
+    close(fds[0]);
+    close(fds[1]);
+    return;
+  }
+  wake_read_ = fds[0];
+  wake_write_ = fds[1];
+  thread_ = std::thread([this] { Loop(); });
+}
+
+SerialReactor::~SerialReactor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  if (thread_.joinable()) {
+    Wake();
+    thread_.join();
+  }
+  for (auto& entry : ports_) {
+    Detach(entry.second.get());
+  }
+  if (wake_read_ >= 0) {
+    close(wake_read_);
+    close(wake_write_);
+  }
+}
+
+bool SerialReactor::OpenPort(int32_t id, const SerialPortConfig& config) {
+  bool opened = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok() || stopping_) {
+      return false;
+    }
+    std::shared_ptr<Port>& port = ports_[id];
+    if (port) {
+      Detach(port.get());
+    }
+    port = std::make_shared<Port>();
+    port->id = id;
+    port->config = config;
+    opened = Attach(port.get());
+    if (!opened) {
+      if (!config.reopen) {
+        ports_.erase(id);
+        return false;
+      }
+      port->retry_at = Clock::now() + kReopenInterval;
+    }
+  }
+  // Picks up the new descriptor (poll) or retry time
+  Wake();
+  return opened;
+}
+
+bool SerialReactor::ClosePort(int32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ports_.find(id);
+  if (it == ports_.end()) {
+    return false;
+  }
+  Detach(it->second.get());
+  ports_.erase(it);
+  return true;
+}
+
+void SerialReactor::SetCapture(SerialCaptureWriter* capture) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capture_ = capture;
+  for (auto& entry : ports_) {
+    entry.second->serial.SetCapture(capture, entry.first);
+  }
+}
+
+bool SerialReactor::Write(int32_t id, const std::string& data) {
+  std::shared_ptr<Port> port;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ports_.find(id);
+    if (it == ports_.end()) {
+      return false;
+    }
+    port = it->second;
+  }
+  // SerialPort locks itself; a port detached meanwhile just fails the write
+  return port->serial.WriteData(data);
+}
+
+bool SerialReactor::PopLine(SerialLine* line) { return lines_.Pop(line); }
+
+std::vector<int32_t> SerialReactor::PortIds() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<int32_t> ids;
+  for (const auto& entry : ports_) {
+    ids.push_back(entry.first);
+  }
+  return ids;
+}
+
+bool SerialReactor::GetPortConfig(int32_t id, SerialPortConfig* config) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ports_.find(id);
+  if (it == ports_.end()) {
+    return false;
+  }
+  *config = it->second->config;
+  return true;
+}
+
+bool SerialReactor::GetPortStats(int32_t id, SerialPortStats* stats) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ports_.find(id);
+  if (it == ports_.end()) {
+    return false;
+  }
+  *stats = it->second->stats;
+  return true;
+}
+
+void SerialReactor::Wake() {
+  const char byte = 1;
+  // A full pipe already means a wake-up is pending
+  ssize_t ignored = write(wake_write_, &byte, 1);
+  (void)ignored;
+}
+
+bool SerialReactor::Attach(Port* port) {
+  port->serial.SetFramerOptions(port->config.framing);
+  port->serial.SetCapture(capture_, port->id);
+  if (!port->serial.Open(port->config.device_path, port->config.baud_rate)) {
+    port->stats.open = false;
+    return false;
+  }
+  port->token = next_token_++;
+  if (!poller_->Add(port->serial.fd(), port->token)) {
+    port->serial.Close();
+    port->stats.open = false;
+    return false;
+  }
+  by_token_[port->token] = port;
+  port->stats.open = true;
+  return true;
+}
+
+void SerialReactor::Detach(Port* port) {
+  if (port->serial.IsOpen()) {
+    poller_->Remove(port->serial.fd());
+    port->serial.Close();
+  }
+  by_token_.erase(port->token);
+  port->stats.open = false;
+}
+
+bool SerialReactor::Drain(Port* port, int64_t woke_ns) {
+  ++port->stats.reads;
+  bool queued = false;
+  const bool alive = port->serial.ReadFrames(
+      [this, port, woke_ns, &queued](std::string_view frame) {
+        SerialLine line;
+        line.port = port->id;
+        line.text.assign(frame.data(), frame.size());
+        if (woke_ns != 0) {
+          // Timed from the wake-up that completed the frame
+          line.scan_id = TraceRecorder::NextScanId();
+          line.framed_ns = TraceRecorder::NowNs();
+          ProcessTraceRecorder().Record("serial.frame", line.scan_id, woke_ns,
+                                        line.framed_ns);
+        }
+        if (!lines_.Push(std::move(line))) {
+          ++port->stats.dropped;
+        }
+        ++port->stats.lines;
+        port->stats.line_bytes += frame.size();
+        queued = true;
+      });
+  if (queued) {
+    port->stats.last_line_ms = NowMs();
+  }
+  if (!alive) {
+    ++port->stats.hangups;
+    Detach(port);
+    port->retry_at = Clock::now() + kReopenInterval;
+  }
+  return queued;
+}
+
+int SerialReactor::ReopenDue(Clock::time_point now) {
+  int timeout = -1;
+  for (auto& entry : ports_) {
+    Port* port = entry.second.get();
+    if (port->stats.open || !port->config.reopen) {
+      continue;
+    }
+    if (port->retry_at <= now) {
+      if (Attach(port)) {
+        ++port->stats.reopens;
+        continue;
+      }
+      port->retry_at = now + kReopenInterval;
+    }
+    const int wait = static_cast<int>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(port->retry_at -
+                                                              now)
+            .count());
+    timeout = timeout < 0 ? wait : std::min(timeout, wait);
+  }
+  return timeout;
+}
+
+void SerialReactor::Loop() {
+  ProcessTraceRecorder().SetThreadName("serial reactor");
+  std::vector<uint64_t> ready;
+  int timeout = -1;
+  while (true) {
+    poller_->Wait(timeout, &ready);
+    const int64_t woke_ns =
+        ProcessTraceRecorder().enabled() ? TraceRecorder::NowNs() : 0;
+    bool queued = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_) {
+        return;
+      }
+      for (uint64_t token : ready) {
+        if (token == kWakeToken) {
+          char drain[64];
+          while (read(wake_read_, drain, sizeof(drain)) > 0) {
+          }
+          continue;
+        }
+        // Events of a port closed or replaced since the wait are stale
+        auto it = by_token_.find(token);
+        if (it != by_token_.end()) {
+          queued |= Drain(it->second, woke_ns);
+        }
+      }
+      timeout = ReopenDue(Clock::now());
+    }
+    if (queued && on_lines_) {
+      on_lines_();
+    }
+  }
+}
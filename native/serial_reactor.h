@@ -0,0 +1,155 @@
+#ifndef NATIVE_SERIAL_REACTOR_H_
+#define NATIVE_SERIAL_REACTOR_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "native/line_framer.h"
+#include "native/serial_port.h"
+#include "native/spsc_ring.h"
+
+// How one port of a SerialReactor is opened and framed.
+struct SerialPortConfig {
+  std::string device_path;
+  int baud_rate = 9600;
+  LineFramerOptions framing;
+  // Keep trying to reopen the device after it goes away (a USB scanner
+  // unplugged and plugged back in)
+  bool reopen = true;
+};
+
+// Counters of one port since it was added.
+struct SerialPortStats {
+  bool open = false;
+  uint64_t lines = 0;
+  uint64_t line_bytes = 0;
+  // Wake-ups with the port readable
+  uint64_t reads = 0;
+  // Lines of this port that found the queue full, so the oldest queued
+  // line was dropped
+  uint64_t dropped = 0;
+  uint64_t hangups = 0;
+  uint64_t reopens = 0;
+  // Wall clock of the last line, ms since the epoch; 0 if none yet
+  int64_t last_line_ms = 0;
+};
+
+// A frame read from port |port|. While tracing is on it starts a scan:
+// |scan_id| names its spans and |framed_ns| is when it was queued.
+struct SerialLine {
+  int32_t port = 0;
+  std::string text;
+  uint64_t scan_id = 0;
+  int64_t framed_ns = 0;
+};
+
+// Services any number of serial ports from one reactor thread.
+//
+// Each counter station can have several scanners (hand scanner, fixed
+// presentation scanner, ATC line). Instead of a thread or a main-loop watch
+// per port, their descriptors share one epoll set (poll() where epoll is
+// not available). Frames from all ports go into one queue in arrival
+// order, tagged with the id the caller gave the port, and the callback
+// tells the consumer to drain it.
+//
+// Ports are added, replaced and removed from any thread. A port that hangs
+// up is closed and, if configured so, reopened once a second until the
+// device is back.
+class SerialReactor {
+ public:
+  // Runs on the reactor thread after lines were queued; must not block.
+  using LinesCallback = std::function<void()>;
+
+  explicit SerialReactor(size_t queue_capacity = 1024,
+                         LinesCallback on_lines = nullptr);
+  // Closes every port.
+  ~SerialReactor();
+
+  SerialReactor(const SerialReactor&) = delete;
+  SerialReactor& operator=(const SerialReactor&) = delete;
+
+  // False if the reactor thread could not be set up
+  bool ok() const { return wake_write_ >= 0; }
+
+  // Adds port |id|, replacing any port with that id. Returns whether the
+  // device opened; a port configured to reopen stays registered and keeps
+  // trying either way.
+  bool OpenPort(int32_t id, const SerialPortConfig& config);
+
+  // Closes and forgets port |id|. Returns false if there was none.
+  bool ClosePort(int32_t id);
+
+  // Writes |data| to port |id|, giving up after 50 ms if the device does
+  // not take it. The reactor lock is not held meanwhile, and SerialPort
+  // reads and closes do not wait for a write, so every port, this one
+  // included, keeps being read, and ports can be closed or replaced.
+  bool Write(int32_t id, const std::string& data);
+
+  // Records the raw reads of every port, under its id, to |capture| (null
+  // stops). The writer must outlive the reactor or be unset first.
+  void SetCapture(SerialCaptureWriter* capture);
+
+  // Consumer side: the oldest queued line. One consumer thread only.
+  bool PopLine(SerialLine* line);
+
+  std::vector<int32_t> PortIds() const;
+  bool GetPortConfig(int32_t id, SerialPortConfig* config) const;
+  bool GetPortStats(int32_t id, SerialPortStats* stats) const;
+  SpscRingStats GetQueueStats() const { return lines_.GetStats(); }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Port {
+    int32_t id = 0;
+    // Names the port in the poll set; changes on every (re)open so events
+    // of a replaced descriptor are ignored
+    uint64_t token = 0;
+    SerialPortConfig config;
+    SerialPort serial;
+    SerialPortStats stats;
+    Clock::time_point retry_at;
+  };
+
+  class Poller;
+
+  void Loop();
+  void Wake();
+  // Opens |port|'s device and adds it to the poll set. Holds mutex_.
+  bool Attach(Port* port);
+  // Removes |port| from the poll set and closes it. Holds mutex_.
+  void Detach(Port* port);
+  // Reads everything |port| has; returns whether lines were queued.
+  // |woke_ns| is when the reactor woke up, 0 unless tracing.
+  bool Drain(Port* port, int64_t woke_ns);
+  // Reopens ports whose retry time has come; returns the time until the
+  // next retry, or -1 if none is waiting. Holds mutex_.
+  int ReopenDue(Clock::time_point now);
+
+  SpscRing<SerialLine> lines_;
+  LinesCallback on_lines_;
+
+  mutable std::mutex mutex_;
+  // Shared so that Write can use a port outside mutex_ while it is closed
+  // or replaced
+  std::map<int32_t, std::shared_ptr<Port>> ports_;
+  std::unordered_map<uint64_t, Port*> by_token_;
+  uint64_t next_token_ = 1;
+  bool stopping_ = false;
+  SerialCaptureWriter* capture_ = nullptr;
+
+  std::unique_ptr<Poller> poller_;
+  int wake_read_ = -1;
+  int wake_write_ = -1;
+  std::thread thread_;
+};
+
+#endif  // NATIVE_SERIAL_REACTOR_H_
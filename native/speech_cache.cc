@@ -0,0 +1,297 @@
+#include "native/speech_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace {
+
+constexpr int kCommaPauseMs = 150;
+constexpr int kSpacePauseMs = 40;
+// Samples quieter than this at either end of a segment are cut...
+constexpr int kSilenceThreshold = 64;
+// ...except for this much, so joined segments do not click.
+constexpr int kEdgeMarginMs = 5;
+// Cached audio is handed to the sink in pieces this long, so an interrupt
+// is noticed promptly and the sink paces playback.
+constexpr int kChunkMs = 20;
+
+bool IsAsciiDigit(char c) { return c >= '0' && c <= '9'; }
+
+std::string Trim(const std::string& text) {
+  const size_t begin = text.find_first_not_of(' ');
+  if (begin == std::string::npos) {
+    return std::string();
+  }
+  const size_t end = text.find_last_not_of(' ');
+  return text.substr(begin, end - begin + 1);
+}
+
+// Appends |token| cut at digit/non-digit boundaries. A '.' between digits
+// belongs to the number ("21.0").
+void SplitToken(const std::string& token, std::vector<SpeechSegment>* out) {
+  size_t start = 0;
+  for (size_t i = 1; i <= token.size(); ++i) {
+    auto numeric = [&token](size_t at) {
+      return IsAsciiDigit(token[at]) ||
+             (token[at] == '.' && at > 0 && at + 1 < token.size() &&
+              IsAsciiDigit(token[at - 1]) && IsAsciiDigit(token[at + 1]));
+    };
+    if (i == token.size() || numeric(i) != numeric(start)) {
+      out->push_back(SpeechSegment{token.substr(start, i - start), 0});
+      start = i;
+    }
+  }
+}
+
+// Drops silence at both ends of |pcm|, keeping a short margin.
+void TrimSilence(PcmBuffer* pcm, int sample_rate) {
+  auto loud = [](int16_t sample) { return std::abs(sample) >= kSilenceThreshold; };
+  const auto first = std::find_if(pcm->begin(), pcm->end(), loud);
+  if (first == pcm->end()) {
+    pcm->clear();
+    return;
+  }
+  const auto last = std::find_if(pcm->rbegin(), pcm->rend(), loud).base();
+  const ptrdiff_t margin = sample_rate * kEdgeMarginMs / 1000;
+  const ptrdiff_t begin = std::max<ptrdiff_t>(first - pcm->begin() - margin, 0);
+  const ptrdiff_t end = std::min<ptrdiff_t>(last - pcm->begin() + margin,
+                                            static_cast<ptrdiff_t>(pcm->size()));
+  pcm->erase(pcm->begin() + end, pcm->end());
+  pcm->erase(pcm->begin(), pcm->begin() + begin);
+  pcm->shrink_to_fit();
+}
+
+}  // namespace
+
+std::vector<SpeechSegment> SplitSpeechSegments(const std::string& text) {
+  std::vector<SpeechSegment> segments;
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t comma = text.find(',', start);
+    if (comma == std::string::npos) {
+      comma = text.size();
+    }
+    const std::string phrase = Trim(text.substr(start, comma - start));
+    start = comma + 1;
+    if (phrase.empty()) {
+      continue;
+    }
+    if (std::none_of(phrase.begin(), phrase.end(), IsAsciiDigit)) {
+      // Names are spoken as one piece for natural prosody.
+      segments.push_back(SpeechSegment{phrase, 0});
+    } else {
+      size_t token_start = 0;
+      while (token_start < phrase.size()) {
+        size_t space = phrase.find(' ', token_start);
+        if (space == std::string::npos) {
+          space = phrase.size();
+        }
+        if (space > token_start) {
+          SplitToken(phrase.substr(token_start, space - token_start),
+                     &segments);
+          segments.back().pause_ms = kSpacePauseMs;
+        }
+        token_start = space + 1;
+      }
+    }
+    segments.back().pause_ms = kCommaPauseMs;
+  }
+  if (!segments.empty()) {
+    segments.back().pause_ms = 0;
+  }
+  return segments;
+}
+
+SegmentCache::SegmentCache(size_t budget_bytes) : budget_bytes_(budget_bytes) {
+  stats_.budget_bytes = budget_bytes;
+}
+
+std::shared_ptr<const PcmBuffer> SegmentCache::Get(const std::string& text) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(text);
+  if (it == index_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->pcm;
+}
+
+bool SegmentCache::Contains(const std::string& text) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.count(text) > 0;
+}
+
+std::shared_ptr<const PcmBuffer> SegmentCache::Put(const std::string& text,
+                                                   PcmBuffer pcm) {
+  auto shared = std::make_shared<const PcmBuffer>(std::move(pcm));
+  const size_t size = SizeOf(*shared);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(text);
+  if (it != index_.end()) {
+    bytes_ -= SizeOf(*it->second->pcm);
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+  if (size > budget_bytes_) {
+    return shared;
+  }
+  lru_.push_front(Entry{text, shared});
+  index_.emplace(text, lru_.begin());
+  bytes_ += size;
+  while (bytes_ > budget_bytes_) {
+    const Entry& oldest = lru_.back();
+    bytes_ -= SizeOf(*oldest.pcm);
+    index_.erase(oldest.text);
+    lru_.pop_back();
+    ++stats_.evictions;
+  }
+  return shared;
+}
+
+SegmentCacheStats SegmentCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SegmentCacheStats stats = stats_;
+  stats.entries = index_.size();
+  stats.bytes = bytes_;
+  return stats;
+}
+
+CachingSpeechEngine::CachingSpeechEngine(SpeechEngine* inner,
+                                         size_t budget_bytes)
+    : inner_(inner), cache_(budget_bytes) {
+  warmer_ = std::thread([this] { RunWarmer(); });
+}
+
+CachingSpeechEngine::~CachingSpeechEngine() {
+  {
+    std::lock_guard<std::mutex> lock(warm_mutex_);
+    shutdown_ = true;
+  }
+  warm_wake_.notify_all();
+  warmer_.join();
+}
+
+bool CachingSpeechEngine::Synthesize(const std::string& text,
+                                     const AudioCallback& on_audio) {
+  struct SpeakingScope {
+    explicit SpeakingScope(std::atomic<int>* count) : count(count) { ++*count; }
+    ~SpeakingScope() { --*count; }
+    std::atomic<int>* count;
+  } speaking(&speaking_);
+
+  const size_t chunk =
+      static_cast<size_t>(std::max(sample_rate() * kChunkMs / 1000, 1));
+  auto play = [&](const int16_t* samples, size_t count) {
+    for (size_t offset = 0; offset < count; offset += chunk) {
+      if (!on_audio(samples + offset, std::min(chunk, count - offset))) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  PcmBuffer silence;
+  for (const SpeechSegment& segment : SplitSpeechSegments(text)) {
+    std::shared_ptr<const PcmBuffer> pcm = cache_.Get(segment.text);
+    if (pcm == nullptr) {
+      std::lock_guard<std::mutex> lock(engine_mutex_);
+      pcm = RenderLocked(segment.text);
+    }
+    if (pcm == nullptr) {
+      return false;
+    }
+    if (!play(pcm->data(), pcm->size())) {
+      return true;
+    }
+    if (segment.pause_ms > 0) {
+      silence.assign(static_cast<size_t>(sample_rate()) * segment.pause_ms /
+                         1000,
+                     0);
+      if (!play(silence.data(), silence.size())) {
+        return true;
+      }
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<const PcmBuffer> CachingSpeechEngine::RenderLocked(
+    const std::string& text) {
+  PcmBuffer pcm;
+  const bool ok = inner_->Synthesize(
+      text, [&pcm](const int16_t* samples, size_t count) {
+        pcm.insert(pcm.end(), samples, samples + count);
+        return true;
+      });
+  if (!ok) {
+    return nullptr;
+  }
+  TrimSilence(&pcm, inner_->sample_rate());
+  return cache_.Put(text, std::move(pcm));
+}
+
+void CachingSpeechEngine::Warm(const std::vector<std::string>& texts) {
+  {
+    std::lock_guard<std::mutex> lock(warm_mutex_);
+    for (const std::string& text : texts) {
+      for (SpeechSegment& segment : SplitSpeechSegments(text)) {
+        if (!cache_.Contains(segment.text) &&
+            queued_.insert(segment.text).second) {
+          warm_queue_.push_back(std::move(segment.text));
+        }
+      }
+    }
+  }
+  warm_wake_.notify_one();
+}
+
+void CachingSpeechEngine::WaitWarm() {
+  std::unique_lock<std::mutex> lock(warm_mutex_);
+  warm_done_.wait(lock, [this] { return warm_queue_.empty() && !warming_; });
+}
+
+void CachingSpeechEngine::RunWarmer() {
+  std::unique_lock<std::mutex> lock(warm_mutex_);
+  while (true) {
+    warm_wake_.wait(lock, [this] { return shutdown_ || !warm_queue_.empty(); });
+    if (shutdown_) {
+      return;
+    }
+    const std::string text = std::move(warm_queue_.front());
+    warm_queue_.pop_front();
+    queued_.erase(text);
+    warming_ = true;
+    lock.unlock();
+
+    // Leave the engine to announcements; they are what the user waits for.
+    while (speaking_ > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    bool rendered = false;
+    if (!cache_.Contains(text)) {
+      std::lock_guard<std::mutex> engine_lock(engine_mutex_);
+      rendered = RenderLocked(text) != nullptr;
+    }
+
+    lock.lock();
+    warming_ = false;
+    if (rendered) {
+      ++warmed_;
+    }
+    if (warm_queue_.empty()) {
+      warm_done_.notify_all();
+    }
+  }
+}
+
+CachingSpeechEngineStats CachingSpeechEngine::GetStats() const {
+  CachingSpeechEngineStats stats;
+  stats.cache = cache_.GetStats();
+  std::lock_guard<std::mutex> lock(warm_mutex_);
+  stats.warmed = warmed_;
+  stats.warm_pending = warm_queue_.size();
+  return stats;
+}
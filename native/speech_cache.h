@@ -0,0 +1,131 @@
+#ifndef NATIVE_SPEECH_CACHE_H_
+#define NATIVE_SPEECH_CACHE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "native/audio_sink.h"
+#include "native/speech_scheduler.h"
+
+// One piece of an announcement and the silence that follows it.
+struct SpeechSegment {
+  std::string text;
+  int pause_ms = 0;
+};
+
+// Cuts an announcement into cacheable pieces. Comma-separated phrases are
+// kept whole unless they contain digits; those are cut at spaces and at
+// digit/non-digit boundaries, so "1정, 3회, 총 21.0개" becomes
+// 1 / 정 / 3 / 회 / 총 / 21.0 / 개 and every piece repeats across drugs.
+std::vector<SpeechSegment> SplitSpeechSegments(const std::string& text);
+
+struct SegmentCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  uint64_t entries = 0;
+  uint64_t bytes = 0;
+  uint64_t budget_bytes = 0;
+};
+
+// PCM per segment text, least recently used first out once the total size
+// passes the budget. Thread-safe; buffers are shared, so an evicted entry
+// that is being played stays alive until playback ends.
+class SegmentCache {
+ public:
+  explicit SegmentCache(size_t budget_bytes);
+
+  SegmentCache(const SegmentCache&) = delete;
+  SegmentCache& operator=(const SegmentCache&) = delete;
+
+  std::shared_ptr<const PcmBuffer> Get(const std::string& text);
+  bool Contains(const std::string& text) const;
+  // Returns the stored buffer (also when it alone exceeds the budget and is
+  // not kept).
+  std::shared_ptr<const PcmBuffer> Put(const std::string& text, PcmBuffer pcm);
+  SegmentCacheStats GetStats() const;
+
+ private:
+  struct Entry {
+    std::string text;
+    std::shared_ptr<const PcmBuffer> pcm;
+  };
+
+  static size_t SizeOf(const PcmBuffer& pcm) { return pcm.size() * sizeof(int16_t); }
+
+  mutable std::mutex mutex_;
+  const size_t budget_bytes_;
+  size_t bytes_ = 0;
+  // Most recently used at the front
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  SegmentCacheStats stats_;
+};
+
+struct CachingSpeechEngineStats {
+  SegmentCacheStats cache;
+  uint64_t warmed = 0;
+  uint64_t warm_pending = 0;
+};
+
+// SpeechEngine that speaks announcements as concatenated cached segments.
+// A missing segment is synthesized whole by the inner engine, trimmed of
+// its leading and trailing silence, cached and then played.
+//
+// Warm() renders segments on a background thread so that they are cached
+// before they are needed. Speech always wins: the warmer only takes the
+// inner engine between segments and yields while an announcement plays.
+class CachingSpeechEngine : public SpeechEngine {
+ public:
+  // |inner| must outlive this engine.
+  CachingSpeechEngine(SpeechEngine* inner, size_t budget_bytes);
+  ~CachingSpeechEngine() override;
+
+  CachingSpeechEngine(const CachingSpeechEngine&) = delete;
+  CachingSpeechEngine& operator=(const CachingSpeechEngine&) = delete;
+
+  int sample_rate() const override { return inner_->sample_rate(); }
+  bool Synthesize(const std::string& text,
+                  const AudioCallback& on_audio) override;
+
+  // Queues the segments of |texts| that are not cached yet.
+  void Warm(const std::vector<std::string>& texts);
+  // Blocks until the warm queue is empty. For tests.
+  void WaitWarm();
+
+  CachingSpeechEngineStats GetStats() const;
+
+ private:
+  // Synthesizes, trims and caches |text|. Requires engine_mutex_.
+  std::shared_ptr<const PcmBuffer> RenderLocked(const std::string& text);
+  void RunWarmer();
+
+  SpeechEngine* inner_;
+  SegmentCache cache_;
+  // Serializes use of |inner_|; engines such as espeak-ng are not reentrant
+  std::mutex engine_mutex_;
+  std::atomic<int> speaking_{0};
+
+  mutable std::mutex warm_mutex_;
+  std::condition_variable warm_wake_;
+  std::condition_variable warm_done_;
+  std::deque<std::string> warm_queue_;
+  std::unordered_set<std::string> queued_;
+  bool warming_ = false;
+  bool shutdown_ = false;
+  uint64_t warmed_ = 0;
+  std::thread warmer_;
+};
+
+#endif  // NATIVE_SPEECH_CACHE_H_
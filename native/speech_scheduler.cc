@@ -0,0 +1,238 @@
+#include "native/speech_scheduler.h"
+
+#include <algorithm>
+
+bool ParseSpeechPriority(const std::string& name, SpeechPriority* priority) {
+  if (name == "patient") {
+    *priority = SpeechPriority::kPatientName;
+  } else if (name == "drug") {
+    *priority = SpeechPriority::kDrugLine;
+  } else if (name == "error") {
+    *priority = SpeechPriority::kError;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+SpeechScheduler::SpeechScheduler(SpeechEngine* engine, AudioSink* sink,
+                                 SpeechSchedulerOptions options)
+    : engine_(engine), sink_(sink), options_(options) {
+  worker_ = std::thread([this] { Run(); });
+}
+
+SpeechScheduler::~SpeechScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+    for (auto& queue : queues_) {
+      queue.clear();
+    }
+    InterruptLocked();
+  }
+  wake_.notify_all();
+  worker_.join();
+}
+
+uint64_t SpeechScheduler::Speak(const std::string& text,
+                                SpeechPriority priority) {
+  if (text.empty()) {
+    return 0;
+  }
+  return Enqueue(text, priority, nullptr);
+}
+
+uint64_t SpeechScheduler::Play(std::shared_ptr<const PcmBuffer> pcm,
+                               const std::string& label,
+                               SpeechPriority priority) {
+  if (pcm == nullptr || pcm->empty()) {
+    return 0;
+  }
+  return Enqueue(label, priority, std::move(pcm));
+}
+
+uint64_t SpeechScheduler::Enqueue(const std::string& text,
+                                  SpeechPriority priority,
+                                  std::shared_ptr<const PcmBuffer> pcm) {
+  const size_t level = static_cast<size_t>(priority);
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.requested;
+  if (pcm != nullptr) {
+    ++stats_.sounds;
+  }
+
+  if (speaking_ && !cancel_ && current_.text == text &&
+      current_.priority >= priority) {
+    ++stats_.coalesced;
+    return current_.id;
+  }
+  for (size_t i = level; i < kSpeechPriorityCount; ++i) {
+    for (const Utterance& waiting : queues_[i]) {
+      if (waiting.text == text) {
+        ++stats_.coalesced;
+        return waiting.id;
+      }
+    }
+  }
+
+  const bool replaces_patient = options_.patient_name_replaces &&
+                                priority == SpeechPriority::kPatientName;
+  std::deque<Utterance>& queue = queues_[level];
+  if (replaces_patient) {
+    stats_.dropped += queue.size();
+    queue.clear();
+  }
+  if (speaking_ && !cancel_ &&
+      (current_.priority < priority ||
+       (replaces_patient && current_.priority == priority))) {
+    ++stats_.preempted;
+    InterruptLocked();
+  }
+
+  const uint64_t id = next_id_++;
+  queue.push_back(Utterance{id, text, priority, Clock::now(), std::move(pcm)});
+  while (queue.size() > std::max<size_t>(options_.max_pending_per_class, 1)) {
+    queue.pop_front();
+    ++stats_.dropped;
+  }
+  stats_.max_queue_depth =
+      std::max<uint64_t>(stats_.max_queue_depth, QueueDepthLocked());
+  wake_.notify_one();
+  return id;
+}
+
+void SpeechScheduler::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& queue : queues_) {
+    stats_.stopped += queue.size();
+    queue.clear();
+  }
+  if (speaking_ && !cancel_) {
+    ++stats_.stopped;
+    InterruptLocked();
+  }
+  idle_.notify_all();
+}
+
+bool SpeechScheduler::WaitIdle(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return idle_.wait_for(lock, timeout, [this] {
+    return !speaking_ && QueueDepthLocked() == 0;
+  });
+}
+
+SpeechSchedulerStats SpeechScheduler::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SpeechSchedulerStats stats = stats_;
+  stats.queue_depth = QueueDepthLocked();
+  return stats;
+}
+
+size_t SpeechScheduler::QueueDepthLocked() const {
+  size_t depth = 0;
+  for (const auto& queue : queues_) {
+    depth += queue.size();
+  }
+  return depth;
+}
+
+void SpeechScheduler::InterruptLocked() {
+  // The engine sees this at its next audio chunk; the worker clears it
+  // before starting the next utterance.
+  cancel_ = true;
+}
+
+void SpeechScheduler::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock,
+               [this] { return shutdown_ || QueueDepthLocked() > 0; });
+    if (shutdown_) {
+      return;
+    }
+    for (size_t i = kSpeechPriorityCount; i-- > 0;) {
+      if (!queues_[i].empty()) {
+        current_ = std::move(queues_[i].front());
+        queues_[i].pop_front();
+        break;
+      }
+    }
+    speaking_ = true;
+    cancel_ = false;
+    const Utterance utterance = current_;
+
+    lock.unlock();
+    SpeakOne(utterance);
+    lock.lock();
+
+    speaking_ = false;
+    if (QueueDepthLocked() == 0) {
+      idle_.notify_all();
+    }
+  }
+}
+
+void SpeechScheduler::SpeakOne(const Utterance& utterance) {
+  if (options_.queue_delay != nullptr) {
+    options_.queue_delay->Record(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - utterance.requested)
+            .count());
+  }
+  if (!sink_->Begin(engine_->sample_rate())) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.engine_errors;
+    return;
+  }
+  bool first = true;
+  bool sink_ok = true;
+  const SpeechEngine::AudioCallback on_audio =
+      [&](const int16_t* samples, size_t count) {
+        if (cancel_) {
+          return false;
+        }
+        if (first && count > 0) {
+          first = false;
+          const uint64_t us = static_cast<uint64_t>(
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  Clock::now() - utterance.requested)
+                  .count());
+          if (options_.first_audio != nullptr) {
+            options_.first_audio->Record(static_cast<int64_t>(us));
+          }
+          std::lock_guard<std::mutex> lock(mutex_);
+          stats_.last_first_audio_us = us;
+          stats_.max_first_audio_us = std::max(stats_.max_first_audio_us, us);
+          stats_.total_first_audio_us += us;
+          ++stats_.first_audio_count;
+        }
+        sink_ok = sink_->Write(samples, count);
+        return sink_ok && !cancel_;
+      };
+  bool ok = true;
+  if (utterance.pcm != nullptr) {
+    // 20 ms pieces, so an interrupt is noticed promptly
+    const size_t chunk = static_cast<size_t>(
+        std::max(engine_->sample_rate() / 50, 1));
+    const PcmBuffer& pcm = *utterance.pcm;
+    for (size_t offset = 0; offset < pcm.size(); offset += chunk) {
+      if (!on_audio(pcm.data() + offset,
+                    std::min(chunk, pcm.size() - offset))) {
+        break;
+      }
+    }
+  } else {
+    ok = engine_->Synthesize(utterance.text, on_audio);
+  }
+  const bool interrupted = cancel_;
+  sink_->End(!interrupted);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!ok || !sink_ok) {
+    if (!interrupted) {
+      ++stats_.engine_errors;
+    }
+  } else if (!interrupted) {
+    ++stats_.spoken;
+  }
+}
@@ -0,0 +1,158 @@
+#ifndef NATIVE_SPEECH_SCHEDULER_H_
+#define NATIVE_SPEECH_SCHEDULER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "native/audio_sink.h"
+#include "native/metrics_registry.h"
+
+// Text-to-PCM engine (espeak-ng on Linux). Synthesize() runs on the
+// scheduler's thread and hands audio to |on_audio| as it is produced; when
+// |on_audio| returns false the engine must stop as soon as it can.
+class SpeechEngine {
+ public:
+  using AudioCallback = std::function<bool(const int16_t* samples,
+                                           size_t count)>;
+
+  virtual ~SpeechEngine() = default;
+  virtual int sample_rate() const = 0;
+  virtual bool Synthesize(const std::string& text,
+                          const AudioCallback& on_audio) = 0;
+};
+
+// Announcement classes, lowest first. A higher class preempts a lower one
+// that is being spoken and is always dequeued first.
+enum class SpeechPriority : uint8_t {
+  kPatientName = 0,
+  kDrugLine = 1,
+  kError = 2,
+};
+constexpr size_t kSpeechPriorityCount = 3;
+
+// Parses "patient", "drug" or "error". Returns false for anything else.
+bool ParseSpeechPriority(const std::string& name, SpeechPriority* priority);
+
+struct SpeechSchedulerOptions {
+  // Waiting utterances kept per class; the oldest is dropped beyond this,
+  // since a stale drug line is worse than a skipped one.
+  size_t max_pending_per_class = 2;
+  // A new patient name replaces the one being spoken or waiting: only the
+  // current selection is worth announcing.
+  bool patient_name_replaces = true;
+  // If set, receive each utterance's wait from Speak() to the start of its
+  // playback, and from Speak() to its first samples, in microseconds.
+  LatencyHistogram* queue_delay = nullptr;
+  LatencyHistogram* first_audio = nullptr;
+};
+
+struct SpeechSchedulerStats {
+  uint64_t requested = 0;
+  // Of which pre-rendered sounds
+  uint64_t sounds = 0;
+  uint64_t spoken = 0;
+  // Identical to an utterance already waiting or being spoken
+  uint64_t coalesced = 0;
+  // Cut off by a higher class or a newer patient name
+  uint64_t preempted = 0;
+  // Dropped from a full class queue or replaced while waiting
+  uint64_t dropped = 0;
+  // Cleared by Stop()
+  uint64_t stopped = 0;
+  uint64_t engine_errors = 0;
+  uint64_t queue_depth = 0;
+  uint64_t max_queue_depth = 0;
+  // Speak() call to the first samples reaching the sink
+  uint64_t last_first_audio_us = 0;
+  uint64_t max_first_audio_us = 0;
+  uint64_t total_first_audio_us = 0;
+  uint64_t first_audio_count = 0;
+};
+
+// Speaks utterances one at a time on a worker thread, in priority order.
+//
+// Speak() never blocks on synthesis or playback. Rules, in order:
+//  - text equal to the utterance being spoken or waiting in the same or a
+//    higher class is coalesced into it;
+//  - a patient name replaces earlier patient names (if enabled);
+//  - an utterance of a higher class than the one being spoken interrupts it;
+//  - each class keeps at most max_pending_per_class waiting utterances.
+class SpeechScheduler {
+ public:
+  // |engine| and |sink| must outlive the scheduler.
+  SpeechScheduler(SpeechEngine* engine, AudioSink* sink,
+                  SpeechSchedulerOptions options = SpeechSchedulerOptions());
+  ~SpeechScheduler();
+
+  SpeechScheduler(const SpeechScheduler&) = delete;
+  SpeechScheduler& operator=(const SpeechScheduler&) = delete;
+
+  // Returns the id of the utterance that will speak |text|: a new one, or
+  // the one it was coalesced into. Returns 0 for empty text.
+  uint64_t Speak(const std::string& text, SpeechPriority priority);
+
+  // Queues pre-rendered audio (a beep) under the same rules as speech, so it
+  // plays in order with the announcements around it. |label| identifies the
+  // sound for coalescing and must not collide with spoken text.
+  uint64_t Play(std::shared_ptr<const PcmBuffer> pcm, const std::string& label,
+                SpeechPriority priority);
+
+  int sample_rate() const { return engine_->sample_rate(); }
+
+  // Drops everything waiting and interrupts the current utterance.
+  void Stop();
+
+  // Blocks until nothing is waiting or being spoken, or |timeout| passes.
+  bool WaitIdle(std::chrono::milliseconds timeout);
+
+  SpeechSchedulerStats GetStats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Utterance {
+    uint64_t id;
+    std::string text;
+    SpeechPriority priority;
+    Clock::time_point requested;
+    // Played as is instead of synthesizing |text|
+    std::shared_ptr<const PcmBuffer> pcm;
+  };
+
+  uint64_t Enqueue(const std::string& text, SpeechPriority priority,
+                   std::shared_ptr<const PcmBuffer> pcm);
+
+  void Run();
+  void SpeakOne(const Utterance& utterance);
+  size_t QueueDepthLocked() const;
+  void InterruptLocked();
+
+  SpeechEngine* engine_;
+  AudioSink* sink_;
+  const SpeechSchedulerOptions options_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::deque<Utterance> queues_[kSpeechPriorityCount];
+  bool speaking_ = false;
+  Utterance current_;
+  uint64_t next_id_ = 1;
+  bool shutdown_ = false;
+  SpeechSchedulerStats stats_;
+
+  // Read by the engine callback without the lock
+  std::atomic<bool> cancel_{false};
+  std::thread worker_;
+};
+
+#endif  // NATIVE_SPEECH_SCHEDULER_H_
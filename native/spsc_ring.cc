@@ -0,0 +1,26 @@
+#include "native/spsc_ring.h"
+
+bool ParseOverflowPolicy(const std::string& name, OverflowPolicy* policy) {
+  if (name == "dropOldest") {
+    *policy = OverflowPolicy::kDropOldest;
+  } else if (name == "dropNewest") {
+    *policy = OverflowPolicy::kDropNewest;
+  } else if (name == "block") {
+    *policy = OverflowPolicy::kBlock;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* OverflowPolicyName(OverflowPolicy policy) {
+  switch (policy) {
+    case OverflowPolicy::kDropOldest:
+      return "dropOldest";
+    case OverflowPolicy::kDropNewest:
+      return "dropNewest";
+    case OverflowPolicy::kBlock:
+      return "block";
+  }
+  return "dropOldest";
+}
@@ -0,0 +1,240 @@
+#ifndef NATIVE_SPSC_RING_H_
+#define NATIVE_SPSC_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Head/tail padding is intentional.
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4324)
+#endif
+
+// What Push() does when the ring is full.
+enum class OverflowPolicy {
+  // Discard the oldest queued item to make room
+  kDropOldest,
+  // Discard the item being pushed
+  kDropNewest,
+  // Wait up to the block timeout for the consumer, then drop the new item
+  kBlock,
+};
+
+// Counters describing a ring's traffic since construction.
+struct SpscRingStats {
+  uint64_t pushed = 0;
+  uint64_t popped = 0;
+  uint64_t dropped = 0;
+  uint64_t size = 0;
+  uint64_t capacity = 0;
+  uint64_t high_water_mark = 0;
+  // Enqueue-to-dequeue latency of popped items
+  uint64_t total_latency_ns = 0;
+  uint64_t max_latency_ns = 0;
+};
+
+// Bounded single-producer/single-consumer queue.
+//
+// Push() and Pop() do not take locks. Every slot carries a sequence number
+// (as in Vyukov's bounded queue) so that the producer can reclaim the oldest
+// slot under kDropOldest without racing a consumer that is reading it; the
+// two sides only contend on the head index in that case.
+template <typename T>
+class SpscRing {
+ public:
+  // |capacity| is rounded up to a power of two, and to at least 2 so that
+  // "ready" and "free" sequence numbers never coincide.
+  explicit SpscRing(size_t capacity,
+                    OverflowPolicy policy = OverflowPolicy::kDropOldest,
+                    std::chrono::milliseconds block_timeout =
+                        std::chrono::milliseconds(1000))
+      : capacity_(RoundUpPowerOfTwo(capacity)),
+        mask_(capacity_ - 1),
+        policy_(policy),
+        block_timeout_(block_timeout),
+        slots_(new Slot[capacity_]) {
+    for (size_t i = 0; i < capacity_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  size_t capacity() const { return capacity_; }
+  OverflowPolicy policy() const { return policy_; }
+
+  // Producer side. Returns false if an item (new or oldest) was dropped.
+  // |value| is assigned into the slot, so e.g. a std::string_view pushed
+  // into a std::string ring reuses the slot's buffer.
+  template <typename U>
+  bool Push(U&& value) {
+    const uint64_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot = &slots_[pos & mask_];
+    bool dropped_oldest = false;
+
+    if (slot->sequence.load(std::memory_order_acquire) != pos) {
+      // Full: the slot still holds the item pushed |capacity_| ago.
+      switch (policy_) {
+        case OverflowPolicy::kDropNewest:
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        case OverflowPolicy::kBlock:
+          if (!WaitForSlot(slot, pos)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+          }
+          break;
+        case OverflowPolicy::kDropOldest: {
+          uint64_t oldest = pos - capacity_;
+          if (head_.compare_exchange_strong(oldest, oldest + 1,
+                                            std::memory_order_acq_rel)) {
+            // We own the oldest slot now; it is overwritten below.
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            dropped_oldest = true;
+          } else {
+            // The consumer claimed it first and is reading it right now.
+            while (slot->sequence.load(std::memory_order_acquire) != pos) {
+              std::this_thread::yield();
+            }
+          }
+          break;
+        }
+      }
+    }
+
+    slot->value = std::forward<U>(value);
+    slot->enqueued_at = Clock::now();
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    tail_.store(pos + 1, std::memory_order_release);
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+
+    const uint64_t depth = pos + 1 - head_.load(std::memory_order_acquire);
+    uint64_t high = high_water_mark_.load(std::memory_order_relaxed);
+    if (depth > high) {
+      high_water_mark_.store(depth, std::memory_order_relaxed);
+    }
+    return !dropped_oldest;
+  }
+
+  // Consumer side. Returns false if the ring is empty. The item is swapped
+  // out, so the caller's previous buffer goes back into the slot for reuse.
+  bool Pop(T* out) {
+    uint64_t pos = head_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot* slot = &slots_[pos & mask_];
+      if (slot->sequence.load(std::memory_order_acquire) != pos + 1) {
+        return false;
+      }
+      // Claim the slot; fails only if the producer dropped it meanwhile.
+      if (head_.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_acq_rel)) {
+        using std::swap;
+        swap(*out, slot->value);
+        RecordLatency(Clock::now() - slot->enqueued_at);
+        slot->sequence.store(pos + capacity_, std::memory_order_release);
+        popped_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+
+  // Approximate number of queued items
+  size_t Size() const {
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    return tail > head ? static_cast<size_t>(tail - head) : 0;
+  }
+
+  bool Empty() const { return Size() == 0; }
+
+  SpscRingStats GetStats() const {
+    SpscRingStats stats;
+    stats.pushed = pushed_.load(std::memory_order_relaxed);
+    stats.popped = popped_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.size = Size();
+    stats.capacity = capacity_;
+    stats.high_water_mark = high_water_mark_.load(std::memory_order_relaxed);
+    stats.total_latency_ns = total_latency_ns_.load(std::memory_order_relaxed);
+    stats.max_latency_ns = max_latency_ns_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    Clock::time_point enqueued_at;
+    T value;
+  };
+
+  static size_t RoundUpPowerOfTwo(size_t n) {
+    size_t result = 2;
+    while (result < n) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  bool WaitForSlot(Slot* slot, uint64_t pos) {
+    const auto deadline = Clock::now() + block_timeout_;
+    while (slot->sequence.load(std::memory_order_acquire) != pos) {
+      if (Clock::now() >= deadline) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+  }
+
+  // Only the consumer writes these, so plain load/store is enough.
+  void RecordLatency(Clock::duration latency) {
+    const uint64_t ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+    total_latency_ns_.store(
+        total_latency_ns_.load(std::memory_order_relaxed) + ns,
+        std::memory_order_relaxed);
+    if (ns > max_latency_ns_.load(std::memory_order_relaxed)) {
+      max_latency_ns_.store(ns, std::memory_order_relaxed);
+    }
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  const OverflowPolicy policy_;
+  const std::chrono::milliseconds block_timeout_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // Head and tail live on separate cache lines to avoid false sharing.
+  alignas(64) std::atomic<uint64_t> head_{0};
+  alignas(64) std::atomic<uint64_t> tail_{0};
+
+  alignas(64) std::atomic<uint64_t> pushed_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> high_water_mark_{0};
+  alignas(64) std::atomic<uint64_t> popped_{0};
+  std::atomic<uint64_t> total_latency_ns_{0};
+  std::atomic<uint64_t> max_latency_ns_{0};
+};
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+// Parses the channel spelling of a policy ("dropOldest", "dropNewest",
+// "block"). Returns false for anything else.
+bool ParseOverflowPolicy(const std::string& name, OverflowPolicy* policy);
+
+// Channel spelling of |policy|.
+const char* OverflowPolicyName(OverflowPolicy policy);
+
+#endif  // NATIVE_SPSC_RING_H_
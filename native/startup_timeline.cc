@@ -0,0 +1,244 @@
+#include "native/startup_timeline.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// How long this process has existed, from the start time in
+// /proc/self/stat. Its resolution is one clock tick (usually 10 ms).
+bool ProcessAgeUs(int64_t* age_us) {
+#ifdef __linux__
+  std::ifstream file("/proc/self/stat");
+  std::string content;
+  if (!std::getline(file, content)) {
+    return false;
+  }
+  // The command name may contain spaces; fields resume after its ')'.
+  const size_t paren = content.rfind(')');
+  if (paren == std::string::npos) {
+    return false;
+  }
+  std::istringstream fields(content.substr(paren + 1));
+  std::string field;
+  // starttime is field 22; field 3 (state) follows the name.
+  for (int i = 3; i <= 22; ++i) {
+    if (!(fields >> field)) {
+      return false;
+    }
+  }
+  const long ticks_per_second = sysconf(_SC_CLK_TCK);
+  timespec now;
+  if (ticks_per_second <= 0 || clock_gettime(CLOCK_BOOTTIME, &now) != 0) {
+    return false;
+  }
+  const int64_t start_us = static_cast<int64_t>(
+      std::strtoull(field.c_str(), nullptr, 10) * 1000000 / ticks_per_second);
+  const int64_t now_us =
+      static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+  *age_us = now_us - start_us;
+  return *age_us >= 0;
+#else
+  return false;
+#endif
+}
+
+void SkipSpace(const std::string& text, size_t* pos) {
+  while (*pos < text.size() &&
+         std::isspace(static_cast<unsigned char>(text[*pos]))) {
+    ++*pos;
+  }
+}
+
+// Consumes |token| after optional whitespace.
+bool Expect(const std::string& text, size_t* pos, const char* token) {
+  SkipSpace(text, pos);
+  const size_t length = std::char_traits<char>::length(token);
+  if (text.compare(*pos, length, token) != 0) {
+    return false;
+  }
+  *pos += length;
+  return true;
+}
+
+bool ReadString(const std::string& text, size_t* pos, std::string* out) {
+  if (!Expect(text, pos, "\"")) {
+    return false;
+  }
+  out->clear();
+  while (*pos < text.size() && text[*pos] != '"') {
+    if (text[*pos] == '\\' && *pos + 1 < text.size()) {
+      ++*pos;
+    }
+    out->push_back(text[(*pos)++]);
+  }
+  return Expect(text, pos, "\"");
+}
+
+bool ReadInt(const std::string& text, size_t* pos, int64_t* out) {
+  SkipSpace(text, pos);
+  const char* start = text.c_str() + *pos;
+  char* end = nullptr;
+  *out = std::strtoll(start, &end, 10);
+  if (end == start) {
+    return false;
+  }
+  *pos += end - start;
+  return true;
+}
+
+void AppendEscaped(const std::string& value, std::string* out) {
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+    }
+    out->push_back(c);
+  }
+}
+
+// Nearest-rank percentile of sorted |values|
+int64_t Percentile(const std::vector<int64_t>& values, int percent) {
+  const size_t rank = (values.size() * percent + 99) / 100;
+  return values[rank > 0 ? rank - 1 : 0];
+}
+
+}  // namespace
+
+StartupTimeline::StartupTimeline() : origin_(Clock::now()) {
+  has_process_start_ = ProcessAgeUs(&origin_us_);
+  if (!has_process_start_) {
+    origin_us_ = 0;
+  }
+}
+
+void StartupTimeline::Mark(const std::string& name) {
+  const int64_t us =
+      origin_us_ + std::chrono::duration_cast<std::chrono::microseconds>(
+                       Clock::now() - origin_)
+                       .count();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const StartupMark& mark : marks_) {
+    if (mark.name == name) {
+      return;
+    }
+  }
+  marks_.push_back(StartupMark{name, us});
+}
+
+int64_t StartupTimeline::Get(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const StartupMark& mark : marks_) {
+    if (mark.name == name) {
+      return mark.us;
+    }
+  }
+  return -1;
+}
+
+std::vector<StartupMark> StartupTimeline::Marks() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return marks_;
+}
+
+std::string StartupTimeline::ToJson() const {
+  std::string json = "{\"process_start\":";
+  json += has_process_start_ ? "true" : "false";
+  json += ",\"marks\":[";
+  const std::vector<StartupMark> marks = Marks();
+  for (size_t i = 0; i < marks.size(); ++i) {
+    json += i == 0 ? "{\"name\":\"" : ",{\"name\":\"";
+    AppendEscaped(marks[i].name, &json);
+    json += "\",\"us\":" + std::to_string(marks[i].us) + "}";
+  }
+  json += "]}";
+  return json;
+}
+
+std::string StartupTimeline::ToText() const {
+  std::ostringstream out;
+  out << "startup (ms since "
+      << (has_process_start_ ? "process start" : "main") << ")\n";
+  int64_t previous = 0;
+  for (const StartupMark& mark : Marks()) {
+    out << "  " << std::left << std::setw(24) << mark.name << std::right
+        << std::fixed << std::setprecision(1) << std::setw(9)
+        << mark.us / 1000.0 << "  +" << (mark.us - previous) / 1000.0
+        << "\n";
+    previous = mark.us;
+  }
+  return out.str();
+}
+
+StartupTimeline& ProcessStartupTimeline() {
+  static StartupTimeline* timeline = new StartupTimeline();
+  return *timeline;
+}
+
+bool ParseStartupTimeline(const std::string& json,
+                          std::vector<StartupMark>* marks) {
+  marks->clear();
+  size_t pos = 0;
+  if (!Expect(json, &pos, "{") || !Expect(json, &pos, "\"process_start\"") ||
+      !Expect(json, &pos, ":") ||
+      !(Expect(json, &pos, "true") || Expect(json, &pos, "false")) ||
+      !Expect(json, &pos, ",") || !Expect(json, &pos, "\"marks\"") ||
+      !Expect(json, &pos, ":") || !Expect(json, &pos, "[")) {
+    return false;
+  }
+  if (Expect(json, &pos, "]")) {
+    return Expect(json, &pos, "}");
+  }
+  do {
+    StartupMark mark;
+    if (!Expect(json, &pos, "{") || !Expect(json, &pos, "\"name\"") ||
+        !Expect(json, &pos, ":") || !ReadString(json, &pos, &mark.name) ||
+        !Expect(json, &pos, ",") || !Expect(json, &pos, "\"us\"") ||
+        !Expect(json, &pos, ":") || !ReadInt(json, &pos, &mark.us) ||
+        !Expect(json, &pos, "}")) {
+      return false;
+    }
+    marks->push_back(std::move(mark));
+  } while (Expect(json, &pos, ","));
+  return Expect(json, &pos, "]") && Expect(json, &pos, "}");
+}
+
+std::vector<StartupPhaseSummary> SummarizeStartups(
+    const std::vector<std::vector<StartupMark>>& runs) {
+  std::vector<std::string> order;
+  std::vector<std::vector<int64_t>> samples;
+  for (const std::vector<StartupMark>& run : runs) {
+    for (const StartupMark& mark : run) {
+      auto it = std::find(order.begin(), order.end(), mark.name);
+      if (it == order.end()) {
+        order.push_back(mark.name);
+        samples.emplace_back();
+        it = order.end() - 1;
+      }
+      samples[it - order.begin()].push_back(mark.us);
+    }
+  }
+
+  std::vector<StartupPhaseSummary> summaries;
+  for (size_t i = 0; i < order.size(); ++i) {
+    std::vector<int64_t>& values = samples[i];
+    std::sort(values.begin(), values.end());
+    StartupPhaseSummary summary;
+    summary.name = order[i];
+    summary.runs = values.size();
+    summary.min_us = values.front();
+    summary.median_us = Percentile(values, 50);
+    summary.p90_us = Percentile(values, 90);
+    summary.max_us = values.back();
+    summaries.push_back(std::move(summary));
+  }
+  return summaries;
+}
@@ -0,0 +1,74 @@
+#ifndef NATIVE_STARTUP_TIMELINE_H_
+#define NATIVE_STARTUP_TIMELINE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct StartupMark {
+  std::string name;
+  // Monotonic time since the process was started
+  int64_t us = 0;
+};
+
+// Monotonic timestamps of the startup phases of one run, from process start
+// to the first frame and whatever the app marks after that.
+//
+// Times are measured from the process start time the kernel reports, so
+// the cost of exec and of loading the engine shows up before the first
+// mark. Where that is unknown they are measured from construction. All
+// methods are thread-safe.
+class StartupTimeline {
+ public:
+  StartupTimeline();
+
+  // Records |name| now. A phase marked twice keeps its first time.
+  void Mark(const std::string& name);
+
+  // Time of |name|, or -1 if it was not marked
+  int64_t Get(const std::string& name) const;
+  std::vector<StartupMark> Marks() const;
+  // False when times count from construction instead of process start
+  bool has_process_start() const { return has_process_start_; }
+
+  // One line: {"process_start":true,"marks":[{"name":"main","us":1234},...]}
+  std::string ToJson() const;
+  // A table of phases with their time and the gap since the previous one
+  std::string ToText() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point origin_;
+  // Process age at |origin_|
+  int64_t origin_us_ = 0;
+  bool has_process_start_ = false;
+  mutable std::mutex mutex_;
+  std::vector<StartupMark> marks_;
+};
+
+// The timeline of this process; created by its first use, which should be
+// the first line of main().
+StartupTimeline& ProcessStartupTimeline();
+
+// Parses ToJson() output. Returns false on anything else.
+bool ParseStartupTimeline(const std::string& json,
+                          std::vector<StartupMark>* marks);
+
+// Distribution of each phase over several runs.
+struct StartupPhaseSummary {
+  std::string name;
+  size_t runs = 0;
+  int64_t min_us = 0;
+  int64_t median_us = 0;
+  int64_t p90_us = 0;
+  int64_t max_us = 0;
+};
+
+// Phases in the order they were first seen across |runs|.
+std::vector<StartupPhaseSummary> SummarizeStartups(
+    const std::vector<std::vector<StartupMark>>& runs);
+
+#endif  // NATIVE_STARTUP_TIMELINE_H_
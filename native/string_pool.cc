@@ -0,0 +1,74 @@
+#include "native/string_pool.h"
+
+namespace {
+
+constexpr size_t kInitialSlots = 64;
+
+size_t HashBytes(std::string_view value) {
+  // FNV-1a; the strings are short names and codes.
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : value) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+}  // namespace
+
+StringPool::StringPool() { Clear(); }
+
+void StringPool::Clear() {
+  bytes_.assign(1, '\0');
+  offsets_.assign(1, 0);
+  slots_.assign(kInitialSlots, kNoId);
+}
+
+uint32_t StringPool::Intern(std::string_view value) {
+  if (value.empty()) {
+    return kEmpty;
+  }
+  if ((offsets_.size() + 1) * 2 > slots_.size()) {
+    Grow();
+  }
+  const size_t mask = slots_.size() - 1;
+  size_t i = HashBytes(value) & mask;
+  for (; slots_[i] != kNoId; i = (i + 1) & mask) {
+    if (Get(slots_[i]) == value) {
+      return slots_[i];
+    }
+  }
+  const uint32_t id = static_cast<uint32_t>(offsets_.size());
+  offsets_.push_back(static_cast<uint32_t>(bytes_.size()));
+  bytes_.insert(bytes_.end(), value.begin(), value.end());
+  bytes_.push_back('\0');
+  slots_[i] = id;
+  return id;
+}
+
+std::string_view StringPool::Get(uint32_t id) const {
+  if (id >= offsets_.size()) {
+    return std::string_view();
+  }
+  const size_t end =
+      id + 1 < offsets_.size() ? offsets_[id + 1] : bytes_.size();
+  // Minus the NUL
+  return std::string_view(bytes_.data() + offsets_[id],
+                          end - offsets_[id] - 1);
+}
+
+void StringPool::Grow() {
+  std::vector<uint32_t> old(slots_.size() * 2, kNoId);
+  old.swap(slots_);
+  const size_t mask = slots_.size() - 1;
+  for (uint32_t id : old) {
+    if (id == kNoId) {
+      continue;
+    }
+    size_t i = HashBytes(Get(id)) & mask;
+    while (slots_[i] != kNoId) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = id;
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef NATIVE_STRING_POOL_H_
+#define NATIVE_STRING_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Interns strings as dense 32-bit ids.
+//
+// The bytes of every distinct string live back to back in one buffer, each
+// followed by a NUL, so a pool of drug names or locations repeated over
+// thousands of rows costs one copy of each plus an id per row. Id 0 is the
+// empty string. Views returned by Get() stay valid until the next Intern()
+// or Clear().
+class StringPool {
+ public:
+  static constexpr uint32_t kEmpty = 0;
+
+  StringPool();
+
+  // Drops every string but the empty one.
+  void Clear();
+
+  // Id of |value|, adding it if it is new.
+  uint32_t Intern(std::string_view value);
+
+  // The string with |id|, or an empty view for an unknown id.
+  std::string_view Get(uint32_t id) const;
+
+  // Number of distinct strings, counting the empty one
+  size_t size() const { return offsets_.size(); }
+  // Bytes held for the strings, NULs included
+  size_t bytes() const { return bytes_.size(); }
+
+ private:
+  static constexpr uint32_t kNoId = UINT32_MAX;
+
+  void Grow();
+
+  std::vector<char> bytes_;
+  // Per id: offset of its first byte in |bytes_|
+  std::vector<uint32_t> offsets_;
+  // Open-addressing table of ids, kNoId marking an empty slot
+  std::vector<uint32_t> slots_;
+};
+
+#endif  // NATIVE_STRING_POOL_H_
@@ -0,0 +1,264 @@
+#include "native/task_executor.h"
+
+#include <algorithm>
+
+namespace {
+
+uint64_t ToMicros(std::chrono::steady_clock::duration duration) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+void AddSample(uint64_t us, uint64_t* total, uint64_t* max) {
+  *total += us;
+  *max = std::max(*max, us);
+}
+
+}  // namespace
+
+TaskExecutor::TaskExecutor(TaskExecutorOptions options)
+    : options_(std::move(options)) {
+  const size_t threads = std::max<size_t>(options_.threads, 1);
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back(&TaskExecutor::WorkerLoop, this);
+  }
+}
+
+TaskExecutor::~TaskExecutor() {
+  std::vector<Item> cancelled;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    for (auto& entry : strands_) {
+      TakeWaiting(&entry.second, 0, &cancelled);
+    }
+  }
+  work_cv_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  RunCancelled(&cancelled);
+}
+
+uint64_t TaskExecutor::Post(const std::string& strand, Task task,
+                            Task on_cancel) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const uint64_t id = next_id_++;
+  if (stopping_) {
+    lock.unlock();
+    if (on_cancel) {
+      on_cancel();
+    }
+    return id;
+  }
+  Strand& target = strands_[strand];
+  target.items.push_back(
+      Item{id, std::move(task), std::move(on_cancel), Clock::now()});
+  ++target.stats.posted;
+  ++target.stats.pending;
+  ++outstanding_;
+  if (!target.scheduled) {
+    target.scheduled = true;
+    ready_.push_back(&target);
+    lock.unlock();
+    work_cv_.notify_one();
+  }
+  return id;
+}
+
+void TaskExecutor::TakeWaiting(Strand* strand, uint64_t id,
+                               std::vector<Item>* out) {
+  auto keep = std::stable_partition(
+      strand->items.begin(), strand->items.end(),
+      [id](const Item& item) { return id != 0 && item.id != id; });
+  const size_t taken = strand->items.end() - keep;
+  for (auto it = keep; it != strand->items.end(); ++it) {
+    out->push_back(std::move(*it));
+  }
+  strand->items.erase(keep, strand->items.end());
+  strand->stats.cancelled += taken;
+  strand->stats.pending -= taken;
+  outstanding_ -= taken;
+  // A strand left in ready_ with nothing waiting is skipped by the workers.
+  if (outstanding_ == 0) {
+    idle_cv_.notify_all();
+  }
+}
+
+void TaskExecutor::RunCancelled(std::vector<Item>* items) {
+  for (Item& item : *items) {
+    if (item.on_cancel) {
+      item.on_cancel();
+    }
+  }
+  items->clear();
+}
+
+bool TaskExecutor::Cancel(uint64_t id) {
+  std::vector<Item> cancelled;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : strands_) {
+      TakeWaiting(&entry.second, id, &cancelled);
+      if (!cancelled.empty()) {
+        break;
+      }
+    }
+  }
+  const bool found = !cancelled.empty();
+  RunCancelled(&cancelled);
+  return found;
+}
+
+size_t TaskExecutor::CancelStrand(const std::string& strand) {
+  std::vector<Item> cancelled;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = strands_.find(strand);
+    if (it != strands_.end()) {
+      TakeWaiting(&it->second, 0, &cancelled);
+    }
+  }
+  const size_t count = cancelled.size();
+  RunCancelled(&cancelled);
+  return count;
+}
+
+void TaskExecutor::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this] { return outstanding_ == 0; });
+}
+
+void TaskExecutor::WorkerLoop() {
+  if (options_.on_thread_start) {
+    options_.on_thread_start();
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+    if (ready_.empty()) {
+      break;
+    }
+    Strand* strand = ready_.front();
+    ready_.pop_front();
+    if (strand->items.empty()) {
+      // Everything it had was cancelled.
+      strand->scheduled = false;
+      continue;
+    }
+    Item item = std::move(strand->items.front());
+    strand->items.pop_front();
+
+    const Clock::time_point start = Clock::now();
+    AddSample(ToMicros(start - item.posted), &strand->stats.total_queue_us,
+              &strand->stats.max_queue_us);
+    lock.unlock();
+    item.task();
+    item = Item();
+    const Clock::time_point end = Clock::now();
+    lock.lock();
+
+    AddSample(ToMicros(end - start), &strand->stats.total_run_us,
+              &strand->stats.max_run_us);
+    ++strand->stats.executed;
+    --strand->stats.pending;
+    // Back of the line: one busy strand cannot starve the others.
+    if (strand->items.empty()) {
+      strand->scheduled = false;
+    } else {
+      ready_.push_back(strand);
+      work_cv_.notify_one();
+    }
+    if (--outstanding_ == 0) {
+      idle_cv_.notify_all();
+    }
+  }
+  lock.unlock();
+  if (options_.on_thread_exit) {
+    options_.on_thread_exit();
+  }
+}
+
+TaskQueueStats TaskExecutor::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  TaskQueueStats total;
+  for (const auto& entry : strands_) {
+    const TaskQueueStats& stats = entry.second.stats;
+    total.posted += stats.posted;
+    total.executed += stats.executed;
+    total.cancelled += stats.cancelled;
+    total.pending += stats.pending;
+    total.total_queue_us += stats.total_queue_us;
+    total.max_queue_us = std::max(total.max_queue_us, stats.max_queue_us);
+    total.total_run_us += stats.total_run_us;
+    total.max_run_us = std::max(total.max_run_us, stats.max_run_us);
+  }
+  return total;
+}
+
+std::map<std::string, TaskQueueStats> TaskExecutor::GetStrandStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, TaskQueueStats> result;
+  for (const auto& entry : strands_) {
+    result.emplace(entry.first, entry.second.stats);
+  }
+  return result;
+}
+
+MainThreadQueue::MainThreadQueue(std::function<void()> wake)
+    : wake_(std::move(wake)) {}
+
+void MainThreadQueue::Post(std::function<void()> completion) {
+  bool was_empty;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    was_empty = queue_.empty();
+    queue_.push_back(Completion{std::move(completion), Clock::now()});
+    ++stats_.posted;
+  }
+  // One wake-up per batch; Drain() takes the whole batch.
+  if (was_empty && wake_) {
+    wake_();
+  }
+}
+
+size_t MainThreadQueue::Drain() {
+  std::vector<Completion> batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch.swap(queue_);
+  }
+  for (Completion& completion : batch) {
+    const Clock::time_point start = Clock::now();
+    completion.run();
+    const Clock::time_point end = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.completed;
+    AddSample(ToMicros(start - completion.posted), &stats_.total_latency_us,
+              &stats_.max_latency_us);
+    const uint64_t busy = ToMicros(end - start);
+    stats_.max_busy_us = std::max(stats_.max_busy_us, busy);
+    if (busy > kFrameBudgetUs) {
+      ++stats_.busy_over_frame;
+    }
+  }
+  return batch.size();
+}
+
+void MainThreadQueue::RecordBusy(Clock::duration busy) {
+  const uint64_t us = ToMicros(busy);
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.max_busy_us = std::max(stats_.max_busy_us, us);
+  if (us > kFrameBudgetUs) {
+    ++stats_.busy_over_frame;
+  }
+}
+
+MainThreadQueue::BusyScope::~BusyScope() {
+  queue_->RecordBusy(std::chrono::steady_clock::now() - start_);
+}
+
+MainThreadQueueStats MainThreadQueue::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
@@ -0,0 +1,173 @@
+#ifndef NATIVE_TASK_EXECUTOR_H_
+#define NATIVE_TASK_EXECUTOR_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TaskExecutorOptions {
+  size_t threads = 2;
+  // Run on every worker thread before its first task and after its last,
+  // e.g. to enter and leave a COM apartment.
+  std::function<void()> on_thread_start;
+  std::function<void()> on_thread_exit;
+};
+
+// Counters of one strand, or of all strands together.
+struct TaskQueueStats {
+  uint64_t posted = 0;
+  uint64_t executed = 0;
+  uint64_t cancelled = 0;
+  // Waiting or running
+  uint64_t pending = 0;
+  // Post-to-start latency
+  uint64_t total_queue_us = 0;
+  uint64_t max_queue_us = 0;
+  uint64_t total_run_us = 0;
+  uint64_t max_run_us = 0;
+};
+
+// Worker pool shared by the native services behind the platform channels.
+//
+// Tasks are posted to a named strand, one per service ("comport", "tts").
+// Tasks of a strand run one at a time in the order they were posted, so a
+// service needs no locking of its own; different strands run in parallel,
+// so a slow serial write does not hold up speech.
+class TaskExecutor {
+ public:
+  using Task = std::function<void()>;
+
+  explicit TaskExecutor(TaskExecutorOptions options = TaskExecutorOptions());
+  // Cancels waiting tasks, waits for running ones and joins the workers.
+  ~TaskExecutor();
+
+  TaskExecutor(const TaskExecutor&) = delete;
+  TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+  // Queues |task| on |strand| and returns its id. If the task is cancelled
+  // before it starts, |on_cancel| runs instead, on the cancelling thread.
+  uint64_t Post(const std::string& strand, Task task, Task on_cancel = nullptr);
+
+  // Cancels a task that has not started. Returns false if it has started,
+  // finished or never existed.
+  bool Cancel(uint64_t id);
+  // Cancels every waiting task of |strand|; returns how many.
+  size_t CancelStrand(const std::string& strand);
+
+  // Blocks until no task is waiting or running.
+  void WaitIdle();
+
+  TaskQueueStats GetStats() const;
+  std::map<std::string, TaskQueueStats> GetStrandStats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Item {
+    uint64_t id;
+    Task task;
+    Task on_cancel;
+    Clock::time_point posted;
+  };
+
+  struct Strand {
+    std::deque<Item> items;
+    // A worker is running one of its tasks, or it is in ready_
+    bool scheduled = false;
+    TaskQueueStats stats;
+  };
+
+  void WorkerLoop();
+  // Drops the waiting items of |strand| matching |id| (0: all) into |out|.
+  void TakeWaiting(Strand* strand, uint64_t id, std::vector<Item>* out);
+  void RunCancelled(std::vector<Item>* items);
+
+  const TaskExecutorOptions options_;
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+  bool stopping_ = false;
+  uint64_t next_id_ = 1;
+  uint64_t outstanding_ = 0;
+  // Ordered so that stats come out sorted by name
+  std::map<std::string, Strand> strands_;
+  // Strands with waiting tasks and no running one, in turn order
+  std::deque<Strand*> ready_;
+  std::vector<std::thread> workers_;
+};
+
+struct MainThreadQueueStats {
+  uint64_t posted = 0;
+  uint64_t completed = 0;
+  // Post-to-run latency of completions
+  uint64_t total_latency_us = 0;
+  uint64_t max_latency_us = 0;
+  // Longest single stretch the platform thread spent in a channel handler
+  // or a completion
+  uint64_t max_busy_us = 0;
+  uint64_t busy_over_frame = 0;
+};
+
+// Hands results from worker threads back to the platform thread, the only
+// thread allowed to answer a method call.
+class MainThreadQueue {
+ public:
+  // One 60 Hz frame: platform thread work longer than this drops a frame.
+  static constexpr uint64_t kFrameBudgetUs = 16667;
+
+  // |wake| is called from any thread when the queue stops being empty. It
+  // must arrange for Drain() to run on the platform thread (PostMessage,
+  // g_idle_add) and must not block.
+  explicit MainThreadQueue(std::function<void()> wake);
+
+  MainThreadQueue(const MainThreadQueue&) = delete;
+  MainThreadQueue& operator=(const MainThreadQueue&) = delete;
+
+  void Post(std::function<void()> completion);
+
+  // Runs the queued completions. Platform thread only; returns how many.
+  size_t Drain();
+
+  // Times a stretch of platform thread work, e.g. a channel handler.
+  class BusyScope {
+   public:
+    explicit BusyScope(MainThreadQueue* queue)
+        : queue_(queue), start_(std::chrono::steady_clock::now()) {}
+    ~BusyScope();
+
+    BusyScope(const BusyScope&) = delete;
+    BusyScope& operator=(const BusyScope&) = delete;
+
+   private:
+    MainThreadQueue* queue_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  MainThreadQueueStats GetStats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Completion {
+    std::function<void()> run;
+    Clock::time_point posted;
+  };
+
+  void RecordBusy(Clock::duration busy);
+
+  const std::function<void()> wake_;
+  mutable std::mutex mutex_;
+  std::vector<Completion> queue_;
+  MainThreadQueueStats stats_;
+};
+
+#endif  // NATIVE_TASK_EXECUTOR_H_
@@ -0,0 +1,160 @@
+// Drives CheckJournal the way CheckJournalService does, against a stand-in
+// RPC server that is slow, drops every third request and is "crashed"
+// across once. Every pack must be counted at most once, repeated serials
+// must come back as duplicates (affected == 0), and the calls in flight at
+// the crash must be reported as unsettled instead of sent again.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "native/check_journal.h"
+#include "stub_http_server.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr char kRpcPath[] = "/rest/v1/rpc/update_checked_amount_and_packserial";
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string JsonString(const std::string& body, const std::string& key) {
+  const size_t at = body.find("\"" + key + "\":\"");
+  if (at == std::string::npos) return "";
+  const size_t start = at + key.size() + 4;
+  return body.substr(start, body.find('"', start) - start);
+}
+
+long JsonNumber(const std::string& body, const std::string& key) {
+  const size_t at = body.find("\"" + key + "\":");
+  if (at == std::string::npos) return 0;
+  return std::strtol(body.c_str() + at + key.size() + 3, nullptr, 10);
+}
+
+// The server side of update_checked_amount_and_packserial: a serial that was
+// already recorded is rejected with 0.
+struct FakeRxRecipe {
+  std::map<long, long> checked;
+  std::set<std::string> serials;
+
+  std::string Handle(const std::string& path, const std::string& body) {
+    if (path != kRpcPath) return "null";
+    const std::string serial = JsonString(body, "_pack_serial");
+    if (!serial.empty() && !serials.insert(serial).second) {
+      return "0";
+    }
+    checked[JsonNumber(body, "_rxrecipe_id")] += JsonNumber(body, "_delta");
+    return "1";
+  }
+};
+
+std::string Body(const CheckEntry& entry) {
+  return "{\"_rxrecipe_id\":" + std::to_string(entry.rxrecipe_id) +
+         ",\"_delta\":" + std::to_string(entry.delta) +
+         ",\"_pack_serial\":\"" + entry.pack_serial + "\"}";
+}
+
+// One flusher pass: send a batch in order and report every outcome. After
+// the first failure the rest of the batch is returned unsent, so a repeated
+// serial can never overtake the scan it repeats. The stub drops a request
+// before handling it, so a drop here is known to be unsent, like a refused
+// connection.
+void FlushOnce(CheckJournal* journal, int port) {
+  std::vector<CheckEntry> batch;
+  journal->TakeBatch(8, NowMs(), &batch);
+  bool failed = false;
+  for (const CheckEntry& entry : batch) {
+    std::string reply;
+    if (!failed && StubHttpPost(port, kRpcPath, Body(entry), &reply)) {
+      journal->Ack(entry.seq, std::atoi(reply.c_str()));
+    } else {
+      failed = true;
+      journal->Fail(entry.seq, NowMs());
+    }
+  }
+  journal->SyncIfDue(NowMs());
+}
+
+bool Drained(const CheckJournal& journal) {
+  CheckJournalStats stats = journal.GetStats();
+  return stats.pending == 0 && stats.in_flight == 0;
+}
+
+void TestFlushThroughFlakyServer() {
+  FakeRxRecipe server_state;
+  StubHttpServer server([&](const std::string& path, const std::string& body) {
+    return server_state.Handle(path, body);
+  });
+  EXPECT_TRUE(server.ok());
+  server.set_latency_ms(2);
+  server.set_fail_every(3);
+
+  CheckJournalOptions options;
+  options.min_backoff_ms = 5;
+  options.max_backoff_ms = 20;
+  const std::string path = TempFilePath("check_journal_flush");
+
+  // 30 packs over 3 rows; every 5th scan repeats the previous serial.
+  std::map<long, long> expected;
+  uint64_t repeated = 0;
+  {
+    CheckJournal journal(options);
+    EXPECT_TRUE(journal.Open(path));
+    for (int i = 0; i < 30; ++i) {
+      const bool repeat = i % 5 == 4;
+      const std::string serial = "S" + std::to_string(repeat ? i - 1 : i);
+      journal.Append(100 + i % 3, 2, serial, NowMs());
+      if (repeat) {
+        ++repeated;
+      } else {
+        expected[100 + i % 3] += 2;
+      }
+    }
+
+    // The server commits a batch but the app dies before the acks land.
+    std::vector<CheckEntry> batch;
+    journal.TakeBatch(4, NowMs(), &batch);
+    for (const CheckEntry& entry : batch) {
+      server_state.Handle(kRpcPath, Body(entry));
+    }
+  }
+
+  CheckJournal journal(options);
+  EXPECT_TRUE(journal.Open(path));
+  EXPECT_EQ(journal.GetStats().replayed, 30u);
+  // Resending those four would count the serial-less ones twice.
+  std::vector<CheckEntry> unsettled;
+  EXPECT_EQ(journal.TakeUnsettled(8, &unsettled), 4u);
+  for (const CheckEntry& entry : unsettled) {
+    journal.Ack(entry.seq, kCheckOutcomeUnknown);
+  }
+  const int64_t deadline = NowMs() + 10000;
+  while (!Drained(journal) && NowMs() < deadline) {
+    FlushOnce(&journal, server.port());
+  }
+  EXPECT_TRUE(Drained(journal));
+
+  CheckJournalStats stats = journal.GetStats();
+  EXPECT_EQ(stats.acked, 30u);
+  EXPECT_EQ(stats.unknown, 4u);
+  EXPECT_TRUE(stats.failures > 0);
+  EXPECT_EQ(stats.duplicates, repeated);
+  EXPECT_TRUE(server_state.checked == expected);
+  journal.Close();
+  std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+  TestFlushThroughFlakyServer();
+  return TEST_RESULT();
+}
@@ -0,0 +1,283 @@
+#include "native/check_journal.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "native/crc32.h"
+#include "native/file_io.h"
+#include "test_util.h"
+
+namespace {
+
+size_t FileSize(const std::string& path) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  return static_cast<size_t>(in.tellg());
+}
+
+void TestReplayUnacked() {
+  const std::string path = TempFilePath("check_journal_replay");
+  {
+    CheckJournal journal;
+    EXPECT_TRUE(journal.Open(path));
+    EXPECT_EQ(journal.Append(11, 30, "SER1", 100), 1u);
+    EXPECT_EQ(journal.Append(12, 1, "", 101), 2u);
+    EXPECT_EQ(journal.Append(13, 10, "SER3", 102), 3u);
+    std::vector<CheckEntry> batch;
+    EXPECT_EQ(journal.TakeBatch(1, 200, &batch), 1u);
+    journal.Ack(batch[0].seq, 1);
+    // Closed with entry 2 and 3 never sent
+  }
+  CheckJournal journal;
+  EXPECT_TRUE(journal.Open(path));
+  CheckJournalStats stats = journal.GetStats();
+  EXPECT_EQ(stats.replayed, 2u);
+  EXPECT_EQ(stats.pending, 2u);
+
+  std::vector<CheckEntry> batch;
+  EXPECT_EQ(journal.TakeBatch(10, 0, &batch), 2u);
+  if (batch.size() == 2) {
+    EXPECT_EQ(batch[0].seq, 2u);
+    EXPECT_EQ(batch[0].rxrecipe_id, 12);
+    EXPECT_EQ(batch[0].pack_serial, "");
+    EXPECT_EQ(batch[1].seq, 3u);
+    EXPECT_EQ(batch[1].delta, 10);
+    EXPECT_EQ(batch[1].pack_serial, "SER3");
+    EXPECT_EQ(batch[1].created_ms, 102);
+  }
+  // Sequence numbers continue after a restart.
+  EXPECT_EQ(journal.Append(14, 1, "", 300), 4u);
+  journal.Close();
+  std::remove(path.c_str());
+}
+
+// A crash in the middle of a write leaves a partial frame; replay keeps the
+// records before it and later appends follow the last good record.
+void TestTornTail() {
+  const std::string path = TempFilePath("check_journal_torn");
+  size_t one_record = 0;
+  {
+    CheckJournal journal;
+    EXPECT_TRUE(journal.Open(path));
+    journal.Append(1, 1, "A", 0);
+    journal.Sync();
+    one_record = FileSize(path);
+    journal.Append(2, 1, "B", 0);
+  }
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::in);
+    out.seekp(0, std::ios::end);
+    out.write("\x40\x00\x00\x00\x12\x34", 6);  // header of a lost record
+  }
+  {
+    CheckJournal journal;
+    EXPECT_TRUE(journal.Open(path));
+    EXPECT_EQ(journal.GetStats().pending, 2u);
+    journal.Append(3, 1, "C", 0);
+  }
+  CheckJournal journal;
+  EXPECT_TRUE(journal.Open(path));
+  EXPECT_EQ(journal.GetStats().pending, 3u);
+  journal.Close();
+
+  // Flip a payload byte of the second record: only the first survives.
+  {
+    std::fstream io(path, std::ios::binary | std::ios::in | std::ios::out);
+    io.seekp(static_cast<std::streamoff>(one_record + 12));
+    io.put('\x7f');
+  }
+  EXPECT_TRUE(journal.Open(path));
+  EXPECT_EQ(journal.GetStats().pending, 1u);
+  journal.Close();
+  std::remove(path.c_str());
+}
+
+void TestFailRequeuesInOrderWithBackoff() {
+  CheckJournalOptions options;
+  options.min_backoff_ms = 100;
+  options.max_backoff_ms = 300;
+  const std::string path = TempFilePath("check_journal_backoff");
+  CheckJournal journal(options);
+  EXPECT_TRUE(journal.Open(path));
+  for (int i = 0; i < 4; ++i) {
+    journal.Append(i, 1, "", 0);
+  }
+  std::vector<CheckEntry> batch;
+  EXPECT_EQ(journal.TakeBatch(3, 0, &batch), 3u);
+  journal.Ack(1, 1);
+  journal.Fail(2, 1000);
+  journal.Fail(3, 1000);
+  EXPECT_EQ(journal.GetStats().backoff_ms, 100);
+
+  batch.clear();
+  EXPECT_EQ(journal.TakeBatch(10, 1050, &batch), 0u);
+  EXPECT_EQ(journal.TakeBatch(10, 1100, &batch), 3u);
+  if (batch.size() == 3) {
+    EXPECT_EQ(batch[0].seq, 2u);
+    EXPECT_EQ(batch[1].seq, 3u);
+    EXPECT_EQ(batch[2].seq, 4u);
+  }
+  journal.Fail(2, 2000);
+  EXPECT_EQ(journal.GetStats().backoff_ms, 200);
+  journal.TakeBatch(10, 2200, &batch);
+  journal.Fail(2, 2200);
+  EXPECT_EQ(journal.GetStats().backoff_ms, 300);  // capped
+  journal.Ack(3, 0);
+  EXPECT_EQ(journal.GetStats().backoff_ms, 0);    // reset by a reply
+  EXPECT_EQ(journal.GetStats().duplicates, 1u);
+  // Unknown or repeated acks are ignored.
+  journal.Ack(3, 1);
+  journal.Ack(99, 1);
+  EXPECT_EQ(journal.GetStats().acked, 2u);
+  journal.Close();
+  std::remove(path.c_str());
+}
+
+// Entries taken for sending when the app stopped may have reached the
+// server: they come back from TakeUnsettled, not TakeBatch.
+void TestUnsettledAfterCrash() {
+  const std::string path = TempFilePath("check_journal_unsettled");
+  {
+    CheckJournal journal;
+    EXPECT_TRUE(journal.Open(path));
+    journal.Append(11, 1, "SER1", 0);
+    journal.Append(12, 1, "SER2", 0);
+    journal.Append(13, 1, "SER3", 0);
+    std::vector<CheckEntry> batch;
+    EXPECT_EQ(journal.TakeBatch(2, 0, &batch), 2u);
+    // 2 could not connect; 1 was on the wire when the app died
+    journal.Fail(2, 0);
+  }
+  {
+    CheckJournal journal;
+    EXPECT_TRUE(journal.Open(path));
+    CheckJournalStats stats = journal.GetStats();
+    EXPECT_EQ(stats.replayed, 3u);
+    EXPECT_EQ(stats.unsettled, 1u);
+    EXPECT_EQ(stats.pending, 2u);
+
+    std::vector<CheckEntry> unsettled;
+    EXPECT_EQ(journal.TakeUnsettled(10, &unsettled), 1u);
+    if (unsettled.size() == 1) {
+      EXPECT_EQ(unsettled[0].seq, 1u);
+      EXPECT_EQ(unsettled[0].pack_serial, "SER1");
+    }
+    journal.Ack(1, kCheckOutcomeUnknown);
+    std::vector<CheckEntry> batch;
+    EXPECT_EQ(journal.TakeBatch(10, 0, &batch), 2u);
+    journal.Ack(2, kCheckRejected);
+    stats = journal.GetStats();
+    EXPECT_EQ(stats.unknown, 1u);
+    EXPECT_EQ(stats.rejected, 1u);
+    EXPECT_EQ(stats.duplicates, 0u);
+  }
+  CheckJournal journal;
+  EXPECT_TRUE(journal.Open(path));
+  // Only 3 is left, and it was being sent
+  EXPECT_EQ(journal.GetStats().unsettled, 1u);
+  EXPECT_EQ(journal.GetStats().pending, 0u);
+  journal.Close();
+  std::remove(path.c_str());
+}
+
+// A journal written before sending marks existed is replayed as queued.
+void TestReadsVersion1() {
+  const std::string path = TempFilePath("check_journal_v1");
+  {
+    std::string payload;
+    AppendPod<uint8_t>(&payload, 1);  // increment
+    AppendPod<uint64_t>(&payload, 7);
+    AppendPod<int64_t>(&payload, 42);
+    AppendPod<int32_t>(&payload, 3);
+    AppendPod<int64_t>(&payload, 500);
+    AppendPod<uint16_t>(&payload, 2);
+    payload += "S1";
+    std::string file;
+    AppendPod<uint32_t>(&file, 0x4A435050);
+    AppendPod<uint32_t>(&file, 1);
+    AppendPod<uint64_t>(&file, 1);
+    AppendPod(&file, static_cast<uint32_t>(payload.size()));
+    AppendPod(&file, Crc32(payload.data(), payload.size()));
+    file += payload;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(file.data(), static_cast<std::streamsize>(file.size()));
+  }
+  {
+    CheckJournal journal;
+    EXPECT_TRUE(journal.Open(path));
+    EXPECT_EQ(journal.GetStats().pending, 1u);
+    std::vector<CheckEntry> batch;
+    EXPECT_EQ(journal.TakeBatch(10, 0, &batch), 1u);
+    if (batch.size() == 1) {
+      EXPECT_EQ(batch[0].seq, 7u);
+      EXPECT_EQ(batch[0].rxrecipe_id, 42);
+    }
+    EXPECT_EQ(journal.Append(43, 1, "", 600), 8u);
+  }
+  // Upgraded in place: the sending mark survives the next open
+  CheckJournal journal;
+  EXPECT_TRUE(journal.Open(path));
+  EXPECT_EQ(journal.GetStats().unsettled, 1u);
+  EXPECT_EQ(journal.GetStats().pending, 1u);
+  journal.Close();
+  std::remove(path.c_str());
+}
+
+void TestSyncBatching() {
+  CheckJournalOptions options;
+  options.sync_batch = 4;
+  options.sync_interval_ms = 50;
+  const std::string path = TempFilePath("check_journal_sync");
+  CheckJournal journal(options);
+  EXPECT_TRUE(journal.Open(path));
+  const uint64_t base = journal.GetStats().syncs;
+  for (int i = 0; i < 8; ++i) {
+    journal.Append(i, 1, "", 0);
+  }
+  EXPECT_EQ(journal.GetStats().syncs - base, 2u);
+  journal.Append(9, 1, "", 100);
+  journal.SyncIfDue(120);
+  EXPECT_EQ(journal.GetStats().syncs - base, 2u);
+  journal.SyncIfDue(150);
+  EXPECT_EQ(journal.GetStats().syncs - base, 3u);
+  journal.Close();
+  std::remove(path.c_str());
+}
+
+void TestCompaction() {
+  CheckJournalOptions options;
+  options.compact_bytes = 1024;
+  const std::string path = TempFilePath("check_journal_compact");
+  {
+    CheckJournal journal(options);
+    EXPECT_TRUE(journal.Open(path));
+    for (int i = 0; i < 200; ++i) {
+      const uint64_t seq = journal.Append(i, 1, "SERIAL", 0);
+      std::vector<CheckEntry> batch;
+      journal.TakeBatch(1, 0, &batch);
+      journal.Ack(seq, 1);
+    }
+    EXPECT_TRUE(journal.GetStats().file_bytes < 2048);
+  }
+  EXPECT_TRUE(FileSize(path) < 2048);
+  CheckJournal journal(options);
+  EXPECT_TRUE(journal.Open(path));
+  EXPECT_EQ(journal.GetStats().pending, 0u);
+  EXPECT_EQ(journal.Append(1, 1, "", 0), 201u);
+  journal.Close();
+  std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+  TestReplayUnacked();
+  TestTornTail();
+  TestFailRequeuesInOrderWithBackoff();
+  TestUnsettledAfterCrash();
+  TestReadsVersion1();
+  TestSyncBatching();
+  TestCompaction();
+  return TEST_RESULT();
+}
@@ -0,0 +1,252 @@
+#include "native/day_snapshot.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr int32_t kDay = 20240521;
+
+std::string Head(int64_t tfn, const char* name, bool complete) {
+  return "{\"tfn\":" + std::to_string(tfn) + ",\"patient_name\":\"" + name +
+         "\",\"is_complete\":" + (complete ? "true" : "false") + "}";
+}
+
+std::string Heads(const std::vector<std::string>& rows) {
+  std::string json = "[";
+  for (size_t i = 0; i < rows.size(); ++i) {
+    json += (i > 0 ? "," : "") + rows[i];
+  }
+  return json + "]";
+}
+
+std::string Recipes(int64_t tfn, int checked) {
+  return "[{\"rxrecipe_id\":" + std::to_string(tfn * 10) +
+         ",\"checked_amount\":" + std::to_string(checked) + ",\"total\":3}]";
+}
+
+void TestPutGetAndReopen() {
+  const std::string path = TempFilePath("day_snapshot_basic");
+  {
+    DaySnapshot snapshot;
+    EXPECT_TRUE(snapshot.Open(path, kDay));
+    std::string out;
+    EXPECT_TRUE(!snapshot.Get(SnapshotKind::kHeads, 0, &out));
+    const std::string heads = Heads({Head(101, "A", false)});
+    EXPECT_TRUE(snapshot.Put(SnapshotKind::kHeads, 0, heads, 1000) ==
+                SnapshotPut::kChanged);
+    EXPECT_TRUE(snapshot.Put(SnapshotKind::kHeads, 0, heads, 2000) ==
+                SnapshotPut::kUnchanged);
+    EXPECT_TRUE(snapshot.Put(SnapshotKind::kRecipes, 101, Recipes(101, 0),
+                             2000) == SnapshotPut::kChanged);
+    int64_t fetched = 0;
+    EXPECT_TRUE(snapshot.Get(SnapshotKind::kHeads, 0, &out, &fetched));
+    EXPECT_EQ(out, heads);
+    EXPECT_EQ(fetched, 2000);
+    EXPECT_EQ(snapshot.Commit(3000), 1u);
+  }
+
+  // A restart has the day at once
+  DaySnapshot snapshot;
+  EXPECT_TRUE(snapshot.Open(path, kDay));
+  std::string out;
+  EXPECT_TRUE(snapshot.Get(SnapshotKind::kRecipes, 101, &out));
+  EXPECT_EQ(out, Recipes(101, 0));
+  DaySnapshotStats stats = snapshot.GetStats();
+  EXPECT_EQ(stats.entries, 2u);
+  EXPECT_EQ(stats.generation, 1u);
+  EXPECT_EQ(stats.synced_ms, 3000);
+  EXPECT_TRUE(snapshot.RecipesToFetch().empty());
+  snapshot.Close();
+
+  // Another day's file starts over
+  EXPECT_TRUE(snapshot.Open(path, kDay + 1));
+  EXPECT_TRUE(!snapshot.Get(SnapshotKind::kHeads, 0, &out));
+  EXPECT_EQ(snapshot.GetStats().entries, 0u);
+  snapshot.Close();
+  std::remove(path.c_str());
+}
+
+void TestIncrementalSync() {
+  const std::string path = TempFilePath("day_snapshot_sync");
+  DaySnapshot snapshot;
+  EXPECT_TRUE(snapshot.Open(path, kDay));
+  snapshot.Put(SnapshotKind::kHeads, 0,
+               Heads({Head(101, "A", false), Head(102, "B", false),
+                      Head(103, "C", true)}),
+               0);
+  EXPECT_TRUE(snapshot.RecipesToFetch() == std::vector<int64_t>({101, 102,
+                                                                 103}));
+  for (int64_t tfn : {101, 102, 103}) {
+    snapshot.Put(SnapshotKind::kRecipes, tfn, Recipes(tfn, 0), 0);
+  }
+  EXPECT_TRUE(snapshot.RecipesToFetch().empty());
+
+  // The server finished 101, a new prescription arrived, 103 was cancelled
+  snapshot.Put(SnapshotKind::kHeads, 0,
+               Heads({Head(101, "A", true), Head(102, "B", false),
+                      Head(104, "D", false)}),
+               1);
+  EXPECT_TRUE(snapshot.RecipesToFetch() == std::vector<int64_t>({101, 104}));
+  std::string out;
+  EXPECT_TRUE(!snapshot.Get(SnapshotKind::kRecipes, 103, &out));
+
+  // A local check makes 102 worth another look
+  snapshot.Put(SnapshotKind::kRecipes, 101, Recipes(101, 3), 2);
+  snapshot.Put(SnapshotKind::kRecipes, 104, Recipes(104, 0), 2);
+  snapshot.MarkDirty(102);
+  EXPECT_TRUE(snapshot.RecipesToFetch() == std::vector<int64_t>({102}));
+  // Same rows as before: unchanged, but no longer dirty
+  EXPECT_TRUE(snapshot.Put(SnapshotKind::kRecipes, 102, Recipes(102, 0), 3) ==
+              SnapshotPut::kUnchanged);
+  EXPECT_TRUE(snapshot.RecipesToFetch().empty());
+
+  // Signatures survive a restart
+  snapshot.Close();
+  EXPECT_TRUE(snapshot.Open(path, kDay));
+  EXPECT_TRUE(snapshot.RecipesToFetch().empty());
+  snapshot.Close();
+  std::remove(path.c_str());
+}
+
+void TestHeadSignatures() {
+  const auto rows = DaySnapshot::HeadSignatures(
+      Heads({Head(101, "A", false), "{\"no\":\"1\"}", Head(102, "A", false),
+             "{\"tfn\":\"103\",\"is_complete\":false}"}));
+  EXPECT_EQ(rows.size(), 3u);
+  EXPECT_EQ(rows[0].first, 101);
+  EXPECT_EQ(rows[1].first, 102);
+  EXPECT_EQ(rows[2].first, 103);
+  EXPECT_TRUE(rows[0].second != rows[1].second);
+  const auto again = DaySnapshot::HeadSignatures(Heads({Head(101, "A", true)}));
+  EXPECT_TRUE(again[0].second != rows[0].second);
+}
+
+void TestTornEntryIsDropped() {
+  const std::string path = TempFilePath("day_snapshot_torn");
+  {
+    DaySnapshot snapshot;
+    EXPECT_TRUE(snapshot.Open(path, kDay));
+    snapshot.Put(SnapshotKind::kHeads, 0, Heads({Head(101, "A", false)}), 0);
+    snapshot.Put(SnapshotKind::kRecipes, 101, Recipes(101, 0), 0);
+  }
+  // Flip a byte of the recipes JSON, as a write cut short would leave it
+  std::string bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>());
+  }
+  const size_t at = bytes.find("checked_amount");
+  EXPECT_TRUE(at != std::string::npos);
+  bytes[at] = 'X';
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  }
+
+  DaySnapshot snapshot;
+  EXPECT_TRUE(snapshot.Open(path, kDay));
+  std::string out;
+  EXPECT_TRUE(snapshot.Get(SnapshotKind::kHeads, 0, &out));
+  EXPECT_TRUE(!snapshot.Get(SnapshotKind::kRecipes, 101, &out));
+  EXPECT_EQ(snapshot.GetStats().dropped, 1u);
+  EXPECT_TRUE(snapshot.RecipesToFetch() == std::vector<int64_t>({101}));
+  snapshot.Close();
+  std::remove(path.c_str());
+}
+
+void TestGrowthAndCompaction() {
+  const std::string path = TempFilePath("day_snapshot_grow");
+  DaySnapshot snapshot;
+  EXPECT_TRUE(snapshot.Open(path, kDay));
+  // More prescriptions than the initial table holds
+  std::vector<std::string> heads;
+  for (int64_t tfn = 1; tfn <= 600; ++tfn) {
+    heads.push_back(Head(tfn, "P", false));
+  }
+  snapshot.Put(SnapshotKind::kHeads, 0, Heads(heads), 0);
+  for (int64_t tfn = 1; tfn <= 600; ++tfn) {
+    EXPECT_TRUE(snapshot.Put(SnapshotKind::kRecipes, tfn, Recipes(tfn, 0),
+                             0) == SnapshotPut::kChanged);
+  }
+  // Rewriting the same entries many times must not grow the file for ever
+  const std::string big(64 * 1024, 'x');
+  for (int i = 0; i < 200; ++i) {
+    snapshot.Put(SnapshotKind::kRecipes, 1,
+                 "[\"" + big + std::to_string(i) + "\"]", i);
+  }
+  const DaySnapshotStats stats = snapshot.GetStats();
+  EXPECT_EQ(stats.entries, 601u);
+  EXPECT_TRUE(stats.compactions >= 1u);
+  EXPECT_TRUE(stats.file_bytes < 4u * 1024 * 1024);
+
+  snapshot.Close();
+  EXPECT_TRUE(snapshot.Open(path, kDay));
+  std::string out;
+  EXPECT_TRUE(snapshot.Get(SnapshotKind::kRecipes, 600, &out));
+  EXPECT_EQ(out, Recipes(600, 0));
+  EXPECT_TRUE(snapshot.Get(SnapshotKind::kRecipes, 1, &out));
+  EXPECT_EQ(out, "[\"" + big + "199\"]");
+  EXPECT_EQ(snapshot.GetStats().dropped, 0u);
+  EXPECT_TRUE(snapshot.RecipesToFetch().empty());
+  snapshot.Close();
+  std::remove(path.c_str());
+}
+
+void TestFfi() {
+  const std::string path = TempFilePath("day_snapshot_ffi");
+  PharmDaySnapshot* snapshot = pharm_day_snapshot_open(path.c_str(), kDay);
+  EXPECT_TRUE(snapshot != nullptr);
+  const std::string heads =
+      Heads({Head(101, "A", false), Head(102, "B", false)});
+  EXPECT_EQ(pharm_day_snapshot_put(
+                snapshot, 1, 0, reinterpret_cast<const uint8_t*>(heads.data()),
+                static_cast<int64_t>(heads.size()), 5),
+            2);
+  EXPECT_EQ(pharm_day_snapshot_put(snapshot, 3, 0, nullptr, 0, 5), 0);
+
+  uint8_t small[8];
+  int64_t fetched = 0;
+  const int64_t length =
+      pharm_day_snapshot_get(snapshot, 1, 0, small, sizeof(small), &fetched);
+  EXPECT_EQ(length, static_cast<int64_t>(heads.size()));
+  std::vector<uint8_t> buffer(static_cast<size_t>(length));
+  EXPECT_EQ(pharm_day_snapshot_get(snapshot, 1, 0, buffer.data(), length,
+                                   &fetched),
+            length);
+  EXPECT_EQ(std::string(buffer.begin(), buffer.end()), heads);
+  EXPECT_EQ(fetched, 5);
+  EXPECT_EQ(pharm_day_snapshot_get(snapshot, 2, 101, small, sizeof(small),
+                                   nullptr),
+            -1);
+
+  int64_t tfns[1];
+  EXPECT_EQ(pharm_day_snapshot_recipes_to_fetch(snapshot, tfns, 1), 2);
+  EXPECT_EQ(tfns[0], 101);
+  EXPECT_EQ(pharm_day_snapshot_commit(snapshot, 9), 1);
+
+  PharmDaySnapshotStats stats;
+  pharm_day_snapshot_stats(snapshot, &stats);
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_EQ(stats.synced_ms, 9);
+  pharm_day_snapshot_close(snapshot);
+  std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+  TestPutGetAndReopen();
+  TestIncrementalSync();
+  TestHeadSignatures();
+  TestTornEntryIsDropped();
+  TestGrowthAndCompaction();
+  TestFfi();
+  return TEST_RESULT();
+}
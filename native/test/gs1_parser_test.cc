@@ -0,0 +1,133 @@
+#include "native/gs1_parser.h"
+
+#include <cstring>
+
+#include <string>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "test_util.h"
+
+namespace {
+
+std::string Field(const std::string& input, const Gs1Parse& parse,
+                  uint16_t ai) {
+  const Gs1Element* element = parse.Find(ai);
+  return element ? std::string(Gs1Value(input, *element)) : std::string();
+}
+
+void TestCheckDigit() {
+  EXPECT_TRUE(Gs1CheckDigitValid("08806469007312"));
+  EXPECT_TRUE(Gs1CheckDigitValid("8806469007312"));
+  EXPECT_TRUE(!Gs1CheckDigitValid("08806469007313"));
+  EXPECT_TRUE(Gs1CheckDigitValid("96385074"));
+}
+
+void TestLegacyLayout() {
+  // The layout handleBarcode used to assume: 01 + GTIN-14 + 21 + serial
+  const std::string input = "010880646900731221SN12345678";
+  Gs1Parse parse;
+  EXPECT_TRUE(ParseGs1(input, &parse) == Gs1Status::kOk);
+  EXPECT_EQ(Field(input, parse, kGs1AiGtin), "08806469007312");
+  EXPECT_EQ(Field(input, parse, kGs1AiSerial), "SN12345678");
+}
+
+void TestVariableFieldsWithGroupSeparators() {
+  const std::string input =
+      "]d201088064690073121726123110LOT42\x1d" "21SERIAL001";
+  Gs1Parse parse;
+  EXPECT_TRUE(ParseGs1(input, &parse) == Gs1Status::kOk);
+  EXPECT_EQ(parse.count, 4);
+  EXPECT_EQ(Field(input, parse, kGs1AiGtin), "08806469007312");
+  EXPECT_EQ(Field(input, parse, kGs1AiExpiry), "261231");
+  EXPECT_EQ(Field(input, parse, kGs1AiLot), "LOT42");
+  EXPECT_EQ(Field(input, parse, kGs1AiSerial), "SERIAL001");
+}
+
+void TestLeadingFnc1AndFourDigitAi() {
+  const std::string input = "\x1d" "01088064690073123103000250\x1d";
+  Gs1Parse parse;
+  EXPECT_TRUE(ParseGs1(input, &parse) == Gs1Status::kOk);
+  EXPECT_EQ(Field(input, parse, 3103), "000250");
+}
+
+void TestLostGroupSeparator() {
+  // The GS after the serial was dropped by a keyboard wedge
+  const std::string input = "010880646900731221SN1234567890AB1726123110LOT42";
+  Gs1Parse parse;
+  EXPECT_TRUE(ParseGs1(input, &parse) == Gs1Status::kOk);
+  EXPECT_EQ(Field(input, parse, kGs1AiSerial), "SN1234567890AB");
+  EXPECT_EQ(Field(input, parse, kGs1AiExpiry), "261231");
+  EXPECT_EQ(Field(input, parse, kGs1AiLot), "LOT42");
+}
+
+void TestBracketed() {
+  const std::string input = "(01)08806469007312(17)261231(21)ABC";
+  Gs1Parse parse;
+  EXPECT_TRUE(ParseGs1(input, &parse) == Gs1Status::kOk);
+  EXPECT_EQ(Field(input, parse, kGs1AiGtin), "08806469007312");
+  EXPECT_EQ(Field(input, parse, kGs1AiSerial), "ABC");
+}
+
+void TestPlainCodes() {
+  const std::string ean13 = "8806469007312";
+  Gs1Parse parse;
+  EXPECT_TRUE(ParseGs1(ean13, &parse) == Gs1Status::kOk);
+  EXPECT_TRUE(parse.plain);
+  EXPECT_EQ(Field(ean13, parse, kGs1AiGtin), ean13);
+}
+
+void TestErrorsKeepEarlierElements() {
+  Gs1Parse parse;
+  const std::string bad_check = "0108806469007313";
+  EXPECT_TRUE(ParseGs1(bad_check, &parse) == Gs1Status::kBadCheckDigit);
+
+  const std::string bad_ai = "010880646900731288XYZ";
+  EXPECT_TRUE(ParseGs1(bad_ai, &parse) == Gs1Status::kUnknownAi);
+  EXPECT_EQ(Field(bad_ai, parse, kGs1AiGtin), "08806469007312");
+
+  // Nothing to split a run-on serial at
+  const std::string long_serial =
+      "010880646900731221ABCDEFGHIJKLMNOPQRSTU";
+  EXPECT_TRUE(ParseGs1(long_serial, &parse) == Gs1Status::kBadLength);
+
+  const std::string bad_date = "01088064690073121726AB31";
+  EXPECT_TRUE(ParseGs1(bad_date, &parse) == Gs1Status::kNotNumeric);
+
+  EXPECT_TRUE(ParseGs1("", &parse) == Gs1Status::kEmpty);
+  EXPECT_TRUE(ParseGs1("]d2", &parse) == Gs1Status::kEmpty);
+}
+
+void TestFfiBatch() {
+  const std::string batch =
+      "8806469007312\r\n"
+      "]d201088064690073121726123110LOT42\x1d" "21SERIAL001\n"
+      "0108806469007313";  // bad check digit, no trailing newline
+  PharmGs1Record records[4];
+  EXPECT_EQ(pharm_gs1_parse_batch(batch.data(),
+                                  static_cast<int32_t>(batch.size()), records,
+                                  4),
+            3);
+  EXPECT_EQ(records[0].status, 0);
+  EXPECT_EQ(std::string(records[0].gtin), "08806469007312");
+  EXPECT_EQ(std::string(records[0].serial), "");
+  EXPECT_EQ(std::string(records[1].expiry), "261231");
+  EXPECT_EQ(std::string(records[1].lot), "LOT42");
+  EXPECT_EQ(std::string(records[1].serial), "SERIAL001");
+  EXPECT_EQ(records[2].status, static_cast<int32_t>(Gs1Status::kBadCheckDigit));
+  EXPECT_EQ(std::strlen(records[2].gtin), 0u);
+}
+
+}  // namespace
+
+int main() {
+  TestCheckDigit();
+  TestLegacyLayout();
+  TestVariableFieldsWithGroupSeparators();
+  TestLeadingFnc1AndFourDigitAi();
+  TestLostGroupSeparator();
+  TestBracketed();
+  TestPlainCodes();
+  TestErrorsKeepEarlierElements();
+  TestFfiBatch();
+  return TEST_RESULT();
+}
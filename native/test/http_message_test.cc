@@ -0,0 +1,180 @@
+#include "native/http_message.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "test_util.h"
+
+namespace {
+
+// Feeds |text| |step| bytes at a time; returns the final result.
+HttpParser::Result FeedInSteps(HttpParser* parser, const std::string& text,
+                               size_t step, size_t* consumed) {
+  HttpParser::Result result = HttpParser::Result::kNeedMore;
+  size_t offset = 0;
+  while (offset < text.size()) {
+    size_t used = 0;
+    const size_t n = std::min(step, text.size() - offset);
+    result = parser->Feed(text.data() + offset, n, &used);
+    offset += used;
+    if (result != HttpParser::Result::kNeedMore) {
+      break;
+    }
+  }
+  *consumed = offset;
+  return result;
+}
+
+void TestContentLengthAnyBoundary() {
+  const std::string response =
+      "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+      "content-length: 13\r\n\r\n[{\"tfn\":101}]";
+  for (size_t step = 1; step <= response.size(); ++step) {
+    HttpParser parser(HttpParser::Kind::kResponse);
+    size_t consumed = 0;
+    EXPECT_TRUE(FeedInSteps(&parser, response, step, &consumed) ==
+                HttpParser::Result::kDone);
+    EXPECT_EQ(consumed, response.size());
+    EXPECT_EQ(parser.status(), 200);
+    EXPECT_EQ(parser.body(), "[{\"tfn\":101}]");
+    EXPECT_TRUE(parser.Header("CONTENT-TYPE") == "application/json");
+    EXPECT_TRUE(parser.keep_alive());
+  }
+}
+
+void TestChunked() {
+  const std::string response =
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "4;ext=1\r\n[1,2\r\n"
+      "A\r\n,3,4,5,6,7\r\n"
+      "1\r\n]\r\n"
+      "0\r\nX-Trailer: yes\r\n\r\n";
+  for (size_t step = 1; step <= response.size(); ++step) {
+    HttpParser parser(HttpParser::Kind::kResponse);
+    size_t consumed = 0;
+    EXPECT_TRUE(FeedInSteps(&parser, response, step, &consumed) ==
+                HttpParser::Result::kDone);
+    EXPECT_EQ(consumed, response.size());
+    EXPECT_EQ(parser.body(), "[1,2,3,4,5,6,7]");
+  }
+}
+
+void TestPipelinedResponses() {
+  const std::string both =
+      "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r\n1"
+      "HTTP/1.1 404 Not Found\r\nContent-Length: 2\r\n\r\n{}";
+  HttpParser parser(HttpParser::Kind::kResponse);
+  size_t used = 0;
+  EXPECT_TRUE(parser.Feed(both.data(), both.size(), &used) ==
+              HttpParser::Result::kDone);
+  EXPECT_EQ(parser.body(), "1");
+  const size_t first = used;
+  parser.Reset();
+  EXPECT_TRUE(!parser.started());
+  EXPECT_TRUE(parser.Feed(both.data() + first, both.size() - first, &used) ==
+              HttpParser::Result::kDone);
+  EXPECT_EQ(first + used, both.size());
+  EXPECT_EQ(parser.status(), 404);
+  EXPECT_EQ(parser.body(), "{}");
+}
+
+void TestRequest() {
+  const std::string request =
+      "POST /rest/v1/rpc/select_rxhead_bydate HTTP/1.1\r\nHost: x\r\n"
+      "Content-Length: 7\r\n\r\n{\"d\":1}";
+  HttpParser parser(HttpParser::Kind::kRequest);
+  size_t consumed = 0;
+  EXPECT_TRUE(FeedInSteps(&parser, request, 5, &consumed) ==
+              HttpParser::Result::kDone);
+  EXPECT_EQ(parser.method(), "POST");
+  EXPECT_EQ(parser.target(), "/rest/v1/rpc/select_rxhead_bydate");
+  EXPECT_EQ(parser.body(), "{\"d\":1}");
+
+  // A request without a length has no body
+  const std::string get = "GET / HTTP/1.1\r\n\r\n";
+  parser.Reset();
+  EXPECT_TRUE(FeedInSteps(&parser, get, get.size(), &consumed) ==
+              HttpParser::Result::kDone);
+  EXPECT_TRUE(parser.body().empty());
+}
+
+void TestConnectionSemantics() {
+  size_t consumed = 0;
+  HttpParser parser(HttpParser::Kind::kResponse);
+  FeedInSteps(&parser,
+              "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 0\r\n"
+              "\r\n",
+              64, &consumed);
+  EXPECT_TRUE(!parser.keep_alive());
+
+  parser.Reset();
+  FeedInSteps(&parser, "HTTP/1.0 200 OK\r\nContent-Length: 0\r\n\r\n", 64,
+              &consumed);
+  EXPECT_TRUE(!parser.keep_alive());
+
+  parser.Reset();
+  FeedInSteps(&parser,
+              "HTTP/1.0 200 OK\r\nConnection: Keep-Alive\r\n"
+              "Content-Length: 0\r\n\r\n",
+              64, &consumed);
+  EXPECT_TRUE(parser.keep_alive());
+
+  // No length: the body runs to the end of the connection
+  parser.Reset();
+  EXPECT_TRUE(FeedInSteps(&parser, "HTTP/1.1 200 OK\r\n\r\n[1,", 64,
+                          &consumed) == HttpParser::Result::kNeedMore);
+  size_t used = 0;
+  EXPECT_TRUE(parser.Feed("2]", 2, &used) == HttpParser::Result::kNeedMore);
+  EXPECT_TRUE(parser.FinishAtEof());
+  EXPECT_EQ(parser.body(), "[1,2]");
+  EXPECT_TRUE(!parser.keep_alive());
+
+  // ... but 204 and HEAD responses never have one
+  parser.Reset();
+  EXPECT_TRUE(FeedInSteps(&parser, "HTTP/1.1 204 No Content\r\n\r\n", 64,
+                          &consumed) == HttpParser::Result::kDone);
+  parser.Reset();
+  parser.set_head_request(true);
+  EXPECT_TRUE(FeedInSteps(&parser,
+                          "HTTP/1.1 200 OK\r\nContent-Length: 50\r\n\r\n", 64,
+                          &consumed) == HttpParser::Result::kDone);
+  EXPECT_TRUE(parser.keep_alive());
+}
+
+void TestErrors() {
+  for (const char* bad : {
+           "HTTP/1.1 2x0 OK\r\n\r\n",
+           "HTTP/2 200 OK\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nno colon\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nContent-Length: 1x\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+           "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nab\r\n",
+       }) {
+    HttpParser parser(HttpParser::Kind::kResponse);
+    size_t used = 0;
+    EXPECT_TRUE(parser.Feed(bad, std::strlen(bad), &used) ==
+                HttpParser::Result::kError);
+    EXPECT_TRUE(!parser.error().empty());
+    EXPECT_TRUE(!parser.keep_alive());
+  }
+
+  HttpParser parser(HttpParser::Kind::kResponse);
+  const std::string huge(HttpParser::kMaxHeadSize + 1, 'a');
+  size_t used = 0;
+  EXPECT_TRUE(parser.Feed(huge.data(), huge.size(), &used) ==
+              HttpParser::Result::kError);
+}
+
+}  // namespace
+
+int main() {
+  TestContentLengthAnyBoundary();
+  TestChunked();
+  TestPipelinedResponses();
+  TestRequest();
+  TestConnectionSemantics();
+  TestErrors();
+  return TEST_RESULT();
+}
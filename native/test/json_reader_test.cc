@@ -0,0 +1,191 @@
+#include "native/json_reader.h"
+
+#include <cmath>
+#include <string>
+#include <string_view>
+
+#include "test_util.h"
+
+namespace {
+
+// Renders the events back as compact text, so whole documents compare as
+// strings.
+class Recorder : public JsonHandler {
+ public:
+  bool StartObject() override { return Append("{"); }
+  bool EndObject() override { return Append("}"); }
+  bool StartArray() override { return Append("["); }
+  bool EndArray() override { return Append("]"); }
+  bool Key(std::string_view key) override {
+    return Append("k:" + std::string(key));
+  }
+  bool String(std::string_view value) override {
+    return Append("s:" + std::string(value));
+  }
+  bool Number(double value) override {
+    char text[32];
+    std::snprintf(text, sizeof(text), "n:%.17g", value);
+    return Append(text);
+  }
+  bool Bool(bool value) override { return Append(value ? "true" : "false"); }
+  bool Null() override { return Append("null"); }
+
+  std::string events;
+  // Stop after this many events; -1 never stops
+  int stop_after = -1;
+
+ private:
+  bool Append(const std::string& event) {
+    if (!events.empty()) {
+      events += ' ';
+    }
+    events += event;
+    return stop_after < 0 || --stop_after > 0;
+  }
+};
+
+std::string Parse(std::string_view json, bool* ok = nullptr) {
+  Recorder recorder;
+  JsonReader reader(&recorder);
+  const bool parsed = reader.Feed(json) && reader.Finish();
+  if (ok != nullptr) {
+    *ok = parsed;
+  }
+  return recorder.events;
+}
+
+void TestValues() {
+  bool ok = false;
+  EXPECT_EQ(Parse(R"({"a":[1,-2.5,true,false,null],"b":{}})", &ok),
+            "{ k:a [ n:1 n:-2.5 true false null ] k:b { } }");
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(Parse(" \t\r\n[ ] ", &ok), "[ ]");
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(Parse("\"top\"", &ok), "s:top");
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(Parse("42", &ok), "n:42");
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(Parse("[\"타이레놀\"]", &ok), "[ s:타이레놀 ]");
+  EXPECT_TRUE(ok);
+}
+
+void TestEscapes() {
+  EXPECT_EQ(Parse(R"(["a\"b\\c\/d\b\f\n\r\t"])"),
+            "[ s:a\"b\\c/d\b\f\n\r\t ]");
+  EXPECT_EQ(Parse(R"(["\u0041\u00e9\uc57d"])"), "[ s:Aé약 ]");
+  // A surrogate pair is one code point; a lone half becomes U+FFFD
+  EXPECT_EQ(Parse(R"(["\ud83d\ude00"])"), "[ s:\xf0\x9f\x98\x80 ]");
+  EXPECT_EQ(Parse(R"(["\ud83dx"])"), "[ s:\xef\xbf\xbdx ]");
+  EXPECT_EQ(Parse(R"(["\ude00"])"), "[ s:\xef\xbf\xbd ]");
+  EXPECT_EQ(Parse(R"({"\u006bey":1})"), "{ k:key n:1 }");
+}
+
+void TestChunkBoundaries() {
+  const std::string json =
+      R"({"rxrecipe_id":9007199254740993,"name":"a\u00e9\ud83d\ude00b",)"
+      R"("total":-12.5e-1,"use":true,"x":null,"list":[false,"",0]})";
+  const std::string expected = Parse(json);
+  // Every split into two chunks, and one byte at a time
+  for (size_t split = 0; split <= json.size(); ++split) {
+    Recorder recorder;
+    JsonReader reader(&recorder);
+    EXPECT_TRUE(reader.Feed(json.data(), split));
+    EXPECT_TRUE(reader.Feed(json.data() + split, json.size() - split));
+    EXPECT_TRUE(reader.Finish());
+    EXPECT_EQ(recorder.events, expected);
+  }
+  Recorder recorder;
+  JsonReader reader(&recorder);
+  for (char c : json) {
+    EXPECT_TRUE(reader.Feed(&c, 1));
+  }
+  EXPECT_TRUE(reader.Finish());
+  EXPECT_EQ(recorder.events, expected);
+  EXPECT_EQ(reader.offset(), json.size());
+}
+
+void TestErrors() {
+  const char* kBad[] = {
+      "",        "[",           "[1,]",        "{\"a\"}",  "{\"a\":1,}",
+      "[1 2]",   "01",          "1.",          "-",        "1e",
+      "tru",     "nul",         "[\"a]",       "\"\\x\"",  "\"\\u12g4\"",
+      "[1]]",    "{1:2}",       "\"a\nb\"",    "[] []",    "+1",
+  };
+  for (const char* json : kBad) {
+    bool ok = true;
+    Parse(json, &ok);
+    if (ok) {
+      std::cerr << "accepted: " << json << std::endl;
+    }
+    EXPECT_TRUE(!ok);
+  }
+
+  Recorder recorder;
+  JsonReader reader(&recorder);
+  EXPECT_TRUE(!reader.Feed("[1,}"));
+  EXPECT_TRUE(!reader.error().empty());
+  // Stays failed until Reset
+  EXPECT_TRUE(!reader.Feed("1"));
+  reader.Reset();
+  recorder.events.clear();
+  EXPECT_TRUE(reader.Feed("[true]"));
+  EXPECT_TRUE(reader.Finish());
+  EXPECT_EQ(recorder.events, "[ true ]");
+  EXPECT_TRUE(reader.error().empty());
+}
+
+void TestDepthAndStop() {
+  Recorder recorder;
+  JsonReader shallow(&recorder, 2);
+  EXPECT_TRUE(shallow.Feed("[[1]]") && shallow.Finish());
+  shallow.Reset();
+  EXPECT_TRUE(!shallow.Feed("[[[1]]]"));
+
+  Recorder stopping;
+  stopping.stop_after = 2;
+  JsonReader reader(&stopping);
+  EXPECT_TRUE(!reader.Feed("[1,2,3]"));
+  EXPECT_EQ(stopping.events, "[ n:1");
+}
+
+void TestNumbers() {
+  double value = 0;
+  EXPECT_TRUE(ParseJsonNumber("0", &value));
+  EXPECT_EQ(value, 0.0);
+  EXPECT_TRUE(ParseJsonNumber("-0", &value));
+  EXPECT_TRUE(std::signbit(value));
+  EXPECT_TRUE(ParseJsonNumber("123456789", &value));
+  EXPECT_EQ(value, 123456789.0);
+  EXPECT_TRUE(ParseJsonNumber("0.1", &value));
+  EXPECT_EQ(value, 0.1);
+  EXPECT_TRUE(ParseJsonNumber("2.5E3", &value));
+  EXPECT_EQ(value, 2500.0);
+  EXPECT_TRUE(ParseJsonNumber("1e-7", &value));
+  EXPECT_EQ(value, 1e-7);
+  // Past the exact fast path
+  EXPECT_TRUE(ParseJsonNumber("9007199254740993", &value));
+  EXPECT_EQ(value, 9007199254740992.0);
+  EXPECT_TRUE(ParseJsonNumber("123456789012345678901234567890", &value));
+  EXPECT_EQ(value, 1.2345678901234568e29);
+  EXPECT_TRUE(ParseJsonNumber("1.7976931348623157e308", &value));
+  EXPECT_EQ(value, 1.7976931348623157e308);
+  EXPECT_TRUE(ParseJsonNumber("4.9e-324", &value));
+  EXPECT_EQ(value, 4.9e-324);
+
+  for (const char* bad : {"", "-", "01", ".5", "5.", "1e", "1e+", "0x10",
+                          "+1", "1 ", "NaN", "Infinity"}) {
+    EXPECT_TRUE(!ParseJsonNumber(bad, &value));
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestValues();
+  TestEscapes();
+  TestChunkBoundaries();
+  TestErrors();
+  TestDepthAndStop();
+  TestNumbers();
+  return TEST_RESULT();
+}
@@ -0,0 +1,141 @@
+#include "native/key_burst_detector.h"
+
+#include <string>
+
+#include "test_util.h"
+
+namespace {
+
+using Key = KeyBurstResult::Key;
+
+// Types |text| one character every |gap_ms| from |*time_ms|; returns the
+// result of the last key.
+KeyBurstResult Type(KeyBurstDetector* detector, const std::string& text,
+                    int64_t gap_ms, int64_t* time_ms) {
+  KeyBurstResult result;
+  for (char c : text) {
+    *time_ms += gap_ms;
+    result = detector->OnPress(KeyKind::kCharacter,
+                               static_cast<unsigned char>(c), *time_ms);
+  }
+  return result;
+}
+
+void TestScanEndedByEnter() {
+  KeyBurstDetector detector;
+  int64_t now = 1000;
+  KeyBurstResult result = Type(&detector, "0108806469007312", 4, &now);
+  EXPECT_TRUE(result.key == Key::kHold);
+  EXPECT_TRUE(!result.release_held);
+  EXPECT_TRUE(detector.holding());
+  EXPECT_EQ(detector.deadline_ms(), now + 30);
+
+  result = detector.OnPress(KeyKind::kTerminator, '\r', now + 3);
+  EXPECT_EQ(result.barcode, "0108806469007312");
+  EXPECT_TRUE(result.key == Key::kDrop);
+  EXPECT_TRUE(!result.release_held);
+  EXPECT_TRUE(!detector.holding());
+  EXPECT_EQ(detector.deadline_ms(), -1);
+}
+
+// A scanner without a suffix: the pause ends the scan
+void TestScanEndedByPause() {
+  KeyBurstDetector detector;
+  int64_t now = 0;
+  Type(&detector, "8806469007312", 2, &now);
+  KeyBurstResult result = detector.OnTimeout();
+  EXPECT_EQ(result.barcode, "8806469007312");
+  EXPECT_TRUE(!result.release_held);
+
+  // The next key after a late timer: the pause is seen from the key
+  Type(&detector, "8806469007312", 2, &now);
+  result = detector.OnPress(KeyKind::kCharacter, 'a', now + 500);
+  EXPECT_EQ(result.barcode, "8806469007312");
+  EXPECT_TRUE(result.key == Key::kHold);
+  result = detector.OnTimeout();
+  EXPECT_TRUE(result.release_held);
+  EXPECT_TRUE(result.barcode.empty());
+}
+
+void TestTypingPassesThrough() {
+  KeyBurstDetector detector;
+  int64_t now = 0;
+  // Each key is held for one gap at most, then released
+  KeyBurstResult result = Type(&detector, "k", 120, &now);
+  EXPECT_TRUE(result.key == Key::kHold);
+  result = detector.OnPress(KeyKind::kCharacter, 'i', now + 120);
+  EXPECT_TRUE(result.release_held);
+  EXPECT_TRUE(result.key == Key::kHold);
+  result = detector.OnTimeout();
+  EXPECT_TRUE(result.release_held);
+
+  // A quick roll of a few keys is still typing
+  Type(&detector, "the", 15, &now);
+  result = detector.OnPress(KeyKind::kTerminator, '\r', now + 10);
+  EXPECT_TRUE(result.release_held);
+  EXPECT_TRUE(result.key == Key::kDeliver);
+  EXPECT_TRUE(result.barcode.empty());
+
+  // Enter, arrows and modifiers with nothing held go straight through
+  EXPECT_TRUE(detector.OnPress(KeyKind::kTerminator, 0, now + 200).key ==
+              Key::kDeliver);
+  EXPECT_TRUE(detector.OnPress(KeyKind::kOther, 0, now + 300).key ==
+              Key::kDeliver);
+  EXPECT_TRUE(detector.OnPress(KeyKind::kModifier, 0, now + 400).key ==
+              Key::kDeliver);
+  EXPECT_TRUE(!detector.OnTimeout().release_held);
+}
+
+void TestModifiersAndOtherKeys() {
+  KeyBurstDetector detector;
+  int64_t now = 0;
+  // Shift for capitals stays with the scan
+  Type(&detector, "21", 3, &now);
+  EXPECT_TRUE(detector.OnPress(KeyKind::kModifier, 0, now + 3).key ==
+              Key::kHold);
+  now += 3;
+  Type(&detector, "ABC123456", 3, &now);
+  KeyBurstResult result = detector.OnPress(KeyKind::kTerminator, '\t', now);
+  EXPECT_EQ(result.barcode, "21ABC123456");
+
+  // Another key ends a burst early, as typing when short
+  Type(&detector, "ab", 5, &now);
+  result = detector.OnPress(KeyKind::kOther, 0, now + 5);
+  EXPECT_TRUE(result.release_held);
+  EXPECT_TRUE(result.key == Key::kDeliver);
+
+  Type(&detector, "abc", 5, &now);
+  result = detector.Release();
+  EXPECT_TRUE(result.release_held);
+  EXPECT_TRUE(!detector.holding());
+}
+
+void TestOptions() {
+  KeyBurstOptions options;
+  options.max_gap_ms = 60;
+  options.min_length = 4;
+  KeyBurstDetector detector(options);
+  int64_t now = 0;
+  // Slower scanner, shorter code
+  Type(&detector, "1234", 50, &now);
+  KeyBurstResult result = detector.OnPress(KeyKind::kTerminator, '\r', now);
+  EXPECT_EQ(result.barcode, "1234");
+
+  // Non-ASCII characters come out as UTF-8
+  Type(&detector, "ab", 10, &now);
+  detector.OnPress(KeyKind::kCharacter, 0xAC00, now + 10);
+  detector.OnPress(KeyKind::kCharacter, 0x1F600, now + 20);
+  result = detector.OnTimeout();
+  EXPECT_EQ(result.barcode, "ab\xEA\xB0\x80\xF0\x9F\x98\x80");
+}
+
+}  // namespace
+
+int main() {
+  TestScanEndedByEnter();
+  TestScanEndedByPause();
+  TestTypingPassesThrough();
+  TestModifiersAndOtherKeys();
+  TestOptions();
+  return TEST_RESULT();
+}
@@ -0,0 +1,125 @@
+#include "native/line_framer.h"
+
+#include <string>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+// Feed |chunks| one at a time and collect the frames.
+std::vector<std::string> Frame(LineFramer* framer,
+                               const std::vector<std::string>& chunks) {
+  std::vector<std::string> frames;
+  for (const std::string& chunk : chunks) {
+    framer->Feed(chunk.data(), chunk.size(), [&frames](std::string_view f) {
+      frames.emplace_back(f);
+    });
+  }
+  return frames;
+}
+
+void TestAnyNewline() {
+  LineFramer framer;
+  std::vector<std::string> frames = Frame(
+      &framer, {"8806469007312\r\n0188064690", "073121\r21ABC\n\n\r",
+                "a-very-long-line-that-crosses-the-16-byte-simd-block\n"});
+  EXPECT_EQ(frames.size(), 4u);
+  if (frames.size() == 4) {
+    EXPECT_EQ(frames[0], "8806469007312");
+    EXPECT_EQ(frames[1], "0188064690073121");
+    EXPECT_EQ(frames[2], "21ABC");
+    EXPECT_EQ(frames[3], "a-very-long-line-that-crosses-the-16-byte-simd-block");
+  }
+  EXPECT_EQ(framer.pending(), 0u);
+  EXPECT_EQ(framer.stats().frames, 4u);
+}
+
+void TestStrictCrLfAcrossReads() {
+  LineFramerOptions options;
+  options.terminator = "\r\n";
+  LineFramer framer(options);
+  // The terminator is split between reads, and a lone CR is payload.
+  std::vector<std::string> frames =
+      Frame(&framer, {"AB\rC\r", "\nDEF", "\r", "\n", "GH\r\n"});
+  EXPECT_EQ(frames.size(), 3u);
+  if (frames.size() == 3) {
+    EXPECT_EQ(frames[0], "AB\rC");
+    EXPECT_EQ(frames[1], "DEF");
+    EXPECT_EQ(frames[2], "GH");
+  }
+}
+
+void TestLfOnly() {
+  LineFramerOptions options;
+  options.terminator = "\n";
+  LineFramer framer(options);
+  std::vector<std::string> frames = Frame(&framer, {"A\rB\nC", "D\n"});
+  EXPECT_EQ(frames.size(), 2u);
+  if (frames.size() == 2) {
+    EXPECT_EQ(frames[0], "A\rB");
+    EXPECT_EQ(frames[1], "CD");
+  }
+}
+
+void TestMultiByteTerminatorOverThreeReads() {
+  LineFramerOptions options;
+  options.terminator = "END";
+  LineFramer framer(options);
+  std::vector<std::string> frames = Frame(&framer, {"xE", "N", "Dy", "END"});
+  EXPECT_EQ(frames.size(), 2u);
+  if (frames.size() == 2) {
+    EXPECT_EQ(frames[0], "x");
+    EXPECT_EQ(frames[1], "y");
+  }
+}
+
+void TestPrefixSuffix() {
+  LineFramerOptions options;
+  options.prefix = "\x02";
+  options.terminator = "\x03";
+  LineFramer framer(options);
+  std::vector<std::string> frames =
+      Frame(&framer, {"noise\x02" "123\x03\x02" "45", "6\x03junk\x03"});
+  EXPECT_EQ(frames.size(), 2u);
+  if (frames.size() == 2) {
+    EXPECT_EQ(frames[0], "123");
+    EXPECT_EQ(frames[1], "456");
+  }
+  EXPECT_EQ(framer.stats().dropped_no_prefix, 1u);
+}
+
+void TestOversizeIsDropped() {
+  LineFramerOptions options;
+  options.max_frame_length = 8;
+  LineFramer framer(options);
+  std::vector<std::string> frames =
+      Frame(&framer, {"0123456", "789abcdef", "ghij\nOK\n"});
+  EXPECT_EQ(frames.size(), 1u);
+  if (frames.size() == 1) {
+    EXPECT_EQ(frames[0], "OK");
+  }
+  EXPECT_EQ(framer.stats().dropped_oversize, 1u);
+}
+
+void TestFindNewline() {
+  std::string data(100, 'x');
+  EXPECT_EQ(FindNewline(data.data(), data.size()), 100u);
+  data[37] = '\n';
+  data[70] = '\r';
+  EXPECT_EQ(FindNewline(data.data(), data.size()), 37u);
+  EXPECT_EQ(FindNewline(data.data() + 38, data.size() - 38), 32u);
+}
+
+}  // namespace
+
+int main() {
+  TestAnyNewline();
+  TestStrictCrLfAcrossReads();
+  TestLfOnly();
+  TestMultiByteTerminatorOverThreeReads();
+  TestPrefixSuffix();
+  TestOversizeIsDropped();
+  TestFindNewline();
+  return TEST_RESULT();
+}
@@ -0,0 +1,205 @@
+#include "native/metrics_registry.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "test_util.h"
+
+namespace {
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path);
+  return std::string((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+}
+
+bool Contains(const std::string& text, const std::string& needle) {
+  return text.find(needle) != std::string::npos;
+}
+
+void TestBucketsCoverEveryValue() {
+  EXPECT_EQ(LatencyHistogram::BucketOf(0), 0u);
+  EXPECT_EQ(LatencyHistogram::BucketOf(127), 127u);
+  EXPECT_EQ(LatencyHistogram::BucketOf(128), 128u);
+  EXPECT_EQ(LatencyHistogram::BucketOf(129), 128u);
+  EXPECT_EQ(LatencyHistogram::BucketOf(130), 129u);
+  EXPECT_EQ(LatencyHistogram::BucketOf(~0ull),
+            LatencyHistogram::kBucketCount - 1);
+
+  // Every value lies within its bucket, and the bucket is narrow
+  bool within = true;
+  for (uint64_t value = 1; value < (1ull << 36); value = value * 3 / 2 + 1) {
+    const size_t bucket = LatencyHistogram::BucketOf(value);
+    const uint64_t upper = LatencyHistogram::BucketUpperBound(bucket);
+    const uint64_t lower =
+        bucket == 0 ? 0 : LatencyHistogram::BucketUpperBound(bucket - 1) + 1;
+    within &= lower <= value && value <= upper;
+    within &= (upper - lower) * 64 <= value;
+  }
+  EXPECT_TRUE(within);
+}
+
+void TestQuantiles() {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.Snapshot().ValueAtQuantile(0.5), 0u);
+  for (int64_t us = 1; us <= 10000; ++us) {
+    histogram.Record(us);
+  }
+  histogram.Record(-5);
+  const HistogramSnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ(snapshot.count, 10001u);
+  EXPECT_EQ(snapshot.sum_us, 50005000u);
+  EXPECT_EQ(snapshot.min_us, 0u);
+  EXPECT_EQ(snapshot.max_us, 10000u);
+  const uint64_t p50 = snapshot.ValueAtQuantile(0.5);
+  const uint64_t p99 = snapshot.ValueAtQuantile(0.99);
+  EXPECT_TRUE(p50 >= 5000 && p50 <= 5000 + 5000 / 64);
+  EXPECT_TRUE(p99 >= 9900 && p99 <= 9900 + 9900 / 64);
+  EXPECT_EQ(snapshot.ValueAtQuantile(1.0), 10000u);
+  EXPECT_EQ(snapshot.ValueAtQuantile(0.0), 0u);
+}
+
+void TestConcurrentUpdatesAreCounted() {
+  MetricsRegistry registry;
+  MetricCounter& counter = registry.GetCounter("pharm_test_total");
+  LatencyHistogram& histogram = registry.GetHistogram("pharm_test_seconds");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 6; ++t) {
+    threads.emplace_back([&counter, &histogram, t] {
+      for (int i = 0; i < 50000; ++i) {
+        counter.Add();
+        histogram.Record(t * 1000 + i % 100);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(counter.Value(), 300000u);
+  const HistogramSnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ(snapshot.count, 300000u);
+  EXPECT_EQ(snapshot.max_us, 5099u);
+  // The same name and labels give the same metric
+  EXPECT_TRUE(&registry.GetCounter("pharm_test_total") == &counter);
+}
+
+void TestPrometheusText() {
+  MetricsRegistry registry;
+  registry.GetCounter("pharm_serial_lines_total", MetricLabel("port", "1"),
+                      "Lines framed")
+      .Add(3);
+  registry.GetCounter("pharm_serial_lines_total", MetricLabel("port", "0"))
+      .Add(2);
+  registry.GetGauge("pharm_queue_depth").Set(-4);
+  LatencyHistogram& rpc = registry.GetHistogram(
+      "pharm_rpc_seconds", MetricLabel("function", "get \"rx\"\n"),
+      "RPC latency");
+  rpc.Record(1500);
+  rpc.Record(2500);
+  // Another kind under a taken name is not exported
+  registry.GetGauge("pharm_serial_lines_total").Set(99);
+  MetricCounter& dropped = registry.GetCounter("pharm_dropped_total");
+  dropped.Add(4);
+  dropped.Mirror(7);
+
+  const std::string text = registry.ToPrometheusText();
+  EXPECT_TRUE(Contains(text, "# TYPE pharm_dropped_total counter\n"
+                             "pharm_dropped_total 7\n"));
+  EXPECT_TRUE(Contains(text, "# TYPE pharm_queue_depth gauge\n"
+                             "pharm_queue_depth -4\n"));
+  EXPECT_TRUE(Contains(text, "# HELP pharm_serial_lines_total Lines framed\n"
+                             "# TYPE pharm_serial_lines_total counter\n"
+                             "pharm_serial_lines_total{port=\"0\"} 2\n"
+                             "pharm_serial_lines_total{port=\"1\"} 3\n"));
+  EXPECT_TRUE(!Contains(text, " 99\n"));
+  const std::string labels = "function=\"get \\\"rx\\\"\\n\"";
+  EXPECT_TRUE(Contains(text, "# TYPE pharm_rpc_seconds summary\n"));
+  EXPECT_TRUE(Contains(text, "pharm_rpc_seconds{" + labels +
+                                 ",quantile=\"0.5\"} 0.001503\n"));
+  EXPECT_TRUE(Contains(text, "pharm_rpc_seconds{" + labels +
+                                 ",quantile=\"0.999\"} 0.002500\n"));
+  EXPECT_TRUE(
+      Contains(text, "pharm_rpc_seconds_sum{" + labels + "} 0.004000\n"));
+  EXPECT_TRUE(Contains(text, "pharm_rpc_seconds_count{" + labels + "} 2\n"));
+  // Families are sorted by name
+  EXPECT_TRUE(text.find("pharm_dropped") < text.find("pharm_queue_depth"));
+  dropped.Mirror(2);
+  EXPECT_EQ(dropped.Value(), 2u);
+}
+
+void TestWriteFileReplaces() {
+  MetricsRegistry registry;
+  MetricCounter& scans = registry.GetCounter("pharm_scans_total");
+  const std::string path = TempFilePath("metrics_registry_test.prom");
+  scans.Add(10);
+  EXPECT_TRUE(registry.WriteFile(path));
+  scans.Add(5);
+  EXPECT_TRUE(registry.WriteFile(path));
+  EXPECT_EQ(ReadFile(path), "# TYPE pharm_scans_total counter\n"
+                            "pharm_scans_total 15\n");
+  std::ifstream temporary(path + ".tmp");
+  EXPECT_TRUE(!temporary.good());
+
+  {
+    MetricsFileWriter writer(&registry, path, 60000);
+    scans.Add(1);
+  }
+  // Written once more on the way out
+  EXPECT_TRUE(Contains(ReadFile(path), "pharm_scans_total 16\n"));
+  std::remove(path.c_str());
+  EXPECT_TRUE(!registry.WriteFile("/nonexistent-dir/metrics.prom"));
+}
+
+// The FFI library has its own process registry, as it does next to the
+// runner.
+void TestFfiRegistry() {
+  PharmMetricHistogram* voice = pharm_metrics_histogram(
+      "pharm_scan_to_voice_seconds", nullptr, nullptr, "Scan to speech");
+  EXPECT_TRUE(voice != nullptr);
+  EXPECT_TRUE(pharm_metrics_histogram("pharm_scan_to_voice_seconds", nullptr,
+                                      nullptr, nullptr) == voice);
+  pharm_metrics_histogram_record(voice, 120000);
+  pharm_metrics_counter_add(
+      pharm_metrics_counter("pharm_scans_total", "source", "keyboard", nullptr),
+      2);
+  pharm_metrics_gauge_set(
+      pharm_metrics_gauge("pharm_pending_checks", nullptr, nullptr, nullptr),
+      7);
+  EXPECT_TRUE(pharm_metrics_counter("", nullptr, nullptr, nullptr) ==
+              nullptr);
+  pharm_metrics_counter_add(nullptr, 1);
+
+  const std::string path = TempFilePath("metrics_registry_ffi.prom");
+  EXPECT_EQ(pharm_metrics_write(path.c_str()), 1);
+  const std::string text = ReadFile(path);
+  EXPECT_TRUE(Contains(text, "pharm_scans_total{source=\"keyboard\"} 2\n"));
+  EXPECT_TRUE(Contains(text, "pharm_pending_checks 7\n"));
+  EXPECT_TRUE(Contains(text, "pharm_scan_to_voice_seconds_count 1\n"));
+  EXPECT_TRUE(!Contains(ProcessMetrics().ToPrometheusText(),
+                        "pharm_scans_total"));
+  std::remove(path.c_str());
+
+  pharm_metrics_start_writer(path.c_str(), 50);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  pharm_metrics_start_writer(nullptr, 0);
+  EXPECT_TRUE(Contains(ReadFile(path), "pharm_pending_checks 7\n"));
+  std::remove(path.c_str());
+  EXPECT_EQ(pharm_metrics_write(""), 0);
+}
+
+}  // namespace
+
+int main() {
+  TestBucketsCoverEveryValue();
+  TestQuantiles();
+  TestConcurrentUpdatesAreCounted();
+  TestPrometheusText();
+  TestWriteFileReplaces();
+  TestFfiRegistry();
+  return TEST_RESULT();
+}
@@ -0,0 +1,133 @@
+#include "native/name_index.h"
+
+#include <string>
+#include <vector>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "test_util.h"
+
+namespace {
+
+std::vector<uint32_t> Search(const NameIndex& index, const std::string& query) {
+  uint32_t ids[16];
+  const size_t count = index.Search(query, ids, 16);
+  return std::vector<uint32_t>(ids, ids + (count < 16 ? count : 16));
+}
+
+NameIndex MakeIndex() {
+  NameIndex index;
+  index.Add("김민수", "12 19800101 5001");  // 0
+  index.Add("박민지", "13 19911111 5002");  // 1
+  index.Add("기미영", "14 20010203 5003");  // 2
+  index.Add("김 민", "15 19751224 5004");   // 3
+  index.Add("이수민", "16 19600505 5005");  // 4
+  index.Add("달기", "17 19990909 5006");    // 5
+  index.Add("John Smith", "18 19850315 5007");  // 6
+  return index;
+}
+
+void TestSyllables() {
+  const NameIndex index = MakeIndex();
+  EXPECT_TRUE((Search(index, "김민") == std::vector<uint32_t>{3, 0}));
+  EXPECT_TRUE((Search(index, "민") == std::vector<uint32_t>{3, 0, 1, 4}));
+  EXPECT_TRUE((Search(index, "수민") == std::vector<uint32_t>{4}));
+  EXPECT_TRUE(Search(index, "최").empty());
+  EXPECT_TRUE(Search(index, "민김").empty());
+}
+
+void TestInitials() {
+  const NameIndex index = MakeIndex();
+  EXPECT_TRUE((Search(index, "ㄱㅁㅅ") == std::vector<uint32_t>{0}));
+  // Exact syllables rank above initials
+  EXPECT_TRUE((Search(index, "ㄱㅁ") == std::vector<uint32_t>{3, 0, 2}));
+  EXPECT_TRUE((Search(index, "김ㅁ") == std::vector<uint32_t>{3, 0}));
+  EXPECT_TRUE((Search(index, "ㅁㅈ") == std::vector<uint32_t>{1}));
+}
+
+void TestHalfTypedSyllable() {
+  const NameIndex index = MakeIndex();
+  // 미 on the way to 민
+  EXPECT_TRUE((Search(index, "김미") == std::vector<uint32_t>{3, 0}));
+  // 김 on the way to 기미: the final becomes the next initial
+  EXPECT_TRUE((Search(index, "김") == std::vector<uint32_t>{3, 0, 2}));
+  // 닭 on the way to 달기, and 달 on the way to 닭
+  EXPECT_TRUE((Search(index, "닭") == std::vector<uint32_t>{5}));
+  NameIndex chicken;
+  chicken.Add("닭", "");
+  EXPECT_TRUE((Search(chicken, "달") == std::vector<uint32_t>{0}));
+  // Only the last character may be half typed
+  EXPECT_TRUE(Search(index, "미수").empty());
+}
+
+void TestNumbersAndAscii() {
+  const NameIndex index = MakeIndex();
+  EXPECT_TRUE((Search(index, "5003") == std::vector<uint32_t>{2}));
+  EXPECT_TRUE((Search(index, "1980") == std::vector<uint32_t>{0}));
+  // A whole field beats an infix
+  EXPECT_TRUE((Search(index, "15") == std::vector<uint32_t>{3, 6}));
+  EXPECT_TRUE((Search(index, "1975") == std::vector<uint32_t>{3}));
+  EXPECT_TRUE((Search(index, "SMITH") == std::vector<uint32_t>{6}));
+  EXPECT_TRUE((Search(index, "john s") == std::vector<uint32_t>{6}));
+  EXPECT_TRUE(Search(index, "   ").empty());
+}
+
+void TestCapacity() {
+  NameIndex index;
+  for (int i = 0; i < 100; ++i) {
+    index.Add("김" + std::to_string(i), "");
+  }
+  uint32_t ids[3];
+  EXPECT_EQ(index.Search("ㄱ", ids, 3), 100u);
+  EXPECT_EQ(ids[0], 0u);
+  EXPECT_EQ(ids[1], 1u);
+  EXPECT_EQ(index.Search("ㄱ", nullptr, 0), 100u);
+  index.Clear();
+  EXPECT_EQ(index.Search("ㄱ", ids, 3), 0u);
+  EXPECT_EQ(index.size(), 0u);
+}
+
+void TestMalformedUtf8() {
+  NameIndex index;
+  index.Add(std::string("\xEA\xB9", 2), "");
+  index.Add("\xC3\x28정", "");
+  uint32_t ids[4];
+  EXPECT_EQ(index.Search("정", ids, 4), 1u);
+  EXPECT_EQ(ids[0], 1u);
+  EXPECT_EQ(index.Search(std::string("\xFF", 1), ids, 4), 2u);
+}
+
+void TestFfi() {
+  PharmNameIndex* index = pharm_name_index_create();
+  const std::string names = "김민수\n박민지\n\n";
+  const std::string numbers = "1 5001\n2 5002\n3 5003\n";
+  EXPECT_EQ(pharm_name_index_build(index, names.data(),
+                                   static_cast<int32_t>(names.size()),
+                                   numbers.data(),
+                                   static_cast<int32_t>(numbers.size()), 3),
+            3);
+  int32_t ids[4];
+  const std::string query = "ㅁ";
+  EXPECT_EQ(pharm_name_index_search(index, query.data(),
+                                    static_cast<int32_t>(query.size()), ids,
+                                    4),
+            2);
+  EXPECT_EQ(ids[0], 0);
+  EXPECT_EQ(ids[1], 1);
+  EXPECT_EQ(pharm_name_index_search(index, "5003", 4, ids, 4), 1);
+  EXPECT_EQ(ids[0], 2);
+  EXPECT_EQ(pharm_name_index_search(index, nullptr, 0, ids, 4), 0);
+  pharm_name_index_destroy(index);
+}
+
+}  // namespace
+
+int main() {
+  TestSyllables();
+  TestInitials();
+  TestHalfTypedSyllable();
+  TestNumbersAndAscii();
+  TestCapacity();
+  TestMalformedUtf8();
+  TestFfi();
+  return TEST_RESULT();
+}
@@ -0,0 +1,66 @@
+#ifndef NATIVE_TEST_PTY_UTIL_H_
+#define NATIVE_TEST_PTY_UTIL_H_
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+// Pseudo-terminal pair standing in for a serial scanner. The code under test
+// opens slave_path() like a real tty; the test writes scanner output to and
+// reads host output from the master side.
+class TestPty {
+ public:
+  TestPty() {
+    master_ = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_ >= 0 && grantpt(master_) == 0 && unlockpt(master_) == 0) {
+      slave_path_ = ptsname(master_);
+    }
+  }
+  ~TestPty() { CloseMaster(); }
+
+  bool ok() const { return master_ >= 0 && !slave_path_.empty(); }
+  const std::string& slave_path() const { return slave_path_; }
+  int master() const { return master_; }
+
+  // Send bytes as if the scanner had emitted them
+  bool Send(const std::string& data) {
+    return write(master_, data.data(), data.size()) ==
+           static_cast<ssize_t>(data.size());
+  }
+
+  // Read up to |max| bytes written by the host, waiting |timeout_ms|
+  std::string Receive(size_t max, int timeout_ms) {
+    std::string out;
+    struct pollfd pfd = {master_, POLLIN, 0};
+    while (out.size() < max && poll(&pfd, 1, timeout_ms) > 0) {
+      char buffer[256];
+      ssize_t n = read(master_, buffer, sizeof(buffer));
+      if (n <= 0) break;
+      out.append(buffer, static_cast<size_t>(n));
+    }
+    return out;
+  }
+
+  // Simulate the scanner being unplugged
+  void CloseMaster() {
+    if (master_ >= 0) {
+      close(master_);
+      master_ = -1;
+    }
+  }
+
+ private:
+  int master_ = -1;
+  std::string slave_path_;
+};
+
+// Wait until |fd| is readable or hung up.
+inline bool WaitReadable(int fd, int timeout_ms) {
+  struct pollfd pfd = {fd, POLLIN, 0};
+  return poll(&pfd, 1, timeout_ms) > 0;
+}
+
+#endif  // NATIVE_TEST_PTY_UTIL_H_
@@ -0,0 +1,116 @@
+#include "native/recipe_index.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+struct Row {
+  std::string code;
+  char type;
+  bool complete;
+};
+
+// The linear scan handleBarcode used before the index.
+std::vector<uint32_t> Scan(const std::vector<Row>& rows,
+                           const std::string& barcode) {
+  std::vector<uint32_t> incomplete;
+  std::vector<uint32_t> complete;
+  for (uint32_t i = 0; i < rows.size(); ++i) {
+    const Row& row = rows[i];
+    const size_t digits = row.type == 'E' ? 12 : 11;
+    if (barcode.size() < digits || row.code.size() < digits ||
+        row.code.compare(0, digits, barcode, 0, digits) != 0) {
+      continue;
+    }
+    (row.complete ? complete : incomplete).push_back(i);
+  }
+  incomplete.insert(incomplete.end(), complete.begin(), complete.end());
+  return incomplete;
+}
+
+std::vector<uint32_t> Lookup(const RecipeIndex& index,
+                             const std::string& barcode) {
+  uint32_t rows[64];
+  const size_t count = index.Lookup(barcode, rows, 64);
+  return std::vector<uint32_t>(rows, rows + count);
+}
+
+void TestTypeRules() {
+  RecipeIndex index;
+  index.AddRow("8806469007312", 'T', false);  // 0: 11-digit match
+  index.AddRow("8806469007329", 'E', false);  // 1: 12 digits differ
+  index.AddRow("8806469007318", 'E', false);  // 2: 12-digit match
+  index.AddRow("", 'T', false);               // 3: no barcode
+  index.AddRow("88064690073", 'T', false);    // 4: exactly 11 digits
+  index.AddRow("ABCDEFGHIJKL", 'T', false);   // 5: not numeric
+
+  EXPECT_TRUE((Lookup(index, "8806469007312") ==
+               std::vector<uint32_t>{0, 2, 4}));
+  EXPECT_TRUE((Lookup(index, "8806469007399") ==
+               std::vector<uint32_t>{0, 4}));
+  EXPECT_TRUE(Lookup(index, "8806469").empty());
+  EXPECT_TRUE(Lookup(index, "ABCDEFGHIJKL").empty());
+  EXPECT_EQ(index.size(), 6u);
+}
+
+void TestIncompleteFirst() {
+  RecipeIndex index;
+  index.AddRow("8806469007312", 'T', true);
+  index.AddRow("8806469007312", 'T', false);
+  index.AddRow("8806469007312", 'E', true);
+  index.AddRow("8806469007312", 'T', false);
+
+  EXPECT_TRUE((Lookup(index, "8806469007312") ==
+               std::vector<uint32_t>{1, 3, 0, 2}));
+  EXPECT_EQ(index.Best("8806469007312"), 1u);
+
+  index.SetComplete(1, true);
+  index.SetComplete(3, true);
+  EXPECT_EQ(index.Best("8806469007312"), 0u);
+  index.SetComplete(2, false);
+  EXPECT_EQ(index.Best("8806469007312"), 2u);
+  EXPECT_EQ(index.Best("8806469999999"), RecipeIndex::kNoRow);
+
+  // The return value counts every match even when |rows| is short.
+  uint32_t one[1];
+  EXPECT_EQ(index.Lookup("8806469007312", one, 1), 4u);
+  EXPECT_EQ(one[0], 2u);
+}
+
+// Random multi-day batch checked against the linear scan, large enough to
+// make the table grow several times.
+void TestMatchesScan() {
+  std::mt19937 rng(7);
+  std::vector<Row> rows;
+  RecipeIndex index;
+  for (int i = 0; i < 5000; ++i) {
+    std::string code = "88064";
+    for (int d = 0; d < 8; ++d) {
+      code += static_cast<char>('0' + rng() % (d < 5 ? 3 : 10));
+    }
+    Row row{code, rng() % 4 == 0 ? 'E' : 'T', rng() % 3 == 0};
+    index.AddRow(row.code, row.type, row.complete);
+    rows.push_back(row);
+  }
+  for (int i = 0; i < 2000; ++i) {
+    const std::string& barcode = rows[rng() % rows.size()].code;
+    EXPECT_TRUE(Lookup(index, barcode) == Scan(rows, barcode));
+  }
+
+  index.Clear();
+  EXPECT_EQ(index.size(), 0u);
+  EXPECT_TRUE(Lookup(index, rows[0].code).empty());
+}
+
+}  // namespace
+
+int main() {
+  TestTypeRules();
+  TestIncompleteFirst();
+  TestMatchesScan();
+  return TEST_RESULT();
+}
@@ -0,0 +1,198 @@
+#include "native/recipe_store.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "test_util.h"
+
+namespace {
+
+struct Line {
+  const char* type;
+  const char* use;  // null when the row has no 'use'
+  int separation;
+  double morning, afternoon, evening, night;
+};
+
+RecipeStore MakeStore(const std::vector<Line>& lines) {
+  RecipeStore store;
+  store.Reset(lines.size());
+  for (uint32_t row = 0; row < lines.size(); ++row) {
+    const Line& line = lines[row];
+    store.SetString(row, RecipeColumn::kType, line.type);
+    if (line.use != nullptr) {
+      store.SetString(row, RecipeColumn::kUse, line.use);
+    }
+    if (line.separation != RecipeStore::kNoSeparation) {
+      store.SetNumber(row, RecipeColumn::kSeparation, line.separation);
+    }
+    store.SetNumber(row, RecipeColumn::kMorning, line.morning);
+    store.SetNumber(row, RecipeColumn::kAfternoon, line.afternoon);
+    store.SetNumber(row, RecipeColumn::kEvening, line.evening);
+    store.SetNumber(row, RecipeColumn::kNight, line.night);
+  }
+  return store;
+}
+
+void TestFieldForKey() {
+  EXPECT_TRUE(RecipeStore::FieldForKey("checked_amount").column ==
+              RecipeColumn::kChecked);
+  EXPECT_TRUE(RecipeStore::FieldForKey("Checked").column ==
+              RecipeColumn::kChecked);
+  EXPECT_TRUE(RecipeStore::FieldForKey("checked_amount").rank <
+              RecipeStore::FieldForKey("Checked").rank);
+  EXPECT_TRUE(RecipeStore::FieldForKey("typeCode").column ==
+              RecipeColumn::kType);
+  EXPECT_TRUE(RecipeStore::FieldForKey("약품명").column ==
+              RecipeColumn::kProductName);
+  EXPECT_TRUE(RecipeStore::FieldForKey("seperate").column ==
+              RecipeColumn::kSeparation);
+  EXPECT_TRUE(RecipeStore::FieldForKey("location").column ==
+              RecipeColumn::kLocation);
+  EXPECT_TRUE(RecipeStore::FieldForKey("special").column ==
+              RecipeColumn::kCount);
+}
+
+void TestSetters() {
+  RecipeStore store;
+  store.Reset(1);
+  store.SetString(0, RecipeColumn::kType, " e ");
+  store.SetString(0, RecipeColumn::kTotal, " 12.5 ");
+  store.SetString(0, RecipeColumn::kDose, "abc");
+  store.SetString(0, RecipeColumn::kUse, "TRUE");
+  store.SetString(0, RecipeColumn::kAtc, "1");
+  store.SetNumber(0, RecipeColumn::kChecked, 3.5);
+  store.SetNumber(0, RecipeColumn::kRxrecipeId, 1234567890123.0);
+  store.SetNumber(0, RecipeColumn::kPackBarcode, 8806469007312.0);
+  store.SetString(0, RecipeColumn::kProductName, "타이레놀정500mg");
+
+  const auto* type =
+      static_cast<const uint8_t*>(store.ColumnData(RecipeColumn::kType));
+  EXPECT_EQ(type[0], 'E');
+  store.SetString(0, RecipeColumn::kType, "TAB");
+  EXPECT_EQ(type[0], 0);
+  store.SetString(0, RecipeColumn::kType, " t");
+  EXPECT_EQ(type[0], 'T');
+  store.SetNumber(0, RecipeColumn::kSeparation, 2.9);
+  EXPECT_EQ(static_cast<const int32_t*>(
+                store.ColumnData(RecipeColumn::kSeparation))[0], 2);
+  EXPECT_EQ(store.total(0), 12.5);
+  EXPECT_EQ(static_cast<const double*>(
+                store.ColumnData(RecipeColumn::kDose))[0], 0.0);
+  EXPECT_EQ(static_cast<const uint8_t*>(
+                store.ColumnData(RecipeColumn::kUse))[0], 1);
+  EXPECT_EQ(static_cast<const uint8_t*>(
+                store.ColumnData(RecipeColumn::kAtc))[0], 1);
+  EXPECT_EQ(store.checked(0), 4);
+  EXPECT_EQ(static_cast<const int64_t*>(
+                store.ColumnData(RecipeColumn::kRxrecipeId))[0],
+            1234567890123LL);
+  const auto* barcode = static_cast<const uint32_t*>(
+      store.ColumnData(RecipeColumn::kPackBarcode));
+  EXPECT_EQ(store.strings().Get(barcode[0]), "8806469007312");
+  const auto* name = static_cast<const uint32_t*>(
+      store.ColumnData(RecipeColumn::kProductName));
+  EXPECT_EQ(store.strings().Get(name[0]), "타이레놀정500mg");
+
+  EXPECT_EQ(store.AddChecked(0, 10), 14);
+  EXPECT_TRUE(store.IsComplete(0));
+  EXPECT_EQ(store.AddChecked(0, -100), 0);
+  EXPECT_EQ(store.AddChecked(0, 1 << 30), RecipeStore::kMaxChecked);
+
+  const uint32_t row = store.AddRow();
+  EXPECT_EQ(row, 1u);
+  EXPECT_EQ(store.size(), 2u);
+  EXPECT_EQ(static_cast<const int32_t*>(
+                store.ColumnData(RecipeColumn::kSeparation))[1],
+            RecipeStore::kNoSeparation);
+}
+
+void TestTotalsAndSeparations() {
+  const int kNone = RecipeStore::kNoSeparation;
+  const RecipeStore store = MakeStore({
+      {"T", "true", 1, 0.5, 0.5, 0, 1.25},  // pills round up: 1 1 0 2
+      {"E", nullptr, 2, 0.5, 0, 0.5, 0},    // use unset counts in totals
+      {"T", "false", 1, 9, 9, 9, 9},        // not in use
+      {"t", "1", 3, 1, 1, 1, 1},
+      {"T", "true", kNone, 0, 2, 0, 0},
+      {"T", "1", 3, 1, 0, 0, 0},
+      {"TAB", "1", 3, 0.5, 0, 0, 0},  // not 'T': no rounding
+  });
+
+  RecipeTotals all = store.Totals(0);
+  EXPECT_EQ(all.morning, 1 + 0.5 + 1 + 1 + 0.5);
+  EXPECT_EQ(all.afternoon, 1 + 0 + 1 + 2);
+  EXPECT_EQ(all.evening, 0 + 0.5 + 1);
+  EXPECT_EQ(all.night, 2.0 + 1);
+
+  RecipeTotals first = store.Totals(1);
+  EXPECT_EQ(first.morning, 1.0);
+  EXPECT_EQ(first.night, 2.0);
+  RecipeTotals third = store.Totals(3);
+  EXPECT_EQ(third.morning, 2.5);
+
+  // Only rows explicitly in use, without the missing separation
+  const std::vector<int32_t> separations = store.Separations();
+  EXPECT_EQ(separations.size(), 2u);
+  EXPECT_EQ(separations[0], 1);
+  EXPECT_EQ(separations[1], 3);
+}
+
+void TestFfi() {
+  PharmRecipeStore* store = pharm_recipe_store_create();
+  EXPECT_EQ(pharm_recipe_store_reset(store, 2), 2);
+
+  int32_t rank = -1;
+  EXPECT_EQ(pharm_recipe_store_column_for_key("Checked", 7, &rank),
+            static_cast<int32_t>(RecipeColumn::kChecked));
+  EXPECT_EQ(rank, 1);
+  EXPECT_EQ(pharm_recipe_store_column_for_key("special", 7, &rank), -1);
+  EXPECT_TRUE(pharm_recipe_store_column(store, 99) == nullptr);
+
+  // Writes through the column pointers land in the store
+  auto* morning = static_cast<double*>(pharm_recipe_store_column(
+      store, static_cast<int32_t>(RecipeColumn::kMorning)));
+  auto* separation = static_cast<int32_t*>(pharm_recipe_store_column(
+      store, static_cast<int32_t>(RecipeColumn::kSeparation)));
+  auto* use = static_cast<uint8_t*>(pharm_recipe_store_column(
+      store, static_cast<int32_t>(RecipeColumn::kUse)));
+  morning[0] = 1.5;
+  morning[1] = 2;
+  separation[0] = 4;
+  separation[1] = 2;
+  use[0] = 1;
+  use[1] = 1;
+
+  PharmRecipeTotals totals;
+  pharm_recipe_store_totals(store, 0, &totals);
+  EXPECT_EQ(totals.morning, 3.5);
+  pharm_recipe_store_totals(store, 2, &totals);
+  EXPECT_EQ(totals.morning, 2.0);
+
+  int32_t separations[1];
+  EXPECT_EQ(pharm_recipe_store_separations(store, separations, 1), 2);
+  EXPECT_EQ(separations[0], 2);
+
+  const char name[] = "아스피린";
+  const uint32_t id = pharm_recipe_store_intern(
+      store, name, static_cast<int32_t>(std::strlen(name)));
+  int32_t length = 0;
+  const char* bytes = pharm_recipe_store_string(store, id, &length);
+  EXPECT_EQ(std::string(bytes, static_cast<size_t>(length)), name);
+
+  EXPECT_EQ(pharm_recipe_store_reset(store, 0), 0);
+  EXPECT_TRUE(pharm_recipe_store_column(store, 0) == nullptr);
+  pharm_recipe_store_destroy(store);
+}
+
+}  // namespace
+
+int main() {
+  TestFieldForKey();
+  TestSetters();
+  TestTotalsAndSeparations();
+  TestFfi();
+  return TEST_RESULT();
+}
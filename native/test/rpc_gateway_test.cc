@@ -0,0 +1,370 @@
+// Drives RpcGateway against the stand-in server: connection reuse,
+// coalescing of identical reads, pipelining, timeouts, retries and the
+// server closing connections on its own.
+
+#include "native/rpc_gateway.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "native/rpc_standin_server.h"
+#include "test_util.h"
+
+namespace {
+
+RpcStandInReply Echo(const std::string& function, const std::string& body) {
+  return RpcStandInReply{200, "{\"fn\":\"" + function + "\",\"in\":" + body +
+                                  "}"};
+}
+
+RpcGatewayOptions OptionsFor(const RpcStandInServer& server) {
+  RpcGatewayOptions options;
+  options.port = server.port();
+  options.headers.push_back("apikey: test");
+  options.retry_backoff_ms = 5;
+  return options;
+}
+
+// Collects asynchronous results.
+class Results {
+ public:
+  RpcGateway::Callback Add() {
+    return [this](const RpcResult& result) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      results_.push_back(result);
+    };
+  }
+
+  std::vector<RpcResult> Wait(size_t count) {
+    const auto give_up =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < give_up) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (results_.size() >= count) {
+          return results_;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return results_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<RpcResult> results_;
+};
+
+void TestCallAndReuse() {
+  RpcStandInServer server(RpcStandInOptions(), Echo);
+  EXPECT_TRUE(server.ok());
+  RpcGateway gateway(OptionsFor(server));
+  EXPECT_TRUE(gateway.ok());
+
+  for (int i = 0; i < 5; ++i) {
+    const RpcResult result = gateway.CallSync(
+        "select_rxhead_bydate", "{\"_date\":\"2024-05-0" +
+                                    std::to_string(i + 1) + "\"}");
+    EXPECT_EQ(result.status, 200);
+    EXPECT_TRUE(result.ok());
+    EXPECT_EQ(result.attempts, 1);
+    EXPECT_EQ(result.body,
+              "{\"fn\":\"select_rxhead_bydate\",\"in\":{\"_date\":\"2024-05-0" +
+                  std::to_string(i + 1) + "\"}}");
+  }
+  // An empty body is sent as an empty JSON object
+  EXPECT_EQ(gateway.CallSync("get_miss_mached_drug", "").body,
+            "{\"fn\":\"get_miss_mached_drug\",\"in\":{}}");
+
+  const RpcGatewayStats stats = gateway.GetStats();
+  EXPECT_EQ(stats.calls, 6u);
+  EXPECT_EQ(stats.requests, 6u);
+  EXPECT_EQ(stats.connections_opened, 1u);
+  EXPECT_EQ(stats.reused, 5u);
+  EXPECT_EQ(server.connections(), 1u);
+
+  // Not a function name; nothing is sent
+  EXPECT_EQ(gateway.CallSync("../admin", "{}").error, "bad function name");
+  EXPECT_EQ(server.requests(), 6u);
+}
+
+void TestCoalescing() {
+  RpcStandInOptions server_options;
+  server_options.latency_ms = 50;
+  RpcStandInServer server(server_options, Echo);
+  RpcGateway gateway(OptionsFor(server));
+  RpcPolicy read;
+  read.coalesce = true;
+  gateway.SetPolicy("get_unit_from_pack_barcode", read);
+
+  Results results;
+  for (int i = 0; i < 5; ++i) {
+    gateway.Call("get_unit_from_pack_barcode", "{\"_b\":\"8806469007312\"}",
+                 results.Add());
+  }
+  std::vector<RpcResult> done = results.Wait(5);
+  EXPECT_EQ(done.size(), 5u);
+  int shared = 0;
+  for (const RpcResult& result : done) {
+    EXPECT_EQ(result.status, 200);
+    EXPECT_EQ(result.body, done[0].body);
+    shared += result.shared ? 1 : 0;
+  }
+  EXPECT_EQ(shared, 4);
+  EXPECT_EQ(server.requests(), 1u);
+  EXPECT_EQ(gateway.GetStats().coalesced, 4u);
+
+  // Writes are never shared
+  Results writes;
+  for (int i = 0; i < 3; ++i) {
+    gateway.Call("update_rxhead_complete", "{\"_tfn\":1}", writes.Add());
+  }
+  EXPECT_EQ(writes.Wait(3).size(), 3u);
+  EXPECT_EQ(server.requests(), 4u);
+
+  // Once answered, the same read is sent again
+  EXPECT_TRUE(gateway
+                  .CallSync("get_unit_from_pack_barcode",
+                            "{\"_b\":\"8806469007312\"}")
+                  .ok());
+  EXPECT_EQ(server.requests(), 5u);
+}
+
+void TestPipelining() {
+  RpcStandInOptions server_options;
+  server_options.latency_ms = 40;
+  RpcStandInServer server(server_options, Echo);
+  RpcGatewayOptions options = OptionsFor(server);
+  options.max_connections = 1;
+  options.pipeline_depth = 8;
+  options.default_policy.idempotent = true;
+  RpcGateway gateway(options);
+
+  Results results;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 8; ++i) {
+    gateway.Call("select_rxrecipe_by_textfile_number",
+                 "{\"_tfn\":" + std::to_string(i) + "}", results.Add());
+  }
+  const std::vector<RpcResult> done = results.Wait(8);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(done.size(), 8u);
+  // In order, and the server's delays overlapped
+  for (size_t i = 0; i < done.size(); ++i) {
+    EXPECT_EQ(done[i].body,
+              "{\"fn\":\"select_rxrecipe_by_textfile_number\","
+              "\"in\":{\"_tfn\":" +
+                  std::to_string(i) + "}}");
+  }
+  EXPECT_TRUE(elapsed < std::chrono::milliseconds(8 * 40));
+  const RpcGatewayStats stats = gateway.GetStats();
+  EXPECT_EQ(stats.connections_opened, 1u);
+  EXPECT_TRUE(stats.pipelined >= 4u);
+  EXPECT_TRUE(stats.max_in_flight >= 4u);
+}
+
+// Writes get a connection of their own; reads are not held up behind them.
+void TestWritesAreNotPipelined() {
+  RpcStandInOptions server_options;
+  server_options.latency_ms = 20;
+  RpcStandInServer server(server_options, Echo);
+  RpcGatewayOptions options = OptionsFor(server);
+  options.max_connections = 1;
+  options.pipeline_depth = 8;
+  RpcGateway gateway(options);
+  RpcPolicy read;
+  read.idempotent = true;
+  gateway.SetPolicy("select_rxhead_bydate", read);
+
+  Results results;
+  for (int i = 0; i < 3; ++i) {
+    gateway.Call("update_checked_amount_and_packserial",
+                 "{\"_i\":" + std::to_string(i) + "}", results.Add());
+  }
+  const std::vector<RpcResult> done = results.Wait(3);
+  EXPECT_EQ(done.size(), 3u);
+  for (const RpcResult& result : done) {
+    EXPECT_TRUE(result.ok());
+  }
+  RpcGatewayStats stats = gateway.GetStats();
+  EXPECT_EQ(stats.pipelined, 0u);
+  EXPECT_EQ(stats.max_in_flight, 1u);
+
+  // Nor is a read written behind a write
+  Results mixed;
+  gateway.Call("update_checked_amount_and_packserial", "{}", mixed.Add());
+  gateway.Call("select_rxhead_bydate", "{}", mixed.Add());
+  EXPECT_EQ(mixed.Wait(2).size(), 2u);
+  EXPECT_EQ(gateway.GetStats().pipelined, 0u);
+}
+
+void TestTimeout() {
+  RpcStandInOptions server_options;
+  server_options.latency_ms = 300;
+  RpcStandInServer server(server_options, Echo);
+  RpcGatewayOptions options = OptionsFor(server);
+  options.default_policy.timeout_ms = 50;
+  RpcGateway gateway(options);
+
+  const RpcResult result = gateway.CallSync("select_rxhead_by_name", "{}");
+  EXPECT_EQ(result.status, 0);
+  EXPECT_EQ(result.error, "timeout");
+  // Written before it timed out: the server may have run it
+  EXPECT_TRUE(result.sent);
+  EXPECT_TRUE(result.latency_us < 250000);
+  EXPECT_EQ(gateway.GetStats().timeouts, 1u);
+  EXPECT_EQ(gateway.GetStats().failures, 1u);
+
+  // The late connection was dropped; a faster server is used afresh
+  server.set_latency_ms(0);
+  EXPECT_TRUE(gateway.CallSync("select_rxhead_by_name", "{}").ok());
+  EXPECT_EQ(gateway.GetStats().connections_opened, 2u);
+}
+
+void TestRetry() {
+  RpcStandInOptions server_options;
+  server_options.drop_every = 2;
+  RpcStandInServer server(server_options, Echo);
+  RpcGateway gateway(OptionsFor(server));
+  RpcPolicy read;
+  read.retries = 2;
+  gateway.SetPolicy("select_rxhead_by_patient_number", read);
+
+  EXPECT_TRUE(gateway.CallSync("select_rxhead_by_patient_number", "{}").ok());
+  // The second request is dropped; the read is tried again
+  const RpcResult retried =
+      gateway.CallSync("select_rxhead_by_patient_number", "{}");
+  EXPECT_TRUE(retried.ok());
+  EXPECT_EQ(retried.attempts, 2);
+  // The fourth is dropped too, but writes get no second attempt
+  const RpcResult lost = gateway.CallSync("insert_patientdrug", "{}");
+  EXPECT_EQ(lost.status, 0);
+  EXPECT_EQ(lost.attempts, 1);
+  EXPECT_EQ(lost.error, "connection closed");
+  EXPECT_TRUE(lost.sent);
+  EXPECT_TRUE(gateway.CallSync("insert_patientdrug", "{}").ok());
+  EXPECT_EQ(gateway.GetStats().retries, 1u);
+}
+
+void TestServerClosesConnections() {
+  RpcStandInOptions server_options;
+  server_options.max_requests_per_connection = 2;
+  server_options.latency_ms = 5;
+  RpcStandInServer server(server_options, Echo);
+  RpcGatewayOptions options = OptionsFor(server);
+  options.max_connections = 1;
+  options.default_policy.idempotent = true;
+  RpcGateway gateway(options);
+
+  // Requests pipelined behind a "Connection: close" go out again on a new
+  // connection, without counting as a retry
+  Results results;
+  for (int i = 0; i < 6; ++i) {
+    gateway.Call("select_rxrecipe_by_textfile_number",
+                 "{\"_i\":" + std::to_string(i) + "}", results.Add());
+  }
+  const std::vector<RpcResult> done = results.Wait(6);
+  EXPECT_EQ(done.size(), 6u);
+  for (const RpcResult& result : done) {
+    EXPECT_TRUE(result.ok());
+    EXPECT_EQ(result.attempts, 1);
+  }
+  EXPECT_EQ(server.requests(), 6u);
+  EXPECT_EQ(server.connections(), 3u);
+  EXPECT_EQ(gateway.GetStats().retries, 0u);
+}
+
+void TestHttpErrorsPassThrough() {
+  RpcStandInServer server(RpcStandInOptions(), [](const std::string& function,
+                                                  const std::string&) {
+    return function == "missing" ? RpcStandInReply{404, "{\"code\":\"42883\"}"}
+                                 : RpcStandInReply{200, "[]"};
+  });
+  RpcGatewayOptions options = OptionsFor(server);
+  options.default_policy.retries = 3;
+  RpcGateway gateway(options);
+  const RpcResult result = gateway.CallSync("missing", "{}");
+  EXPECT_EQ(result.status, 404);
+  EXPECT_TRUE(!result.ok());
+  EXPECT_EQ(result.body, "{\"code\":\"42883\"}");
+  // Only 502/503/504 are worth another try
+  EXPECT_EQ(result.attempts, 1);
+  EXPECT_EQ(gateway.GetStats().failures, 0u);
+}
+
+void TestUnavailableIsRetried() {
+  std::atomic<int> calls{0};
+  RpcStandInServer server(RpcStandInOptions(), [&](const std::string&,
+                                                   const std::string&) {
+    return ++calls < 3 ? RpcStandInReply{503, "{}"}
+                       : RpcStandInReply{200, "[1]"};
+  });
+  RpcGatewayOptions options = OptionsFor(server);
+  options.default_policy.retries = 2;
+  RpcGateway gateway(options);
+  const RpcResult result = gateway.CallSync("select_rxhead_bydate", "{}");
+  EXPECT_EQ(result.status, 200);
+  EXPECT_EQ(result.body, "[1]");
+  EXPECT_EQ(result.attempts, 3);
+}
+
+void TestConnectFailure() {
+  uint16_t port;
+  {
+    RpcStandInServer server(RpcStandInOptions(), Echo);
+    port = server.port();
+  }
+  RpcGatewayOptions options;
+  options.port = port;
+  options.retry_backoff_ms = 1;
+  options.default_policy.retries = 1;
+  RpcGateway gateway(options);
+  const RpcResult result = gateway.CallSync("select_rxhead_bydate", "{}");
+  EXPECT_EQ(result.status, 0);
+  EXPECT_EQ(result.error, "connect failed");
+  EXPECT_EQ(result.attempts, 2);
+  // Never reached the server, so safe to send again later
+  EXPECT_TRUE(!result.sent);
+}
+
+void TestShutdownFailsPending() {
+  RpcStandInOptions server_options;
+  server_options.latency_ms = 2000;
+  RpcStandInServer server(server_options, Echo);
+  Results results;
+  {
+    RpcGateway gateway(OptionsFor(server));
+    for (int i = 0; i < 3; ++i) {
+      gateway.Call("select_rxhead_bydate", "{\"_i\":" + std::to_string(i) + "}",
+                   results.Add());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  const std::vector<RpcResult> done = results.Wait(3);
+  EXPECT_EQ(done.size(), 3u);
+  for (const RpcResult& result : done) {
+    EXPECT_EQ(result.error, "shutdown");
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestCallAndReuse();
+  TestCoalescing();
+  TestPipelining();
+  TestWritesAreNotPipelined();
+  TestTimeout();
+  TestRetry();
+  TestServerClosesConnections();
+  TestHttpErrorsPassThrough();
+  TestUnavailableIsRetried();
+  TestConnectFailure();
+  TestShutdownFailsPending();
+  return TEST_RESULT();
+}
@@ -0,0 +1,107 @@
+#include "native/rpc_records.h"
+
+#include <string>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "test_util.h"
+
+namespace {
+
+// Two rxhead rows with the alias keys and stringly-typed values older
+// functions used.
+const char kHeads[] = R"([
+  {"tfn": 20240101001, "no": 7, "pid": "P-1",
+   "환자명": "김철수", "patient_name": "홍길동",
+   "birth_date": "1980-01-02", "is_complete": "true"},
+  {"tfn": "20240101002", "name": "이영희", "is_complete": false,
+   "extra": [1, 2]}
+])";
+
+void TestShapes() {
+  RecordTable drugs(MissMatchedDrugSchema());
+  // A single object is one row; scalars and nested arrays are not rows
+  EXPECT_TRUE(DecodeJsonRows(R"({"location": "A-1"})", &drugs));
+  EXPECT_EQ(drugs.size(), 1u);
+  EXPECT_TRUE(DecodeJsonRows(
+      R"([1, "x", [{"location": "B-1"}], {"location": "C-1"}])", &drugs));
+  EXPECT_EQ(drugs.size(), 2u);
+  const size_t location =
+      static_cast<size_t>(MissMatchedDrugColumn::kLocation);
+  EXPECT_EQ(drugs.StringAt(1, location), "C-1");
+  EXPECT_TRUE(DecodeJsonRows("null", &drugs));
+  EXPECT_TRUE(DecodeJsonRows("[]", &drugs));
+  EXPECT_EQ(drugs.size(), 2u);
+
+  std::string error;
+  EXPECT_TRUE(!DecodeJsonRows(R"([{"location": "A-1"},)", &drugs, &error));
+  EXPECT_TRUE(!error.empty());
+}
+
+void TestRxHead() {
+  RecordTable heads(RxHeadSchema());
+  EXPECT_TRUE(DecodeJsonRows(kHeads, &heads));
+  EXPECT_EQ(heads.size(), 2u);
+  const size_t tfn = static_cast<size_t>(RxHeadColumn::kTfn);
+  const size_t no = static_cast<size_t>(RxHeadColumn::kNo);
+  const size_t name = static_cast<size_t>(RxHeadColumn::kPatientName);
+  const size_t birth = static_cast<size_t>(RxHeadColumn::kPatientBirth);
+  const size_t complete = static_cast<size_t>(RxHeadColumn::kIsComplete);
+  EXPECT_EQ(heads.Int64At(0, tfn), 20240101001LL);
+  EXPECT_EQ(heads.Int64At(1, tfn), 20240101002LL);
+  EXPECT_EQ(heads.StringAt(0, no), "7");
+  EXPECT_EQ(heads.StringAt(0, name), "홍길동");
+  EXPECT_EQ(heads.StringAt(1, name), "이영희");
+  EXPECT_EQ(heads.StringAt(0, birth), "1980-01-02");
+  EXPECT_EQ(heads.StringAt(1, birth), "");
+  EXPECT_TRUE(heads.BoolAt(0, complete));
+  EXPECT_TRUE(!heads.BoolAt(1, complete));
+  EXPECT_TRUE(heads.ColumnData(tfn) != nullptr);
+  EXPECT_TRUE(heads.ColumnData(99) == nullptr);
+
+  heads.Clear();
+  EXPECT_EQ(heads.size(), 0u);
+  EXPECT_TRUE(heads.ColumnData(tfn) == nullptr);
+
+  RecordTable drugs(MissMatchedDrugSchema());
+  EXPECT_TRUE(DecodeJsonRows(
+      R"([{"product_name": "아스피린", "location": "B-1"}])", &drugs));
+  EXPECT_EQ(drugs.size(), 1u);
+  EXPECT_EQ(drugs.StringAt(
+                0, static_cast<size_t>(MissMatchedDrugColumn::kLocation)),
+            "B-1");
+}
+
+void TestFfi() {
+  EXPECT_TRUE(pharm_record_table_create(2) == nullptr);
+  PharmRecordTable* table = pharm_record_table_create(0);
+  const std::string json = kHeads;
+  EXPECT_EQ(pharm_record_table_load_json(table, json.data(),
+                                         static_cast<int32_t>(json.size())),
+            2);
+  const auto* tfn = static_cast<const int64_t*>(pharm_record_table_column(
+      table, static_cast<int32_t>(RxHeadColumn::kTfn)));
+  const auto* name = static_cast<const uint32_t*>(pharm_record_table_column(
+      table, static_cast<int32_t>(RxHeadColumn::kPatientName)));
+  const auto* complete = static_cast<const uint8_t*>(
+      pharm_record_table_column(
+          table, static_cast<int32_t>(RxHeadColumn::kIsComplete)));
+  EXPECT_EQ(tfn[1], 20240101002LL);
+  EXPECT_EQ(complete[0], 1);
+  int32_t length = 0;
+  const char* value = pharm_record_table_string(table, name[1], &length);
+  EXPECT_EQ(std::string(value, static_cast<size_t>(length)), "이영희");
+  EXPECT_TRUE(pharm_record_table_column(table, 6) == nullptr);
+
+  EXPECT_EQ(pharm_record_table_load_json(table, "[{", 2), -1);
+  EXPECT_TRUE(pharm_record_table_column(table, 0) == nullptr);
+  pharm_record_table_destroy(table);
+}
+
+}  // namespace
+
+int main() {
+  TestShapes();
+  TestRxHead();
+  TestFfi();
+  return TEST_RESULT();
+}
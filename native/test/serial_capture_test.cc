@@ -0,0 +1,158 @@
+#include "native/serial_capture.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+}
+
+void TestRoundTrip() {
+  const std::string path = TempFilePath("serial_capture_test.cap");
+  SerialCaptureWriter writer;
+  EXPECT_TRUE(!writer.IsOpen());
+  writer.Record(0, "ignored", 7);
+  EXPECT_TRUE(writer.Open(path));
+  writer.Record(0, "0108806469007312\r", 17);
+  writer.Record(0, "\n", 1);
+  writer.Record(3, "", 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  const std::string binary("21A\0\x1d\xff\r", 7);
+  writer.Record(3, binary.data(), binary.size());
+  EXPECT_EQ(writer.chunks(), 3u);
+  EXPECT_EQ(writer.bytes(), 25u);
+  writer.Close();
+  writer.Record(0, "late", 4);
+
+  SerialCapture capture;
+  EXPECT_TRUE(ReadSerialCapture(path, &capture));
+  EXPECT_TRUE(!capture.truncated);
+  EXPECT_TRUE(capture.start_unix_us > 1600000000000000);
+  EXPECT_EQ(capture.chunks.size(), 3u);
+  if (capture.chunks.size() == 3) {
+    EXPECT_EQ(capture.chunks[0].data, "0108806469007312\r");
+    EXPECT_EQ(capture.chunks[1].data, "\n");
+    EXPECT_EQ(capture.chunks[2].port, 3);
+    EXPECT_EQ(capture.chunks[2].data, binary);
+    EXPECT_TRUE(capture.chunks[0].time_ns <= capture.chunks[1].time_ns);
+    EXPECT_TRUE(capture.chunks[2].time_ns - capture.chunks[1].time_ns >=
+                2000000);
+  }
+  // Header plus a few bytes of framing per record
+  EXPECT_TRUE(ReadFile(path).size() <= 16 + 25 + 3 * 6);
+
+  // Opening again starts a new capture
+  EXPECT_TRUE(writer.Open(path));
+  writer.Record(1, "x", 1);
+  writer.Close();
+  EXPECT_TRUE(ReadSerialCapture(path, &capture));
+  EXPECT_EQ(capture.chunks.size(), 1u);
+  std::remove(path.c_str());
+}
+
+// A read with none after it reaches the file on Flush(), while the
+// capture is still open.
+void TestFlushWritesTheTail() {
+  const std::string path = TempFilePath("serial_capture_flush.cap");
+  SerialCaptureWriter writer;
+  EXPECT_TRUE(writer.Open(path));
+  writer.Record(0, "8806469007312\r\n", 15);
+  SerialCapture capture;
+  EXPECT_TRUE(ReadSerialCapture(path, &capture));
+  EXPECT_EQ(capture.chunks.size(), 0u);
+  writer.Flush();
+  EXPECT_TRUE(ReadSerialCapture(path, &capture));
+  EXPECT_EQ(capture.chunks.size(), 1u);
+  writer.Close();
+  writer.Flush();
+  std::remove(path.c_str());
+}
+
+void TestTruncatedTailIsDropped() {
+  const std::string path = TempFilePath("serial_capture_cut.cap");
+  SerialCaptureWriter writer;
+  EXPECT_TRUE(writer.Open(path));
+  writer.Record(0, "8806469007312\r\n", 15);
+  writer.Record(0, "8806469007313\r\n", 15);
+  writer.Close();
+  const std::string contents = ReadFile(path);
+  {
+    std::ofstream cut(path, std::ios::binary | std::ios::trunc);
+    cut.write(contents.data(), contents.size() - 4);
+  }
+  SerialCapture capture;
+  EXPECT_TRUE(ReadSerialCapture(path, &capture));
+  EXPECT_TRUE(capture.truncated);
+  EXPECT_EQ(capture.chunks.size(), 1u);
+  std::remove(path.c_str());
+}
+
+void TestRejectsOtherFiles() {
+  const std::string path = TempFilePath("serial_capture_other.cap");
+  SerialCapture capture;
+  EXPECT_TRUE(!ReadSerialCapture(path, &capture));
+  {
+    std::ofstream other(path, std::ios::binary);
+    other << "0108806469007312\r\n";
+  }
+  EXPECT_TRUE(!ReadSerialCapture(path, &capture));
+  std::remove(path.c_str());
+  SerialCaptureWriter writer;
+  EXPECT_TRUE(!writer.Open("/nonexistent-dir/scan.cap"));
+}
+
+// Records from several threads come out whole and in time order.
+void TestConcurrentRecords() {
+  const std::string path = TempFilePath("serial_capture_threads.cap");
+  SerialCaptureWriter writer;
+  EXPECT_TRUE(writer.Open(path));
+  std::vector<std::thread> threads;
+  for (int port = 0; port < 4; ++port) {
+    threads.emplace_back([&writer, port] {
+      const std::string line = "port" + std::to_string(port) + "\r\n";
+      for (int i = 0; i < 2000; ++i) {
+        writer.Record(port, line.data(), line.size());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  writer.Close();
+
+  SerialCapture capture;
+  EXPECT_TRUE(ReadSerialCapture(path, &capture));
+  EXPECT_EQ(capture.chunks.size(), 8000u);
+  bool ordered = true;
+  bool whole = true;
+  int64_t last_ns = 0;
+  for (const SerialCaptureChunk& chunk : capture.chunks) {
+    ordered &= chunk.time_ns >= last_ns;
+    whole &= chunk.data == "port" + std::to_string(chunk.port) + "\r\n";
+    last_ns = chunk.time_ns;
+  }
+  EXPECT_TRUE(ordered);
+  EXPECT_TRUE(whole);
+  std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+  TestRoundTrip();
+  TestFlushWritesTheTail();
+  TestTruncatedTailIsDropped();
+  TestRejectsOtherFiles();
+  TestConcurrentRecords();
+  return TEST_RESULT();
+}
@@ -0,0 +1,150 @@
+#include "native/serial_filter.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "test_util.h"
+
+namespace {
+
+constexpr int32_t kToday = 20000;
+constexpr int64_t kScope = 42;
+
+void TestStates() {
+  SerialFilter filter;
+  EXPECT_TRUE(filter.Load("", kToday));
+  EXPECT_TRUE(filter.Lookup(kToday, kScope, "SN001") == SerialState::kUnknown);
+
+  filter.Record(kToday, kScope, "SN001", SerialState::kPending);
+  EXPECT_TRUE(filter.Lookup(kToday, kScope, "SN001") == SerialState::kPending);
+  filter.Record(kToday, kScope, "SN001", SerialState::kConfirmed);
+  EXPECT_TRUE(filter.Lookup(kToday, kScope, "SN001") ==
+              SerialState::kConfirmed);
+  // States never go back down.
+  filter.Record(kToday, kScope, "SN001", SerialState::kPending);
+  EXPECT_TRUE(filter.Lookup(kToday, kScope, "SN001") ==
+              SerialState::kConfirmed);
+
+  // Scoped per prescription and per day.
+  EXPECT_TRUE(filter.Lookup(kToday, kScope + 1, "SN001") ==
+              SerialState::kUnknown);
+  EXPECT_TRUE(filter.Lookup(kToday + 1, kScope, "SN001") ==
+              SerialState::kUnknown);
+  // Exact match, not prefix.
+  EXPECT_TRUE(filter.Lookup(kToday, kScope, "SN00") == SerialState::kUnknown);
+
+  filter.Record(kToday, kScope, "", SerialState::kConfirmed);
+  EXPECT_EQ(filter.GetStats().entries, 1u);
+}
+
+void TestManySerials() {
+  SerialFilterOptions options;
+  options.expected_serials = 64;
+  SerialFilter filter(options);
+  EXPECT_TRUE(filter.Load("", kToday));
+  // Well past the sizing hint: the table and Bloom filter grow.
+  for (int i = 0; i < 2000; ++i) {
+    filter.Record(kToday, kScope, "S" + std::to_string(i),
+                  SerialState::kConfirmed);
+  }
+  for (int i = 0; i < 2000; ++i) {
+    EXPECT_TRUE(filter.Lookup(kToday, kScope, "S" + std::to_string(i)) ==
+                SerialState::kConfirmed);
+  }
+  for (int i = 2000; i < 4000; ++i) {
+    EXPECT_TRUE(filter.Lookup(kToday, kScope, "S" + std::to_string(i)) ==
+                SerialState::kUnknown);
+  }
+  SerialFilterStats stats = filter.GetStats();
+  EXPECT_EQ(stats.entries, 2000u);
+  EXPECT_EQ(stats.confirmed_hits, 2000u);
+  // Most misses never reach the table.
+  EXPECT_TRUE(stats.bloom_negatives > 1900);
+}
+
+void TestPersistenceAndRetention() {
+  const std::string path = TempFilePath("serial_filter_log");
+  SerialFilterOptions options;
+  options.retention_days = 2;
+  {
+    SerialFilter filter(options);
+    EXPECT_TRUE(filter.Load(path, kToday));
+    filter.Record(kToday - 2, kScope, "OLD", SerialState::kConfirmed);
+    filter.Record(kToday - 1, kScope, "YESTERDAY", SerialState::kConfirmed);
+    filter.Record(kToday, kScope, "PENDING", SerialState::kPending);
+    filter.Record(kToday, kScope, "DONE", SerialState::kPending);
+    filter.Record(kToday, kScope, "DONE", SerialState::kConfirmed);
+  }
+  {
+    SerialFilter filter(options);
+    EXPECT_TRUE(filter.Load(path, kToday));
+    EXPECT_EQ(filter.GetStats().loaded, 3u);
+    EXPECT_TRUE(filter.Lookup(kToday - 2, kScope, "OLD") ==
+                SerialState::kUnknown);
+    EXPECT_TRUE(filter.Lookup(kToday - 1, kScope, "YESTERDAY") ==
+                SerialState::kConfirmed);
+    EXPECT_TRUE(filter.Lookup(kToday, kScope, "PENDING") ==
+                SerialState::kPending);
+    EXPECT_TRUE(filter.Lookup(kToday, kScope, "DONE") ==
+                SerialState::kConfirmed);
+  }
+  // The next day yesterday's serials are still kept, then they expire and
+  // the log is rewritten without them.
+  {
+    SerialFilter filter(options);
+    EXPECT_TRUE(filter.Load(path, kToday + 1));
+    EXPECT_EQ(filter.GetStats().loaded, 2u);
+  }
+  {
+    SerialFilter filter(options);
+    EXPECT_TRUE(filter.Load(path, kToday + 2));
+    EXPECT_EQ(filter.GetStats().loaded, 0u);
+  }
+  std::remove(path.c_str());
+}
+
+void TestTornTail() {
+  const std::string path = TempFilePath("serial_filter_torn");
+  {
+    SerialFilter filter;
+    EXPECT_TRUE(filter.Load(path, kToday));
+    filter.Record(kToday, kScope, "A", SerialState::kConfirmed);
+    filter.Record(kToday, kScope, "B", SerialState::kConfirmed);
+  }
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    out.write("\x20\x00\x00\x00\x12\x34", 6);  // header of a lost record
+  }
+  {
+    SerialFilter filter;
+    EXPECT_TRUE(filter.Load(path, kToday));
+    EXPECT_EQ(filter.GetStats().loaded, 2u);
+    filter.Record(kToday, kScope, "C", SerialState::kConfirmed);
+  }
+  SerialFilter filter;
+  EXPECT_TRUE(filter.Load(path, kToday));
+  EXPECT_EQ(filter.GetStats().loaded, 3u);
+  EXPECT_TRUE(filter.Lookup(kToday, kScope, "C") == SerialState::kConfirmed);
+  filter.Close();
+
+  // A file that is not a filter log is started over.
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << "not a serial filter";
+  }
+  EXPECT_TRUE(filter.Load(path, kToday));
+  EXPECT_EQ(filter.GetStats().loaded, 0u);
+  filter.Close();
+  std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+  TestStates();
+  TestManySerials();
+  TestPersistenceAndRetention();
+  TestTornTail();
+  return TEST_RESULT();
+}
@@ -0,0 +1,187 @@
+#include "native/serial_port.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "native/serial_capture.h"
+#include "pty_util.h"
+#include "test_util.h"
+
+namespace {
+
+// Collect lines until |count| have arrived or the port stops being readable.
+std::vector<std::string> ReadLinesFrom(SerialPort* port, size_t count) {
+  std::vector<std::string> lines;
+  while (lines.size() < count && WaitReadable(port->fd(), 1000)) {
+    if (!port->ReadLines(&lines)) break;
+  }
+  return lines;
+}
+
+void TestOpenRejectsUnknownBaudRate() {
+  TestPty pty;
+  EXPECT_TRUE(pty.ok());
+  SerialPort port;
+  EXPECT_TRUE(!port.Open(pty.slave_path(), 12345));
+  EXPECT_TRUE(!port.IsOpen());
+  EXPECT_TRUE(!port.Open("/nonexistent/tty", 9600));
+}
+
+void TestReadsMixedTerminators() {
+  TestPty pty;
+  SerialPort port;
+  EXPECT_TRUE(port.Open(pty.slave_path(), 9600));
+
+  EXPECT_TRUE(pty.Send("8806469007312\r\n0188064690073121\r"));
+  EXPECT_TRUE(pty.Send("21ABC\n\n\r"));
+  std::vector<std::string> lines = ReadLinesFrom(&port, 3);
+  EXPECT_EQ(lines.size(), 3u);
+  if (lines.size() == 3) {
+    EXPECT_EQ(lines[0], "8806469007312");
+    EXPECT_EQ(lines[1], "0188064690073121");
+    EXPECT_EQ(lines[2], "21ABC");
+  }
+}
+
+void TestLineSplitAcrossReads() {
+  TestPty pty;
+  SerialPort port;
+  EXPECT_TRUE(port.Open(pty.slave_path(), 115200));
+
+  std::vector<std::string> lines;
+  EXPECT_TRUE(pty.Send("01088064"));
+  EXPECT_TRUE(WaitReadable(port.fd(), 1000));
+  EXPECT_TRUE(port.ReadLines(&lines));
+  EXPECT_TRUE(lines.empty());
+
+  EXPECT_TRUE(pty.Send("69007312\r\n"));
+  lines = ReadLinesFrom(&port, 1);
+  EXPECT_EQ(lines.size(), 1u);
+  if (!lines.empty()) {
+    EXPECT_EQ(lines[0], "0108806469007312");
+  }
+}
+
+void TestWriteReachesDevice() {
+  TestPty pty;
+  SerialPort port;
+  EXPECT_TRUE(port.Open(pty.slave_path(), 9600));
+  EXPECT_TRUE(port.WriteData("TRIGGER\r"));
+  EXPECT_EQ(pty.Receive(8, 1000), "TRIGGER\r");
+}
+
+void TestHangUpIsReported() {
+  TestPty pty;
+  SerialPort port;
+  EXPECT_TRUE(port.Open(pty.slave_path(), 9600));
+  pty.CloseMaster();
+  EXPECT_TRUE(WaitReadable(port.fd(), 1000));
+  std::vector<std::string> lines;
+  EXPECT_TRUE(!port.ReadLines(&lines));
+  port.Close();
+  EXPECT_TRUE(!port.WriteData("x"));
+}
+
+// Writes racing a close from another thread never reach a reused
+// descriptor; later writes fail.
+void TestCloseDuringWrites() {
+  TestPty pty;
+  SerialPort port;
+  EXPECT_TRUE(port.Open(pty.slave_path(), 9600));
+  std::thread writer([&port] {
+    for (int i = 0; i < 200; ++i) {
+      port.WriteData("x");
+    }
+  });
+  port.Close();
+  writer.join();
+  EXPECT_TRUE(!port.IsOpen());
+  EXPECT_TRUE(!port.WriteData("x"));
+}
+
+int64_t MsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// A write stalled on a device that takes nothing holds up neither reads
+// nor a close, which cancels it; on its own it gives up after 50 ms.
+void TestStalledWriteBlocksNothing() {
+  TestPty pty;
+  SerialPort port;
+  EXPECT_TRUE(port.Open(pty.slave_path(), 115200));
+  const std::string flood(1 << 20, 'x');
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(!port.WriteData(flood));
+  EXPECT_TRUE(MsSince(start) < 200);
+
+  std::atomic<bool> done{false};
+  std::thread writer([&port, &flood, &done] {
+    port.WriteData(flood);
+    done.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_TRUE(pty.Send("8806469007312\r"));
+  start = std::chrono::steady_clock::now();
+  std::vector<std::string> lines = ReadLinesFrom(&port, 1);
+  EXPECT_EQ(lines.size(), 1u);
+  EXPECT_TRUE(MsSince(start) < 25);
+  EXPECT_TRUE(!done.load());
+  start = std::chrono::steady_clock::now();
+  port.Close();
+  writer.join();
+  EXPECT_TRUE(MsSince(start) < 25);
+}
+
+// Reads are captured raw, before framing drops the terminators.
+void TestCaptureRecordsRawReads() {
+  TestPty pty;
+  SerialPort port;
+  SerialCaptureWriter capture;
+  const std::string path = TempFilePath("serial_port_test.cap");
+  EXPECT_TRUE(capture.Open(path));
+  EXPECT_TRUE(port.Open(pty.slave_path(), 9600));
+  port.SetCapture(&capture, 2);
+  EXPECT_TRUE(pty.Send("8806469007312\r\n\r"));
+  std::vector<std::string> lines = ReadLinesFrom(&port, 1);
+  EXPECT_EQ(lines.size(), 1u);
+  port.SetCapture(nullptr, 0);
+  EXPECT_TRUE(pty.Send("21ABC\n"));
+  lines = ReadLinesFrom(&port, 1);
+  capture.Close();
+
+  SerialCapture recorded;
+  EXPECT_TRUE(ReadSerialCapture(path, &recorded));
+  std::string bytes;
+  for (const SerialCaptureChunk& chunk : recorded.chunks) {
+    EXPECT_EQ(chunk.port, 2);
+    bytes += chunk.data;
+  }
+  EXPECT_EQ(bytes, "8806469007312\r\n\r");
+  std::remove(path.c_str());
+}
+
+void TestPortNumberMapping() {
+  EXPECT_EQ(SerialDevicePathForPort(1), "/dev/ttyS0");
+  EXPECT_EQ(SerialDevicePathForPort(4), "/dev/ttyS3");
+}
+
+}  // namespace
+
+int main() {
+  TestOpenRejectsUnknownBaudRate();
+  TestReadsMixedTerminators();
+  TestLineSplitAcrossReads();
+  TestWriteReachesDevice();
+  TestHangUpIsReported();
+  TestCloseDuringWrites();
+  TestStalledWriteBlocksNothing();
+  TestCaptureRecordsRawReads();
+  TestPortNumberMapping();
+  return TEST_RESULT();
+}
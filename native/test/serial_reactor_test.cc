@@ -0,0 +1,355 @@
+#include "native/serial_reactor.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "native/trace_recorder.h"
+#include "pty_util.h"
+#include "test_util.h"
+
+namespace {
+
+// Collects the reactor's lines on the test thread, woken by its callback.
+class Collector {
+ public:
+  void Notify() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++wakeups_;
+    cv_.notify_all();
+  }
+
+  // Pops lines until |count| have arrived or |timeout_ms| passed.
+  std::vector<SerialLine> Take(SerialReactor* reactor, size_t count,
+                               int timeout_ms = 2000) {
+    std::vector<SerialLine> lines;
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::milliseconds(timeout_ms);
+    while (lines.size() < count) {
+      SerialLine line;
+      while (lines.size() < count && reactor->PopLine(&line)) {
+        lines.push_back(std::move(line));
+      }
+      if (lines.size() >= count) {
+        break;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      const uint64_t seen = wakeups_;
+      if (!cv_.wait_until(lock, deadline,
+                          [this, seen] { return wakeups_ != seen; })) {
+        // One last look: the wake-up may have come before the wait
+        lock.unlock();
+        while (lines.size() < count && reactor->PopLine(&line)) {
+          lines.push_back(std::move(line));
+        }
+        break;
+      }
+    }
+    return lines;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  uint64_t wakeups_ = 0;
+};
+
+SerialPortConfig Config(const TestPty& pty) {
+  SerialPortConfig config;
+  config.device_path = pty.slave_path();
+  config.baud_rate = 115200;
+  return config;
+}
+
+// Polls |predicate| for up to two seconds.
+template <typename Predicate>
+bool WaitFor(Predicate predicate) {
+  for (int i = 0; i < 200; ++i) {
+    if (predicate()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return predicate();
+}
+
+void TestLinesAreTaggedWithTheirPort() {
+  Collector collector;
+  SerialReactor reactor(64, [&collector] { collector.Notify(); });
+  EXPECT_TRUE(reactor.ok());
+  TestPty hand, fixed, atc;
+  EXPECT_TRUE(reactor.OpenPort(1, Config(hand)));
+  EXPECT_TRUE(reactor.OpenPort(2, Config(fixed)));
+  EXPECT_TRUE(reactor.OpenPort(7, Config(atc)));
+  EXPECT_TRUE((reactor.PortIds() == std::vector<int32_t>{1, 2, 7}));
+
+  EXPECT_TRUE(hand.Send("8806469007312\r\n"));
+  EXPECT_TRUE(WaitFor([&] {
+    SerialPortStats stats;
+    return reactor.GetPortStats(1, &stats) && stats.lines == 1;
+  }));
+  EXPECT_TRUE(atc.Send("0108806469007312\r"));
+  EXPECT_TRUE(fixed.Send("ABC\n"));
+  std::vector<SerialLine> lines = collector.Take(&reactor, 3);
+  EXPECT_EQ(lines.size(), 3u);
+  std::map<int32_t, std::string> by_port;
+  for (const SerialLine& line : lines) {
+    by_port[line.port] = line.text;
+  }
+  EXPECT_EQ(by_port[1], "8806469007312");
+  EXPECT_EQ(by_port[2], "ABC");
+  EXPECT_EQ(by_port[7], "0108806469007312");
+  EXPECT_EQ(lines[0].port, 1);
+
+  SerialPortStats stats;
+  EXPECT_TRUE(reactor.GetPortStats(7, &stats));
+  EXPECT_TRUE(stats.open);
+  EXPECT_EQ(stats.lines, 1u);
+  EXPECT_EQ(stats.line_bytes, 16u);
+  EXPECT_TRUE(stats.last_line_ms > 0);
+  EXPECT_TRUE(!reactor.GetPortStats(3, &stats));
+}
+
+void TestPerPortFraming() {
+  Collector collector;
+  SerialReactor reactor(64, [&collector] { collector.Notify(); });
+  TestPty plain, stx;
+  EXPECT_TRUE(reactor.OpenPort(1, Config(plain)));
+  SerialPortConfig config = Config(stx);
+  config.framing.prefix = "\x02";
+  config.framing.terminator = "\x03";
+  EXPECT_TRUE(reactor.OpenPort(2, config));
+
+  EXPECT_TRUE(stx.Send("noise\x02" "A\rB\x03"));
+  std::vector<SerialLine> lines = collector.Take(&reactor, 1);
+  EXPECT_EQ(lines.size(), 1u);
+  if (!lines.empty()) {
+    EXPECT_EQ(lines[0].port, 2);
+    EXPECT_EQ(lines[0].text, "A\rB");
+  }
+  EXPECT_TRUE(plain.Send("A\rB\x03\r"));
+  lines = collector.Take(&reactor, 2);
+  EXPECT_EQ(lines.size(), 2u);
+
+  SerialPortConfig stored;
+  EXPECT_TRUE(reactor.GetPortConfig(2, &stored));
+  EXPECT_EQ(stored.framing.terminator, "\x03");
+  EXPECT_EQ(stored.baud_rate, 115200);
+}
+
+// Several scanners firing at once: nothing lost, each port in order.
+void TestConcurrentLoad() {
+  constexpr int kPorts = 4;
+  constexpr int kLinesPerPort = 2000;
+  Collector collector;
+  SerialReactor reactor(kPorts * kLinesPerPort,
+                        [&collector] { collector.Notify(); });
+  std::vector<std::unique_ptr<TestPty>> ptys;
+  for (int id = 0; id < kPorts; ++id) {
+    ptys.emplace_back(new TestPty());
+    EXPECT_TRUE(reactor.OpenPort(id, Config(*ptys.back())));
+  }
+
+  std::vector<std::thread> scanners;
+  for (int id = 0; id < kPorts; ++id) {
+    scanners.emplace_back([&ptys, id] {
+      std::string burst;
+      for (int n = 0; n < kLinesPerPort; ++n) {
+        burst += "P" + std::to_string(id) + "-" + std::to_string(n) + "\r\n";
+        // Uneven writes, so lines straddle reads
+        if (burst.size() > static_cast<size_t>(97 + id * 13)) {
+          ptys[id]->Send(burst);
+          burst.clear();
+        }
+      }
+      ptys[id]->Send(burst);
+    });
+  }
+  std::vector<SerialLine> lines =
+      collector.Take(&reactor, kPorts * kLinesPerPort, 20000);
+  for (std::thread& scanner : scanners) {
+    scanner.join();
+  }
+
+  EXPECT_EQ(lines.size(), static_cast<size_t>(kPorts * kLinesPerPort));
+  std::vector<int> next(kPorts, 0);
+  bool in_order = true;
+  for (const SerialLine& line : lines) {
+    if (line.port < 0 || line.port >= kPorts ||
+        line.text != "P" + std::to_string(line.port) + "-" +
+                         std::to_string(next[line.port])) {
+      in_order = false;
+      break;
+    }
+    ++next[line.port];
+  }
+  EXPECT_TRUE(in_order);
+  for (int id = 0; id < kPorts; ++id) {
+    SerialPortStats stats;
+    EXPECT_TRUE(reactor.GetPortStats(id, &stats));
+    EXPECT_EQ(stats.lines, static_cast<uint64_t>(kLinesPerPort));
+    EXPECT_EQ(stats.dropped, 0u);
+  }
+  EXPECT_EQ(reactor.GetQueueStats().dropped, 0u);
+}
+
+void TestFullQueueDropsOldest() {
+  SerialReactor reactor(4);
+  TestPty pty;
+  EXPECT_TRUE(reactor.OpenPort(1, Config(pty)));
+  EXPECT_TRUE(pty.Send("1\n2\n3\n4\n5\n6\n"));
+  EXPECT_TRUE(WaitFor([&] {
+    SerialPortStats stats;
+    return reactor.GetPortStats(1, &stats) && stats.lines == 6;
+  }));
+  SerialPortStats stats;
+  reactor.GetPortStats(1, &stats);
+  EXPECT_EQ(stats.dropped, 2u);
+  SerialLine line;
+  EXPECT_TRUE(reactor.PopLine(&line));
+  EXPECT_EQ(line.text, "3");
+}
+
+void TestWriteCloseAndReplace() {
+  Collector collector;
+  SerialReactor reactor(64, [&collector] { collector.Notify(); });
+  TestPty first, second;
+  EXPECT_TRUE(reactor.OpenPort(1, Config(first)));
+  EXPECT_TRUE(reactor.Write(1, "BEEP\r"));
+  EXPECT_EQ(first.Receive(5, 1000), "BEEP\r");
+  EXPECT_TRUE(!reactor.Write(9, "x"));
+
+  // Same id, another device: the first one is no longer read
+  EXPECT_TRUE(reactor.OpenPort(1, Config(second)));
+  EXPECT_TRUE(first.Send("OLD\n"));
+  EXPECT_TRUE(second.Send("NEW\n"));
+  std::vector<SerialLine> lines = collector.Take(&reactor, 2, 300);
+  EXPECT_EQ(lines.size(), 1u);
+  if (!lines.empty()) {
+    EXPECT_EQ(lines[0].text, "NEW");
+  }
+
+  EXPECT_TRUE(reactor.ClosePort(1));
+  EXPECT_TRUE(!reactor.ClosePort(1));
+  EXPECT_TRUE(reactor.PortIds().empty());
+  SerialPortConfig missing;
+  missing.device_path = "/nonexistent/tty";
+  missing.reopen = false;
+  EXPECT_TRUE(!reactor.OpenPort(2, missing));
+  EXPECT_TRUE(reactor.PortIds().empty());
+}
+
+// A write waiting for room on one port holds up neither reading that port
+// or the others, nor the reactor's lock, nor closing the port.
+void TestBlockedWriteDoesNotStallReactor() {
+  Collector collector;
+  SerialReactor reactor(64, [&collector] { collector.Notify(); });
+  TestPty stuck, other;
+  EXPECT_TRUE(reactor.OpenPort(1, Config(stuck)));
+  EXPECT_TRUE(reactor.OpenPort(2, Config(other)));
+  // Nobody reads |stuck|, so its buffer fills and writes wait for room
+  std::atomic<bool> stop{false};
+  std::thread writer([&reactor, &stop] {
+    const std::string chunk(16 * 1024, 'x');
+    while (!stop.load()) {
+      reactor.Write(1, chunk);
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(stuck.Send("SAME\n"));
+  EXPECT_TRUE(other.Send("LIVE\n"));
+  std::vector<SerialLine> lines = collector.Take(&reactor, 2, 30);
+  EXPECT_EQ(lines.size(), 2u);
+  SerialPortStats stats;
+  EXPECT_TRUE(reactor.GetPortStats(1, &stats));
+  EXPECT_TRUE(std::chrono::steady_clock::now() - start <
+              std::chrono::milliseconds(30));
+  EXPECT_TRUE(reactor.ClosePort(1));
+  EXPECT_TRUE(!reactor.Write(1, "x"));
+  stop.store(true);
+  writer.join();
+  EXPECT_TRUE(other.Send("STILL\n"));
+  lines = collector.Take(&reactor, 1);
+  EXPECT_EQ(lines.size(), 1u);
+  if (!lines.empty()) {
+    EXPECT_EQ(lines[0].text, "STILL");
+  }
+}
+
+void TestHangupLeavesOtherPortsRunning() {
+  Collector collector;
+  SerialReactor reactor(64, [&collector] { collector.Notify(); });
+  TestPty unplugged, steady;
+  EXPECT_TRUE(reactor.OpenPort(1, Config(unplugged)));
+  EXPECT_TRUE(reactor.OpenPort(2, Config(steady)));
+  unplugged.CloseMaster();
+  EXPECT_TRUE(WaitFor([&] {
+    SerialPortStats stats;
+    return reactor.GetPortStats(1, &stats) && !stats.open;
+  }));
+  SerialPortStats stats;
+  reactor.GetPortStats(1, &stats);
+  EXPECT_EQ(stats.hangups, 1u);
+
+  EXPECT_TRUE(steady.Send("STILL\n"));
+  std::vector<SerialLine> lines = collector.Take(&reactor, 1);
+  EXPECT_EQ(lines.size(), 1u);
+  if (!lines.empty()) {
+    EXPECT_EQ(lines[0].port, 2);
+  }
+  // Still registered, waiting for the device to come back
+  EXPECT_TRUE((reactor.PortIds() == std::vector<int32_t>{1, 2}));
+}
+
+// While tracing, each line starts a scan whose framing span is recorded on
+// the reactor thread.
+void TestTracedLinesCarryAScan() {
+  Collector collector;
+  SerialReactor reactor(64, [&collector] { collector.Notify(); });
+  TestPty pty;
+  EXPECT_TRUE(reactor.OpenPort(1, Config(pty)));
+
+  EXPECT_TRUE(pty.Send("untraced\n"));
+  std::vector<SerialLine> lines = collector.Take(&reactor, 1);
+  EXPECT_EQ(lines.size(), 1u);
+  EXPECT_TRUE(lines.empty() || lines[0].scan_id == 0);
+
+  TraceRecorder& trace = ProcessTraceRecorder();
+  trace.SetEnabled(true);
+  EXPECT_TRUE(pty.Send("a\nb\n"));
+  lines = collector.Take(&reactor, 2);
+  trace.SetEnabled(false);
+  EXPECT_EQ(lines.size(), 2u);
+  if (lines.size() == 2) {
+    EXPECT_TRUE(lines[0].scan_id != 0);
+    EXPECT_TRUE(lines[1].scan_id > lines[0].scan_id);
+    EXPECT_TRUE(lines[0].framed_ns > 0);
+  }
+  size_t frames = 0;
+  for (const TraceEvent& event : trace.Collect()) {
+    frames += std::string(event.name) == "serial.frame";
+  }
+  EXPECT_EQ(frames, 2u);
+  trace.Clear();
+}
+
+}  // namespace
+
+int main() {
+  TestLinesAreTaggedWithTheirPort();
+  TestPerPortFraming();
+  TestConcurrentLoad();
+  TestFullQueueDropsOldest();
+  TestWriteCloseAndReplace();
+  TestBlockedWriteDoesNotStallReactor();
+  TestHangupLeavesOtherPortsRunning();
+  TestTracedLinesCarryAScan();
+  return TEST_RESULT();
+}
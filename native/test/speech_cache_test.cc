@@ -0,0 +1,178 @@
+#include "native/speech_cache.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+// Renders each text as 10 ms of silence, a tone whose length depends on
+// the text, and 10 ms of silence, and counts what it was asked to say.
+class CountingEngine : public SpeechEngine {
+ public:
+  int sample_rate() const override { return 8000; }
+
+  bool Synthesize(const std::string& text,
+                  const AudioCallback& on_audio) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++calls_[text];
+    }
+    PcmBuffer pcm(80, 0);
+    pcm.insert(pcm.end(), 100 + text.size() * 10, 1000);
+    pcm.insert(pcm.end(), 80, 0);
+    on_audio(pcm.data(), pcm.size());
+    return true;
+  }
+
+  int calls(const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return calls_[text];
+  }
+  int total_calls() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int total = 0;
+    for (const auto& entry : calls_) {
+      total += entry.second;
+    }
+    return total;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, int> calls_;
+};
+
+std::vector<std::string> Texts(const std::vector<SpeechSegment>& segments) {
+  std::vector<std::string> texts;
+  for (const SpeechSegment& segment : segments) {
+    texts.push_back(segment.text);
+  }
+  return texts;
+}
+
+void TestSplit() {
+  const auto segments =
+      SplitSpeechSegments("타이레놀, 1정, 3회, 7일, 총 21.0개");
+  EXPECT_TRUE(Texts(segments) ==
+              std::vector<std::string>({"타이레놀", "1", "정", "3", "회", "7",
+                                        "일", "총", "21.0", "개"}));
+  // Pauses follow phrases and words, not number/unit boundaries.
+  EXPECT_EQ(segments[0].pause_ms, 150);
+  EXPECT_EQ(segments[1].pause_ms, 0);
+  EXPECT_EQ(segments[2].pause_ms, 150);
+  EXPECT_EQ(segments[7].pause_ms, 40);
+  EXPECT_EQ(segments.back().pause_ms, 0);
+
+  // Names without digits stay whole, spaces included.
+  EXPECT_TRUE(Texts(SplitSpeechSegments("중복된 바코드입니다")) ==
+              std::vector<std::string>({"중복된 바코드입니다"}));
+  EXPECT_TRUE(Texts(SplitSpeechSegments("아스피린, 2.5개!")) ==
+              std::vector<std::string>({"아스피린", "2.5", "개!"}));
+  EXPECT_TRUE(Texts(SplitSpeechSegments("v1.")) ==
+              std::vector<std::string>({"v", "1", "."}));
+  EXPECT_TRUE(SplitSpeechSegments(" , ").empty());
+}
+
+void TestLru() {
+  // Each entry is 100 samples = 200 bytes.
+  SegmentCache cache(500);
+  cache.Put("a", PcmBuffer(100));
+  cache.Put("b", PcmBuffer(100));
+  EXPECT_TRUE(cache.Get("a") != nullptr);  // "b" is now the oldest
+  cache.Put("c", PcmBuffer(100));
+  EXPECT_TRUE(!cache.Contains("b"));
+  EXPECT_TRUE(cache.Contains("a"));
+  EXPECT_TRUE(cache.Contains("c"));
+
+  // Too big to keep, but still handed back for playing.
+  EXPECT_EQ(cache.Put("huge", PcmBuffer(1000))->size(), 1000u);
+  EXPECT_TRUE(!cache.Contains("huge"));
+
+  // Replacing an entry does not double count it.
+  cache.Put("a", PcmBuffer(50));
+  SegmentCacheStats stats = cache.GetStats();
+  EXPECT_EQ(stats.entries, 2u);
+  EXPECT_EQ(stats.bytes, 300u);
+  EXPECT_EQ(stats.evictions, 1u);
+  EXPECT_EQ(stats.hits, 1u);
+}
+
+void TestSegmentsAreReused() {
+  CountingEngine inner;
+  CachingSpeechEngine engine(&inner, 1 << 20);
+  size_t first_samples = 0;
+  engine.Synthesize("타이레놀, 1정, 3회",
+                    [&](const int16_t* samples, size_t count) {
+                      first_samples += count;
+                      return true;
+                    });
+  EXPECT_EQ(inner.total_calls(), 5);
+
+  // Another drug with the same numbers only renders the new name.
+  size_t samples = 0;
+  engine.Synthesize("아스피린, 1정, 3회", [&](const int16_t*, size_t count) {
+    samples += count;
+    return true;
+  });
+  EXPECT_EQ(inner.total_calls(), 6);
+  EXPECT_EQ(inner.calls("1"), 1);
+  EXPECT_EQ(inner.calls("정"), 1);
+
+  // Trimmed segments keep a 5 ms margin; pauses are added back between.
+  const size_t margin = 2 * 40;
+  const size_t pauses = 8 * 150 + 8 * 150;
+  const size_t tone = (100 + 12 * 10) + (100 + 10) + (100 + 3 * 10) +
+                      (100 + 10) + (100 + 3 * 10);
+  EXPECT_EQ(first_samples, tone + 5 * margin + pauses);
+
+  CachingSpeechEngineStats stats = engine.GetStats();
+  EXPECT_EQ(stats.cache.misses, 6u);
+  EXPECT_EQ(stats.cache.hits, 4u);
+}
+
+void TestInterruptStopsPlayback() {
+  CountingEngine inner;
+  CachingSpeechEngine engine(&inner, 1 << 20);
+  int chunks = 0;
+  EXPECT_TRUE(engine.Synthesize("1정, 3회", [&](const int16_t*, size_t) {
+    return ++chunks < 2;
+  }));
+  EXPECT_EQ(chunks, 2);
+  // Only the segment being played was rendered.
+  EXPECT_EQ(inner.total_calls(), 1);
+}
+
+void TestWarm() {
+  CountingEngine inner;
+  CachingSpeechEngine engine(&inner, 1 << 20);
+  engine.Warm({"타이레놀, 1정, 3회, 7일, 총 21.0개",
+               "아스피린, 1정, 3회, 7일, 총 21.0개"});
+  engine.WaitWarm();
+  EXPECT_EQ(inner.total_calls(), 11);
+  EXPECT_EQ(engine.GetStats().warmed, 11u);
+
+  // Warming again finds everything cached.
+  engine.Warm({"타이레놀, 1정"});
+  engine.WaitWarm();
+  EXPECT_EQ(inner.total_calls(), 11);
+
+  engine.Synthesize("아스피린, 1정, 3회, 7일, 총 21.0개",
+                    [](const int16_t*, size_t) { return true; });
+  EXPECT_EQ(inner.total_calls(), 11);
+  EXPECT_EQ(engine.GetStats().cache.misses, 0u);
+}
+
+}  // namespace
+
+int main() {
+  TestSplit();
+  TestLru();
+  TestSegmentsAreReused();
+  TestInterruptStopsPlayback();
+  TestWarm();
+  return TEST_RESULT();
+}
@@ -0,0 +1,270 @@
+#include "native/speech_scheduler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "native/audio_sink.h"
+#include "test_util.h"
+
+namespace {
+
+using std::chrono::milliseconds;
+
+// Produces |chunks| chunks of silence per utterance. Texts in the held set
+// keep producing audio until released or interrupted, so tests can decide
+// what is being spoken when the next request arrives.
+class FakeEngine : public SpeechEngine {
+ public:
+  static constexpr size_t kChunk = 160;
+
+  int sample_rate() const override { return 16000; }
+
+  bool Synthesize(const std::string& text,
+                  const AudioCallback& on_audio) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      started_.push_back(text);
+    }
+    const std::vector<int16_t> chunk(kChunk, 0);
+    for (int i = 0; i < 3; ++i) {
+      if (!on_audio(chunk.data(), chunk.size())) {
+        return true;
+      }
+    }
+    while (IsHeld(text)) {
+      if (!on_audio(chunk.data(), chunk.size())) {
+        return true;
+      }
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed_.push_back(text);
+    return true;
+  }
+
+  void Hold(const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    held_.insert(text);
+  }
+  void Release(const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    held_.erase(text);
+  }
+  // Waits until |text| has started speaking.
+  bool WaitStarted(const std::string& text) {
+    for (int i = 0; i < 2000; ++i) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const std::string& s : started_) {
+          if (s == text) {
+            return true;
+          }
+        }
+      }
+      std::this_thread::sleep_for(milliseconds(1));
+    }
+    return false;
+  }
+  std::vector<std::string> started() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return started_;
+  }
+  std::vector<std::string> completed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return completed_;
+  }
+
+ private:
+  bool IsHeld(const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return held_.count(text) > 0;
+  }
+
+  std::mutex mutex_;
+  std::set<std::string> held_;
+  std::vector<std::string> started_;
+  std::vector<std::string> completed_;
+};
+
+using Texts = std::vector<std::string>;
+
+void TestPriorityAndPreemption() {
+  FakeEngine engine;
+  NullAudioSink sink;
+  SpeechScheduler scheduler(&engine, &sink);
+  engine.Hold("drug A");
+  scheduler.Speak("drug A", SpeechPriority::kDrugLine);
+  EXPECT_TRUE(engine.WaitStarted("drug A"));
+
+  // Lower and equal classes wait; the error interrupts the drug line.
+  scheduler.Speak("patient", SpeechPriority::kPatientName);
+  scheduler.Speak("drug B", SpeechPriority::kDrugLine);
+  EXPECT_EQ(scheduler.GetStats().preempted, 0u);
+  scheduler.Speak("error", SpeechPriority::kError);
+  EXPECT_TRUE(scheduler.WaitIdle(milliseconds(2000)));
+
+  EXPECT_TRUE(engine.started() ==
+              Texts({"drug A", "error", "drug B", "patient"}));
+  EXPECT_TRUE(engine.completed() == Texts({"error", "drug B", "patient"}));
+  SpeechSchedulerStats stats = scheduler.GetStats();
+  EXPECT_EQ(stats.requested, 4u);
+  EXPECT_EQ(stats.spoken, 3u);
+  EXPECT_EQ(stats.preempted, 1u);
+  EXPECT_EQ(stats.max_queue_depth, 3u);
+  EXPECT_EQ(stats.queue_depth, 0u);
+  EXPECT_EQ(stats.first_audio_count, 4u);
+  EXPECT_TRUE(stats.max_first_audio_us >= stats.last_first_audio_us);
+  EXPECT_EQ(sink.utterances(), 4u);
+  EXPECT_EQ(sink.interrupted(), 1u);
+}
+
+void TestCoalescing() {
+  FakeEngine engine;
+  NullAudioSink sink;
+  SpeechScheduler scheduler(&engine, &sink);
+  engine.Hold("drug A");
+  const uint64_t a = scheduler.Speak("drug A", SpeechPriority::kDrugLine);
+  EXPECT_TRUE(engine.WaitStarted("drug A"));
+  // Same text as the one being spoken, and as one waiting.
+  EXPECT_EQ(scheduler.Speak("drug A", SpeechPriority::kDrugLine), a);
+  const uint64_t b = scheduler.Speak("drug B", SpeechPriority::kDrugLine);
+  EXPECT_EQ(scheduler.Speak("drug B", SpeechPriority::kDrugLine), b);
+  // A patient name equal to a waiting drug line is not spoken twice.
+  EXPECT_EQ(scheduler.Speak("drug B", SpeechPriority::kPatientName), b);
+  EXPECT_EQ(scheduler.Speak("", SpeechPriority::kError), 0u);
+  engine.Release("drug A");
+  EXPECT_TRUE(scheduler.WaitIdle(milliseconds(2000)));
+
+  EXPECT_TRUE(engine.completed() == Texts({"drug A", "drug B"}));
+  EXPECT_EQ(scheduler.GetStats().coalesced, 3u);
+}
+
+void TestLatencyHistograms() {
+  FakeEngine engine;
+  NullAudioSink sink;
+  LatencyHistogram queue_delay;
+  LatencyHistogram first_audio;
+  SpeechSchedulerOptions options;
+  options.queue_delay = &queue_delay;
+  options.first_audio = &first_audio;
+  SpeechScheduler scheduler(&engine, &sink, options);
+  engine.Hold("drug A");
+  scheduler.Speak("drug A", SpeechPriority::kDrugLine);
+  EXPECT_TRUE(engine.WaitStarted("drug A"));
+  scheduler.Speak("drug B", SpeechPriority::kDrugLine);
+  std::this_thread::sleep_for(milliseconds(20));
+  engine.Release("drug A");
+  EXPECT_TRUE(scheduler.WaitIdle(milliseconds(2000)));
+
+  const HistogramSnapshot waited = queue_delay.Snapshot();
+  EXPECT_EQ(waited.count, 2u);
+  // drug B waited behind drug A
+  EXPECT_TRUE(waited.max_us >= 20000);
+  const HistogramSnapshot audio = first_audio.Snapshot();
+  EXPECT_EQ(audio.count, 2u);
+  EXPECT_TRUE(audio.max_us >= waited.max_us);
+}
+
+void TestPatientNameReplaces() {
+  FakeEngine engine;
+  NullAudioSink sink;
+  SpeechScheduler scheduler(&engine, &sink);
+  engine.Hold("kim");
+  engine.Hold("lee");
+  scheduler.Speak("kim", SpeechPriority::kPatientName);
+  EXPECT_TRUE(engine.WaitStarted("kim"));
+  scheduler.Speak("lee", SpeechPriority::kPatientName);
+  scheduler.Speak("park", SpeechPriority::kPatientName);
+  EXPECT_TRUE(scheduler.WaitIdle(milliseconds(2000)));
+
+  // "lee" was either replaced while waiting or cut off while speaking.
+  EXPECT_TRUE(engine.completed() == Texts({"park"}));
+  SpeechSchedulerStats stats = scheduler.GetStats();
+  EXPECT_EQ(stats.preempted + stats.dropped, 2u);
+  EXPECT_TRUE(stats.preempted >= 1);
+}
+
+void TestBoundedQueue() {
+  FakeEngine engine;
+  NullAudioSink sink;
+  SpeechScheduler scheduler(&engine, &sink);
+  engine.Hold("error");
+  scheduler.Speak("error", SpeechPriority::kError);
+  EXPECT_TRUE(engine.WaitStarted("error"));
+  scheduler.Speak("d1", SpeechPriority::kDrugLine);
+  scheduler.Speak("d2", SpeechPriority::kDrugLine);
+  scheduler.Speak("d3", SpeechPriority::kDrugLine);
+  EXPECT_EQ(scheduler.GetStats().queue_depth, 2u);
+  engine.Release("error");
+  EXPECT_TRUE(scheduler.WaitIdle(milliseconds(2000)));
+
+  EXPECT_TRUE(engine.completed() == Texts({"error", "d2", "d3"}));
+  EXPECT_EQ(scheduler.GetStats().dropped, 1u);
+}
+
+void TestStop() {
+  FakeEngine engine;
+  NullAudioSink sink;
+  SpeechScheduler scheduler(&engine, &sink);
+  engine.Hold("long");
+  scheduler.Speak("long", SpeechPriority::kDrugLine);
+  EXPECT_TRUE(engine.WaitStarted("long"));
+  scheduler.Speak("p", SpeechPriority::kPatientName);
+  scheduler.Speak("d", SpeechPriority::kDrugLine);
+  scheduler.Stop();
+  EXPECT_TRUE(scheduler.WaitIdle(milliseconds(2000)));
+  EXPECT_TRUE(engine.completed().empty());
+  EXPECT_EQ(scheduler.GetStats().stopped, 3u);
+  EXPECT_EQ(sink.interrupted(), 1u);
+
+  // The scheduler keeps working after a stop.
+  scheduler.Speak("after", SpeechPriority::kDrugLine);
+  EXPECT_TRUE(scheduler.WaitIdle(milliseconds(2000)));
+  EXPECT_TRUE(engine.completed() == Texts({"after"}));
+}
+
+void TestWavFileSink() {
+  const std::string path = TempFilePath("speech_scheduler.wav");
+  uint64_t samples = 0;
+  {
+    FakeEngine engine;
+    WavFileSink sink(path);
+    SpeechScheduler scheduler(&engine, &sink);
+    scheduler.Speak("one", SpeechPriority::kDrugLine);
+    scheduler.Speak("two", SpeechPriority::kDrugLine);
+    EXPECT_TRUE(scheduler.WaitIdle(milliseconds(2000)));
+    samples = sink.samples();
+  }
+  EXPECT_EQ(samples, 6 * FakeEngine::kChunk);
+
+  std::ifstream in(path, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  EXPECT_EQ(data.size(), 44 + samples * 2);
+  EXPECT_TRUE(data.compare(0, 4, "RIFF") == 0);
+  EXPECT_TRUE(data.compare(36, 4, "data") == 0);
+  uint32_t data_bytes = 0;
+  std::memcpy(&data_bytes, data.data() + 40, sizeof(data_bytes));
+  EXPECT_EQ(data_bytes, samples * 2);
+  in.close();
+  std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+  TestPriorityAndPreemption();
+  TestCoalescing();
+  TestLatencyHistograms();
+  TestPatientNameReplaces();
+  TestBoundedQueue();
+  TestStop();
+  TestWavFileSink();
+  return TEST_RESULT();
+}
@@ -0,0 +1,116 @@
+#include "native/spsc_ring.h"
+
+#include <string>
+#include <thread>
+
+#include "test_util.h"
+
+namespace {
+
+void TestFifoAndCounters() {
+  SpscRing<std::string> ring(3);  // rounded up to 4
+  EXPECT_EQ(ring.capacity(), 4u);
+  EXPECT_TRUE(ring.Push("a"));
+  EXPECT_TRUE(ring.Push("b"));
+  std::string out;
+  EXPECT_TRUE(ring.Pop(&out));
+  EXPECT_EQ(out, "a");
+  EXPECT_TRUE(ring.Pop(&out));
+  EXPECT_EQ(out, "b");
+  EXPECT_TRUE(!ring.Pop(&out));
+
+  SpscRingStats stats = ring.GetStats();
+  EXPECT_EQ(stats.pushed, 2u);
+  EXPECT_EQ(stats.popped, 2u);
+  EXPECT_EQ(stats.dropped, 0u);
+  EXPECT_EQ(stats.high_water_mark, 2u);
+  EXPECT_EQ(stats.size, 0u);
+}
+
+void TestDropOldest() {
+  SpscRing<int> ring(4, OverflowPolicy::kDropOldest);
+  for (int i = 0; i < 4; ++i) EXPECT_TRUE(ring.Push(i));
+  EXPECT_TRUE(!ring.Push(4));
+  EXPECT_TRUE(!ring.Push(5));
+  int out = -1;
+  for (int expected = 2; expected <= 5; ++expected) {
+    EXPECT_TRUE(ring.Pop(&out));
+    EXPECT_EQ(out, expected);
+  }
+  EXPECT_EQ(ring.GetStats().dropped, 2u);
+  EXPECT_EQ(ring.GetStats().high_water_mark, 4u);
+}
+
+void TestDropNewest() {
+  SpscRing<int> ring(2, OverflowPolicy::kDropNewest);
+  EXPECT_TRUE(ring.Push(1));
+  EXPECT_TRUE(ring.Push(2));
+  EXPECT_TRUE(!ring.Push(3));
+  int out = 0;
+  EXPECT_TRUE(ring.Pop(&out));
+  EXPECT_EQ(out, 1);
+  EXPECT_TRUE(ring.Pop(&out));
+  EXPECT_EQ(out, 2);
+  EXPECT_EQ(ring.GetStats().dropped, 1u);
+}
+
+void TestBlockTimesOut() {
+  SpscRing<int> ring(2, OverflowPolicy::kBlock, std::chrono::milliseconds(5));
+  EXPECT_TRUE(ring.Push(1));
+  EXPECT_TRUE(ring.Push(2));
+  EXPECT_TRUE(!ring.Push(3));
+  EXPECT_EQ(ring.GetStats().dropped, 1u);
+}
+
+// Items must arrive in order and either be delivered or counted as dropped.
+void TestConcurrent(OverflowPolicy policy) {
+  constexpr int kItems = 200000;
+  SpscRing<int> ring(64, policy);
+  std::thread producer([&ring]() {
+    for (int i = 0; i < kItems; ++i) ring.Push(i);
+  });
+
+  int last = -1;
+  bool ordered = true;
+  uint64_t received = 0;
+  int out = 0;
+  while (true) {
+    if (ring.Pop(&out)) {
+      if (out <= last) ordered = false;
+      last = out;
+      ++received;
+      if (out == kItems - 1) break;
+    } else if (policy == OverflowPolicy::kDropNewest &&
+               ring.GetStats().pushed + ring.GetStats().dropped == kItems &&
+               ring.Empty()) {
+      break;
+    }
+  }
+  producer.join();
+  while (ring.Pop(&out)) ++received;
+
+  SpscRingStats stats = ring.GetStats();
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(received, stats.popped);
+  if (policy == OverflowPolicy::kBlock) {
+    EXPECT_EQ(received, static_cast<uint64_t>(kItems));
+  }
+  if (policy == OverflowPolicy::kDropOldest) {
+    EXPECT_EQ(stats.pushed, static_cast<uint64_t>(kItems));
+    EXPECT_EQ(received + stats.dropped, static_cast<uint64_t>(kItems));
+  }
+  EXPECT_TRUE(stats.high_water_mark <= 64);
+}
+
+}  // namespace
+
+int main() {
+  TestFifoAndCounters();
+  TestDropOldest();
+  TestDropNewest();
+  TestBlockTimesOut();
+  TestConcurrent(OverflowPolicy::kDropOldest);
+  TestConcurrent(OverflowPolicy::kDropNewest);
+  TestConcurrent(OverflowPolicy::kBlock);
+  return TEST_RESULT();
+}
@@ -0,0 +1,91 @@
+#include "native/startup_timeline.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+void TestMarks() {
+  StartupTimeline timeline;
+  timeline.Mark("main");
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  timeline.Mark("activate");
+  timeline.Mark("main");
+
+  const std::vector<StartupMark> marks = timeline.Marks();
+  EXPECT_EQ(marks.size(), 2u);
+  EXPECT_EQ(marks[0].name, "main");
+  EXPECT_EQ(marks[1].name, "activate");
+  EXPECT_TRUE(marks[1].us - marks[0].us >= 5000);
+  EXPECT_EQ(timeline.Get("main"), marks[0].us);
+  EXPECT_EQ(timeline.Get("first_frame"), -1);
+#ifdef __linux__
+  // The test binary has been running since before the timeline existed.
+  EXPECT_TRUE(timeline.has_process_start());
+  EXPECT_TRUE(marks[0].us > 0);
+#endif
+}
+
+void TestJsonRoundTrip() {
+  StartupTimeline timeline;
+  timeline.Mark("main");
+  timeline.Mark("dart \"main\"");
+  timeline.Mark("first_frame");
+  const std::string json = timeline.ToJson();
+  EXPECT_EQ(json.find('\n'), std::string::npos);
+
+  std::vector<StartupMark> parsed;
+  EXPECT_TRUE(ParseStartupTimeline(json, &parsed));
+  const std::vector<StartupMark> marks = timeline.Marks();
+  EXPECT_EQ(parsed.size(), marks.size());
+  for (size_t i = 0; i < parsed.size() && i < marks.size(); ++i) {
+    EXPECT_EQ(parsed[i].name, marks[i].name);
+    EXPECT_EQ(parsed[i].us, marks[i].us);
+  }
+
+  EXPECT_TRUE(ParseStartupTimeline(
+      "{ \"process_start\": false, \"marks\": [ ] }", &parsed));
+  EXPECT_TRUE(parsed.empty());
+  EXPECT_TRUE(!ParseStartupTimeline("", &parsed));
+  EXPECT_TRUE(!ParseStartupTimeline(
+      "{\"process_start\":true,\"marks\":[{\"name\":\"main\"}]}", &parsed));
+
+  const std::string text = timeline.ToText();
+  EXPECT_TRUE(text.find("first_frame") != std::string::npos);
+}
+
+void TestSummary() {
+  std::vector<std::vector<StartupMark>> runs;
+  for (int i = 1; i <= 10; ++i) {
+    runs.push_back({{"main", 1000 * i}, {"first_frame", 10000 * i}});
+  }
+  // A phase only some runs reached
+  runs[0].push_back({"first_data", 50000});
+
+  const std::vector<StartupPhaseSummary> summary = SummarizeStartups(runs);
+  EXPECT_EQ(summary.size(), 3u);
+  EXPECT_EQ(summary[0].name, "main");
+  EXPECT_EQ(summary[0].runs, 10u);
+  EXPECT_EQ(summary[0].min_us, 1000);
+  EXPECT_EQ(summary[0].median_us, 5000);
+  EXPECT_EQ(summary[0].p90_us, 9000);
+  EXPECT_EQ(summary[0].max_us, 10000);
+  EXPECT_EQ(summary[1].name, "first_frame");
+  EXPECT_EQ(summary[1].median_us, 50000);
+  EXPECT_EQ(summary[2].name, "first_data");
+  EXPECT_EQ(summary[2].runs, 1u);
+  EXPECT_EQ(summary[2].p90_us, 50000);
+}
+
+}  // namespace
+
+int main() {
+  TestMarks();
+  TestJsonRoundTrip();
+  TestSummary();
+  return TEST_RESULT();
+}
@@ -0,0 +1,54 @@
+#include "native/string_pool.h"
+
+#include <string>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+void TestIntern() {
+  StringPool pool;
+  EXPECT_EQ(pool.Intern(""), StringPool::kEmpty);
+  const uint32_t a = pool.Intern("타이레놀정500mg");
+  const uint32_t b = pool.Intern("A");
+  EXPECT_TRUE(a != b);
+  EXPECT_TRUE(a != StringPool::kEmpty);
+  EXPECT_EQ(pool.Intern("타이레놀정500mg"), a);
+  EXPECT_EQ(pool.Get(a), "타이레놀정500mg");
+  EXPECT_EQ(pool.Get(b), "A");
+  EXPECT_EQ(pool.Get(StringPool::kEmpty), "");
+  EXPECT_EQ(pool.Get(1000), "");
+  EXPECT_EQ(pool.size(), 3u);
+
+  // Embedded NULs are part of the string
+  const std::string with_nul("a\0b", 3);
+  const uint32_t c = pool.Intern(with_nul);
+  EXPECT_EQ(pool.Get(c).size(), 3u);
+  EXPECT_TRUE(pool.Intern("a") != c);
+
+  pool.Clear();
+  EXPECT_EQ(pool.size(), 1u);
+  EXPECT_EQ(pool.Get(a), "");
+}
+
+void TestGrow() {
+  StringPool pool;
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < 5000; ++i) {
+    ids.push_back(pool.Intern("drug-" + std::to_string(i)));
+  }
+  EXPECT_EQ(pool.size(), 5001u);
+  for (int i = 0; i < 5000; ++i) {
+    EXPECT_EQ(pool.Intern("drug-" + std::to_string(i)), ids[i]);
+    EXPECT_EQ(pool.Get(ids[i]), "drug-" + std::to_string(i));
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestIntern();
+  TestGrow();
+  return TEST_RESULT();
+}
@@ -0,0 +1,203 @@
+#ifndef NATIVE_TEST_STUB_HTTP_SERVER_H_
+#define NATIVE_TEST_STUB_HTTP_SERVER_H_
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Loopback HTTP/1.1 server standing in for the PostgREST RPC endpoint. Each
+// request's body goes to a handler that returns the response body. Latency
+// and failures are injected per request: every |fail_every|-th request has
+// its connection dropped without a reply, as a flapping network would.
+class StubHttpServer {
+ public:
+  using Handler = std::function<std::string(const std::string& path,
+                                            const std::string& body)>;
+
+  explicit StubHttpServer(Handler handler) : handler_(std::move(handler)) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t length = sizeof(addr);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ==
+            0 &&
+        listen(listen_fd_, 16) == 0 &&
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &length) ==
+            0) {
+      port_ = ntohs(addr.sin_port);
+      thread_ = std::thread([this] { Serve(); });
+    }
+  }
+
+  ~StubHttpServer() {
+    stop_ = true;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    close(listen_fd_);
+  }
+
+  bool ok() const { return port_ != 0; }
+  int port() const { return port_; }
+
+  void set_latency_ms(int ms) { latency_ms_ = ms; }
+  void set_fail_every(int n) { fail_every_ = n; }
+  int requests() const { return requests_; }
+
+ private:
+  void Serve() {
+    while (!stop_) {
+      struct pollfd pfd = {listen_fd_, POLLIN, 0};
+      if (poll(&pfd, 1, 20) <= 0) {
+        continue;
+      }
+      int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) {
+        continue;
+      }
+      // Keep-alive: serve requests on this connection until it closes.
+      std::string buffer;
+      while (!stop_ && HandleOne(fd, &buffer)) {
+      }
+      close(fd);
+    }
+  }
+
+  // Reads one request from |fd| and answers it. Returns false when the
+  // connection should be closed.
+  bool HandleOne(int fd, std::string* buffer) {
+    size_t header_end;
+    while ((header_end = buffer->find("\r\n\r\n")) == std::string::npos) {
+      if (!ReadMore(fd, buffer)) {
+        return false;
+      }
+    }
+    const std::string head = buffer->substr(0, header_end);
+    size_t content_length = 0;
+    const size_t cl = head.find("Content-Length:");
+    if (cl != std::string::npos) {
+      content_length = std::strtoul(head.c_str() + cl + 15, nullptr, 10);
+    }
+    while (buffer->size() < header_end + 4 + content_length) {
+      if (!ReadMore(fd, buffer)) {
+        return false;
+      }
+    }
+    const size_t path_start = head.find(' ') + 1;
+    const std::string path =
+        head.substr(path_start, head.find(' ', path_start) - path_start);
+    const std::string body = buffer->substr(header_end + 4, content_length);
+    buffer->erase(0, header_end + 4 + content_length);
+
+    const int index = ++requests_;
+    if (latency_ms_ > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(latency_ms_));
+    }
+    if (fail_every_ > 0 && index % fail_every_ == 0) {
+      return false;
+    }
+    std::string reply;
+    {
+      std::lock_guard<std::mutex> lock(handler_mutex_);
+      reply = handler_(path, body);
+    }
+    const std::string response =
+        "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+        "Content-Length: " +
+        std::to_string(reply.size()) + "\r\n\r\n" + reply;
+    return send(fd, response.data(), response.size(), MSG_NOSIGNAL) ==
+           static_cast<ssize_t>(response.size());
+  }
+
+  bool ReadMore(int fd, std::string* buffer) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, 1000) <= 0) {
+      return false;
+    }
+    char chunk[4096];
+    const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+    if (n <= 0) {
+      return false;
+    }
+    buffer->append(chunk, static_cast<size_t>(n));
+    return true;
+  }
+
+  Handler handler_;
+  std::mutex handler_mutex_;
+  int listen_fd_ = -1;
+  int port_ = 0;
+  std::thread thread_;
+  std::atomic<bool> stop_{false};
+  std::atomic<int> latency_ms_{0};
+  std::atomic<int> fail_every_{0};
+  std::atomic<int> requests_{0};
+};
+
+// One-shot blocking POST to the stub on 127.0.0.1:|port|. Returns false on
+// any transport failure (refused, dropped, timed out).
+inline bool StubHttpPost(int port, const std::string& path,
+                         const std::string& body, std::string* response) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    close(fd);
+    return false;
+  }
+  const std::string request = "POST " + path +
+                              " HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                              "Content-Type: application/json\r\n"
+                              "Content-Length: " +
+                              std::to_string(body.size()) + "\r\n\r\n" + body;
+  bool ok = send(fd, request.data(), request.size(), MSG_NOSIGNAL) ==
+            static_cast<ssize_t>(request.size());
+  std::string reply;
+  size_t header_end = std::string::npos;
+  size_t content_length = 0;
+  while (ok) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    char chunk[4096];
+    ssize_t n = 0;
+    if (poll(&pfd, 1, 2000) <= 0 ||
+        (n = recv(fd, chunk, sizeof(chunk), 0)) <= 0) {
+      ok = false;
+      break;
+    }
+    reply.append(chunk, static_cast<size_t>(n));
+    if (header_end == std::string::npos) {
+      header_end = reply.find("\r\n\r\n");
+      if (header_end != std::string::npos) {
+        const size_t cl = reply.find("Content-Length:");
+        if (cl != std::string::npos && cl < header_end) {
+          content_length = std::strtoul(reply.c_str() + cl + 15, nullptr, 10);
+        }
+      }
+    }
+    if (header_end != std::string::npos &&
+        reply.size() >= header_end + 4 + content_length) {
+      *response = reply.substr(header_end + 4, content_length);
+      break;
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+#endif  // NATIVE_TEST_STUB_HTTP_SERVER_H_
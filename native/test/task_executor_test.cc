@@ -0,0 +1,246 @@
+#include "native/task_executor.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+using std::chrono::milliseconds;
+
+// Holds a task until Open() is called.
+class Gate {
+ public:
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    entered_ = true;
+    cv_.notify_all();
+    cv_.wait(lock, [this] { return open_; });
+  }
+  void WaitEntered() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return entered_; });
+  }
+  void Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = true;
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool entered_ = false;
+  bool open_ = false;
+};
+
+void TestStrandRunsInOrder() {
+  TaskExecutor executor(TaskExecutorOptions{4});
+  std::mutex mutex;
+  std::vector<int> order;
+  std::atomic<int> running{0};
+  std::atomic<int> overlaps{0};
+  for (int i = 0; i < 50; ++i) {
+    executor.Post("comport", [&, i] {
+      if (running.fetch_add(1) != 0) {
+        ++overlaps;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(i);
+      }
+      running.fetch_sub(1);
+    });
+  }
+  executor.WaitIdle();
+  EXPECT_EQ(overlaps.load(), 0);
+  EXPECT_EQ(order.size(), 50u);
+  bool sorted = true;
+  for (size_t i = 0; i < order.size(); ++i) {
+    sorted = sorted && order[i] == static_cast<int>(i);
+  }
+  EXPECT_TRUE(sorted);
+
+  const TaskQueueStats stats = executor.GetStats();
+  EXPECT_EQ(stats.posted, 50u);
+  EXPECT_EQ(stats.executed, 50u);
+  EXPECT_EQ(stats.pending, 0u);
+  EXPECT_TRUE(stats.total_run_us >= 50 * 200);
+  // Later tasks waited for the earlier ones.
+  EXPECT_TRUE(stats.max_queue_us >= 40 * 200);
+}
+
+void TestStrandsRunInParallel() {
+  TaskExecutor executor(TaskExecutorOptions{2});
+  Gate gate;
+  executor.Post("comport", [&] { gate.Wait(); });
+  gate.WaitEntered();
+
+  // A blocked serial write does not hold up speech.
+  std::atomic<bool> spoke{false};
+  executor.Post("tts", [&] { spoke = true; });
+  for (int i = 0; i < 500 && !spoke; ++i) {
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  EXPECT_TRUE(spoke.load());
+
+  gate.Open();
+  executor.WaitIdle();
+  const auto strands = executor.GetStrandStats();
+  EXPECT_EQ(strands.size(), 2u);
+  EXPECT_EQ(strands.at("comport").executed, 1u);
+  EXPECT_EQ(strands.at("tts").executed, 1u);
+}
+
+void TestCancel() {
+  TaskExecutor executor(TaskExecutorOptions{2});
+  Gate gate;
+  const uint64_t blocker = executor.Post("comport", [&] { gate.Wait(); });
+  gate.WaitEntered();
+
+  std::vector<std::string> log;
+  std::mutex mutex;
+  auto note = [&](const std::string& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    log.push_back(entry);
+  };
+  executor.Post("comport", [&] { note("run 1"); }, [&] { note("cancel 1"); });
+  const uint64_t second = executor.Post(
+      "comport", [&] { note("run 2"); }, [&] { note("cancel 2"); });
+  executor.Post("comport", [&] { note("run 3"); }, [&] { note("cancel 3"); });
+
+  // Started tasks cannot be cancelled.
+  EXPECT_TRUE(!executor.Cancel(blocker));
+  EXPECT_TRUE(executor.Cancel(second));
+  EXPECT_TRUE(!executor.Cancel(second));
+  EXPECT_EQ(log.size(), 1u);
+  EXPECT_EQ(log[0], "cancel 2");
+
+  gate.Open();
+  executor.WaitIdle();
+  EXPECT_EQ(log.size(), 3u);
+  EXPECT_EQ(log[1], "run 1");
+  EXPECT_EQ(log[2], "run 3");
+
+  // Cancelling a whole strand, e.g. when the port is closed.
+  Gate second_gate;
+  executor.Post("comport", [&] { second_gate.Wait(); });
+  second_gate.WaitEntered();
+  for (int i = 0; i < 5; ++i) {
+    executor.Post("comport", [&] { note("late run"); },
+                  [&] { note("late cancel"); });
+  }
+  EXPECT_EQ(executor.CancelStrand("comport"), 5u);
+  EXPECT_EQ(executor.CancelStrand("unknown"), 0u);
+  second_gate.Open();
+  executor.WaitIdle();
+  EXPECT_EQ(log.size(), 8u);
+  EXPECT_EQ(log.back(), "late cancel");
+
+  const TaskQueueStats stats = executor.GetStrandStats().at("comport");
+  EXPECT_EQ(stats.posted, 10u);
+  EXPECT_EQ(stats.executed, 4u);
+  EXPECT_EQ(stats.cancelled, 6u);
+  EXPECT_EQ(stats.pending, 0u);
+}
+
+void TestShutdownCancelsWaiting() {
+  std::atomic<int> cancelled{0};
+  std::atomic<int> ran{0};
+  Gate gate;
+  std::thread opener;
+  {
+    TaskExecutor executor(TaskExecutorOptions{1});
+    executor.Post("tts", [&] { gate.Wait(); });
+    gate.WaitEntered();
+    for (int i = 0; i < 3; ++i) {
+      executor.Post("tts", [&] { ++ran; }, [&] { ++cancelled; });
+    }
+    opener = std::thread([&] {
+      std::this_thread::sleep_for(milliseconds(20));
+      gate.Open();
+    });
+  }
+  opener.join();
+  // The running task finished; the waiting ones were answered as cancelled.
+  EXPECT_EQ(ran.load(), 0);
+  EXPECT_EQ(cancelled.load(), 3);
+}
+
+void TestThreadHooks() {
+  std::atomic<int> started{0};
+  std::atomic<int> exited{0};
+  {
+    TaskExecutorOptions options;
+    options.threads = 3;
+    options.on_thread_start = [&] { ++started; };
+    options.on_thread_exit = [&] { ++exited; };
+    TaskExecutor executor(options);
+    executor.Post("tts", [] {});
+    executor.WaitIdle();
+  }
+  EXPECT_EQ(started.load(), 3);
+  EXPECT_EQ(exited.load(), 3);
+}
+
+void TestMainThreadQueue() {
+  std::atomic<int> wakes{0};
+  MainThreadQueue queue([&] { ++wakes; });
+  TaskExecutor executor(TaskExecutorOptions{2});
+
+  std::vector<int> results;
+  const std::thread::id main_thread = std::this_thread::get_id();
+  std::atomic<int> on_main{0};
+  for (int i = 0; i < 10; ++i) {
+    executor.Post("comport", [&, i] {
+      queue.Post([&, i] {
+        results.push_back(i);
+        if (std::this_thread::get_id() == main_thread) {
+          ++on_main;
+        }
+      });
+    });
+  }
+  executor.WaitIdle();
+  // Posted while nothing was drained: a single wake-up.
+  EXPECT_EQ(wakes.load(), 1);
+  EXPECT_EQ(queue.Drain(), 10u);
+  EXPECT_EQ(results.size(), 10u);
+  EXPECT_EQ(on_main.load(), 10);
+  EXPECT_EQ(results.front(), 0);
+  EXPECT_EQ(results.back(), 9);
+  EXPECT_EQ(queue.Drain(), 0u);
+
+  queue.Post([] {});
+  EXPECT_EQ(wakes.load(), 2);
+  queue.Drain();
+
+  {
+    MainThreadQueue::BusyScope busy(&queue);
+    std::this_thread::sleep_for(milliseconds(20));
+  }
+  const MainThreadQueueStats stats = queue.GetStats();
+  EXPECT_EQ(stats.posted, 11u);
+  EXPECT_EQ(stats.completed, 11u);
+  EXPECT_TRUE(stats.max_busy_us >= 20000);
+  EXPECT_EQ(stats.busy_over_frame, 1u);
+}
+
+}  // namespace
+
+int main() {
+  TestStrandRunsInOrder();
+  TestStrandsRunInParallel();
+  TestCancel();
+  TestShutdownCancelsWaiting();
+  TestThreadHooks();
+  TestMainThreadQueue();
+  return TEST_RESULT();
+}
@@ -0,0 +1,50 @@
+#ifndef NATIVE_TEST_TEST_UTIL_H_
+#define NATIVE_TEST_TEST_UTIL_H_
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+// Minimal assertion helpers for the native tests. Each test binary returns
+// TEST_RESULT() from main so ctest sees failures as a non-zero exit code.
+
+inline int& TestFailureCount() {
+  static int failures = 0;
+  return failures;
+}
+
+#define EXPECT_TRUE(cond)                                             \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": expected " #cond \
+                << std::endl;                                         \
+      ++TestFailureCount();                                           \
+    }                                                                 \
+  } while (0)
+
+#define EXPECT_EQ(a, b)                                                 \
+  do {                                                                  \
+    if (!((a) == (b))) {                                                \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": expected " #a      \
+                << " == " #b << " (" << (a) << " vs " << (b) << ")"     \
+                << std::endl;                                           \
+      ++TestFailureCount();                                             \
+    }                                                                   \
+  } while (0)
+
+// Fresh path in the temp directory for a test's scratch file; any file left
+// at that path by an earlier run is removed.
+inline std::string TempFilePath(const std::string& name) {
+  const auto stamp =
+      std::chrono::steady_clock::now().time_since_epoch().count();
+  std::filesystem::path path = std::filesystem::temp_directory_path() /
+                               (name + "." + std::to_string(stamp));
+  std::error_code ignored;
+  std::filesystem::remove(path, ignored);
+  return path.string();
+}
+
+#define TEST_RESULT() (TestFailureCount() == 0 ? 0 : 1)
+
+#endif  // NATIVE_TEST_TEST_UTIL_H_
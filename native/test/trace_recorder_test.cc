@@ -0,0 +1,174 @@
+#include "native/trace_recorder.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "native/ffi/pharm_native_ffi.h"
+#include "test_util.h"
+
+namespace {
+
+size_t Count(const std::string& text, const std::string& needle) {
+  size_t count = 0;
+  for (size_t at = text.find(needle); at != std::string::npos;
+       at = text.find(needle, at + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+void TestDisabledRecordsNothing() {
+  TraceRecorder recorder;
+  recorder.Record("serial.frame", 1, 100, 200);
+  EXPECT_TRUE(recorder.Collect().empty());
+  EXPECT_EQ(recorder.ToChromeJson(),
+            "{\"traceEvents\":[],\"displayTimeUnit\":\"ms\"}");
+}
+
+void TestSpansOfSeveralThreads() {
+  TraceRecorder recorder;
+  recorder.SetEnabled(true);
+  recorder.SetThreadName("main \"loop\"");
+  recorder.Record("scan.match", 7, 3000, 5000);
+  std::thread worker([&recorder] {
+    recorder.SetThreadName("serial");
+    recorder.Record("serial.frame", 7, 1000, 2500);
+  });
+  worker.join();
+  recorder.Record("ui.frame", 7, 6000, 4000);
+
+  const std::vector<TraceEvent> events = recorder.Collect();
+  EXPECT_EQ(events.size(), 3u);
+  EXPECT_EQ(std::string(events[0].name), "serial.frame");
+  EXPECT_EQ(std::string(events[1].name), "scan.match");
+  EXPECT_TRUE(events[0].thread_id != events[1].thread_id);
+  EXPECT_EQ(events[1].thread_id, events[2].thread_id);
+  // An end before the begin is clamped to an empty span
+  EXPECT_EQ(events[2].end_ns, 6000);
+
+  const std::string json = recorder.ToChromeJson();
+  EXPECT_EQ(Count(json, "\"ph\":\"X\""), 3u);
+  EXPECT_EQ(Count(json, "\"ph\":\"M\""), 2u);
+  EXPECT_TRUE(json.find("\"ts\":1.000,\"dur\":1.500") != std::string::npos);
+  EXPECT_EQ(Count(json, "\"args\":{\"scan\":7}"), 3u);
+  EXPECT_TRUE(json.find("main \\\"loop\\\"") != std::string::npos);
+
+  recorder.Clear();
+  EXPECT_TRUE(recorder.Collect().empty());
+  recorder.Record("after.clear", 0, 1, 2);
+  EXPECT_EQ(recorder.Collect().size(), 1u);
+  EXPECT_TRUE(recorder.ToChromeJson().find("{\"scan\"") == std::string::npos);
+}
+
+void TestRingKeepsTheNewest() {
+  TraceRecorder recorder(4);
+  recorder.SetEnabled(true);
+  for (int i = 0; i < 10; ++i) {
+    recorder.Record("span", static_cast<uint64_t>(i + 1), i * 10, i * 10 + 5);
+  }
+  const std::vector<TraceEvent> events = recorder.Collect();
+  EXPECT_EQ(events.size(), 4u);
+  EXPECT_EQ(events.front().scan_id, 7u);
+  EXPECT_EQ(events.back().scan_id, 10u);
+
+  const std::string long_name(100, 'x');
+  recorder.Record(long_name, 0, 0, 1);
+  EXPECT_EQ(std::string(recorder.Collect().front().name).size(), 39u);
+}
+
+// Dumps while threads record; every collected span must be one that was
+// written whole.
+void TestCollectWhileRecording() {
+  TraceRecorder recorder(64);
+  recorder.SetEnabled(true);
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 3; ++t) {
+    writers.emplace_back([&recorder, t] {
+      for (int i = 1; i <= 20000; ++i) {
+        const int64_t begin = static_cast<int64_t>(t) * 1000000 + i;
+        recorder.Record("w", static_cast<uint64_t>(begin), begin, begin + i);
+      }
+    });
+  }
+  bool consistent = true;
+  for (int round = 0; round < 200; ++round) {
+    for (const TraceEvent& event : recorder.Collect()) {
+      consistent &= event.scan_id == static_cast<uint64_t>(event.begin_ns) &&
+                    event.end_ns - event.begin_ns == event.begin_ns % 1000000;
+    }
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  EXPECT_TRUE(consistent);
+  EXPECT_EQ(recorder.Collect().size(), 3u * 64u);
+}
+
+void TestScanIdsIncrease() {
+  uint64_t previous = 0;
+  bool increasing = true;
+  for (int i = 0; i < 1000; ++i) {
+    const uint64_t id = TraceRecorder::NextScanId();
+    increasing &= id > previous;
+    previous = id;
+  }
+  EXPECT_TRUE(increasing);
+  EXPECT_TRUE(static_cast<int64_t>(pharm_trace_next_scan_id()) >
+              static_cast<int64_t>(previous) - 1000000000);
+}
+
+void TestSpanScope() {
+  ProcessTraceRecorder().SetEnabled(true);
+  { TraceSpan span("scoped", 3); }
+  ProcessTraceRecorder().SetEnabled(false);
+  { TraceSpan span("ignored", 4); }
+  const std::vector<TraceEvent> events = ProcessTraceRecorder().Collect();
+  EXPECT_EQ(events.size(), 1u);
+  EXPECT_EQ(std::string(events[0].name), "scoped");
+  EXPECT_TRUE(events[0].end_ns >= events[0].begin_ns);
+}
+
+// The test links both the static library and the FFI library, each with
+// its own process recorder, as the runner and Dart do.
+void TestFfiMergesAnotherRecorder() {
+  pharm_trace_set_enabled(1);
+  EXPECT_EQ(pharm_trace_enabled(), 1);
+  pharm_trace_set_thread_name("dart:ui", 7);
+  const int64_t begin = pharm_trace_now_ns();
+  pharm_trace_record("scan.unit", 9, 42, begin, begin + 1000);
+
+  const std::string path = TempFilePath("trace_recorder_test.json");
+  const std::string runner = ProcessTraceRecorder().ChromeEvents();
+  EXPECT_EQ(pharm_trace_write(path.c_str(), runner.data(),
+                              static_cast<int32_t>(runner.size())),
+            1);
+  std::ifstream file(path);
+  const std::string json((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  EXPECT_TRUE(json.rfind("{\"traceEvents\":[", 0) == 0);
+  EXPECT_TRUE(json.find("\"scan.unit\"") != std::string::npos);
+  EXPECT_TRUE(json.find("\"dart:ui\"") != std::string::npos);
+  EXPECT_TRUE(json.find("\"scoped\"") != std::string::npos);
+  std::remove(path.c_str());
+
+  pharm_trace_clear();
+  pharm_trace_set_enabled(0);
+  EXPECT_EQ(pharm_trace_write("", nullptr, 0), 0);
+}
+
+}  // namespace
+
+int main() {
+  TestDisabledRecordsNothing();
+  TestSpansOfSeveralThreads();
+  TestRingKeepsTheNewest();
+  TestCollectWhileRecording();
+  TestScanIdsIncrease();
+  TestSpanScope();
+  TestFfiMergesAnotherRecorder();
+  return TEST_RESULT();
+}
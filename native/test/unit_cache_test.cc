@@ -0,0 +1,147 @@
+#include "native/unit_cache.h"
+
+#include <cstdio>
+#include <string>
+
+#include "native/mapped_file.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr int64_t kTtlMs = 60 * 1000;
+
+void TestMissHitStale() {
+  const std::string path = TempFilePath("unit_cache_basic");
+  UnitCache cache;
+  EXPECT_TRUE(cache.Open(path, 16, kTtlMs));
+
+  double unit = -1;
+  EXPECT_TRUE(cache.Lookup("8806469007312", 1000, &unit) ==
+              UnitCacheResult::kMiss);
+  EXPECT_TRUE(cache.Put("8806469007312", 30, 1000));
+  EXPECT_TRUE(cache.Lookup("8806469007312", 2000, &unit) ==
+              UnitCacheResult::kHit);
+  EXPECT_EQ(unit, 30.0);
+
+  // Past the TTL the value is still served, flagged stale.
+  unit = -1;
+  EXPECT_TRUE(cache.Lookup("8806469007312", 1000 + kTtlMs + 1, &unit) ==
+              UnitCacheResult::kStale);
+  EXPECT_EQ(unit, 30.0);
+
+  // A refresh makes it fresh again.
+  EXPECT_TRUE(cache.Put("8806469007312", 28, 1000 + kTtlMs + 1));
+  EXPECT_TRUE(cache.Lookup("8806469007312", 1000 + kTtlMs + 2, &unit) ==
+              UnitCacheResult::kHit);
+  EXPECT_EQ(unit, 28.0);
+
+  UnitCacheStats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 2u);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.stale, 1u);
+  EXPECT_EQ(stats.puts, 2u);
+  EXPECT_EQ(stats.entries, 1u);
+  cache.Close();
+  std::remove(path.c_str());
+}
+
+void TestKeys() {
+  EXPECT_TRUE(UnitCache::MakeKey("") == 0);
+  EXPECT_TRUE(UnitCache::MakeKey("88064690073A2") == 0);
+  EXPECT_TRUE(UnitCache::MakeKey("123456789012345") == 0);  // > 14 digits
+  EXPECT_TRUE(UnitCache::MakeKey("0123") != UnitCache::MakeKey("123"));
+  EXPECT_TRUE(UnitCache::MakeKey("08806469007312") != 0);
+
+  const std::string path = TempFilePath("unit_cache_keys");
+  UnitCache cache;
+  EXPECT_TRUE(cache.Open(path, 16, kTtlMs));
+  EXPECT_TRUE(!cache.Put("not-a-gtin", 1, 0));
+  double unit = 0;
+  EXPECT_TRUE(cache.Lookup("not-a-gtin", 0, &unit) == UnitCacheResult::kMiss);
+  cache.Close();
+  std::remove(path.c_str());
+}
+
+void TestGeneration() {
+  const std::string path = TempFilePath("unit_cache_generation");
+  UnitCache cache;
+  EXPECT_TRUE(cache.Open(path, 16, kTtlMs));
+  cache.SetGeneration(1);
+  EXPECT_TRUE(cache.Put("8806469007312", 10, 0));
+  cache.SetGeneration(2);
+  double unit = 0;
+  EXPECT_TRUE(cache.Lookup("8806469007312", 1, &unit) ==
+              UnitCacheResult::kStale);
+  EXPECT_TRUE(cache.Put("8806469007312", 12, 1));
+  EXPECT_TRUE(cache.Lookup("8806469007312", 2, &unit) ==
+              UnitCacheResult::kHit);
+  EXPECT_EQ(unit, 12.0);
+  cache.Close();
+  std::remove(path.c_str());
+}
+
+// Entries and generation survive a reopen, including after the table grew.
+void TestPersistenceAndGrowth() {
+  const std::string path = TempFilePath("unit_cache_persist");
+  const int kEntries = 1000;
+  {
+    UnitCache cache;
+    EXPECT_TRUE(cache.Open(path, 64, kTtlMs));
+    cache.SetGeneration(7);
+    for (int i = 0; i < kEntries; ++i) {
+      EXPECT_TRUE(cache.Put(std::to_string(8806469000000LL + i), i % 100 + 1,
+                            5000));
+    }
+    EXPECT_TRUE(cache.GetStats().capacity >= 2 * kEntries);
+    EXPECT_TRUE(cache.Flush(true));
+  }
+  UnitCache cache;
+  EXPECT_TRUE(cache.Open(path, 64, kTtlMs));
+  UnitCacheStats stats = cache.GetStats();
+  EXPECT_EQ(stats.entries, static_cast<uint64_t>(kEntries));
+  EXPECT_EQ(stats.generation, 7u);
+  int found = 0;
+  for (int i = 0; i < kEntries; ++i) {
+    double unit = 0;
+    if (cache.Lookup(std::to_string(8806469000000LL + i), 6000, &unit) ==
+            UnitCacheResult::kHit &&
+        unit == i % 100 + 1) {
+      ++found;
+    }
+  }
+  EXPECT_EQ(found, kEntries);
+  cache.Close();
+  std::remove(path.c_str());
+}
+
+// A file that is not a cache is replaced rather than trusted.
+void TestCorruptFileIsReset() {
+  const std::string path = TempFilePath("unit_cache_corrupt");
+  {
+    MappedFile file;
+    EXPECT_TRUE(file.Open(path, 4096));
+    for (size_t i = 0; i < file.size(); ++i) {
+      file.data()[i] = static_cast<uint8_t>(i * 31);
+    }
+  }
+  UnitCache cache;
+  EXPECT_TRUE(cache.Open(path, 16, kTtlMs));
+  EXPECT_EQ(cache.GetStats().entries, 0u);
+  double unit = 0;
+  EXPECT_TRUE(cache.Lookup("8806469007312", 0, &unit) ==
+              UnitCacheResult::kMiss);
+  EXPECT_TRUE(cache.Put("8806469007312", 3, 0));
+  cache.Close();
+  std::remove(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+  TestMissHitStale();
+  TestKeys();
+  TestGeneration();
+  TestPersistenceAndGrowth();
+  TestCorruptFileIsReset();
+  return TEST_RESULT();
+}
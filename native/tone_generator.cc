@@ -0,0 +1,82 @@
+#include "native/tone_generator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kFadeMs = 5;
+
+}  // namespace
+
+PcmBuffer RenderTone(int frequency, int duration_ms, int sample_rate,
+                     ToneWaveform waveform, double volume) {
+  const size_t count =
+      static_cast<size_t>(sample_rate) * static_cast<size_t>(duration_ms) /
+      1000;
+  const size_t fade = std::min<size_t>(
+      static_cast<size_t>(sample_rate) * kFadeMs / 1000, count / 2);
+  const double amplitude = 32767.0 * std::clamp(volume, 0.0, 1.0);
+  const double step = 2 * kPi * frequency / sample_rate;
+
+  PcmBuffer pcm(count);
+  for (size_t i = 0; i < count; ++i) {
+    double value = std::sin(step * static_cast<double>(i));
+    if (waveform == ToneWaveform::kSquare) {
+      value = value >= 0 ? 1.0 : -1.0;
+    }
+    double gain = 1.0;
+    if (i < fade) {
+      gain = static_cast<double>(i) / fade;
+    } else if (count - i <= fade) {
+      gain = static_cast<double>(count - i - 1) / fade;
+    }
+    pcm[i] = static_cast<int16_t>(std::lround(value * gain * amplitude));
+  }
+  return pcm;
+}
+
+ToneGenerator::Entry& ToneGenerator::FindLocked(const Key& key) {
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return lru_.front();
+  }
+  const auto [frequency, duration_ms, waveform] = key;
+  lru_.push_front(Entry{key,
+                        std::make_shared<const PcmBuffer>(RenderTone(
+                            frequency, duration_ms, sample_rate_, waveform)),
+                        nullptr});
+  index_.emplace(key, lru_.begin());
+  if (lru_.size() > kMaxTones) {
+    index_.erase(lru_.back().key);
+    lru_.pop_back();
+  }
+  return lru_.front();
+}
+
+std::shared_ptr<const PcmBuffer> ToneGenerator::Get(int frequency,
+                                                    int duration_ms,
+                                                    ToneWaveform waveform) {
+  const Key key(std::clamp(frequency, 37, 16000),
+                std::clamp(duration_ms, 1, 5000), waveform);
+  std::lock_guard<std::mutex> lock(mutex_);
+  return FindLocked(key).pcm;
+}
+
+std::shared_ptr<const std::string> ToneGenerator::GetWav(
+    int frequency, int duration_ms, ToneWaveform waveform) {
+  const Key key(std::clamp(frequency, 37, 16000),
+                std::clamp(duration_ms, 1, 5000), waveform);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = FindLocked(key);
+  if (entry.wav == nullptr) {
+    const PcmBuffer& pcm = *entry.pcm;
+    std::string wav = MakeWavHeader(sample_rate_, pcm.size());
+    wav.append(reinterpret_cast<const char*>(pcm.data()),
+               pcm.size() * sizeof(int16_t));
+    entry.wav = std::make_shared<const std::string>(std::move(wav));
+  }
+  return entry.wav;
+}
@@ -0,0 +1,75 @@
+#ifndef NATIVE_TONE_GENERATOR_H_
+#define NATIVE_TONE_GENERATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "native/audio_sink.h"
+
+enum class ToneWaveform : uint8_t {
+  kSine = 0,
+  kSquare = 1,
+};
+
+// Renders |duration_ms| of a tone with short fades at both ends, so that it
+// starts and stops without a click.
+PcmBuffer RenderTone(int frequency, int duration_ms, int sample_rate,
+                     ToneWaveform waveform = ToneWaveform::kSine,
+                     double volume = 0.5);
+
+// Beep tones for the TTS channel's "beep" method. The app uses a handful
+// of fixed (frequency, duration) pairs, so each is rendered once and then
+// shared; the kMaxTones most recently used are kept, so arbitrary
+// arguments from the channel cannot grow the cache. Thread-safe.
+class ToneGenerator {
+ public:
+  static constexpr size_t kMaxTones = 16;
+
+  explicit ToneGenerator(int sample_rate) : sample_rate_(sample_rate) {}
+
+  ToneGenerator(const ToneGenerator&) = delete;
+  ToneGenerator& operator=(const ToneGenerator&) = delete;
+
+  // |frequency| is clamped to 37..16000 Hz and |duration_ms| to 1..5000,
+  // matching what Win32 Beep() accepts in practice.
+  std::shared_ptr<const PcmBuffer> Get(
+      int frequency, int duration_ms,
+      ToneWaveform waveform = ToneWaveform::kSine);
+
+  // The same tone as a complete WAV file image, for players that take one
+  // (PlaySound on Windows). An evicted image stays valid while the caller
+  // holds it, so keep it until the sound has stopped.
+  std::shared_ptr<const std::string> GetWav(
+      int frequency, int duration_ms,
+      ToneWaveform waveform = ToneWaveform::kSine);
+
+  int sample_rate() const { return sample_rate_; }
+
+ private:
+  using Key = std::tuple<int, int, ToneWaveform>;
+
+  struct Entry {
+    Key key;
+    std::shared_ptr<const PcmBuffer> pcm;
+    // Built on the first GetWav
+    std::shared_ptr<const std::string> wav;
+  };
+
+  // Holds mutex_. Finds or renders the tone of the clamped |key| and moves
+  // it to the front.
+  Entry& FindLocked(const Key& key);
+
+  const int sample_rate_;
+  std::mutex mutex_;
+  // Most recently used at the front
+  std::list<Entry> lru_;
+  std::map<Key, std::list<Entry>::iterator> index_;
+};
+
+#endif  // NATIVE_TONE_GENERATOR_H_
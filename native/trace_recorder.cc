@@ -0,0 +1,237 @@
+#include "native/trace_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<uint64_t> next_recorder_serial{1};
+
+uint64_t CurrentThreadId() {
+#if defined(_WIN32)
+  return GetCurrentThreadId();
+#elif defined(__linux__)
+  return static_cast<uint64_t>(syscall(SYS_gettid));
+#else
+  return std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
+
+// The ring last used by this thread, and whose it is
+struct RingCache {
+  uint64_t recorder_serial = 0;
+  void* ring = nullptr;
+};
+thread_local RingCache ring_cache;
+
+void AppendEscaped(std::string* out, std::string_view text) {
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out->append(escaped);
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+}  // namespace
+
+struct TraceRecorder::ThreadRing {
+  explicit ThreadRing(size_t capacity)
+      : capacity(capacity), events(new TraceEvent[capacity]) {}
+
+  uint64_t thread_id = 0;
+  const size_t capacity;
+  std::unique_ptr<TraceEvent[]> events;
+  // Spans ever recorded; event i lives in events[i % capacity]
+  std::atomic<uint64_t> head{0};
+  // head + 1 while the writer fills a slot, head otherwise
+  std::atomic<uint64_t> writing{0};
+  // Spans before this index were cleared
+  std::atomic<uint64_t> floor{0};
+};
+
+TraceRecorder::TraceRecorder(size_t events_per_thread)
+    : events_per_thread_(std::max<size_t>(events_per_thread, 1)),
+      serial_(next_recorder_serial.fetch_add(1)) {}
+
+TraceRecorder::~TraceRecorder() = default;
+
+int64_t TraceRecorder::NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t TraceRecorder::NextScanId() {
+  static std::atomic<uint64_t> last{0};
+  const uint64_t now = static_cast<uint64_t>(NowNs());
+  uint64_t previous = last.load(std::memory_order_relaxed);
+  uint64_t id;
+  do {
+    id = std::max(now, previous + 1);
+  } while (!last.compare_exchange_weak(previous, id,
+                                       std::memory_order_relaxed));
+  return id;
+}
+
+TraceRecorder::ThreadRing* TraceRecorder::RingOfThisThread() {
+  if (ring_cache.recorder_serial == serial_) {
+    return static_cast<ThreadRing*>(ring_cache.ring);
+  }
+  const uint64_t thread_id = CurrentThreadId();
+  std::lock_guard<std::mutex> lock(mutex_);
+  ThreadRing* ring = nullptr;
+  // A ring left by an exited thread with the same id is taken over
+  for (const auto& candidate : rings_) {
+    if (candidate->thread_id == thread_id) {
+      ring = candidate.get();
+      break;
+    }
+  }
+  if (ring == nullptr) {
+    rings_.push_back(std::make_unique<ThreadRing>(events_per_thread_));
+    ring = rings_.back().get();
+    ring->thread_id = thread_id;
+  }
+  ring_cache.recorder_serial = serial_;
+  ring_cache.ring = ring;
+  return ring;
+}
+
+void TraceRecorder::Record(std::string_view name, uint64_t scan_id,
+                           int64_t begin_ns, int64_t end_ns) {
+  if (!enabled()) {
+    return;
+  }
+  ThreadRing* ring = RingOfThisThread();
+  const uint64_t head = ring->head.load(std::memory_order_relaxed);
+  ring->writing.store(head + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  TraceEvent& event = ring->events[head % ring->capacity];
+  const size_t length = std::min(name.size(), sizeof(event.name) - 1);
+  std::memcpy(event.name, name.data(), length);
+  event.name[length] = '\0';
+  event.scan_id = scan_id;
+  event.begin_ns = begin_ns;
+  event.end_ns = std::max(begin_ns, end_ns);
+  event.thread_id = ring->thread_id;
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+void TraceRecorder::SetThreadName(std::string_view name) {
+  const uint64_t thread_id = CurrentThreadId();
+  std::lock_guard<std::mutex> lock(mutex_);
+  thread_names_[thread_id].assign(name.data(), name.size());
+}
+
+std::vector<TraceEvent> TraceRecorder::Collect() const {
+  std::vector<TraceEvent> events;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& ring : rings_) {
+    const uint64_t capacity = ring->capacity;
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t begin = std::max(ring->floor.load(std::memory_order_relaxed),
+                              head > capacity ? head - capacity : 0);
+    const size_t first = events.size();
+    for (uint64_t i = begin; i < head; ++i) {
+      events.push_back(ring->events[i % capacity]);
+    }
+    // Slots the writer reused while they were copied, including one it
+    // may be filling now, held older spans
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t after = ring->writing.load(std::memory_order_relaxed);
+    const uint64_t valid = after > capacity ? after - capacity : 0;
+    if (valid > begin) {
+      const size_t stale =
+          static_cast<size_t>(std::min<uint64_t>(valid - begin, head - begin));
+      events.erase(events.begin() + first, events.begin() + first + stale);
+    }
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TraceEvent& a, const TraceEvent& b) {
+                     return a.begin_ns < b.begin_ns;
+                   });
+  return events;
+}
+
+void TraceRecorder::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& ring : rings_) {
+    ring->floor.store(ring->head.load(std::memory_order_acquire),
+                      std::memory_order_relaxed);
+  }
+}
+
+std::string TraceRecorder::ChromeEvents() const {
+  std::string out;
+  char number[96];
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : thread_names_) {
+      if (!out.empty()) {
+        out.push_back(',');
+      }
+      std::snprintf(number, sizeof(number),
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                    "\"tid\":%llu,\"args\":{\"name\":\"",
+                    static_cast<unsigned long long>(entry.first));
+      out.append(number);
+      AppendEscaped(&out, entry.second);
+      out.append("\"}}");
+    }
+  }
+  for (const TraceEvent& event : Collect()) {
+    if (!out.empty()) {
+      out.push_back(',');
+    }
+    out.append("{\"name\":\"");
+    AppendEscaped(&out, event.name);
+    std::snprintf(number, sizeof(number),
+                  "\",\"cat\":\"scan\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                  "\"pid\":1,\"tid\":%llu",
+                  event.begin_ns / 1000.0,
+                  (event.end_ns - event.begin_ns) / 1000.0,
+                  static_cast<unsigned long long>(event.thread_id));
+    out.append(number);
+    if (event.scan_id != 0) {
+      std::snprintf(number, sizeof(number), ",\"args\":{\"scan\":%llu}",
+                    static_cast<unsigned long long>(event.scan_id));
+      out.append(number);
+    }
+    out.push_back('}');
+  }
+  return out;
+}
+
+std::string TraceRecorder::ToChromeJson(std::string_view extra_events) const {
+  std::string events = ChromeEvents();
+  if (!extra_events.empty()) {
+    if (!events.empty()) {
+      events.push_back(',');
+    }
+    events.append(extra_events.data(), extra_events.size());
+  }
+  return "{\"traceEvents\":[" + events + "],\"displayTimeUnit\":\"ms\"}";
+}
+
+TraceRecorder& ProcessTraceRecorder() {
+  static TraceRecorder* recorder = new TraceRecorder();
+  return *recorder;
+}
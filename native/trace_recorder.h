@@ -0,0 +1,124 @@
+#ifndef NATIVE_TRACE_RECORDER_H_
+#define NATIVE_TRACE_RECORDER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One finished span. Times are steady-clock nanoseconds, the same clock in
+// every copy of this library in the process, so spans recorded by the
+// runner and by the FFI library line up.
+struct TraceEvent {
+  // Truncated and NUL-terminated
+  char name[40];
+  // The scan the span belongs to; 0 if none
+  uint64_t scan_id;
+  int64_t begin_ns;
+  int64_t end_ns;
+  // Operating-system thread id
+  uint64_t thread_id;
+};
+
+// Where the time of each scan goes, from the first serial byte to the UI
+// update, as spans that open in chrome://tracing or Perfetto.
+//
+// Each recording thread owns a ring of the last |events_per_thread| spans.
+// Recording stores into it and publishes with one release store: no lock
+// and no allocation after the thread's first span. While disabled,
+// Record() is a single relaxed load.
+//
+// Collect() and the dumps may run while other threads record; spans that
+// were overwritten during the copy are left out.
+class TraceRecorder {
+ public:
+  explicit TraceRecorder(size_t events_per_thread = 4096);
+  ~TraceRecorder();
+
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  void SetEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Steady clock now, in the unit of TraceEvent
+  static int64_t NowNs();
+
+  // A new scan id: increasing, and unique across the copies of this
+  // library in the process (it is based on the clock).
+  static uint64_t NextScanId();
+
+  // Records a span of the calling thread. Does nothing while disabled.
+  void Record(std::string_view name, uint64_t scan_id, int64_t begin_ns,
+              int64_t end_ns);
+
+  // Names the calling thread in the dump ("serial", "dart:ui", ...). Does
+  // not allocate its ring.
+  void SetThreadName(std::string_view name);
+
+  // Spans of every thread, oldest first
+  std::vector<TraceEvent> Collect() const;
+
+  // Forgets the spans recorded so far.
+  void Clear();
+
+  // The spans and thread names as comma-separated trace event objects,
+  // to be merged into another recorder's dump.
+  std::string ChromeEvents() const;
+
+  // {"traceEvents":[...],"displayTimeUnit":"ms"}, with |extra_events|
+  // (ChromeEvents() of another recorder) merged in.
+  std::string ToChromeJson(std::string_view extra_events = {}) const;
+
+ private:
+  struct ThreadRing;
+
+  ThreadRing* RingOfThisThread();
+
+  const size_t events_per_thread_;
+  // Tells apart recorders that reuse the address of a destroyed one
+  const uint64_t serial_;
+  std::atomic<bool> enabled_{false};
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<ThreadRing>> rings_;
+  std::map<uint64_t, std::string> thread_names_;
+};
+
+// The recorder of this process (of this copy of the library)
+TraceRecorder& ProcessTraceRecorder();
+
+// Records the lifetime of a scope into ProcessTraceRecorder().
+//
+//   TraceSpan span("serial.frame", scan_id);
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name, uint64_t scan_id = 0)
+      : name_(name),
+        scan_id_(scan_id),
+        begin_ns_(ProcessTraceRecorder().enabled() ? TraceRecorder::NowNs()
+                                                   : 0) {}
+  ~TraceSpan() {
+    if (begin_ns_ != 0) {
+      ProcessTraceRecorder().Record(name_, scan_id_, begin_ns_,
+                                    TraceRecorder::NowNs());
+    }
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  const char* name_;
+  uint64_t scan_id_;
+  int64_t begin_ns_;
+};
+
+#endif  // NATIVE_TRACE_RECORDER_H_
@@ -0,0 +1,237 @@
+#include "native/unit_cache.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kMagic = 0x43555050;  // "PPUC"
+constexpr uint32_t kFormatVersion = 1;
+constexpr size_t kMinCapacity = 64;
+constexpr size_t kMaxDigits = 14;
+
+size_t RoundUpPowerOfTwo(size_t value) {
+  size_t result = kMinCapacity;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+size_t HashKey(uint64_t key) {
+  // splitmix64 finalizer, as in RecipeIndex.
+  key ^= key >> 30;
+  key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 27;
+  key *= 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+  return static_cast<size_t>(key);
+}
+
+}  // namespace
+
+// On-disk layout. Both structs are plain data with fixed-width fields, so the
+// file is valid across runs of the same architecture; the magic and format
+// version reject anything else.
+struct UnitCache::Header {
+  uint32_t magic;
+  uint32_t format_version;
+  uint32_t capacity;
+  uint32_t count;
+  uint32_t generation;
+  uint32_t reserved[11];
+};
+
+struct UnitCache::Record {
+  // 0 marks an empty slot; written last when a record is inserted
+  uint64_t key;
+  double unit;
+  int64_t fetched_ms;
+  uint32_t generation;
+  uint32_t reserved;
+};
+
+UnitCache::UnitCache() : ttl_ms_(0) {
+  static_assert(sizeof(Header) == 64, "header layout");
+  static_assert(sizeof(Record) == 32, "record layout");
+}
+
+UnitCache::~UnitCache() { Close(); }
+
+uint64_t UnitCache::MakeKey(std::string_view barcode) {
+  if (barcode.empty() || barcode.size() > kMaxDigits) {
+    return 0;
+  }
+  uint64_t value = 0;
+  for (char c : barcode) {
+    const unsigned digit = static_cast<unsigned char>(c) - '0';
+    if (digit > 9) {
+      return 0;
+    }
+    value = value * 10 + digit;
+  }
+  // The length keeps "0123" and "123" apart; +1 keeps every key non-zero.
+  return ((value << 4) | barcode.size()) + 1;
+}
+
+UnitCache::Header* UnitCache::header() {
+  return reinterpret_cast<Header*>(file_.data());
+}
+
+UnitCache::Record* UnitCache::records() {
+  return reinterpret_cast<Record*>(file_.data() + sizeof(Header));
+}
+
+void UnitCache::Initialize(size_t capacity) {
+  std::memset(file_.data(), 0, file_.size());
+  Header* h = header();
+  h->magic = kMagic;
+  h->format_version = kFormatVersion;
+  h->capacity = static_cast<uint32_t>(capacity);
+}
+
+bool UnitCache::Open(const std::string& path, size_t initial_capacity,
+                     int64_t ttl_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  file_.Close();
+  stats_ = UnitCacheStats();
+  ttl_ms_ = ttl_ms;
+
+  const size_t capacity = RoundUpPowerOfTwo(initial_capacity);
+  const size_t fresh_size = sizeof(Header) + capacity * sizeof(Record);
+  if (!file_.Open(path, sizeof(Header))) {
+    return false;
+  }
+
+  const Header* h = header();
+  const bool valid =
+      h->magic == kMagic && h->format_version == kFormatVersion &&
+      h->capacity >= kMinCapacity && (h->capacity & (h->capacity - 1)) == 0 &&
+      file_.size() >= sizeof(Header) + h->capacity * sizeof(Record) &&
+      h->count < h->capacity;
+  if (!valid) {
+    // New, truncated or foreign file: start over.
+    if (!file_.Resize(fresh_size)) {
+      file_.Close();
+      return false;
+    }
+    Initialize(capacity);
+  }
+  file_.Prefetch();
+  return true;
+}
+
+void UnitCache::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_.IsOpen()) {
+    file_.Sync(false);
+  }
+  file_.Close();
+}
+
+bool UnitCache::IsOpen() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_.IsOpen();
+}
+
+UnitCache::Record* UnitCache::FindSlot(uint64_t key) {
+  const size_t mask = header()->capacity - 1;
+  Record* table = records();
+  for (size_t i = HashKey(key) & mask;; i = (i + 1) & mask) {
+    if (table[i].key == key || table[i].key == 0) {
+      return &table[i];
+    }
+  }
+}
+
+UnitCacheResult UnitCache::Lookup(std::string_view barcode, int64_t now_ms,
+                                  double* unit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t key = MakeKey(barcode);
+  if (!file_.IsOpen() || key == 0) {
+    ++stats_.misses;
+    return UnitCacheResult::kMiss;
+  }
+  const Record* record = FindSlot(key);
+  if (record->key == 0) {
+    ++stats_.misses;
+    return UnitCacheResult::kMiss;
+  }
+  *unit = record->unit;
+  if (record->generation != header()->generation ||
+      now_ms - record->fetched_ms > ttl_ms_ || now_ms < record->fetched_ms) {
+    ++stats_.stale;
+    return UnitCacheResult::kStale;
+  }
+  ++stats_.hits;
+  return UnitCacheResult::kHit;
+}
+
+bool UnitCache::Put(std::string_view barcode, double unit, int64_t now_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t key = MakeKey(barcode);
+  if (!file_.IsOpen() || key == 0) {
+    return false;
+  }
+  Record* record = FindSlot(key);
+  if (record->key == 0) {
+    // Keep the load factor under 1/2 so probes stay short.
+    if ((header()->count + 1) * 2 > header()->capacity) {
+      if (!Grow()) {
+        return false;
+      }
+      record = FindSlot(key);
+    }
+    ++header()->count;
+  }
+  record->unit = unit;
+  record->fetched_ms = now_ms;
+  record->generation = header()->generation;
+  record->key = key;
+  ++stats_.puts;
+  return true;
+}
+
+bool UnitCache::Grow() {
+  const Header old_header = *header();
+  std::vector<Record> old(records(), records() + old_header.capacity);
+
+  const size_t capacity = static_cast<size_t>(old_header.capacity) * 2;
+  if (capacity > UINT32_MAX ||
+      !file_.Resize(sizeof(Header) + capacity * sizeof(Record))) {
+    return false;
+  }
+  Initialize(capacity);
+  header()->generation = old_header.generation;
+  for (const Record& record : old) {
+    if (record.key != 0) {
+      *FindSlot(record.key) = record;
+      ++header()->count;
+    }
+  }
+  return true;
+}
+
+void UnitCache::SetGeneration(uint32_t generation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_.IsOpen()) {
+    header()->generation = generation;
+  }
+}
+
+bool UnitCache::Flush(bool wait) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_.Sync(wait);
+}
+
+UnitCacheStats UnitCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  UnitCacheStats stats = stats_;
+  if (file_.IsOpen()) {
+    const Header* h = reinterpret_cast<const Header*>(file_.data());
+    stats.entries = h->count;
+    stats.capacity = h->capacity;
+    stats.generation = h->generation;
+  }
+  return stats;
+}
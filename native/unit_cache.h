@@ -0,0 +1,97 @@
+#ifndef NATIVE_UNIT_CACHE_H_
+#define NATIVE_UNIT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "native/mapped_file.h"
+
+// Result of a UnitCache lookup.
+enum class UnitCacheResult : int32_t {
+  // Not cached; ask the server
+  kMiss = 0,
+  // Cached and fresh
+  kHit = 1,
+  // Cached but older than the TTL or from an older generation; the value is
+  // still returned so the caller can use it while it refreshes
+  kStale = 2,
+};
+
+// Counters since Open().
+struct UnitCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t stale = 0;
+  uint64_t puts = 0;
+  uint64_t entries = 0;
+  uint64_t capacity = 0;
+  uint32_t generation = 0;
+};
+
+// Persistent pack barcode -> pack unit cache for get_unit_from_pack_barcode.
+//
+// The table lives in a memory-mapped file: a small header followed by an
+// open-addressing array of fixed-size records keyed on the numeric barcode,
+// so a restart finds every unit it ever fetched without parsing anything.
+// Each record remembers when it was fetched and under which generation;
+// bumping the generation (SetGeneration) turns every older record stale at
+// once, e.g. when the server's unit table changes.
+//
+// Barcodes must be numeric and at most 14 digits (GTIN-14); anything else is
+// never cached. All methods are thread-safe.
+class UnitCache {
+ public:
+  UnitCache();
+  ~UnitCache();
+
+  UnitCache(const UnitCache&) = delete;
+  UnitCache& operator=(const UnitCache&) = delete;
+
+  // Maps |path|, creating it with room for |initial_capacity| entries if it
+  // does not exist or is not a valid cache file, and prefetches it. Records
+  // older than |ttl_ms| are reported as stale.
+  bool Open(const std::string& path, size_t initial_capacity, int64_t ttl_ms);
+  void Close();
+  bool IsOpen() const;
+
+  // Looks up |barcode| at time |now_ms| (milliseconds, any epoch the caller
+  // uses consistently). On kHit and kStale, |*unit| receives the value.
+  UnitCacheResult Lookup(std::string_view barcode, int64_t now_ms,
+                         double* unit);
+
+  // Stores the unit fetched from the server at |now_ms| under the current
+  // generation. Returns false if |barcode| is not cacheable.
+  bool Put(std::string_view barcode, double unit, int64_t now_ms);
+
+  // Sets the current generation. Records written under another generation
+  // become stale.
+  void SetGeneration(uint32_t generation);
+
+  // Flushes the mapping to disk.
+  bool Flush(bool wait);
+
+  UnitCacheStats GetStats() const;
+
+  // Table key of |barcode|, or 0 if it is not cacheable.
+  static uint64_t MakeKey(std::string_view barcode);
+
+ private:
+  struct Header;
+  struct Record;
+
+  Header* header();
+  Record* records();
+  Record* FindSlot(uint64_t key);
+  bool Grow();
+  void Initialize(size_t capacity);
+
+  mutable std::mutex mutex_;
+  MappedFile file_;
+  int64_t ttl_ms_;
+  UnitCacheStats stats_;
+};
+
+#endif  // NATIVE_UNIT_CACHE_H_
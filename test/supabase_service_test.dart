@@ -0,0 +1,99 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:http/http.dart' show ClientException;
+import 'package:pharm_parrot_flutter/services/supabase_service.dart';
+import 'package:supabase_flutter/supabase_flutter.dart';
+
+const _write = 'update_checked_amount_and_packserial';
+const _read = 'select_rxrecipe_by_textfile_number';
+
+Uint8List _bytes(String text) => Uint8List.fromList(utf8.encode(text));
+
+void main() {
+  group('failedBeforeSending', () {
+    test('connect refused and DNS failures were never sent', () {
+      expect(
+          SupabaseService.failedBeforeSending(SocketException('connect',
+              osError: const OSError('Connection refused', 111))),
+          isTrue);
+      expect(
+          SupabaseService.failedBeforeSending(ClientException(
+              'Failed host lookup: \'db.local\'', Uri.parse('http://db'))),
+          isTrue);
+      expect(
+          SupabaseService.failedBeforeSending(
+              PlatformException(code: 'RPC_FAILED', message: 'connect')),
+          isTrue);
+    });
+
+    test('anything after the request may have gone out is not', () {
+      for (final error in <Object>[
+        SocketException('read',
+            osError: const OSError('Connection reset by peer', 104)),
+        ClientException('Connection closed before full header was received'),
+        TimeoutException('slow'),
+        PlatformException(code: 'RPC_OUTCOME_UNKNOWN', message: 'timeout'),
+        PlatformException(code: 'SOMETHING_ELSE'),
+        const FormatException('bad json'),
+      ]) {
+        expect(SupabaseService.failedBeforeSending(error), isFalse,
+            reason: '$error');
+      }
+    });
+  });
+
+  group('decodeReply', () {
+    test('decodes a 2xx body', () async {
+      expect(
+          await SupabaseService.decodeReply(
+              _write, RpcPolicy.write, 200, _bytes('3')),
+          3);
+      expect(
+          await SupabaseService.decodeReply(
+              _write, RpcPolicy.write, 204, Uint8List(0)),
+          isNull);
+    });
+
+    test('an unreadable 2xx write reply is an unknown outcome', () {
+      expect(
+          SupabaseService.decodeReply(
+              _write, RpcPolicy.write, 200, _bytes('<html>')),
+          throwsA(isA<RpcOutcomeUnknown>()));
+      expect(
+          SupabaseService.decodeReply(
+              _read, RpcPolicy.read, 200, _bytes('<html>')),
+          throwsA(isA<FormatException>()));
+    });
+
+    test('a 1xx/3xx write reply is an unknown outcome', () {
+      for (final status in [101, 302]) {
+        expect(
+            SupabaseService.decodeReply(
+                _write, RpcPolicy.write, status, Uint8List(0)),
+            throwsA(isA<RpcOutcomeUnknown>()));
+      }
+      expect(
+          SupabaseService.decodeReply(
+              _read, RpcPolicy.read, 302, Uint8List(0)),
+          throwsA(isA<PostgrestException>()));
+    });
+
+    test('4xx/5xx are server errors with their code', () {
+      expect(
+          SupabaseService.decodeReply(_write, RpcPolicy.write, 400,
+              _bytes('{"code": "P0001", "message": "no such row"}')),
+          throwsA(isA<PostgrestException>()
+              .having((e) => e.code, 'code', 'P0001')));
+      expect(
+          SupabaseService.decodeReply(
+              _write, RpcPolicy.write, 502, _bytes('Bad Gateway')),
+          throwsA(isA<PostgrestException>()
+              .having((e) => e.code, 'code', '502')));
+    });
+  });
+}
@@ -1,8 +1,21 @@
 #include "com_port_handler.h"
 #include <sstream>
 
+namespace {
+
+// Default line queue size: far more than a burst of tray scans.
+constexpr size_t kDefaultQueueCapacity = 256;
+
+}  // namespace
+
 ComPortHandler::ComPortHandler()
-    : port_handle_(INVALID_HANDLE_VALUE), should_stop_(false) {}
+    : port_handle_(INVALID_HANDLE_VALUE),
+      should_stop_(false),
+      queue_capacity_(kDefaultQueueCapacity),
+      overflow_policy_(OverflowPolicy::kDropOldest) {
+  line_ring_ = std::make_shared<SpscRing<std::string>>(queue_capacity_,
+                                                       overflow_policy_);
+}
 
 ComPortHandler::~ComPortHandler() { CloseComPort(); }
 
@@ -75,6 +88,12 @@ bool ComPortHandler::OpenComPort(int port_number, DWORD baud_rate) {
     return false;
   }
 
+  // Fresh queue and framer with the current options; the read thread is
+  // not running
+  std::atomic_store(&line_ring_, std::make_shared<SpscRing<std::string>>(
+                                    queue_capacity_, overflow_policy_));
+  framer_ = LineFramer(framer_options_);
+
   // Start read thread
   should_stop_ = false;
   read_thread_ = std::thread(&ComPortHandler::ReadThreadProc, this);
@@ -109,61 +128,45 @@ bool ComPortHandler::WriteData(const std::string& data) {
   return bytes_written == static_cast<DWORD>(data.length());
 }
 
-std::string ComPortHandler::ReadData() {
-  std::lock_guard<std::mutex> lock(queue_mutex_);
+std::string ComPortHandler::ReadData() { return GetLineData(); }
 
-  if (data_queue_.empty()) {
+std::string ComPortHandler::GetLineData() {
+  std::string data;
+  if (!ring()->Pop(&data)) {
     return "";
   }
-
-  std::string data = data_queue_.front();
-  data_queue_.pop();
   return data;
 }
 
-std::string ComPortHandler::GetLineData() {
-  std::lock_guard<std::mutex> lock(queue_mutex_);
-
-  if (data_queue_.empty()) {
-    return "";
-  }
+void ComPortHandler::SetQueueOptions(size_t capacity, OverflowPolicy policy) {
+  queue_capacity_ = capacity > 0 ? capacity : kDefaultQueueCapacity;
+  overflow_policy_ = policy;
+}
 
-  std::string data = data_queue_.front();
-  data_queue_.pop();
-  return data;
+void ComPortHandler::SetFramerOptions(LineFramerOptions options) {
+  framer_options_ = std::move(options);
 }
 
 void ComPortHandler::ReadThreadProc() {
-  unsigned char buffer[1024];
+  char buffer[4096];
   DWORD bytes_read = 0;
 
   while (!should_stop_) {
     // Read data from port
     if (ReadFile(port_handle_, buffer, sizeof(buffer), &bytes_read, NULL)) {
       if (bytes_read > 0) {
-        std::string data(reinterpret_cast<char*>(buffer), bytes_read);
-
-        // Process line by line
-        for (char c : data) {
-          partial_line_ += c;
-
-          // Detect newline character
-          if (c == '\n' || c == '\r') {
-            if (!partial_line_.empty()) {
-              // Remove newline characters
-              std::string line = partial_line_;
-              line.erase(
-                  std::remove_if(line.begin(), line.end(),
-                                 [](char ch) { return ch == '\r' || ch == '\n'; }),
-                  line.end());
-
-              if (!line.empty()) {
-                std::lock_guard<std::mutex> lock(queue_mutex_);
-                data_queue_.push(line);
-              }
-            }
-            partial_line_.clear();
-          }
+        bool queued = false;
+
+        // Frames are views into |buffer|; the ring copies them into its
+        // recycled slot strings.
+        framer_.Feed(buffer, bytes_read, [this, &queued](std::string_view line) {
+          line_ring_->Push(line);
+          queued = true;
+        });
+
+        // Wake the consumer once per read instead of once per line
+        if (queued && data_available_callback_) {
+          data_available_callback_();
         }
       }
     } else {
@@ -2,11 +2,16 @@
 #define RUNNER_COM_PORT_HANDLER_H_
 
 #include <windows.h>
+#include <functional>
+#include <memory>
 #include <string>
-#include <queue>
 #include <thread>
-#include <mutex>
 
+#include "native/line_framer.h"
+#include "native/spsc_ring.h"
+
+// Open, close and write run on the executor's "comport" strand; the line
+// queue is read on the platform thread.
 class ComPortHandler {
  public:
   ComPortHandler();
@@ -30,18 +35,44 @@ class ComPortHandler {
   // Get line data from queue
   std::string GetLineData();
 
+  // Size and overflow policy of the line queue; applied on the next open
+  void SetQueueOptions(size_t capacity, OverflowPolicy policy);
+
+  // How incoming bytes are cut into lines; applied on the next open
+  void SetFramerOptions(LineFramerOptions options);
+
+  // Line queue counters (drops, high-water mark, latency)
+  SpscRingStats GetQueueStats() const { return ring()->GetStats(); }
+  OverflowPolicy queue_policy() const { return ring()->policy(); }
+
+  // Called on the read thread whenever new lines were queued. Set it before
+  // opening the port.
+  void SetDataAvailableCallback(std::function<void()> callback) {
+    data_available_callback_ = std::move(callback);
+  }
+
  private:
   HANDLE port_handle_;
   std::thread read_thread_;
   bool should_stop_;
-  std::queue<std::string> data_queue_;
-  std::mutex queue_mutex_;
+
+  // Lines travel from the read thread (producer) to the platform thread
+  // (consumer) through a bounded lock-free ring. Opening the port replaces
+  // the ring on another thread, so the consumer side loads it atomically.
+  std::shared_ptr<SpscRing<std::string>> line_ring_;
+  std::shared_ptr<SpscRing<std::string>> ring() const {
+    return std::atomic_load(&line_ring_);
+  }
+  size_t queue_capacity_;
+  OverflowPolicy overflow_policy_;
+  std::function<void()> data_available_callback_;
 
   // Thread procedure for reading
   void ReadThreadProc();
 
-  // Partial line data waiting for newline
-  std::string partial_line_;
+  // Splits reads into lines; only touched by the read thread while open
+  LineFramerOptions framer_options_;
+  LineFramer framer_;
 };
 
 #endif  // RUNNER_COM_PORT_HANDLER_H_
@@ -1,5 +1,6 @@
 #include "flutter_window.h"
 
+#include <mmsystem.h>
 #include <optional>
 #pragma warning(push)
 #pragma warning(disable: 4996)
@@ -7,26 +8,59 @@
 #include <sphelper.h>
 #pragma warning(pop)
 
+#include "flutter/event_stream_handler_functions.h"
 #include "flutter/generated_plugin_registrant.h"
 #include "flutter/method_channel.h"
 #include "flutter/standard_method_codec.h"
 
+namespace {
+
+// Posted by the COM Port read thread when new lines are queued.
+constexpr UINT kComPortDataMessage = WM_APP + 1;
+
+// Posted by executor threads when an answer is ready for the platform thread.
+constexpr UINT kTaskCompletionMessage = WM_APP + 2;
+
+flutter::EncodableValue Int64Value(uint64_t value) {
+  return flutter::EncodableValue(static_cast<int64_t>(value));
+}
+
+flutter::EncodableMap TaskQueueStatsMap(const TaskQueueStats& stats) {
+  return {
+      {flutter::EncodableValue("posted"), Int64Value(stats.posted)},
+      {flutter::EncodableValue("executed"), Int64Value(stats.executed)},
+      {flutter::EncodableValue("cancelled"), Int64Value(stats.cancelled)},
+      {flutter::EncodableValue("pending"), Int64Value(stats.pending)},
+      {flutter::EncodableValue("avgQueueUs"), Int64Value(stats.executed > 0 ? stats.total_queue_us / stats.executed : 0)},
+      {flutter::EncodableValue("maxQueueUs"), Int64Value(stats.max_queue_us)},
+      {flutter::EncodableValue("avgRunUs"), Int64Value(stats.executed > 0 ? stats.total_run_us / stats.executed : 0)},
+      {flutter::EncodableValue("maxRunUs"), Int64Value(stats.max_run_us)},
+  };
+}
+
+}  // namespace
+
 FlutterWindow::FlutterWindow(const flutter::DartProject& project)
     : project_(project) {
-  // Initialize COM and create TTS voice
+  // Initialize COM
   CoInitialize(nullptr);
-  CoCreateInstance(CLSID_SpVoice, nullptr, CLSCTX_ALL, IID_ISpVoice, (void**)&tts_voice_);
   
   // Initialize COM Port handler
   com_port_handler_ = std::make_unique<ComPortHandler>();
+
+  // Workers join the multithreaded apartment so SAPI can be used from
+  // whichever of them runs the "tts" strand.
+  TaskExecutorOptions options;
+  options.threads = 2;
+  options.on_thread_start = [] { CoInitializeEx(nullptr, COINIT_MULTITHREADED); };
+  options.on_thread_exit = [] { CoUninitialize(); };
+  executor_ = std::make_unique<TaskExecutor>(std::move(options));
+  main_queue_ = std::make_unique<MainThreadQueue>([this]() {
+    PostMessage(GetHandle(), kTaskCompletionMessage, 0, 0);
+  });
 }
 
 FlutterWindow::~FlutterWindow() {
-  // Release TTS voice
-  if (tts_voice_) {
-    tts_voice_->Release();
-    tts_voice_ = nullptr;
-  }
   CoUninitialize();
 }
 
@@ -55,6 +89,10 @@ bool FlutterWindow::OnCreate() {
   
   // Setup COM Port platform channel
   SetupComPortChannel();
+  SetupComPortEventChannel();
+
+  // Setup executor stats channel
+  SetupExecutorChannel();
   
   SetChildContent(flutter_controller_->view()->GetNativeWindow());
 
@@ -71,6 +109,25 @@ bool FlutterWindow::OnCreate() {
 }
 
 void FlutterWindow::OnDestroy() {
+  // Drop waiting work, release the voice and the beep on their strand and
+  // answer every outstanding call while the engine is still there.
+  if (executor_) {
+    executor_->CancelStrand("comport");
+    executor_->CancelStrand("tts");
+    executor_->Post("tts", [this]() {
+      if (tts_voice_) {
+        tts_voice_->Release();
+        tts_voice_ = nullptr;
+      }
+      // Stop a beep before its image is freed
+      PlaySoundA(nullptr, nullptr, 0);
+      playing_beep_ = nullptr;
+    });
+    executor_->WaitIdle();
+    executor_ = nullptr;
+    main_queue_->Drain();
+  }
+  comport_event_sink_ = nullptr;
   if (flutter_controller_) {
     flutter_controller_ = nullptr;
   }
@@ -96,6 +153,13 @@ FlutterWindow::MessageHandler(HWND hwnd, UINT const message,
     case WM_FONTCHANGE:
       flutter_controller_->engine()->ReloadSystemFonts();
       break;
+    case kComPortDataMessage:
+      comport_notify_pending_ = false;
+      DeliverComPortLines();
+      return 0;
+    case kTaskCompletionMessage:
+      main_queue_->Drain();
+      return 0;
   }
 
   return Win32Window::MessageHandler(hwnd, message, wparam, lparam);
@@ -110,29 +174,27 @@ void FlutterWindow::SetupTtsChannel() {
   channel->SetMethodCallHandler(
       [this](const flutter::MethodCall<flutter::EncodableValue>& call,
          std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+        MainThreadQueue::BusyScope busy(main_queue_.get());
         if (call.method_name() == "speak") {
           const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
           if (arguments) {
             auto text_it = arguments->find(flutter::EncodableValue("text"));
             if (text_it != arguments->end()) {
               std::string text = std::get<std::string>(text_it->second);
-              
-              if (tts_voice_) {
+              RunOnStrand("tts", std::move(result), [this, text]() {
+                if (!EnsureTtsVoice()) {
+                  return ChannelReply::Error("TTS_ERROR", "TTS voice not initialized");
+                }
                 // UTF-8 to Wide String conversion
                 int wchars_num = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, nullptr, 0);
-                wchar_t* wstr = new wchar_t[wchars_num];
-                MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, wstr, wchars_num);
-                
+                std::wstring wstr(wchars_num, L'\0');
+                MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, wstr.data(), wchars_num);
+
                 // Use SPF_ASYNC for non-blocking speech
                 // The global tts_voice_ persists so audio won't be cut off
-                tts_voice_->Speak(wstr, SPF_ASYNC | SPF_PURGEBEFORESPEAK, nullptr);
-                
-                delete[] wstr;
-                result->Success();
-              } else {
-                result->Error("TTS_ERROR", "TTS voice not initialized");
-              }
-              
+                tts_voice_->Speak(wstr.c_str(), SPF_ASYNC | SPF_PURGEBEFORESPEAK, nullptr);
+                return ChannelReply::Success();
+              });
               return;
             }
           }
@@ -147,13 +209,32 @@ void FlutterWindow::SetupTtsChannel() {
               int frequency = std::get<int>(freq_it->second);
               int duration = std::get<int>(dur_it->second);
               
-              // Windows Beep API
-              Beep(frequency, duration);
-              result->Success();
+              // Beep() blocks the platform thread for the whole tone;
+              // PlaySound returns at once and mixes with the voice. On the
+              // "tts" strand it stays in order with speech.
+              RunOnStrand("tts", std::move(result), [this, frequency, duration]() {
+                std::shared_ptr<const std::string> wav =
+                    tone_generator_.GetWav(frequency, duration);
+                PlaySoundA(wav->data(), nullptr,
+                           SND_MEMORY | SND_ASYNC | SND_NODEFAULT);
+                // PlaySound stopped the previous beep, so its image can go
+                playing_beep_ = std::move(wav);
+                return ChannelReply::Success();
+              });
               return;
             }
           }
           result->Error("INVALID_ARGUMENT", "Frequency and duration required");
+        } else if (call.method_name() == "stop") {
+          // Speech that has not started yet is dropped, then purging with
+          // no text stops the current utterance
+          executor_->CancelStrand("tts");
+          RunOnStrand("tts", std::move(result), [this]() {
+            if (tts_voice_) {
+              tts_voice_->Speak(nullptr, SPF_ASYNC | SPF_PURGEBEFORESPEAK, nullptr);
+            }
+            return ChannelReply::Success();
+          });
         } else {
           result->NotImplemented();
         }
@@ -169,6 +250,8 @@ void FlutterWindow::SetupWindowChannel() {
   channel->SetMethodCallHandler(
       [this](const flutter::MethodCall<flutter::EncodableValue>& call,
          std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+        // Window calls stay on the platform thread, which owns the window.
+        MainThreadQueue::BusyScope busy(main_queue_.get());
         if (call.method_name() == "setWindowGeometry") {
           const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
           if (arguments) {
@@ -211,6 +294,7 @@ void FlutterWindow::SetupComPortChannel() {
   channel->SetMethodCallHandler(
       [this](const flutter::MethodCall<flutter::EncodableValue>& call,
          std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+        MainThreadQueue::BusyScope busy(main_queue_.get());
         if (call.method_name() == "openComPort") {
           const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
           if (arguments) {
@@ -220,27 +304,92 @@ void FlutterWindow::SetupComPortChannel() {
             if (port_it != arguments->end() && baud_it != arguments->end()) {
               int port_number = std::get<int>(port_it->second);
               int baud_rate = std::get<int>(baud_it->second);
-              
-              bool success = com_port_handler_->OpenComPort(port_number, baud_rate);
-              result->Success(success);
+
+              // Optional line queue options
+              size_t capacity = 0;
+              OverflowPolicy policy = com_port_handler_->queue_policy();
+              auto capacity_it = arguments->find(flutter::EncodableValue("queueCapacity"));
+              if (capacity_it != arguments->end()) {
+                if (const auto* value = std::get_if<int>(&capacity_it->second)) {
+                  capacity = static_cast<size_t>(*value > 0 ? *value : 0);
+                }
+              }
+              auto policy_it = arguments->find(flutter::EncodableValue("overflowPolicy"));
+              if (policy_it != arguments->end()) {
+                if (const auto* name = std::get_if<std::string>(&policy_it->second)) {
+                  ParseOverflowPolicy(*name, &policy);
+                }
+              }
+
+              // Optional framing: a terminator such as "\r\n" or "\x03",
+              // and a prefix such as "\x02". Default: any CR or LF.
+              LineFramerOptions framing;
+              auto terminator_it = arguments->find(flutter::EncodableValue("terminator"));
+              if (terminator_it != arguments->end()) {
+                if (const auto* value = std::get_if<std::string>(&terminator_it->second)) {
+                  framing.terminator = *value;
+                }
+              }
+              auto prefix_it = arguments->find(flutter::EncodableValue("prefix"));
+              if (prefix_it != arguments->end()) {
+                if (const auto* value = std::get_if<std::string>(&prefix_it->second)) {
+                  framing.prefix = *value;
+                }
+              }
+
+              // Opening joins a previous read thread and configures the
+              // device, so it runs on the "comport" strand.
+              RunOnStrand(
+                  "comport", std::move(result),
+                  [this, port_number, baud_rate, capacity, policy, framing]() {
+                    com_port_handler_->SetQueueOptions(capacity, policy);
+                    com_port_handler_->SetFramerOptions(framing);
+                    bool success = com_port_handler_->OpenComPort(port_number, baud_rate);
+                    return ChannelReply::Success(flutter::EncodableValue(success));
+                  });
               return;
             }
           }
           result->Error("INVALID_ARGUMENT", "Port number and baud rate required");
         } else if (call.method_name() == "closeComPort") {
-          com_port_handler_->CloseComPort();
-          result->Success();
+          // Writes still waiting for the port are answered as cancelled
+          executor_->CancelStrand("comport");
+          RunOnStrand("comport", std::move(result), [this]() {
+            com_port_handler_->CloseComPort();
+            return ChannelReply::Success();
+          });
         } else if (call.method_name() == "readComPort") {
           std::string data = com_port_handler_->GetLineData();
           result->Success(data);
+        } else if (call.method_name() == "getComPortStats") {
+          SpscRingStats stats = com_port_handler_->GetQueueStats();
+          int64_t avg_latency_us =
+              stats.popped > 0
+                  ? static_cast<int64_t>(stats.total_latency_ns / stats.popped / 1000)
+                  : 0;
+          flutter::EncodableMap map = {
+              {flutter::EncodableValue("pushed"), flutter::EncodableValue(static_cast<int64_t>(stats.pushed))},
+              {flutter::EncodableValue("popped"), flutter::EncodableValue(static_cast<int64_t>(stats.popped))},
+              {flutter::EncodableValue("dropped"), flutter::EncodableValue(static_cast<int64_t>(stats.dropped))},
+              {flutter::EncodableValue("size"), flutter::EncodableValue(static_cast<int64_t>(stats.size))},
+              {flutter::EncodableValue("capacity"), flutter::EncodableValue(static_cast<int64_t>(stats.capacity))},
+              {flutter::EncodableValue("highWaterMark"), flutter::EncodableValue(static_cast<int64_t>(stats.high_water_mark))},
+              {flutter::EncodableValue("avgLatencyUs"), flutter::EncodableValue(avg_latency_us)},
+              {flutter::EncodableValue("maxLatencyUs"), flutter::EncodableValue(static_cast<int64_t>(stats.max_latency_ns / 1000))},
+              {flutter::EncodableValue("overflowPolicy"), flutter::EncodableValue(std::string(OverflowPolicyName(com_port_handler_->queue_policy())))},
+          };
+          result->Success(flutter::EncodableValue(map));
         } else if (call.method_name() == "writeComPort") {
           const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
           if (arguments) {
             auto data_it = arguments->find(flutter::EncodableValue("data"));
             if (data_it != arguments->end()) {
               std::string data = std::get<std::string>(data_it->second);
-              bool success = com_port_handler_->WriteData(data);
-              result->Success(success);
+              // WriteFile may wait out its 50 ms timeout
+              RunOnStrand("comport", std::move(result), [this, data]() {
+                bool success = com_port_handler_->WriteData(data);
+                return ChannelReply::Success(flutter::EncodableValue(success));
+              });
               return;
             }
           }
@@ -250,3 +399,115 @@ void FlutterWindow::SetupComPortChannel() {
         }
       });
 }
+
+void FlutterWindow::SetupComPortEventChannel() {
+  comport_event_channel_ =
+      std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+          flutter_controller_->engine()->messenger(),
+          "com.example.pharm_parrot_flutter/comport/events",
+          &flutter::StandardMethodCodec::GetInstance());
+
+  auto handler = std::make_unique<
+      flutter::StreamHandlerFunctions<flutter::EncodableValue>>(
+      [this](const flutter::EncodableValue* arguments,
+             std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>&&
+                 events)
+          -> std::unique_ptr<
+              flutter::StreamHandlerError<flutter::EncodableValue>> {
+        comport_event_sink_ = std::move(events);
+        // Flush anything scanned before Dart started listening
+        DeliverComPortLines();
+        return nullptr;
+      },
+      [this](const flutter::EncodableValue* arguments)
+          -> std::unique_ptr<
+              flutter::StreamHandlerError<flutter::EncodableValue>> {
+        comport_event_sink_ = nullptr;
+        return nullptr;
+      });
+  comport_event_channel_->SetStreamHandler(std::move(handler));
+
+  // The read thread only posts a message; lines are delivered on the
+  // platform thread, which is the only thread allowed to use the sink.
+  com_port_handler_->SetDataAvailableCallback([this]() {
+    if (!comport_notify_pending_.exchange(true)) {
+      PostMessage(GetHandle(), kComPortDataMessage, 0, 0);
+    }
+  });
+}
+
+void FlutterWindow::DeliverComPortLines() {
+  if (!comport_event_sink_) {
+    return;
+  }
+
+  flutter::EncodableList lines;
+  for (std::string line = com_port_handler_->GetLineData(); !line.empty();
+       line = com_port_handler_->GetLineData()) {
+    lines.emplace_back(std::move(line));
+  }
+  if (!lines.empty()) {
+    comport_event_sink_->Success(flutter::EncodableValue(std::move(lines)));
+  }
+}
+
+void FlutterWindow::RunOnStrand(
+    const std::string& strand,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result,
+    std::function<ChannelReply()> work) {
+  // std::function needs copyable captures
+  std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared =
+      std::move(result);
+  executor_->Post(
+      strand,
+      [this, shared, work]() {
+        ChannelReply reply = work();
+        main_queue_->Post([shared, reply]() {
+          if (reply.value) {
+            shared->Success(*reply.value);
+          } else {
+            shared->Error(reply.error_code, reply.error_message);
+          }
+        });
+      },
+      // Cancelled from the platform thread, so answer directly
+      [shared]() { shared->Error("CANCELLED", "Cancelled before it started"); });
+}
+
+bool FlutterWindow::EnsureTtsVoice() {
+  if (!tts_voice_) {
+    CoCreateInstance(CLSID_SpVoice, nullptr, CLSCTX_ALL, IID_ISpVoice, (void**)&tts_voice_);
+  }
+  return tts_voice_ != nullptr;
+}
+
+void FlutterWindow::SetupExecutorChannel() {
+  auto channel = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+      flutter_controller_->engine()->messenger(),
+      "pharm_parrot/executor",
+      &flutter::StandardMethodCodec::GetInstance());
+
+  channel->SetMethodCallHandler(
+      [this](const flutter::MethodCall<flutter::EncodableValue>& call,
+         std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+        if (call.method_name() == "getStats") {
+          flutter::EncodableMap strands;
+          for (const auto& entry : executor_->GetStrandStats()) {
+            strands[flutter::EncodableValue(entry.first)] =
+                flutter::EncodableValue(TaskQueueStatsMap(entry.second));
+          }
+          MainThreadQueueStats main_thread = main_queue_->GetStats();
+          flutter::EncodableMap map = {
+              {flutter::EncodableValue("strands"), flutter::EncodableValue(strands)},
+              {flutter::EncodableValue("completions"), Int64Value(main_thread.completed)},
+              {flutter::EncodableValue("avgCompletionUs"), Int64Value(main_thread.completed > 0 ? main_thread.total_latency_us / main_thread.completed : 0)},
+              {flutter::EncodableValue("maxCompletionUs"), Int64Value(main_thread.max_latency_us)},
+              {flutter::EncodableValue("maxPlatformBusyUs"), Int64Value(main_thread.max_busy_us)},
+              {flutter::EncodableValue("platformBusyOverFrame"), Int64Value(main_thread.busy_over_frame)},
+          };
+          result->Success(flutter::EncodableValue(map));
+        } else {
+          result->NotImplemented();
+        }
+      });
+}
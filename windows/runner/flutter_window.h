@@ -2,13 +2,38 @@
 #define RUNNER_FLUTTER_WINDOW_H_
 
 #include <flutter/dart_project.h>
+#include <flutter/encodable_value.h>
+#include <flutter/event_channel.h>
 #include <flutter/flutter_view_controller.h>
+#include <flutter/method_result.h>
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <sapi.h>
+#include <string>
 
 #include "win32_window.h"
 #include "com_port_handler.h"
+#include "native/task_executor.h"
+#include "native/tone_generator.h"
+
+// Answer to a method call whose work ran on an executor thread; sent back
+// on the platform thread.
+struct ChannelReply {
+  static ChannelReply Success(
+      flutter::EncodableValue value = flutter::EncodableValue()) {
+    return ChannelReply{std::move(value), "", ""};
+  }
+  static ChannelReply Error(std::string code, std::string message) {
+    return ChannelReply{std::nullopt, std::move(code), std::move(message)};
+  }
+
+  std::optional<flutter::EncodableValue> value;
+  std::string error_code;
+  std::string error_message;
+};
 
 // A window that does nothing but host a Flutter view.
 class FlutterWindow : public Win32Window {
@@ -31,11 +56,43 @@ class FlutterWindow : public Win32Window {
   // The Flutter instance hosted by this window.
   std::unique_ptr<flutter::FlutterViewController> flutter_controller_;
   
-  // Global TTS voice instance
+  // Global TTS voice instance. Created, used and released on the "tts"
+  // strand, whose workers live in the multithreaded COM apartment.
   ISpVoice* tts_voice_ = nullptr;
+
+  // Beep tones as in-memory WAV images; PlaySound reads them while playing
+  ToneGenerator tone_generator_{22050};
+  // The image of the last beep, kept until the next one replaces the sound
+  // even if the generator evicts it. Used on the "tts" strand only.
+  std::shared_ptr<const std::string> playing_beep_;
   
   // COM Port handler instance
   std::unique_ptr<ComPortHandler> com_port_handler_;
+
+  // Pushes scanned lines to Dart as soon as the read thread queues them
+  std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>>
+      comport_event_channel_;
+  std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>
+      comport_event_sink_;
+
+  // Set while a wake-up message is in flight so bursts post only one
+  std::atomic<bool> comport_notify_pending_{false};
+
+  // Brings the executor's answers back to the platform thread
+  std::unique_ptr<MainThreadQueue> main_queue_;
+  // Channel work that can block (serial I/O, SAPI) runs here, one strand
+  // per service, so no method call holds up rendering.
+  std::unique_ptr<TaskExecutor> executor_;
+
+  // Runs |work| on |strand| and answers |result| with what it returns. If
+  // the work is cancelled before it starts, |result| gets "CANCELLED".
+  void RunOnStrand(
+      const std::string& strand,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result,
+      std::function<ChannelReply()> work);
+
+  // Creates the SAPI voice on first use ("tts" strand only)
+  bool EnsureTtsVoice();
   
   // Setup TTS platform channel
   void SetupTtsChannel();
@@ -45,6 +102,15 @@ class FlutterWindow : public Win32Window {
   
   // Setup COM Port platform channel
   void SetupComPortChannel();
+
+  // Setup COM Port event channel
+  void SetupComPortEventChannel();
+
+  // Send every queued line to the event sink (platform thread only)
+  void DeliverComPortLines();
+
+  // Setup the channel reporting executor and platform thread latency
+  void SetupExecutorChannel();
 };
 
 #endif  // RUNNER_FLUTTER_WINDOW_H_